@@ -3250,6 +3250,151 @@ dds_takecdr_instance (
     dds_instance_handle_t handle,
     uint32_t mask);
 
+/**
+ * @brief Read-only view of the serialized representation of a sample
+ *
+ * A view refers directly to the data as received (or, for local writers, as
+ * serialized by the writer), in the native byte order and 8-byte aligned. It
+ * remains valid until the loan through which it was obtained is returned using
+ * @ref dds_return_loan.
+ */
+typedef struct dds_cdr_view {
+  const void *data;             /**< serialized data, excluding the encoding header; NULL if !valid_data */
+  uint32_t size;                /**< size of the serialized data in bytes */
+  struct ddsi_serdata *serdata; /**< sample the view refers to */
+} dds_cdr_view_t;
+
+/**
+ * @brief Access the collection of samples as views on their serialized representation,
+ *        without deserializing them.
+ *
+ * This operation implements the same functionality as dds_read_mask_wl, except that
+ * instead of deserialized samples, it loans the application read-only views on the
+ * serialized data stored in the reader history cache. This avoids copying the contents
+ * of (large) sequences and strings. The contents can be accessed using
+ * @ref dds_cdr_view_get_prim and @ref dds_cdr_view_get_string.
+ *
+ * On success, buf[0 .. n-1] point to views that remain valid until they are returned
+ * using dds_return_loan (reader_or_condition, (void **) buf, n). Only readers using the
+ * default serialization of IDL types support views.
+ *
+ * @param[in]  reader_or_condition Reader, readcondition or querycondition entity.
+ * @param[out] buf An array of at least maxs pointers that is filled with pointers to views.
+ * @param[out] si Pointer to an array of at least maxs \ref dds_sample_info_t.
+ * @param[in]  maxs Maximum number of samples to read.
+ * @param[in]  mask Filter the data based on dds_sample_state_t|dds_view_state_t|dds_instance_state_t.
+ *
+ * @returns A dds_return_t with the number of samples read or an error code.
+ *
+ * @retval >=0
+ *             Number of samples read.
+ * @retval DDS_RETCODE_BAD_PARAMETER
+ *             One of the given arguments is not valid.
+ * @retval DDS_RETCODE_ILLEGAL_OPERATION
+ *             The operation is invoked on an inappropriate object.
+ * @retval DDS_RETCODE_ALREADY_DELETED
+ *             The entity has already been deleted.
+ * @retval DDS_RETCODE_UNSUPPORTED
+ *             The reader's type does not use the default serialization.
+ */
+DDS_EXPORT dds_return_t
+dds_read_cdrview(
+  dds_entity_t reader_or_condition,
+  const dds_cdr_view_t **buf,
+  dds_sample_info_t *si,
+  uint32_t maxs,
+  uint32_t mask);
+
+/**
+ * @brief Take the collection of samples as views on their serialized representation,
+ *        without deserializing them.
+ *
+ * This operation implements the same functionality as @ref dds_read_cdrview, except
+ * that the samples are removed from the reader. The data remains available until the
+ * loan is returned.
+ *
+ * @param[in]  reader_or_condition Reader, readcondition or querycondition entity.
+ * @param[out] buf An array of at least maxs pointers that is filled with pointers to views.
+ * @param[out] si Pointer to an array of at least maxs \ref dds_sample_info_t.
+ * @param[in]  maxs Maximum number of samples to take.
+ * @param[in]  mask Filter the data based on dds_sample_state_t|dds_view_state_t|dds_instance_state_t.
+ *
+ * @returns A dds_return_t with the number of samples taken or an error code.
+ *
+ * @retval >=0
+ *             Number of samples taken.
+ * @retval DDS_RETCODE_BAD_PARAMETER
+ *             One of the given arguments is not valid.
+ * @retval DDS_RETCODE_ILLEGAL_OPERATION
+ *             The operation is invoked on an inappropriate object.
+ * @retval DDS_RETCODE_ALREADY_DELETED
+ *             The entity has already been deleted.
+ * @retval DDS_RETCODE_UNSUPPORTED
+ *             The reader's type does not use the default serialization.
+ */
+DDS_EXPORT dds_return_t
+dds_take_cdrview(
+  dds_entity_t reader_or_condition,
+  const dds_cdr_view_t **buf,
+  dds_sample_info_t *si,
+  uint32_t maxs,
+  uint32_t mask);
+
+/**
+ * @brief Locate a member of primitive type, or a sequence or array of a primitive
+ *        type, in a view on a serialized sample
+ *
+ * The member is identified by its offset in the C representation of the type, so
+ * offsetof (T, m) locates member m. The returned pointer refers to the data in the
+ * view and is suitably aligned for the element type.
+ *
+ * @param[in]  view Pointer to a view returned by dds_read_cdrview/dds_take_cdrview.
+ * @param[in]  offset Offset of the member in the C representation of the type.
+ * @param[in]  elem_size Expected size of the (element) type in bytes.
+ * @param[out] ptr Set to the address of the (first element of the) member.
+ * @param[out] count Set to the number of elements, 1 for a primitive member.
+ *
+ * @returns A dds_return_t indicating success or failure.
+ *
+ * @retval DDS_RETCODE_OK
+ *             The member was located.
+ * @retval DDS_RETCODE_BAD_PARAMETER
+ *             There is no such member or it is not of the expected type.
+ * @retval DDS_RETCODE_PRECONDITION_NOT_MET
+ *             The view contains no data.
+ */
+DDS_EXPORT dds_return_t
+dds_cdr_view_get_prim(
+  const dds_cdr_view_t *view,
+  size_t offset,
+  uint32_t elem_size,
+  const void **ptr,
+  uint32_t *count);
+
+/**
+ * @brief Locate a (bounded) string member in a view on a serialized sample
+ *
+ * @param[in]  view Pointer to a view returned by dds_read_cdrview/dds_take_cdrview.
+ * @param[in]  offset Offset of the member in the C representation of the type.
+ * @param[out] str Set to the address of the 0-terminated string in the view.
+ * @param[out] len Set to the length of the string, excluding the terminating 0.
+ *
+ * @returns A dds_return_t indicating success or failure.
+ *
+ * @retval DDS_RETCODE_OK
+ *             The member was located.
+ * @retval DDS_RETCODE_BAD_PARAMETER
+ *             There is no such member or it is not a string.
+ * @retval DDS_RETCODE_PRECONDITION_NOT_MET
+ *             The view contains no data.
+ */
+DDS_EXPORT dds_return_t
+dds_cdr_view_get_string(
+  const dds_cdr_view_t *view,
+  size_t offset,
+  const char **str,
+  uint32_t *len);
+
 
 /**
  * @brief Access the collection of data values (of same type) and sample info from the
@@ -3538,7 +3683,8 @@ dds_read_next_wl(
  * When the application provides an empty buffer to a reader-loan, memory is allocated and
  * managed by DDS. By calling dds_return_loan, the reader-loan is released so that the buffer
  * can be reused during a successive read/take operation. When a condition is provided, the
- * reader to which the condition belongs is looked up.
+ * reader to which the condition belongs is looked up. Views obtained using dds_read_cdrview
+ * or dds_take_cdrview are returned in the same way, which releases the samples they refer to.
  *
  * Writer-loans are normally released implicitly when writing a loaned sample, but you can
  * cancel a writer-loan prematurely by invoking the return_loan operation. For writer loans, buf is
@@ -53,6 +53,28 @@ dds_key_descriptor_t;
   API is a pointer to the "topic_descriptor_t" struct type.
 */
 
+struct dds_istream;
+struct dds_ostream;
+struct dds_ostreamBE;
+
+/*
+  Type-specialized (de)serialization functions, as generated by idlc when
+  invoked with "-f native-serializers".  They operate on the same streams and
+  produce/accept the same representation as the interpretation of m_ops, but
+  without the overhead of interpreting it for each sample.  Any of them may
+  be NULL, in which case m_ops is interpreted instead.
+*/
+
+typedef struct dds_topic_native_ops
+{
+  void (*m_write) (struct dds_ostream *os, const void *sample);
+  void (*m_read) (struct dds_istream *is, void *sample);
+  bool (*m_normalize) (char *data, uint32_t *off, uint32_t size, bool bswap);
+  void (*m_write_keyBE) (struct dds_ostreamBE *os, const void *sample);
+  void (*m_extract_keyBE) (struct dds_istream *is, struct dds_ostreamBE *os);
+}
+dds_topic_native_ops_t;
+
 typedef struct dds_topic_descriptor
 {
   const uint32_t m_size;               /* Size of topic type */
@@ -64,6 +86,7 @@ typedef struct dds_topic_descriptor
   const uint32_t m_nops;               /* Number of ops in m_ops */
   const uint32_t * m_ops;              /* Marshalling meta data */
   const char * m_meta;                 /* XML topic description meta data */
+  const dds_topic_native_ops_t * m_native_ops; /* Native (de)serializers, only present if DDS_TOPIC_NATIVE_OPS is set in m_flagset */
 }
 dds_topic_descriptor_t;
 
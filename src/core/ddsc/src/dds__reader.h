@@ -25,6 +25,8 @@ void dds_reader_status_cb (void *entity, const struct status_cb_data * data);
 
 dds_return_t dds_return_reader_loan (dds_reader *rd, void **buf, int32_t bufsz);
 
+void dds_reader_free_cdrview_loans (dds_reader *rd);
+
 /*
   dds_reader_lock_samples: Returns number of samples in read cache and locks the
   reader cache to make sure that the samples content doesn't change.
@@ -13,6 +13,7 @@
 #define _DDS_RHC_DEFAULT_H_
 
 #include "dds/features.h"
+#include "dds__types.h"
 
 #if defined (__cplusplus)
 extern "C" {
@@ -27,6 +28,32 @@ struct rhc_sample;
 
 DDS_EXPORT struct dds_rhc *dds_rhc_default_new_xchecks (dds_reader *reader, struct ddsi_domaingv *gv, const struct ddsi_sertype *type, bool xchecks);
 DDS_EXPORT struct dds_rhc *dds_rhc_default_new (struct dds_reader *reader, const struct ddsi_sertype *type);
+
+/* Read conditions attached to a reader history cache: a stand-alone default
+   RHC has its own set, the shards of a sharded RHC (dds__rhc_sharded.h) share
+   one.  The set may only be modified while all RHCs sharing it are locked. */
+struct dds_rhc_default_conds {
+  struct dds_readcond *conds;            /* List of associated read conditions */
+  uint32_t nconds;                       /* Number of associated read conditions */
+  uint32_t nqconds;                      /* Number of associated query conditions */
+  dds_querycond_mask_t qconds_samplest;  /* Mask of associated query conditions that check the sample state */
+};
+
+struct dds_rhc *dds_rhc_default_new_shard (struct dds_reader *reader, struct ddsi_domaingv *gv, const struct ddsi_sertype *type, bool xchecks, struct dds_rhc_default_conds *conds);
+void dds_rhc_default_lock (struct dds_rhc *rhc);
+void dds_rhc_default_unlock (struct dds_rhc *rhc);
+uint32_t dds_rhc_default_nsamples_locked (const struct dds_rhc *rhc);
+bool dds_rhc_default_conds_add (struct dds_rhc_default_conds *conds, struct dds_readcond *cond);
+void dds_rhc_default_conds_remove (struct dds_rhc_default_conds *conds, struct dds_readcond *cond);
+void dds_rhc_default_add_readcondition_locked (struct dds_rhc *rhc, struct dds_readcond *cond);
+void dds_rhc_default_remove_readcondition_locked (struct dds_rhc *rhc, struct dds_readcond *cond);
+
+struct dds_slab_stats;
+
+/* Adds the memory statistics of "rhc" to "st" if it is a default RHC, returns false
+   without touching "st" otherwise */
+bool dds_rhc_default_add_alloc_stats (struct dds_rhc *rhc, struct dds_slab_stats *st);
+
 #ifdef DDS_HAS_LIFESPAN
 DDS_EXPORT ddsrt_mtime_t dds_rhc_default_sample_expired_cb(void *hc, ddsrt_mtime_t tnow);
 #endif
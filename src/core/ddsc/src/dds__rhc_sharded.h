@@ -0,0 +1,66 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#ifndef _DDS_RHC_SHARDED_H_
+#define _DDS_RHC_SHARDED_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+struct dds_rhc;
+struct dds_reader;
+struct ddsi_sertype;
+struct ddsi_domaingv;
+
+#define DDS_RHC_SHARDED_MAX_SHARDS 256u
+
+/* Name of the reader QoS property that overrides Internal/ReaderHistoryShards */
+#define DDS_RHC_SHARDS_PROPERTY "org.eclipse.cyclonedds.rhc.shards"
+
+/** @brief Creates a reader history cache that partitions the instances over
+ * "nshards" default RHCs, each with its own lock.
+ *
+ * Instances are assigned to shards based on their instance handle, so storing
+ * data for different instances only contends for the lock if the instances
+ * happen to be in the same shard.  Read and take visit the shards in turn,
+ * holding only one lock at a time, and therefore do not return a consistent
+ * snapshot of the reader history cache as a whole.
+ *
+ * Resource limits on the number of samples and instances would be applied per
+ * shard, therefore readers only use it if these are unlimited.
+ *
+ * @param[in] reader  reader owning the history cache, may be NULL
+ * @param[in] gv      domain globals
+ * @param[in] type    type of the data
+ * @param[in] xchecks whether to do expensive consistency checks
+ * @param[in] nshards number of shards, 1 < nshards <= DDS_RHC_SHARDED_MAX_SHARDS
+ *
+ * @returns the new reader history cache
+ */
+struct dds_rhc *dds_rhc_sharded_new_xchecks (struct dds_reader *reader, struct ddsi_domaingv *gv, const struct ddsi_sertype *type, bool xchecks, uint32_t nshards);
+
+/** @brief Creates a sharded reader history cache for "reader" */
+struct dds_rhc *dds_rhc_sharded_new (struct dds_reader *reader, const struct ddsi_sertype *type, uint32_t nshards);
+
+struct dds_slab_stats;
+
+/** @brief Adds the memory statistics of all shards to "st" if "rhc" is a sharded RHC
+ * @returns false without touching "st" if "rhc" is not a sharded RHC */
+bool dds_rhc_sharded_add_alloc_stats (struct dds_rhc *rhc, struct dds_slab_stats *st);
+
+#if defined (__cplusplus)
+}
+#endif
+#endif
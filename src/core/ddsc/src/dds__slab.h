@@ -0,0 +1,70 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#ifndef DDS__SLAB_H
+#define DDS__SLAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dds/export.h"
+#include "dds/ddsrt/avl.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/* Slab allocator for fixed-size objects: objects are carved out of chunks of
+   increasing size (up to DDS_SLAB_MAX_CHUNK_BYTES) and freed objects are kept
+   on a per-chunk free list for reuse.  A chunk that no longer contains any
+   objects in use is kept for reuse if fewer than "max_cached_chunks" chunks
+   are cached, and returned to the heap otherwise.
+
+   Not thread-safe: the owner is responsible for locking. */
+
+#define DDS_SLAB_MIN_CHUNK_OBJS 16u
+#define DDS_SLAB_MAX_CHUNK_BYTES 65536u
+
+struct dds_slab_chunk;
+
+struct dds_slab {
+  size_t objsize;                    /* object size, rounded up for alignment */
+  uint32_t next_chunk_nobjs;         /* number of objects in next chunk to allocate */
+  uint32_t max_chunk_nobjs;          /* upper bound for next_chunk_nobjs */
+  uint32_t max_cached_chunks;        /* upper bound for ncached */
+  ddsrt_avl_tree_t chunks;           /* chunks with objects in use, by address */
+  struct dds_slab_chunk *avail;      /* chunks with objects in use and room for more */
+  struct dds_slab_chunk *cached;     /* empty chunks kept for reuse */
+  uint32_t nchunks;                  /* number of chunks with objects in use */
+  uint32_t ncached;                  /* number of cached chunks */
+  uint32_t ninuse;                   /* number of objects currently in use */
+  size_t bytes;                      /* bytes allocated from the heap, including cached chunks */
+};
+
+struct dds_slab_stats {
+  uint64_t bytes;                    /* bytes allocated from the heap */
+  uint64_t bytes_in_use;             /* bytes in objects in use */
+  uint64_t chunks;                   /* number of chunks with objects in use */
+  uint64_t cached_chunks;            /* number of empty chunks kept for reuse */
+};
+
+DDS_EXPORT void dds_slab_init (struct dds_slab *slab, size_t objsize, uint32_t max_cached_chunks);
+DDS_EXPORT void dds_slab_fini (struct dds_slab *slab);
+DDS_EXPORT void *dds_slab_alloc (struct dds_slab *slab);
+DDS_EXPORT void dds_slab_free (struct dds_slab *slab, void *obj);
+
+/* Adds the statistics of "slab" to "st" */
+DDS_EXPORT void dds_slab_add_stats (const struct dds_slab *slab, struct dds_slab_stats *st);
+
+#if defined (__cplusplus)
+}
+#endif
+#endif /* DDS__SLAB_H */
@@ -49,6 +49,7 @@ struct dds_statuscond;
 
 struct ddsi_sertype;
 struct ddsi_rhc;
+struct ddsi_serdata_default_cache;
 
 typedef uint16_t status_mask_t;
 typedef ddsrt_atomic_uint32_t status_and_enabled_t;
@@ -332,6 +333,8 @@ typedef struct dds_reader {
   bool m_loan_out;
   void *m_loan;
   uint32_t m_loan_size;
+  struct dds_cdr_view_loan *m_cdrview_loans; /* [m_entity.m_mutex] outstanding loans of views on serialized data */
+  struct dds_cdr_view_loan *m_cdrview_cache; /* [m_entity.m_mutex] returned loan kept for reuse */
   unsigned m_wrapped_sertopic : 1; /* set iff reader's topic is a wrapped ddsi_sertopic for backwards compatibility */
 #ifdef DDS_HAS_SHM
   iox_sub_storage_extension_t m_iox_sub_stor;
@@ -355,6 +358,7 @@ typedef struct dds_writer {
   struct writer *m_wr;
   struct whc *m_whc; /* FIXME: ownership still with underlying DDSI writer (cos of DDSI built-in writers )*/
   bool whc_batch; /* FIXME: channels + latency budget */
+  struct ddsi_serdata_default_cache *m_serdata_cache; /* NULL unless enabled via DDS_WRITER_SERDATA_CACHE_PROPERTY */
 #ifdef DDS_HAS_SHM
   iox_pub_storage_t m_iox_pub_stor;
   iox_pub_t m_iox_pub;
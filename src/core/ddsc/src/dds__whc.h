@@ -19,10 +19,44 @@ extern "C" {
 #endif
 
 struct ddsi_domaingv;
-struct whc_writer_info;
 struct dds_writer;
 
+struct whc_writer_info {
+  struct dds_writer *writer; /* can be NULL, eg in case of whc for built-in writers */
+  unsigned is_transient_local: 1;
+  unsigned has_deadline: 1;
+  uint32_t hdepth; /* 0 = unlimited */
+  uint32_t tldepth; /* 0 = disabled/unlimited (no need to maintain an index if KEEP_ALL <=> is_transient_local + tldepth=0) */
+  uint32_t idxdepth; /* = max (hdepth, tldepth) */
+};
+
 struct whc *whc_new (struct ddsi_domaingv *gv, const struct whc_writer_info *wrinfo);
+
+/* The compact WHC limits the per-instance history depth it handles */
+#define WHC_COMPACT_MAX_IDXDEPTH 65536u
+
+/** @brief Whether the compact WHC can be used for a writer
+ *
+ * It does not implement deadline and lifespan handling, and it keeps the
+ * histories of all instances in a single array, which limits the depth.
+ */
+bool whc_compact_supported (const struct whc_writer_info *wrinfo);
+
+/** @brief Creates a compact WHC
+ *
+ * The compact WHC stores the samples in a ring buffer in sequence number order,
+ * locating a sample by indexing it directly if the sequence numbers are dense
+ * and by a binary search otherwise.  The instance index is an open addressing
+ * hash table over a contiguous array of instances that have their histories
+ * stored as sequence numbers.  It trades some CPU time in retransmits of
+ * sparse sequence numbers for a much lower per-sample overhead.
+ *
+ * @param[in] gv      domain globals
+ * @param[in] wrinfo  writer info, whc_compact_supported (wrinfo) must be true
+ *
+ * @returns the new WHC
+ */
+struct whc *whc_compact_new (struct ddsi_domaingv *gv, const struct whc_writer_info *wrinfo);
 struct whc_writer_info *whc_make_wrinfo (struct dds_writer *wr, const dds_qos_t *qos);
 void whc_free_wrinfo (struct whc_writer_info *);
 
@@ -20,6 +20,14 @@ extern "C" {
 
 DEFINE_ENTITY_LOCK_UNLOCK(dds_writer, DDS_KIND_WRITER)
 
+/* Name of the writer QoS property that enables caching of serialized samples, the
+   value is the number of distinct samples to cache (0 = disabled) */
+#define DDS_WRITER_SERDATA_CACHE_PROPERTY "org.eclipse.cyclonedds.writer.serdata_cache"
+#define DDS_WRITER_SERDATA_CACHE_MAX_SLOTS 4096u
+
+/* Name of the writer QoS property that selects the compact WHC ("true" to enable) */
+#define DDS_WRITER_WHC_COMPACT_PROPERTY "org.eclipse.cyclonedds.writer.whc_compact"
+
 struct status_cb_data;
 
 void dds_writer_status_cb (void *entity, const struct status_cb_data * data);
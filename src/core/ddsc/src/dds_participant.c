@@ -20,12 +20,14 @@
 #include "dds/ddsi/ddsi_plist.h"
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/ddsi_entity_index.h"
+#include "dds/ddsi/ddsi_statistics.h"
 #include "dds/version.h"
 #include "dds__init.h"
 #include "dds__domain.h"
 #include "dds__participant.h"
 #include "dds__builtin.h"
 #include "dds__qos.h"
+#include "dds__statistics.h"
 
 DECL_ENTITY_LOCK_UNLOCK (dds_participant)
 
@@ -80,14 +82,51 @@ static dds_return_t dds_participant_qos_set (dds_entity *e, const dds_qos_t *qos
   return DDS_RETCODE_OK;
 }
 
+static const struct dds_stat_keyvalue_descriptor dds_participant_statistics_kv[] = {
+  { "recv_batch_count", DDS_STAT_KIND_UINT64 },
+  { "recv_batch_packets", DDS_STAT_KIND_UINT64 },
+  { "xmit_batch_count", DDS_STAT_KIND_UINT64 },
+  { "xmit_batch_packets", DDS_STAT_KIND_UINT64 },
+  { "dqueue_wakeups_spun", DDS_STAT_KIND_UINT64 },
+  { "dqueue_wakeups_parked", DDS_STAT_KIND_UINT64 },
+  { "sedp_sample_count", DDS_STAT_KIND_UINT64 },
+  { "sedp_processing_time", DDS_STAT_KIND_UINT64 },
+  { "qos_match_cache_hits", DDS_STAT_KIND_UINT64 },
+  { "qos_match_cache_misses", DDS_STAT_KIND_UINT64 },
+  { "wraddrset_rebuild_count", DDS_STAT_KIND_UINT64 },
+  { "wraddrset_rebuild_time", DDS_STAT_KIND_UINT64 },
+  { "wraddrset_update_count", DDS_STAT_KIND_UINT64 },
+  { "wraddrset_update_time", DDS_STAT_KIND_UINT64 }
+};
+
+static const struct dds_stat_descriptor dds_participant_statistics_desc = {
+  .count = sizeof (dds_participant_statistics_kv) / sizeof (dds_participant_statistics_kv[0]),
+  .kv = dds_participant_statistics_kv
+};
+
+static struct dds_statistics *dds_participant_create_statistics (const struct dds_entity *entity)
+{
+  return dds_alloc_statistics (entity, &dds_participant_statistics_desc);
+}
+
+static void dds_participant_refresh_statistics (const struct dds_entity *entity, struct dds_statistics *stat)
+{
+  /* receiving, sending and delivering are not participant-specific, these cover the domain */
+  ddsi_get_recv_stats (&entity->m_domain->gv, &stat->kv[0].u.u64, &stat->kv[1].u.u64);
+  ddsi_get_xmit_stats (&entity->m_domain->gv, &stat->kv[2].u.u64, &stat->kv[3].u.u64);
+  ddsi_get_dqueue_stats (&entity->m_domain->gv, &stat->kv[4].u.u64, &stat->kv[5].u.u64);
+  ddsi_get_discovery_stats (&entity->m_domain->gv, &stat->kv[6].u.u64, &stat->kv[7].u.u64, &stat->kv[8].u.u64, &stat->kv[9].u.u64);
+  ddsi_get_wraddrset_stats (&entity->m_domain->gv, &stat->kv[10].u.u64, &stat->kv[11].u.u64, &stat->kv[12].u.u64, &stat->kv[13].u.u64);
+}
+
 const struct dds_entity_deriver dds_entity_deriver_participant = {
   .interrupt = dds_entity_deriver_dummy_interrupt,
   .close = dds_entity_deriver_dummy_close,
   .delete = dds_participant_delete,
   .set_qos = dds_participant_qos_set,
   .validate_status = dds_participant_status_validate,
-  .create_statistics = dds_entity_deriver_dummy_create_statistics,
-  .refresh_statistics = dds_entity_deriver_dummy_refresh_statistics
+  .create_statistics = dds_participant_create_statistics,
+  .refresh_statistics = dds_participant_refresh_statistics
 };
 
 dds_entity_t dds_create_participant (const dds_domainid_t domain, const dds_qos_t *qos, const dds_listener_t *listener)
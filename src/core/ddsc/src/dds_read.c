@@ -11,6 +11,7 @@
  */
 #include <assert.h>
 #include <string.h>
+#include "dds/ddsrt/heap.h"
 #include "dds__entity.h"
 #include "dds__reader.h"
 #include "dds/ddsi/ddsi_tkmap.h"
@@ -21,6 +22,8 @@
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/ddsi_sertype.h"
 #include "dds/ddsi/ddsi_sertopic.h" // for extern ddsi_sertopic_serdata_ops_wrap
+#include "dds/ddsi/ddsi_serdata_default.h"
+#include "dds/ddsi/ddsi_cdrstream.h"
 
 /*
   dds_read_impl: Core read/take function. Usually maxs is size of buf and si
@@ -495,6 +498,187 @@ dds_return_t dds_takecdr_instance (dds_entity_t rd_or_cnd, struct ddsi_serdata *
   return dds_readcdr_impl(true, rd_or_cnd, buf, maxs, si, mask, handle, lock);
 }
 
+/* Views on serialized data are loaned out in blocks, one per read/take, that
+   also hold the references to the serdata.  Outstanding blocks are tracked by
+   the reader so that dds_return_loan can recognise them; the most recently
+   returned one is kept for reuse. */
+struct dds_cdr_view_loan {
+  struct dds_cdr_view_loan *next;
+  uint32_t size;                  /* capacity of views, serdata */
+  uint32_t n;                     /* number of views in use */
+  struct ddsi_serdata **serdata;  /* points into the same allocation, following views */
+  dds_cdr_view_t views[];
+};
+
+static bool dds_reader_supports_cdrview (const struct dds_reader *rd)
+{
+  const struct ddsi_sertype *st = rd->m_topic->m_stype;
+  if (rd->m_wrapped_sertopic)
+    return false;
+#ifdef DDS_HAS_SHM
+  /* data received via Iceoryx is not available in serialized form */
+  if (rd->m_iox_sub != NULL)
+    return false;
+#endif
+  return st->serdata_ops == &ddsi_serdata_ops_cdr || st->serdata_ops == &ddsi_serdata_ops_cdr_nokey;
+}
+
+static void dds_cdr_view_loan_release (struct dds_reader *rd, struct dds_cdr_view_loan *loan)
+{
+  /* caller must hold rd->m_entity.m_mutex */
+  for (uint32_t i = 0; i < loan->n; i++)
+    ddsi_serdata_unref (loan->serdata[i]);
+  loan->n = 0;
+  if (rd->m_cdrview_cache == NULL)
+    rd->m_cdrview_cache = loan;
+  else if (rd->m_cdrview_cache->size < loan->size)
+  {
+    ddsrt_free (rd->m_cdrview_cache);
+    rd->m_cdrview_cache = loan;
+  }
+  else
+  {
+    ddsrt_free (loan);
+  }
+}
+
+static dds_return_t dds_read_cdrview_impl (bool take, dds_entity_t reader_or_condition, const dds_cdr_view_t **buf, dds_sample_info_t *si, uint32_t maxs, uint32_t mask)
+{
+  struct dds_entity *entity;
+  struct dds_reader *rd;
+  struct dds_cdr_view_loan *loan;
+  dds_return_t ret;
+
+  if (buf == NULL || si == NULL || maxs == 0 || maxs > INT32_MAX)
+    return DDS_RETCODE_BAD_PARAMETER;
+
+  if ((ret = dds_entity_pin (reader_or_condition, &entity)) < 0) {
+    return ret;
+  } else if (dds_entity_kind (entity) == DDS_KIND_READER) {
+    rd = (dds_reader *) entity;
+  } else if (dds_entity_kind (entity) != DDS_KIND_COND_READ && dds_entity_kind (entity) != DDS_KIND_COND_QUERY) {
+    dds_entity_unpin (entity);
+    return DDS_RETCODE_ILLEGAL_OPERATION;
+  } else {
+    rd = (dds_reader *) entity->m_parent;
+  }
+
+  if (!dds_reader_supports_cdrview (rd))
+  {
+    dds_entity_unpin (entity);
+    return DDS_RETCODE_UNSUPPORTED;
+  }
+
+  ddsrt_mutex_lock (&rd->m_entity.m_mutex);
+  if ((loan = rd->m_cdrview_cache) != NULL && loan->size >= maxs)
+    rd->m_cdrview_cache = NULL;
+  else
+    loan = NULL;
+  ddsrt_mutex_unlock (&rd->m_entity.m_mutex);
+  if (loan == NULL)
+  {
+    loan = ddsrt_malloc (sizeof (*loan) + maxs * (sizeof (loan->views[0]) + sizeof (*loan->serdata)));
+    loan->size = maxs;
+    loan->n = 0;
+    loan->serdata = (struct ddsi_serdata **) (loan->views + maxs);
+  }
+
+  ret = dds_readcdr_impl (take, reader_or_condition, loan->serdata, maxs, si, mask, DDS_HANDLE_NIL, true);
+  for (int32_t i = 0; i < ret; i++)
+  {
+    /* Received data has been normalized to the native byte order by dds_stream_normalize
+       and local data is serialized in the native byte order to begin with */
+    const struct ddsi_serdata_default *d = (const struct ddsi_serdata_default *) loan->serdata[i];
+    dds_cdr_view_t * const v = &loan->views[i];
+    v->serdata = loan->serdata[i];
+    v->data = si[i].valid_data ? d->data : NULL;
+    v->size = si[i].valid_data ? d->pos : 0;
+    buf[i] = v;
+  }
+
+  ddsrt_mutex_lock (&rd->m_entity.m_mutex);
+  if (ret > 0)
+  {
+    loan->n = (uint32_t) ret;
+    loan->next = rd->m_cdrview_loans;
+    rd->m_cdrview_loans = loan;
+  }
+  else
+  {
+    dds_cdr_view_loan_release (rd, loan);
+  }
+  ddsrt_mutex_unlock (&rd->m_entity.m_mutex);
+  dds_entity_unpin (entity);
+  return ret;
+}
+
+dds_return_t dds_read_cdrview (dds_entity_t rd_or_cnd, const dds_cdr_view_t **buf, dds_sample_info_t *si, uint32_t maxs, uint32_t mask)
+{
+  return dds_read_cdrview_impl (false, rd_or_cnd, buf, si, maxs, mask);
+}
+
+dds_return_t dds_take_cdrview (dds_entity_t rd_or_cnd, const dds_cdr_view_t **buf, dds_sample_info_t *si, uint32_t maxs, uint32_t mask)
+{
+  return dds_read_cdrview_impl (true, rd_or_cnd, buf, si, maxs, mask);
+}
+
+void dds_reader_free_cdrview_loans (struct dds_reader *rd)
+{
+  struct dds_cdr_view_loan *loan;
+  ddsrt_mutex_lock (&rd->m_entity.m_mutex);
+  while ((loan = rd->m_cdrview_loans) != NULL)
+  {
+    rd->m_cdrview_loans = loan->next;
+    dds_cdr_view_loan_release (rd, loan);
+  }
+  ddsrt_free (rd->m_cdrview_cache);
+  rd->m_cdrview_cache = NULL;
+  ddsrt_mutex_unlock (&rd->m_entity.m_mutex);
+}
+
+static dds_return_t dds_cdr_view_locate (const dds_cdr_view_t *view, size_t offset, struct dds_stream_member_loc *loc)
+{
+  if (view == NULL || view->serdata == NULL || offset > UINT32_MAX)
+    return DDS_RETCODE_BAD_PARAMETER;
+  if (view->data == NULL || view->size == 0)
+    return DDS_RETCODE_PRECONDITION_NOT_MET;
+  const struct ddsi_sertype_default *type = (const struct ddsi_sertype_default *) view->serdata->type;
+  dds_istream_t is = { .m_buffer = view->data, .m_size = view->size, .m_index = 0 };
+  if (!dds_stream_locate_member (&is, type, (uint32_t) offset, loc))
+    return DDS_RETCODE_BAD_PARAMETER;
+  return DDS_RETCODE_OK;
+}
+
+dds_return_t dds_cdr_view_get_prim (const dds_cdr_view_t *view, size_t offset, uint32_t elem_size, const void **ptr, uint32_t *count)
+{
+  struct dds_stream_member_loc loc;
+  dds_return_t ret;
+  if (ptr == NULL || count == NULL)
+    return DDS_RETCODE_BAD_PARAMETER;
+  if ((ret = dds_cdr_view_locate (view, offset, &loc)) != DDS_RETCODE_OK)
+    return ret;
+  if (loc.elem_size == 0 || loc.elem_size != elem_size)
+    return DDS_RETCODE_BAD_PARAMETER;
+  *ptr = (const char *) view->data + loc.index;
+  *count = loc.count;
+  return DDS_RETCODE_OK;
+}
+
+dds_return_t dds_cdr_view_get_string (const dds_cdr_view_t *view, size_t offset, const char **str, uint32_t *len)
+{
+  struct dds_stream_member_loc loc;
+  dds_return_t ret;
+  if (str == NULL || len == NULL)
+    return DDS_RETCODE_BAD_PARAMETER;
+  if ((ret = dds_cdr_view_locate (view, offset, &loc)) != DDS_RETCODE_OK)
+    return ret;
+  if (loc.type != DDS_OP_VAL_STR && loc.type != DDS_OP_VAL_BST)
+    return DDS_RETCODE_BAD_PARAMETER;
+  *str = (const char *) view->data + loc.index;
+  *len = loc.count;
+  return DDS_RETCODE_OK;
+}
+
 dds_return_t dds_take_next (dds_entity_t reader, void **buf, dds_sample_info_t *si)
 {
   uint32_t mask = DDS_NOT_READ_SAMPLE_STATE | DDS_ANY_VIEW_STATE | DDS_ANY_INSTANCE_STATE;
@@ -526,7 +710,18 @@ dds_return_t dds_return_reader_loan (dds_reader *rd, void **buf, int32_t bufsz)
      the observer_lock), so holding it for a bit longer in return for simpler
      code is a fair trade-off. */
   ddsrt_mutex_lock (&rd->m_entity.m_mutex);
-  if (buf[0] != rd->m_loan)
+  struct dds_cdr_view_loan **ploan = &rd->m_cdrview_loans;
+  while (*ploan != NULL && (void *) (*ploan)->views != buf[0])
+    ploan = &(*ploan)->next;
+  if (*ploan != NULL)
+  {
+    /* Views on serialized data: releases the references to the samples */
+    struct dds_cdr_view_loan * const loan = *ploan;
+    *ploan = loan->next;
+    dds_cdr_view_loan_release (rd, loan);
+    buf[0] = NULL;
+  }
+  else if (buf[0] != rd->m_loan)
   {
     /* Not so much a loan as a buffer allocated by the middleware on behalf of the
        application.  So it really is no more than a sophisticated variant of "free". */
@@ -15,6 +15,7 @@
 #include "dds/version.h"
 #include "dds/ddsrt/static_assert.h"
 #include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/strtol.h"
 #include "dds__participant.h"
 #include "dds__subscriber.h"
 #include "dds__reader.h"
@@ -22,6 +23,8 @@
 #include "dds__init.h"
 #include "dds/ddsc/dds_rhc.h"
 #include "dds__rhc_default.h"
+#include "dds__rhc_sharded.h"
+#include "dds__slab.h"
 #include "dds__topic.h"
 #include "dds__get_status.h"
 #include "dds__qos.h"
@@ -97,6 +100,7 @@ static dds_return_t dds_reader_delete (dds_entity *e)
     ddsi_sertype_free_samples (rd->m_topic->m_stype, ptrs, rd->m_loan_size, DDS_FREE_ALL);
     ddsrt_free (ptrs);
   }
+  dds_reader_free_cdrview_loans (rd);
 
   thread_state_awake (lookup_thread_state (), &e->m_domain->gv);
   dds_rhc_free (rd->m_rhc);
@@ -437,7 +441,11 @@ void dds_reader_status_cb (void *ventity, const status_cb_data_t *data)
 }
 
 static const struct dds_stat_keyvalue_descriptor dds_reader_statistics_kv[] = {
-  { "discarded_bytes", DDS_STAT_KIND_UINT64 }
+  { "discarded_bytes", DDS_STAT_KIND_UINT64 },
+  { "rhc_bytes", DDS_STAT_KIND_UINT64 },
+  { "rhc_bytes_in_use", DDS_STAT_KIND_UINT64 },
+  { "rhc_chunks", DDS_STAT_KIND_UINT64 },
+  { "rhc_cached_chunks", DDS_STAT_KIND_UINT64 }
 };
 
 static const struct dds_stat_descriptor dds_reader_statistics_desc = {
@@ -455,6 +463,14 @@ static void dds_reader_refresh_statistics (const struct dds_entity *entity, stru
   const struct dds_reader *rd = (const struct dds_reader *) entity;
   if (rd->m_rd)
     ddsi_get_reader_stats (rd->m_rd, &stat->kv[0].u.u64);
+  /* memory used for instances and samples in the history cache (if it keeps track) */
+  struct dds_slab_stats st = { 0, 0, 0, 0 };
+  if (!dds_rhc_default_add_alloc_stats (rd->m_rhc, &st))
+    (void) dds_rhc_sharded_add_alloc_stats (rd->m_rhc, &st);
+  stat->kv[1].u.u64 = st.bytes;
+  stat->kv[2].u.u64 = st.bytes_in_use;
+  stat->kv[3].u.u64 = st.chunks;
+  stat->kv[4].u.u64 = st.cached_chunks;
 }
 
 const struct dds_entity_deriver dds_entity_deriver_reader = {
@@ -490,6 +506,29 @@ static bool dds_reader_support_shm(const struct ddsi_config* cfg, const dds_qos_
 }
 #endif
 
+static struct dds_rhc *dds_reader_new_rhc (struct dds_reader *rd, const dds_qos_t *qos, const struct ddsi_sertype *type)
+{
+  /* Number of shards from the configuration, overridden by a property in the reader QoS;
+     resource limits would be applied per shard, so those must be unlimited for sharding */
+  uint32_t nshards = rd->m_entity.m_domain->gv.config.rhc_shards;
+  const char *value;
+  if (ddsi_xqos_find_prop (qos, DDS_RHC_SHARDS_PROPERTY, &value))
+  {
+    long long v;
+    char *endp;
+    if (ddsrt_strtoll (value, &endp, 10, &v) == DDS_RETCODE_OK && *endp == 0 && v >= 0)
+      nshards = (v > DDS_RHC_SHARDED_MAX_SHARDS) ? DDS_RHC_SHARDED_MAX_SHARDS : (uint32_t) v;
+  }
+  if (nshards > DDS_RHC_SHARDED_MAX_SHARDS)
+    nshards = DDS_RHC_SHARDED_MAX_SHARDS;
+  if (nshards > 1 &&
+      qos->resource_limits.max_samples == DDS_LENGTH_UNLIMITED &&
+      qos->resource_limits.max_instances == DDS_LENGTH_UNLIMITED)
+    return dds_rhc_sharded_new (rd, type, nshards);
+  else
+    return dds_rhc_default_new (rd, type);
+}
+
 static dds_entity_t dds_create_reader_int (dds_entity_t participant_or_subscriber, dds_entity_t topic, const dds_qos_t *qos, const dds_listener_t *listener, struct dds_rhc *rhc)
 {
   dds_qos_t *rqos;
@@ -621,7 +660,7 @@ static dds_entity_t dds_create_reader_int (dds_entity_t participant_or_subscribe
   rd->m_sample_rejected_status.last_reason = DDS_NOT_REJECTED;
   rd->m_topic = tp;
   rd->m_wrapped_sertopic = (tp->m_stype->wrapped_sertopic != NULL) ? 1 : 0;
-  rd->m_rhc = rhc ? rhc : dds_rhc_default_new (rd, tp->m_stype);
+  rd->m_rhc = rhc ? rhc : dds_reader_new_rhc (rd, rqos, tp->m_stype);
   if (dds_rhc_associate (rd->m_rhc, rd, tp->m_stype, rd->m_entity.m_domain->gv.m_tkmap) < 0)
   {
     /* FIXME: see also create_querycond, need to be able to undo entity_init */
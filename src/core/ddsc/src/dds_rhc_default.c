@@ -27,6 +27,7 @@
 #include "dds__reader.h"
 #include "dds/ddsc/dds_rhc.h"
 #include "dds__rhc_default.h"
+#include "dds__slab.h"
 #include "dds/ddsi/ddsi_tkmap.h"
 #include "dds/ddsrt/hopscotch.h"
 #include "dds/ddsrt/avl.h"
@@ -322,11 +323,11 @@ struct dds_rhc_default {
   uint32_t history_depth;            /* depth, 1 for KEEP_LAST_1, 2**32-1 for KEEP_ALL */
 
   ddsrt_mutex_t lock;
-  dds_readcond * conds;              /* List of associated read conditions */
-  uint32_t nconds;                   /* Number of associated read conditions */
-  uint32_t nqconds;                  /* Number of associated query conditions */
-  dds_querycond_mask_t qconds_samplest;  /* Mask of associated query conditions that check the sample state */
+  struct dds_rhc_default_conds *cs;  /* Associated read conditions, points to own_conds unless a shard */
+  struct dds_rhc_default_conds own_conds; /* Read conditions of a stand-alone RHC */
   void *qcond_eval_samplebuf;        /* Temporary storage for evaluating query conditions, NULL if no qconds */
+  struct dds_slab instance_slab;     /* Storage for instances */
+  struct dds_slab sample_slab;       /* Storage for samples not embedded in an instance */
 #ifdef DDS_HAS_LIFESPAN
   struct lifespan_adm lifespan;      /* Lifespan administration */
 #endif
@@ -558,16 +559,19 @@ ddsrt_mtime_t dds_rhc_default_deadline_missed_cb(void *hc, ddsrt_mtime_t tnow)
 }
 #endif /* DDS_HAS_DEADLINE_MISSED */
 
-struct dds_rhc *dds_rhc_default_new_xchecks (dds_reader *reader, struct ddsi_domaingv *gv, const struct ddsi_sertype *type, bool xchecks)
+static struct dds_rhc *dds_rhc_default_new_common (dds_reader *reader, struct ddsi_domaingv *gv, const struct ddsi_sertype *type, bool xchecks, struct dds_rhc_default_conds *cs)
 {
   struct dds_rhc_default *rhc = ddsrt_malloc (sizeof (*rhc));
   memset (rhc, 0, sizeof (*rhc));
   rhc->common.common.ops = &dds_rhc_default_ops;
+  rhc->cs = cs ? cs : &rhc->own_conds;
 
   lwregs_init (&rhc->registrations);
   ddsrt_mutex_init (&rhc->lock);
   rhc->instances = ddsrt_hh_new (1, instance_iid_hash, instance_iid_eq);
   ddsrt_circlist_init (&rhc->nonempty_instances);
+  dds_slab_init (&rhc->instance_slab, sizeof (struct rhc_instance), gv->config.rhc_cached_chunks);
+  dds_slab_init (&rhc->sample_slab, sizeof (struct rhc_sample), gv->config.rhc_cached_chunks);
   rhc->type = type;
   rhc->reader = reader;
   rhc->tkmap = gv->m_tkmap;
@@ -586,6 +590,16 @@ struct dds_rhc *dds_rhc_default_new_xchecks (dds_reader *reader, struct ddsi_dom
   return &rhc->common;
 }
 
+struct dds_rhc *dds_rhc_default_new_xchecks (dds_reader *reader, struct ddsi_domaingv *gv, const struct ddsi_sertype *type, bool xchecks)
+{
+  return dds_rhc_default_new_common (reader, gv, type, xchecks, NULL);
+}
+
+struct dds_rhc *dds_rhc_default_new_shard (dds_reader *reader, struct ddsi_domaingv *gv, const struct ddsi_sertype *type, bool xchecks, struct dds_rhc_default_conds *conds)
+{
+  return dds_rhc_default_new_common (reader, gv, type, xchecks, conds);
+}
+
 struct dds_rhc *dds_rhc_default_new (dds_reader *reader, const struct ddsi_sertype *type)
 {
   return dds_rhc_default_new_xchecks (reader, &reader->m_entity.m_domain->gv, type, (reader->m_entity.m_domain->gv.config.enabled_xchecks & DDSI_XCHECK_RHC) != 0);
@@ -629,7 +643,7 @@ static bool eval_predicate_invsample (const struct dds_rhc_default *rhc, const s
   return ret;
 }
 
-static struct rhc_sample *alloc_sample (struct rhc_instance *inst)
+static struct rhc_sample *alloc_sample (struct dds_rhc_default *rhc, struct rhc_instance *inst)
 {
   if (inst->a_sample_free)
   {
@@ -641,18 +655,12 @@ static struct rhc_sample *alloc_sample (struct rhc_instance *inst)
   }
   else
   {
-    /* This instead of sizeof(rhc_sample) gets us type checking */
-    struct rhc_sample *s;
-    s = ddsrt_malloc (sizeof (*s));
-    return s;
+    return dds_slab_alloc (&rhc->sample_slab);
   }
 }
 
 static void free_sample (struct dds_rhc_default *rhc, struct rhc_instance *inst, struct rhc_sample *s)
 {
-#ifndef DDS_HAS_LIFESPAN
-  DDSRT_UNUSED_ARG (rhc);
-#endif
   ddsi_serdata_unref (s->sample);
 #ifdef DDS_HAS_LIFESPAN
   lifespan_unregister_sample_locked (&rhc->lifespan, &s->lifespan);
@@ -667,7 +675,7 @@ static void free_sample (struct dds_rhc_default *rhc, struct rhc_instance *inst,
   }
   else
   {
-    ddsrt_free (s);
+    dds_slab_free (&rhc->sample_slab, s);
   }
 }
 
@@ -719,7 +727,7 @@ static void free_empty_instance (struct rhc_instance *inst, struct dds_rhc_defau
   if (inst->deadline_reg)
     deadline_unregister_instance_locked (&rhc->deadline, &inst->deadline);
 #endif
-  ddsrt_free (inst);
+  dds_slab_free (&rhc->instance_slab, inst);
 }
 
 static void free_instance_rhc_free (struct rhc_instance *inst, struct dds_rhc_default *rhc)
@@ -764,6 +772,36 @@ static uint32_t dds_rhc_default_lock_samples (struct dds_rhc *rhc_common)
   return no;
 }
 
+void dds_rhc_default_lock (struct dds_rhc *rhc_common)
+{
+  struct dds_rhc_default * const rhc = (struct dds_rhc_default *) rhc_common;
+  ddsrt_mutex_lock (&rhc->lock);
+}
+
+void dds_rhc_default_unlock (struct dds_rhc *rhc_common)
+{
+  struct dds_rhc_default * const rhc = (struct dds_rhc_default *) rhc_common;
+  ddsrt_mutex_unlock (&rhc->lock);
+}
+
+uint32_t dds_rhc_default_nsamples_locked (const struct dds_rhc *rhc_common)
+{
+  const struct dds_rhc_default * const rhc = (const struct dds_rhc_default *) rhc_common;
+  return rhc->n_vsamples + rhc->n_invsamples;
+}
+
+bool dds_rhc_default_add_alloc_stats (struct dds_rhc *rhc_common, struct dds_slab_stats *st)
+{
+  struct dds_rhc_default * const rhc = (struct dds_rhc_default *) rhc_common;
+  if (rhc_common->common.ops != &dds_rhc_default_ops)
+    return false;
+  ddsrt_mutex_lock (&rhc->lock);
+  dds_slab_add_stats (&rhc->instance_slab, st);
+  dds_slab_add_stats (&rhc->sample_slab, st);
+  ddsrt_mutex_unlock (&rhc->lock);
+  return true;
+}
+
 static void free_instance_rhc_free_wrap (void *vnode, void *varg)
 {
   free_instance_rhc_free (vnode, varg);
@@ -785,6 +823,8 @@ static void dds_rhc_default_free (struct ddsi_rhc *rhc_common)
   deadline_fini (&rhc->deadline);
 #endif
   ddsrt_hh_free (rhc->instances);
+  dds_slab_fini (&rhc->sample_slab);
+  dds_slab_fini (&rhc->instance_slab);
   lwregs_fini (&rhc->registrations);
   if (rhc->qcond_eval_samplebuf != NULL)
     ddsi_sertype_free_sample (rhc->type, rhc->qcond_eval_samplebuf, DDS_FREE_ALL);
@@ -829,7 +869,7 @@ static bool trigger_info_differs (const struct dds_rhc_default *rhc, const struc
       pre->c.has_read != post->c.has_read ||
       pre->c.has_not_read != post->c.has_not_read)
     return true;
-  else if (rhc->nqconds == 0)
+  else if (rhc->cs->nqconds == 0)
     return false;
   else
     return (trig_qc->dec_conds_invsample != trig_qc->inc_conds_invsample ||
@@ -896,7 +936,7 @@ static bool add_sample (struct dds_rhc_default *rhc, struct rhc_instance *inst,
     }
 
     /* add new latest sample */
-    s = alloc_sample (inst);
+    s = alloc_sample (rhc, inst);
     inst_clear_invsample_if_exists (rhc, inst, trig_qc);
     if (inst->latest == NULL)
     {
@@ -923,9 +963,9 @@ static bool add_sample (struct dds_rhc_default *rhc, struct rhc_instance *inst,
 #endif
 
   s->conds = 0;
-  if (rhc->nqconds != 0)
+  if (rhc->cs->nqconds != 0)
   {
-    for (dds_readcond *rc = rhc->conds; rc != NULL; rc = rc->m_next)
+    for (dds_readcond *rc = rhc->cs->conds; rc != NULL; rc = rc->m_next)
       if (rc->m_query.m_filter != 0 && eval_predicate_sample (rhc, s->sample, rc->m_query.m_filter))
         s->conds |= rc->m_query.m_qcmask;
   }
@@ -1384,7 +1424,7 @@ static struct rhc_instance *alloc_new_instance (struct dds_rhc_default *rhc, con
   struct rhc_instance *inst;
 
   ddsi_tkmap_instance_ref (tk);
-  inst = ddsrt_malloc (sizeof (*inst));
+  inst = dds_slab_alloc (&rhc->instance_slab);
   memset (inst, 0, sizeof (*inst));
   inst->iid = tk->m_iid;
   inst->tk = tk;
@@ -1401,9 +1441,9 @@ static struct rhc_instance *alloc_new_instance (struct dds_rhc_default *rhc, con
   inst->tstamp = serdata->timestamp;
   inst->strength = wrinfo->ownership_strength;
 
-  if (rhc->nqconds != 0)
+  if (rhc->cs->nqconds != 0)
   {
-    for (dds_readcond *c = rhc->conds; c != NULL; c = c->m_next)
+    for (dds_readcond *c = rhc->cs->conds; c != NULL; c = c->m_next)
     {
       assert ((dds_entity_kind (&c->m_entity) == DDS_KIND_COND_READ && c->m_query.m_filter == 0) ||
               (dds_entity_kind (&c->m_entity) == DDS_KIND_COND_QUERY && c->m_query.m_filter != 0));
@@ -1961,11 +2001,11 @@ static void patch_generations (dds_sample_info_t *si, uint32_t last_of_inst)
 static bool read_sample_update_conditions (struct dds_rhc_default *rhc, struct trigger_info_pre *pre, struct trigger_info_post *post, struct trigger_info_qcond *trig_qc, struct rhc_instance *inst, dds_querycond_mask_t conds, bool sample_wasread)
 {
   /* No query conditions that are dependent on sample states */
-  if (rhc->qconds_samplest == 0)
+  if (rhc->cs->qconds_samplest == 0)
     return false;
 
   /* Some, but perhaps none that matches this sample */
-  if ((conds & rhc->qconds_samplest) == 0)
+  if ((conds & rhc->cs->qconds_samplest) == 0)
     return false;
 
   TRACE("read_sample_update_conditions\n");
@@ -1982,7 +2022,7 @@ static bool read_sample_update_conditions (struct dds_rhc_default *rhc, struct t
 static bool take_sample_update_conditions (struct dds_rhc_default *rhc, struct trigger_info_pre *pre, struct trigger_info_post *post, struct trigger_info_qcond *trig_qc, struct rhc_instance *inst, dds_querycond_mask_t conds, bool sample_wasread)
 {
   /* Mostly the same as read_...: but we are deleting samples (so no "inc sample") and need to process all query conditions that match this sample. */
-  if (rhc->nqconds == 0 || conds == 0)
+  if (rhc->cs->nqconds == 0 || conds == 0)
     return false;
 
   TRACE("take_sample_update_conditions\n");
@@ -2353,15 +2393,8 @@ static bool cond_is_sample_state_dependent (const struct dds_readcond *cond)
   }
 }
 
-static bool dds_rhc_default_add_readcondition (struct dds_rhc *rhc_common, dds_readcond *cond)
+bool dds_rhc_default_conds_add (struct dds_rhc_default_conds *cs, dds_readcond *cond)
 {
-  /* On the assumption that a readcondition will be attached to a
-     waitset for nearly all of its life, we keep track of all
-     readconditions on a reader in one set, without distinguishing
-     between those attached to a waitset or not. */
-  struct dds_rhc_default * const rhc = (struct dds_rhc_default *) rhc_common;
-  struct ddsrt_hh_iter it;
-
   assert ((dds_entity_kind (&cond->m_entity) == DDS_KIND_COND_READ && cond->m_query.m_filter == 0) ||
           (dds_entity_kind (&cond->m_entity) == DDS_KIND_COND_QUERY && cond->m_query.m_filter != 0));
   assert (ddsrt_atomic_ld32 (&cond->m_entity.m_status.m_trigger) == 0);
@@ -2369,13 +2402,11 @@ static bool dds_rhc_default_add_readcondition (struct dds_rhc *rhc_common, dds_r
 
   cond->m_qminv = qmask_from_dcpsquery (cond->m_sample_states, cond->m_view_states, cond->m_instance_states);
 
-  ddsrt_mutex_lock (&rhc->lock);
-
   /* Allocate a slot in the condition bitmasks; return an error no more slots are available */
   if (cond->m_query.m_filter != 0)
   {
     dds_querycond_mask_t avail_qcmask = ~(dds_querycond_mask_t)0;
-    for (dds_readcond *rc = rhc->conds; rc != NULL; rc = rc->m_next)
+    for (dds_readcond *rc = cs->conds; rc != NULL; rc = rc->m_next)
     {
       assert ((rc->m_query.m_filter == 0 && rc->m_query.m_qcmask == 0) || (rc->m_query.m_filter != 0 && rc->m_query.m_qcmask != 0));
       avail_qcmask &= ~rc->m_query.m_qcmask;
@@ -2383,18 +2414,43 @@ static bool dds_rhc_default_add_readcondition (struct dds_rhc *rhc_common, dds_r
     if (avail_qcmask == 0)
     {
       /* no available indices */
-      ddsrt_mutex_unlock (&rhc->lock);
       return false;
     }
 
     /* use the least significant bit set */
     cond->m_query.m_qcmask = avail_qcmask & (~avail_qcmask + 1);
+    if (cond_is_sample_state_dependent (cond))
+      cs->qconds_samplest |= cond->m_query.m_qcmask;
+    cs->nqconds++;
   }
 
-  rhc->nconds++;
-  cond->m_next = rhc->conds;
-  rhc->conds = cond;
+  cs->nconds++;
+  cond->m_next = cs->conds;
+  cs->conds = cond;
+  return true;
+}
 
+void dds_rhc_default_conds_remove (struct dds_rhc_default_conds *cs, dds_readcond *cond)
+{
+  dds_readcond **ptr;
+  ptr = &cs->conds;
+  while (*ptr != cond)
+    ptr = &(*ptr)->m_next;
+  *ptr = (*ptr)->m_next;
+  cs->nconds--;
+  if (cond->m_query.m_filter)
+  {
+    cs->nqconds--;
+    cs->qconds_samplest &= ~cond->m_query.m_qcmask;
+    cond->m_query.m_qcmask = 0;
+  }
+}
+
+void dds_rhc_default_add_readcondition_locked (struct dds_rhc *rhc_common, dds_readcond *cond)
+{
+  /* Pre: rhc->lock held, cond already in rhc->cs */
+  struct dds_rhc_default * const rhc = (struct dds_rhc_default *) rhc_common;
+  struct ddsrt_hh_iter it;
   uint32_t trigger = 0;
   if (cond->m_query.m_filter == 0)
   {
@@ -2412,13 +2468,8 @@ static bool dds_rhc_default_add_readcondition (struct dds_rhc *rhc_common, dds_r
   }
   else
   {
-    if (cond_is_sample_state_dependent (cond))
-      rhc->qconds_samplest |= cond->m_query.m_qcmask;
-    if (rhc->nqconds++ == 0)
-    {
-      assert (rhc->qcond_eval_samplebuf == NULL);
+    if (rhc->qcond_eval_samplebuf == NULL)
       rhc->qcond_eval_samplebuf = ddsi_sertype_alloc_sample (rhc->type);
-    }
 
     /* Attaching a query condition means clearing the allocated bit in all instances and
        samples, except for those that match the predicate. */
@@ -2445,16 +2496,44 @@ static bool dds_rhc_default_add_readcondition (struct dds_rhc *rhc_common, dds_r
     }
   }
 
+  /* The shards of a sharded RHC all contribute to the trigger value */
   if (trigger)
   {
-    ddsrt_atomic_st32 (&cond->m_entity.m_status.m_trigger, trigger);
+    ddsrt_atomic_add32 (&cond->m_entity.m_status.m_trigger, trigger);
     dds_entity_status_signal (&cond->m_entity, DDS_DATA_AVAILABLE_STATUS);
   }
 
   TRACE ("add_readcondition(%p, %"PRIx32", %"PRIx32", %"PRIx32") => %p qminv %"PRIx32" ; rhc %"PRIu32" conds\n",
     (void *) rhc, cond->m_sample_states, cond->m_view_states,
-    cond->m_instance_states, (void *) cond, cond->m_qminv, rhc->nconds);
+    cond->m_instance_states, (void *) cond, cond->m_qminv, rhc->cs->nconds);
+}
+
+void dds_rhc_default_remove_readcondition_locked (struct dds_rhc *rhc_common, dds_readcond *cond)
+{
+  /* Pre: rhc->lock held, cond already removed from rhc->cs */
+  struct dds_rhc_default * const rhc = (struct dds_rhc_default *) rhc_common;
+  (void) cond;
+  if (rhc->cs->nqconds == 0 && rhc->qcond_eval_samplebuf != NULL)
+  {
+    ddsi_sertype_free_sample (rhc->type, rhc->qcond_eval_samplebuf, DDS_FREE_ALL);
+    rhc->qcond_eval_samplebuf = NULL;
+  }
+}
 
+static bool dds_rhc_default_add_readcondition (struct dds_rhc *rhc_common, dds_readcond *cond)
+{
+  /* On the assumption that a readcondition will be attached to a
+     waitset for nearly all of its life, we keep track of all
+     readconditions on a reader in one set, without distinguishing
+     between those attached to a waitset or not. */
+  struct dds_rhc_default * const rhc = (struct dds_rhc_default *) rhc_common;
+  ddsrt_mutex_lock (&rhc->lock);
+  if (!dds_rhc_default_conds_add (rhc->cs, cond))
+  {
+    ddsrt_mutex_unlock (&rhc->lock);
+    return false;
+  }
+  dds_rhc_default_add_readcondition_locked (rhc_common, cond);
   ddsrt_mutex_unlock (&rhc->lock);
   return true;
 }
@@ -2462,25 +2541,9 @@ static bool dds_rhc_default_add_readcondition (struct dds_rhc *rhc_common, dds_r
 static void dds_rhc_default_remove_readcondition (struct dds_rhc *rhc_common, dds_readcond *cond)
 {
   struct dds_rhc_default * const rhc = (struct dds_rhc_default *) rhc_common;
-  dds_readcond **ptr;
   ddsrt_mutex_lock (&rhc->lock);
-  ptr = &rhc->conds;
-  while (*ptr != cond)
-    ptr = &(*ptr)->m_next;
-  *ptr = (*ptr)->m_next;
-  rhc->nconds--;
-  if (cond->m_query.m_filter)
-  {
-    rhc->nqconds--;
-    rhc->qconds_samplest &= ~cond->m_query.m_qcmask;
-    cond->m_query.m_qcmask = 0;
-    if (rhc->nqconds == 0)
-    {
-      assert (rhc->qcond_eval_samplebuf != NULL);
-      ddsi_sertype_free_sample (rhc->type, rhc->qcond_eval_samplebuf, DDS_FREE_ALL);
-      rhc->qcond_eval_samplebuf = NULL;
-    }
-  }
+  dds_rhc_default_conds_remove (rhc->cs, cond);
+  dds_rhc_default_remove_readcondition_locked (rhc_common, cond);
   ddsrt_mutex_unlock (&rhc->lock);
 }
 
@@ -2508,7 +2571,7 @@ static bool update_conditions_locked (struct dds_rhc_default *rhc, bool called_f
 #endif
   assert (rhc->n_vsamples >= rhc->n_vread);
 
-  iter = rhc->conds;
+  iter = rhc->cs->conds;
   while (iter)
   {
     m_pre = ((pre->c.qminst & iter->m_qminv) == 0);
@@ -2730,7 +2793,7 @@ static int rhc_check_counts_locked (struct dds_rhc_default *rhc, bool check_cond
   if (!rhc->xchecks)
     return 1;
 
-  const uint32_t ncheck = rhc->nconds < CHECK_MAX_CONDS ? rhc->nconds : CHECK_MAX_CONDS;
+  const uint32_t ncheck = rhc->cs->nconds < CHECK_MAX_CONDS ? rhc->cs->nconds : CHECK_MAX_CONDS;
   uint32_t n_instances = 0, n_nonempty_instances = 0;
   uint32_t n_not_alive_disposed = 0, n_not_alive_no_writers = 0, n_new = 0;
   uint32_t n_vsamples = 0, n_vread = 0;
@@ -2745,7 +2808,7 @@ static int rhc_check_counts_locked (struct dds_rhc_default *rhc, bool check_cond
   for (i = 0; i < CHECK_MAX_CONDS; i++)
     cond_match_count[i] = 0;
 
-  for (rciter = rhc->conds; rciter; rciter = rciter->m_next)
+  for (rciter = rhc->cs->conds; rciter; rciter = rciter->m_next)
   {
     assert ((dds_entity_kind (&rciter->m_entity) == DDS_KIND_COND_READ && rciter->m_query.m_filter == 0) ||
             (dds_entity_kind (&rciter->m_entity) == DDS_KIND_COND_QUERY && rciter->m_query.m_filter != 0));
@@ -2803,12 +2866,12 @@ static int rhc_check_counts_locked (struct dds_rhc_default *rhc, bool check_cond
 
     if (check_conds)
     {
-      if (check_qcmask && rhc->nqconds > 0)
+      if (check_qcmask && rhc->cs->nqconds > 0)
       {
         dds_querycond_mask_t qcmask;
         untyped_to_clean_invsample (rhc->type, inst->tk->m_sample, rhc->qcond_eval_samplebuf, 0, 0);
         qcmask = 0;
-        for (rciter = rhc->conds; rciter; rciter = rciter->m_next)
+        for (rciter = rhc->cs->conds; rciter; rciter = rciter->m_next)
           if (rciter->m_query.m_filter != 0 && rciter->m_query.m_filter (rhc->qcond_eval_samplebuf))
             qcmask |= rciter->m_query.m_qcmask;
         assert ((inst->conds & enabled_qcmask) == qcmask);
@@ -2818,7 +2881,7 @@ static int rhc_check_counts_locked (struct dds_rhc_default *rhc, bool check_cond
           do {
             ddsi_serdata_to_sample (sample->sample, rhc->qcond_eval_samplebuf, NULL, NULL);
             qcmask = 0;
-            for (rciter = rhc->conds; rciter; rciter = rciter->m_next)
+            for (rciter = rhc->cs->conds; rciter; rciter = rciter->m_next)
               if (rciter->m_query.m_filter != 0 && rciter->m_query.m_filter (rhc->qcond_eval_samplebuf))
                 qcmask |= rciter->m_query.m_qcmask;
             assert ((sample->conds & enabled_qcmask) == qcmask);
@@ -2827,7 +2890,7 @@ static int rhc_check_counts_locked (struct dds_rhc_default *rhc, bool check_cond
         }
       }
 
-      for (i = 0, rciter = rhc->conds; rciter && i < ncheck; i++, rciter = rciter->m_next)
+      for (i = 0, rciter = rhc->cs->conds; rciter && i < ncheck; i++, rciter = rciter->m_next)
       {
         if (!rhc_get_cond_trigger (inst, rciter))
           ;
@@ -2860,9 +2923,10 @@ static int rhc_check_counts_locked (struct dds_rhc_default *rhc, bool check_cond
   assert (rhc->n_invsamples == n_invsamples);
   assert (rhc->n_invread == n_invread);
 
-  if (check_conds)
+  /* Triggers are the sum over all shards, so they can only be checked for a stand-alone RHC */
+  if (check_conds && rhc->cs == &rhc->own_conds)
   {
-    for (i = 0, rciter = rhc->conds; rciter && i < ncheck; i++, rciter = rciter->m_next)
+    for (i = 0, rciter = rhc->cs->conds; rciter && i < ncheck; i++, rciter = rciter->m_next)
       assert (cond_match_count[i] == ddsrt_atomic_ld32 (&rciter->m_entity.m_status.m_trigger));
   }
 
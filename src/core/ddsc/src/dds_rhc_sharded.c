@@ -0,0 +1,295 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <assert.h>
+#include <string.h>
+
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/atomics.h"
+#include "dds__entity.h"
+#include "dds__reader.h"
+#include "dds/ddsc/dds_rhc.h"
+#include "dds__rhc_default.h"
+#include "dds__rhc_sharded.h"
+#include "dds/ddsi/ddsi_tkmap.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+
+/* SHARDED RHC
+   ===========
+
+   The sharded RHC is a thin layer over a number of default RHCs, one per
+   shard, that each manage a subset of the instances and have their own lock.
+   Operations on a single instance (store, read/take by instance handle) go to
+   the shard owning the instance; operations on all instances visit all shards.
+
+   Read conditions are shared: the list of conditions lives here and all shards
+   refer to it, each shard maintaining its own contribution to the trigger
+   values.  Changing the set of conditions requires all shard locks, taken in
+   index order, as does "lock_samples".  Everything else holds at most one
+   shard lock at any one time.
+
+   Instance handles are drawn approximately uniformly from the 64-bit integers,
+   so the shard is simply the handle modulo the number of shards. */
+
+struct dds_rhc_sharded {
+  struct dds_rhc common;
+  struct dds_rhc_default_conds conds;
+  ddsrt_atomic_uint32_t next_shard; /* shard at which to start next read/take, for fairness */
+  uint32_t nshards;
+  struct dds_rhc *shards[];
+};
+
+enum rhc_sharded_op {
+  RSOP_READ,
+  RSOP_TAKE,
+  RSOP_READCDR,
+  RSOP_TAKECDR
+};
+
+struct rhc_sharded_args {
+  enum rhc_sharded_op op;
+  uint32_t mask;
+  dds_readcond *cond;
+  uint32_t sample_states, view_states, instance_states;
+};
+
+static const struct dds_rhc_ops dds_rhc_sharded_ops;
+
+static struct dds_rhc *shard_of (const struct dds_rhc_sharded *rhc, uint64_t iid)
+{
+  return rhc->shards[(uint32_t) ((iid ^ (iid >> 32)) % rhc->nshards)];
+}
+
+static void lock_all_shards (struct dds_rhc_sharded *rhc)
+{
+  for (uint32_t i = 0; i < rhc->nshards; i++)
+    dds_rhc_default_lock (rhc->shards[i]);
+}
+
+static void unlock_all_shards (struct dds_rhc_sharded *rhc)
+{
+  for (uint32_t i = 0; i < rhc->nshards; i++)
+    dds_rhc_default_unlock (rhc->shards[i]);
+}
+
+struct dds_rhc *dds_rhc_sharded_new_xchecks (dds_reader *reader, struct ddsi_domaingv *gv, const struct ddsi_sertype *type, bool xchecks, uint32_t nshards)
+{
+  assert (nshards > 1 && nshards <= DDS_RHC_SHARDED_MAX_SHARDS);
+  struct dds_rhc_sharded *rhc = ddsrt_malloc (sizeof (*rhc) + nshards * sizeof (rhc->shards[0]));
+  memset (&rhc->conds, 0, sizeof (rhc->conds));
+  rhc->common.common.ops = &dds_rhc_sharded_ops;
+  ddsrt_atomic_st32 (&rhc->next_shard, 0);
+  rhc->nshards = nshards;
+  for (uint32_t i = 0; i < nshards; i++)
+    rhc->shards[i] = dds_rhc_default_new_shard (reader, gv, type, xchecks, &rhc->conds);
+  return &rhc->common;
+}
+
+struct dds_rhc *dds_rhc_sharded_new (dds_reader *reader, const struct ddsi_sertype *type, uint32_t nshards)
+{
+  struct ddsi_domaingv * const gv = &reader->m_entity.m_domain->gv;
+  return dds_rhc_sharded_new_xchecks (reader, gv, type, (gv->config.enabled_xchecks & DDSI_XCHECK_RHC) != 0, nshards);
+}
+
+static dds_return_t dds_rhc_sharded_associate (struct dds_rhc *rhc_common, dds_reader *reader, const struct ddsi_sertype *type, struct ddsi_tkmap *tkmap)
+{
+  struct dds_rhc_sharded * const rhc = (struct dds_rhc_sharded *) rhc_common;
+  dds_return_t ret = DDS_RETCODE_OK;
+  for (uint32_t i = 0; i < rhc->nshards && ret == DDS_RETCODE_OK; i++)
+    ret = dds_rhc_associate (rhc->shards[i], reader, type, tkmap);
+  return ret;
+}
+
+static bool dds_rhc_sharded_store (struct ddsi_rhc * __restrict rhc_common, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * __restrict sample, struct ddsi_tkmap_instance * __restrict tk)
+{
+  struct dds_rhc_sharded * const rhc = (struct dds_rhc_sharded *) rhc_common;
+  return dds_rhc_store (shard_of (rhc, tk->m_iid), wrinfo, sample, tk);
+}
+
+static void dds_rhc_sharded_unregister_wr (struct ddsi_rhc * __restrict rhc_common, const struct ddsi_writer_info * __restrict wrinfo)
+{
+  struct dds_rhc_sharded * const rhc = (struct dds_rhc_sharded *) rhc_common;
+  for (uint32_t i = 0; i < rhc->nshards; i++)
+    dds_rhc_unregister_wr (rhc->shards[i], wrinfo);
+}
+
+static void dds_rhc_sharded_relinquish_ownership (struct ddsi_rhc * __restrict rhc_common, const uint64_t wr_iid)
+{
+  struct dds_rhc_sharded * const rhc = (struct dds_rhc_sharded *) rhc_common;
+  for (uint32_t i = 0; i < rhc->nshards; i++)
+    dds_rhc_relinquish_ownership (rhc->shards[i], wr_iid);
+}
+
+static void dds_rhc_sharded_set_qos (struct ddsi_rhc *rhc_common, const dds_qos_t *qos)
+{
+  struct dds_rhc_sharded * const rhc = (struct dds_rhc_sharded *) rhc_common;
+  for (uint32_t i = 0; i < rhc->nshards; i++)
+    dds_rhc_set_qos (rhc->shards[i], qos);
+}
+
+static void dds_rhc_sharded_free (struct ddsi_rhc *rhc_common)
+{
+  struct dds_rhc_sharded * const rhc = (struct dds_rhc_sharded *) rhc_common;
+  for (uint32_t i = 0; i < rhc->nshards; i++)
+    dds_rhc_free (rhc->shards[i]);
+  assert (rhc->conds.conds == NULL);
+  ddsrt_free (rhc);
+}
+
+static int32_t shard_read_take (struct dds_rhc *shard, bool lock, void **values, dds_sample_info_t *info_seq, uint32_t max_samples, dds_instance_handle_t handle, const struct rhc_sharded_args *args)
+{
+  switch (args->op)
+  {
+    case RSOP_READ:
+      return dds_rhc_read (shard, lock, values, info_seq, max_samples, args->mask, handle, args->cond);
+    case RSOP_TAKE:
+      return dds_rhc_take (shard, lock, values, info_seq, max_samples, args->mask, handle, args->cond);
+    case RSOP_READCDR:
+      return dds_rhc_readcdr (shard, lock, (struct ddsi_serdata **) values, info_seq, max_samples, args->sample_states, args->view_states, args->instance_states, handle);
+    case RSOP_TAKECDR:
+      return dds_rhc_takecdr (shard, lock, (struct ddsi_serdata **) values, info_seq, max_samples, args->sample_states, args->view_states, args->instance_states, handle);
+  }
+  assert (0);
+  return DDS_RETCODE_ERROR;
+}
+
+static int32_t read_take (struct dds_rhc_sharded *rhc, bool lock, void **values, dds_sample_info_t *info_seq, uint32_t max_samples, dds_instance_handle_t handle, const struct rhc_sharded_args *args)
+{
+  /* lock = false means all shards have been locked by lock_samples, and that read/take must
+     unlock them, just like it is for the default RHC */
+  if (handle)
+  {
+    struct dds_rhc * const shard = shard_of (rhc, handle);
+    if (!lock)
+    {
+      for (uint32_t i = 0; i < rhc->nshards; i++)
+        if (rhc->shards[i] != shard)
+          dds_rhc_default_unlock (rhc->shards[i]);
+    }
+    return shard_read_take (shard, lock, values, info_seq, max_samples, handle, args);
+  }
+
+  /* Starting at a different shard every time ensures that a sequence of calls with a small
+     max_samples doesn't favour the instances in the first shards */
+  const uint32_t first = ddsrt_atomic_inc32_ov (&rhc->next_shard) % rhc->nshards;
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < rhc->nshards; i++)
+  {
+    struct dds_rhc * const shard = rhc->shards[(first + i) % rhc->nshards];
+    if (n < max_samples)
+    {
+      const int32_t m = shard_read_take (shard, lock, values + n, info_seq + n, max_samples - n, 0, args);
+      assert (m >= 0);
+      n += (uint32_t) m;
+    }
+    else if (!lock)
+    {
+      dds_rhc_default_unlock (shard);
+    }
+    else
+    {
+      break;
+    }
+  }
+  return (int32_t) n;
+}
+
+static int32_t dds_rhc_sharded_read (struct dds_rhc *rhc_common, bool lock, void **values, dds_sample_info_t *info_seq, uint32_t max_samples, uint32_t mask, dds_instance_handle_t handle, dds_readcond *cond)
+{
+  const struct rhc_sharded_args args = { .op = RSOP_READ, .mask = mask, .cond = cond };
+  return read_take ((struct dds_rhc_sharded *) rhc_common, lock, values, info_seq, max_samples, handle, &args);
+}
+
+static int32_t dds_rhc_sharded_take (struct dds_rhc *rhc_common, bool lock, void **values, dds_sample_info_t *info_seq, uint32_t max_samples, uint32_t mask, dds_instance_handle_t handle, dds_readcond *cond)
+{
+  const struct rhc_sharded_args args = { .op = RSOP_TAKE, .mask = mask, .cond = cond };
+  return read_take ((struct dds_rhc_sharded *) rhc_common, lock, values, info_seq, max_samples, handle, &args);
+}
+
+static int32_t dds_rhc_sharded_readcdr (struct dds_rhc *rhc_common, bool lock, struct ddsi_serdata **values, dds_sample_info_t *info_seq, uint32_t max_samples, uint32_t sample_states, uint32_t view_states, uint32_t instance_states, dds_instance_handle_t handle)
+{
+  const struct rhc_sharded_args args = { .op = RSOP_READCDR, .sample_states = sample_states, .view_states = view_states, .instance_states = instance_states };
+  DDSRT_STATIC_ASSERT (sizeof (void *) == sizeof (struct ddsi_serdata *));
+  return read_take ((struct dds_rhc_sharded *) rhc_common, lock, (void **) values, info_seq, max_samples, handle, &args);
+}
+
+static int32_t dds_rhc_sharded_takecdr (struct dds_rhc *rhc_common, bool lock, struct ddsi_serdata **values, dds_sample_info_t *info_seq, uint32_t max_samples, uint32_t sample_states, uint32_t view_states, uint32_t instance_states, dds_instance_handle_t handle)
+{
+  const struct rhc_sharded_args args = { .op = RSOP_TAKECDR, .sample_states = sample_states, .view_states = view_states, .instance_states = instance_states };
+  DDSRT_STATIC_ASSERT (sizeof (void *) == sizeof (struct ddsi_serdata *));
+  return read_take ((struct dds_rhc_sharded *) rhc_common, lock, (void **) values, info_seq, max_samples, handle, &args);
+}
+
+static bool dds_rhc_sharded_add_readcondition (struct dds_rhc *rhc_common, dds_readcond *cond)
+{
+  struct dds_rhc_sharded * const rhc = (struct dds_rhc_sharded *) rhc_common;
+  bool ret;
+  lock_all_shards (rhc);
+  if ((ret = dds_rhc_default_conds_add (&rhc->conds, cond)))
+  {
+    for (uint32_t i = 0; i < rhc->nshards; i++)
+      dds_rhc_default_add_readcondition_locked (rhc->shards[i], cond);
+  }
+  unlock_all_shards (rhc);
+  return ret;
+}
+
+static void dds_rhc_sharded_remove_readcondition (struct dds_rhc *rhc_common, dds_readcond *cond)
+{
+  struct dds_rhc_sharded * const rhc = (struct dds_rhc_sharded *) rhc_common;
+  lock_all_shards (rhc);
+  dds_rhc_default_conds_remove (&rhc->conds, cond);
+  for (uint32_t i = 0; i < rhc->nshards; i++)
+    dds_rhc_default_remove_readcondition_locked (rhc->shards[i], cond);
+  unlock_all_shards (rhc);
+}
+
+static uint32_t dds_rhc_sharded_lock_samples (struct dds_rhc *rhc_common)
+{
+  struct dds_rhc_sharded * const rhc = (struct dds_rhc_sharded *) rhc_common;
+  uint32_t no = 0;
+  lock_all_shards (rhc);
+  for (uint32_t i = 0; i < rhc->nshards; i++)
+    no += dds_rhc_default_nsamples_locked (rhc->shards[i]);
+  if (no == 0)
+  {
+    unlock_all_shards (rhc);
+  }
+  return no;
+}
+
+bool dds_rhc_sharded_add_alloc_stats (struct dds_rhc *rhc_common, struct dds_slab_stats *st)
+{
+  struct dds_rhc_sharded * const rhc = (struct dds_rhc_sharded *) rhc_common;
+  if (rhc_common->common.ops != &dds_rhc_sharded_ops)
+    return false;
+  for (uint32_t i = 0; i < rhc->nshards; i++)
+    (void) dds_rhc_default_add_alloc_stats (rhc->shards[i], st);
+  return true;
+}
+
+static const struct dds_rhc_ops dds_rhc_sharded_ops = {
+  .rhc_ops = {
+    .store = dds_rhc_sharded_store,
+    .unregister_wr = dds_rhc_sharded_unregister_wr,
+    .relinquish_ownership = dds_rhc_sharded_relinquish_ownership,
+    .set_qos = dds_rhc_sharded_set_qos,
+    .free = dds_rhc_sharded_free
+  },
+  .read = dds_rhc_sharded_read,
+  .take = dds_rhc_sharded_take,
+  .readcdr = dds_rhc_sharded_readcdr,
+  .takecdr = dds_rhc_sharded_takecdr,
+  .add_readcondition = dds_rhc_sharded_add_readcondition,
+  .remove_readcondition = dds_rhc_sharded_remove_readcondition,
+  .lock_samples = dds_rhc_sharded_lock_samples,
+  .associate = dds_rhc_sharded_associate
+};
@@ -0,0 +1,199 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <assert.h>
+#include <string.h>
+
+#include "dds/ddsrt/heap.h"
+#include "dds__slab.h"
+
+#define SLAB_ALIGN 16u
+
+struct dds_slab_freeobj {
+  struct dds_slab_freeobj *next;
+};
+
+struct dds_slab_chunk {
+  ddsrt_avl_node_t avlnode;          /* in slab->chunks while objects are in use */
+  struct dds_slab_chunk *next;       /* in slab->avail or slab->cached */
+  struct dds_slab_chunk *prev;       /* in slab->avail */
+  struct dds_slab_freeobj *freelist; /* freed objects in this chunk */
+  size_t size;                       /* size of chunk, including header */
+  uint32_t nobjs;                    /* capacity */
+  uint32_t nbumped;                  /* number of objects ever handed out */
+  uint32_t ninuse;                   /* number of objects in use */
+};
+
+#define SLAB_CHUNK_HDRSIZE ((sizeof (struct dds_slab_chunk) + SLAB_ALIGN - 1) & ~(size_t) (SLAB_ALIGN - 1))
+
+static int compare_chunk_addr (const void *va, const void *vb)
+{
+  const uintptr_t a = (uintptr_t) va, b = (uintptr_t) vb;
+  return (a == b) ? 0 : (a < b) ? -1 : 1;
+}
+
+/* the key is the chunk itself, objects are mapped to their chunk by looking
+   for the chunk with the highest address not above that of the object */
+static const ddsrt_avl_treedef_t slab_chunks_td = DDSRT_AVL_TREEDEF_INITIALIZER (offsetof (struct dds_slab_chunk, avlnode), 0, compare_chunk_addr, 0);
+
+static char *chunk_objs (struct dds_slab_chunk *c)
+{
+  return (char *) c + SLAB_CHUNK_HDRSIZE;
+}
+
+void dds_slab_init (struct dds_slab *slab, size_t objsize, uint32_t max_cached_chunks)
+{
+  if (objsize < sizeof (struct dds_slab_freeobj))
+    objsize = sizeof (struct dds_slab_freeobj);
+  slab->objsize = (objsize + SLAB_ALIGN - 1) & ~(size_t) (SLAB_ALIGN - 1);
+  slab->next_chunk_nobjs = DDS_SLAB_MIN_CHUNK_OBJS;
+  slab->max_chunk_nobjs = (uint32_t) ((DDS_SLAB_MAX_CHUNK_BYTES - SLAB_CHUNK_HDRSIZE) / slab->objsize);
+  if (slab->max_chunk_nobjs < DDS_SLAB_MIN_CHUNK_OBJS)
+    slab->max_chunk_nobjs = DDS_SLAB_MIN_CHUNK_OBJS;
+  slab->max_cached_chunks = max_cached_chunks;
+  ddsrt_avl_init (&slab_chunks_td, &slab->chunks);
+  slab->avail = NULL;
+  slab->cached = NULL;
+  slab->nchunks = 0;
+  slab->ncached = 0;
+  slab->ninuse = 0;
+  slab->bytes = 0;
+}
+
+void dds_slab_fini (struct dds_slab *slab)
+{
+  assert (slab->ninuse == 0);
+  assert (ddsrt_avl_is_empty (&slab->chunks));
+  while (slab->cached)
+  {
+    struct dds_slab_chunk * const c = slab->cached;
+    slab->cached = c->next;
+    ddsrt_free (c);
+  }
+  slab->ncached = 0;
+  slab->bytes = 0;
+}
+
+static void avail_insert (struct dds_slab *slab, struct dds_slab_chunk *c)
+{
+  c->prev = NULL;
+  c->next = slab->avail;
+  if (c->next)
+    c->next->prev = c;
+  slab->avail = c;
+}
+
+static void avail_remove (struct dds_slab *slab, struct dds_slab_chunk *c)
+{
+  if (c->prev)
+    c->prev->next = c->next;
+  else
+    slab->avail = c->next;
+  if (c->next)
+    c->next->prev = c->prev;
+}
+
+static struct dds_slab_chunk *new_chunk (struct dds_slab *slab)
+{
+  struct dds_slab_chunk *c;
+  if ((c = slab->cached) != NULL)
+  {
+    slab->cached = c->next;
+    slab->ncached--;
+  }
+  else
+  {
+    /* Chunks grow geometrically so that readers with only a few instances don't waste
+       much memory, while readers with many instances get large contiguous blocks */
+    const size_t sz = SLAB_CHUNK_HDRSIZE + slab->next_chunk_nobjs * slab->objsize;
+    c = ddsrt_malloc (sz);
+    c->size = sz;
+    c->nobjs = slab->next_chunk_nobjs;
+    slab->bytes += sz;
+    if (slab->next_chunk_nobjs < slab->max_chunk_nobjs)
+    {
+      slab->next_chunk_nobjs *= 2;
+      if (slab->next_chunk_nobjs > slab->max_chunk_nobjs)
+        slab->next_chunk_nobjs = slab->max_chunk_nobjs;
+    }
+  }
+  c->freelist = NULL;
+  c->nbumped = 0;
+  c->ninuse = 0;
+  ddsrt_avl_insert (&slab_chunks_td, &slab->chunks, c);
+  slab->nchunks++;
+  avail_insert (slab, c);
+  return c;
+}
+
+void *dds_slab_alloc (struct dds_slab *slab)
+{
+  struct dds_slab_chunk * const c = slab->avail ? slab->avail : new_chunk (slab);
+  void *obj;
+  if (c->freelist)
+  {
+    struct dds_slab_freeobj * const f = c->freelist;
+    c->freelist = f->next;
+    obj = f;
+  }
+  else
+  {
+    assert (c->nbumped < c->nobjs);
+    obj = chunk_objs (c) + c->nbumped++ * slab->objsize;
+  }
+  if (++c->ninuse == c->nobjs)
+    avail_remove (slab, c);
+  slab->ninuse++;
+  return obj;
+}
+
+void dds_slab_free (struct dds_slab *slab, void *obj)
+{
+  struct dds_slab_chunk * const c = ddsrt_avl_lookup_pred_eq (&slab_chunks_td, &slab->chunks, obj);
+  assert (c != NULL && (char *) obj >= chunk_objs (c) && (char *) obj < chunk_objs (c) + c->nbumped * slab->objsize);
+  assert (slab->ninuse > 0 && c->ninuse > 0);
+  slab->ninuse--;
+  if (c->ninuse-- == c->nobjs)
+    avail_insert (slab, c);
+  if (c->ninuse > 0)
+  {
+    struct dds_slab_freeobj * const f = obj;
+    f->next = c->freelist;
+    c->freelist = f;
+  }
+  else
+  {
+    /* Empty chunks are either cached or returned to the heap, so that memory is
+       released when the number of objects in use shrinks */
+    avail_remove (slab, c);
+    ddsrt_avl_delete (&slab_chunks_td, &slab->chunks, c);
+    slab->nchunks--;
+    if (slab->ncached < slab->max_cached_chunks)
+    {
+      c->next = slab->cached;
+      slab->cached = c;
+      slab->ncached++;
+    }
+    else
+    {
+      slab->bytes -= c->size;
+      ddsrt_free (c);
+    }
+  }
+}
+
+void dds_slab_add_stats (const struct dds_slab *slab, struct dds_slab_stats *st)
+{
+  st->bytes += slab->bytes;
+  st->bytes_in_use += (uint64_t) slab->ninuse * slab->objsize;
+  st->chunks += slab->nchunks;
+  st->cached_chunks += slab->ncached;
+}
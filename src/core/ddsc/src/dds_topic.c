@@ -626,7 +626,9 @@ dds_entity_t dds_create_topic (dds_entity_t participant, const dds_topic_descrip
   st->serpool = ppent->m_domain->gv.serpool;
   st->type.size = desc->m_size;
   st->type.align = desc->m_align;
-  st->type.flagset = desc->m_flagset;
+  /* the native (de)serializers don't change the type, so the flag indicating their
+     presence must not affect type equality and hashing */
+  st->type.flagset = desc->m_flagset & ~(uint32_t) DDS_TOPIC_NATIVE_OPS;
   st->type.keys.nkeys = desc->m_nkeys;
   st->type.keys.keys = ddsrt_malloc (st->type.keys.nkeys  * sizeof (*st->type.keys.keys));
   for (uint32_t i = 0; i < st->type.keys.nkeys; i++)
@@ -637,7 +639,16 @@ dds_entity_t dds_create_topic (dds_entity_t participant, const dds_topic_descrip
   /* Check if topic cannot be optimised (memcpy marshal) */
   if (!(st->type.flagset & DDS_TOPIC_NO_OPTIMIZE)) {
     st->opt_size = dds_stream_check_optimize (&st->type);
-    DDS_CTRACE (&ppent->m_domain->gv.logconfig, "Marshalling for type: %s is %soptimised\n", desc->m_typename, st->opt_size ? "" : "not ");
+    st->copy_plan = dds_stream_make_copy_plan (&st->type);
+    if (st->opt_size == 0 && st->copy_plan)
+      DDS_CTRACE (&ppent->m_domain->gv.logconfig, "Marshalling for type: %s is optimised using %"PRIu32" copy runs\n", desc->m_typename, st->copy_plan->nruns);
+    else
+      DDS_CTRACE (&ppent->m_domain->gv.logconfig, "Marshalling for type: %s is %soptimised\n", desc->m_typename, st->opt_size ? "" : "not ");
+  }
+  if (desc->m_flagset & DDS_TOPIC_NATIVE_OPS)
+  {
+    st->native_ops = desc->m_native_ops;
+    DDS_CTRACE (&ppent->m_domain->gv.logconfig, "Marshalling for type: %s uses native (de)serializers\n", desc->m_typename);
   }
 
   ddsi_plist_init_empty (&plist);
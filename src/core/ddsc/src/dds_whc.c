@@ -85,19 +85,11 @@ struct whc_seq_entry {
 };
 #endif
 
-struct whc_writer_info {
-  dds_writer * writer; /* can be NULL, eg in case of whc for built-in writers */
-  unsigned is_transient_local: 1;
-  unsigned has_deadline: 1;
-  uint32_t hdepth; /* 0 = unlimited */
-  uint32_t tldepth; /* 0 = disabled/unlimited (no need to maintain an index if KEEP_ALL <=> is_transient_local + tldepth=0) */
-  uint32_t idxdepth; /* = max (hdepth, tldepth) */
-};
-
 struct whc_impl {
   struct whc common;
   ddsrt_mutex_t lock;
   uint32_t seq_size;
+  uint32_t n_instances;
   size_t unacked_bytes;
   size_t sample_overhead;
   uint32_t fragment_size;
@@ -164,6 +156,7 @@ static uint32_t whc_default_downgrade_to_volatile (struct whc *whc, struct whc_s
 static void whc_default_sample_iter_init (const struct whc *whc, struct whc_sample_iter *opaque_it);
 static bool whc_default_sample_iter_borrow_next (struct whc_sample_iter *opaque_it, struct whc_borrowed_sample *sample);
 static void whc_default_free (struct whc *whc);
+static void whc_default_get_memory_stats (const struct whc *whc, struct whc_memory_stats *st);
 
 static const ddsrt_avl_treedef_t whc_seq_treedef =
   DDSRT_AVL_TREEDEF_INITIALIZER (offsetof (struct whc_intvnode, avlnode), offsetof (struct whc_intvnode, min), compare_seq, 0);
@@ -180,7 +173,8 @@ static const struct whc_ops whc_ops = {
   .sample_iter_init = whc_default_sample_iter_init,
   .sample_iter_borrow_next = whc_default_sample_iter_borrow_next,
   .downgrade_to_volatile = whc_default_downgrade_to_volatile,
-  .free = whc_default_free
+  .free = whc_default_free,
+  .get_memory_stats = whc_default_get_memory_stats
 };
 
 #define TRACE(...) DDS_CLOG (DDS_LC_WHC, &whc->gv->logconfig, __VA_ARGS__)
@@ -459,6 +453,7 @@ struct whc *whc_new (struct ddsi_domaingv *gv, const struct whc_writer_info *wri
   whc->tkmap = gv->m_tkmap;
   memcpy (&whc->wrinfo, wrinfo, sizeof (*wrinfo));
   whc->seq_size = 0;
+  whc->n_instances = 0;
   whc->max_drop_seq = 0;
   whc->unacked_bytes = 0;
   whc->total_bytes = 0;
@@ -683,6 +678,7 @@ static void delete_one_instance_from_idx (struct whc_impl *whc, seqno_t max_drop
 {
   if (!ddsrt_hh_remove (whc->idx_hash, idxn))
     assert (0);
+  whc->n_instances--;
 #ifdef DDS_HAS_DEADLINE_MISSED
   deadline_unregister_instance_locked (&whc->deadline, &idxn->deadline);
 #endif
@@ -739,6 +735,7 @@ static uint32_t whc_default_downgrade_to_volatile (struct whc *whc_generic, stru
       }
       ddsrt_hh_free (whc->idx_hash);
       whc->wrinfo.idxdepth = 0;
+      whc->n_instances = 0;
       whc->idx_hash = NULL;
     }
   }
@@ -1367,6 +1364,7 @@ static int whc_default_insert (struct whc *whc_generic, seqno_t max_drop_seq, se
       }
       if (!ddsrt_hh_add (whc->idx_hash, idxn))
         assert (0);
+      whc->n_instances++;
 #ifdef DDS_HAS_DEADLINE_MISSED
       deadline_register_instance_locked (&whc->deadline, &idxn->deadline, ddsrt_time_monotonic ());
 #endif
@@ -1504,3 +1502,17 @@ static bool whc_default_sample_iter_borrow_next (struct whc_sample_iter *opaque_
   ddsrt_mutex_unlock (&whc->lock);
   return valid;
 }
+
+static void whc_default_get_memory_stats (const struct whc *whc_generic, struct whc_memory_stats *st)
+{
+  /* Estimate: the hash tables have a load factor of roughly 50% and each bucket holds
+     a pointer and the hopscotch neighbourhood info */
+  const struct whc_impl * const whc = (const struct whc_impl *)whc_generic;
+  const size_t hash_entry_size = 2 * (sizeof (uint32_t) + sizeof (void *));
+  ddsrt_mutex_lock ((ddsrt_mutex_t *)&whc->lock);
+  st->nsamples = whc->seq_size;
+  st->bytes = sizeof (*whc) +
+    whc->seq_size * (sizeof (struct whc_node) + hash_entry_size) +
+    whc->n_instances * (sizeof (struct whc_idxnode) + whc->wrinfo.idxdepth * sizeof (struct whc_node *) + hash_entry_size);
+  ddsrt_mutex_unlock ((ddsrt_mutex_t *)&whc->lock);
+}
@@ -267,6 +267,13 @@ static void bwhc_free_deferred_free_list (struct whc *whc, struct whc_node *defe
   (void)deferred_free_list;
 }
 
+static void bwhc_get_memory_stats (const struct whc *whc, struct whc_memory_stats *st)
+{
+  (void)whc;
+  st->nsamples = 0;
+  st->bytes = 0;
+}
+
 static const struct whc_ops bwhc_ops = {
   .insert = bwhc_insert,
   .remove_acked_messages = bwhc_remove_acked_messages,
@@ -279,7 +286,8 @@ static const struct whc_ops bwhc_ops = {
   .sample_iter_init = bwhc_sample_iter_init,
   .sample_iter_borrow_next = bwhc_sample_iter_borrow_next,
   .downgrade_to_volatile = bwhc_downgrade_to_volatile,
-  .free = bwhc_free
+  .free = bwhc_free,
+  .get_memory_stats = bwhc_get_memory_stats
 };
 
 struct whc *builtintopic_whc_new (enum ddsi_sertype_builtintopic_entity_kind entity_kind, const struct entity_index *entidx)
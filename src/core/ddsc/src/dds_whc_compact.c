@@ -0,0 +1,1147 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/misc.h"
+#include "dds/ddsrt/static_assert.h"
+#include "dds/ddsi/ddsi_serdata.h"
+#include "dds/ddsi/ddsi_plist.h"
+#include "dds/ddsi/q_unused.h"
+#include "dds/ddsi/q_config.h"
+#include "dds/ddsi/ddsi_tkmap.h"
+#include "dds/ddsi/q_rtps.h"
+#include "dds/ddsi/q_protocol.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds__whc.h"
+
+/* Compact WHC: same behaviour as the default WHC (minus deadline and lifespan support),
+ * but with a different representation:
+ *
+ * - Samples are stored by value in a ring buffer in increasing sequence number order.
+ *   Slots are addressed by a "virtual index" that doesn't change when slots get added
+ *   or removed at either end, or when the ring buffer is resized.
+ * - Deleting a sample from the middle leaves a hole that retains the sequence number;
+ *   holes at either end are trimmed at the end of each operation and the ring buffer
+ *   is compacted (changing virtual indices) once there are more holes than samples.
+ * - Looking up a sequence number is a direct index operation if the sequence numbers
+ *   are dense, and a binary search otherwise.  There is no hash table on sequence
+ *   numbers.
+ * - The instance index is an open-addressing hash table with linear probing mapping
+ *   instance ids to slots in an array of instances.  The history of instance i is
+ *   stored as sequence numbers in hist[i * idxdepth ...], 0 marks an empty entry.
+ *   If idxdepth = 0, instances are not tracked at all as the index then has no
+ *   observable effect.
+ *
+ * The deferred free list is an array of serdata/plist pairs disguised as a whc_node.
+ */
+
+#define WHCC_MIN_RING_SIZE 32u
+#define WHCC_MIN_IDX_SIZE 16u
+#define WHCC_NO_INST UINT32_MAX
+
+struct whcc_node {
+  seqno_t seq;
+  struct ddsi_serdata *serdata; /* NULL iff deleted */
+  struct ddsi_plist *plist; /* NULL if nothing special */
+  ddsrt_mtime_t last_rexmit_ts;
+  uint32_t size; /* whcc_size, saturated */
+  uint32_t rexmit_count;
+  uint32_t inst; /* WHCC_NO_INST if not in index */
+  uint32_t idxpos: 30; /* index in instance history */
+  uint32_t unacked: 1; /* counted in whc::unacked_bytes iff 1 */
+  uint32_t borrowed: 1; /* at most one can borrow it at any time */
+};
+
+struct whcc_inst {
+  uint64_t iid; /* 0 if free */
+  seqno_t prune_seq;
+  uint32_t headidx; /* next free slot if free */
+};
+
+struct whcc_deferred_free_list {
+  uint32_t n;
+  struct {
+    struct ddsi_serdata *serdata;
+    struct ddsi_plist *plist;
+  } xs[];
+};
+
+struct whc_compact {
+  struct whc common;
+  ddsrt_mutex_t lock;
+  unsigned xchecks: 1;
+  struct ddsi_domaingv *gv;
+  struct ddsi_tkmap *tkmap;
+  struct whc_writer_info wrinfo;
+  size_t sample_overhead;
+  uint32_t fragment_size;
+  seqno_t max_drop_seq; /* samples in whc with seq <= max_drop_seq => transient-local */
+  size_t unacked_bytes;
+  uint32_t seq_size; /* number of samples, excluding holes */
+
+  /* ring buffer of samples: size is a power of 2, virtual index v lives in ring[v & (size-1)] */
+  struct whcc_node *ring;
+  uint32_t ring_size;
+  uint32_t ring_first; /* virtual index of first slot */
+  uint32_t ring_n; /* number of slots in use, including holes */
+
+  /* instance index */
+  struct whcc_inst *insts;
+  seqno_t *hist;
+  uint32_t insts_size;
+  uint32_t insts_free; /* head of free list, insts_size if empty */
+  uint32_t n_instances;
+  uint32_t *idx; /* inst + 1, 0 if empty */
+  uint32_t idx_size;
+  uint32_t idx_shift;
+};
+
+struct whcc_sample_iter_impl {
+  struct whc_sample_iter_base c;
+  bool first;
+};
+
+/* check that our definition of whc_sample_iter fits in the type that callers allocate */
+DDSRT_STATIC_ASSERT (sizeof (struct whcc_sample_iter_impl) <= sizeof (struct whc_sample_iter));
+
+static int whcc_insert (struct whc *whc, seqno_t max_drop_seq, seqno_t seq, ddsrt_mtime_t exp, struct ddsi_plist *plist, struct ddsi_serdata *serdata, struct ddsi_tkmap_instance *tk);
+static uint32_t whcc_remove_acked_messages (struct whc *whc, seqno_t max_drop_seq, struct whc_state *whcst, struct whc_node **deferred_free_list);
+static void whcc_free_deferred_free_list (struct whc *whc, struct whc_node *deferred_free_list);
+static void whcc_get_state (const struct whc *whc, struct whc_state *st);
+static seqno_t whcc_next_seq (const struct whc *whc, seqno_t seq);
+static bool whcc_borrow_sample (const struct whc *whc, seqno_t seq, struct whc_borrowed_sample *sample);
+static bool whcc_borrow_sample_key (const struct whc *whc, const struct ddsi_serdata *serdata_key, struct whc_borrowed_sample *sample);
+static void whcc_return_sample (struct whc *whc, struct whc_borrowed_sample *sample, bool update_retransmit_info);
+static void whcc_sample_iter_init (const struct whc *whc, struct whc_sample_iter *opaque_it);
+static bool whcc_sample_iter_borrow_next (struct whc_sample_iter *opaque_it, struct whc_borrowed_sample *sample);
+static uint32_t whcc_downgrade_to_volatile (struct whc *whc, struct whc_state *st);
+static void whcc_free (struct whc *whc);
+static void whcc_get_memory_stats (const struct whc *whc, struct whc_memory_stats *st);
+
+static const struct whc_ops whcc_ops = {
+  .insert = whcc_insert,
+  .remove_acked_messages = whcc_remove_acked_messages,
+  .free_deferred_free_list = whcc_free_deferred_free_list,
+  .get_state = whcc_get_state,
+  .next_seq = whcc_next_seq,
+  .borrow_sample = whcc_borrow_sample,
+  .borrow_sample_key = whcc_borrow_sample_key,
+  .return_sample = whcc_return_sample,
+  .sample_iter_init = whcc_sample_iter_init,
+  .sample_iter_borrow_next = whcc_sample_iter_borrow_next,
+  .downgrade_to_volatile = whcc_downgrade_to_volatile,
+  .free = whcc_free,
+  .get_memory_stats = whcc_get_memory_stats
+};
+
+#define TRACE(...) DDS_CLOG (DDS_LC_WHC, &whc->gv->logconfig, __VA_ARGS__)
+
+/* ring buffer */
+
+static struct whcc_node *whcc_slot (const struct whc_compact *whc, uint32_t v)
+{
+  return &whc->ring[v & (whc->ring_size - 1)];
+}
+
+static uint32_t whcc_end (const struct whc_compact *whc)
+{
+  return whc->ring_first + whc->ring_n;
+}
+
+static bool whcc_before_end (const struct whc_compact *whc, uint32_t v)
+{
+  return (uint32_t) (v - whc->ring_first) < whc->ring_n;
+}
+
+static void whcc_resize_ring (struct whc_compact *whc, uint32_t size)
+{
+  /* virtual indices remain valid because ring_n <= min (old size, new size) */
+  struct whcc_node *ring = ddsrt_malloc (size * sizeof (*ring));
+  assert (whc->ring_n <= size);
+  for (uint32_t v = whc->ring_first; v != whcc_end (whc); v++)
+    ring[v & (size - 1)] = *whcc_slot (whc, v);
+  ddsrt_free (whc->ring);
+  whc->ring = ring;
+  whc->ring_size = size;
+}
+
+/* Returns the virtual index of the first slot with a sequence number >= seq, whcc_end if none */
+static uint32_t whcc_lower_bound (const struct whc_compact *whc, seqno_t seq)
+{
+  if (whc->ring_n == 0)
+    return whc->ring_first;
+  const seqno_t first_seq = whcc_slot (whc, whc->ring_first)->seq;
+  if (seq <= first_seq)
+    return whc->ring_first;
+  if ((uint64_t) (seq - first_seq) < whc->ring_n)
+  {
+    /* if the sequence numbers are dense, the slot is at a fixed offset */
+    const uint32_t v = whc->ring_first + (uint32_t) (seq - first_seq);
+    if (whcc_slot (whc, v)->seq == seq)
+      return v;
+  }
+  uint32_t lo = 0, hi = whc->ring_n;
+  while (lo < hi)
+  {
+    const uint32_t m = lo + (hi - lo) / 2;
+    if (whcc_slot (whc, whc->ring_first + m)->seq < seq)
+      lo = m + 1;
+    else
+      hi = m;
+  }
+  return whc->ring_first + lo;
+}
+
+static struct whcc_node *whcc_findseq (const struct whc_compact *whc, seqno_t seq)
+{
+  const uint32_t v = whcc_lower_bound (whc, seq);
+  if (!whcc_before_end (whc, v))
+    return NULL;
+  struct whcc_node * const n = whcc_slot (whc, v);
+  return (n->seq == seq && n->serdata != NULL) ? n : NULL;
+}
+
+/* Returns the virtual index of the first sample (not a hole) at or after v */
+static uint32_t whcc_skip_holes (const struct whc_compact *whc, uint32_t v)
+{
+  while (whcc_before_end (whc, v) && whcc_slot (whc, v)->serdata == NULL)
+    v++;
+  return v;
+}
+
+static struct whcc_node *whcc_find_nextseq (const struct whc_compact *whc, seqno_t seq)
+{
+  const uint32_t v = whcc_skip_holes (whc, whcc_lower_bound (whc, seq + 1));
+  return whcc_before_end (whc, v) ? whcc_slot (whc, v) : NULL;
+}
+
+static void whcc_tidy (struct whc_compact *whc)
+{
+  /* trim holes at both ends, compact if more holes than samples, shrink if mostly empty */
+  while (whc->ring_n > 0 && whcc_slot (whc, whc->ring_first)->serdata == NULL)
+  {
+    whc->ring_first++;
+    whc->ring_n--;
+  }
+  while (whc->ring_n > 0 && whcc_slot (whc, whcc_end (whc) - 1)->serdata == NULL)
+    whc->ring_n--;
+  if (whc->ring_n - whc->seq_size > whc->seq_size && whc->ring_n - whc->seq_size >= WHCC_MIN_RING_SIZE)
+  {
+    uint32_t w = whc->ring_first;
+    for (uint32_t v = whc->ring_first; v != whcc_end (whc); v++)
+    {
+      const struct whcc_node *n = whcc_slot (whc, v);
+      if (n->serdata != NULL)
+        *whcc_slot (whc, w++) = *n;
+    }
+    whc->ring_n = w - whc->ring_first;
+    assert (whc->ring_n == whc->seq_size);
+  }
+  if (whc->ring_size > WHCC_MIN_RING_SIZE && whc->ring_n < whc->ring_size / 4)
+    whcc_resize_ring (whc, whc->ring_size / 2);
+}
+
+/* instance index */
+
+static uint32_t whcc_idx_hash (const struct whc_compact *whc, uint64_t iid)
+{
+  return (uint32_t) ((iid * UINT64_C (16292676669999574021)) >> whc->idx_shift);
+}
+
+static uint32_t whcc_idx_lookup (const struct whc_compact *whc, uint64_t iid, uint32_t *p_pos)
+{
+  const uint32_t mask = whc->idx_size - 1;
+  uint32_t pos = whcc_idx_hash (whc, iid);
+  while (whc->idx[pos] != 0)
+  {
+    if (whc->insts[whc->idx[pos] - 1].iid == iid)
+    {
+      if (p_pos)
+        *p_pos = pos;
+      return whc->idx[pos] - 1;
+    }
+    pos = (pos + 1) & mask;
+  }
+  return WHCC_NO_INST;
+}
+
+static void whcc_idx_add (struct whc_compact *whc, uint32_t inst)
+{
+  const uint32_t mask = whc->idx_size - 1;
+  uint32_t pos = whcc_idx_hash (whc, whc->insts[inst].iid);
+  while (whc->idx[pos] != 0)
+    pos = (pos + 1) & mask;
+  whc->idx[pos] = inst + 1;
+}
+
+static void whcc_idx_remove (struct whc_compact *whc, uint32_t pos)
+{
+  /* backward shift deletion: move entries that would otherwise become unreachable */
+  const uint32_t mask = whc->idx_size - 1;
+  uint32_t j = pos;
+  whc->idx[pos] = 0;
+  while (whc->idx[j = (j + 1) & mask] != 0)
+  {
+    const uint32_t home = whcc_idx_hash (whc, whc->insts[whc->idx[j] - 1].iid);
+    if (((j - home) & mask) >= ((j - pos) & mask))
+    {
+      whc->idx[pos] = whc->idx[j];
+      whc->idx[j] = 0;
+      pos = j;
+    }
+  }
+}
+
+static void whcc_idx_resize (struct whc_compact *whc, uint32_t size)
+{
+  uint32_t shift = 64;
+  for (uint32_t s = size; s > 1; s >>= 1)
+    shift--;
+  ddsrt_free (whc->idx);
+  whc->idx = ddsrt_malloc (size * sizeof (*whc->idx));
+  memset (whc->idx, 0, size * sizeof (*whc->idx));
+  whc->idx_size = size;
+  whc->idx_shift = shift;
+  for (uint32_t i = 0; i < whc->insts_size; i++)
+    if (whc->insts[i].iid != 0)
+      whcc_idx_add (whc, i);
+}
+
+static seqno_t *whcc_hist (const struct whc_compact *whc, uint32_t inst)
+{
+  return &whc->hist[(size_t) inst * whc->wrinfo.idxdepth];
+}
+
+static uint32_t whcc_new_inst (struct whc_compact *whc, uint64_t iid)
+{
+  uint32_t inst;
+  if (whc->insts_free == whc->insts_size)
+  {
+    const uint32_t size = (whc->insts_size == 0) ? WHCC_MIN_IDX_SIZE / 2 : 2 * whc->insts_size;
+    whc->insts = ddsrt_realloc (whc->insts, size * sizeof (*whc->insts));
+    whc->hist = ddsrt_realloc (whc->hist, (size_t) size * whc->wrinfo.idxdepth * sizeof (*whc->hist));
+    for (uint32_t i = whc->insts_size; i < size; i++)
+    {
+      whc->insts[i].iid = 0;
+      whc->insts[i].headidx = i + 1;
+    }
+    whc->insts_free = whc->insts_size;
+    whc->insts_size = size;
+  }
+  inst = whc->insts_free;
+  whc->insts_free = whc->insts[inst].headidx;
+  whc->insts[inst].iid = iid;
+  whc->insts[inst].prune_seq = 0;
+  whc->insts[inst].headidx = 0;
+  memset (whcc_hist (whc, inst), 0, whc->wrinfo.idxdepth * sizeof (*whc->hist));
+  whc->n_instances++;
+  /* keep the load factor of the hash table below 50% */
+  if (2 * whc->n_instances > whc->idx_size)
+    whcc_idx_resize (whc, 2 * whc->idx_size);
+  else
+    whcc_idx_add (whc, inst);
+  return inst;
+}
+
+static void whcc_free_inst (struct whc_compact *whc, uint32_t inst)
+{
+  whc->insts[inst].iid = 0;
+  whc->insts[inst].headidx = whc->insts_free;
+  whc->insts_free = inst;
+  whc->n_instances--;
+}
+
+/* samples */
+
+static uint32_t whcc_size (const struct whc_compact *whc, const struct ddsi_serdata *serdata)
+{
+  const size_t sz = ddsi_serdata_size (serdata);
+  const size_t sz_tot = sz + ((sz + whc->fragment_size - 1) / whc->fragment_size) * whc->sample_overhead;
+  return (sz_tot > UINT32_MAX) ? UINT32_MAX : (uint32_t) sz_tot;
+}
+
+static void free_whcc_node_contents (struct ddsi_serdata *serdata, struct ddsi_plist *plist)
+{
+  ddsi_serdata_unref (serdata);
+  if (plist)
+  {
+    ddsi_plist_fini (plist);
+    ddsrt_free (plist);
+  }
+}
+
+static void delete_one_sample_from_idx (struct whc_compact *whc, struct whcc_node *n)
+{
+  seqno_t * const hist = whcc_hist (whc, n->inst);
+  assert (hist[n->idxpos] == n->seq);
+  hist[n->idxpos] = 0;
+  n->inst = WHCC_NO_INST;
+}
+
+/* Turns n into a hole; if dfl is NULL the contents are freed immediately, else they
+   are appended to dfl.  Borrowed samples are owned by the borrower once deleted. */
+static void whcc_delete_one (struct whc_compact *whc, struct whcc_node *n, struct whcc_deferred_free_list *dfl)
+{
+  assert (n->serdata != NULL);
+  if (n->inst != WHCC_NO_INST)
+    delete_one_sample_from_idx (whc, n);
+  if (n->unacked)
+  {
+    assert (whc->unacked_bytes >= n->size);
+    whc->unacked_bytes -= n->size;
+    n->unacked = 0;
+  }
+  if (n->borrowed)
+    ;
+  else if (dfl == NULL)
+    free_whcc_node_contents (n->serdata, n->plist);
+  else
+  {
+    dfl->xs[dfl->n].serdata = n->serdata;
+    dfl->xs[dfl->n].plist = n->plist;
+    dfl->n++;
+  }
+  n->serdata = NULL;
+  n->plist = NULL;
+  assert (whc->seq_size > 0);
+  whc->seq_size--;
+}
+
+static void whcc_delete_seq (struct whc_compact *whc, seqno_t seq)
+{
+  struct whcc_node * const n = whcc_findseq (whc, seq);
+  assert (n != NULL);
+  whcc_delete_one (whc, n, NULL);
+}
+
+static void check_whc (const struct whc_compact *whc)
+{
+  (void) whc;
+  assert (whc->seq_size <= whc->ring_n);
+  assert (whc->ring_n <= whc->ring_size);
+  assert (whc->ring_n == 0 || whcc_slot (whc, whc->ring_first)->serdata != NULL);
+  assert (whc->ring_n == 0 || whcc_slot (whc, whcc_end (whc) - 1)->serdata != NULL);
+#if !defined (NDEBUG)
+  if (whc->xchecks)
+  {
+    seqno_t prevseq = 0;
+    uint32_t nlive = 0;
+    size_t unacked_bytes = 0;
+    for (uint32_t v = whc->ring_first; v != whcc_end (whc); v++)
+    {
+      const struct whcc_node *n = whcc_slot (whc, v);
+      assert (n->seq > prevseq);
+      prevseq = n->seq;
+      if (n->serdata == NULL)
+        continue;
+      nlive++;
+      if (n->unacked)
+        unacked_bytes += n->size;
+      assert (whcc_findseq (whc, n->seq) == n);
+      assert (n->inst == WHCC_NO_INST || whcc_hist (whc, n->inst)[n->idxpos] == n->seq);
+    }
+    assert (nlive == whc->seq_size);
+    assert (unacked_bytes == whc->unacked_bytes);
+  }
+#endif
+}
+
+bool whc_compact_supported (const struct whc_writer_info *wrinfo)
+{
+  return !wrinfo->has_deadline && wrinfo->idxdepth <= WHC_COMPACT_MAX_IDXDEPTH;
+}
+
+struct whc *whc_compact_new (struct ddsi_domaingv *gv, const struct whc_writer_info *wrinfo)
+{
+  struct whc_compact *whc;
+  assert (whc_compact_supported (wrinfo));
+  assert ((wrinfo->hdepth == 0 || wrinfo->tldepth <= wrinfo->hdepth) || wrinfo->is_transient_local);
+
+  whc = ddsrt_malloc (sizeof (*whc));
+  whc->common.ops = &whcc_ops;
+  ddsrt_mutex_init (&whc->lock);
+  whc->xchecks = (gv->config.enabled_xchecks & DDSI_XCHECK_WHC) != 0;
+  whc->gv = gv;
+  whc->tkmap = gv->m_tkmap;
+  memcpy (&whc->wrinfo, wrinfo, sizeof (*wrinfo));
+  whc->sample_overhead = 80; /* INFO_TS, DATA (estimate), inline QoS */
+  whc->fragment_size = gv->config.fragment_size;
+  whc->max_drop_seq = 0;
+  whc->unacked_bytes = 0;
+  whc->seq_size = 0;
+
+  whc->ring_size = WHCC_MIN_RING_SIZE;
+  whc->ring = ddsrt_malloc (whc->ring_size * sizeof (*whc->ring));
+  whc->ring_first = 0;
+  whc->ring_n = 0;
+
+  whc->insts = NULL;
+  whc->hist = NULL;
+  whc->insts_size = 0;
+  whc->insts_free = 0;
+  whc->n_instances = 0;
+  whc->idx = NULL;
+  if (whc->wrinfo.idxdepth > 0)
+    whcc_idx_resize (whc, WHCC_MIN_IDX_SIZE);
+  else
+  {
+    whc->idx_size = 0;
+    whc->idx_shift = 0;
+  }
+  check_whc (whc);
+  return (struct whc *) whc;
+}
+
+static void whcc_free (struct whc *whc_generic)
+{
+  struct whc_compact * const whc = (struct whc_compact *) whc_generic;
+  check_whc (whc);
+  for (uint32_t v = whc->ring_first; v != whcc_end (whc); v++)
+  {
+    struct whcc_node *n = whcc_slot (whc, v);
+    if (n->serdata)
+      free_whcc_node_contents (n->serdata, n->plist);
+  }
+  ddsrt_free (whc->ring);
+  ddsrt_free (whc->insts);
+  ddsrt_free (whc->hist);
+  ddsrt_free (whc->idx);
+  ddsrt_mutex_destroy (&whc->lock);
+  ddsrt_free (whc);
+}
+
+static void get_state_locked (const struct whc_compact *whc, struct whc_state *st)
+{
+  if (whc->seq_size == 0)
+  {
+    st->min_seq = st->max_seq = -1;
+    st->unacked_bytes = 0;
+  }
+  else
+  {
+    st->min_seq = whcc_slot (whc, whc->ring_first)->seq;
+    st->max_seq = whcc_slot (whc, whcc_end (whc) - 1)->seq;
+    st->unacked_bytes = whc->unacked_bytes;
+  }
+}
+
+static void whcc_get_state (const struct whc *whc_generic, struct whc_state *st)
+{
+  const struct whc_compact * const whc = (const struct whc_compact *) whc_generic;
+  ddsrt_mutex_lock ((ddsrt_mutex_t *) &whc->lock);
+  check_whc (whc);
+  get_state_locked (whc, st);
+  ddsrt_mutex_unlock ((ddsrt_mutex_t *) &whc->lock);
+}
+
+static seqno_t whcc_next_seq (const struct whc *whc_generic, seqno_t seq)
+{
+  const struct whc_compact * const whc = (const struct whc_compact *) whc_generic;
+  const struct whcc_node *n;
+  seqno_t nseq;
+  ddsrt_mutex_lock ((ddsrt_mutex_t *) &whc->lock);
+  check_whc (whc);
+  if ((n = whcc_find_nextseq (whc, seq)) == NULL)
+    nseq = MAX_SEQ_NUMBER;
+  else
+    nseq = n->seq;
+  ddsrt_mutex_unlock ((ddsrt_mutex_t *) &whc->lock);
+  return nseq;
+}
+
+static void free_one_instance_from_idx (struct whc_compact *whc, seqno_t max_drop_seq, uint32_t inst)
+{
+  seqno_t * const hist = whcc_hist (whc, inst);
+  for (uint32_t i = 0; i < whc->wrinfo.idxdepth; i++)
+  {
+    if (hist[i] != 0)
+    {
+      struct whcc_node * const oldn = whcc_findseq (whc, hist[i]);
+      assert (oldn != NULL && oldn->inst == inst);
+      oldn->inst = WHCC_NO_INST;
+      if (oldn->seq <= max_drop_seq)
+      {
+        TRACE ("  prune tl whcn %"PRId64"\n", oldn->seq);
+        whcc_delete_one (whc, oldn, NULL);
+      }
+    }
+  }
+  whcc_free_inst (whc, inst);
+}
+
+static bool whcn_in_tlidx (const struct whc_compact *whc, const struct whcc_node *n)
+{
+  if (n->inst == WHCC_NO_INST)
+    return false;
+  else
+  {
+    const uint32_t headidx = whc->insts[n->inst].headidx;
+    const uint32_t d = (headidx + (n->idxpos > headidx ? whc->wrinfo.idxdepth : 0)) - n->idxpos;
+    assert (d < whc->wrinfo.idxdepth);
+    return d < whc->wrinfo.tldepth;
+  }
+}
+
+static struct whcc_deferred_free_list *whcc_new_deferred_free_list (const struct whc_compact *whc, seqno_t max_drop_seq)
+{
+  /* upper bound on the number of samples with sequence number <= max_drop_seq */
+  const uint32_t n = (uint32_t) (whcc_lower_bound (whc, max_drop_seq + 1) - whc->ring_first);
+  if (n == 0)
+    return NULL;
+  struct whcc_deferred_free_list *dfl = ddsrt_malloc (sizeof (*dfl) + n * sizeof (dfl->xs[0]));
+  dfl->n = 0;
+  return dfl;
+}
+
+static struct whc_node *whcc_finish_deferred_free_list (struct whcc_deferred_free_list *dfl)
+{
+  if (dfl != NULL && dfl->n == 0)
+  {
+    ddsrt_free (dfl);
+    dfl = NULL;
+  }
+  return (struct whc_node *) dfl;
+}
+
+static void whcc_free_deferred_free_list (struct whc *whc_generic, struct whc_node *deferred_free_list)
+{
+  struct whcc_deferred_free_list * const dfl = (struct whcc_deferred_free_list *) deferred_free_list;
+  (void) whc_generic;
+  if (dfl)
+  {
+    for (uint32_t i = 0; i < dfl->n; i++)
+      free_whcc_node_contents (dfl->xs[i].serdata, dfl->xs[i].plist);
+    ddsrt_free (dfl);
+  }
+}
+
+static uint32_t whcc_remove_acked_messages_noidx (struct whc_compact *whc, seqno_t max_drop_seq, struct whc_node **deferred_free_list)
+{
+  struct whcc_deferred_free_list *dfl;
+  uint32_t ndropped = 0;
+
+  /* In the trivial case of an empty WHC, get out quickly */
+  if (max_drop_seq <= whc->max_drop_seq || whc->seq_size == 0)
+  {
+    if (max_drop_seq > whc->max_drop_seq)
+      whc->max_drop_seq = max_drop_seq;
+    *deferred_free_list = NULL;
+    return 0;
+  }
+
+  /* Everything up to whc->max_drop_seq has been dropped already, so it is simply a matter
+     of dropping a prefix of the ring buffer */
+  dfl = whcc_new_deferred_free_list (whc, max_drop_seq);
+  for (uint32_t v = whc->ring_first; whcc_before_end (whc, v) && whcc_slot (whc, v)->seq <= max_drop_seq; v++)
+  {
+    struct whcc_node * const n = whcc_slot (whc, v);
+    if (n->serdata != NULL)
+    {
+      whcc_delete_one (whc, n, dfl);
+      ndropped++;
+    }
+  }
+  whcc_tidy (whc);
+  whc->max_drop_seq = max_drop_seq;
+  *deferred_free_list = whcc_finish_deferred_free_list (dfl);
+  return ndropped;
+}
+
+static uint32_t whcc_remove_acked_messages_full (struct whc_compact *whc, seqno_t max_drop_seq, struct whc_node **deferred_free_list)
+{
+  struct whcc_deferred_free_list *dfl;
+  const uint32_t vstart = whcc_lower_bound (whc, whc->max_drop_seq + 1);
+  uint32_t ndropped = 0;
+
+  if (whc->wrinfo.is_transient_local && whc->wrinfo.tldepth == 0)
+  {
+    /* KEEP_ALL on transient local, so we can never ever delete anything, but
+       we have to ack the data in whc */
+    TRACE ("  KEEP_ALL transient-local: ack data\n");
+    for (uint32_t v = vstart; whcc_before_end (whc, v) && whcc_slot (whc, v)->seq <= max_drop_seq; v++)
+    {
+      struct whcc_node * const n = whcc_slot (whc, v);
+      if (n->unacked)
+      {
+        assert (whc->unacked_bytes >= n->size);
+        whc->unacked_bytes -= n->size;
+        n->unacked = 0;
+      }
+    }
+    whc->max_drop_seq = max_drop_seq;
+    *deferred_free_list = NULL;
+    return 0;
+  }
+
+  /* Slots don't move until whcc_tidy gets called, so virtual indices stay valid */
+  dfl = whcc_new_deferred_free_list (whc, max_drop_seq);
+  for (uint32_t v = vstart; whcc_before_end (whc, v) && whcc_slot (whc, v)->seq <= max_drop_seq; v++)
+  {
+    struct whcc_node * const n = whcc_slot (whc, v);
+    if (n->serdata == NULL)
+      continue;
+    TRACE ("  whcn %"PRId64, n->seq);
+    if (whcn_in_tlidx (whc, n))
+    {
+      /* quickly skip over samples in tlidx */
+      TRACE (" tl:keep");
+      if (n->unacked)
+      {
+        assert (whc->unacked_bytes >= n->size);
+        whc->unacked_bytes -= n->size;
+        n->unacked = 0;
+      }
+    }
+    else
+    {
+      TRACE (" delete");
+      whcc_delete_one (whc, n, dfl);
+      ndropped++;
+    }
+    TRACE ("\n");
+  }
+  *deferred_free_list = whcc_finish_deferred_free_list (dfl);
+
+  /* If the history is deeper than durability_service.history (but not KEEP_ALL), then there
+   may be old samples in this instance, samples that were retained because they were within
+   the T-L history but that are not anymore. Writing new samples will eventually push these
+   out, but if the difference is large and the update rate low, it may take a long time.
+   Thus, we had better prune them. */
+  if (whc->wrinfo.tldepth > 0 && whc->wrinfo.idxdepth > whc->wrinfo.tldepth)
+  {
+    assert (whc->wrinfo.hdepth == whc->wrinfo.idxdepth);
+    TRACE ("  idxdepth %"PRIu32" > tldepth %"PRIu32" > 0 -- must prune\n", whc->wrinfo.idxdepth, whc->wrinfo.tldepth);
+
+    /* Do a second pass over the sequence number range we just processed: this time we only
+     encounter samples that were retained because of the transient-local durability setting
+     (the rest has been dropped already) and we prune old samples in the instance */
+    for (uint32_t v = vstart; whcc_before_end (whc, v) && whcc_slot (whc, v)->seq <= max_drop_seq; v++)
+    {
+      const struct whcc_node * const n = whcc_slot (whc, v);
+      if (n->serdata == NULL)
+        continue;
+      struct whcc_inst * const inst = &whc->insts[n->inst];
+      seqno_t * const hist = whcc_hist (whc, n->inst);
+      TRACE ("  whcn %"PRId64" inst %"PRIu32" prune_seq %"PRId64":", n->seq, n->inst, inst->prune_seq);
+
+      assert (whcn_in_tlidx (whc, n));
+      assert (inst->prune_seq <= max_drop_seq);
+
+      if (inst->prune_seq == max_drop_seq)
+      {
+        TRACE (" already pruned\n");
+        continue;
+      }
+      inst->prune_seq = max_drop_seq;
+
+      uint32_t idx = inst->headidx;
+      uint32_t cnt = whc->wrinfo.idxdepth - whc->wrinfo.tldepth;
+      while (cnt--)
+      {
+        if (++idx == whc->wrinfo.idxdepth)
+          idx = 0;
+        if (hist[idx] != 0)
+        {
+          /* Delete it - but this may not result in deleting the instance as
+           there must still be a more recent one available */
+          assert (hist[idx] < n->seq);
+          TRACE (" del %"PRId64, hist[idx]);
+          whcc_delete_seq (whc, hist[idx]);
+        }
+      }
+      TRACE ("\n");
+    }
+  }
+
+  whcc_tidy (whc);
+  whc->max_drop_seq = max_drop_seq;
+  return ndropped;
+}
+
+static uint32_t whcc_remove_acked_messages (struct whc *whc_generic, seqno_t max_drop_seq, struct whc_state *whcst, struct whc_node **deferred_free_list)
+{
+  struct whc_compact * const whc = (struct whc_compact *) whc_generic;
+  uint32_t cnt;
+
+  ddsrt_mutex_lock (&whc->lock);
+  assert (max_drop_seq < MAX_SEQ_NUMBER);
+  assert (max_drop_seq >= whc->max_drop_seq);
+
+  if (whc->gv->logconfig.c.mask & DDS_LC_WHC)
+  {
+    struct whc_state tmp;
+    get_state_locked (whc, &tmp);
+    TRACE ("whcc_remove_acked_messages(%p max_drop_seq %"PRId64")\n", (void *)whc, max_drop_seq);
+    TRACE ("  whc: [%"PRId64",%"PRId64"] max_drop_seq %"PRId64" h %"PRIu32" tl %"PRIu32"\n",
+           tmp.min_seq, tmp.max_seq, whc->max_drop_seq, whc->wrinfo.hdepth, whc->wrinfo.tldepth);
+  }
+
+  check_whc (whc);
+  if (whc->wrinfo.idxdepth == 0 && !whc->wrinfo.is_transient_local)
+    cnt = whcc_remove_acked_messages_noidx (whc, max_drop_seq, deferred_free_list);
+  else
+    cnt = whcc_remove_acked_messages_full (whc, max_drop_seq, deferred_free_list);
+  check_whc (whc);
+  get_state_locked (whc, whcst);
+  ddsrt_mutex_unlock (&whc->lock);
+  return cnt;
+}
+
+static uint32_t whcc_downgrade_to_volatile (struct whc *whc_generic, struct whc_state *st)
+{
+  struct whc_compact * const whc = (struct whc_compact *) whc_generic;
+  seqno_t old_max_drop_seq;
+  struct whc_node *deferred_free_list;
+  uint32_t cnt;
+
+  ddsrt_mutex_lock (&whc->lock);
+  check_whc (whc);
+
+  if (whc->wrinfo.idxdepth == 0)
+  {
+    /* if not maintaining an index at all, this is nonsense */
+    get_state_locked (whc, st);
+    ddsrt_mutex_unlock (&whc->lock);
+    return 0;
+  }
+
+  assert (!whc->wrinfo.is_transient_local);
+  if (whc->wrinfo.tldepth > 0)
+  {
+    assert (whc->wrinfo.hdepth == 0 || whc->wrinfo.tldepth <= whc->wrinfo.hdepth);
+    whc->wrinfo.tldepth = 0;
+    if (whc->wrinfo.hdepth == 0)
+    {
+      for (uint32_t i = 0; i < whc->insts_size; i++)
+        if (whc->insts[i].iid != 0)
+          free_one_instance_from_idx (whc, 0, i);
+      assert (whc->n_instances == 0);
+      ddsrt_free (whc->insts);
+      ddsrt_free (whc->hist);
+      ddsrt_free (whc->idx);
+      whc->insts = NULL;
+      whc->hist = NULL;
+      whc->idx = NULL;
+      whc->insts_size = whc->insts_free = 0;
+      whc->idx_size = 0;
+      whc->wrinfo.idxdepth = 0;
+    }
+  }
+
+  /* Immediately drop them from the WHC; but need to make sure remove_acked_messages
+   processes them all. */
+  old_max_drop_seq = whc->max_drop_seq;
+  whc->max_drop_seq = 0;
+  cnt = whcc_remove_acked_messages_full (whc, old_max_drop_seq, &deferred_free_list);
+  whcc_free_deferred_free_list (whc_generic, deferred_free_list);
+  assert (whc->max_drop_seq == old_max_drop_seq);
+  check_whc (whc);
+  get_state_locked (whc, st);
+  ddsrt_mutex_unlock (&whc->lock);
+  return cnt;
+}
+
+static struct whcc_node *whcc_insert_seq (struct whc_compact *whc, seqno_t max_drop_seq, seqno_t seq, struct ddsi_plist *plist, struct ddsi_serdata *serdata)
+{
+  struct whcc_node *n;
+  if (whc->ring_n == whc->ring_size)
+    whcc_resize_ring (whc, 2 * whc->ring_size);
+  n = whcc_slot (whc, whcc_end (whc));
+  whc->ring_n++;
+  n->seq = seq;
+  n->serdata = ddsi_serdata_ref (serdata);
+  n->plist = plist;
+  n->last_rexmit_ts.v = 0;
+  n->size = whcc_size (whc, serdata);
+  n->rexmit_count = 0;
+  n->inst = WHCC_NO_INST;
+  n->idxpos = 0;
+  n->unacked = (seq > max_drop_seq);
+  n->borrowed = 0;
+  if (n->unacked)
+    whc->unacked_bytes += n->size;
+  whc->seq_size++;
+  return n;
+}
+
+static void whcc_insert_idx (struct whc_compact *whc, seqno_t max_drop_seq, struct whcc_node *newn, struct ddsi_serdata *serdata, struct ddsi_tkmap_instance *tk)
+{
+  uint32_t inst, pos;
+  if ((inst = whcc_idx_lookup (whc, tk->m_iid, &pos)) != WHCC_NO_INST)
+  {
+    /* Unregisters cause deleting of index entry, non-unregister of adding/overwriting in history */
+    TRACE (" inst %"PRIu32, inst);
+    if (serdata->statusinfo & NN_STATUSINFO_UNREGISTER)
+    {
+      TRACE (" unreg:delete\n");
+      whcc_idx_remove (whc, pos);
+      free_one_instance_from_idx (whc, max_drop_seq, inst);
+      if (newn->seq <= max_drop_seq)
+      {
+        TRACE (" unreg:seq <= max_drop_seq: delete newn\n");
+        whcc_delete_one (whc, newn, NULL);
+      }
+    }
+    else
+    {
+      struct whcc_inst * const in = &whc->insts[inst];
+      seqno_t * const hist = whcc_hist (whc, inst);
+      struct whcc_node *oldn = NULL;
+      if (++in->headidx == whc->wrinfo.idxdepth)
+        in->headidx = 0;
+      if (hist[in->headidx] != 0)
+      {
+        oldn = whcc_findseq (whc, hist[in->headidx]);
+        assert (oldn != NULL && oldn->inst == inst);
+        TRACE (" overwrite whcn %"PRId64, oldn->seq);
+        oldn->inst = WHCC_NO_INST;
+      }
+      hist[in->headidx] = newn->seq;
+      newn->inst = inst;
+      newn->idxpos = in->headidx & 0x3fffffff;
+
+      if (oldn && (whc->wrinfo.hdepth > 0 || oldn->seq <= max_drop_seq) && (!whc->wrinfo.is_transient_local || whc->wrinfo.tldepth > 0))
+      {
+        TRACE (" prune whcn %"PRId64, oldn->seq);
+        whcc_delete_one (whc, oldn, NULL);
+      }
+
+      /* Special case for dropping everything beyond T-L history when the new sample is being
+      auto-acknowledged (for lack of reliable readers), and the keep-last T-L history is
+      shallower than the keep-last regular history (normal path handles this via pruning in
+      whcc_remove_acked_messages, but that never happens when there are no readers). */
+      if (newn->seq <= max_drop_seq && whc->wrinfo.tldepth > 0 && whc->wrinfo.idxdepth > whc->wrinfo.tldepth)
+      {
+        uint32_t hpos = in->headidx + whc->wrinfo.idxdepth - whc->wrinfo.tldepth;
+        if (hpos >= whc->wrinfo.idxdepth)
+          hpos -= whc->wrinfo.idxdepth;
+        if (hist[hpos] != 0)
+        {
+          TRACE (" prune tl whcn %"PRId64, hist[hpos]);
+          whcc_delete_seq (whc, hist[hpos]);
+        }
+      }
+      TRACE ("\n");
+    }
+  }
+  else
+  {
+    TRACE (" newkey");
+    /* Ignore unregisters, but insert everything else */
+    if (!(serdata->statusinfo & NN_STATUSINFO_UNREGISTER))
+    {
+      ddsi_tkmap_instance_ref (tk);
+      inst = whcc_new_inst (whc, tk->m_iid);
+      TRACE (" inst %"PRIu32, inst);
+      whcc_hist (whc, inst)[0] = newn->seq;
+      newn->inst = inst;
+      newn->idxpos = 0;
+    }
+    else
+    {
+      TRACE (" unreg:skip");
+      if (newn->seq <= max_drop_seq)
+      {
+        TRACE (" unreg:seq <= max_drop_seq: delete newn");
+        whcc_delete_one (whc, newn, NULL);
+      }
+    }
+    TRACE ("\n");
+  }
+}
+
+static int whcc_insert (struct whc *whc_generic, seqno_t max_drop_seq, seqno_t seq, ddsrt_mtime_t exp, struct ddsi_plist *plist, struct ddsi_serdata *serdata, struct ddsi_tkmap_instance *tk)
+{
+  struct whc_compact * const whc = (struct whc_compact *) whc_generic;
+  struct whcc_node *newn;
+  DDSRT_UNUSED_ARG (exp);
+
+  ddsrt_mutex_lock (&whc->lock);
+  check_whc (whc);
+
+  if (whc->gv->logconfig.c.mask & DDS_LC_WHC)
+  {
+    struct whc_state whcst;
+    get_state_locked (whc, &whcst);
+    TRACE ("whcc_insert(%p max_drop_seq %"PRId64" seq %"PRId64" plist %p serdata %p:%"PRIx32")\n",
+           (void *) whc, max_drop_seq, seq, (void *) plist, (void *) serdata, serdata->hash);
+    TRACE ("  whc: [%"PRId64",%"PRId64"] max_drop_seq %"PRId64" h %"PRIu32" tl %"PRIu32"\n",
+           whcst.min_seq, whcst.max_seq, whc->max_drop_seq, whc->wrinfo.hdepth, whc->wrinfo.tldepth);
+  }
+
+  assert (max_drop_seq < MAX_SEQ_NUMBER);
+  assert (max_drop_seq >= whc->max_drop_seq);
+
+  /* Seq must be greater than what is currently stored. Usually it'll
+   be the next sequence number, but if there are no readers
+   temporarily, a gap may be among the possibilities */
+  assert (whc->ring_n == 0 || seq > whcc_slot (whc, whcc_end (whc) - 1)->seq);
+
+  /* Always insert in seq admin */
+  newn = whcc_insert_seq (whc, max_drop_seq, seq, plist, serdata);
+  TRACE ("  whcn %"PRId64":", seq);
+
+  /* Special case of empty data (such as commit messages) can't go into index */
+  if (serdata->kind == SDK_EMPTY)
+    TRACE (" empty\n");
+  else if (whc->wrinfo.idxdepth > 0)
+    whcc_insert_idx (whc, max_drop_seq, newn, serdata, tk);
+  else if ((serdata->statusinfo & NN_STATUSINFO_UNREGISTER) && seq <= max_drop_seq)
+  {
+    /* without an index, the only effect of an unregister is this */
+    TRACE (" unreg:seq <= max_drop_seq: delete newn\n");
+    whcc_delete_one (whc, newn, NULL);
+  }
+  else
+  {
+    TRACE (" no hist\n");
+  }
+
+  whcc_tidy (whc);
+  check_whc (whc);
+  ddsrt_mutex_unlock (&whc->lock);
+  return 0;
+}
+
+static void make_borrowed_sample (struct whc_borrowed_sample *sample, struct whcc_node *n)
+{
+  assert (!n->borrowed);
+  n->borrowed = 1;
+  sample->seq = n->seq;
+  sample->plist = n->plist;
+  sample->serdata = n->serdata;
+  sample->unacked = n->unacked;
+  sample->rexmit_count = n->rexmit_count;
+  sample->last_rexmit_ts = n->last_rexmit_ts;
+}
+
+static bool whcc_borrow_sample (const struct whc *whc_generic, seqno_t seq, struct whc_borrowed_sample *sample)
+{
+  const struct whc_compact * const whc = (const struct whc_compact *) whc_generic;
+  struct whcc_node *n;
+  bool found;
+  ddsrt_mutex_lock ((ddsrt_mutex_t *) &whc->lock);
+  if ((n = whcc_findseq (whc, seq)) == NULL)
+    found = false;
+  else
+  {
+    make_borrowed_sample (sample, n);
+    found = true;
+  }
+  ddsrt_mutex_unlock ((ddsrt_mutex_t *) &whc->lock);
+  return found;
+}
+
+static bool whcc_borrow_sample_key (const struct whc *whc_generic, const struct ddsi_serdata *serdata_key, struct whc_borrowed_sample *sample)
+{
+  const struct whc_compact * const whc = (const struct whc_compact *) whc_generic;
+  struct whcc_node *n = NULL;
+  uint32_t inst;
+  bool found;
+  ddsrt_mutex_lock ((ddsrt_mutex_t *) &whc->lock);
+  check_whc (whc);
+  if (whc->wrinfo.idxdepth > 0 && (inst = whcc_idx_lookup (whc, ddsi_tkmap_lookup (whc->tkmap, serdata_key), NULL)) != WHCC_NO_INST)
+  {
+    const seqno_t seq = whcc_hist (whc, inst)[whc->insts[inst].headidx];
+    if (seq != 0)
+      n = whcc_findseq (whc, seq);
+  }
+  if (n == NULL)
+    found = false;
+  else
+  {
+    make_borrowed_sample (sample, n);
+    found = true;
+  }
+  ddsrt_mutex_unlock ((ddsrt_mutex_t *) &whc->lock);
+  return found;
+}
+
+static void return_sample_locked (struct whc_compact *whc, struct whc_borrowed_sample *sample, bool update_retransmit_info)
+{
+  struct whcc_node *n;
+  if ((n = whcc_findseq (whc, sample->seq)) == NULL)
+  {
+    /* data no longer present in WHC - that means ownership for serdata, plist shifted to the borrowed copy and "returning" it really becomes "destroying" it */
+    free_whcc_node_contents (sample->serdata, sample->plist);
+  }
+  else
+  {
+    assert (n->borrowed);
+    n->borrowed = 0;
+    if (update_retransmit_info)
+    {
+      n->rexmit_count = sample->rexmit_count;
+      n->last_rexmit_ts = sample->last_rexmit_ts;
+    }
+  }
+}
+
+static void whcc_return_sample (struct whc *whc_generic, struct whc_borrowed_sample *sample, bool update_retransmit_info)
+{
+  struct whc_compact * const whc = (struct whc_compact *) whc_generic;
+  ddsrt_mutex_lock (&whc->lock);
+  return_sample_locked (whc, sample, update_retransmit_info);
+  ddsrt_mutex_unlock (&whc->lock);
+}
+
+static void whcc_sample_iter_init (const struct whc *whc_generic, struct whc_sample_iter *opaque_it)
+{
+  struct whcc_sample_iter_impl *it = (struct whcc_sample_iter_impl *) opaque_it;
+  it->c.whc = (struct whc *) whc_generic;
+  it->first = true;
+}
+
+static bool whcc_sample_iter_borrow_next (struct whc_sample_iter *opaque_it, struct whc_borrowed_sample *sample)
+{
+  struct whcc_sample_iter_impl * const it = (struct whcc_sample_iter_impl *) opaque_it;
+  struct whc_compact * const whc = (struct whc_compact *) it->c.whc;
+  struct whcc_node *n;
+  seqno_t seq;
+  bool valid;
+  ddsrt_mutex_lock (&whc->lock);
+  check_whc (whc);
+  if (!it->first)
+  {
+    seq = sample->seq;
+    return_sample_locked (whc, sample, false);
+  }
+  else
+  {
+    it->first = false;
+    seq = 0;
+  }
+  if ((n = whcc_find_nextseq (whc, seq)) == NULL)
+    valid = false;
+  else
+  {
+    make_borrowed_sample (sample, n);
+    valid = true;
+  }
+  ddsrt_mutex_unlock (&whc->lock);
+  return valid;
+}
+
+static void whcc_get_memory_stats (const struct whc *whc_generic, struct whc_memory_stats *st)
+{
+  const struct whc_compact * const whc = (const struct whc_compact *) whc_generic;
+  ddsrt_mutex_lock ((ddsrt_mutex_t *) &whc->lock);
+  st->nsamples = whc->seq_size;
+  st->bytes = sizeof (*whc) +
+    whc->ring_size * sizeof (*whc->ring) +
+    whc->insts_size * (sizeof (*whc->insts) + whc->wrinfo.idxdepth * sizeof (*whc->hist)) +
+    whc->idx_size * sizeof (*whc->idx);
+  ddsrt_mutex_unlock ((ddsrt_mutex_t *) &whc->lock);
+}
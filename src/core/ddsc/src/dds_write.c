@@ -315,7 +315,7 @@ static dds_return_t deliver_locally (struct writer *wr, struct ddsi_serdata *pay
   dds_return_t rc;
   struct ddsi_writer_info wrinfo;
   ddsi_make_writer_info (&wrinfo, &wr->e, wr->xqos, payload->statusinfo);
-  rc = deliver_locally_allinsync (wr->e.gv, &wr->e, false, &wr->rdary, &wrinfo, &deliver_locally_ops, &sourceinfo);
+  rc = deliver_locally_allinsync (wr->e.gv, NULL, &wr->e, false, &wr->rdary, &wrinfo, &deliver_locally_ops, &sourceinfo);
   if (rc == DDS_RETCODE_TIMEOUT)
     DDS_CERROR (&wr->e.gv->logconfig, "The writer could not deliver data on time, probably due to a local reader resources being full\n");
   return rc;
@@ -363,7 +363,11 @@ dds_return_t dds_write_impl (dds_writer *wr, const void * data, dds_time_t tstam
   thread_state_awake (ts1, &wr->m_entity.m_domain->gv);
 
   /* Serialize and write data or key */
-  if ((d = ddsi_serdata_from_sample (ddsi_wr->type, writekey ? SDK_KEY : SDK_DATA, data)) == NULL)
+  if (!writekey && wr->m_serdata_cache)
+    d = ddsi_serdata_default_cache_from_sample (wr->m_serdata_cache, ddsi_wr->type, data);
+  else
+    d = ddsi_serdata_from_sample (ddsi_wr->type, writekey ? SDK_KEY : SDK_DATA, data);
+  if (d == NULL)
     ret = DDS_RETCODE_BAD_PARAMETER;
   else
   {
@@ -15,6 +15,7 @@
 #include "dds/dds.h"
 #include "dds/version.h"
 #include "dds/ddsrt/static_assert.h"
+#include "dds/ddsrt/strtol.h"
 #include "dds/ddsi/q_config.h"
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/q_entity.h"
@@ -34,6 +35,7 @@
 #include "dds__statistics.h"
 #include "dds__data_allocator.h"
 #include "dds/ddsi/ddsi_statistics.h"
+#include "dds/ddsi/ddsi_serdata_default.h"
 
 DECL_ENTITY_LOCK_UNLOCK (dds_writer)
 
@@ -207,6 +209,8 @@ static dds_return_t dds_writer_delete (dds_entity *e)
   }
 #endif
   /* FIXME: not freeing WHC here because it is owned by the DDSI entity */
+  if (wr->m_serdata_cache)
+    ddsi_serdata_default_cache_free (wr->m_serdata_cache);
   thread_state_awake (lookup_thread_state (), &e->m_domain->gv);
   nn_xpack_free (wr->m_xp);
   thread_state_asleep (lookup_thread_state ());
@@ -251,7 +255,9 @@ static const struct dds_stat_keyvalue_descriptor dds_writer_statistics_kv[] = {
   { "rexmit_bytes", DDS_STAT_KIND_UINT64 },
   { "throttle_count", DDS_STAT_KIND_UINT32 },
   { "time_throttle", DDS_STAT_KIND_UINT64 },
-  { "time_rexmit", DDS_STAT_KIND_UINT64 }
+  { "time_rexmit", DDS_STAT_KIND_UINT64 },
+  { "serdata_cache_hits", DDS_STAT_KIND_UINT64 },
+  { "whc_bytes_per_sample", DDS_STAT_KIND_UINT64 }
 };
 
 static const struct dds_stat_descriptor dds_writer_statistics_desc = {
@@ -269,6 +275,14 @@ static void dds_writer_refresh_statistics (const struct dds_entity *entity, stru
   const struct dds_writer *wr = (const struct dds_writer *) entity;
   if (wr->m_wr)
     ddsi_get_writer_stats (wr->m_wr, &stat->kv[0].u.u64, &stat->kv[1].u.u32, &stat->kv[2].u.u64, &stat->kv[3].u.u64);
+  if (wr->m_serdata_cache)
+    stat->kv[4].u.u64 = ddsi_serdata_default_cache_hits (wr->m_serdata_cache);
+  if (wr->m_whc)
+  {
+    struct whc_memory_stats st;
+    whc_get_memory_stats (wr->m_whc, &st);
+    stat->kv[5].u.u64 = (st.nsamples > 0) ? st.bytes / st.nsamples : 0;
+  }
 }
 
 const struct dds_entity_deriver dds_entity_deriver_writer = {
@@ -281,6 +295,31 @@ const struct dds_entity_deriver dds_entity_deriver_writer = {
   .refresh_statistics = dds_writer_refresh_statistics
 };
 
+static struct ddsi_serdata_default_cache *dds_writer_new_serdata_cache (const dds_qos_t *qos, const struct ddsi_sertype *type)
+{
+  /* Only for the default serialization, the cache relies on its representation */
+  const char *value;
+  long long v;
+  char *endp;
+  if (type->serdata_ops != &ddsi_serdata_ops_cdr && type->serdata_ops != &ddsi_serdata_ops_cdr_nokey)
+    return NULL;
+  if (!ddsi_xqos_find_prop (qos, DDS_WRITER_SERDATA_CACHE_PROPERTY, &value))
+    return NULL;
+  if (ddsrt_strtoll (value, &endp, 10, &v) != DDS_RETCODE_OK || *endp != 0 || v <= 0)
+    return NULL;
+  return ddsi_serdata_default_cache_new ((v > DDS_WRITER_SERDATA_CACHE_MAX_SLOTS) ? DDS_WRITER_SERDATA_CACHE_MAX_SLOTS : (uint32_t) v);
+}
+
+static struct whc *dds_writer_new_whc (struct ddsi_domaingv *gv, const dds_qos_t *qos, const struct whc_writer_info *wrinfo)
+{
+  /* The compact WHC doesn't do deadline and lifespan, for those it silently falls back to the default */
+  const char *value;
+  if (ddsi_xqos_find_prop (qos, DDS_WRITER_WHC_COMPACT_PROPERTY, &value) && strcmp (value, "true") == 0 &&
+      (!(qos->present & QP_LIFESPAN) || qos->lifespan.duration == DDS_INFINITY) && whc_compact_supported (wrinfo))
+    return whc_compact_new (gv, wrinfo);
+  return whc_new (gv, wrinfo);
+}
+
 #ifdef DDS_HAS_SHM
 #define DDS_WRITER_QOS_CHECK_FIELDS (QP_LIVELINESS|QP_DEADLINE|QP_RELIABILITY|QP_DURABILITY|QP_HISTORY)
 static bool dds_writer_support_shm(const struct ddsi_config* cfg, const dds_qos_t* qos, const struct dds_topic *tp)
@@ -402,9 +441,10 @@ dds_entity_t dds_create_writer (dds_entity_t participant_or_publisher, dds_entit
   dds_entity_add_ref_locked (&tp->m_entity);
   wr->m_xp = nn_xpack_new (gv, get_bandwidth_limit (wqos->transport_priority), async_mode);
   wrinfo = whc_make_wrinfo (wr, wqos);
-  wr->m_whc = whc_new (gv, wrinfo);
+  wr->m_whc = dds_writer_new_whc (gv, wqos, wrinfo);
   whc_free_wrinfo (wrinfo);
   wr->whc_batch = gv->config.whc_batch;
+  wr->m_serdata_cache = dds_writer_new_serdata_cache (wqos, tp->m_stype);
 
 #ifdef DDS_HAS_SHM
   assert(wqos->present & QP_LOCATOR_MASK);
@@ -0,0 +1,407 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <assert.h>
+#include <string.h>
+
+#include "dds/dds.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/random.h"
+#include "dds/ddsrt/string.h"
+#include "dds/ddsi/ddsi_cdrstream.h"
+#include "CdrStreamTypes.h"
+
+#include "test_common.h"
+
+#define N_SAMPLES 200
+
+/* Storage for the strings and sequences referenced by a randomly generated sample */
+struct sample_storage {
+  char str[2][16];
+  uint8_t os[16];
+  int16_t ss[16];
+  int64_t lls[16];
+  double bds[4];
+};
+
+typedef void (*fill_sample_t) (void *sample, struct sample_storage *stor, ddsrt_prng_t *prng);
+
+/* Same as dds_create_topic, but without the memcpy-based marshalling and with the native
+   (de)serializers only if requested, so that the native (de)serializers and the interpreter
+   can be compared */
+static void sertype_init (struct ddsi_sertype_default *st, const dds_topic_descriptor_t *desc, bool native)
+{
+  memset (st, 0, sizeof (*st));
+  st->type.size = desc->m_size;
+  st->type.align = desc->m_align;
+  st->type.flagset = desc->m_flagset & ~(uint32_t) DDS_TOPIC_NATIVE_OPS;
+  st->type.keys.nkeys = desc->m_nkeys;
+  st->type.keys.keys = ddsrt_malloc (desc->m_nkeys * sizeof (*st->type.keys.keys));
+  for (uint32_t i = 0; i < desc->m_nkeys; i++)
+    st->type.keys.keys[i] = desc->m_keys[i].m_index;
+  st->type.ops.nops = dds_stream_countops (desc->m_ops);
+  st->type.ops.ops = ddsrt_memdup (desc->m_ops, st->type.ops.nops * sizeof (*st->type.ops.ops));
+  st->opt_size = 0;
+  st->copy_plan = NULL;
+  st->native_ops = native ? desc->m_native_ops : NULL;
+}
+
+/* Same, but with the copy plan that dds_create_topic would use for fixed-size types */
+static void sertype_init_copy_plan (struct ddsi_sertype_default *st, const dds_topic_descriptor_t *desc)
+{
+  sertype_init (st, desc, false);
+  st->copy_plan = dds_stream_make_copy_plan (&st->type);
+}
+
+static void sertype_fini (struct ddsi_sertype_default *st)
+{
+  ddsrt_free (st->copy_plan);
+  ddsrt_free (st->type.keys.keys);
+  ddsrt_free (st->type.ops.ops);
+}
+
+static uint32_t random_below (ddsrt_prng_t *prng, uint32_t n)
+{
+  return ddsrt_prng_random (prng) % n;
+}
+
+static char *random_string (ddsrt_prng_t *prng, char *buf, uint32_t maxlen)
+{
+  const uint32_t n = random_below (prng, maxlen + 1);
+  for (uint32_t i = 0; i < n; i++)
+    buf[i] = (char) ('a' + random_below (prng, 26));
+  buf[n] = 0;
+  return buf;
+}
+
+static void fill_keyed (void *sample, struct sample_storage *stor, ddsrt_prng_t *prng)
+{
+  CdrStreamTypes_Keyed *s = sample;
+  s->id = (int32_t) ddsrt_prng_random (prng);
+  s->name = random_string (prng, stor->str[0], sizeof (stor->str[0]) - 1);
+  s->s = (int16_t) ddsrt_prng_random (prng);
+  s->d = (double) ddsrt_prng_random (prng) / 3.0;
+  (void) random_string (prng, s->label, sizeof (s->label) - 1);
+  for (uint32_t i = 0; i < sizeof (s->tag); i++)
+    s->tag[i] = (char) ddsrt_prng_random (prng);
+}
+
+static void fill_keylist_order (void *sample, struct sample_storage *stor, ddsrt_prng_t *prng)
+{
+  CdrStreamTypes_KeylistOrder *s = sample;
+  s->o = (uint8_t) ddsrt_prng_random (prng);
+  s->ll = (int64_t) (((uint64_t) ddsrt_prng_random (prng) << 32) | ddsrt_prng_random (prng));
+  s->str = random_string (prng, stor->str[0], sizeof (stor->str[0]) - 1);
+  s->sh = (int16_t) ddsrt_prng_random (prng);
+}
+
+static void fill_inner (CdrStreamTypes_Inner *s, char *strbuf, ddsrt_prng_t *prng)
+{
+  s->o = (uint8_t) ddsrt_prng_random (prng);
+  s->ll = (int64_t) (((uint64_t) ddsrt_prng_random (prng) << 32) | ddsrt_prng_random (prng));
+  s->str = random_string (prng, strbuf, 15);
+}
+
+static void fill_nested (void *sample, struct sample_storage *stor, ddsrt_prng_t *prng)
+{
+  CdrStreamTypes_Nested *s = sample;
+  s->c = (char) ddsrt_prng_random (prng);
+  fill_inner (&s->in, stor->str[0], prng);
+  fill_inner (&s->in2, stor->str[1], prng);
+  s->s = (int16_t) ddsrt_prng_random (prng);
+}
+
+static void fill_sequences (void *sample, struct sample_storage *stor, ddsrt_prng_t *prng)
+{
+  CdrStreamTypes_Sequences *s = sample;
+  s->os._length = s->os._maximum = random_below (prng, 17);
+  s->os._buffer = stor->os;
+  for (uint32_t i = 0; i < s->os._length; i++)
+    stor->os[i] = (uint8_t) ddsrt_prng_random (prng);
+  s->ss._length = s->ss._maximum = random_below (prng, 17);
+  s->ss._buffer = stor->ss;
+  for (uint32_t i = 0; i < s->ss._length; i++)
+    stor->ss[i] = (int16_t) ddsrt_prng_random (prng);
+  s->lls._length = s->lls._maximum = random_below (prng, 17);
+  s->lls._buffer = stor->lls;
+  for (uint32_t i = 0; i < s->lls._length; i++)
+    stor->lls[i] = (int64_t) (((uint64_t) ddsrt_prng_random (prng) << 32) | ddsrt_prng_random (prng));
+  s->bds._length = s->bds._maximum = random_below (prng, 5);
+  s->bds._buffer = stor->bds;
+  for (uint32_t i = 0; i < s->bds._length; i++)
+    stor->bds[i] = (double) ddsrt_prng_random (prng) / 7.0;
+  s->b = (random_below (prng, 2) != 0);
+}
+
+static void write_sample (dds_ostream_t *os, uint32_t prefix, const void *sample, const struct ddsi_sertype_default *st)
+{
+  /* garbage in the buffer, so that padding that isn't cleared shows up */
+  dds_ostream_init (os, 256);
+  memset (os->m_buffer, 0xee, os->m_size);
+  for (uint32_t i = 0; i < prefix; i++)
+    dds_os_put1 (os, 0xff);
+  dds_stream_write_sample (os, sample, st);
+}
+
+static void check_same_output (const dds_ostream_t *a, const dds_ostream_t *b)
+{
+  CU_ASSERT_EQUAL_FATAL (a->m_index, b->m_index);
+  CU_ASSERT_FATAL (a->m_index == 0 || memcmp (a->m_buffer, b->m_buffer, a->m_index) == 0);
+}
+
+static void check_normalize (const struct ddsi_sertype_default *st, const struct ddsi_sertype_default *st_int, const unsigned char *data, uint32_t size)
+{
+  /* every truncation and both byte orders: both must accept or reject it, and they must
+     leave the same result behind if they accept it */
+  char *a = ddsrt_malloc (size + 1), *b = ddsrt_malloc (size + 1);
+  for (uint32_t sz = 0; sz <= size; sz++)
+  {
+    for (int bswap = 0; bswap <= 1; bswap++)
+    {
+      memcpy (a, data, sz);
+      memcpy (b, data, sz);
+      const bool ra = dds_stream_normalize (a, sz, bswap, st, false);
+      const bool rb = dds_stream_normalize (b, sz, bswap, st_int, false);
+      CU_ASSERT_EQUAL_FATAL (ra, rb);
+      if (ra)
+        CU_ASSERT_FATAL (memcmp (a, b, sz) == 0);
+      if (sz == size && !bswap)
+        CU_ASSERT_FATAL (ra);
+    }
+  }
+  ddsrt_free (a);
+  ddsrt_free (b);
+}
+
+static void check_read (const struct ddsi_sertype_default *st, const struct ddsi_sertype_default *st_int, void *rd_sample, const dds_ostream_t *os)
+{
+  /* reading into a sample previously read covers reuse of strings and sequences */
+  dds_istream_t is = { .m_buffer = os->m_buffer, .m_size = os->m_index, .m_index = 0 };
+  dds_stream_read_sample (&is, rd_sample, st);
+  CU_ASSERT_EQUAL_FATAL (is.m_index, os->m_index);
+  dds_ostream_t os1;
+  write_sample (&os1, 0, rd_sample, st_int);
+  check_same_output (&os1, os);
+  dds_ostream_fini (&os1);
+}
+
+static void check_keys (const struct ddsi_sertype_default *st_nat, const struct ddsi_sertype_default *st_int, const void *sample, const dds_ostream_t *os)
+{
+  dds_ostreamBE_t kn, ki;
+  dds_ostreamBE_init (&kn, 0);
+  dds_ostreamBE_init (&ki, 0);
+  dds_stream_write_keyBE (&kn, sample, st_nat);
+  dds_stream_write_keyBE (&ki, sample, st_int);
+  check_same_output (&kn.x, &ki.x);
+  dds_ostreamBE_fini (&kn);
+  dds_ostreamBE_fini (&ki);
+
+  dds_ostreamBE_init (&kn, 0);
+  dds_ostreamBE_init (&ki, 0);
+  dds_istream_t is = { .m_buffer = os->m_buffer, .m_size = os->m_index, .m_index = 0 };
+  dds_stream_extract_keyBE_from_data (&is, &kn, st_nat);
+  is.m_index = 0;
+  dds_stream_extract_keyBE_from_data (&is, &ki, st_int);
+  check_same_output (&kn.x, &ki.x);
+  dds_ostreamBE_fini (&kn);
+  dds_ostreamBE_fini (&ki);
+}
+
+static void check_native_vs_interpreter (const dds_topic_descriptor_t *desc, fill_sample_t fill)
+{
+  CU_ASSERT_FATAL (desc->m_flagset & DDS_TOPIC_NATIVE_OPS);
+  CU_ASSERT_FATAL (desc->m_native_ops != NULL);
+  struct ddsi_sertype_default st_nat, st_int;
+  sertype_init (&st_nat, desc, true);
+  sertype_init (&st_int, desc, false);
+
+  ddsrt_prng_t prng;
+  ddsrt_prng_init_simple (&prng, 1);
+  void *sample = ddsrt_malloc (desc->m_size);
+  void *rd_nat = ddsrt_calloc (1, desc->m_size);
+  void *rd_int = ddsrt_calloc (1, desc->m_size);
+  for (uint32_t i = 0; i < N_SAMPLES; i++)
+  {
+    struct sample_storage stor;
+    memset (sample, 0, desc->m_size);
+    fill (sample, &stor, &prng);
+
+    /* CDR alignment is relative to the start of the stream, so also check that the
+       native serializers align the same way when starting at an arbitrary offset */
+    const uint32_t prefix = i % 8;
+    dds_ostream_t os_nat, os_int;
+    write_sample (&os_nat, prefix, sample, &st_nat);
+    write_sample (&os_int, prefix, sample, &st_int);
+    check_same_output (&os_nat, &os_int);
+    dds_ostream_fini (&os_nat);
+    dds_ostream_fini (&os_int);
+
+    write_sample (&os_nat, 0, sample, &st_nat);
+    write_sample (&os_int, 0, sample, &st_int);
+    check_same_output (&os_nat, &os_int);
+    check_normalize (&st_nat, &st_int, os_int.m_buffer, os_int.m_index);
+    check_read (&st_nat, &st_int, rd_nat, &os_int);
+    check_read (&st_int, &st_int, rd_int, &os_int);
+    check_keys (&st_nat, &st_int, sample, &os_int);
+    dds_ostream_fini (&os_nat);
+    dds_ostream_fini (&os_int);
+  }
+  dds_stream_free_sample (rd_nat, desc->m_ops);
+  dds_stream_free_sample (rd_int, desc->m_ops);
+  ddsrt_free (rd_nat);
+  ddsrt_free (rd_int);
+  ddsrt_free (sample);
+  sertype_fini (&st_nat);
+  sertype_fini (&st_int);
+}
+
+CU_Test (ddsc_cdrstream, native_keyed)
+{
+  check_native_vs_interpreter (&CdrStreamTypes_Keyed_desc, fill_keyed);
+}
+
+CU_Test (ddsc_cdrstream, native_keylist_order)
+{
+  check_native_vs_interpreter (&CdrStreamTypes_KeylistOrder_desc, fill_keylist_order);
+}
+
+CU_Test (ddsc_cdrstream, native_nested)
+{
+  check_native_vs_interpreter (&CdrStreamTypes_Nested_desc, fill_nested);
+}
+
+CU_Test (ddsc_cdrstream, native_sequences)
+{
+  check_native_vs_interpreter (&CdrStreamTypes_Sequences_desc, fill_sequences);
+}
+
+CU_Test (ddsc_cdrstream, native_unsupported)
+{
+  /* types the native serializers don't handle are left to the interpreter */
+  CU_ASSERT_FATAL (!(CdrStreamTypes_StringSequence_desc.m_flagset & DDS_TOPIC_NATIVE_OPS));
+}
+
+CU_Test (ddsc_cdrstream, native_write_read)
+{
+  /* end-to-end through a writer and a reader using the native serializers */
+  char name[100];
+  create_unique_topic_name ("ddsc_cdrstream", name, sizeof name);
+  const dds_entity_t pp = dds_create_participant (DDS_DOMAIN_DEFAULT, NULL, NULL);
+  CU_ASSERT_FATAL (pp > 0);
+  const dds_entity_t tp = dds_create_topic (pp, &CdrStreamTypes_Nested_desc, name, NULL, NULL);
+  CU_ASSERT_FATAL (tp > 0);
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  const dds_entity_t rd = dds_create_reader (pp, tp, qos, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  const dds_entity_t wr = dds_create_writer (pp, tp, qos, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  dds_delete_qos (qos);
+
+  CdrStreamTypes_Nested s = { .c = 'x', .in = { 1, -2, "three" }, .in2 = { 4, 5, "" }, .s = -6 };
+  dds_return_t rc = dds_write (wr, &s);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  dds_instance_handle_t ih = dds_lookup_instance (rd, &s);
+  CU_ASSERT_FATAL (ih != DDS_HANDLE_NIL);
+
+  void *raw = NULL;
+  dds_sample_info_t si;
+  rc = dds_take (rd, &raw, &si, 1, 1);
+  CU_ASSERT_FATAL (rc == 1);
+  const CdrStreamTypes_Nested *r = raw;
+  CU_ASSERT_FATAL (si.instance_handle == ih);
+  CU_ASSERT_FATAL (r->c == s.c && r->s == s.s);
+  CU_ASSERT_FATAL (r->in.o == s.in.o && r->in.ll == s.in.ll && strcmp (r->in.str, s.in.str) == 0);
+  CU_ASSERT_FATAL (r->in2.o == s.in2.o && r->in2.ll == s.in2.ll && strcmp (r->in2.str, s.in2.str) == 0);
+  rc = dds_return_loan (rd, &raw, 1);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+
+  rc = dds_delete (pp);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+}
+
+static void fill_random_bytes (void *sample, struct sample_storage *stor, ddsrt_prng_t *prng)
+{
+  /* random bytes in the padding of the sample as well, those must not end up in the CDR */
+  (void) stor;
+  unsigned char *p = sample;
+  for (uint32_t i = 0; i < CdrStreamTypes_PlanNested_desc.m_size; i++)
+    p[i] = (unsigned char) ddsrt_prng_random (prng);
+}
+
+CU_Test (ddsc_cdrstream, copy_plan_nested)
+{
+  const dds_topic_descriptor_t *desc = &CdrStreamTypes_PlanNested_desc;
+  struct ddsi_sertype_default st_plan, st_int;
+  sertype_init_copy_plan (&st_plan, desc);
+  sertype_init (&st_int, desc, false);
+  CU_ASSERT_FATAL (st_plan.copy_plan != NULL);
+  assert (st_plan.copy_plan != NULL); /* for Clang's static analyzer */
+  CU_ASSERT_FATAL (st_int.copy_plan == NULL);
+  /* the padding following the nested structs makes CDR smaller than the sample */
+  CU_ASSERT_FATAL (st_plan.copy_plan->cdr_size < desc->m_size);
+  CU_ASSERT_FATAL (st_plan.copy_plan->nruns > 1);
+
+  ddsrt_prng_t prng;
+  ddsrt_prng_init_simple (&prng, 1);
+  CdrStreamTypes_PlanNested sample, rd_plan, rd_int;
+  for (uint32_t i = 0; i < N_SAMPLES; i++)
+  {
+    fill_random_bytes (&sample, NULL, &prng);
+
+    /* at an offset that is not a multiple of the plan's alignment, the interpreter is
+       used instead; either way the output must be the same */
+    const uint32_t prefix = i % 8;
+    dds_ostream_t os_plan, os_int;
+    write_sample (&os_plan, prefix, &sample, &st_plan);
+    write_sample (&os_int, prefix, &sample, &st_int);
+    check_same_output (&os_plan, &os_int);
+    memset (&rd_plan, 0, sizeof (rd_plan));
+    memset (&rd_int, 0, sizeof (rd_int));
+    dds_istream_t is = { .m_buffer = os_int.m_buffer, .m_size = os_int.m_index, .m_index = prefix };
+    dds_stream_read_sample (&is, &rd_plan, &st_plan);
+    CU_ASSERT_EQUAL_FATAL (is.m_index, os_int.m_index);
+    is.m_index = prefix;
+    dds_stream_read_sample (&is, &rd_int, &st_int);
+    CU_ASSERT_FATAL (memcmp (&rd_plan, &rd_int, sizeof (rd_plan)) == 0);
+    dds_ostream_fini (&os_plan);
+    dds_ostream_fini (&os_int);
+
+    write_sample (&os_plan, 0, &sample, &st_plan);
+    write_sample (&os_int, 0, &sample, &st_int);
+    CU_ASSERT_EQUAL_FATAL (os_plan.m_index, st_plan.copy_plan->cdr_size);
+    check_same_output (&os_plan, &os_int);
+    check_normalize (&st_plan, &st_int, os_int.m_buffer, os_int.m_index);
+    check_read (&st_plan, &st_int, &rd_plan, &os_int);
+    dds_ostream_fini (&os_plan);
+    dds_ostream_fini (&os_int);
+  }
+  sertype_fini (&st_plan);
+  sertype_fini (&st_int);
+}
+
+CU_Test (ddsc_cdrstream, copy_plan_unsupported)
+{
+  /* strings, sequences and too many runs: no copy plan, so the interpreter is used */
+  const dds_topic_descriptor_t *descs[] = {
+    &CdrStreamTypes_Keyed_desc,
+    &CdrStreamTypes_Sequences_desc,
+    &CdrStreamTypes_PlanManyRuns_desc
+  };
+  for (size_t i = 0; i < sizeof (descs) / sizeof (descs[0]); i++)
+  {
+    struct ddsi_sertype_default st;
+    sertype_init_copy_plan (&st, descs[i]);
+    CU_ASSERT_FATAL (st.copy_plan == NULL);
+    sertype_fini (&st);
+  }
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <string.h>
+#include "dds/dds.h"
+#include "test_common.h"
+
+static dds_entity_t participant, topic, reader, writer;
+
+static void create_entities (const dds_topic_descriptor_t *desc)
+{
+  char topicname[100];
+  dds_qos_t *qos;
+
+  create_unique_topic_name ("ddsc_cdrview_test", topicname, sizeof topicname);
+  participant = dds_create_participant (DDS_DOMAIN_DEFAULT, NULL, NULL);
+  CU_ASSERT_FATAL (participant > 0);
+  qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  topic = dds_create_topic (participant, desc, topicname, qos, NULL);
+  CU_ASSERT_FATAL (topic > 0);
+  writer = dds_create_writer (participant, topic, qos, NULL);
+  CU_ASSERT_FATAL (writer > 0);
+  reader = dds_create_reader (participant, topic, qos, NULL);
+  CU_ASSERT_FATAL (reader > 0);
+  dds_delete_qos (qos);
+}
+
+static void create_entities_datatype (void)
+{
+  create_entities (&RoundTripModule_DataType_desc);
+}
+
+static void create_entities_address (void)
+{
+  create_entities (&RoundTripModule_Address_desc);
+}
+
+static void delete_entities (void)
+{
+  dds_return_t result = dds_delete (participant);
+  CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+}
+
+CU_Test (ddsc_cdrview, bad_params, .init = create_entities_datatype, .fini = delete_entities)
+{
+  const dds_cdr_view_t *views[1];
+  dds_sample_info_t si[1];
+  dds_return_t result;
+
+  result = dds_take_cdrview (reader, NULL, si, 1, 0);
+  CU_ASSERT (result == DDS_RETCODE_BAD_PARAMETER);
+  result = dds_take_cdrview (reader, views, NULL, 1, 0);
+  CU_ASSERT (result == DDS_RETCODE_BAD_PARAMETER);
+  result = dds_take_cdrview (reader, views, si, 0, 0);
+  CU_ASSERT (result == DDS_RETCODE_BAD_PARAMETER);
+  result = dds_take_cdrview (writer, views, si, 1, 0);
+  CU_ASSERT (result == DDS_RETCODE_ILLEGAL_OPERATION);
+  result = dds_take_cdrview (reader, views, si, 1, 0);
+  CU_ASSERT (result == 0);
+
+  const void *ptr;
+  uint32_t count;
+  result = dds_cdr_view_get_prim (NULL, 0, 1, &ptr, &count);
+  CU_ASSERT (result == DDS_RETCODE_BAD_PARAMETER);
+}
+
+CU_Test (ddsc_cdrview, sequence, .init = create_entities_datatype, .fini = delete_entities)
+{
+  unsigned char payload[1000];
+  for (size_t i = 0; i < sizeof (payload); i++)
+    payload[i] = (unsigned char) i;
+  const RoundTripModule_DataType s = {
+    .payload = { ._length = sizeof (payload), ._maximum = sizeof (payload), ._buffer = payload, ._release = false }
+  };
+  dds_return_t result = dds_write (writer, &s);
+  CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+
+  const dds_cdr_view_t *views[2];
+  dds_sample_info_t si[2];
+  int32_t n = dds_read_cdrview (reader, views, si, 2, 0);
+  CU_ASSERT_FATAL (n == 1);
+  CU_ASSERT_FATAL (si[0].valid_data);
+  CU_ASSERT_FATAL (views[0]->data != NULL);
+
+  const void *ptr;
+  uint32_t count;
+  result = dds_cdr_view_get_prim (views[0], offsetof (RoundTripModule_DataType, payload), 1, &ptr, &count);
+  CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+  CU_ASSERT (count == sizeof (payload));
+  CU_ASSERT (memcmp (ptr, payload, sizeof (payload)) == 0);
+  /* points into the serialized data */
+  CU_ASSERT ((const char *) ptr > (const char *) views[0]->data);
+  CU_ASSERT ((const char *) ptr + count <= (const char *) views[0]->data + views[0]->size);
+
+  /* wrong element size, wrong type, non-existent member */
+  result = dds_cdr_view_get_prim (views[0], offsetof (RoundTripModule_DataType, payload), 4, &ptr, &count);
+  CU_ASSERT (result == DDS_RETCODE_BAD_PARAMETER);
+  const char *str;
+  result = dds_cdr_view_get_string (views[0], offsetof (RoundTripModule_DataType, payload), &str, &count);
+  CU_ASSERT (result == DDS_RETCODE_BAD_PARAMETER);
+  result = dds_cdr_view_get_prim (views[0], 1, 1, &ptr, &count);
+  CU_ASSERT (result == DDS_RETCODE_BAD_PARAMETER);
+
+  /* read doesn't remove it, the loan must be returned exactly once */
+  result = dds_return_loan (reader, (void **) views, n);
+  CU_ASSERT (result == DDS_RETCODE_OK);
+  CU_ASSERT (views[0] == NULL);
+  n = dds_take_cdrview (reader, views, si, 2, 0);
+  CU_ASSERT_FATAL (n == 1);
+  result = dds_return_loan (reader, (void **) views, n);
+  CU_ASSERT (result == DDS_RETCODE_OK);
+  n = dds_take_cdrview (reader, views, si, 2, 0);
+  CU_ASSERT (n == 0);
+}
+
+CU_Test (ddsc_cdrview, string_and_prim, .init = create_entities_address, .fini = delete_entities)
+{
+  char ip[] = "127.0.0.1";
+  RoundTripModule_Address s = { .ip = ip, .port = 7400 };
+  dds_return_t result = dds_write (writer, &s);
+  CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+
+  const dds_cdr_view_t *views[2];
+  dds_sample_info_t si[2];
+  int32_t n = dds_take_cdrview (reader, views, si, 2, 0);
+  CU_ASSERT_FATAL (n == 1);
+  CU_ASSERT_FATAL (si[0].valid_data);
+
+  const char *str;
+  uint32_t len;
+  result = dds_cdr_view_get_string (views[0], offsetof (RoundTripModule_Address, ip), &str, &len);
+  CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+  CU_ASSERT (len == strlen (ip));
+  CU_ASSERT (strcmp (str, ip) == 0);
+
+  const void *ptr;
+  uint32_t count;
+  result = dds_cdr_view_get_prim (views[0], offsetof (RoundTripModule_Address, port), sizeof (int32_t), &ptr, &count);
+  CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+  CU_ASSERT (count == 1);
+  CU_ASSERT (*(const int32_t *) ptr == 7400);
+
+  result = dds_return_loan (reader, (void **) views, n);
+  CU_ASSERT (result == DDS_RETCODE_OK);
+
+  /* invalid samples have no data */
+  result = dds_dispose (writer, &s);
+  CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+  n = dds_take_cdrview (reader, views, si, 2, 0);
+  CU_ASSERT_FATAL (n == 1);
+  CU_ASSERT_FATAL (!si[0].valid_data);
+  CU_ASSERT (views[0]->data == NULL);
+  result = dds_cdr_view_get_string (views[0], offsetof (RoundTripModule_Address, ip), &str, &len);
+  CU_ASSERT (result == DDS_RETCODE_PRECONDITION_NOT_MET);
+  result = dds_return_loan (reader, (void **) views, n);
+  CU_ASSERT (result == DDS_RETCODE_OK);
+}
+
+CU_Test (ddsc_cdrview, delete_with_loan, .init = create_entities_datatype, .fini = delete_entities)
+{
+  const RoundTripModule_DataType s = { .payload = { ._length = 0, ._maximum = 0, ._buffer = NULL, ._release = false } };
+  dds_return_t result = dds_write (writer, &s);
+  CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+
+  /* outstanding loans are released when the reader is deleted */
+  const dds_cdr_view_t *views[1];
+  dds_sample_info_t si[1];
+  int32_t n = dds_take_cdrview (reader, views, si, 1, 0);
+  CU_ASSERT_FATAL (n == 1);
+  const void *ptr;
+  uint32_t count;
+  result = dds_cdr_view_get_prim (views[0], offsetof (RoundTripModule_DataType, payload), 1, &ptr, &count);
+  CU_ASSERT (result == DDS_RETCODE_OK);
+  CU_ASSERT (count == 0);
+  result = dds_delete (reader);
+  CU_ASSERT (result == DDS_RETCODE_OK);
+}
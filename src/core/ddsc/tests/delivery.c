@@ -0,0 +1,455 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include "dds/dds.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/io.h"
+#include "dds/ddsrt/environ.h"
+#include "dds/ddsc/dds_statistics.h"
+
+#include "test_common.h"
+
+/* Samples published in one domain and received in another go through the
+   receive threads and the delivery queues, which is what these tests are
+   about.  The two domains use a different domain id, but ExternalDomainId
+   maps both to the same port numbers.  By default, data of writers with the
+   default QoS is delivered synchronously by the receive thread, raising the
+   priority threshold makes it go through the delivery queues. */
+#define DDS_DOMAINID_PUB 0
+#define DDS_DOMAINID_SUB 1
+#define DDS_CONFIG_NO_PORT_GAIN "${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}<Discovery><ExternalDomainId>0</ExternalDomainId></Discovery>"
+
+#define NINSTANCES 10
+#define NSAMPLES 10000
+#define MAX_WRITERS 2
+
+static dds_entity_t g_domain = 0;
+static dds_entity_t g_participant = 0;
+static dds_entity_t g_remote_domain = 0;
+static dds_entity_t g_remote_participant = 0;
+static dds_entity_t g_topic = 0;
+static dds_entity_t g_remote_topic = 0;
+
+static void delivery_init_common (const char *internal)
+{
+  char name[100];
+  char *conf_fmt, *conf_pub, *conf_sub;
+  ddsrt_asprintf (&conf_fmt, "%s<Internal><SynchronousDeliveryPriorityThreshold>1</SynchronousDeliveryPriorityThreshold>%s</Internal>", DDS_CONFIG_NO_PORT_GAIN, internal);
+  conf_pub = ddsrt_expand_envvars (conf_fmt, DDS_DOMAINID_PUB);
+  conf_sub = ddsrt_expand_envvars (conf_fmt, DDS_DOMAINID_SUB);
+  g_domain = dds_create_domain (DDS_DOMAINID_PUB, conf_pub);
+  CU_ASSERT_FATAL (g_domain > 0);
+  g_remote_domain = dds_create_domain (DDS_DOMAINID_SUB, conf_sub);
+  CU_ASSERT_FATAL (g_remote_domain > 0);
+  ddsrt_free (conf_fmt);
+  dds_free (conf_pub);
+  dds_free (conf_sub);
+
+  g_participant = dds_create_participant (DDS_DOMAINID_PUB, NULL, NULL);
+  CU_ASSERT_FATAL (g_participant > 0);
+  g_remote_participant = dds_create_participant (DDS_DOMAINID_SUB, NULL, NULL);
+  CU_ASSERT_FATAL (g_remote_participant > 0);
+
+  create_unique_topic_name ("ddsc_delivery_test", name, sizeof name);
+  g_topic = dds_create_topic (g_participant, &Space_Type1_desc, name, NULL, NULL);
+  CU_ASSERT_FATAL (g_topic > 0);
+  g_remote_topic = dds_create_topic (g_remote_participant, &Space_Type1_desc, name, NULL, NULL);
+  CU_ASSERT_FATAL (g_remote_topic > 0);
+}
+
+static void delivery_init_default (void)
+{
+  delivery_init_common ("");
+}
+
+static void delivery_init_lockfree (void)
+{
+  delivery_init_common ("<DeliveryQueueLockFree>true</DeliveryQueueLockFree>");
+}
+
+static void delivery_init_pool (void)
+{
+  delivery_init_common ("<DeliveryThreads>4</DeliveryThreads>");
+}
+
+static void delivery_init_pool_lateack (void)
+{
+  delivery_init_common ("<DeliveryThreads>4</DeliveryThreads><LateAckMode>true</LateAckMode>");
+}
+
+static void delivery_fini (void)
+{
+  dds_delete (g_domain);
+  dds_delete (g_remote_domain);
+}
+
+static dds_qos_t *create_reliable_qos (void)
+{
+  dds_qos_t *qos = dds_create_qos ();
+  CU_ASSERT_FATAL (qos != NULL);
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  return qos;
+}
+
+/* A reader starts out of sync with a writer, with data taking a different path
+   that acknowledges it on receipt, until a heartbeat brings it in sync.  Writing
+   a first sample (of "writer" 1) and waiting for it to be acknowledged forces
+   that transition.  A sample arriving during the transition may get delivered
+   along both paths, so whatever arrived is discarded. */
+static void bring_in_sync (const dds_entity_t *readers, int nreaders, dds_entity_t writer)
+{
+  Space_Type1 sample = { .long_1 = 0, .long_2 = 0, .long_3 = 1 };
+  dds_return_t ret = dds_write (writer, &sample);
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+  ret = dds_wait_for_acks (writer, DDS_SECS (10));
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+  for (int i = 0; i < nreaders; i++)
+  {
+    Space_Type1 data;
+    void *ptr = &data;
+    dds_sample_info_t si;
+    const dds_time_t tend = dds_time () + DDS_SECS (10);
+    int32_t n;
+    while ((n = dds_take (readers[i], &ptr, &si, 1, 1)) == 0 && dds_time () < tend)
+      dds_sleepfor (DDS_MSECS (1));
+    CU_ASSERT_FATAL (n == 1);
+  }
+  dds_sleepfor (DDS_MSECS (100));
+  for (int i = 0; i < nreaders; i++)
+  {
+    Space_Type1 data;
+    void *ptr = &data;
+    dds_sample_info_t si;
+    while (dds_take (readers[i], &ptr, &si, 1, 1) > 0)
+      ;
+  }
+}
+
+static void create_reader_writer_qos (dds_entity_t *reader, dds_entity_t *writer, const dds_qos_t *qos)
+{
+  *reader = dds_create_reader (g_remote_participant, g_remote_topic, qos, NULL);
+  CU_ASSERT_FATAL (*reader > 0);
+  *writer = dds_create_writer (g_participant, g_topic, qos, NULL);
+  CU_ASSERT_FATAL (*writer > 0);
+  sync_reader_writer (g_remote_participant, *reader, g_participant, *writer);
+  bring_in_sync (reader, 1, *writer);
+}
+
+static void create_reader_writer (dds_entity_t *reader, dds_entity_t *writer)
+{
+  dds_qos_t *qos = create_reliable_qos ();
+  create_reader_writer_qos (reader, writer, qos);
+  dds_delete_qos (qos);
+}
+
+/* Takes all samples, checking that the samples of each instance arrive in the
+   order in which each writer wrote them and without gaps; long_3 identifies
+   the writer.  Returns once "nsamples" have been received. */
+static void take_in_order (dds_entity_t reader, int32_t nsamples)
+{
+  int32_t next[MAX_WRITERS][NINSTANCES] = { { 0 } };
+  int32_t received = 0;
+  const dds_time_t tend = dds_time () + DDS_SECS (10);
+  while (received < nsamples && dds_time () < tend)
+  {
+    Space_Type1 data[64];
+    void *ptrs[64];
+    dds_sample_info_t si[64];
+    for (size_t i = 0; i < 64; i++)
+      ptrs[i] = &data[i];
+    const int32_t n = dds_take (reader, ptrs, si, 64, 64);
+    CU_ASSERT_FATAL (n >= 0);
+    if (n == 0)
+    {
+      dds_sleepfor (DDS_MSECS (1));
+      continue;
+    }
+    for (int32_t i = 0; i < n; i++)
+    {
+      CU_ASSERT_FATAL (si[i].valid_data);
+      CU_ASSERT_FATAL (data[i].long_1 >= 0 && data[i].long_1 < NINSTANCES);
+      CU_ASSERT_FATAL (data[i].long_3 >= 0 && data[i].long_3 < MAX_WRITERS);
+      CU_ASSERT_EQUAL_FATAL (data[i].long_2, next[data[i].long_3][data[i].long_1]);
+      next[data[i].long_3][data[i].long_1]++;
+    }
+    received += n;
+  }
+  CU_ASSERT_EQUAL_FATAL (received, nsamples);
+}
+
+static void write_samples (dds_entity_t writer, int32_t wrid, int32_t nsamples)
+{
+  for (int32_t s = 0; s < nsamples; s++)
+  {
+    Space_Type1 sample = { .long_1 = s % NINSTANCES, .long_2 = s / NINSTANCES, .long_3 = wrid };
+    dds_return_t ret = dds_write (writer, &sample);
+    CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+  }
+}
+
+static void get_dqueue_wakeups (dds_entity_t participant, uint64_t *spun, uint64_t *parked)
+{
+  struct dds_statistics *stat = dds_create_statistics (participant);
+  CU_ASSERT_FATAL (stat != NULL);
+  dds_return_t ret = dds_refresh_statistics (stat);
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+  const struct dds_stat_keyvalue *kv;
+  kv = dds_lookup_statistic (stat, "dqueue_wakeups_spun");
+  CU_ASSERT_FATAL (kv != NULL && kv->kind == DDS_STAT_KIND_UINT64);
+  *spun = kv->u.u64;
+  kv = dds_lookup_statistic (stat, "dqueue_wakeups_parked");
+  CU_ASSERT_FATAL (kv != NULL && kv->kind == DDS_STAT_KIND_UINT64);
+  *parked = kv->u.u64;
+  dds_delete_statistics (stat);
+}
+
+CU_Test(ddsc_delivery, default_in_order, .init = delivery_init_default, .fini = delivery_fini, .timeout = 30)
+{
+  dds_entity_t reader, writer;
+  uint64_t spun, parked;
+  create_reader_writer (&reader, &writer);
+  write_samples (writer, 0, NSAMPLES);
+  take_in_order (reader, NSAMPLES);
+
+  /* the mutex-based queues don't poll and don't count wakeups */
+  get_dqueue_wakeups (g_remote_participant, &spun, &parked);
+  CU_ASSERT_EQUAL_FATAL (spun, 0);
+  CU_ASSERT_EQUAL_FATAL (parked, 0);
+}
+
+CU_Test(ddsc_delivery, lockfree_in_order, .init = delivery_init_lockfree, .fini = delivery_fini, .timeout = 30)
+{
+  dds_entity_t reader, writer;
+  uint64_t spun0, parked0, spun1, parked1;
+  create_reader_writer (&reader, &writer);
+  get_dqueue_wakeups (g_remote_participant, &spun0, &parked0);
+  write_samples (writer, 0, NSAMPLES);
+  take_in_order (reader, NSAMPLES);
+
+  /* every batch of samples taken from the queue follows a wakeup, either after
+     polling or after parking, and the queue starts out parked and idle */
+  get_dqueue_wakeups (g_remote_participant, &spun1, &parked1);
+  CU_ASSERT_FATAL (spun1 >= spun0 && parked1 >= parked0);
+  CU_ASSERT_FATAL ((spun1 - spun0) + (parked1 - parked0) > 0);
+  CU_ASSERT_FATAL (parked1 > 0);
+}
+
+CU_Test(ddsc_delivery, lockfree_multiple_writers, .init = delivery_init_lockfree, .fini = delivery_fini, .timeout = 30)
+{
+  /* two writers interleave their sample chains in the same delivery queue */
+  dds_entity_t reader, writer1, writer2;
+  dds_qos_t *qos = create_reliable_qos ();
+  create_reader_writer_qos (&reader, &writer1, qos);
+  writer2 = dds_create_writer (g_participant, g_topic, qos, NULL);
+  CU_ASSERT_FATAL (writer2 > 0);
+  dds_delete_qos (qos);
+  while (1)
+  {
+    dds_subscription_matched_status_t rst;
+    dds_publication_matched_status_t wst;
+    CU_ASSERT_FATAL (dds_get_subscription_matched_status (reader, &rst) == DDS_RETCODE_OK);
+    CU_ASSERT_FATAL (dds_get_publication_matched_status (writer2, &wst) == DDS_RETCODE_OK);
+    if (rst.current_count == 2 && wst.current_count == 1)
+      break;
+    dds_sleepfor (DDS_MSECS (1));
+  }
+  bring_in_sync (&reader, 1, writer2);
+
+  /* both writers write the same instances, ordering only holds per writer */
+  for (int32_t s = 0; s < NSAMPLES; s++)
+  {
+    Space_Type1 sample1 = { .long_1 = s % NINSTANCES, .long_2 = s / NINSTANCES, .long_3 = 0 };
+    Space_Type1 sample2 = { .long_1 = s % NINSTANCES, .long_2 = s / NINSTANCES, .long_3 = 1 };
+    CU_ASSERT_FATAL (dds_write (writer1, &sample1) == DDS_RETCODE_OK);
+    CU_ASSERT_FATAL (dds_write (writer2, &sample2) == DDS_RETCODE_OK);
+  }
+  take_in_order (reader, 2 * NSAMPLES);
+}
+
+#define NREADERS 3
+
+static dds_entity_t create_pool_readers_writer (dds_entity_t readers[NREADERS], const dds_qos_t *qos)
+{
+  dds_entity_t writer = dds_create_writer (g_participant, g_topic, qos, NULL);
+  CU_ASSERT_FATAL (writer > 0);
+  for (int i = 0; i < NREADERS; i++)
+  {
+    readers[i] = dds_create_reader (g_remote_participant, g_remote_topic, qos, NULL);
+    CU_ASSERT_FATAL (readers[i] > 0);
+    sync_reader_writer (g_remote_participant, readers[i], g_participant, writer);
+  }
+  return writer;
+}
+
+CU_Test(ddsc_delivery, pool_in_order, .init = delivery_init_pool, .fini = delivery_fini, .timeout = 30)
+{
+  /* the readers and instances get spread over the threads of the delivery pool,
+     but the samples of an instance must still be stored in order in each reader */
+  dds_entity_t readers[NREADERS];
+  dds_qos_t *qos = create_reliable_qos ();
+  const dds_entity_t writer = create_pool_readers_writer (readers, qos);
+  dds_delete_qos (qos);
+  bring_in_sync (readers, NREADERS, writer);
+  write_samples (writer, 0, NSAMPLES);
+  for (int i = 0; i < NREADERS; i++)
+    take_in_order (readers[i], NSAMPLES);
+}
+
+/* A keep-all reader that can hold only a single sample makes the delivery pool
+   retry storing until the application takes the sample, so the pool ends up
+   with a backlog that only drains while the test takes the samples */
+#define NBACKLOG 100
+
+static dds_entity_t create_full_reader (const dds_qos_t *qos)
+{
+  dds_qos_t *rdqos = dds_create_qos ();
+  CU_ASSERT_FATAL (rdqos != NULL);
+  dds_copy_qos (rdqos, qos);
+  dds_qset_resource_limits (rdqos, 1, DDS_LENGTH_UNLIMITED, DDS_LENGTH_UNLIMITED);
+  dds_entity_t reader = dds_create_reader (g_remote_participant, g_remote_topic, rdqos, NULL);
+  CU_ASSERT_FATAL (reader > 0);
+  dds_delete_qos (rdqos);
+  return reader;
+}
+
+static void wait_for_no_alive_writers (dds_entity_t reader)
+{
+  const dds_time_t tend = dds_time () + DDS_SECS (10);
+  dds_liveliness_changed_status_t st;
+  do {
+    dds_return_t ret = dds_get_liveliness_changed_status (reader, &st);
+    CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+    if (st.alive_count > 0)
+      dds_sleepfor (DDS_MSECS (10));
+  } while (st.alive_count > 0 && dds_time () < tend);
+  CU_ASSERT_FATAL (st.alive_count == 0);
+}
+
+static void check_unregistered_after_data (dds_entity_t reader, int32_t nsamples)
+{
+  /* unregistering the writer must not overtake samples still waiting in the
+     delivery pool, else storing those registers the writer again: the last
+     state seen for every instance, whether in a valid sample or in the invalid
+     sample signalling the unregister, must be "no writers" */
+  uint32_t state[NINSTANCES];
+  int32_t next[NINSTANCES] = { 0 };
+  int32_t received = 0, nnowriters = 0;
+  for (int32_t i = 0; i < NINSTANCES; i++)
+    state[i] = DDS_ALIVE_INSTANCE_STATE;
+  const dds_time_t tend = dds_time () + DDS_SECS (10);
+  while ((received < nsamples || nnowriters < NINSTANCES) && dds_time () < tend)
+  {
+    Space_Type1 data[64];
+    void *ptrs[64];
+    dds_sample_info_t si[64];
+    for (size_t i = 0; i < 64; i++)
+      ptrs[i] = &data[i];
+    const int32_t n = dds_take (reader, ptrs, si, 64, 64);
+    CU_ASSERT_FATAL (n >= 0);
+    if (n == 0)
+    {
+      dds_sleepfor (DDS_MSECS (1));
+      continue;
+    }
+    for (int32_t i = 0; i < n; i++)
+    {
+      CU_ASSERT_FATAL (data[i].long_1 >= 0 && data[i].long_1 < NINSTANCES);
+      if (si[i].valid_data)
+      {
+        CU_ASSERT_EQUAL_FATAL (data[i].long_2, next[data[i].long_1]);
+        next[data[i].long_1]++;
+        received++;
+      }
+      state[data[i].long_1] = si[i].instance_state;
+    }
+    nnowriters = 0;
+    for (int32_t i = 0; i < NINSTANCES; i++)
+      if (state[i] == DDS_NOT_ALIVE_NO_WRITERS_INSTANCE_STATE)
+        nnowriters++;
+  }
+  CU_ASSERT_EQUAL_FATAL (received, nsamples);
+  CU_ASSERT_EQUAL_FATAL (nnowriters, NINSTANCES);
+  wait_for_no_alive_writers (reader);
+}
+
+CU_Test(ddsc_delivery, pool_unregister_after_data_lease, .init = delivery_init_pool, .fini = delivery_fini, .timeout = 30)
+{
+  /* the writer loses its liveliness while the pool is still storing its data */
+  dds_qos_t *qos = create_reliable_qos ();
+  dds_qset_liveliness (qos, DDS_LIVELINESS_MANUAL_BY_TOPIC, DDS_SECS (1));
+  dds_qset_writer_data_lifecycle (qos, false);
+  const dds_entity_t reader = create_full_reader (qos);
+  const dds_entity_t writer = dds_create_writer (g_participant, g_topic, qos, NULL);
+  CU_ASSERT_FATAL (writer > 0);
+  dds_delete_qos (qos);
+  sync_reader_writer (g_remote_participant, reader, g_participant, writer);
+  bring_in_sync (&reader, 1, writer);
+  write_samples (writer, 0, NBACKLOG);
+  dds_sleepfor (DDS_MSECS (1500));
+  check_unregistered_after_data (reader, NBACKLOG);
+}
+
+CU_Test(ddsc_delivery, pool_unregister_after_data_delete, .init = delivery_init_pool, .fini = delivery_fini, .timeout = 30)
+{
+  /* the pool gives up on storing samples once the proxy writer is gone, so
+     this can't use a reader that forces a backlog */
+  dds_qos_t *qos = create_reliable_qos ();
+  dds_qset_writer_data_lifecycle (qos, false);
+  const dds_entity_t reader = dds_create_reader (g_remote_participant, g_remote_topic, qos, NULL);
+  CU_ASSERT_FATAL (reader > 0);
+  const dds_entity_t writer = dds_create_writer (g_participant, g_topic, qos, NULL);
+  CU_ASSERT_FATAL (writer > 0);
+  dds_delete_qos (qos);
+  sync_reader_writer (g_remote_participant, reader, g_participant, writer);
+  bring_in_sync (&reader, 1, writer);
+  write_samples (writer, 0, NSAMPLES);
+  dds_return_t ret = dds_delete (writer);
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+  check_unregistered_after_data (reader, NSAMPLES);
+}
+
+CU_Test(ddsc_delivery, pool_late_ack, .init = delivery_init_pool_lateack, .fini = delivery_fini, .timeout = 30)
+{
+  /* in late-ack mode, a sample is acknowledged only once it has been stored in
+     the reader history cache, so the writer can't get all acks before the
+     samples have been taken */
+  dds_qos_t *qos = create_reliable_qos ();
+  const dds_entity_t reader = create_full_reader (qos);
+  const dds_entity_t writer = dds_create_writer (g_participant, g_topic, qos, NULL);
+  CU_ASSERT_FATAL (writer > 0);
+  dds_delete_qos (qos);
+  sync_reader_writer (g_remote_participant, reader, g_participant, writer);
+  bring_in_sync (&reader, 1, writer);
+  write_samples (writer, 0, NBACKLOG);
+  dds_return_t ret = dds_wait_for_acks (writer, DDS_MSECS (300));
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_TIMEOUT);
+  take_in_order (reader, NBACKLOG);
+  ret = dds_wait_for_acks (writer, DDS_SECS (10));
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+}
+
+CU_Test(ddsc_delivery, pool_late_ack_many, .init = delivery_init_pool_lateack, .fini = delivery_fini, .timeout = 30)
+{
+  /* acknowledgements are batched: samples handed to the pool while an update of
+     the acknowledged sequence number is in flight are acknowledged by the next
+     one, and the last samples written must get acknowledged all the same */
+  dds_entity_t readers[NREADERS];
+  dds_qos_t *qos = create_reliable_qos ();
+  const dds_entity_t writer = create_pool_readers_writer (readers, qos);
+  dds_delete_qos (qos);
+  bring_in_sync (readers, NREADERS, writer);
+  write_samples (writer, 0, NSAMPLES);
+  for (int i = 0; i < NREADERS; i++)
+    take_in_order (readers[i], NSAMPLES);
+  dds_return_t ret = dds_wait_for_acks (writer, DDS_SECS (10));
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+}
@@ -468,3 +468,127 @@ CU_Test(ddsc_discstress, create_writer, .timeout = 20)
   rc = dds_delete (sub_dom);
   CU_ASSERT_FATAL (rc == 0);
 }
+
+#define N_PARTICIPANTS 8
+#define N_PARTICIPANT_ROUNDS 5
+
+static void wait_for_matched (dds_entity_t reader, dds_entity_t writer, uint32_t count)
+{
+  const dds_time_t tend = dds_time () + DDS_SECS (10);
+  dds_subscription_matched_status_t rst;
+  dds_publication_matched_status_t wst;
+  do {
+    dds_return_t rc;
+    rc = dds_get_subscription_matched_status (reader, &rst);
+    CU_ASSERT_FATAL (rc == 0);
+    rc = dds_get_publication_matched_status (writer, &wst);
+    CU_ASSERT_FATAL (rc == 0);
+    if (rst.current_count == count && wst.current_count == count)
+      return;
+    dds_sleepfor (DDS_MSECS (10));
+  } while (dds_time () < tend);
+  CU_FAIL_FATAL ("timed out waiting for matching endpoints");
+}
+
+/* Every round creates a set of participants at once in domain 0, each with nendpoints
+   writers for one topic and as many readers for another, and those must all get
+   discovered by and match with the single participant in domain 1, then they get
+   deleted and their proxies must disappear again.  Returns the average time it took
+   from starting to create the participants until everything matched. */
+static dds_duration_t parallel_participants (uint32_t discovery_delivery_threads, int nendpoints, int nrounds)
+{
+  char config[500];
+#ifdef DDS_HAS_SHM
+  (void) snprintf (config, sizeof (config), "${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}<Discovery><ExternalDomainId>0</ExternalDomainId></Discovery><Internal><DiscoveryDeliveryThreads>%"PRIu32"</DiscoveryDeliveryThreads></Internal><Domain id=\"any\"><SharedMemory><Enable>false</Enable></SharedMemory></Domain>", discovery_delivery_threads);
+#else
+  (void) snprintf (config, sizeof (config), "${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}<Discovery><ExternalDomainId>0</ExternalDomainId></Discovery><Internal><DiscoveryDeliveryThreads>%"PRIu32"</DiscoveryDeliveryThreads></Internal>", discovery_delivery_threads);
+#endif
+  char *pub_conf = ddsrt_expand_envvars (config, 0);
+  char *sub_conf = ddsrt_expand_envvars (config, 1);
+  const dds_entity_t pub_dom = dds_create_domain (0, pub_conf);
+  CU_ASSERT_FATAL (pub_dom > 0);
+  const dds_entity_t sub_dom = dds_create_domain (1, sub_conf);
+  CU_ASSERT_FATAL (sub_dom > 0);
+  ddsrt_free (pub_conf);
+  ddsrt_free (sub_conf);
+
+  char topicname[2][100];
+  create_unique_topic_name ("ddsc_discstress_parallel_participants", topicname[0], sizeof topicname[0]);
+  create_unique_topic_name ("ddsc_discstress_parallel_participants", topicname[1], sizeof topicname[1]);
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_SECS (10));
+
+  const dds_entity_t sub_pp = dds_create_participant (1, NULL, NULL);
+  CU_ASSERT_FATAL (sub_pp > 0);
+  const dds_entity_t sub_tp0 = dds_create_topic (sub_pp, &DiscStress_CreateWriter_Msg_desc, topicname[0], qos, NULL);
+  CU_ASSERT_FATAL (sub_tp0 > 0);
+  const dds_entity_t sub_tp1 = dds_create_topic (sub_pp, &DiscStress_CreateWriter_Msg_desc, topicname[1], qos, NULL);
+  CU_ASSERT_FATAL (sub_tp1 > 0);
+  const dds_entity_t sub_rd = dds_create_reader (sub_pp, sub_tp0, qos, NULL);
+  CU_ASSERT_FATAL (sub_rd > 0);
+  const dds_entity_t sub_wr = dds_create_writer (sub_pp, sub_tp1, qos, NULL);
+  CU_ASSERT_FATAL (sub_wr > 0);
+
+  dds_entity_t *rds = ddsrt_malloc ((size_t) (N_PARTICIPANTS * nendpoints) * sizeof (*rds));
+  dds_entity_t *wrs = ddsrt_malloc ((size_t) (N_PARTICIPANTS * nendpoints) * sizeof (*wrs));
+  dds_duration_t tdisc = 0;
+  for (int round = 0; round < nrounds; round++)
+  {
+    dds_entity_t pps[N_PARTICIPANTS];
+    dds_return_t rc;
+    const dds_time_t tstart = dds_time ();
+    for (int i = 0; i < N_PARTICIPANTS; i++)
+    {
+      pps[i] = dds_create_participant (0, NULL, NULL);
+      CU_ASSERT_FATAL (pps[i] > 0);
+      const dds_entity_t tp0 = dds_create_topic (pps[i], &DiscStress_CreateWriter_Msg_desc, topicname[0], qos, NULL);
+      CU_ASSERT_FATAL (tp0 > 0);
+      const dds_entity_t tp1 = dds_create_topic (pps[i], &DiscStress_CreateWriter_Msg_desc, topicname[1], qos, NULL);
+      CU_ASSERT_FATAL (tp1 > 0);
+      for (int j = 0; j < nendpoints; j++)
+      {
+        rds[i * nendpoints + j] = dds_create_reader (pps[i], tp1, qos, NULL);
+        CU_ASSERT_FATAL (rds[i * nendpoints + j] > 0);
+        wrs[i * nendpoints + j] = dds_create_writer (pps[i], tp0, qos, NULL);
+        CU_ASSERT_FATAL (wrs[i * nendpoints + j] > 0);
+      }
+    }
+    wait_for_matched (sub_rd, sub_wr, (uint32_t) (N_PARTICIPANTS * nendpoints));
+    for (int i = 0; i < N_PARTICIPANTS * nendpoints; i++)
+      wait_for_matched (rds[i], wrs[i], 1);
+    tdisc += dds_time () - tstart;
+    for (int i = 0; i < N_PARTICIPANTS; i++)
+    {
+      rc = dds_delete (pps[i]);
+      CU_ASSERT_FATAL (rc == 0);
+    }
+    wait_for_matched (sub_rd, sub_wr, 0);
+  }
+  ddsrt_free (rds);
+  ddsrt_free (wrs);
+
+  dds_delete_qos (qos);
+  dds_return_t rc;
+  rc = dds_delete (pub_dom);
+  CU_ASSERT_FATAL (rc == 0);
+  rc = dds_delete (sub_dom);
+  CU_ASSERT_FATAL (rc == 0);
+  return tdisc / nrounds;
+}
+
+CU_Test(ddsc_discstress, parallel_participants, .timeout = 60)
+{
+  /* Discovery of the participants in the other domain gets spread over several
+     threads in both domains */
+  (void) parallel_participants (4, 1, N_PARTICIPANT_ROUNDS);
+}
+
+CU_Test(ddsc_discstress, discovery_time, .timeout = 120)
+{
+  /* Many endpoints per participant make SEDP processing dominate; whether spreading
+     it over threads pays off depends on the number of cores, so this only reports the
+     time it takes */
+  const dds_duration_t t1 = parallel_participants (1, 20, N_PARTICIPANT_ROUNDS);
+  const dds_duration_t t4 = parallel_participants (4, 20, N_PARTICIPANT_ROUNDS);
+  printf ("discovery time: 1 thread %.3fs, 4 threads %.3fs\n", (double) t1 / 1e9, (double) t4 / 1e9);
+}
@@ -26,6 +26,7 @@
 #include "dds/ddsrt/environ.h"
 #include "dds/ddsrt/atomics.h"
 #include "dds/ddsrt/time.h"
+#include "dds/ddsrt/random.h"
 
 #include "test_common.h"
 
@@ -1261,3 +1262,249 @@ CU_Test(ddsc_liveliness, listener_vs_getstatus, .init = liveliness_init, .fini =
   dds_set_listener (reader, NULL); // listener must not be invoked anymore
   ddsrt_mutex_destroy(&listener_state.lock);
 }
+
+/**
+ * Writer leases with different durations expire in order of their expiry times,
+ * regardless of the order in which they were created.
+ */
+#define NWRITERS 5
+struct lease_order_arg {
+  ddsrt_atomic_uint32_t *next;
+  uint32_t rank;
+};
+
+static void lease_order_liveliness_lost (dds_entity_t wr, const dds_liveliness_lost_status_t status, void *varg)
+{
+  struct lease_order_arg *arg = varg;
+  (void) wr;
+  if (status.total_count_change > 0)
+    arg->rank = ddsrt_atomic_inc32_nv (arg->next);
+}
+
+CU_Test(ddsc_liveliness, lease_expiry_order, .init = liveliness_init, .fini = liveliness_fini, .timeout = 10)
+{
+  dds_entity_t pub_topic, writers[NWRITERS];
+  ddsrt_atomic_uint32_t next = DDSRT_ATOMIC_UINT32_INIT (0);
+  struct lease_order_arg args[NWRITERS];
+  char name[100];
+  Space_Type1 sample = {1, 0, 0};
+
+  create_unique_topic_name("ddsc_liveliness_lease_expiry_order", name, sizeof name);
+  CU_ASSERT_FATAL((pub_topic = dds_create_topic(g_pub_participant, &Space_Type1_desc, name, NULL, NULL)) > 0);
+
+  /* first writer has the longest lease */
+  for (uint32_t i = 0; i < NWRITERS; i++)
+  {
+    dds_qos_t *wqos;
+    dds_listener_t *listener;
+    args[i].next = &next;
+    args[i].rank = 0;
+    CU_ASSERT_FATAL((wqos = dds_create_qos()) != NULL);
+    dds_qset_liveliness(wqos, DDS_LIVELINESS_MANUAL_BY_TOPIC, DDS_MSECS(100) * (NWRITERS - i));
+    CU_ASSERT_FATAL((listener = dds_create_listener(&args[i])) != NULL);
+    dds_lset_liveliness_lost(listener, lease_order_liveliness_lost);
+    CU_ASSERT_FATAL((writers[i] = dds_create_writer(g_pub_participant, pub_topic, wqos, listener)) > 0);
+    dds_delete_listener(listener);
+    dds_delete_qos(wqos);
+  }
+  for (uint32_t i = 0; i < NWRITERS; i++)
+    CU_ASSERT_EQUAL_FATAL(dds_write(writers[i], &sample), DDS_RETCODE_OK);
+
+  const dds_time_t tend = dds_time() + DDS_SECS(5);
+  while (ddsrt_atomic_ld32(&next) < NWRITERS && dds_time() < tend)
+    dds_sleepfor(DDS_MSECS(10));
+  CU_ASSERT_FATAL(ddsrt_atomic_ld32(&next) == NWRITERS);
+  for (uint32_t i = 0; i < NWRITERS; i++)
+  {
+    dds_set_listener(writers[i], NULL);
+    CU_ASSERT_EQUAL(args[i].rank, NWRITERS - i);
+  }
+  CU_ASSERT_EQUAL_FATAL(dds_delete(pub_topic), DDS_RETCODE_OK);
+}
+#undef NWRITERS
+
+static void wait_for_alive_count (dds_entity_t reader, uint32_t count, dds_duration_t timeout)
+{
+  struct dds_liveliness_changed_status lstatus;
+  const dds_time_t tend = dds_time() + timeout;
+  do {
+    CU_ASSERT_EQUAL_FATAL(dds_get_liveliness_changed_status(reader, &lstatus), DDS_RETCODE_OK);
+    if (lstatus.alive_count != count)
+      dds_sleepfor(DDS_MSECS(10));
+  } while (lstatus.alive_count != count && dds_time() < tend);
+  CU_ASSERT_EQUAL_FATAL(lstatus.alive_count, count);
+}
+
+/**
+ * Renewing a lease keeps the writer alive, in the writer itself and for a remote
+ * reader, while a writer that is not renewed expires.
+ */
+CU_Test(ddsc_liveliness, lease_renewal, .init = liveliness_init, .fini = liveliness_fini, .timeout = 10)
+{
+  dds_entity_t pub_topic, sub_topic, reader, writers[2];
+  struct dds_liveliness_lost_status llstatus;
+  dds_qos_t *qos;
+  char name[100];
+  Space_Type1 sample = {1, 0, 0};
+  const dds_duration_t ldur = DDS_MSECS(300);
+
+  create_unique_topic_name("ddsc_liveliness_lease_renewal", name, sizeof name);
+  CU_ASSERT_FATAL((pub_topic = dds_create_topic(g_pub_participant, &Space_Type1_desc, name, NULL, NULL)) > 0);
+  CU_ASSERT_FATAL((sub_topic = dds_create_topic(g_sub_participant, &Space_Type1_desc, name, NULL, NULL)) > 0);
+
+  CU_ASSERT_FATAL((qos = dds_create_qos()) != NULL);
+  dds_qset_liveliness(qos, DDS_LIVELINESS_MANUAL_BY_TOPIC, ldur);
+  CU_ASSERT_FATAL((reader = dds_create_reader(g_sub_participant, sub_topic, qos, NULL)) > 0);
+  for (int i = 0; i < 2; i++)
+    CU_ASSERT_FATAL((writers[i] = dds_create_writer(g_pub_participant, pub_topic, qos, NULL)) > 0);
+  dds_delete_qos(qos);
+  for (int i = 0; i < 2; i++)
+    CU_ASSERT_EQUAL_FATAL(dds_write(writers[i], &sample), DDS_RETCODE_OK);
+  wait_for_alive_count(reader, 2, DDS_SECS(5));
+
+  /* renew the lease of the first writer for several lease durations */
+  const dds_time_t tend = dds_time() + 5 * ldur;
+  while (dds_time() < tend)
+  {
+    CU_ASSERT_EQUAL_FATAL(dds_write(writers[0], &sample), DDS_RETCODE_OK);
+    dds_sleepfor(ldur / 6);
+  }
+  CU_ASSERT_EQUAL_FATAL(dds_get_liveliness_lost_status(writers[0], &llstatus), DDS_RETCODE_OK);
+  CU_ASSERT_EQUAL(llstatus.total_count, 0);
+  CU_ASSERT_EQUAL_FATAL(dds_get_liveliness_lost_status(writers[1], &llstatus), DDS_RETCODE_OK);
+  CU_ASSERT_EQUAL(llstatus.total_count, 1);
+  wait_for_alive_count(reader, 1, DDS_SECS(1));
+
+  /* once no longer renewed, it expires as well */
+  wait_for_alive_count(reader, 0, DDS_SECS(5));
+  CU_ASSERT_EQUAL_FATAL(dds_get_liveliness_lost_status(writers[0], &llstatus), DDS_RETCODE_OK);
+  CU_ASSERT_EQUAL(llstatus.total_count, 1);
+
+  CU_ASSERT_EQUAL_FATAL(dds_delete(sub_topic), DDS_RETCODE_OK);
+  CU_ASSERT_EQUAL_FATAL(dds_delete(pub_topic), DDS_RETCODE_OK);
+}
+
+/**
+ * Writers that regain liveliness move the expiry of their (proxy) writer leases
+ * earlier (lease_set_expiry) while the gc thread handles expiring leases.  Racing
+ * these may not lose a lease: once the writers stop, every writer must lose its
+ * liveliness, and they must still be able to regain it afterwards.
+ */
+#define NWRITERS 8
+#define NTHREADS 4
+struct set_expiry_thread_arg {
+  const dds_entity_t *writers;
+  uint32_t seed;
+  ddsrt_atomic_uint32_t *stop;
+};
+
+static uint32_t set_expiry_thread (void *varg)
+{
+  struct set_expiry_thread_arg *arg = varg;
+  ddsrt_prng_t prng;
+  Space_Type1 sample = {1, 0, 0};
+  ddsrt_prng_init_simple (&prng, arg->seed);
+  while (!ddsrt_atomic_ld32 (arg->stop))
+  {
+    const uint32_t i = ddsrt_prng_random (&prng) % NWRITERS;
+    if (dds_write (arg->writers[i], &sample) != DDS_RETCODE_OK)
+      return 0;
+    dds_sleepfor (DDS_USECS (ddsrt_prng_random (&prng) % 20000));
+  }
+  return 1;
+}
+
+CU_Test(ddsc_liveliness, lease_set_expiry_vs_gc, .init = liveliness_init, .fini = liveliness_fini, .timeout = 30)
+{
+  dds_entity_t pub_topic, sub_topic, reader, remote_reader, writers[NWRITERS];
+  struct dds_liveliness_lost_status llstatus;
+  dds_qos_t *qos;
+  char name[100];
+  Space_Type1 sample = {1, 0, 0};
+  dds_return_t rc;
+
+  create_unique_topic_name("ddsc_liveliness_lease_set_expiry_vs_gc", name, sizeof name);
+  CU_ASSERT_FATAL((pub_topic = dds_create_topic(g_pub_participant, &Space_Type1_desc, name, NULL, NULL)) > 0);
+  CU_ASSERT_FATAL((sub_topic = dds_create_topic(g_sub_participant, &Space_Type1_desc, name, NULL, NULL)) > 0);
+
+  /* lease duration is short enough that the writers keep losing and regaining liveliness */
+  CU_ASSERT_FATAL((qos = dds_create_qos()) != NULL);
+  dds_qset_liveliness(qos, DDS_LIVELINESS_MANUAL_BY_TOPIC, DDS_MSECS(10));
+  CU_ASSERT_FATAL((reader = dds_create_reader(g_pub_participant, pub_topic, qos, NULL)) > 0);
+  CU_ASSERT_FATAL((remote_reader = dds_create_reader(g_sub_participant, sub_topic, qos, NULL)) > 0);
+  for (int i = 0; i < NWRITERS; i++)
+    CU_ASSERT_FATAL((writers[i] = dds_create_writer(g_pub_participant, pub_topic, qos, NULL)) > 0);
+  dds_delete_qos(qos);
+  for (int i = 0; i < NWRITERS; i++)
+  {
+    dds_publication_matched_status_t st;
+    do {
+      CU_ASSERT_EQUAL_FATAL(dds_get_publication_matched_status(writers[i], &st), DDS_RETCODE_OK);
+      if (st.current_count < 2)
+        dds_sleepfor(DDS_MSECS(10));
+    } while (st.current_count < 2);
+  }
+
+  ddsrt_atomic_uint32_t stop = DDSRT_ATOMIC_UINT32_INIT (0);
+  struct set_expiry_thread_arg args[NTHREADS];
+  ddsrt_thread_t tids[NTHREADS];
+  ddsrt_threadattr_t tattr;
+  ddsrt_threadattr_init(&tattr);
+  for (uint32_t i = 0; i < NTHREADS; i++)
+  {
+    args[i].writers = writers;
+    args[i].seed = i + 1;
+    args[i].stop = &stop;
+    rc = ddsrt_thread_create(&tids[i], "set_expiry", &tattr, set_expiry_thread, &args[i]);
+    CU_ASSERT_FATAL(rc == DDS_RETCODE_OK);
+  }
+  dds_sleepfor(DDS_SECS(2));
+  ddsrt_atomic_st32(&stop, 1);
+  for (uint32_t i = 0; i < NTHREADS; i++)
+  {
+    uint32_t ok;
+    rc = ddsrt_thread_join(tids[i], &ok);
+    CU_ASSERT_FATAL(rc == DDS_RETCODE_OK);
+    CU_ASSERT_FATAL(ok != 0);
+  }
+
+  /* the writers must have lost liveliness along the way, else nothing was tested */
+  for (int i = 0; i < NWRITERS; i++)
+  {
+    CU_ASSERT_EQUAL_FATAL(dds_get_liveliness_lost_status(writers[i], &llstatus), DDS_RETCODE_OK);
+    CU_ASSERT(llstatus.total_count > 0);
+  }
+
+  /* no writer (local) nor proxy writer (remote) can be alive for long */
+  wait_for_alive_count(reader, 0, DDS_SECS(2));
+  wait_for_alive_count(remote_reader, 0, DDS_SECS(2));
+
+  /* and they can still become alive and expire (exactly once more) */
+  uint32_t lost_count[NWRITERS];
+  for (int i = 0; i < NWRITERS; i++)
+  {
+    CU_ASSERT_EQUAL_FATAL(dds_get_liveliness_lost_status(writers[i], &llstatus), DDS_RETCODE_OK);
+    lost_count[i] = llstatus.total_count;
+    CU_ASSERT_EQUAL_FATAL(dds_write(writers[i], &sample), DDS_RETCODE_OK);
+  }
+  for (int i = 0; i < NWRITERS; i++)
+  {
+    const dds_time_t tend = dds_time() + DDS_SECS(2);
+    do {
+      CU_ASSERT_EQUAL_FATAL(dds_get_liveliness_lost_status(writers[i], &llstatus), DDS_RETCODE_OK);
+      if (llstatus.total_count == lost_count[i])
+        dds_sleepfor(DDS_MSECS(10));
+    } while (llstatus.total_count == lost_count[i] && dds_time() < tend);
+    CU_ASSERT_EQUAL(llstatus.total_count, lost_count[i] + 1);
+  }
+  wait_for_alive_count(reader, 0, DDS_SECS(2));
+  wait_for_alive_count(remote_reader, 0, DDS_SECS(2));
+  struct dds_liveliness_changed_status lstatus;
+  CU_ASSERT_EQUAL_FATAL(dds_get_liveliness_changed_status(remote_reader, &lstatus), DDS_RETCODE_OK);
+  CU_ASSERT_EQUAL(lstatus.not_alive_count, (uint32_t) NWRITERS);
+
+  CU_ASSERT_EQUAL_FATAL(dds_delete(sub_topic), DDS_RETCODE_OK);
+  CU_ASSERT_EQUAL_FATAL(dds_delete(pub_topic), DDS_RETCODE_OK);
+}
+#undef NTHREADS
+#undef NWRITERS
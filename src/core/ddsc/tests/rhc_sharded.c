@@ -0,0 +1,128 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include "dds/dds.h"
+#include "dds/ddsc/dds_internal_api.h"
+
+#include "test_common.h"
+
+#define N_INSTANCES 200
+
+static Space_Type1 g_data[3 * N_INSTANCES];
+static void *g_samples[3 * N_INSTANCES];
+static dds_sample_info_t g_info[3 * N_INSTANCES];
+
+static bool filter_even (const void *sample)
+{
+  const Space_Type1 *s = sample;
+  return (s->long_1 % 2) == 0;
+}
+
+CU_TheoryDataPoints(ddsc_rhc_sharded, read_take) = {
+  CU_DataPoints(char *, "1", "4", "1000"),
+};
+
+CU_Theory((char *nshards), ddsc_rhc_sharded, read_take)
+{
+  char name[100];
+  dds_return_t rc;
+  int32_t n;
+
+  for (size_t i = 0; i < sizeof (g_samples) / sizeof (g_samples[0]); i++)
+    g_samples[i] = &g_data[i];
+
+  const dds_entity_t pp = dds_create_participant (DDS_DOMAIN_DEFAULT, NULL, NULL);
+  CU_ASSERT_FATAL (pp > 0);
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  dds_qset_prop (qos, "org.eclipse.cyclonedds.rhc.shards", nshards);
+  const dds_entity_t tp = dds_create_topic (pp, &Space_Type1_desc, create_unique_topic_name ("ddsc_rhc_sharded", name, sizeof (name)), qos, NULL);
+  CU_ASSERT_FATAL (tp > 0);
+  const dds_entity_t rd = dds_create_reader (pp, tp, qos, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  const dds_entity_t wr = dds_create_writer (pp, tp, qos, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  dds_delete_qos (qos);
+
+  /* one condition attached before writing, two after so both ways of
+     initialising the triggers get covered */
+  const dds_entity_t qc = dds_create_querycondition (rd, DDS_ANY_STATE, filter_even);
+  CU_ASSERT_FATAL (qc > 0);
+  for (int32_t j = 0; j < 2; j++)
+  {
+    for (int32_t i = 0; i < N_INSTANCES; i++)
+    {
+      Space_Type1 s = { i, j, 0 };
+      rc = dds_write (wr, &s);
+      CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+    }
+  }
+  const dds_entity_t rdc = dds_create_readcondition (rd, DDS_NOT_READ_SAMPLE_STATE);
+  CU_ASSERT_FATAL (rdc > 0);
+  const dds_entity_t qc_nr = dds_create_querycondition (rd, DDS_NOT_READ_SAMPLE_STATE, filter_even);
+  CU_ASSERT_FATAL (qc_nr > 0);
+
+  const dds_entity_t ws = dds_create_waitset (pp);
+  CU_ASSERT_FATAL (ws > 0);
+  rc = dds_waitset_attach (ws, qc, 0);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  rc = dds_waitset_attach (ws, rdc, 1);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  rc = dds_waitset_attach (ws, qc_nr, 2);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  rc = dds_waitset_wait (ws, NULL, 0, 0);
+  CU_ASSERT_FATAL (rc == 3);
+
+  /* query condition visits all shards; reading changes the sample state in all of them */
+  n = dds_read (qc, g_samples, g_info, 3 * N_INSTANCES, 3 * N_INSTANCES);
+  CU_ASSERT_FATAL (n == N_INSTANCES);
+  for (int32_t i = 0; i < n; i++)
+    CU_ASSERT (g_data[i].long_1 % 2 == 0);
+  n = dds_read (qc_nr, g_samples, g_info, 3 * N_INSTANCES, 3 * N_INSTANCES);
+  CU_ASSERT_FATAL (n == 0);
+  n = dds_read (rdc, g_samples, g_info, 3 * N_INSTANCES, 3 * N_INSTANCES);
+  CU_ASSERT_FATAL (n == N_INSTANCES);
+  rc = dds_waitset_wait (ws, NULL, 0, 0);
+  CU_ASSERT_FATAL (rc == 1);
+
+  /* instance handles go to a single shard */
+  const Space_Type1 key = { 17, 0, 0 };
+  const dds_instance_handle_t ih = dds_lookup_instance (rd, &key);
+  CU_ASSERT_FATAL (ih != 0);
+  n = dds_take_instance (rd, g_samples, g_info, 3 * N_INSTANCES, 3 * N_INSTANCES, ih);
+  CU_ASSERT_FATAL (n == 2);
+  CU_ASSERT (g_data[0].long_1 == 17 && g_data[1].long_1 == 17);
+  n = dds_take_instance (rd, g_samples, g_info, 3 * N_INSTANCES, 3 * N_INSTANCES, ih);
+  CU_ASSERT_FATAL (n == 0);
+
+  /* locking all shards, then a read/take that must release them all */
+  uint32_t nlocked = dds_reader_lock_samples (rd);
+  CU_ASSERT_FATAL (nlocked == 2 * N_INSTANCES - 2);
+  n = dds_read (rd, g_samples, g_info, 3 * N_INSTANCES, DDS_READ_WITHOUT_LOCK);
+  CU_ASSERT_FATAL (n == (int32_t) nlocked);
+  nlocked = dds_reader_lock_samples (rd);
+  CU_ASSERT_FATAL (nlocked == 2 * N_INSTANCES - 2);
+  n = dds_take (rd, g_samples, g_info, 10, DDS_READ_WITHOUT_LOCK);
+  CU_ASSERT_FATAL (n == 10);
+
+  /* small takes must eventually return everything */
+  int32_t total = n;
+  while ((n = dds_take (rd, g_samples, g_info, 7, 7)) > 0)
+    total += n;
+  CU_ASSERT_FATAL (n == 0);
+  CU_ASSERT (total == 2 * N_INSTANCES - 2);
+  rc = dds_waitset_wait (ws, NULL, 0, 0);
+  CU_ASSERT (rc == 0);
+
+  rc = dds_delete (pp);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+}
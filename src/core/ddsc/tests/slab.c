@@ -0,0 +1,274 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <string.h>
+
+#include "dds/dds.h"
+#include "dds/ddsrt/environ.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/random.h"
+#include "dds/ddsc/dds_statistics.h"
+#include "dds__slab.h"
+
+#include "test_common.h"
+
+/* 24 bytes gets rounded up to 32 */
+#define OBJSIZE 24
+#define ROUNDED_OBJSIZE 32
+
+static void check_stats (const struct dds_slab *slab, uint64_t bytes, uint64_t bytes_in_use, uint64_t chunks, uint64_t cached_chunks)
+{
+  struct dds_slab_stats st = { 0, 0, 0, 0 };
+  dds_slab_add_stats (slab, &st);
+  CU_ASSERT_EQUAL_FATAL (st.bytes, bytes);
+  CU_ASSERT_EQUAL_FATAL (st.bytes_in_use, bytes_in_use);
+  CU_ASSERT_EQUAL_FATAL (st.chunks, chunks);
+  CU_ASSERT_EQUAL_FATAL (st.cached_chunks, cached_chunks);
+}
+
+static uint64_t get_bytes (const struct dds_slab *slab)
+{
+  struct dds_slab_stats st = { 0, 0, 0, 0 };
+  dds_slab_add_stats (slab, &st);
+  return st.bytes;
+}
+
+CU_Test (ddsc_slab, reuse)
+{
+  struct dds_slab slab;
+  void *objs[DDS_SLAB_MIN_CHUNK_OBJS];
+  dds_slab_init (&slab, OBJSIZE, 1);
+  check_stats (&slab, 0, 0, 0, 0);
+  for (uint32_t i = 0; i < DDS_SLAB_MIN_CHUNK_OBJS; i++)
+  {
+    objs[i] = dds_slab_alloc (&slab);
+    CU_ASSERT_FATAL (((uintptr_t) objs[i] % 16) == 0);
+    memset (objs[i], 0xff, OBJSIZE);
+  }
+  /* the first chunk holds 16 objects */
+  const uint64_t bytes = get_bytes (&slab);
+  CU_ASSERT_FATAL (bytes >= DDS_SLAB_MIN_CHUNK_OBJS * ROUNDED_OBJSIZE);
+  check_stats (&slab, bytes, DDS_SLAB_MIN_CHUNK_OBJS * ROUNDED_OBJSIZE, 1, 0);
+
+  /* freed objects are reused, most recently freed one first */
+  dds_slab_free (&slab, objs[5]);
+  dds_slab_free (&slab, objs[9]);
+  check_stats (&slab, bytes, (DDS_SLAB_MIN_CHUNK_OBJS - 2) * ROUNDED_OBJSIZE, 1, 0);
+  CU_ASSERT_FATAL (dds_slab_alloc (&slab) == objs[9]);
+  CU_ASSERT_FATAL (dds_slab_alloc (&slab) == objs[5]);
+  check_stats (&slab, bytes, DDS_SLAB_MIN_CHUNK_OBJS * ROUNDED_OBJSIZE, 1, 0);
+
+  /* the next one requires a second chunk */
+  void *obj = dds_slab_alloc (&slab);
+  const uint64_t bytes2 = get_bytes (&slab);
+  CU_ASSERT_FATAL (bytes2 > bytes);
+  check_stats (&slab, bytes2, (DDS_SLAB_MIN_CHUNK_OBJS + 1) * ROUNDED_OBJSIZE, 2, 0);
+  dds_slab_free (&slab, obj);
+  check_stats (&slab, bytes2, DDS_SLAB_MIN_CHUNK_OBJS * ROUNDED_OBJSIZE, 1, 1);
+
+  /* the cached chunk gets used once the first one is full */
+  CU_ASSERT_FATAL (dds_slab_alloc (&slab) == obj);
+  check_stats (&slab, bytes2, (DDS_SLAB_MIN_CHUNK_OBJS + 1) * ROUNDED_OBJSIZE, 2, 0);
+
+  /* the cache holds only one chunk, the second one to become empty is freed */
+  dds_slab_free (&slab, obj);
+  for (uint32_t i = 0; i < DDS_SLAB_MIN_CHUNK_OBJS; i++)
+    dds_slab_free (&slab, objs[i]);
+  check_stats (&slab, bytes2 - bytes, 0, 0, 1);
+  dds_slab_fini (&slab);
+}
+
+CU_Test (ddsc_slab, release)
+{
+  /* three chunks: 16, 32 and 64 objects */
+#define N (DDS_SLAB_MIN_CHUNK_OBJS * 7)
+  struct dds_slab slab;
+  void *objs[N];
+  dds_slab_init (&slab, OBJSIZE, 1);
+  uint64_t chunk_bytes[3];
+  for (uint32_t i = 0, k = 0; i < N; i++)
+  {
+    const uint64_t b0 = get_bytes (&slab);
+    objs[i] = dds_slab_alloc (&slab);
+    if (get_bytes (&slab) != b0)
+      chunk_bytes[k++] = get_bytes (&slab) - b0;
+  }
+  const uint64_t bytes = chunk_bytes[0] + chunk_bytes[1] + chunk_bytes[2];
+  check_stats (&slab, bytes, N * ROUNDED_OBJSIZE, 3, 0);
+
+  /* emptying the middle chunk moves it to the cache */
+  for (uint32_t i = DDS_SLAB_MIN_CHUNK_OBJS; i < 3 * DDS_SLAB_MIN_CHUNK_OBJS; i++)
+    dds_slab_free (&slab, objs[i]);
+  check_stats (&slab, bytes, 5 * DDS_SLAB_MIN_CHUNK_OBJS * ROUNDED_OBJSIZE, 2, 1);
+
+  /* the cache is full, so emptying the first chunk returns it to the heap */
+  for (uint32_t i = 0; i < DDS_SLAB_MIN_CHUNK_OBJS; i++)
+    dds_slab_free (&slab, objs[i]);
+  check_stats (&slab, bytes - chunk_bytes[0], 4 * DDS_SLAB_MIN_CHUNK_OBJS * ROUNDED_OBJSIZE, 1, 1);
+
+  /* freeing all but one object in the last chunk doesn't release anything */
+  for (uint32_t i = 3 * DDS_SLAB_MIN_CHUNK_OBJS; i < N - 1; i++)
+    dds_slab_free (&slab, objs[i]);
+  check_stats (&slab, bytes - chunk_bytes[0], ROUNDED_OBJSIZE, 1, 1);
+  dds_slab_free (&slab, objs[N - 1]);
+  check_stats (&slab, chunk_bytes[1], 0, 0, 1);
+  dds_slab_fini (&slab);
+
+  /* without a cache, memory is released as soon as a chunk is empty */
+  dds_slab_init (&slab, OBJSIZE, 0);
+  for (uint32_t i = 0; i < N; i++)
+    objs[i] = dds_slab_alloc (&slab);
+  for (uint32_t i = 0; i < N; i++)
+    dds_slab_free (&slab, objs[i]);
+  check_stats (&slab, 0, 0, 0, 0);
+  dds_slab_fini (&slab);
+#undef N
+}
+
+CU_Test (ddsc_slab, random)
+{
+  /* objects must never overlap, whatever the pattern of allocations and frees */
+#define N 2000
+  struct dds_slab slab;
+  uint32_t *objs[N] = { NULL };
+  uint32_t ninuse = 0;
+  ddsrt_prng_t prng;
+  ddsrt_prng_init_simple (&prng, 1);
+  dds_slab_init (&slab, OBJSIZE, 2);
+  for (uint32_t op = 0; op < 100000; op++)
+  {
+    /* cycle between growing and shrinking, so that chunks get emptied */
+    const bool grow = ((op / 10000) % 2) == 0;
+    const uint32_t i = ddsrt_prng_random (&prng) % N;
+    if (objs[i] == NULL && (grow || (ddsrt_prng_random (&prng) % 4) == 0))
+    {
+      objs[i] = dds_slab_alloc (&slab);
+      for (uint32_t j = 0; j < OBJSIZE / sizeof (uint32_t); j++)
+        objs[i][j] = i;
+      ninuse++;
+    }
+    else if (objs[i] != NULL && (!grow || (ddsrt_prng_random (&prng) % 4) == 0))
+    {
+      for (uint32_t j = 0; j < OBJSIZE / sizeof (uint32_t); j++)
+        CU_ASSERT_FATAL (objs[i][j] == i);
+      dds_slab_free (&slab, objs[i]);
+      objs[i] = NULL;
+      ninuse--;
+    }
+    struct dds_slab_stats st = { 0, 0, 0, 0 };
+    dds_slab_add_stats (&slab, &st);
+    CU_ASSERT_FATAL (st.bytes_in_use == ninuse * ROUNDED_OBJSIZE);
+    CU_ASSERT_FATAL (st.cached_chunks <= 2);
+    CU_ASSERT_FATAL (st.bytes >= st.bytes_in_use);
+  }
+  for (uint32_t i = 0; i < N; i++)
+    if (objs[i])
+      dds_slab_free (&slab, objs[i]);
+  check_stats (&slab, get_bytes (&slab), 0, 0, 2);
+  dds_slab_fini (&slab);
+#undef N
+}
+
+static void get_rhc_stats (struct dds_statistics *stat, uint64_t *bytes, uint64_t *bytes_in_use, uint64_t *chunks, uint64_t *cached_chunks)
+{
+  dds_return_t rc = dds_refresh_statistics (stat);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  const char *names[] = { "rhc_bytes", "rhc_bytes_in_use", "rhc_chunks", "rhc_cached_chunks" };
+  uint64_t *vals[] = { bytes, bytes_in_use, chunks, cached_chunks };
+  for (size_t i = 0; i < sizeof (names) / sizeof (names[0]); i++)
+  {
+    const struct dds_stat_keyvalue *kv = dds_lookup_statistic (stat, names[i]);
+    CU_ASSERT_FATAL (kv != NULL && kv->kind == DDS_STAT_KIND_UINT64);
+    *vals[i] = kv->u.u64;
+  }
+}
+
+CU_Test (ddsc_slab, reader_stats)
+{
+#define N 1000
+  char *conf = ddsrt_expand_envvars ("${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}<Internal><ReaderHistoryCachedChunks>1</ReaderHistoryCachedChunks></Internal>", 0);
+  const dds_entity_t dom = dds_create_domain (0, conf);
+  CU_ASSERT_FATAL (dom > 0);
+  dds_free (conf);
+  const dds_entity_t pp = dds_create_participant (0, NULL, NULL);
+  CU_ASSERT_FATAL (pp > 0);
+  char name[100];
+  create_unique_topic_name ("ddsc_slab", name, sizeof name);
+  const dds_entity_t tp = dds_create_topic (pp, &Space_Type1_desc, name, NULL, NULL);
+  CU_ASSERT_FATAL (tp > 0);
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_LAST, 2);
+  dds_qset_writer_data_lifecycle (qos, false);
+  const dds_entity_t rd = dds_create_reader (pp, tp, qos, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  dds_entity_t wr = dds_create_writer (pp, tp, qos, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  dds_delete_qos (qos);
+
+  struct dds_statistics *stat = dds_create_statistics (rd);
+  CU_ASSERT_FATAL (stat != NULL);
+  uint64_t bytes, bytes_in_use, chunks, cached_chunks;
+  get_rhc_stats (stat, &bytes, &bytes_in_use, &chunks, &cached_chunks);
+  CU_ASSERT_FATAL (bytes == 0 && bytes_in_use == 0 && chunks == 0 && cached_chunks == 0);
+
+  /* two samples per instance, the second one doesn't fit in the instance */
+  for (int32_t k = 0; k < 2 * N; k++)
+  {
+    dds_return_t rc = dds_write (wr, &(Space_Type1){ k % N, 0, 0 });
+    CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  }
+  get_rhc_stats (stat, &bytes, &bytes_in_use, &chunks, &cached_chunks);
+  CU_ASSERT_FATAL (bytes_in_use > 0 && bytes >= bytes_in_use);
+  CU_ASSERT_FATAL (chunks > 2 && cached_chunks == 0);
+
+  /* taking all samples frees the out-of-line ones, that releases chunks */
+  const uint64_t bytes_in_use1 = bytes_in_use, bytes1 = bytes;
+  void *raw[2] = { NULL, NULL };
+  dds_sample_info_t si[2];
+  for (int32_t k = 0; k < N; k++)
+  {
+    const dds_instance_handle_t ih = dds_lookup_instance (rd, &(Space_Type1){ k, 0, 0 });
+    dds_return_t n = dds_take_instance (rd, raw, si, 2, 2, ih);
+    CU_ASSERT_FATAL (n == 2);
+    (void) dds_return_loan (rd, raw, n);
+  }
+  get_rhc_stats (stat, &bytes, &bytes_in_use, &chunks, &cached_chunks);
+  CU_ASSERT_FATAL (bytes_in_use < bytes_in_use1 && bytes < bytes1);
+  CU_ASSERT_FATAL (cached_chunks == 1);
+
+  /* deleting the writer and taking the remaining samples removes the instances */
+  dds_return_t rc = dds_delete (wr);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  int32_t n;
+  while ((n = dds_take (rd, raw, si, 2, 2)) > 0)
+    (void) dds_return_loan (rd, raw, n);
+  CU_ASSERT_FATAL (n == 0);
+  get_rhc_stats (stat, &bytes, &bytes_in_use, &chunks, &cached_chunks);
+  CU_ASSERT_FATAL (bytes_in_use == 0 && chunks == 0);
+  /* one cached chunk for instances and one for samples */
+  CU_ASSERT_FATAL (cached_chunks == 2);
+  CU_ASSERT_FATAL (bytes > 0 && bytes <= 2 * DDS_SLAB_MAX_CHUNK_BYTES);
+
+  /* new instances reuse the cached chunks */
+  const uint64_t bytes2 = bytes;
+  wr = dds_create_writer (pp, tp, NULL, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  rc = dds_write (wr, &(Space_Type1){ 0, 0, 0 });
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  get_rhc_stats (stat, &bytes, &bytes_in_use, &chunks, &cached_chunks);
+  CU_ASSERT_FATAL (bytes_in_use > 0 && chunks == 1 && cached_chunks == 1 && bytes == bytes2);
+
+  dds_delete_statistics (stat);
+  rc = dds_delete (dom);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+#undef N
+}
@@ -16,10 +16,13 @@
 #include "dds/ddsrt/process.h"
 #include "dds/ddsrt/threads.h"
 #include "dds/ddsrt/environ.h"
+#include "dds/ddsc/dds_statistics.h"
 #include "dds/ddsi/ddsi_entity_index.h"
 #include "dds/ddsi/q_entity.h"
 #include "dds/ddsi/q_whc.h"
+#include "dds/ddsi/ddsi_serdata.h"
 #include "dds__entity.h"
+#include "dds__writer.h"
 
 #include "test_common.h"
 
@@ -141,7 +144,7 @@ static void check_whc_state(dds_entity_t writer, seqno_t exp_min, seqno_t exp_ma
 #define KA DDS_HISTORY_KEEP_ALL
 #define KL DDS_HISTORY_KEEP_LAST
 static void test_whc_end_state(dds_durability_kind_t d, dds_reliability_kind_t r, dds_history_kind_t h, int32_t hd, dds_history_kind_t dh,
-    int32_t dhd, bool lrd, bool rrd, int32_t ni, bool k, bool dl)
+    int32_t dhd, bool lrd, bool rrd, int32_t ni, bool k, bool dl, bool compact)
 {
   char name[100];
   Space_Type1 sample = { 0, 0, 0 };
@@ -152,7 +155,8 @@ static void test_whc_end_state(dds_durability_kind_t d, dds_reliability_kind_t r
   dds_return_t ret;
   int32_t s, i;
 
-  printf ("test_whc_end_state: %s, %s, %s(%d), durability %s(%d), readers: %u local, %u remote, instances: %"PRId32", key %u, deadline %"PRId64"\n",
+  printf ("test_whc_end_state: %s%s, %s, %s(%d), durability %s(%d), readers: %u local, %u remote, instances: %"PRId32", key %u, deadline %"PRId64"\n",
+      compact ? "compact, " : "",
       d == V ? "volatile" : "TL",
       r == BE ? "best-effort" : "reliable",
       h == KA ? "keep-all" : "keep-last", h == KA ? 0 : hd,
@@ -165,6 +169,10 @@ static void test_whc_end_state(dds_durability_kind_t d, dds_reliability_kind_t r
   dds_qset_history (g_qos, h, h == KA ? 0 : hd);
   dds_qset_deadline (g_qos, dl ? DEADLINE_DURATION : DDS_INFINITY);
   dds_qset_durability_service (g_qos, 0, dh, dh == KA ? 0 : dhd, DDS_LENGTH_UNLIMITED, DDS_LENGTH_UNLIMITED, DDS_LENGTH_UNLIMITED);
+  if (compact)
+    dds_qset_prop (g_qos, DDS_WRITER_WHC_COMPACT_PROPERTY, "true");
+  else
+    dds_qunset_prop (g_qos, DDS_WRITER_WHC_COMPACT_PROPERTY);
 
   create_unique_topic_name ("ddsc_whc_end_state_test", name, sizeof name);
   topic = dds_create_topic (g_participant, k ? &Space_Type1_desc : &Space_Type3_desc, name, NULL, NULL);
@@ -245,7 +253,7 @@ static void test_whc_end_state(dds_durability_kind_t d, dds_reliability_kind_t r
 }
 
 #define ARRAY_LEN(A) ((int32_t)(sizeof(A) / sizeof(A[0])))
-CU_Test(ddsc_whc, check_end_state, .init=whc_init, .fini=whc_fini, .timeout=30)
+static void test_whc_end_states (bool compact)
 {
   dds_durability_kind_t dur[] = {V, TL};
   dds_reliability_kind_t rel[] = {BE, R};
@@ -262,6 +270,8 @@ CU_Test(ddsc_whc, check_end_state, .init=whc_init, .fini=whc_fini, .timeout=30)
 #else
   bool deadline[] = {false};
 #endif
+  /* compact WHC falls back to the default one if a deadline is set */
+  const int32_t n_deadline = compact ? 1 : ARRAY_LEN(deadline);
   int32_t i_d, i_r, i_h, i_hd, i_dh, i_dhd, i_lrd, i_rrd, i_ni, i_k, i_dl;
 
   for (i_d = 0; i_d < ARRAY_LEN(dur); i_d++)
@@ -274,7 +284,7 @@ CU_Test(ddsc_whc, check_end_state, .init=whc_init, .fini=whc_fini, .timeout=30)
                 for (i_rrd = 0; i_rrd < ARRAY_LEN(rem_rd); i_rrd++)
                   for (i_ni = 0; i_ni < ARRAY_LEN(n_inst); i_ni++)
                     for (i_k = 0; i_k < ARRAY_LEN(keyed); i_k++)
-                      for (i_dl = 0; i_dl < ARRAY_LEN(deadline); i_dl++)
+                      for (i_dl = 0; i_dl < n_deadline; i_dl++)
                       {
                         if (rel[i_r] == BE && dur[i_d] == TL)
                           continue;
@@ -285,11 +295,363 @@ CU_Test(ddsc_whc, check_end_state, .init=whc_init, .fini=whc_fini, .timeout=30)
                         else
                         {
                           test_whc_end_state (dur[i_d], rel[i_r], hist[i_h], hist_depth[i_hd], dhist[i_dh], dhist_depth[i_dhd],
-                              loc_rd[i_lrd], rem_rd[i_rrd], keyed[i_k] ? n_inst[i_ni] : 1, keyed[i_k], deadline[i_dl]);
+                              loc_rd[i_lrd], rem_rd[i_rrd], keyed[i_k] ? n_inst[i_ni] : 1, keyed[i_k], deadline[i_dl], compact);
                         }
                       }
 }
 
+CU_Test(ddsc_whc, check_end_state, .init=whc_init, .fini=whc_fini, .timeout=30)
+{
+  test_whc_end_states (false);
+}
+
+CU_Test(ddsc_whc, check_end_state_compact, .init=whc_init, .fini=whc_fini, .timeout=30)
+{
+  test_whc_end_states (true);
+}
+
+static uint64_t whc_bytes_per_sample (bool compact, int32_t ninst)
+{
+  char name[100];
+  Space_Type1 sample = { 0, 0, 0 };
+  dds_return_t ret;
+  dds_qset_durability (g_qos, TL);
+  dds_qset_reliability (g_qos, R, DDS_INFINITY);
+  dds_qset_history (g_qos, KL, 1);
+  dds_qset_deadline (g_qos, DDS_INFINITY);
+  dds_qset_durability_service (g_qos, 0, KL, 1, DDS_LENGTH_UNLIMITED, DDS_LENGTH_UNLIMITED, DDS_LENGTH_UNLIMITED);
+  if (compact)
+    dds_qset_prop (g_qos, DDS_WRITER_WHC_COMPACT_PROPERTY, "true");
+  else
+    dds_qunset_prop (g_qos, DDS_WRITER_WHC_COMPACT_PROPERTY);
+  create_unique_topic_name ("ddsc_whc_bytes_per_sample_test", name, sizeof name);
+  const dds_entity_t topic = dds_create_topic (g_participant, &Space_Type1_desc, name, NULL, NULL);
+  CU_ASSERT_FATAL (topic > 0);
+  const dds_entity_t writer = dds_create_writer (g_publisher, topic, g_qos, NULL);
+  CU_ASSERT_FATAL (writer > 0);
+  /* two rounds so that the first sample of each instance has been replaced */
+  for (int32_t s = 0; s < 2 * ninst; s++)
+  {
+    sample.long_1 = s % ninst;
+    sample.long_2 = s;
+    ret = dds_write (writer, &sample);
+    CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+  }
+  check_whc_state (writer, ninst + 1, 2 * ninst);
+
+  struct dds_statistics *stat = dds_create_statistics (writer);
+  CU_ASSERT_FATAL (stat != NULL);
+  ret = dds_refresh_statistics (stat);
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+  const struct dds_stat_keyvalue *kv = dds_lookup_statistic (stat, "whc_bytes_per_sample");
+  CU_ASSERT_FATAL (kv != NULL && kv->kind == DDS_STAT_KIND_UINT64);
+  const uint64_t bps = kv->u.u64;
+  dds_delete_statistics (stat);
+  dds_delete (writer);
+  dds_delete (topic);
+  return bps;
+}
+
+CU_Test(ddsc_whc, compact_bytes_per_sample, .init=whc_init, .fini=whc_fini)
+{
+  const uint64_t bps_default = whc_bytes_per_sample (false, 1000);
+  const uint64_t bps_compact = whc_bytes_per_sample (true, 1000);
+  CU_ASSERT_FATAL (bps_compact > 0);
+  CU_ASSERT_FATAL (bps_compact < bps_default);
+}
+
+#define LOSSY_SAMPLE_COUNT 200
+#define LOSSY_NINST 3
+
+static bool borrow_whc_sample (dds_entity_t writer, seqno_t seq, Space_Type1 *sample, uint32_t *rexmit_count)
+{
+  struct dds_entity *wr_entity;
+  struct writer *wr;
+  struct whc_borrowed_sample bs;
+  bool found;
+  CU_ASSERT_EQUAL_FATAL(dds_entity_pin(writer, &wr_entity), 0);
+  thread_state_awake(lookup_thread_state(), &wr_entity->m_domain->gv);
+  wr = entidx_lookup_writer_guid(wr_entity->m_domain->gv.entity_index, &wr_entity->m_guid);
+  CU_ASSERT_FATAL(wr != NULL);
+  assert(wr != NULL); /* for Clang's static analyzer */
+  if ((found = whc_borrow_sample (wr->whc, seq, &bs)))
+  {
+    CU_ASSERT_FATAL (bs.seq == seq);
+    CU_ASSERT_FATAL (ddsi_serdata_to_sample (bs.serdata, sample, NULL, NULL));
+    *rexmit_count = bs.rexmit_count;
+    whc_return_sample (wr->whc, &bs, false);
+  }
+  thread_state_asleep(lookup_thread_state());
+  dds_entity_unpin(wr_entity);
+  return found;
+}
+
+CU_Test(ddsc_whc, compact_lossy, .timeout=60)
+{
+  /* Writing over a lossy network to a remote reliable reader exercises the compact WHC
+     for retransmits and acks; a transient-local keep-all writer keeps everything so that
+     the contents of the WHC can be checked afterwards */
+  const char *config = "${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}\
+    <Discovery>\
+      <ExternalDomainId>0</ExternalDomainId>\
+    </Discovery>\
+    <Internal>\
+      <Test>\
+        <XmitLossiness>100</XmitLossiness>\
+      </Test>\
+    </Internal>";
+  char *conf_pub = ddsrt_expand_envvars (config, DDS_DOMAINID_PUB);
+  char *conf_sub = ddsrt_expand_envvars (config, DDS_DOMAINID_SUB);
+  const dds_entity_t pub_dom = dds_create_domain (DDS_DOMAINID_PUB, conf_pub);
+  CU_ASSERT_FATAL (pub_dom > 0);
+  const dds_entity_t sub_dom = dds_create_domain (DDS_DOMAINID_SUB, conf_sub);
+  CU_ASSERT_FATAL (sub_dom > 0);
+  dds_free (conf_pub);
+  dds_free (conf_sub);
+  const dds_entity_t pub_pp = dds_create_participant (DDS_DOMAINID_PUB, NULL, NULL);
+  CU_ASSERT_FATAL (pub_pp > 0);
+  const dds_entity_t sub_pp = dds_create_participant (DDS_DOMAINID_SUB, NULL, NULL);
+  CU_ASSERT_FATAL (sub_pp > 0);
+
+  char name[100];
+  create_unique_topic_name ("ddsc_whc_compact_lossy", name, sizeof name);
+  const dds_entity_t pub_tp = dds_create_topic (pub_pp, &Space_Type1_desc, name, NULL, NULL);
+  CU_ASSERT_FATAL (pub_tp > 0);
+  const dds_entity_t sub_tp = dds_create_topic (sub_pp, &Space_Type1_desc, name, NULL, NULL);
+  CU_ASSERT_FATAL (sub_tp > 0);
+
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_durability (qos, TL);
+  dds_qset_reliability (qos, R, DDS_INFINITY);
+  dds_qset_history (qos, KA, 0);
+  dds_qset_durability_service (qos, 0, KA, 0, DDS_LENGTH_UNLIMITED, DDS_LENGTH_UNLIMITED, DDS_LENGTH_UNLIMITED);
+  dds_qset_prop (qos, DDS_WRITER_WHC_COMPACT_PROPERTY, "true");
+  const dds_entity_t writer = dds_create_writer (pub_pp, pub_tp, qos, NULL);
+  CU_ASSERT_FATAL (writer > 0);
+  const dds_entity_t reader = create_and_sync_reader (sub_pp, sub_tp, qos, writer);
+  dds_delete_qos (qos);
+
+  dds_return_t ret;
+  for (int32_t s = 0; s < LOSSY_SAMPLE_COUNT; s++)
+  {
+    const Space_Type1 sample = { .long_1 = s % LOSSY_NINST, .long_2 = s, .long_3 = s / LOSSY_NINST };
+    ret = dds_write (writer, &sample);
+    CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+  }
+
+  /* reader must get everything, in order, regardless of the losses; samples are
+     returned grouped by instance, so check the order per instance */
+  int32_t next[LOSSY_NINST], nrecv = 0;
+  for (int32_t i = 0; i < LOSSY_NINST; i++)
+    next[i] = i;
+  const dds_time_t tend = dds_time () + DDS_SECS (30);
+  while (nrecv < LOSSY_SAMPLE_COUNT && dds_time () < tend)
+  {
+    Space_Type1 sample;
+    void *raw = &sample;
+    dds_sample_info_t si;
+    if ((ret = dds_take (reader, &raw, &si, 1, 1)) < 0)
+      CU_FAIL_FATAL ("take failed");
+    else if (ret == 0)
+      dds_sleepfor (DDS_MSECS (10));
+    else if (si.valid_data)
+    {
+      CU_ASSERT_FATAL (sample.long_1 >= 0 && sample.long_1 < LOSSY_NINST);
+      CU_ASSERT_FATAL (sample.long_2 == next[sample.long_1]);
+      next[sample.long_1] += LOSSY_NINST;
+      nrecv++;
+    }
+  }
+  CU_ASSERT_FATAL (nrecv == LOSSY_SAMPLE_COUNT);
+
+  /* everything gets acked eventually, but a transient-local writer keeps it all */
+  struct whc_state whcst;
+  do {
+    get_writer_whc_state (writer, &whcst);
+    if (whcst.unacked_bytes > 0)
+      dds_sleepfor (DDS_MSECS (10));
+  } while (whcst.unacked_bytes > 0 && dds_time () < tend);
+  CU_ASSERT_FATAL (whcst.unacked_bytes == 0);
+  CU_ASSERT_FATAL (whcst.min_seq == 1);
+  CU_ASSERT_FATAL (whcst.max_seq == LOSSY_SAMPLE_COUNT);
+
+  /* samples can be retrieved by sequence number and some must have been retransmitted */
+  uint32_t total_rexmits = 0;
+  for (int32_t s = 0; s < LOSSY_SAMPLE_COUNT; s++)
+  {
+    Space_Type1 sample;
+    uint32_t rexmit_count = 0;
+    CU_ASSERT_FATAL (borrow_whc_sample (writer, s + 1, &sample, &rexmit_count));
+    CU_ASSERT_FATAL (sample.long_1 == s % LOSSY_NINST && sample.long_2 == s && sample.long_3 == s / LOSSY_NINST);
+    total_rexmits += rexmit_count;
+  }
+  CU_ASSERT_FATAL (total_rexmits > 0);
+
+  struct dds_statistics *stat = dds_create_statistics (writer);
+  CU_ASSERT_FATAL (stat != NULL);
+  ret = dds_refresh_statistics (stat);
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+  const struct dds_stat_keyvalue *kv = dds_lookup_statistic (stat, "rexmit_bytes");
+  CU_ASSERT_FATAL (kv != NULL && kv->kind == DDS_STAT_KIND_UINT64 && kv->u.u64 > 0);
+  dds_delete_statistics (stat);
+
+  ret = dds_delete (pub_dom);
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+  ret = dds_delete (sub_dom);
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+}
+
+#define ACK_COALESCING_DELAY DDS_MSECS (200)
+#define ACK_COALESCING_SAMPLE_COUNT 1000
+
+static void write_seq (dds_entity_t writer, int32_t seq)
+{
+  const Space_Type1 sample = { .long_1 = 0, .long_2 = seq, .long_3 = 0 };
+  const dds_return_t ret = dds_write (writer, &sample);
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+}
+
+static int32_t take_all (dds_entity_t reader, int32_t next, dds_time_t tend)
+{
+  while (dds_time () < tend)
+  {
+    Space_Type1 sample;
+    void *raw = &sample;
+    dds_sample_info_t si;
+    const dds_return_t ret = dds_take (reader, &raw, &si, 1, 1);
+    CU_ASSERT_FATAL (ret >= 0);
+    if (ret == 0)
+      return next;
+    CU_ASSERT_FATAL (si.valid_data && sample.long_2 == next);
+    next++;
+  }
+  return next;
+}
+
+static dds_duration_t wait_for_whc_drained (dds_entity_t writer, dds_time_t tend)
+{
+  const dds_time_t t0 = dds_time ();
+  struct whc_state whcst;
+  get_writer_whc_state (writer, &whcst);
+  while (whcst.unacked_bytes > 0 && dds_time () < tend)
+  {
+    dds_sleepfor (DDS_MSECS (1));
+    get_writer_whc_state (writer, &whcst);
+  }
+  CU_ASSERT_FATAL (whcst.unacked_bytes == 0);
+  return dds_time () - t0;
+}
+
+CU_Test(ddsc_whc, ack_coalescing, .timeout=60)
+{
+  /* With Internal/AckCoalescingDelay set, an ACK only updates the state of the remote
+     reader and the acknowledged samples are dropped from the WHC by a timed event: the WHC
+     must drain after that window, a writer throttled because its WHC is full must still
+     be unblocked and a lingering writer must still be deleted once everything is acked.
+     The watermarks are small and fixed to get throttled, and the linger duration is long
+     so that deleting the writer only completes in time because the data was acked. */
+  const char *config = "${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}\
+    <Discovery>\
+      <ExternalDomainId>0</ExternalDomainId>\
+    </Discovery>\
+    <Internal>\
+      <AckCoalescingDelay>200 ms</AckCoalescingDelay>\
+      <WriterLingerDuration>20 s</WriterLingerDuration>\
+      <Watermarks>\
+        <WhcLow>1 kB</WhcLow>\
+        <WhcHigh>2 kB</WhcHigh>\
+        <WhcHighInit>2 kB</WhcHighInit>\
+        <WhcAdaptive>false</WhcAdaptive>\
+      </Watermarks>\
+    </Internal>";
+  char *conf_pub = ddsrt_expand_envvars (config, DDS_DOMAINID_PUB);
+  char *conf_sub = ddsrt_expand_envvars (config, DDS_DOMAINID_SUB);
+  const dds_entity_t pub_dom = dds_create_domain (DDS_DOMAINID_PUB, conf_pub);
+  CU_ASSERT_FATAL (pub_dom > 0);
+  const dds_entity_t sub_dom = dds_create_domain (DDS_DOMAINID_SUB, conf_sub);
+  CU_ASSERT_FATAL (sub_dom > 0);
+  dds_free (conf_pub);
+  dds_free (conf_sub);
+  const dds_entity_t pub_pp = dds_create_participant (DDS_DOMAINID_PUB, NULL, NULL);
+  CU_ASSERT_FATAL (pub_pp > 0);
+  const dds_entity_t sub_pp = dds_create_participant (DDS_DOMAINID_SUB, NULL, NULL);
+  CU_ASSERT_FATAL (sub_pp > 0);
+
+  char name[100];
+  create_unique_topic_name ("ddsc_whc_ack_coalescing", name, sizeof name);
+  const dds_entity_t pub_tp = dds_create_topic (pub_pp, &Space_Type1_desc, name, NULL, NULL);
+  CU_ASSERT_FATAL (pub_tp > 0);
+  const dds_entity_t sub_tp = dds_create_topic (sub_pp, &Space_Type1_desc, name, NULL, NULL);
+  CU_ASSERT_FATAL (sub_tp > 0);
+
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_durability (qos, V);
+  dds_qset_reliability (qos, R, DDS_SECS (10));
+  dds_qset_history (qos, KA, 0);
+  const dds_entity_t writer = dds_create_writer (pub_pp, pub_tp, qos, NULL);
+  CU_ASSERT_FATAL (writer > 0);
+  dds_return_t ret = dds_set_status_mask (writer, DDS_PUBLICATION_MATCHED_STATUS);
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+  const dds_entity_t reader = create_and_sync_reader (sub_pp, sub_tp, qos, writer);
+  dds_delete_qos (qos);
+
+  const dds_time_t tend = dds_time () + DDS_SECS (30);
+  int32_t seq = 0, next = 0;
+
+  /* the sample is acked almost immediately, but stays in the WHC for the window */
+  write_seq (writer, seq++);
+  const dds_duration_t tdrain = wait_for_whc_drained (writer, tend);
+  printf (" -- WHC drained after %"PRId64" ns\n", tdrain);
+  CU_ASSERT_FATAL (tdrain >= ACK_COALESCING_DELAY / 2);
+  next = take_all (reader, next, tend);
+  CU_ASSERT_FATAL (next == seq);
+
+  /* the WHC fills up many times over, writing times out if the writer isn't unblocked
+     once the samples are dropped */
+  while (seq < ACK_COALESCING_SAMPLE_COUNT)
+  {
+    write_seq (writer, seq++);
+    next = take_all (reader, next, tend);
+  }
+  struct dds_statistics *stat = dds_create_statistics (writer);
+  CU_ASSERT_FATAL (stat != NULL);
+  ret = dds_refresh_statistics (stat);
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+  const struct dds_stat_keyvalue *kv = dds_lookup_statistic (stat, "throttle_count");
+  CU_ASSERT_FATAL (kv != NULL && kv->kind == DDS_STAT_KIND_UINT32);
+  printf (" -- writer throttled %"PRIu32" times\n", kv->u.u32);
+  CU_ASSERT_FATAL (kv->u.u32 > 0);
+  dds_delete_statistics (stat);
+  (void) wait_for_whc_drained (writer, tend);
+
+  /* deleting a writer with unacked data makes it linger until it is acked */
+  for (int32_t i = 0; i < 10; i++)
+    write_seq (writer, seq++);
+  struct whc_state whcst;
+  get_writer_whc_state (writer, &whcst);
+  CU_ASSERT_FATAL (whcst.unacked_bytes > 0);
+  const dds_time_t tdel = dds_time ();
+  ret = dds_delete (writer);
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+  printf (" -- deleting lingering writer took %"PRId64" ns\n", dds_time () - tdel);
+  CU_ASSERT_FATAL (dds_time () - tdel < DDS_SECS (10));
+  while (next < seq && dds_time () < tend)
+  {
+    next = take_all (reader, next, tend);
+    dds_sleepfor (DDS_MSECS (10));
+  }
+  CU_ASSERT_FATAL (next == seq);
+
+  ret = dds_delete (pub_dom);
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+  ret = dds_delete (sub_dom);
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+}
+
+#undef ACK_COALESCING_SAMPLE_COUNT
+#undef ACK_COALESCING_DELAY
+#undef LOSSY_NINST
+#undef LOSSY_SAMPLE_COUNT
 #undef ARRAY_LEN
 #undef V
 #undef TL
@@ -0,0 +1,191 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <assert.h>
+
+#include "dds/dds.h"
+#include "dds/ddsrt/environ.h"
+#include "dds/ddsrt/random.h"
+#include "dds/ddsc/dds_statistics.h"
+#include "dds/ddsi/ddsi_entity_index.h"
+#include "dds/ddsi/ddsi_wraddrset.h"
+#include "dds/ddsi/q_addrset.h"
+#include "dds/ddsi/q_entity.h"
+#include "dds__entity.h"
+
+#include "test_common.h"
+
+#define DDS_DOMAINID_PUB 0
+#define DDS_DOMAINID_SUB 1
+#define DDS_CONFIG_NO_PORT_GAIN "${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}<Discovery><ExternalDomainId>0</ExternalDomainId></Discovery>"
+/* each participant gets its own unicast port, so that the proxy readers in different
+   participants have different locators */
+#define DDS_CONFIG_MANY_SOCKETS DDS_CONFIG_NO_PORT_GAIN "<Compatibility><ManySocketsMode>many</ManySocketsMode></Compatibility>"
+
+#define N_PARTICIPANTS 4
+#define N_READERS_PER_PP 2
+#define N_OPS 40
+
+static uint32_t get_matched_count (dds_entity_t writer)
+{
+  dds_publication_matched_status_t st;
+  dds_return_t rc = dds_get_publication_matched_status (writer, &st);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  return st.current_count;
+}
+
+static void wait_for_matched_count (dds_entity_t writer, uint32_t count)
+{
+  const dds_time_t tend = dds_time () + DDS_SECS (10);
+  while (get_matched_count (writer) != count && dds_time () < tend)
+    dds_sleepfor (DDS_MSECS (10));
+  CU_ASSERT_FATAL (get_matched_count (writer) == count);
+}
+
+#define MAX_LOCS 32
+struct locs {
+  uint32_t n;
+  ddsi_xlocator_t ls[MAX_LOCS];
+};
+
+static void collect_locator (const ddsi_xlocator_t *loc, void *varg)
+{
+  struct locs *locs = varg;
+  CU_ASSERT_FATAL (locs->n < MAX_LOCS);
+  locs->ls[locs->n++] = *loc;
+}
+
+static bool addrset_equal (struct addrset *a, struct addrset *b)
+{
+  /* addresses are enumerated in a fixed order, unicast addresses first */
+  struct locs la = { .n = 0 }, lb = { .n = 0 };
+  addrset_forall (a, collect_locator, &la);
+  addrset_forall (b, collect_locator, &lb);
+  if (la.n != lb.n)
+    return false;
+  for (uint32_t i = 0; i < la.n; i++)
+    if (compare_xlocators (&la.ls[i], &lb.ls[i]) != 0)
+      return false;
+  return true;
+}
+#undef MAX_LOCS
+
+static void check_writer_addrset (dds_entity_t writer, bool expect_incremental)
+{
+  struct dds_entity *wr_entity;
+  struct writer *wr;
+  CU_ASSERT_EQUAL_FATAL (dds_entity_pin (writer, &wr_entity), 0);
+  thread_state_awake (lookup_thread_state (), &wr_entity->m_domain->gv);
+  wr = entidx_lookup_writer_guid (wr_entity->m_domain->gv.entity_index, &wr_entity->m_guid);
+  CU_ASSERT_FATAL (wr != NULL);
+  assert (wr != NULL); /* for Clang's static analyzer */
+  ddsrt_mutex_lock (&wr->e.lock);
+  struct addrset *full = compute_writer_addrset (wr);
+  const bool eq = addrset_equal (full, wr->as);
+  const bool incremental = (wr->as_refs != NULL);
+  ddsrt_mutex_unlock (&wr->e.lock);
+  unref_addrset (full);
+  thread_state_asleep (lookup_thread_state ());
+  dds_entity_unpin (wr_entity);
+  CU_ASSERT_FATAL (eq);
+  if (expect_incremental)
+    CU_ASSERT_FATAL (incremental);
+}
+
+static uint64_t get_update_count (dds_entity_t participant)
+{
+  struct dds_statistics *stat = dds_create_statistics (participant);
+  CU_ASSERT_FATAL (stat != NULL);
+  dds_return_t rc = dds_refresh_statistics (stat);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  const struct dds_stat_keyvalue *kv = dds_lookup_statistic (stat, "wraddrset_update_count");
+  CU_ASSERT_FATAL (kv != NULL && kv->kind == DDS_STAT_KIND_UINT64);
+  const uint64_t n = kv->u.u64;
+  dds_delete_statistics (stat);
+  return n;
+}
+
+CU_Test (ddsc_wraddrset, incremental_vs_full, .timeout = 60)
+{
+  char *conf_pub = ddsrt_expand_envvars (DDS_CONFIG_NO_PORT_GAIN, DDS_DOMAINID_PUB);
+  char *conf_sub = ddsrt_expand_envvars (DDS_CONFIG_MANY_SOCKETS, DDS_DOMAINID_SUB);
+  const dds_entity_t pub_dom = dds_create_domain (DDS_DOMAINID_PUB, conf_pub);
+  CU_ASSERT_FATAL (pub_dom > 0);
+  const dds_entity_t sub_dom = dds_create_domain (DDS_DOMAINID_SUB, conf_sub);
+  CU_ASSERT_FATAL (sub_dom > 0);
+  dds_free (conf_pub);
+  dds_free (conf_sub);
+
+  char name[100];
+  create_unique_topic_name ("ddsc_wraddrset", name, sizeof name);
+  const dds_entity_t pub_pp = dds_create_participant (DDS_DOMAINID_PUB, NULL, NULL);
+  CU_ASSERT_FATAL (pub_pp > 0);
+  const dds_entity_t pub_tp = dds_create_topic (pub_pp, &Space_Type1_desc, name, NULL, NULL);
+  CU_ASSERT_FATAL (pub_tp > 0);
+  const dds_entity_t writer = dds_create_writer (pub_pp, pub_tp, NULL, NULL);
+  CU_ASSERT_FATAL (writer > 0);
+
+  dds_entity_t sub_pps[N_PARTICIPANTS], sub_tps[N_PARTICIPANTS];
+  for (int i = 0; i < N_PARTICIPANTS; i++)
+  {
+    sub_pps[i] = dds_create_participant (DDS_DOMAINID_SUB, NULL, NULL);
+    CU_ASSERT_FATAL (sub_pps[i] > 0);
+    sub_tps[i] = dds_create_topic (sub_pps[i], &Space_Type1_desc, name, NULL, NULL);
+    CU_ASSERT_FATAL (sub_tps[i] > 0);
+  }
+
+  /* Randomly create and delete readers, some of them sharing locators because they
+     are in the same participant, and check that the incrementally maintained address
+     set of the writer is the same as one computed from scratch */
+  dds_entity_t readers[N_PARTICIPANTS * N_READERS_PER_PP] = { 0 };
+  uint32_t nreaders = 0;
+  ddsrt_prng_t prng;
+  ddsrt_prng_init_simple (&prng, 1);
+  const uint64_t update_count0 = get_update_count (pub_pp);
+  for (int op = 0; op < N_OPS; op++)
+  {
+    const uint32_t i = ddsrt_prng_random (&prng) % (N_PARTICIPANTS * N_READERS_PER_PP);
+    if (readers[i] == 0)
+    {
+      readers[i] = dds_create_reader (sub_pps[i / N_READERS_PER_PP], sub_tps[i / N_READERS_PER_PP], NULL, NULL);
+      CU_ASSERT_FATAL (readers[i] > 0);
+      nreaders++;
+    }
+    else
+    {
+      dds_return_t rc = dds_delete (readers[i]);
+      CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+      readers[i] = 0;
+      nreaders--;
+    }
+    wait_for_matched_count (writer, nreaders);
+    check_writer_addrset (writer, true);
+  }
+  CU_ASSERT_FATAL (get_update_count (pub_pp) > update_count0);
+
+  /* removing all of them must result in an empty address set */
+  for (uint32_t i = 0; i < N_PARTICIPANTS * N_READERS_PER_PP; i++)
+  {
+    if (readers[i] != 0)
+    {
+      dds_return_t rc = dds_delete (readers[i]);
+      CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+      nreaders--;
+      wait_for_matched_count (writer, nreaders);
+      check_writer_addrset (writer, true);
+    }
+  }
+
+  dds_return_t rc = dds_delete (pub_dom);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  rc = dds_delete (sub_dom);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+}
@@ -13,6 +13,7 @@
 
 #include "CUnit/Theory.h"
 #include "dds/dds.h"
+#include "dds/ddsc/dds_statistics.h"
 #include "RoundTrip.h"
 #include "Space.h"
 #include "dds/ddsrt/misc.h"
@@ -158,3 +159,54 @@ CU_Test(ddsc_write, simpletypes)
     dds_delete(top);
     dds_delete(par);
 }
+
+CU_Test(ddsc_write, serdata_cache)
+{
+    dds_return_t status;
+    dds_entity_t par, top, wri, rea;
+    dds_qos_t *qos;
+    Space_Type1 sample = { 1, 0, 0 };
+
+    par = dds_create_participant(DDS_DOMAIN_DEFAULT, NULL, NULL);
+    CU_ASSERT_FATAL(par > 0);
+    top = dds_create_topic(par, &Space_Type1_desc, "SerdataCache", NULL, NULL);
+    CU_ASSERT_FATAL(top > 0);
+    qos = dds_create_qos();
+    dds_qset_history(qos, DDS_HISTORY_KEEP_LAST, 1);
+    rea = dds_create_reader(par, top, qos, NULL);
+    CU_ASSERT_FATAL(rea > 0);
+    dds_qset_prop(qos, "org.eclipse.cyclonedds.writer.serdata_cache", "4");
+    wri = dds_create_writer(par, top, qos, NULL);
+    CU_ASSERT_FATAL(wri > 0);
+    dds_delete_qos(qos);
+
+    /* identical samples: once the reader and the WHC have dropped the older ones,
+       the cached serdata gets reused, but every write must still arrive with its
+       own timestamp */
+    for (int32_t i = 0; i < 10; i++)
+    {
+        sample.long_2 = i / 4;
+        status = dds_write_ts(wri, &sample, DDS_SECS(1) + i);
+        CU_ASSERT_EQUAL_FATAL(status, DDS_RETCODE_OK);
+
+        Space_Type1 rd_sample;
+        void *ptr = &rd_sample;
+        dds_sample_info_t si;
+        int32_t n = dds_take(rea, &ptr, &si, 1, 1);
+        CU_ASSERT_EQUAL_FATAL(n, 1);
+        CU_ASSERT_EQUAL(rd_sample.long_1, 1);
+        CU_ASSERT_EQUAL(rd_sample.long_2, i / 4);
+        CU_ASSERT_EQUAL(si.source_timestamp, DDS_SECS(1) + i);
+    }
+
+    struct dds_statistics *stat = dds_create_statistics(wri);
+    CU_ASSERT_FATAL(stat != NULL);
+    status = dds_refresh_statistics(stat);
+    CU_ASSERT_EQUAL_FATAL(status, DDS_RETCODE_OK);
+    const struct dds_stat_keyvalue *kv = dds_lookup_statistic(stat, "serdata_cache_hits");
+    CU_ASSERT_FATAL(kv != NULL);
+    CU_ASSERT(kv->u.u64 > 0 && kv->u.u64 < 10);
+    dds_delete_statistics(stat);
+
+    dds_delete(par);
+}
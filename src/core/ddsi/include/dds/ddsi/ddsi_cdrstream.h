@@ -12,6 +12,10 @@
 #ifndef DDSI_CDRSTREAM_H
 #define DDSI_CDRSTREAM_H
 
+#include <assert.h>
+#include <string.h>
+
+#include "dds/ddsrt/bswap.h"
 #include "dds/ddsi/ddsi_serdata.h"
 #include "dds/ddsi/ddsi_serdata_default.h"
 
@@ -40,14 +44,198 @@ DDS_EXPORT void dds_ostream_fini (dds_ostream_t * __restrict st);
 DDS_EXPORT void dds_ostreamBE_init (dds_ostreamBE_t * __restrict st, uint32_t size);
 DDS_EXPORT void dds_ostreamBE_fini (dds_ostreamBE_t * __restrict st);
 
-bool dds_stream_normalize (void * __restrict data, uint32_t size, bool bswap, const struct ddsi_sertype_default * __restrict type, bool just_key);
+/* Stream primitives, available inline for the type-specialized (de)serializers
+   that idlc generates with "-f native-serializers" */
+
+DDS_EXPORT void dds_ostream_grow (dds_ostream_t * __restrict st, uint32_t size);
+
+DDS_INLINE_EXPORT inline void dds_cdr_resize (dds_ostream_t * __restrict s, uint32_t l)
+{
+  if (s->m_size < l + s->m_index)
+    dds_ostream_grow (s, l);
+}
 
-void dds_stream_write_sample (dds_ostream_t * __restrict os, const void * __restrict data, const struct ddsi_sertype_default * __restrict type);
-void dds_stream_read_sample (dds_istream_t * __restrict is, void * __restrict data, const struct ddsi_sertype_default * __restrict type);
-void dds_stream_free_sample (void *data, const uint32_t * ops);
+DDS_INLINE_EXPORT inline void dds_cdr_alignto (dds_istream_t * __restrict s, uint32_t a)
+{
+  s->m_index = (s->m_index + a - 1) & ~(a - 1);
+  assert (s->m_index < s->m_size);
+}
+
+DDS_INLINE_EXPORT inline uint32_t dds_cdr_alignto_clear_and_resize (dds_ostream_t * __restrict s, uint32_t a, uint32_t extra)
+{
+  const uint32_t m = s->m_index % a;
+  if (m == 0)
+  {
+    dds_cdr_resize (s, extra);
+    return 0;
+  }
+  else
+  {
+    const uint32_t pad = a - m;
+    dds_cdr_resize (s, pad + extra);
+    for (uint32_t i = 0; i < pad; i++)
+      s->m_buffer[s->m_index++] = 0;
+    return pad;
+  }
+}
+
+DDS_INLINE_EXPORT inline uint32_t dds_cdr_alignto_clear_and_resize_be (dds_ostreamBE_t * __restrict s, uint32_t a, uint32_t extra)
+{
+  return dds_cdr_alignto_clear_and_resize (&s->x, a, extra);
+}
+
+DDS_INLINE_EXPORT inline uint8_t dds_is_get1 (dds_istream_t * __restrict s)
+{
+  assert (s->m_index < s->m_size);
+  uint8_t v = *(s->m_buffer + s->m_index);
+  s->m_index++;
+  return v;
+}
+
+DDS_INLINE_EXPORT inline uint16_t dds_is_get2 (dds_istream_t * __restrict s)
+{
+  dds_cdr_alignto (s, 2);
+  uint16_t v = * ((uint16_t *) (s->m_buffer + s->m_index));
+  s->m_index += 2;
+  return v;
+}
+
+DDS_INLINE_EXPORT inline uint32_t dds_is_get4 (dds_istream_t * __restrict s)
+{
+  dds_cdr_alignto (s, 4);
+  uint32_t v = * ((uint32_t *) (s->m_buffer + s->m_index));
+  s->m_index += 4;
+  return v;
+}
+
+DDS_INLINE_EXPORT inline uint64_t dds_is_get8 (dds_istream_t * __restrict s)
+{
+  dds_cdr_alignto (s, 8);
+  uint64_t v = * ((uint64_t *) (s->m_buffer + s->m_index));
+  s->m_index += 8;
+  return v;
+}
+
+DDS_INLINE_EXPORT inline void dds_is_get_bytes (dds_istream_t * __restrict s, void * __restrict b, uint32_t num, uint32_t elem_size)
+{
+  dds_cdr_alignto (s, elem_size);
+  memcpy (b, s->m_buffer + s->m_index, num * elem_size);
+  s->m_index += num * elem_size;
+}
+
+DDS_INLINE_EXPORT inline void dds_os_put1 (dds_ostream_t * __restrict s, uint8_t v)
+{
+  dds_cdr_resize (s, 1);
+  *((uint8_t *) (s->m_buffer + s->m_index)) = v;
+  s->m_index += 1;
+}
+
+DDS_INLINE_EXPORT inline void dds_os_put2 (dds_ostream_t * __restrict s, uint16_t v)
+{
+  dds_cdr_alignto_clear_and_resize (s, 2, 2);
+  *((uint16_t *) (s->m_buffer + s->m_index)) = v;
+  s->m_index += 2;
+}
+
+DDS_INLINE_EXPORT inline void dds_os_put4 (dds_ostream_t * __restrict s, uint32_t v)
+{
+  dds_cdr_alignto_clear_and_resize (s, 4, 4);
+  *((uint32_t *) (s->m_buffer + s->m_index)) = v;
+  s->m_index += 4;
+}
 
-uint32_t dds_stream_countops (const uint32_t * __restrict ops);
+DDS_INLINE_EXPORT inline void dds_os_put8 (dds_ostream_t * __restrict s, uint64_t v)
+{
+  dds_cdr_alignto_clear_and_resize (s, 8, 8);
+  *((uint64_t *) (s->m_buffer + s->m_index)) = v;
+  s->m_index += 8;
+}
+
+DDS_INLINE_EXPORT inline void dds_os_put1be (dds_ostreamBE_t * __restrict s, uint8_t v)
+{
+  dds_os_put1 (&s->x, v);
+}
+
+DDS_INLINE_EXPORT inline void dds_os_put2be (dds_ostreamBE_t * __restrict s, uint16_t v)
+{
+  dds_os_put2 (&s->x, ddsrt_toBE2u (v));
+}
+
+DDS_INLINE_EXPORT inline void dds_os_put4be (dds_ostreamBE_t * __restrict s, uint32_t v)
+{
+  dds_os_put4 (&s->x, ddsrt_toBE4u (v));
+}
+
+DDS_INLINE_EXPORT inline void dds_os_put8be (dds_ostreamBE_t * __restrict s, uint64_t v)
+{
+  dds_os_put8 (&s->x, ddsrt_toBE8u (v));
+}
+
+DDS_INLINE_EXPORT inline void dds_os_put_bytes (dds_ostream_t * __restrict s, const void * __restrict b, uint32_t l)
+{
+  dds_cdr_resize (s, l);
+  memcpy (s->m_buffer + s->m_index, b, l);
+  s->m_index += l;
+}
+
+DDS_INLINE_EXPORT inline void dds_os_put_bytes_aligned (dds_ostream_t * __restrict s, const void * __restrict b, uint32_t n, uint32_t a)
+{
+  const uint32_t l = n * a;
+  dds_cdr_alignto_clear_and_resize (s, a, l);
+  memcpy (s->m_buffer + s->m_index, b, l);
+  s->m_index += l;
+}
+
+/* Helpers for the type-specialized (de)serializers for the types they do not
+   expand inline; the normalize functions validate the input and convert it to
+   native endianness, like dds_stream_normalize does for the whole sample */
+
+DDS_EXPORT void dds_stream_write_string (dds_ostream_t * __restrict os, const char * __restrict val);
+DDS_EXPORT void dds_streamBE_write_string (dds_ostreamBE_t * __restrict os, const char * __restrict val);
+DDS_EXPORT char *dds_stream_reuse_string (dds_istream_t * __restrict is, char * __restrict str);
+DDS_EXPORT void dds_stream_reuse_string_bound (dds_istream_t * __restrict is, char * __restrict str, const uint32_t bound);
+DDS_EXPORT void dds_stream_skip_string (dds_istream_t * __restrict is);
+DDS_EXPORT void dds_stream_read_primseq (dds_istream_t * __restrict is, dds_sequence_t * __restrict seq, uint32_t elem_size);
+DDS_EXPORT void dds_stream_skip_primseq (dds_istream_t * __restrict is, uint32_t elem_size);
+DDS_EXPORT bool dds_stream_normalize_prim (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap, enum dds_stream_typecode type);
+DDS_EXPORT bool dds_stream_normalize_string (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap, size_t maxsz);
+DDS_EXPORT bool dds_stream_normalize_primarray (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap, uint32_t num, enum dds_stream_typecode type);
+DDS_EXPORT bool dds_stream_normalize_primseq (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap, enum dds_stream_typecode type);
+
+DDS_EXPORT bool dds_stream_normalize (void * __restrict data, uint32_t size, bool bswap, const struct ddsi_sertype_default * __restrict type, bool just_key);
+
+DDS_EXPORT void dds_stream_write_sample (dds_ostream_t * __restrict os, const void * __restrict data, const struct ddsi_sertype_default * __restrict type);
+DDS_EXPORT void dds_stream_read_sample (dds_istream_t * __restrict is, void * __restrict data, const struct ddsi_sertype_default * __restrict type);
+DDS_EXPORT void dds_stream_free_sample (void *data, const uint32_t * ops);
+
+DDS_EXPORT uint32_t dds_stream_countops (const uint32_t * __restrict ops);
 size_t dds_stream_check_optimize (const struct ddsi_sertype_default_desc * __restrict desc);
+
+/* Maximum number of runs in a copy plan: beyond that the interpreter is about as fast */
+#define DDS_STREAM_COPY_PLAN_MAX_RUNS 64u
+
+/* A run of primitives of the same size that is contiguous both in the sample and in the
+   CDR representation */
+struct dds_stream_copy_run {
+  uint32_t mem_off;   /* offset in the sample */
+  uint32_t cdr_off;   /* offset in the CDR representation */
+  uint32_t size;      /* number of bytes */
+  uint32_t elem_size; /* size of the primitives in the run, for byte swapping */
+};
+
+/* Copy plan for fixed-size types that have a different layout in memory and in CDR, e.g.,
+   because of padding following nested structs: (de)serialization and normalization then
+   reduce to a few memcpy calls/byte swaps.  Runs are in increasing CDR offset. */
+struct dds_stream_copy_plan {
+  uint32_t cdr_size;  /* size of the CDR representation */
+  uint32_t cdr_align; /* largest alignment needed in the CDR representation */
+  uint32_t nruns;
+  struct dds_stream_copy_run runs[];
+};
+
+/* Returns a copy plan (to be freed with ddsrt_free) if the type consists of primitives,
+   primitive arrays and arrays of such structs only, or NULL otherwise */
+DDS_EXPORT struct dds_stream_copy_plan *dds_stream_make_copy_plan (const struct ddsi_sertype_default_desc * __restrict desc);
 void dds_istream_from_serdata_default (dds_istream_t * __restrict s, const struct ddsi_serdata_default * __restrict d);
 void dds_ostream_from_serdata_default (dds_ostream_t * __restrict s, struct ddsi_serdata_default * __restrict d);
 void dds_ostream_add_to_serdata_default (dds_ostream_t * __restrict s, struct ddsi_serdata_default ** __restrict d);
@@ -55,9 +243,9 @@ void dds_ostreamBE_from_serdata_default (dds_ostreamBE_t * __restrict s, struct
 void dds_ostreamBE_add_to_serdata_default (dds_ostreamBE_t * __restrict s, struct ddsi_serdata_default ** __restrict d);
 
 void dds_stream_write_key (dds_ostream_t * __restrict os, const char * __restrict sample, const struct ddsi_sertype_default * __restrict type);
-void dds_stream_write_keyBE (dds_ostreamBE_t * __restrict os, const char * __restrict sample, const struct ddsi_sertype_default * __restrict type);
+DDS_EXPORT void dds_stream_write_keyBE (dds_ostreamBE_t * __restrict os, const char * __restrict sample, const struct ddsi_sertype_default * __restrict type);
 void dds_stream_extract_key_from_data (dds_istream_t * __restrict is, dds_ostream_t * __restrict os, const struct ddsi_sertype_default * __restrict type);
-void dds_stream_extract_keyBE_from_data (dds_istream_t * __restrict is, dds_ostreamBE_t * __restrict os, const struct ddsi_sertype_default * __restrict type);
+DDS_EXPORT void dds_stream_extract_keyBE_from_data (dds_istream_t * __restrict is, dds_ostreamBE_t * __restrict os, const struct ddsi_sertype_default * __restrict type);
 void dds_stream_extract_keyhash (dds_istream_t * __restrict is, dds_keyhash_t * __restrict kh, const struct ddsi_sertype_default * __restrict type, const bool just_key);
 
 void dds_stream_read_key (dds_istream_t * __restrict is, char * __restrict sample, const struct ddsi_sertype_default * __restrict type);
@@ -66,6 +254,17 @@ size_t dds_stream_print_key (dds_istream_t * __restrict is, const struct ddsi_se
 
 size_t dds_stream_print_sample (dds_istream_t * __restrict is, const struct ddsi_sertype_default * __restrict type, char * __restrict buf, size_t size);
 
+/* Location of a member in (normalized) serialized data */
+struct dds_stream_member_loc {
+  enum dds_stream_typecode type;    /* type of the member */
+  enum dds_stream_typecode subtype; /* element type for sequences and arrays */
+  uint32_t elem_size;               /* size of elements if primitive (or a sequence/array thereof), else 0 */
+  uint32_t index;                   /* offset of first element/character in the data */
+  uint32_t count;                   /* number of elements (1 for primitives); string length excluding terminating 0 */
+};
+
+bool dds_stream_locate_member (dds_istream_t * __restrict is, const struct ddsi_sertype_default * __restrict type, uint32_t offset, struct dds_stream_member_loc * __restrict loc);
+
 /* For marshalling op code handling */
 
 #define DDS_OP_MASK 0xff000000
@@ -1022,6 +1022,74 @@ static struct cfgelem internal_cfgelems[] = {
       "expressed in samples. Once a delivery queue is full, incoming samples "
       "destined for that queue are dropped until space becomes available "
       "again.</p>")),
+  BOOL("DeliveryQueueLockFree", NULL, 1, "false",
+    MEMBER(delivery_queue_lockfree),
+    FUNCTIONS(0, uf_boolean, 0, pf_boolean),
+    DESCRIPTION(
+      "<p>This element controls whether the delivery queues use a lock-free "
+      "queue instead of one protected by a mutex. In lock-free mode the "
+      "receive threads append samples without locking, and the delivery "
+      "thread briefly polls for new data before going to sleep, adapting "
+      "the polling time to the data rate. This avoids most of the "
+      "locking and wakeups at high data rates at the cost of some CPU "
+      "time. The participant statistics dqueue_wakeups_spun and "
+      "dqueue_wakeups_parked count how often the delivery threads found new "
+      "data while polling and how often they had to go to sleep.</p>")),
+  INT("DeliveryThreads", NULL, 1, "0",
+    MEMBER(delivery_threads),
+    FUNCTIONS(0, uf_uint, 0, pf_uint),
+    DESCRIPTION(
+      "<p>This element sets the number of threads that store application data "
+      "taken from the delivery queue in the reader history caches. Samples "
+      "are assigned to these threads based on the reader and the instance, "
+      "so that the order of the samples of an instance is preserved in each "
+      "reader while multiple readers are updated in parallel. The order of "
+      "samples of different instances is not preserved. A value of 0 means "
+      "the delivery queue thread stores the data itself, values larger "
+      "than 64 are treated as 64. Data delivered synchronously from the "
+      "receive threads (see Internal/SynchronousDeliveryLatencyBound) is "
+      "not affected.</p>")),
+  INT("DiscoveryDeliveryThreads", NULL, 1, "1",
+    MEMBER(discovery_delivery_threads),
+    FUNCTIONS(0, uf_uint, 0, pf_uint),
+    DESCRIPTION(
+      "<p>This element sets the number of delivery queues (each with its own "
+      "thread) processing discovery data. Remote participants are assigned "
+      "to a queue based on their GUID, so that the SPDP and SEDP data of a "
+      "single participant is processed in order, while that of different "
+      "participants is processed in parallel. This reduces discovery "
+      "latency when many nodes (re)start simultaneously. A value of 0 is "
+      "treated as 1, values larger than 64 are treated as 64.</p>")),
+  INT("ReaderHistoryCachedChunks", NULL, 1, "4",
+    MEMBER(rhc_cached_chunks),
+    FUNCTIONS(0, uf_uint, 0, pf_uint),
+    DESCRIPTION(
+      "<p>This element sets the number of empty chunks of memory each "
+      "reader history cache keeps for reuse, separately for instances and "
+      "for samples. Instances and samples are "
+      "stored in chunks of up to 64kB that are allocated as needed. A "
+      "chunk that no longer holds any of them is kept if fewer than this "
+      "number of chunks are kept already and otherwise returned to the "
+      "heap. A larger value avoids allocating and freeing memory when the "
+      "number of instances fluctuates, a smaller value returns memory "
+      "more quickly. For a reader history cache partitioned in shards, "
+      "the limit applies to each shard.</p>")),
+  INT("ReaderHistoryShards", NULL, 1, "1",
+    MEMBER(rhc_shards),
+    FUNCTIONS(0, uf_uint, 0, pf_uint),
+    DESCRIPTION(
+      "<p>This element sets the number of shards in which the reader history "
+      "caches are partitioned. Each shard holds a subset of the instances "
+      "and has its own lock, so that storing data and reading or taking it "
+      "contend less for a lock when a reader has very many instances. A "
+      "read or take visits the shards one at a time and therefore does not "
+      "see a consistent snapshot of the reader history cache as a whole. "
+      "A value of 1 uses a single, unpartitioned reader history cache, "
+      "values larger than 256 are treated as 256.</p>\n"
+      "<p>It can be overridden for individual readers by setting the "
+      "property org.eclipse.cyclonedds.rhc.shards in the reader QoS. "
+      "Readers with a limit on the number of samples or instances always "
+      "use an unpartitioned reader history cache.</p>")),
   INT("PrimaryReorderMaxSamples", NULL, 1, "128",
     MEMBER(primary_reorder_maxsamples),
     FUNCTIONS(0, uf_uint, 0, pf_uint),
@@ -1227,6 +1295,20 @@ static struct cfgelem internal_cfgelems[] = {
       "<p>This setting controls the delay between sending identical "
       "acknowledgements.</p>"),
     UNIT("duration")),
+  STRING("AckCoalescingDelay", NULL, 1, "0 ms",
+    MEMBER(ack_coalescing_delay),
+    FUNCTIONS(0, uf_duration_ms_1hr, 0, pf_duration),
+    DESCRIPTION(
+      "<p>This setting controls the time window within which a reliable "
+      "writer coalesces incoming acknowledgements before dropping the "
+      "acknowledged samples from its history. Acknowledgements received in "
+      "this window only update the state of the remote readers, after which "
+      "all samples acknowledged by all readers are dropped from the history "
+      "in one go on the event thread. The default of 0 drops samples "
+      "immediately upon receipt of an acknowledgement. A non-zero setting "
+      "reduces contention on the writer with many reliable readers, at the "
+      "cost of retaining acknowledged data longer.</p>"),
+    UNIT("duration")),
   STRING("AutoReschedNackDelay", NULL, 1, "1 s",
     MEMBER(auto_resched_nack_delay),
     FUNCTIONS(0, uf_duration_inf, 0, pf_duration),
@@ -1254,6 +1336,34 @@ static struct cfgelem internal_cfgelems[] = {
       "scheduled exactly, whereas a value of 10ms would mean that events are "
       "rounded up to the nearest 10 milliseconds.</p>"),
     UNIT("duration")),
+  ENUM("EventQueueScheduler", NULL, 1, "heap",
+    MEMBER(xevent_scheduler),
+    FUNCTIONS(0, uf_xevent_scheduler, 0, pf_xevent_scheduler),
+    DESCRIPTION(
+      "<p>This setting selects the data structure used for keeping track of "
+      "the timed events (heartbeats, acknowledgements, deadline and lifespan "
+      "expiry, etc.) in the event queues:</p>\n"
+      "<ul><li><i>heap</i>: a priority queue, ordering all events exactly at "
+      "a cost logarithmic in the number of events;</li>\n"
+      "<li><i>wheel</i>: a hierarchical timing wheel, with constant-time "
+      "scheduling and cancelling of events that only sorts events into "
+      "buckets until they are almost due.</li></ul>\n"
+      "<p>Events never execute early with either. The timing wheel is "
+      "preferable when there are very many (re)scheduled events.</p>"),
+    VALUES("heap","wheel")),
+  INT("EventQueueThreads", NULL, 1, "1",
+    MEMBER(xevent_threads),
+    FUNCTIONS(0, uf_uint, 0, pf_uint),
+    DESCRIPTION(
+      "<p>This element sets the number of event queues (each with its own "
+      "thread and its own packing of messages) handling the heartbeats, "
+      "acknowledgements, retransmits and other events of writers, proxy "
+      "writers and participants. These entities are assigned to a queue "
+      "based on their GUID, so that the events of a single entity are "
+      "handled in order, while a queue that is blocked, e.g., by bandwidth "
+      "limiting, only delays the entities assigned to it. Each queue "
+      "applies the auxiliary bandwidth limit independently. A value of 0 is "
+      "treated as 1, values larger than 64 are treated as 64.</p>")),
 #ifdef DDS_HAS_BANDWIDTH_LIMITING
   STRING("AuxiliaryBandwidthLimit", NULL, 1, "inf",
     MEMBER(auxiliary_bandwidth_limit),
@@ -1402,6 +1512,42 @@ static struct cfgelem internal_cfgelems[] = {
     "transport (e.g., UDP) and ManySocketsMode not set to single (the "
     "default).</p>"),
     VALUES("false","true","default")),
+  INT("ReceiveBatchSize", NULL, 1, "1",
+    MEMBER(recv_batch_size),
+    FUNCTIONS(0, uf_uint, 0, pf_uint),
+    DESCRIPTION(
+      "<p>This element sets the maximum number of packets a receive thread "
+      "reads from a socket in a single system call (using recvmmsg), which "
+      "reduces the per-packet cost at high packet rates. A value of 1 "
+      "disables batching, values larger than 64 are treated as 64. It is "
+      "only supported for UDP on Linux.</p>\n"
+      "<p>All packets of a batch must fit in a single receive buffer, so the "
+      "number of packets actually requested is further limited to "
+      "Sizing/ReceiveBufferSize divided by Sizing/ReceiveBufferChunkSize.</p>")),
+  INT("TransmitBatchSize", NULL, 1, "1",
+    MEMBER(xmit_batch_size),
+    FUNCTIONS(0, uf_uint, 0, pf_uint),
+    DESCRIPTION(
+      "<p>This element sets the maximum number of destinations to which a "
+      "packet is sent in a single system call (using sendmmsg) when it has "
+      "to be sent to multiple unicast addresses, e.g., when a writer has "
+      "many remote readers and no multicast. A value of 1 disables batching, "
+      "values larger than 64 are treated as 64. It is only supported for UDP "
+      "on Linux and is not used when packets are encrypted as a whole or "
+      "when Internal/Test/XmitLossiness is set.</p>")),
+  INT("UnicastDataReceiveThreads", NULL, 1, "1",
+    MEMBER(data_uc_recv_threads),
+    FUNCTIONS(0, uf_uint, 0, pf_uint),
+    DESCRIPTION(
+      "<p>This element sets the number of sockets bound to the unicast data "
+      "port (using SO_REUSEPORT), each with its own receive thread and "
+      "receive buffer pool. The kernel assigns incoming packets to the "
+      "sockets based on their source address, so that the processing of "
+      "data from different remote writers is spread over multiple "
+      "threads. A value of 1 disables this, values larger than 8 are "
+      "treated as 8. It is only supported for UDP on Linux and only "
+      "applies if Internal/MultipleReceiveThreads is enabled and "
+      "Compatibility/ManySocketsMode is set to single.</p>")),
   GROUP("ControlTopic", control_topic_cfgelems, control_topic_cfgattrs, 1,
     NOMEMBER,
     NOFUNCTIONS,
@@ -1554,8 +1700,48 @@ static struct cfgelem tcp_cfgelems[] = {
     FUNCTIONS(0, uf_duration_ms_1hr, 0, pf_duration),
     DESCRIPTION(
       "<p>This element specifies the timeout for blocking TCP write "
-      "operations. If this timeout expires then the connection is closed.</p>"),
+      "operations. If this timeout expires then the connection is closed. "
+      "With a send queue (see TCP/SendQueueSize), it is the maximum time "
+      "the queue may make no progress before the connection is closed.</p>"),
     UNIT("duration")),
+  STRING("SendQueueSize", NULL, 1, "1 MiB",
+    MEMBER(tcp_sendq_size),
+    FUNCTIONS(0, uf_memsize, 0, pf_memsize),
+    DESCRIPTION(
+      "<p>This element specifies the maximum number of bytes queued for "
+      "transmission on a single TCP connection. Messages that can't be "
+      "written to the socket immediately are queued and written by a "
+      "separate thread, combining queued messages into a single system "
+      "call, so that a slow peer doesn't block the sending thread for "
+      "everyone. If 0, messages are written directly, blocking for at most "
+      "TCP/WriteTimeout. The queue is not used with SSL.</p>"),
+    UNIT("memsize")),
+  ENUM("SendQueueOverflow", NULL, 1, "block",
+    MEMBER(tcp_sendq_overflow),
+    FUNCTIONS(0, uf_tcp_sendq_overflow, 0, pf_tcp_sendq_overflow),
+    DESCRIPTION(
+      "<p>This element specifies what happens to a message that doesn't fit "
+      "in the send queue of a TCP connection:</p>\n"
+      "<ul><li><i>block</i>: wait for at most TCP/WriteTimeout for space to "
+      "become available, dropping the message if none does;</li>\n"
+      "<li><i>drop</i>: drop the message immediately.</li></ul>\n"
+      "<p>Dropped messages are treated as lost in transmission. "
+      "TCP/SendQueueOverflowPeers can override this for individual peers.</p>"),
+    VALUES("block","drop")),
+  STRING("SendQueueOverflowPeers", NULL, 1, "",
+    MEMBER(tcp_sendq_overflow_peers),
+    FUNCTIONS(0, uf_string, ff_free, pf_string),
+    DESCRIPTION(
+      "<p>This element specifies, per peer, what happens to a message that "
+      "doesn't fit in the send queue of a TCP connection, overriding "
+      "TCP/SendQueueOverflow. It is a comma-separated list of "
+      "<i>address</i>=<i>policy</i> pairs, where the address is the IP "
+      "address of the peer (without port) and may contain the usual "
+      "wildcards '*' and '?', and the policy is <i>block</i> or <i>drop</i>, "
+      "e.g. <i>10.1.0.1=block,10.1.*=drop</i>. The first matching entry "
+      "applies, connections to peers that match no entry use "
+      "TCP/SendQueueOverflow.</p>"
+    )),
   BOOL("AlwaysUsePeeraddrForUnicast", NULL, 1, "false",
     MEMBER(tcp_use_peeraddr_for_unicast),
     FUNCTIONS(0, uf_boolean, 0, pf_boolean),
@@ -1828,6 +2014,84 @@ static struct cfgelem discovery_cfgelems[] = {
   END_MARKER
 };
 
+static struct cfgelem packet_capture_cfgelems[] = {
+  STRING("BufferSize", NULL, 1, "0 B",
+    MEMBER(pcap_buffer_size),
+    FUNCTIONS(0, uf_memsize, 0, pf_memsize),
+    DESCRIPTION(
+      "<p>This element specifies the size of the buffer into which the "
+      "receive and transmit threads copy the captured packets when "
+      "Tracing/PacketCaptureFile is set. A background thread writes them to "
+      "the file, so that the threads handling the network traffic never wait "
+      "for file I/O. Packets are dropped if the buffer is full; this is "
+      "reported in the log.</p>\n"
+      "<p>The size is rounded up to a power of two. The default of 0 writes "
+      "the packets to the file directly from the receive and transmit "
+      "threads.</p>"),
+    UNIT("memsize")),
+  STRING("MaxFileSize", NULL, 1, "0 B",
+    MEMBER(pcap_max_file_size),
+    FUNCTIONS(0, uf_memsize, 0, pf_memsize),
+    DESCRIPTION(
+      "<p>This element specifies the size at which the capture file is "
+      "closed and the next one started. The default of 0 means no limit.</p>\n"
+      "<p>If either this element or PacketCapture/RotationInterval is set, "
+      "a sequence number is inserted in the name of each file before the "
+      "extension, e.g. <i>capture.0.pcap</i>, <i>capture.1.pcap</i>, "
+      "etc.</p>"),
+    UNIT("memsize")),
+  STRING("RotationInterval", NULL, 1, "inf",
+    MEMBER(pcap_rotation_interval),
+    FUNCTIONS(0, uf_duration_inf, 0, pf_duration),
+    DESCRIPTION(
+      "<p>This element specifies how long packets are written to a capture "
+      "file before the next one is started. The switch happens when the "
+      "first packet after the interval is captured.</p>"),
+    UNIT("duration_inf")),
+  INT("MaxFiles", NULL, 1, "0",
+    MEMBER(pcap_max_files),
+    FUNCTIONS(0, uf_uint, 0, pf_uint),
+    DESCRIPTION(
+      "<p>This element specifies the number of capture files kept when the "
+      "files are rotated: once this number is reached, the oldest file is "
+      "overwritten. The default of 0 means files are never overwritten.</p>"
+    )),
+  STRING("SnapLength", NULL, 1, "0 B",
+    MEMBER(pcap_snaplen),
+    FUNCTIONS(0, uf_memsize, 0, pf_memsize),
+    DESCRIPTION(
+      "<p>This element specifies the maximum number of bytes stored for "
+      "each packet, including the fictitious 28 bytes of IP and UDP headers. "
+      "The default of 0 stores complete packets.</p>"),
+    UNIT("memsize")),
+  STRING("GuidPrefixes", NULL, 1, "",
+    MEMBER(pcap_guid_prefixes),
+    FUNCTIONS(0, uf_string, ff_free, pf_string),
+    DESCRIPTION(
+      "<p>This element specifies a comma-separated list of GUID prefixes, "
+      "formatted as in the trace (e.g. <i>1107a3c:2c0e2bd6:85e4b52e</i>) and "
+      "possibly containing the usual wildcards '*' and '?'. If set, only "
+      "packets of which the RTPS header contains a matching GUID prefix are "
+      "captured. The default captures packets regardless of their source.</p>"
+    )),
+  STRING("Topics", NULL, 1, "",
+    MEMBER(pcap_topics),
+    FUNCTIONS(0, uf_string, ff_free, pf_string),
+    DESCRIPTION(
+      "<p>This element specifies a comma-separated list of topic names, "
+      "possibly containing the usual wildcards '*' and '?'. If set, only "
+      "packets containing a submessage from or to a known reader or writer of "
+      "a matching topic are captured. The built-in topics have their "
+      "standard names, e.g., <i>DCPSParticipant</i>. The default captures "
+      "packets regardless of the topic.</p>\n"
+      "<p>Matching requires looking up the endpoints. With a "
+      "PacketCapture/BufferSize, this is done by the background thread, "
+      "which then needs the complete packets to be copied into the buffer "
+      "even if a PacketCapture/SnapLength is set.</p>"
+    )),
+  END_MARKER
+};
+
 static struct cfgelem tracing_cfgelems[] = {
   LIST("Category|EnableCategory", NULL, 1, "",
     NOMEMBER,
@@ -1909,6 +2173,22 @@ static struct cfgelem tracing_cfgelems[] = {
       "existing log file. The default is to create a new log file each time, "
       "which is generally the best option if a detailed log is generated.</p>"
     )),
+  ENUM("OutputFormat", NULL, 1, "text",
+    MEMBER(trace_format),
+    FUNCTIONS(0, uf_trace_format, 0, pf_trace_format),
+    DESCRIPTION(
+      "<p>This option specifies the format of the trace output:</p>\n"
+      "<ul><li><i>text</i>: each line is formatted and written to the file "
+      "as it is generated;</li>\n"
+      "<li><i>binary</i>: the threads store the format strings and "
+      "arguments in per-thread buffers and a background thread writes them "
+      "to the file in a compact binary format.</li></ul>\n"
+      "<p>The binary format has a much lower overhead, but messages are "
+      "dropped if they are generated faster than they can be written (this "
+      "is recorded in the file) and the file must be converted using the "
+      "decode-trace tool to make it readable. Log messages are not affected "
+      "by this setting.</p>"),
+    VALUES("text","binary")),
   STRING("PacketCaptureFile", NULL, 1, "",
     MEMBER(pcap_file),
     FUNCTIONS(0, uf_string, ff_free, pf_string),
@@ -1921,6 +2201,14 @@ static struct cfgelem tracing_cfgelems[] = {
       "it is 255 for sent packets and 128 for received ones. Currently IPv4 "
       "only.</p>"
     )),
+  GROUP("PacketCapture", packet_capture_cfgelems, NULL, 1,
+    NOMEMBER,
+    NOFUNCTIONS,
+    DESCRIPTION(
+      "<p>This element controls how packets are written to "
+      "Tracing/PacketCaptureFile, which ones are written and whether the "
+      "file is rotated.</p>"
+    )),
   END_MARKER
 };
 
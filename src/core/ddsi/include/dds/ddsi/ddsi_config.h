@@ -186,6 +186,21 @@ enum ddsi_many_sockets_mode {
   DDSI_MSM_MANY_UNICAST
 };
 
+enum ddsi_trace_format {
+  DDSI_TRACE_FORMAT_TEXT,
+  DDSI_TRACE_FORMAT_BINARY
+};
+
+enum ddsi_xevent_scheduler {
+  DDSI_XEVENT_SCHEDULER_HEAP,
+  DDSI_XEVENT_SCHEDULER_WHEEL
+};
+
+enum ddsi_tcp_sendq_overflow {
+  DDSI_TCP_SENDQ_BLOCK,
+  DDSI_TCP_SENDQ_DROP
+};
+
 #ifdef DDS_HAS_SECURITY
 struct ddsi_plugin_library_properties {
   char *library_path;
@@ -241,6 +256,13 @@ struct ddsi_config
   uint32_t tracemask;
   uint32_t enabled_xchecks;
   char *pcap_file;
+  uint32_t pcap_buffer_size;
+  uint32_t pcap_max_file_size;
+  int64_t pcap_rotation_interval;
+  uint32_t pcap_max_files;
+  uint32_t pcap_snaplen;
+  char *pcap_guid_prefixes;
+  char *pcap_topics;
 
   char *networkAddressString;
   char **networkRecvAddressStrings;
@@ -249,6 +271,7 @@ struct ddsi_config
   FILE *tracefp;
   char *tracefile;
   int tracingAppendToFile;
+  enum ddsi_trace_format trace_format;
   uint32_t allowMulticast;
   int prefer_multicast;
   enum ddsi_transport_selector transport_selector;
@@ -280,11 +303,19 @@ struct ddsi_config
   int prioritize_retransmit;
   enum ddsi_boolean_default multiple_recv_threads;
   unsigned recv_thread_stop_maxretries;
+  unsigned recv_batch_size;
+  unsigned xmit_batch_size;
+  unsigned data_uc_recv_threads;
 
   unsigned primary_reorder_maxsamples;
   unsigned secondary_reorder_maxsamples;
 
   unsigned delivery_queue_maxsamples;
+  int delivery_queue_lockfree;
+  unsigned delivery_threads;
+  unsigned discovery_delivery_threads;
+  unsigned rhc_shards;
+  unsigned rhc_cached_chunks;
 
   uint16_t fragment_size;
   uint32_t max_msg_size;
@@ -305,6 +336,9 @@ struct ddsi_config
   int64_t tcp_read_timeout;
   int64_t tcp_write_timeout;
   int tcp_use_peeraddr_for_unicast;
+  uint32_t tcp_sendq_size;
+  enum ddsi_tcp_sendq_overflow tcp_sendq_overflow;
+  char *tcp_sendq_overflow_peers;
 
 #ifdef DDS_HAS_SSL
   /* SSL support for TCP */
@@ -364,7 +398,10 @@ struct ddsi_config
   int64_t nack_delay;
   int64_t preemptive_ack_delay;
   int64_t schedule_time_rounding;
+  enum ddsi_xevent_scheduler xevent_scheduler;
+  unsigned xevent_threads;
   int64_t auto_resched_nack_delay;
+  int64_t ack_coalescing_delay;
   int64_t ds_grace_period;
 #ifdef DDS_HAS_BANDWIDTH_LIMITING
   uint32_t auxiliary_bandwidth_limit; /* bytes/second */
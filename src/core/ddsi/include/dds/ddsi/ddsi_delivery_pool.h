@@ -0,0 +1,76 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#ifndef DDSI_DELIVERY_POOL_H
+#define DDSI_DELIVERY_POOL_H
+
+#include <stdint.h>
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+struct ddsi_domaingv;
+struct ddsi_serdata;
+struct ddsi_tkmap_instance;
+struct ddsi_writer_info;
+struct reader;
+struct ddsi_delivery_pool;
+
+/* Upper bound on the number of threads in a delivery pool */
+#define DDSI_DELIVERY_POOL_MAX_THREADS 64
+
+typedef void (*ddsi_delivery_pool_callback_t) (void *arg);
+
+/** @brief Creates a pool of threads for storing received samples in reader history caches
+ *
+ * Samples are assigned to a thread based on the reader GUID and the instance id, so the
+ * order of the samples is preserved for each instance in each reader, while the history
+ * caches of different readers are updated in parallel.
+ *
+ * @param[in] gv        domain
+ * @param[in] name      base name of the threads, suffixed with the thread index
+ * @param[in] nthreads  number of threads, at most DDSI_DELIVERY_POOL_MAX_THREADS
+ * @param[in] max_items maximum number of samples queued for a thread before
+ *                      @ref ddsi_delivery_pool_store blocks
+ *
+ * @returns pointer to the new pool, or NULL on failure
+ */
+struct ddsi_delivery_pool *ddsi_delivery_pool_new (struct ddsi_domaingv *gv, const char *name, uint32_t nthreads, uint32_t max_items);
+
+/** @brief Stores all queued samples and then stops and frees the pool
+ *
+ * No other thread may use the pool anymore once this is called. */
+void ddsi_delivery_pool_free (struct ddsi_delivery_pool *pool);
+
+/** @brief Queues a sample for storing in a set of readers
+ *
+ * The pool takes its own references to payload and tk.  The readers are looked up
+ * again by GUID in the pool's threads, so they may be deleted in the meantime. */
+void ddsi_delivery_pool_store (struct ddsi_delivery_pool *pool, struct reader * const *rds, uint32_t nrds, const struct ddsi_writer_info *wrinfo, struct ddsi_serdata *payload, struct ddsi_tkmap_instance *tk);
+
+/** @brief Invokes a callback once all samples queued before it have been stored
+ *
+ * The callback is invoked on one of the pool's threads. */
+void ddsi_delivery_pool_enqueue_callback (struct ddsi_delivery_pool *pool, ddsi_delivery_pool_callback_t cb, void *arg);
+
+/** @brief Waits until all samples queued before the call have been stored
+ *
+ * Must be called before unregistering a writer in a reader history cache, or the
+ * pool could store a sample of that writer afterward.  Returns immediately when
+ * called from one of the pool's own threads. */
+void ddsi_delivery_pool_drain (struct ddsi_delivery_pool *pool);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* DDSI_DELIVERY_POOL_H */
@@ -21,6 +21,7 @@
 #include "dds/ddsrt/sockets.h"
 #include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/fibheap.h"
+#include "dds/ddsrt/timerwheel.h"
 
 #include "dds/ddsi/ddsi_plist.h"
 #include "dds/ddsi/ddsi_ownip.h"
@@ -50,6 +51,7 @@ struct ddsi_tkmap;
 struct dds_security_context;
 struct dds_security_match_index;
 struct ddsi_hsadmin;
+struct pcap_capture;
 
 typedef struct config_in_addr_node {
    ddsi_locator_t loc;
@@ -73,10 +75,18 @@ struct recv_thread_arg {
   enum recv_thread_mode mode;
   struct nn_rbufpool *rbpool;
   struct ddsi_domaingv *gv;
+  /* number of batched reads that returned data and the total number of
+     packets received by them (Internal/ReceiveBatchSize > 1) */
+  ddsrt_atomic_uint64_t rdbatch_count;
+  ddsrt_atomic_uint64_t rdbatch_packets;
   union {
     struct {
       const ddsi_locator_t *loc;
       struct ddsi_tran_conn *conn;
+      /* non-NULL if conn shares its port with other sockets (SO_REUSEPORT),
+         then the kernel picks the socket and loc can't be used to wake up
+         the thread */
+      os_sockWaitset ws;
     } single;
     struct {
       os_sockWaitset ws;
@@ -100,15 +110,27 @@ struct ddsi_domaingv {
      participants, proxy readers and proxy writers by GUID. */
   struct entity_index *entity_index;
 
-  /* Timed events admin */
+  /* Outcomes of QoS matching for pairs of QoS fingerprints, see qos_match_cached_p */
+  struct qos_match_cache *qos_match_cache;
+
+  /* Timed events admin: events of writers, proxy writers and participants
+     are spread over the shards based on their GUID (see xeventq_for_guid),
+     all others go to xevents, which is also the first shard */
   struct xeventq *xevents;
+  uint32_t n_xevents_shards;
+  struct xeventq **xevents_shards;
 
   /* Queue for garbage collection requests */
   struct gcreq_queue *gcreq_queue;
 
-  /* Lease junk */
-  ddsrt_mutex_t leaseheap_lock;
-  ddsrt_fibheap_t leaseheap;
+  /* Lease junk: leases are scheduled in a timing wheel owned by the gc
+     thread; leases of which the expiry time moved earlier are queued on
+     lease_pending (a lock-free stack) for rescheduling, and lease_tnext is
+     the time the gc thread will next look at the leases */
+  ddsrt_mutex_t leasewheel_lock;
+  ddsrt_timerwheel_t leasewheel;
+  ddsrt_atomic_voidp_t lease_pending;
+  ddsrt_atomic_uint64_t lease_tnext;
 
   /* Transport factories & selected factory */
   struct ddsi_tran_factory *ddsi_tran_factories;
@@ -124,6 +146,14 @@ struct ddsi_domaingv {
   struct ddsi_tran_conn * disc_conn_uc;
   struct ddsi_tran_conn * data_conn_uc;
 
+  /* Additional sockets bound to the same port as data_conn_uc using
+     SO_REUSEPORT, each served by its own receive thread, so the kernel
+     spreads the incoming unicast data over multiple threads (see
+     Internal/UnicastDataReceiveThreads) */
+#define MAX_DATA_UC_RECV_THREADS 8
+  uint32_t n_data_conn_uc_extra;
+  struct ddsi_tran_conn * data_conn_uc_extra[MAX_DATA_UC_RECV_THREADS - 1];
+
   /* Connection used for all output (for connectionless transports), this
      used to simply be data_conn_uc, but:
 
@@ -219,7 +249,7 @@ struct ddsi_domaingv {
      trigger socket.) Receive buffer pool is per receive thread,
      it is only a global variable because it needs to be freed way later
      than the receive thread itself terminates */
-#define MAX_RECV_THREADS 3
+#define MAX_RECV_THREADS (2 + MAX_DATA_UC_RECV_THREADS)
   uint32_t n_recv_threads;
   struct recv_thread {
     const char *name;
@@ -260,14 +290,28 @@ struct ddsi_domaingv {
   /* SPDP packets get very special treatment (they're the only packets
      we accept from writers we don't know) and have their very own
      do-nothing defragmentation and reordering thingummies, as well as a
-     global mutex to in lieu of the proxy writer lock. */
+     global mutex to in lieu of the proxy writer lock.  There is a
+     reordering admin for each builtins delivery queue, so that whatever
+     it delivers belongs to participants assigned to that queue. */
   ddsrt_mutex_t spdp_lock;
   struct nn_defrag *spdp_defrag;
-  struct nn_reorder *spdp_reorder;
-
-  /* Built-in stuff other than SPDP gets funneled through the builtins
-     delivery queue; currently just SEDP and PMD */
-  struct nn_dqueue *builtins_dqueue;
+  struct nn_reorder **spdp_reorders;
+
+  /* Built-in stuff gets funneled through the builtins delivery queues,
+     proxy participants are assigned to a queue based on their GUID prefix
+     (see builtins_dqueue_index_for_prefix); new_proxypp_lock serializes
+     checking for the existence of a proxy participant and creating it,
+     because the "implicit" creation in SEDP processing may run on another
+     queue than the participant's SPDP.  Similarly, SEDP relayed by another
+     participant is processed on that participant's queue, and so one of
+     new_proxy_endpoint_locks, selected by hashing the endpoint GUID,
+     serializes checking for the existence of a proxy endpoint and creating
+     it.  Matching is done after releasing it. */
+  uint32_t n_builtins_dqueues;
+  struct nn_dqueue **builtins_dqueues;
+  ddsrt_mutex_t new_proxypp_lock;
+#define N_NEW_PROXY_ENDPOINT_LOCKS 16
+  ddsrt_mutex_t new_proxy_endpoint_locks[N_NEW_PROXY_ENDPOINT_LOCKS];
 
   struct debug_monitor *debmon;
 
@@ -279,6 +323,10 @@ struct ddsi_domaingv {
   struct nn_dqueue *user_dqueue;
 #endif
 
+  /* Optional pool of threads storing application data taken from the
+     delivery queue(s) in the reader history caches */
+  struct ddsi_delivery_pool *delivery_pool;
+
   /* Transmit side: pools for the serializer & transmit messages and a
      transmit queue*/
   struct serdatapool *serpool;
@@ -311,9 +359,26 @@ struct ddsi_domaingv {
   bool sendq_running;
   ddsrt_mutex_t sendq_running_lock;
 
-  /* File for dumping captured packets, NULL if disabled */
-  FILE *pcap_fp;
-  ddsrt_mutex_t pcap_lock;
+  /* Number of ddsi_conn_write_multi calls and the number of packets they
+     sent (Internal/TransmitBatchSize > 1) */
+  ddsrt_atomic_uint64_t xmit_batch_count;
+  ddsrt_atomic_uint64_t xmit_batch_packets;
+
+  /* Number of SEDP samples processed and the total time spent processing them
+     (in ns), including matching the new endpoints */
+  ddsrt_atomic_uint64_t sedp_sample_count;
+  ddsrt_atomic_uint64_t sedp_processing_time;
+
+  /* Number of times a writer's address set was recomputed from scratch and
+     the number of times it was updated incrementally on a change in the set
+     of matched proxy readers, with the total time spent on each (in ns) */
+  ddsrt_atomic_uint64_t wraddrset_rebuild_count;
+  ddsrt_atomic_uint64_t wraddrset_rebuild_time;
+  ddsrt_atomic_uint64_t wraddrset_update_count;
+  ddsrt_atomic_uint64_t wraddrset_update_time;
+
+  /* Packet capture state (see q_pcap.c), NULL if disabled */
+  struct pcap_capture *pcap;
 
   struct ddsi_builtin_topic_interface *builtin_topic_interface;
 
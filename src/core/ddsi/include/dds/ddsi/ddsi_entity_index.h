@@ -44,6 +44,7 @@ struct entidx_enum
 {
   struct entity_index *entidx;
   enum entity_kind kind;
+  bool topic_only; /* iff true, enumerating only the endpoints with the same topic as cur */
   struct entity_common *cur;
 #ifndef NDEBUG
   vtime_t vtime;
@@ -68,8 +69,8 @@ struct entidx_enum
    at the protocol level slightly before the network reader can use it
    to transmit data. */
 
-struct entity_index *entity_index_new (struct ddsi_domaingv *gv) ddsrt_nonnull_all;
-void entity_index_free (struct entity_index *ei) ddsrt_nonnull_all;
+DDS_EXPORT struct entity_index *entity_index_new (struct ddsi_domaingv *gv) ddsrt_nonnull_all;
+DDS_EXPORT void entity_index_free (struct entity_index *ei) ddsrt_nonnull_all;
 
 void entidx_insert_participant_guid (struct entity_index *ei, struct participant *pp) ddsrt_nonnull_all;
 void entidx_insert_proxy_participant_guid (struct entity_index *ei, struct proxy_participant *proxypp) ddsrt_nonnull_all;
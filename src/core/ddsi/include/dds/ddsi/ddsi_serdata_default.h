@@ -119,12 +119,16 @@ struct ddsi_sertype_default_desc {
   ddsi_sertype_default_desc_op_seq_t ops;
 };
 
+struct dds_stream_copy_plan;
+
 struct ddsi_sertype_default {
   struct ddsi_sertype c;
   uint16_t native_encoding_identifier; /* (PL_)?CDR_(LE|BE) */
   struct serdatapool *serpool;
   struct ddsi_sertype_default_desc type;
   size_t opt_size;
+  struct dds_stream_copy_plan *copy_plan; /* for fixed-size types, NULL otherwise */
+  const struct dds_topic_native_ops *native_ops; /* type-specialized (de)serializers, or NULL */
 };
 
 struct ddsi_plist_sample {
@@ -148,6 +152,18 @@ extern DDS_EXPORT const struct ddsi_serdata_ops ddsi_serdata_ops_cdr_nokey;
 struct serdatapool * ddsi_serdatapool_new (void);
 void ddsi_serdatapool_free (struct serdatapool * pool);
 
+/* Cache of serialized samples for writers that repeatedly publish identical data:
+   samples are serialized into a scratch buffer and compared with the cached serdata
+   with the same hash; a cached serdata that is no longer referenced by anything but
+   the cache is then returned instead of a new one, avoiding the allocation, copy
+   and key hash computation.  Only for ddsi_serdata_ops_cdr and _nokey. */
+struct ddsi_serdata_default_cache;
+
+struct ddsi_serdata_default_cache *ddsi_serdata_default_cache_new (uint32_t nslots);
+void ddsi_serdata_default_cache_free (struct ddsi_serdata_default_cache *cache);
+struct ddsi_serdata *ddsi_serdata_default_cache_from_sample (struct ddsi_serdata_default_cache *cache, const struct ddsi_sertype *type, const void *sample);
+uint64_t ddsi_serdata_default_cache_hits (struct ddsi_serdata_default_cache *cache);
+
 #if defined (__cplusplus)
 }
 #endif
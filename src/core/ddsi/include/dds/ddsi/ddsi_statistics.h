@@ -20,9 +20,15 @@ extern "C" {
 
 struct reader;
 struct writer;
+struct ddsi_domaingv;
 
 void ddsi_get_writer_stats (struct writer *wr, uint64_t * __restrict rexmit_bytes, uint32_t * __restrict throttle_count, uint64_t * __restrict time_throttled, uint64_t * __restrict time_retransmit);
 void ddsi_get_reader_stats (struct reader *rd, uint64_t * __restrict discarded_bytes);
+void ddsi_get_recv_stats (const struct ddsi_domaingv *gv, uint64_t * __restrict rdbatch_count, uint64_t * __restrict rdbatch_packets);
+void ddsi_get_xmit_stats (const struct ddsi_domaingv *gv, uint64_t * __restrict xmit_batch_count, uint64_t * __restrict xmit_batch_packets);
+void ddsi_get_dqueue_stats (const struct ddsi_domaingv *gv, uint64_t * __restrict wakeups_spun, uint64_t * __restrict wakeups_parked);
+void ddsi_get_discovery_stats (const struct ddsi_domaingv *gv, uint64_t * __restrict sedp_sample_count, uint64_t * __restrict sedp_processing_time, uint64_t * __restrict qos_match_cache_hits, uint64_t * __restrict qos_match_cache_misses);
+void ddsi_get_wraddrset_stats (const struct ddsi_domaingv *gv, uint64_t * __restrict rebuild_count, uint64_t * __restrict rebuild_time, uint64_t * __restrict update_count, uint64_t * __restrict update_time);
 
 #if defined (__cplusplus)
 }
@@ -46,7 +46,15 @@ typedef struct ddsi_tran_qos ddsi_tran_qos_t;
 /* Function pointer types */
 
 typedef ssize_t (*ddsi_tran_read_fn_t) (ddsi_tran_conn_t, unsigned char *, size_t, bool, ddsi_locator_t *);
+/* Upper bound on the number of datagrams read in one call to ddsi_conn_read_batch */
+#define DDSI_MAX_READ_BATCH 64
+
+/* Upper bound on the number of destinations in one call to ddsi_conn_write_multi */
+#define DDSI_MAX_WRITE_BATCH 64
+
+typedef int (*ddsi_tran_read_batch_fn_t) (ddsi_tran_conn_t, uint32_t, unsigned char * const *, size_t, size_t *, ddsi_locator_t *);
 typedef ssize_t (*ddsi_tran_write_fn_t) (ddsi_tran_conn_t, const ddsi_locator_t *, size_t, const ddsrt_iovec_t *, uint32_t);
+typedef int (*ddsi_tran_write_multi_fn_t) (ddsi_tran_conn_t, uint32_t, const ddsi_locator_t *, size_t, const ddsrt_iovec_t *, uint32_t);
 typedef int (*ddsi_tran_locator_fn_t) (ddsi_tran_factory_t, ddsi_tran_base_t, ddsi_locator_t *);
 typedef bool (*ddsi_tran_supports_fn_t) (const struct ddsi_tran_factory *, int32_t);
 typedef ddsrt_socket_t (*ddsi_tran_handle_fn_t) (ddsi_tran_base_t);
@@ -113,7 +121,9 @@ struct ddsi_tran_conn
   /* Functions */
 
   ddsi_tran_read_fn_t m_read_fn;
+  ddsi_tran_read_batch_fn_t m_read_batch_fn; /* optional, datagram transports only */
   ddsi_tran_write_fn_t m_write_fn;
+  ddsi_tran_write_multi_fn_t m_write_multi_fn; /* optional, datagram transports only */
   ddsi_tran_peer_locator_fn_t m_peer_locator_fn;
   ddsi_tran_disable_multiplexing_fn_t m_disable_multiplexing_fn;
   ddsi_tran_locator_fn_t m_locator_fn;
@@ -224,6 +234,7 @@ struct ddsi_tran_qos
   enum ddsi_tran_qos_purpose m_purpose;
   int m_diffserv;
   struct nn_interface *m_interface; // only for purpose = XMIT
+  bool m_reuse_port; // only for purpose = RECV_UC: allow binding multiple sockets to the port (SO_REUSEPORT)
 };
 
 void ddsi_tran_factories_fini (struct ddsi_domaingv *gv);
@@ -276,13 +287,25 @@ DDS_INLINE_EXPORT inline int ddsi_conn_locator (ddsi_tran_conn_t conn, ddsi_loca
 DDS_INLINE_EXPORT inline ssize_t ddsi_conn_write (ddsi_tran_conn_t conn, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags) {
   return conn->m_closed ? -1 : (conn->m_write_fn) (conn, dst, niov, iov, flags);
 }
+/* Sends the same message to ndst (<= DDSI_MAX_WRITE_BATCH) destinations in as few system calls as
+   possible; returns the number of destinations it was sent to, or -1 on error. Only valid if
+   conn->m_write_multi_fn is set. */
+DDS_INLINE_EXPORT inline int ddsi_conn_write_multi (ddsi_tran_conn_t conn, uint32_t ndst, const ddsi_locator_t *dsts, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags) {
+  return conn->m_closed ? -1 : conn->m_write_multi_fn (conn, ndst, dsts, niov, iov, flags);
+}
 DDS_INLINE_EXPORT inline ssize_t ddsi_conn_read (ddsi_tran_conn_t conn, unsigned char * buf, size_t len, bool allow_spurious, ddsi_locator_t *srcloc) {
   return conn->m_closed ? -1 : conn->m_read_fn (conn, buf, len, allow_spurious, srcloc);
 }
+/* Reads up to n datagrams into bufs[0 .. n-1] (each of size len), blocking until at least one is
+   available; returns the number of datagrams read (sizes in szs, sources in srclocs), 0 for a
+   spurious wakeup, or -1 on error. Only valid if conn->m_read_batch_fn is set. */
+DDS_INLINE_EXPORT inline int ddsi_conn_read_batch (ddsi_tran_conn_t conn, uint32_t n, unsigned char * const *bufs, size_t len, size_t *szs, ddsi_locator_t *srclocs) {
+  return conn->m_closed ? -1 : conn->m_read_batch_fn (conn, n, bufs, len, szs, srclocs);
+}
 bool ddsi_conn_peer_locator (ddsi_tran_conn_t conn, ddsi_locator_t * loc);
 void ddsi_conn_disable_multiplexing (ddsi_tran_conn_t conn);
 void ddsi_conn_add_ref (ddsi_tran_conn_t conn);
-void ddsi_conn_free (ddsi_tran_conn_t conn);
+DDS_EXPORT void ddsi_conn_free (ddsi_tran_conn_t conn);
 int ddsi_conn_join_mc (ddsi_tran_conn_t conn, const ddsi_locator_t *srcip, const ddsi_locator_t *mcip, const struct nn_interface *interf);
 int ddsi_conn_leave_mc (ddsi_tran_conn_t conn, const ddsi_locator_t *srcip, const ddsi_locator_t *mcip, const struct nn_interface *interf);
 void ddsi_conn_transfer_group_membership (ddsi_tran_conn_t conn, ddsi_tran_conn_t newconn);
@@ -14,6 +14,7 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include "dds/export.h"
 
 #if defined (__cplusplus)
 extern "C" {
@@ -21,8 +22,43 @@ extern "C" {
 
 struct addrset;
 struct writer;
+struct wr_prd_match;
+struct proxy_reader;
 
-struct addrset *compute_writer_addrset (const struct writer *wr);
+DDS_EXPORT struct addrset *compute_writer_addrset (const struct writer *wr);
+
+/** @brief Recomputes the reader counts for the locators in wr->as after it has been
+ * computed from scratch, disabling incremental updates if the set of matched readers
+ * doesn't allow them */
+void wraddrset_refs_reset (struct writer *wr);
+
+/** @brief Discards the reader counts for the locators in wr->as */
+void wraddrset_refs_clear (struct writer *wr);
+
+/** @brief Updates the address set for a newly matched proxy reader without computing
+ * it from scratch
+ *
+ * @param[in,out] wr     writer, m already in wr->readers, wr->e.lock held
+ * @param[in,out] m      match object for prd
+ * @param[in]     prd    new proxy reader
+ * @param[out]    newas  new address set to use, or NULL if wr->as remains unchanged
+ *
+ * @returns false if the address set must be computed from scratch instead */
+bool wraddrset_add_reader (struct writer *wr, struct wr_prd_match *m, struct proxy_reader *prd, struct addrset **newas);
+
+/** @brief Updates the address set for a proxy reader no longer matched without
+ * computing it from scratch
+ *
+ * @param[in,out] wr     writer, m already removed from wr->readers, wr->e.lock held
+ * @param[in,out] m      match object for the proxy reader
+ * @param[out]    newas  new address set to use, or NULL if wr->as remains unchanged
+ *
+ * @returns false if the address set must be computed from scratch instead */
+bool wraddrset_remove_reader (struct writer *wr, struct wr_prd_match *m, struct addrset **newas);
+
+/** @brief Checks the reader counts against the address set and matched readers
+ * (no-op in release builds) */
+void wraddrset_check (struct writer *wr);
 
 #if defined (__cplusplus)
 }
@@ -26,6 +26,7 @@ struct reader;
 struct nn_rsample_info;
 struct nn_rdata;
 struct ddsi_plist;
+struct nn_dqueue;
 
 struct participant_builtin_topic_data_locators {
   struct nn_locators_one def_uni[MAX_XMIT_CONNS], meta_uni[MAX_XMIT_CONNS];
@@ -45,6 +46,10 @@ int sedp_dispose_unregister_reader (struct reader *rd);
 
 int builtins_dqueue_handler (const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, const ddsi_guid_t *rdguid, void *qarg);
 
+/* Delivery queue for the built-in data of the participant with the given GUID prefix */
+uint32_t builtins_dqueue_index_for_prefix (const struct ddsi_domaingv *gv, const ddsi_guid_prefix_t *prefix);
+struct nn_dqueue *builtins_dqueue_for_prefix (const struct ddsi_domaingv *gv, const ddsi_guid_prefix_t *prefix);
+
 #if defined (__cplusplus)
 }
 #endif
@@ -44,6 +44,7 @@ struct nn_dqueue;
 struct nn_rsample_info;
 struct nn_rdata;
 struct addrset;
+struct wraddrset_refs;
 struct ddsi_sertype;
 struct whc;
 struct dds_qos;
@@ -144,6 +145,7 @@ struct wr_prd_match {
   ddsrt_wctime_t hb_to_ack_latency_tlastlog;
   uint32_t non_responsive_count;
   uint32_t rexmit_requests;
+  struct addrset *counted_as; /* address set of the proxy reader as accounted for in the writer's as_refs, NULL if not accounted for */
 #ifdef DDS_HAS_SECURITY
   int64_t crypto_handle;
 #endif
@@ -208,6 +210,7 @@ struct entity_common {
   bool onlylocal;
   struct ddsi_domaingv *gv;
   ddsrt_avl_node_t all_entities_avlnode;
+  ddsrt_avl_node_t topic_avlnode; /* endpoints only: in entity index per (kind, topic) */
 
   /* QoS changes always lock the entity itself, and additionally
      (and within the scope of the entity lock) acquire qos_lock
@@ -277,6 +280,7 @@ struct topic {
 struct endpoint_common {
   struct participant *pp;
   ddsi_guid_t group_guid;
+  uint64_t qos_match_fp; /* qos_match_fingerprint of the QoS, constant because the relevant QoS is */
 #ifdef DDS_HAS_TYPE_DISCOVERY
   type_identifier_t type_id;
 #endif
@@ -327,6 +331,7 @@ struct writer
   unsigned test_suppress_retransmit : 1; /* iff 1, the writer does not respond to retransmit requests */
   unsigned test_suppress_heartbeat : 1; /* iff 1, the writer suppresses all periodic heartbeats */
   unsigned test_drop_outgoing_data : 1; /* iff 1, the writer drops outgoing data, forcing the readers to request a retransmit */
+  unsigned ack_coalescing_pending : 1; /* iff 1, ack_coalescing_xevent is scheduled to drop acknowledged samples from the WHC */
 #ifdef DDS_HAS_SSM
   unsigned supports_ssm: 1;
   struct addrset *ssm_as;
@@ -335,7 +340,9 @@ struct writer
   const struct ddsi_sertype * type; /* type of the data written by this writer */
   struct addrset *as; /* set of addresses to publish to */
   struct addrset *as_group; /* alternate case, used for SPDP, when using Cloud with multiple bootstrap locators */
+  struct wraddrset_refs *as_refs; /* number of matched proxy readers reached via each locator in "as", NULL <=> "as" can only be recomputed from scratch */
   struct xevent *heartbeat_xevent; /* timed event for "periodically" publishing heartbeats when unack'd data present, NULL <=> unreliable */
+  struct xevent *ack_coalescing_xevent; /* timed event for dropping acknowledged samples from the WHC, NULL <=> unreliable or Internal/AckCoalescingDelay = 0 */
   struct ldur_fhnode *lease_duration; /* fibheap node to keep lease duration for this writer, NULL in case of automatic liveliness with inifite duration  */
   struct whc *whc; /* WHC tracking history, T-L durability service history + samples by sequence number for retransmit */
   uint32_t whc_low, whc_high; /* watermarks for WHC in bytes (counting only unack'd data) */
@@ -484,6 +491,7 @@ struct proxy_endpoint_common
   struct proxy_endpoint_common *next_ep; /* next \ endpoint belonging to this proxy participant */
   struct proxy_endpoint_common *prev_ep; /* prev / -- this is in arbitrary ordering */
   struct dds_qos *xqos; /* proxy endpoint QoS lives here; FIXME: local ones should have it moved to common as well */
+  uint64_t qos_match_fp; /* qos_match_fingerprint of xqos, constant because the relevant QoS is */
   struct addrset *as; /* address set to use for communicating with this endpoint */
   ddsi_guid_t group_guid; /* 0:0:0:0 if not available */
   nn_vendorid_t vendor; /* cached from proxypp->vendor */
@@ -512,6 +520,8 @@ struct proxy_writer {
   uint32_t last_fragnum; /* last known frag for last_seq, or UINT32_MAX if last_seq not partial */
   nn_count_t nackfragcount; /* last nackfrag seq number */
   ddsrt_atomic_uint32_t next_deliv_seq_lowword; /* lower 32-bits for next sequence number that will be delivered; for generating acks; 32-bit so atomic reads on all supported platforms */
+  ddsrt_atomic_uint32_t pool_handed_seq_lowword; /* late-ack mode: lower 32-bits of the sequence number following the last sample handed to the delivery pool */
+  ddsrt_atomic_uint32_t deliv_seq_update_inflight; /* late-ack mode: 1 iff a callback updating next_deliv_seq_lowword is queued in the delivery pool */
   unsigned deliver_synchronously: 1; /* iff 1, delivery happens straight from receive thread for non-historical data; else through delivery queue "dqueue" */
   unsigned have_seen_heartbeat: 1; /* iff 1, we have received at least on heartbeat from this proxy writer */
   unsigned local_matching_inprogress: 1; /* iff 1, we are still busy matching local readers; this is so we don't deliver incoming data to some but not all readers initially */
@@ -737,6 +747,7 @@ void update_writer_qos (struct writer *wr, const struct dds_qos *xqos);
 struct whc_node;
 struct whc_state;
 unsigned remove_acked_messages (struct writer *wr, struct whc_state *whcst, struct whc_node **deferred_free_list);
+bool writer_defer_remove_acked_messages (struct writer *wr);
 seqno_t writer_max_drop_seq (const struct writer *wr);
 int writer_must_have_hb_scheduled (const struct writer *wr, const struct whc_state *whcst);
 void writer_set_retransmitting (struct writer *wr);
@@ -798,7 +809,7 @@ dds_return_t delete_topic (struct ddsi_domaingv *gv, const struct ddsi_guid *gui
 int topic_definition_equal (const struct ddsi_topic_definition *tpd_a, const struct ddsi_topic_definition *tpd_b);
 uint32_t topic_definition_hash (const struct ddsi_topic_definition *tpd);
 dds_return_t lookup_topic_definition_by_name (struct ddsi_domaingv *gv, const char * topic_name, struct ddsi_topic_definition **tpd);
-void new_proxy_topic (struct proxy_participant *proxypp, seqno_t seq, const ddsi_guid_t *guid, const type_identifier_t *type_id, struct dds_qos *qos, ddsrt_wctime_t timestamp);
+dds_return_t new_proxy_topic (struct proxy_participant *proxypp, seqno_t seq, const ddsi_guid_t *guid, const type_identifier_t *type_id, struct dds_qos *qos, ddsrt_wctime_t timestamp);
 struct proxy_topic *lookup_proxy_topic (struct proxy_participant *proxypp, const ddsi_guid_t *guid);
 void update_proxy_topic (struct proxy_participant *proxypp, struct proxy_topic *proxytp, seqno_t seq, struct dds_qos *xqos, ddsrt_wctime_t timestamp);
 int delete_proxy_topic_locked (struct proxy_participant *proxypp, struct proxy_topic *proxytp, ddsrt_wctime_t timestamp);
@@ -813,6 +824,20 @@ int new_proxy_reader (struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid,
 #endif
                       );
 
+/* Same, but without matching it with the local readers or writers: the new proxy
+   writer or reader is returned and becomes visible right away, and must be matched
+   using match_new_proxy_writer or match_new_proxy_reader.  This allows creating it
+   under a lock that prevents concurrent creation without also matching it while
+   holding that lock. */
+int new_proxy_writer_unmatched (struct proxy_writer **ppwr, struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid, const struct ddsi_guid *guid, struct addrset *as, const struct ddsi_plist *plist, struct nn_dqueue *dqueue, struct xeventq *evq, ddsrt_wctime_t timestamp, seqno_t seq);
+int new_proxy_reader_unmatched (struct proxy_reader **pprd, struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid, const struct ddsi_guid *guid, struct addrset *as, const struct ddsi_plist *plist, ddsrt_wctime_t timestamp, seqno_t seq
+#ifdef DDS_HAS_SSM
+                                , int favours_ssm
+#endif
+                                );
+void match_new_proxy_writer (struct proxy_writer *pwr);
+void match_new_proxy_reader (struct proxy_reader *prd);
+
 /* To delete a proxy writer or reader; these synchronously hide it
    from the outside world, preventing it from being matched to a
    reader or writer. Actual deletion is scheduled in the future, when
@@ -13,6 +13,7 @@
 #define Q_PCAP_H
 
 #include <stdio.h>
+#include "dds/export.h"
 #include "dds/ddsrt/time.h"
 
 #if defined (__cplusplus)
@@ -20,11 +21,13 @@ extern "C" {
 #endif
 
 struct msghdr;
+struct pcap_capture;
 
-FILE * new_pcap_file (struct ddsi_domaingv *gv, const char *name);
+DDS_EXPORT struct pcap_capture *new_pcap_capture (struct ddsi_domaingv *gv, const char *name);
+DDS_EXPORT void free_pcap_capture (struct pcap_capture *pc);
 
-void write_pcap_received (struct ddsi_domaingv *gv, ddsrt_wctime_t tstamp, const struct sockaddr_storage *src, const struct sockaddr_storage *dst, unsigned char *buf, size_t sz);
-void write_pcap_sent (struct ddsi_domaingv *gv, ddsrt_wctime_t tstamp, const struct sockaddr_storage *src,
+DDS_EXPORT void write_pcap_received (struct ddsi_domaingv *gv, ddsrt_wctime_t tstamp, const struct sockaddr_storage *src, const struct sockaddr_storage *dst, unsigned char *buf, size_t sz);
+DDS_EXPORT void write_pcap_sent (struct ddsi_domaingv *gv, ddsrt_wctime_t tstamp, const struct sockaddr_storage *src,
   const ddsrt_msghdr_t *hdr, size_t sz);
 
 #if defined (__cplusplus)
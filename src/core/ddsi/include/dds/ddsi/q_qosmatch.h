@@ -59,6 +59,34 @@ bool qos_match_p (
 #endif
 );
 
+struct qos_match_cache;
+
+/* fingerprint of the QoS that qos_match_p looks at, except for the type information */
+DDS_EXPORT uint64_t qos_match_fingerprint (const dds_qos_t *qos);
+
+DDS_EXPORT struct qos_match_cache *qos_match_cache_new (void);
+DDS_EXPORT void qos_match_cache_free (struct qos_match_cache *qmc);
+DDS_EXPORT void qos_match_cache_get_stats (struct qos_match_cache *qmc, uint64_t * __restrict hits, uint64_t * __restrict misses);
+
+/* same as qos_match_p, but using (and updating) gv->qos_match_cache for the matching
+   of everything but the type; rd_fp and wr_fp are used to locate the cache entry and
+   should be the fingerprints of rd_qos and wr_qos, but the result is correct regardless
+   because cached outcomes are only used if the QoS are equivalent */
+DDS_EXPORT bool qos_match_cached_p (
+    struct ddsi_domaingv *gv,
+    const dds_qos_t *rd_qos,
+    uint64_t rd_fp,
+    const dds_qos_t *wr_qos,
+    uint64_t wr_fp,
+    dds_qos_policy_id_t *reason
+#ifdef DDS_HAS_TYPE_DISCOVERY
+    , const type_identifier_t *rd_typeid
+    , const type_identifier_t *wr_typeid
+    , bool *rd_typeid_req_lookup
+    , bool *wr_typeid_req_lookup
+#endif
+);
+
 #if defined (__cplusplus)
 }
 #endif
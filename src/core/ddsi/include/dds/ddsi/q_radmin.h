@@ -102,6 +102,9 @@ struct nn_rmsg {
   /* whether to log */
   bool trace;
 
+  /* whether allocated as part of a batch by nn_rmsg_new_batch */
+  bool batch;
+
   struct nn_rmsg_chunk chunk;
 };
 DDSRT_STATIC_ASSERT (sizeof (struct nn_rmsg) == offsetof (struct nn_rmsg, chunk) + sizeof (struct nn_rmsg_chunk));
@@ -221,6 +224,7 @@ void nn_rbufpool_setowner (struct nn_rbufpool *rbp, ddsrt_thread_t tid);
 void nn_rbufpool_free (struct nn_rbufpool *rbp);
 
 struct nn_rmsg *nn_rmsg_new (struct nn_rbufpool *rbufpool);
+uint32_t nn_rmsg_new_batch (struct nn_rbufpool *rbufpool, uint32_t n, struct nn_rmsg **rmsgs);
 void nn_rmsg_setsize (struct nn_rmsg *rmsg, uint32_t size);
 void nn_rmsg_commit (struct nn_rmsg *rmsg);
 void nn_rmsg_free (struct nn_rmsg *rmsg);
@@ -267,6 +271,7 @@ void nn_dqueue_enqueue1 (struct nn_dqueue *q, const ddsi_guid_t *rdguid, struct
 void nn_dqueue_enqueue_callback (struct nn_dqueue *q, nn_dqueue_callback_t cb, void *arg);
 int  nn_dqueue_is_full (struct nn_dqueue *q);
 void nn_dqueue_wait_until_empty_if_full (struct nn_dqueue *q);
+void nn_dqueue_get_wakeup_stats (const struct nn_dqueue *q, uint64_t * __restrict spun, uint64_t * __restrict parked);
 
 void nn_defrag_stats (struct nn_defrag *defrag, uint64_t *discarded_bytes);
 void nn_reorder_stats (struct nn_reorder *reorder, uint64_t *discarded_bytes);
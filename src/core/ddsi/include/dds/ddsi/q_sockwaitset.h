@@ -12,6 +12,8 @@
 #ifndef Q_SOCKWAITSET_H
 #define Q_SOCKWAITSET_H
 
+#include "dds/export.h"
+
 #if defined (__cplusplus)
 extern "C" {
 #endif
@@ -27,13 +29,13 @@ struct ddsi_tran_conn;
   the wait set using the Wait and NextEvent functions in a single handling
   loop.
 */
-os_sockWaitset os_sockWaitsetNew (void);
+DDS_EXPORT os_sockWaitset os_sockWaitsetNew (void);
 
 /*
   Frees the waitset WS. Any connections associated with it will
   be closed.
 */
-void os_sockWaitsetFree (os_sockWaitset ws);
+DDS_EXPORT void os_sockWaitsetFree (os_sockWaitset ws);
 
 /*
   Triggers the waitset, from any thread.  It is level
@@ -84,7 +86,7 @@ void os_sockWaitsetPurge (os_sockWaitset ws, unsigned index);
   Shared state updates preceding os_sockWaitsetTrigger are visible
   following os_sockWaitsetWait.
 */
-os_sockWaitsetCtx os_sockWaitsetWait (os_sockWaitset ws);
+DDS_EXPORT os_sockWaitsetCtx os_sockWaitsetWait (os_sockWaitset ws);
 
 /*
   Returns the index of the next triggered connection in the
@@ -99,7 +101,7 @@ os_sockWaitsetCtx os_sockWaitsetWait (os_sockWaitset ws);
   If the return value is >= 0, *conn contains the connection on which
   data is available.
 */
-int os_sockWaitsetNextEvent (os_sockWaitsetCtx ctx, struct ddsi_tran_conn ** conn);
+DDS_EXPORT int os_sockWaitsetNextEvent (os_sockWaitsetCtx ctx, struct ddsi_tran_conn ** conn);
 
 /* Remove connection */
 void os_sockWaitsetRemove (os_sockWaitset ws, struct ddsi_tran_conn * conn);
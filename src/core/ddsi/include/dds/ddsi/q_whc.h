@@ -41,6 +41,11 @@ struct whc_state {
 };
 #define WHCST_ISEMPTY(whcst) ((whcst)->max_seq == -1)
 
+struct whc_memory_stats {
+  size_t nsamples; /* number of samples currently stored */
+  size_t bytes; /* memory used for storing them, excluding serdata and plist */
+};
+
 /* Adjust SIZE and alignment stuff as needed: they are here simply so we can allocate
    an iter on the stack without specifying an implementation. If future changes or
    implementations require more, these can be adjusted.  An implementation should check
@@ -68,6 +73,7 @@ typedef void (*whc_return_sample_t)(struct whc *whc, struct whc_borrowed_sample
 typedef void (*whc_sample_iter_init_t)(const struct whc *whc, struct whc_sample_iter *it);
 typedef bool (*whc_sample_iter_borrow_next_t)(struct whc_sample_iter *it, struct whc_borrowed_sample *sample);
 typedef void (*whc_free_t)(struct whc *whc);
+typedef void (*whc_get_memory_stats_t)(const struct whc *whc, struct whc_memory_stats *st);
 
 /* min_seq is lowest sequence number that must be retained because of
    reliable readers that have not acknowledged all data */
@@ -91,6 +97,7 @@ struct whc_ops {
   whc_sample_iter_borrow_next_t sample_iter_borrow_next;
   whc_downgrade_to_volatile_t downgrade_to_volatile;
   whc_free_t free;
+  whc_get_memory_stats_t get_memory_stats;
 };
 
 struct whc {
@@ -121,6 +128,9 @@ DDS_INLINE_EXPORT inline bool whc_sample_iter_borrow_next (struct whc_sample_ite
 DDS_INLINE_EXPORT inline void whc_free (struct whc *whc) {
   whc->ops->free (whc);
 }
+DDS_INLINE_EXPORT inline void whc_get_memory_stats (const struct whc *whc, struct whc_memory_stats *st) {
+  whc->ops->get_memory_stats (whc, st);
+}
 DDS_INLINE_EXPORT inline int whc_insert (struct whc *whc, seqno_t max_drop_seq, seqno_t seq, ddsrt_mtime_t exp, struct ddsi_plist *plist, struct ddsi_serdata *serdata, struct ddsi_tkmap_instance *tk) {
   return whc->ops->insert (whc, max_drop_seq, seq, exp, plist, serdata, tk);
 }
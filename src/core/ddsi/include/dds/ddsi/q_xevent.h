@@ -44,6 +44,9 @@ DDS_EXPORT void xeventq_free (struct xeventq *evq);
 DDS_EXPORT dds_return_t xeventq_start (struct xeventq *evq, const char *name); /* <0 => error, =0 => ok */
 DDS_EXPORT void xeventq_stop (struct xeventq *evq);
 
+/* Returns the event queue for the events of the entity with the given GUID */
+DDS_EXPORT struct xeventq *xeventq_for_guid (const struct ddsi_domaingv *gv, const ddsi_guid_t *guid);
+
 DDS_EXPORT void qxev_msg (struct xeventq *evq, struct nn_xmsg *msg);
 
 DDS_EXPORT void qxev_pwr_entityid (struct proxy_writer * pwr, const ddsi_guid_t *guid);
@@ -31,7 +31,7 @@
 static void dds_stream_write (dds_ostream_t * __restrict os, const char * __restrict data, const uint32_t * __restrict ops);
 static void dds_stream_read (dds_istream_t * __restrict is, char * __restrict data, const uint32_t * __restrict ops);
 
-static void dds_ostream_grow (dds_ostream_t * __restrict st, uint32_t size)
+void dds_ostream_grow (dds_ostream_t * __restrict st, uint32_t size)
 {
   uint32_t needed = size + st->m_index;
 
@@ -44,11 +44,25 @@ static void dds_ostream_grow (dds_ostream_t * __restrict st, uint32_t size)
   st->m_size = newSize;
 }
 
-static void dds_cdr_resize (dds_ostream_t * __restrict s, uint32_t l)
-{
-  if (s->m_size < l + s->m_index)
-    dds_ostream_grow (s, l);
-}
+DDS_EXPORT extern inline void dds_cdr_resize (dds_ostream_t * __restrict s, uint32_t l);
+DDS_EXPORT extern inline void dds_cdr_alignto (dds_istream_t * __restrict s, uint32_t a);
+DDS_EXPORT extern inline uint32_t dds_cdr_alignto_clear_and_resize (dds_ostream_t * __restrict s, uint32_t a, uint32_t extra);
+DDS_EXPORT extern inline uint32_t dds_cdr_alignto_clear_and_resize_be (dds_ostreamBE_t * __restrict s, uint32_t a, uint32_t extra);
+DDS_EXPORT extern inline uint8_t dds_is_get1 (dds_istream_t * __restrict s);
+DDS_EXPORT extern inline uint16_t dds_is_get2 (dds_istream_t * __restrict s);
+DDS_EXPORT extern inline uint32_t dds_is_get4 (dds_istream_t * __restrict s);
+DDS_EXPORT extern inline uint64_t dds_is_get8 (dds_istream_t * __restrict s);
+DDS_EXPORT extern inline void dds_is_get_bytes (dds_istream_t * __restrict s, void * __restrict b, uint32_t num, uint32_t elem_size);
+DDS_EXPORT extern inline void dds_os_put1 (dds_ostream_t * __restrict s, uint8_t v);
+DDS_EXPORT extern inline void dds_os_put2 (dds_ostream_t * __restrict s, uint16_t v);
+DDS_EXPORT extern inline void dds_os_put4 (dds_ostream_t * __restrict s, uint32_t v);
+DDS_EXPORT extern inline void dds_os_put8 (dds_ostream_t * __restrict s, uint64_t v);
+DDS_EXPORT extern inline void dds_os_put1be (dds_ostreamBE_t * __restrict s, uint8_t v);
+DDS_EXPORT extern inline void dds_os_put2be (dds_ostreamBE_t * __restrict s, uint16_t v);
+DDS_EXPORT extern inline void dds_os_put4be (dds_ostreamBE_t * __restrict s, uint32_t v);
+DDS_EXPORT extern inline void dds_os_put8be (dds_ostreamBE_t * __restrict s, uint64_t v);
+DDS_EXPORT extern inline void dds_os_put_bytes (dds_ostream_t * __restrict s, const void * __restrict b, uint32_t l);
+DDS_EXPORT extern inline void dds_os_put_bytes_aligned (dds_ostream_t * __restrict s, const void * __restrict b, uint32_t n, uint32_t a);
 
 void dds_ostream_init (dds_ostream_t * __restrict st, uint32_t size)
 {
@@ -73,136 +87,9 @@ void dds_ostreamBE_fini (dds_ostreamBE_t * __restrict st)
   dds_ostream_fini (&st->x);
 }
 
-static void dds_cdr_alignto (dds_istream_t * __restrict s, uint32_t a)
-{
-  s->m_index = (s->m_index + a - 1) & ~(a - 1);
-  assert (s->m_index < s->m_size);
-}
-
-static uint32_t dds_cdr_alignto_clear_and_resize (dds_ostream_t * __restrict s, uint32_t a, uint32_t extra)
-{
-  const uint32_t m = s->m_index % a;
-  if (m == 0)
-  {
-    dds_cdr_resize (s, extra);
-    return 0;
-  }
-  else
-  {
-    const uint32_t pad = a - m;
-    dds_cdr_resize (s, pad + extra);
-    for (uint32_t i = 0; i < pad; i++)
-      s->m_buffer[s->m_index++] = 0;
-    return pad;
-  }
-}
-
-static uint32_t dds_cdr_alignto_clear_and_resize_be (dds_ostreamBE_t * __restrict s, uint32_t a, uint32_t extra)
-{
-  return dds_cdr_alignto_clear_and_resize (&s->x, a, extra);
-}
-
-static uint8_t dds_is_get1 (dds_istream_t * __restrict s)
-{
-  assert (s->m_index < s->m_size);
-  uint8_t v = *(s->m_buffer + s->m_index);
-  s->m_index++;
-  return v;
-}
-
-static uint16_t dds_is_get2 (dds_istream_t * __restrict s)
-{
-  dds_cdr_alignto (s, 2);
-  uint16_t v = * ((uint16_t *) (s->m_buffer + s->m_index));
-  s->m_index += 2;
-  return v;
-}
-
-static uint32_t dds_is_get4 (dds_istream_t * __restrict s)
-{
-  dds_cdr_alignto (s, 4);
-  uint32_t v = * ((uint32_t *) (s->m_buffer + s->m_index));
-  s->m_index += 4;
-  return v;
-}
-
-static uint64_t dds_is_get8 (dds_istream_t * __restrict s)
-{
-  dds_cdr_alignto (s, 8);
-  uint64_t v = * ((uint64_t *) (s->m_buffer + s->m_index));
-  s->m_index += 8;
-  return v;
-}
-
-static void dds_is_get_bytes (dds_istream_t * __restrict s, void * __restrict b, uint32_t num, uint32_t elem_size)
-{
-  dds_cdr_alignto (s, elem_size);
-  memcpy (b, s->m_buffer + s->m_index, num * elem_size);
-  s->m_index += num * elem_size;
-}
-
-static void dds_os_put1 (dds_ostream_t * __restrict s, uint8_t v)
-{
-  dds_cdr_resize (s, 1);
-  *((uint8_t *) (s->m_buffer + s->m_index)) = v;
-  s->m_index += 1;
-}
-
-static void dds_os_put2 (dds_ostream_t * __restrict s, uint16_t v)
-{
-  dds_cdr_alignto_clear_and_resize (s, 2, 2);
-  *((uint16_t *) (s->m_buffer + s->m_index)) = v;
-  s->m_index += 2;
-}
-
-static void dds_os_put4 (dds_ostream_t * __restrict s, uint32_t v)
-{
-  dds_cdr_alignto_clear_and_resize (s, 4, 4);
-  *((uint32_t *) (s->m_buffer + s->m_index)) = v;
-  s->m_index += 4;
-}
-
-static void dds_os_put8 (dds_ostream_t * __restrict s, uint64_t v)
-{
-  dds_cdr_alignto_clear_and_resize (s, 8, 8);
-  *((uint64_t *) (s->m_buffer + s->m_index)) = v;
-  s->m_index += 8;
-}
-
-static void dds_os_put1be (dds_ostreamBE_t * __restrict s, uint8_t v)
-{
-  dds_os_put1 (&s->x, v);
-}
-
-static void dds_os_put2be (dds_ostreamBE_t * __restrict s, uint16_t v)
-{
-  dds_os_put2 (&s->x, ddsrt_toBE2u (v));
-}
-
-static void dds_os_put4be (dds_ostreamBE_t * __restrict s, uint32_t v)
-{
-  dds_os_put4 (&s->x, ddsrt_toBE4u (v));
-}
-
-static void dds_os_put8be (dds_ostreamBE_t * __restrict s, uint64_t v)
-{
-  dds_os_put8 (&s->x, ddsrt_toBE8u (v));
-}
-
-static void dds_os_put_bytes (dds_ostream_t * __restrict s, const void * __restrict b, uint32_t l)
-{
-  dds_cdr_resize (s, l);
-  memcpy (s->m_buffer + s->m_index, b, l);
-  s->m_index += l;
-}
-
-static void dds_os_put_bytes_aligned (dds_ostream_t * __restrict s, const void * __restrict b, uint32_t n, uint32_t a)
-{
-  const uint32_t l = n * a;
-  dds_cdr_alignto_clear_and_resize (s, a, l);
-  memcpy (s->m_buffer + s->m_index, b, l);
-  s->m_index += l;
-}
+/* Limit the size of the input buffer so we don't need to worry about adding
+   padding and a primitive type overflowing our offset */
+#define CDR_SIZE_MAX ((uint32_t) 0xfffffff0)
 
 static uint32_t get_type_size (enum dds_stream_typecode type)
 {
@@ -268,6 +155,162 @@ size_t dds_stream_check_optimize (const struct ddsi_sertype_default_desc * __res
   return dds_stream_check_optimize1 (desc);
 }
 
+struct copy_plan_builder {
+  uint32_t mem_size;
+  uint32_t cdr_off;
+  uint32_t cdr_align;
+  uint32_t nruns;
+  struct dds_stream_copy_run runs[DDS_STREAM_COPY_PLAN_MAX_RUNS];
+};
+
+static bool copy_plan_add (struct copy_plan_builder * __restrict b, uint32_t mem_off, uint32_t elem_size, uint32_t num)
+{
+  const uint32_t cdr_off = (b->cdr_off + elem_size - 1) & ~(elem_size - 1);
+  if (num > (CDR_SIZE_MAX - cdr_off) / elem_size || (uint64_t) mem_off + (uint64_t) num * elem_size > b->mem_size)
+    return false;
+  const uint32_t size = num * elem_size;
+  if (elem_size > b->cdr_align)
+    b->cdr_align = elem_size;
+  b->cdr_off = cdr_off + size;
+  if (b->nruns > 0)
+  {
+    struct dds_stream_copy_run * const r = &b->runs[b->nruns - 1];
+    if (r->elem_size == elem_size && r->mem_off + r->size == mem_off && r->cdr_off + r->size == cdr_off)
+    {
+      r->size += size;
+      return true;
+    }
+  }
+  if (b->nruns == DDS_STREAM_COPY_PLAN_MAX_RUNS)
+    return false;
+  b->runs[b->nruns++] = (struct dds_stream_copy_run) { .mem_off = mem_off, .cdr_off = cdr_off, .size = size, .elem_size = elem_size };
+  return true;
+}
+
+static bool copy_plan_build (struct copy_plan_builder * __restrict b, uint32_t mem_off, const uint32_t * __restrict ops)
+{
+  uint32_t insn;
+  while ((insn = *ops) != DDS_OP_RTS)
+  {
+    if (DDS_OP (insn) == DDS_OP_JSR)
+    {
+      if (!copy_plan_build (b, mem_off, ops + DDS_OP_JUMP (insn)))
+        return false;
+      ops++;
+      continue;
+    }
+    if (DDS_OP (insn) != DDS_OP_ADR)
+      return false;
+    switch (DDS_OP_TYPE (insn))
+    {
+      case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY:
+        if (!copy_plan_add (b, mem_off + ops[1], get_type_size (DDS_OP_TYPE (insn)), 1))
+          return false;
+        ops += 2;
+        break;
+      case DDS_OP_VAL_ARR:
+        switch (DDS_OP_SUBTYPE (insn))
+        {
+          case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY:
+            if (!copy_plan_add (b, mem_off + ops[1], get_type_size (DDS_OP_SUBTYPE (insn)), ops[2]))
+              return false;
+            ops += 3;
+            break;
+          case DDS_OP_VAL_STU: {
+            const uint32_t *jsr_ops = ops + DDS_OP_ADR_JSR (ops[3]);
+            const uint32_t jmp = DDS_OP_ADR_JMP (ops[3]);
+            const uint32_t elem_size = ops[4];
+            /* elements usually coalesce into a single run, if not, the run limit bounds the work */
+            for (uint32_t i = 0; i < ops[2]; i++)
+            {
+              if ((uint64_t) mem_off + ops[1] + (uint64_t) i * elem_size >= b->mem_size)
+                return false;
+              if (!copy_plan_build (b, mem_off + ops[1] + i * elem_size, jsr_ops))
+                return false;
+            }
+            ops += jmp ? jmp : 5;
+            break;
+          }
+          default:
+            return false;
+        }
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+struct dds_stream_copy_plan *dds_stream_make_copy_plan (const struct ddsi_sertype_default_desc * __restrict desc)
+{
+  struct copy_plan_builder b = { .mem_size = desc->size, .cdr_off = 0, .cdr_align = 1, .nruns = 0 };
+  if ((desc->flagset & DDS_TOPIC_CONTAINS_UNION) || !copy_plan_build (&b, 0, desc->ops.ops) || b.nruns == 0)
+    return NULL;
+  struct dds_stream_copy_plan *plan = ddsrt_malloc (sizeof (*plan) + b.nruns * sizeof (plan->runs[0]));
+  plan->cdr_size = b.cdr_off;
+  plan->cdr_align = b.cdr_align;
+  plan->nruns = b.nruns;
+  memcpy (plan->runs, b.runs, b.nruns * sizeof (plan->runs[0]));
+  return plan;
+}
+
+static void dds_stream_write_copy_plan (dds_ostream_t * __restrict os, const char * __restrict data, const struct dds_stream_copy_plan * __restrict plan)
+{
+  dds_cdr_resize (os, plan->cdr_size);
+  char * const dst = (char *) os->m_buffer + os->m_index;
+  uint32_t end = 0;
+  for (uint32_t i = 0; i < plan->nruns; i++)
+  {
+    const struct dds_stream_copy_run * const r = &plan->runs[i];
+    if (r->cdr_off > end)
+      memset (dst + end, 0, r->cdr_off - end);
+    memcpy (dst + r->cdr_off, data + r->mem_off, r->size);
+    end = r->cdr_off + r->size;
+  }
+  os->m_index += plan->cdr_size;
+}
+
+static void dds_stream_read_copy_plan (dds_istream_t * __restrict is, char * __restrict data, const struct dds_stream_copy_plan * __restrict plan)
+{
+  const char * const src = (const char *) is->m_buffer + is->m_index;
+  for (uint32_t i = 0; i < plan->nruns; i++)
+  {
+    const struct dds_stream_copy_run * const r = &plan->runs[i];
+    memcpy (data + r->mem_off, src + r->cdr_off, r->size);
+  }
+  is->m_index += plan->cdr_size;
+}
+
+static bool dds_stream_normalize_copy_plan (char * __restrict data, uint32_t size, bool bswap, const struct dds_stream_copy_plan * __restrict plan)
+{
+  if (size < plan->cdr_size)
+    return false;
+  if (bswap)
+  {
+    for (uint32_t i = 0; i < plan->nruns; i++)
+    {
+      const struct dds_stream_copy_run * const r = &plan->runs[i];
+      char * const p = data + r->cdr_off;
+      switch (r->elem_size)
+      {
+        case 1:
+          break;
+        case 2:
+          ddsrt_bswap2u_array ((uint16_t *) p, (const uint16_t *) p, r->size / 2);
+          break;
+        case 4:
+          ddsrt_bswap4u_array ((uint32_t *) p, (const uint32_t *) p, r->size / 4);
+          break;
+        case 8:
+          ddsrt_bswap8u_array ((uint64_t *) p, (const uint64_t *) p, r->size / 8);
+          break;
+      }
+    }
+  }
+  return true;
+}
+
 static void dds_stream_countops1 (const uint32_t * __restrict ops, const uint32_t **ops_end);
 
 static const uint32_t *dds_stream_countops_seq (const uint32_t * __restrict ops, uint32_t insn, const uint32_t **ops_end)
@@ -399,7 +442,7 @@ uint32_t dds_stream_countops (const uint32_t * __restrict ops)
   return (uint32_t) (ops_end - ops);
 }
 
-static void dds_stream_reuse_string_bound (dds_istream_t * __restrict is, char * __restrict str, const uint32_t bound)
+void dds_stream_reuse_string_bound (dds_istream_t * __restrict is, char * __restrict str, const uint32_t bound)
 {
   const uint32_t length = dds_is_get4 (is);
   const void *src = is->m_buffer + is->m_index;
@@ -411,7 +454,7 @@ static void dds_stream_reuse_string_bound (dds_istream_t * __restrict is, char *
   is->m_index += length;
 }
 
-static char *dds_stream_reuse_string (dds_istream_t * __restrict is, char * __restrict str)
+char *dds_stream_reuse_string (dds_istream_t * __restrict is, char * __restrict str)
 {
   const uint32_t length = dds_is_get4 (is);
   const void *src = is->m_buffer + is->m_index;
@@ -428,13 +471,13 @@ static void dds_stream_skip_forward (dds_istream_t * __restrict is, uint32_t len
     is->m_index += len * elem_size;
 }
 
-static void dds_stream_skip_string (dds_istream_t * __restrict is)
+void dds_stream_skip_string (dds_istream_t * __restrict is)
 {
   const uint32_t length = dds_is_get4 (is);
   dds_stream_skip_forward (is, length, 1);
 }
 
-static void dds_stream_write_string (dds_ostream_t * __restrict os, const char * __restrict val)
+void dds_stream_write_string (dds_ostream_t * __restrict os, const char * __restrict val)
 {
   uint32_t size = 1;
 
@@ -456,7 +499,7 @@ static void dds_stream_write_string (dds_ostream_t * __restrict os, const char *
   }
 }
 
-static void dds_streamBE_write_string (dds_ostreamBE_t * __restrict os, const char * __restrict val)
+void dds_streamBE_write_string (dds_ostreamBE_t * __restrict os, const char * __restrict val)
 {
   uint32_t size = 1;
 
@@ -713,6 +756,34 @@ static void realloc_sequence_buffer_if_needed (dds_sequence_t * __restrict seq,
   }
 }
 
+static void dds_stream_read_primseq_elems (dds_istream_t * __restrict is, dds_sequence_t * __restrict seq, uint32_t num, uint32_t elem_size)
+{
+  realloc_sequence_buffer_if_needed (seq, num, elem_size, false);
+  seq->_length = (num <= seq->_maximum) ? num : seq->_maximum;
+  dds_is_get_bytes (is, seq->_buffer, seq->_length, elem_size);
+  if (seq->_length < num)
+    dds_stream_skip_forward (is, num - seq->_length, elem_size);
+}
+
+void dds_stream_read_primseq (dds_istream_t * __restrict is, dds_sequence_t * __restrict seq, uint32_t elem_size)
+{
+  const uint32_t num = dds_is_get4 (is);
+  if (num == 0)
+    seq->_length = 0;
+  else
+    dds_stream_read_primseq_elems (is, seq, num, elem_size);
+}
+
+void dds_stream_skip_primseq (dds_istream_t * __restrict is, uint32_t elem_size)
+{
+  const uint32_t num = dds_is_get4 (is);
+  if (num > 0)
+  {
+    dds_cdr_alignto (is, elem_size);
+    dds_stream_skip_forward (is, num, elem_size);
+  }
+}
+
 static const uint32_t *dds_stream_read_seq (dds_istream_t * __restrict is, char * __restrict addr, const uint32_t * __restrict ops, uint32_t insn)
 {
   dds_sequence_t * const seq = (dds_sequence_t *) addr;
@@ -727,12 +798,7 @@ static const uint32_t *dds_stream_read_seq (dds_istream_t * __restrict is, char
   switch (subtype)
   {
     case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY: {
-      const uint32_t elem_size = get_type_size (subtype);
-      realloc_sequence_buffer_if_needed (seq, num, elem_size, false);
-      seq->_length = (num <= seq->_maximum) ? num : seq->_maximum;
-      dds_is_get_bytes (is, seq->_buffer, seq->_length, elem_size);
-      if (seq->_length < num)
-        dds_stream_skip_forward (is, num - seq->_length, elem_size);
+      dds_stream_read_primseq_elems (is, seq, num, get_type_size (subtype));
       return ops + 2;
     }
     case DDS_OP_VAL_STR: {
@@ -881,10 +947,6 @@ static void dds_stream_read (dds_istream_t * __restrict is, char * __restrict da
  **
  *******************************************************************************************/
 
-/* Limit the size of the input buffer so we don't need to worry about adding
-   padding and a primitive type overflowing our offset */
-#define CDR_SIZE_MAX ((uint32_t) 0xfffffff0)
-
 static bool stream_normalize (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap, const uint32_t * __restrict ops);
 
 static uint32_t check_align_prim (uint32_t off, uint32_t size, uint32_t a_lg2)
@@ -990,8 +1052,7 @@ static bool normalize_primarray (char * __restrict data, uint32_t * __restrict o
       if (bswap)
       {
         uint16_t *xs = (uint16_t *) (data + *off);
-        for (uint32_t i = 0; i < num; i++)
-          xs[i] = ddsrt_bswap2u (xs[i]);
+        ddsrt_bswap2u_array (xs, xs, num);
       }
       *off += 2 * num;
       return true;
@@ -1001,8 +1062,7 @@ static bool normalize_primarray (char * __restrict data, uint32_t * __restrict o
       if (bswap)
       {
         uint32_t *xs = (uint32_t *) (data + *off);
-        for (uint32_t i = 0; i < num; i++)
-          xs[i] = ddsrt_bswap4u (xs[i]);
+        ddsrt_bswap4u_array (xs, xs, num);
       }
       *off += 4 * num;
       return true;
@@ -1012,8 +1072,7 @@ static bool normalize_primarray (char * __restrict data, uint32_t * __restrict o
       if (bswap)
       {
         uint64_t *xs = (uint64_t *) (data + *off);
-        for (uint32_t i = 0; i < num; i++)
-          xs[i] = ddsrt_bswap8u (xs[i]);
+        ddsrt_bswap8u_array (xs, xs, num);
       }
       *off += 8 * num;
       return true;
@@ -1206,6 +1265,37 @@ static bool stream_normalize_key (void * __restrict data, uint32_t size, bool bs
   return true;
 }
 
+bool dds_stream_normalize_prim (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap, enum dds_stream_typecode type)
+{
+  switch (type)
+  {
+    case DDS_OP_VAL_1BY: return normalize_uint8 (off, size);
+    case DDS_OP_VAL_2BY: return normalize_uint16 (data, off, size, bswap);
+    case DDS_OP_VAL_4BY: return normalize_uint32 (data, off, size, bswap);
+    case DDS_OP_VAL_8BY: return normalize_uint64 (data, off, size, bswap);
+    default: abort (); break;
+  }
+  return false;
+}
+
+bool dds_stream_normalize_string (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap, size_t maxsz)
+{
+  return normalize_string (data, off, size, bswap, maxsz);
+}
+
+bool dds_stream_normalize_primarray (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap, uint32_t num, enum dds_stream_typecode type)
+{
+  return normalize_primarray (data, off, size, bswap, num, type);
+}
+
+bool dds_stream_normalize_primseq (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap, enum dds_stream_typecode type)
+{
+  uint32_t num;
+  if (!read_and_normalize_uint32 (&num, data, off, size, bswap))
+    return false;
+  return num == 0 || normalize_primarray (data, off, size, bswap, num, type);
+}
+
 bool dds_stream_normalize (void * __restrict data, uint32_t size, bool bswap, const struct ddsi_sertype_default * __restrict topic, bool just_key)
 {
   if (size > CDR_SIZE_MAX)
@@ -1215,6 +1305,10 @@ bool dds_stream_normalize (void * __restrict data, uint32_t size, bool bswap, co
   else
   {
     uint32_t off = 0;
+    if (topic->copy_plan)
+      return dds_stream_normalize_copy_plan (data, size, bswap, topic->copy_plan);
+    if (topic->native_ops && topic->native_ops->m_normalize)
+      return topic->native_ops->m_normalize (data, &off, size, bswap);
     return stream_normalize (data, &off, size, bswap, topic->type.ops.ops);
   }
 }
@@ -1432,6 +1526,10 @@ void dds_stream_read_sample (dds_istream_t * __restrict is, void * __restrict da
        potential out-of-bounds read */
     dds_is_get_bytes (is, data, (uint32_t) type->opt_size, 1);
   }
+  else if (type->copy_plan && (is->m_index % type->copy_plan->cdr_align) == 0)
+  {
+    dds_stream_read_copy_plan (is, data, type->copy_plan);
+  }
   else
   {
     if (desc->flagset & DDS_TOPIC_CONTAINS_UNION)
@@ -1445,7 +1543,10 @@ void dds_stream_read_sample (dds_istream_t * __restrict is, void * __restrict da
       dds_stream_free_sample (data, desc->ops.ops);
       memset (data, 0, desc->size);
     }
-    dds_stream_read (is, data, desc->ops.ops);
+    if (type->native_ops && type->native_ops->m_read)
+      type->native_ops->m_read (is, data);
+    else
+      dds_stream_read (is, data, desc->ops.ops);
   }
 }
 
@@ -1454,6 +1555,10 @@ void dds_stream_write_sample (dds_ostream_t * __restrict os, const void * __rest
   const struct ddsi_sertype_default_desc *desc = &type->type;
   if (type->opt_size && desc->align && (os->m_index % desc->align) == 0)
     dds_os_put_bytes (os, data, (uint32_t) type->opt_size);
+  else if (type->copy_plan && (os->m_index % type->copy_plan->cdr_align) == 0)
+    dds_stream_write_copy_plan (os, data, type->copy_plan);
+  else if (type->native_ops && type->native_ops->m_write)
+    type->native_ops->m_write (os, data);
   else
     dds_stream_write (os, data, desc->ops.ops);
 }
@@ -1525,20 +1630,17 @@ static void dds_stream_swap_insitu (void * __restrict vbuf, uint32_t size, uint3
       break;
     case 2: {
       uint16_t *buf = vbuf;
-      for (uint32_t i = 0; i < num; i++)
-        buf[i] = ddsrt_bswap2u (buf[i]);
+      ddsrt_bswap2u_array (buf, buf, num);
       break;
     }
     case 4: {
       uint32_t *buf = vbuf;
-      for (uint32_t i = 0; i < num; i++)
-        buf[i] = ddsrt_bswap4u (buf[i]);
+      ddsrt_bswap4u_array (buf, buf, num);
       break;
     }
     case 8: {
       uint64_t *buf = vbuf;
-      for (uint32_t i = 0; i < num; i++)
-        buf[i] = ddsrt_bswap8u (buf[i]);
+      ddsrt_bswap8u_array (buf, buf, num);
       break;
     }
   }
@@ -1547,6 +1649,11 @@ static void dds_stream_swap_insitu (void * __restrict vbuf, uint32_t size, uint3
 void dds_stream_write_keyBE (dds_ostreamBE_t * __restrict os, const char * __restrict sample, const struct ddsi_sertype_default * __restrict type)
 {
   const struct ddsi_sertype_default_desc *desc = &type->type;
+  if (type->native_ops && type->native_ops->m_write_keyBE)
+  {
+    type->native_ops->m_write_keyBE (os, sample);
+    return;
+  }
   for (uint32_t i = 0; i < desc->keys.nkeys; i++)
   {
     const uint32_t *insnp = desc->ops.ops + desc->keys.keys[i];
@@ -1579,7 +1686,10 @@ void dds_stream_write_keyBE (dds_ostreamBE_t * __restrict os, const char * __res
 #elif DDSRT_ENDIAN == DDSRT_BIG_ENDIAN
 void dds_stream_write_keyBE (dds_ostreamBE_t * __restrict os, const char * __restrict sample, const struct ddsi_sertype_default * __restrict type)
 {
-  dds_stream_write_key (&os->x, sample, type);
+  if (type->native_ops && type->native_ops->m_write_keyBE)
+    type->native_ops->m_write_keyBE (os, sample);
+  else
+    dds_stream_write_key (&os->x, sample, type);
 }
 #else
 #error "DDSRT_ENDIAN neither LITTLE nor BIG"
@@ -1639,24 +1749,15 @@ static void dds_stream_swap_copy (void * __restrict vdst, const void * __restric
       memcpy (vdst, vsrc, num);
       break;
     case 2: {
-      const uint16_t *src = vsrc;
-      uint16_t *dst = vdst;
-      for (uint32_t i = 0; i < num; i++)
-        dst[i] = ddsrt_bswap2u (src[i]);
+      ddsrt_bswap2u_array (vdst, vsrc, num);
       break;
     }
     case 4: {
-      const uint32_t *src = vsrc;
-      uint32_t *dst = vdst;
-      for (uint32_t i = 0; i < num; i++)
-        dst[i] = ddsrt_bswap4u (src[i]);
+      ddsrt_bswap4u_array (vdst, vsrc, num);
       break;
     }
     case 8: {
-      const uint64_t *src = vsrc;
-      uint64_t *dst = vdst;
-      for (uint32_t i = 0; i < num; i++)
-        dst[i] = ddsrt_bswap8u (src[i]);
+      ddsrt_bswap8u_array (vdst, vsrc, num);
       break;
     }
   }
@@ -1918,6 +2019,92 @@ static void dds_stream_extract_keyBE_from_data1 (dds_istream_t * __restrict is,
   }
 }
 
+static const uint32_t *dds_stream_locate_member1 (dds_istream_t * __restrict is, const uint32_t * __restrict ops, uint32_t offset)
+{
+  uint32_t insn;
+  while ((insn = *ops) != DDS_OP_RTS)
+  {
+    switch (DDS_OP (insn))
+    {
+      case DDS_OP_ADR: {
+        const uint32_t type = DDS_OP_TYPE (insn);
+        if (ops[1] == offset)
+          return ops;
+        switch (type)
+        {
+          case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY: case DDS_OP_VAL_STR: case DDS_OP_VAL_BST:
+            dds_stream_extract_key_from_data_skip_subtype (is, 1, type, NULL);
+            ops += 2 + (type == DDS_OP_VAL_BST);
+            break;
+          case DDS_OP_VAL_SEQ:
+            ops = dds_stream_extract_key_from_data_skip_sequence (is, ops);
+            break;
+          case DDS_OP_VAL_ARR:
+            ops = dds_stream_extract_key_from_data_skip_array (is, ops);
+            break;
+          case DDS_OP_VAL_UNI:
+            ops = dds_stream_extract_key_from_data_skip_union (is, ops);
+            break;
+          case DDS_OP_VAL_STU:
+            abort ();
+        }
+        break;
+      }
+      case DDS_OP_JSR: {
+        const uint32_t *found;
+        if ((found = dds_stream_locate_member1 (is, ops + DDS_OP_JUMP (insn), offset)) != NULL)
+          return found;
+        ops++;
+        break;
+      }
+      case DDS_OP_RTS: case DDS_OP_JEQ: {
+        abort ();
+        break;
+      }
+    }
+  }
+  return NULL;
+}
+
+bool dds_stream_locate_member (dds_istream_t * __restrict is, const struct ddsi_sertype_default * __restrict type, uint32_t offset, struct dds_stream_member_loc * __restrict loc)
+{
+  /* Walks the top-level members, skipping over the data of those preceding the one
+     at "offset" in the in-memory representation.  Relies on the data having been
+     normalized (or having been produced locally), so no bounds checking is needed. */
+  const uint32_t *ops;
+  if ((ops = dds_stream_locate_member1 (is, type->type.ops.ops, offset)) == NULL)
+    return false;
+  const uint32_t insn = *ops;
+  loc->type = DDS_OP_TYPE (insn);
+  loc->subtype = 0;
+  loc->elem_size = 0;
+  loc->count = 1;
+  switch (loc->type)
+  {
+    case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY:
+      loc->elem_size = get_type_size (loc->type);
+      dds_cdr_alignto (is, loc->elem_size);
+      break;
+    case DDS_OP_VAL_STR: case DDS_OP_VAL_BST:
+      loc->count = dds_is_get4 (is) - 1;
+      break;
+    case DDS_OP_VAL_SEQ: case DDS_OP_VAL_ARR:
+      loc->subtype = DDS_OP_SUBTYPE (insn);
+      loc->count = (loc->type == DDS_OP_VAL_SEQ) ? dds_is_get4 (is) : ops[2];
+      if (loc->subtype >= DDS_OP_VAL_1BY && loc->subtype <= DDS_OP_VAL_8BY)
+      {
+        loc->elem_size = get_type_size (loc->subtype);
+        if (loc->count > 0)
+          dds_cdr_alignto (is, loc->elem_size);
+      }
+      break;
+    case DDS_OP_VAL_UNI: case DDS_OP_VAL_STU:
+      break;
+  }
+  loc->index = is->m_index;
+  return true;
+}
+
 void dds_stream_extract_key_from_data (dds_istream_t * __restrict is, dds_ostream_t * __restrict os, const struct ddsi_sertype_default * __restrict type)
 {
   const struct ddsi_sertype_default_desc *desc = &type->type;
@@ -1928,8 +2115,13 @@ void dds_stream_extract_key_from_data (dds_istream_t * __restrict is, dds_ostrea
 void dds_stream_extract_keyBE_from_data (dds_istream_t * __restrict is, dds_ostreamBE_t * __restrict os, const struct ddsi_sertype_default * __restrict type)
 {
   const struct ddsi_sertype_default_desc *desc = &type->type;
-  uint32_t keys_remaining = desc->keys.nkeys;
-  dds_stream_extract_keyBE_from_data1 (is, os, desc->ops.ops, &keys_remaining);
+  if (type->native_ops && type->native_ops->m_extract_keyBE)
+    type->native_ops->m_extract_keyBE (is, os);
+  else
+  {
+    uint32_t keys_remaining = desc->keys.nkeys;
+    dds_stream_extract_keyBE_from_data1 (is, os, desc->ops.ops, &keys_remaining);
+  }
 }
 
 void dds_stream_extract_keyhash (dds_istream_t * __restrict is, dds_keyhash_t * __restrict kh, const struct ddsi_sertype_default * __restrict type, const bool just_key)
@@ -23,6 +23,7 @@
 #include "dds/ddsi/ddsi_rhc.h"
 #include "dds/ddsi/ddsi_entity_index.h"
 #include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/ddsi_delivery_pool.h"
 #include "dds/ddsi/q_entity.h"
 
 #define TYPE_SAMPLE_CACHE_SIZE 4
@@ -133,7 +134,7 @@ static void type_sample_cache_store (struct type_sample_cache * __restrict tsc,
   tsc->n++;
 }
 
-dds_return_t deliver_locally_one (struct ddsi_domaingv *gv, struct entity_common *source_entity, bool source_entity_locked, const ddsi_guid_t *rdguid, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void *vsourceinfo)
+dds_return_t deliver_locally_one (struct ddsi_domaingv *gv, struct ddsi_delivery_pool *pool, struct entity_common *source_entity, bool source_entity_locked, const ddsi_guid_t *rdguid, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void *vsourceinfo)
 {
   struct reader *rd = entidx_lookup_reader_guid (gv->entity_index, rdguid);
   if (rd == NULL)
@@ -141,7 +142,15 @@ dds_return_t deliver_locally_one (struct ddsi_domaingv *gv, struct entity_common
 
   struct ddsi_serdata *payload;
   struct ddsi_tkmap_instance *tk;
-  if ((payload = ops->makesample (&tk, gv, rd->type, vsourceinfo)) != NULL)
+  if ((payload = ops->makesample (&tk, gv, rd->type, vsourceinfo)) == NULL)
+    ; /* malformed payload */
+  else if (pool)
+  {
+    EETRACE (source_entity, " =>"PGUIDFMT" (async)\n", PGUID (*rdguid));
+    ddsi_delivery_pool_store (pool, &rd, 1, wrinfo, payload, tk);
+    free_sample_after_store (gv, payload, tk);
+  }
+  else
   {
     EETRACE (source_entity, " =>"PGUIDFMT"\n", PGUID (*rdguid));
     /* FIXME: why look up rd,pwr again? Their states remains valid while the thread stays
@@ -166,7 +175,7 @@ dds_return_t deliver_locally_one (struct ddsi_domaingv *gv, struct entity_common
   return DDS_RETCODE_OK;
 }
 
-static dds_return_t deliver_locally_slowpath (struct ddsi_domaingv *gv, struct entity_common *source_entity, bool source_entity_locked, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void *vsourceinfo)
+static dds_return_t deliver_locally_slowpath (struct ddsi_domaingv *gv, struct ddsi_delivery_pool *pool, struct entity_common *source_entity, bool source_entity_locked, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void *vsourceinfo)
 {
   /* When deleting, pwr is no longer accessible via the hash
      tables, and consequently, a reader may be deleted without
@@ -198,7 +207,10 @@ static dds_return_t deliver_locally_slowpath (struct ddsi_domaingv *gv, struct e
     if (payload)
     {
       EETRACE (source_entity, " "PGUIDFMT, PGUID (rd->e.guid));
-      (void) ddsi_rhc_store (rd->rhc, wrinfo, payload, tk);
+      if (pool)
+        ddsi_delivery_pool_store (pool, &rd, 1, wrinfo, payload, tk);
+      else
+        (void) ddsi_rhc_store (rd->rhc, wrinfo, payload, tk);
     }
     rd = ops->next_reader (gv->entity_index, &it);
   }
@@ -209,7 +221,7 @@ static dds_return_t deliver_locally_slowpath (struct ddsi_domaingv *gv, struct e
   return DDS_RETCODE_OK;
 }
 
-static dds_return_t deliver_locally_fastpath (struct ddsi_domaingv *gv, struct entity_common *source_entity, bool source_entity_locked, struct local_reader_ary *fastpath_rdary, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void *vsourceinfo)
+static dds_return_t deliver_locally_fastpath (struct ddsi_domaingv *gv, struct ddsi_delivery_pool *pool, struct entity_common *source_entity, bool source_entity_locked, struct local_reader_ary *fastpath_rdary, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void *vsourceinfo)
 {
   struct reader ** const rdary = fastpath_rdary->rdary;
   uint32_t i = 0;
@@ -224,6 +236,14 @@ static dds_return_t deliver_locally_fastpath (struct ddsi_domaingv *gv, struct e
       while (rdary[++i] && rdary[i]->type == type)
         ; /* do nothing */
     }
+    else if (pool)
+    {
+      const uint32_t first = i;
+      while (rdary[++i] && rdary[i]->type == type)
+        ; /* find all readers with the same type */
+      ddsi_delivery_pool_store (pool, &rdary[first], i - first, wrinfo, payload, tk);
+      free_sample_after_store (gv, payload, tk);
+    }
     else
     {
       do {
@@ -243,7 +263,7 @@ static dds_return_t deliver_locally_fastpath (struct ddsi_domaingv *gv, struct e
   return DDS_RETCODE_OK;
 }
 
-dds_return_t deliver_locally_allinsync (struct ddsi_domaingv *gv, struct entity_common *source_entity, bool source_entity_locked, struct local_reader_ary *fastpath_rdary, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void *vsourceinfo)
+dds_return_t deliver_locally_allinsync (struct ddsi_domaingv *gv, struct ddsi_delivery_pool *pool, struct entity_common *source_entity, bool source_entity_locked, struct local_reader_ary *fastpath_rdary, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void *vsourceinfo)
 {
   dds_return_t rc;
   /* FIXME: Retry loop for re-delivery of rejected reliable samples is a bad hack
@@ -254,7 +274,7 @@ dds_return_t deliver_locally_allinsync (struct ddsi_domaingv *gv, struct entity_
     {
       EETRACE (source_entity, " => EVERYONE\n");
       if (fastpath_rdary->rdary[0])
-        rc = deliver_locally_fastpath (gv, source_entity, source_entity_locked, fastpath_rdary, wrinfo, ops, vsourceinfo);
+        rc = deliver_locally_fastpath (gv, pool, source_entity, source_entity_locked, fastpath_rdary, wrinfo, ops, vsourceinfo);
       else
         rc = DDS_RETCODE_OK;
       ddsrt_mutex_unlock (&fastpath_rdary->rdary_lock);
@@ -262,7 +282,7 @@ dds_return_t deliver_locally_allinsync (struct ddsi_domaingv *gv, struct entity_
     else
     {
       ddsrt_mutex_unlock (&fastpath_rdary->rdary_lock);
-      rc = deliver_locally_slowpath (gv, source_entity, source_entity_locked, wrinfo, ops, vsourceinfo);
+      rc = deliver_locally_slowpath (gv, pool, source_entity, source_entity_locked, wrinfo, ops, vsourceinfo);
     }
   } while (rc == DDS_RETCODE_TRY_AGAIN);
   return rc;
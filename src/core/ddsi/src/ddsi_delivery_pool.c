@@ -0,0 +1,294 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/mh3.h"
+#include "dds/ddsi/ddsi_delivery_pool.h"
+#include "dds/ddsi/ddsi_serdata.h"
+#include "dds/ddsi/ddsi_tkmap.h"
+#include "dds/ddsi/ddsi_rhc.h"
+#include "dds/ddsi/ddsi_entity_index.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/q_entity.h"
+#include "dds/ddsi/q_thread.h"
+#include "dds/ddsi/q_log.h"
+
+struct ddsi_delivery_barrier {
+  ddsrt_atomic_uint32_t count;
+  ddsi_delivery_pool_callback_t cb;
+  void *arg;
+};
+
+struct ddsi_delivery_item {
+  struct ddsi_delivery_item *next;
+  struct ddsi_delivery_barrier *barrier; /* if non-null: no sample, just a barrier */
+  struct ddsi_serdata *payload;
+  struct ddsi_tkmap_instance *tk;
+  struct ddsi_writer_info wrinfo;
+  uint32_t nrds;
+  ddsi_guid_t rdguids[];
+};
+
+struct ddsi_delivery_worker {
+  struct ddsi_delivery_pool *pool;
+  ddsrt_mutex_t lock;
+  ddsrt_cond_t cond;
+  struct ddsi_delivery_item *first, *last;
+  uint32_t nitems;
+  bool stop;
+  struct thread_state1 *ts;
+};
+
+struct ddsi_delivery_pool {
+  struct ddsi_domaingv *gv;
+  uint32_t max_items;
+  uint32_t nworkers;
+  struct ddsi_delivery_worker workers[];
+};
+
+static void store_item (struct ddsi_domaingv *gv, const struct ddsi_delivery_item *item)
+{
+  for (uint32_t i = 0; i < item->nrds; i++)
+  {
+    struct reader *rd;
+    if ((rd = entidx_lookup_reader_guid (gv->entity_index, &item->rdguids[i])) == NULL)
+      continue;
+    /* Retrying on a rejected sample mirrors deliver_locally_one: it blocks this thread,
+       and therefore eventually the delivery queue and the writer */
+    while (!ddsi_rhc_store (rd->rhc, &item->wrinfo, item->payload, item->tk))
+    {
+      dds_sleepfor (DDS_MSECS (1));
+      if (entidx_lookup_reader_guid (gv->entity_index, &item->rdguids[i]) == NULL ||
+          entidx_lookup_guid_untyped (gv->entity_index, &item->wrinfo.guid) == NULL)
+      {
+        /* give up when reader or proxy writer no longer accessible */
+        break;
+      }
+    }
+  }
+  ddsi_tkmap_instance_unref (gv->m_tkmap, item->tk);
+  ddsi_serdata_unref (item->payload);
+}
+
+static uint32_t delivery_worker_thread (struct ddsi_delivery_worker *w)
+{
+  struct thread_state1 * const ts1 = lookup_thread_state ();
+  struct ddsi_domaingv * const gv = w->pool->gv;
+  bool stop = false;
+  ddsrt_mutex_lock (&w->lock);
+  while (!stop)
+  {
+    struct ddsi_delivery_item *item;
+    while (w->first == NULL && !w->stop)
+      ddsrt_cond_wait (&w->cond, &w->lock);
+    /* stop only once the queue has been drained */
+    stop = (w->first == NULL);
+    item = w->first;
+    w->first = w->last = NULL;
+    w->nitems = 0;
+    ddsrt_cond_broadcast (&w->cond);
+    ddsrt_mutex_unlock (&w->lock);
+
+    thread_state_awake_fixed_domain (ts1);
+    while (item)
+    {
+      struct ddsi_delivery_item * const next = item->next;
+      thread_state_awake_to_awake_no_nest (ts1);
+      if (item->barrier == NULL)
+        store_item (gv, item);
+      else if (ddsrt_atomic_dec32_nv (&item->barrier->count) == 0)
+      {
+        item->barrier->cb (item->barrier->arg);
+        ddsrt_free (item->barrier);
+      }
+      ddsrt_free (item);
+      item = next;
+    }
+    thread_state_asleep (ts1);
+    ddsrt_mutex_lock (&w->lock);
+  }
+  ddsrt_mutex_unlock (&w->lock);
+  return 0;
+}
+
+struct ddsi_delivery_pool *ddsi_delivery_pool_new (struct ddsi_domaingv *gv, const char *name, uint32_t nthreads, uint32_t max_items)
+{
+  struct ddsi_delivery_pool *pool;
+  assert (nthreads > 0 && nthreads <= DDSI_DELIVERY_POOL_MAX_THREADS);
+  pool = ddsrt_malloc (sizeof (*pool) + nthreads * sizeof (pool->workers[0]));
+  pool->gv = gv;
+  pool->max_items = (max_items > 0) ? max_items : 1;
+  pool->nworkers = 0;
+  for (uint32_t i = 0; i < nthreads; i++)
+  {
+    struct ddsi_delivery_worker * const w = &pool->workers[i];
+    char thrname[64];
+    w->pool = pool;
+    ddsrt_mutex_init (&w->lock);
+    ddsrt_cond_init (&w->cond);
+    w->first = w->last = NULL;
+    w->nitems = 0;
+    w->stop = false;
+    (void) snprintf (thrname, sizeof (thrname), "%s.%"PRIu32, name, i);
+    if (create_thread (&w->ts, gv, thrname, (uint32_t (*) (void *)) delivery_worker_thread, w) != DDS_RETCODE_OK)
+    {
+      GVERROR ("ddsi_delivery_pool_new: failed to start thread %s\n", thrname);
+      ddsrt_cond_destroy (&w->cond);
+      ddsrt_mutex_destroy (&w->lock);
+      ddsi_delivery_pool_free (pool);
+      return NULL;
+    }
+    pool->nworkers++;
+  }
+  return pool;
+}
+
+void ddsi_delivery_pool_free (struct ddsi_delivery_pool *pool)
+{
+  for (uint32_t i = 0; i < pool->nworkers; i++)
+  {
+    struct ddsi_delivery_worker * const w = &pool->workers[i];
+    ddsrt_mutex_lock (&w->lock);
+    w->stop = true;
+    ddsrt_cond_broadcast (&w->cond);
+    ddsrt_mutex_unlock (&w->lock);
+  }
+  for (uint32_t i = 0; i < pool->nworkers; i++)
+  {
+    struct ddsi_delivery_worker * const w = &pool->workers[i];
+    join_thread (w->ts);
+    assert (w->first == NULL);
+    ddsrt_cond_destroy (&w->cond);
+    ddsrt_mutex_destroy (&w->lock);
+  }
+  ddsrt_free (pool);
+}
+
+static void delivery_worker_enqueue (struct ddsi_delivery_pool *pool, struct ddsi_delivery_worker *w, struct ddsi_delivery_item *item, bool may_block)
+{
+  item->next = NULL;
+  ddsrt_mutex_lock (&w->lock);
+  /* Blocking when the worker falls behind provides the back pressure that makes
+     the delivery queue fill up (and incoming data get dropped, as it would
+     without a delivery pool).  Barriers never block: they are enqueued from
+     callbacks where it might not be safe to do so. */
+  while (may_block && w->nitems >= pool->max_items)
+    ddsrt_cond_wait (&w->cond, &w->lock);
+  if (w->first == NULL)
+  {
+    w->first = item;
+    ddsrt_cond_broadcast (&w->cond);
+  }
+  else
+  {
+    w->last->next = item;
+  }
+  w->last = item;
+  w->nitems++;
+  ddsrt_mutex_unlock (&w->lock);
+}
+
+static uint32_t delivery_worker_index (const struct ddsi_delivery_pool *pool, const struct reader *rd, const struct ddsi_tkmap_instance *tk)
+{
+  const uint32_t h = ddsrt_mh3 (&rd->e.guid, sizeof (rd->e.guid), (uint32_t) (tk->m_iid ^ (tk->m_iid >> 32)));
+  return h % pool->nworkers;
+}
+
+void ddsi_delivery_pool_store (struct ddsi_delivery_pool *pool, struct reader * const *rds, uint32_t nrds, const struct ddsi_writer_info *wrinfo, struct ddsi_serdata *payload, struct ddsi_tkmap_instance *tk)
+{
+  uint32_t counts[DDSI_DELIVERY_POOL_MAX_THREADS];
+  struct ddsi_delivery_item *items[DDSI_DELIVERY_POOL_MAX_THREADS];
+  memset (counts, 0, pool->nworkers * sizeof (counts[0]));
+  for (uint32_t i = 0; i < nrds; i++)
+    counts[delivery_worker_index (pool, rds[i], tk)]++;
+  for (uint32_t w = 0; w < pool->nworkers; w++)
+  {
+    if (counts[w] == 0)
+      continue;
+    items[w] = ddsrt_malloc (sizeof (*items[w]) + counts[w] * sizeof (items[w]->rdguids[0]));
+    items[w]->barrier = NULL;
+    items[w]->payload = ddsi_serdata_ref (payload);
+    items[w]->tk = tk;
+    ddsi_tkmap_instance_ref (tk);
+    items[w]->wrinfo = *wrinfo;
+    items[w]->nrds = 0;
+  }
+  for (uint32_t i = 0; i < nrds; i++)
+  {
+    struct ddsi_delivery_item * const item = items[delivery_worker_index (pool, rds[i], tk)];
+    item->rdguids[item->nrds++] = rds[i]->e.guid;
+  }
+  for (uint32_t w = 0; w < pool->nworkers; w++)
+  {
+    if (counts[w] > 0)
+      delivery_worker_enqueue (pool, &pool->workers[w], items[w], true);
+  }
+}
+
+void ddsi_delivery_pool_enqueue_callback (struct ddsi_delivery_pool *pool, ddsi_delivery_pool_callback_t cb, void *arg)
+{
+  struct ddsi_delivery_barrier *b = ddsrt_malloc (sizeof (*b));
+  ddsrt_atomic_st32 (&b->count, pool->nworkers);
+  b->cb = cb;
+  b->arg = arg;
+  for (uint32_t w = 0; w < pool->nworkers; w++)
+  {
+    struct ddsi_delivery_item *item = ddsrt_malloc (sizeof (*item));
+    item->barrier = b;
+    item->nrds = 0;
+    delivery_worker_enqueue (pool, &pool->workers[w], item, false);
+  }
+}
+
+struct ddsi_delivery_pool_drain_arg {
+  ddsrt_mutex_t lock;
+  ddsrt_cond_t cond;
+  bool done;
+};
+
+static void delivery_pool_drain_cb (void *varg)
+{
+  struct ddsi_delivery_pool_drain_arg * const arg = varg;
+  ddsrt_mutex_lock (&arg->lock);
+  arg->done = true;
+  ddsrt_cond_broadcast (&arg->cond);
+  ddsrt_mutex_unlock (&arg->lock);
+}
+
+void ddsi_delivery_pool_drain (struct ddsi_delivery_pool *pool)
+{
+  /* A worker can only get here via a listener invoked while storing a sample,
+     waiting for the other workers could then deadlock */
+  struct thread_state1 * const self = lookup_thread_state ();
+  for (uint32_t w = 0; w < pool->nworkers; w++)
+    if (pool->workers[w].ts == self)
+      return;
+
+  struct ddsi_delivery_pool_drain_arg arg;
+  ddsrt_mutex_init (&arg.lock);
+  ddsrt_cond_init (&arg.cond);
+  arg.done = false;
+  ddsi_delivery_pool_enqueue_callback (pool, delivery_pool_drain_cb, &arg);
+  ddsrt_mutex_lock (&arg.lock);
+  while (!arg.done)
+    ddsrt_cond_wait (&arg.cond, &arg.lock);
+  ddsrt_mutex_unlock (&arg.lock);
+  ddsrt_cond_destroy (&arg.cond);
+  ddsrt_mutex_destroy (&arg.lock);
+}
@@ -15,6 +15,8 @@
 
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/misc.h"
+#include "dds/ddsrt/mh3.h"
+#include "dds/ddsrt/string.h"
 
 #include "dds/ddsrt/hopscotch.h"
 #include "dds/ddsrt/avl.h"
@@ -30,6 +32,18 @@ struct entity_index {
   struct ddsrt_chh *guid_hash;
   ddsrt_mutex_t all_entities_lock;
   ddsrt_avl_tree_t all_entities;
+  struct ddsrt_hh *topic_index; /* (kind, topic) -> struct entidx_topic, protected by all_entities_lock */
+};
+
+/* The endpoints of one kind for one topic, so that matching a new endpoint only
+   needs to look at the candidates for the same topic instead of searching the
+   tree of all entities for each next candidate.  Exists only while there are
+   endpoints in it. */
+struct entidx_topic {
+  enum entity_kind kind;
+  uint32_t hash;
+  char *topic;
+  ddsrt_avl_tree_t endpoints; /* ordered on GUID */
 };
 
 static const uint64_t unihashconsts[] = {
@@ -43,6 +57,34 @@ static int all_entities_compare (const void *va, const void *vb);
 static const ddsrt_avl_treedef_t all_entities_treedef =
   DDSRT_AVL_TREEDEF_INITIALIZER (offsetof (struct entity_common, all_entities_avlnode), 0, all_entities_compare, 0);
 
+static int topic_endpoints_compare (const void *va, const void *vb)
+{
+  return memcmp (va, vb, sizeof (ddsi_guid_t));
+}
+
+static const ddsrt_avl_treedef_t topic_endpoints_treedef =
+  DDSRT_AVL_TREEDEF_INITIALIZER (offsetof (struct entity_common, topic_avlnode), offsetof (struct entity_common, guid), topic_endpoints_compare, 0);
+
+static uint32_t hash_entidx_topic (const void *vx)
+{
+  const struct entidx_topic *x = vx;
+  return x->hash;
+}
+
+static int entidx_topic_eq (const void *va, const void *vb)
+{
+  const struct entidx_topic *a = va;
+  const struct entidx_topic *b = vb;
+  return a->kind == b->kind && strcmp (a->topic, b->topic) == 0;
+}
+
+static void entidx_topic_template (struct entidx_topic *template, enum entity_kind kind, const char *topic)
+{
+  template->kind = kind;
+  template->hash = ddsrt_mh3 (topic, strlen (topic), (uint32_t) kind);
+  template->topic = (char *) topic;
+}
+
 static uint32_t hash_entity_guid (const struct entity_common *c)
 {
   return
@@ -240,12 +282,22 @@ struct entity_index *entity_index_new (struct ddsi_domaingv *gv)
   } else {
     ddsrt_mutex_init (&entidx->all_entities_lock);
     ddsrt_avl_init (&all_entities_treedef, &entidx->all_entities);
+    entidx->topic_index = ddsrt_hh_new (32, hash_entidx_topic, entidx_topic_eq);
     return entidx;
   }
 }
 
 void entity_index_free (struct entity_index *entidx)
 {
+  struct ddsrt_hh_iter it;
+  for (struct entidx_topic *x = ddsrt_hh_iter_first (entidx->topic_index, &it); x; x = ddsrt_hh_iter_next (&it))
+  {
+    ddsrt_hh_remove (entidx->topic_index, x);
+    ddsrt_avl_free (&topic_endpoints_treedef, &x->endpoints, 0);
+    ddsrt_free (x->topic);
+    ddsrt_free (x);
+  }
+  ddsrt_hh_free (entidx->topic_index);
   ddsrt_avl_free (&all_entities_treedef, &entidx->all_entities, 0);
   ddsrt_mutex_destroy (&entidx->all_entities_lock);
   ddsrt_chh_free (entidx->guid_hash);
@@ -253,19 +305,74 @@ void entity_index_free (struct entity_index *entidx)
   ddsrt_free (entidx);
 }
 
+static const char *endpoint_topic_name (const struct entity_common *e)
+{
+  switch (e->kind)
+  {
+    case EK_WRITER:
+      return ((const struct writer *) e)->xqos->topic_name;
+    case EK_READER:
+      return ((const struct reader *) e)->xqos->topic_name;
+    case EK_PROXY_WRITER:
+    case EK_PROXY_READER:
+      return ((const struct generic_proxy_endpoint *) e)->c.xqos->topic_name;
+    case EK_PARTICIPANT:
+    case EK_PROXY_PARTICIPANT:
+    case EK_TOPIC:
+      break;
+  }
+  return NULL;
+}
+
+static void add_to_topic_index (struct entity_index *ei, struct entity_common *e, const char *topic)
+{
+  struct entidx_topic template, *x;
+  entidx_topic_template (&template, e->kind, topic);
+  if ((x = ddsrt_hh_lookup (ei->topic_index, &template)) == NULL)
+  {
+    x = ddsrt_malloc (sizeof (*x));
+    *x = template;
+    x->topic = ddsrt_strdup (topic);
+    ddsrt_avl_init (&topic_endpoints_treedef, &x->endpoints);
+    (void) ddsrt_hh_add (ei->topic_index, x);
+  }
+  ddsrt_avl_insert (&topic_endpoints_treedef, &x->endpoints, e);
+}
+
+static void remove_from_topic_index (struct entity_index *ei, struct entity_common *e, const char *topic)
+{
+  struct entidx_topic template, *x;
+  entidx_topic_template (&template, e->kind, topic);
+  x = ddsrt_hh_lookup (ei->topic_index, &template);
+  assert (x != NULL);
+  ddsrt_avl_delete (&topic_endpoints_treedef, &x->endpoints, e);
+  if (ddsrt_avl_is_empty (&x->endpoints))
+  {
+    ddsrt_hh_remove (ei->topic_index, x);
+    ddsrt_free (x->topic);
+    ddsrt_free (x);
+  }
+}
+
 static void add_to_all_entities (struct entity_index *ei, struct entity_common *e)
 {
+  const char *topic = endpoint_topic_name (e);
   ddsrt_mutex_lock (&ei->all_entities_lock);
   assert (ddsrt_avl_lookup (&all_entities_treedef, &ei->all_entities, e) == NULL);
   ddsrt_avl_insert (&all_entities_treedef, &ei->all_entities, e);
+  if (topic)
+    add_to_topic_index (ei, e, topic);
   ddsrt_mutex_unlock (&ei->all_entities_lock);
 }
 
 static void remove_from_all_entities (struct entity_index *ei, struct entity_common *e)
 {
+  const char *topic = endpoint_topic_name (e);
   ddsrt_mutex_lock (&ei->all_entities_lock);
   assert (ddsrt_avl_lookup (&all_entities_treedef, &ei->all_entities, e) != NULL);
   ddsrt_avl_delete (&all_entities_treedef, &ei->all_entities, e);
+  if (topic)
+    remove_from_topic_index (ei, e, topic);
   ddsrt_mutex_unlock (&ei->all_entities_lock);
 }
 
@@ -427,17 +534,39 @@ static void entidx_enum_init_minmax_int (struct entidx_enum *st, const struct en
 #endif
   st->entidx = (struct entity_index *) ei;
   st->kind = min->entity.e.kind;
+  st->topic_only = false;
   ddsrt_mutex_lock (&st->entidx->all_entities_lock);
   st->cur = ddsrt_avl_lookup_succ_eq (&all_entities_treedef, &st->entidx->all_entities, min);
   ddsrt_mutex_unlock (&st->entidx->all_entities_lock);
 }
 
+static void entidx_enum_init_topic_int (struct entidx_enum *st, const struct entity_index *ei, const struct match_entities_range_key *min)
+{
+  /* Same reasoning as entidx_enum_init_minmax_int, but enumerating the endpoints of
+     a single topic using the topic index */
+  struct entidx_topic template, *x;
+#ifndef NDEBUG
+  assert (thread_is_awake ());
+  st->vtime = ddsrt_atomic_ld32 (&lookup_thread_state ()->vtime);
+#endif
+  st->entidx = (struct entity_index *) ei;
+  st->kind = min->entity.e.kind;
+  st->topic_only = true;
+  entidx_topic_template (&template, st->kind, min->xqos.topic_name);
+  ddsrt_mutex_lock (&st->entidx->all_entities_lock);
+  if ((x = ddsrt_hh_lookup (st->entidx->topic_index, &template)) == NULL)
+    st->cur = NULL;
+  else
+    st->cur = ddsrt_avl_lookup_succ_eq (&topic_endpoints_treedef, &x->endpoints, &min->entity.e.guid);
+  ddsrt_mutex_unlock (&st->entidx->all_entities_lock);
+}
+
 void entidx_enum_init_topic (struct entidx_enum *st, const struct entity_index *ei, enum entity_kind kind, const char *topic, struct match_entities_range_key *max)
 {
   assert (kind == EK_READER || kind == EK_WRITER || kind == EK_PROXY_READER || kind == EK_PROXY_WRITER);
   struct match_entities_range_key min;
   match_endpoint_range (kind, topic, &min, max);
-  entidx_enum_init_minmax_int (st, ei, &min);
+  entidx_enum_init_topic_int (st, ei, &min);
   if (st->cur && all_entities_compare (st->cur, &max->entity) > 0)
     st->cur = NULL;
 }
@@ -449,7 +578,7 @@ void entidx_enum_init_topic_w_prefix (struct entidx_enum *st, const struct entit
   match_endpoint_range (kind, topic, &min, max);
   min.entity.e.guid.prefix = *prefix;
   max->entity.e.guid.prefix = *prefix;
-  entidx_enum_init_minmax_int (st, ei, &min);
+  entidx_enum_init_topic_int (st, ei, &min);
   if (st->cur && all_entities_compare (st->cur, &max->entity) > 0)
     st->cur = NULL;
 }
@@ -498,7 +627,9 @@ void *entidx_enum_next (struct entidx_enum *st)
   /* st->cur can not have been freed yet, but it may have been removed from the index */
   assert (ddsrt_atomic_ld32 (&lookup_thread_state ()->vtime) == st->vtime);
   void *res = st->cur;
-  if (st->cur)
+  if (st->cur == NULL)
+    ;
+  else if (!st->topic_only)
   {
     ddsrt_mutex_lock (&st->entidx->all_entities_lock);
     st->cur = ddsrt_avl_lookup_succ (&all_entities_treedef, &st->entidx->all_entities, st->cur);
@@ -506,6 +637,19 @@ void *entidx_enum_next (struct entidx_enum *st)
     if (st->cur && st->cur->kind != st->kind)
       st->cur = NULL;
   }
+  else
+  {
+    /* the topic may have disappeared from the index if st->cur was the last endpoint,
+       the topic name of st->cur is still valid because the GC won't free it yet */
+    struct entidx_topic template, *x;
+    entidx_topic_template (&template, st->kind, endpoint_topic_name (st->cur));
+    ddsrt_mutex_lock (&st->entidx->all_entities_lock);
+    if ((x = ddsrt_hh_lookup (st->entidx->topic_index, &template)) == NULL)
+      st->cur = NULL;
+    else
+      st->cur = ddsrt_avl_lookup_succ (&topic_endpoints_treedef, &x->endpoints, &st->cur->guid);
+    ddsrt_mutex_unlock (&st->entidx->all_entities_lock);
+  }
   return res;
 }
 
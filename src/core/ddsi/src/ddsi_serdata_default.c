@@ -18,6 +18,7 @@
 #include "dds/ddsrt/log.h"
 #include "dds/ddsrt/md5.h"
 #include "dds/ddsrt/mh3.h"
+#include "dds/ddsrt/sync.h"
 #include "dds/ddsi/q_bswap.h"
 #include "dds/ddsi/q_config.h"
 #include "dds/ddsi/q_freelist.h"
@@ -494,6 +495,139 @@ static struct ddsi_serdata *serdata_default_from_sample_cdr_nokey (const struct
   return fix_serdata_default_nokey (d, tpcmn->serdata_basehash);
 }
 
+struct ddsi_serdata_default_cache_slot {
+  uint32_t hash;                        /* hash of the serialized data in sd */
+  uint32_t last;                        /* index of most recently used entry in sd */
+  struct ddsi_serdata_default *sd[2];   /* cached serdata with identical contents, or NULL */
+};
+
+struct ddsi_serdata_default_cache {
+  ddsrt_mutex_t lock;
+  uint32_t nslots;
+  uint64_t hits;
+  struct ddsi_serdata_default *scratch; /* serialization buffer, NULL if handed out */
+  struct ddsi_serdata_default_cache_slot slots[];
+};
+
+struct ddsi_serdata_default_cache *ddsi_serdata_default_cache_new (uint32_t nslots)
+{
+  assert (nslots > 0);
+  struct ddsi_serdata_default_cache *cache = ddsrt_malloc (sizeof (*cache) + nslots * sizeof (cache->slots[0]));
+  ddsrt_mutex_init (&cache->lock);
+  cache->nslots = nslots;
+  cache->hits = 0;
+  cache->scratch = NULL;
+  memset (cache->slots, 0, nslots * sizeof (cache->slots[0]));
+  return cache;
+}
+
+void ddsi_serdata_default_cache_free (struct ddsi_serdata_default_cache *cache)
+{
+  for (uint32_t i = 0; i < cache->nslots; i++)
+  {
+    for (uint32_t j = 0; j < 2; j++)
+      if (cache->slots[i].sd[j])
+        ddsi_serdata_unref (&cache->slots[i].sd[j]->c);
+  }
+  if (cache->scratch)
+    ddsi_serdata_unref (&cache->scratch->c);
+  ddsrt_mutex_destroy (&cache->lock);
+  ddsrt_free (cache);
+}
+
+uint64_t ddsi_serdata_default_cache_hits (struct ddsi_serdata_default_cache *cache)
+{
+  ddsrt_mutex_lock (&cache->lock);
+  const uint64_t hits = cache->hits;
+  ddsrt_mutex_unlock (&cache->lock);
+  return hits;
+}
+
+static bool serdata_default_cache_try_reuse (struct ddsi_serdata_default_cache_slot *slot, uint32_t i, const struct ddsi_serdata_default *d)
+{
+  struct ddsi_serdata_default * const e = slot->sd[i];
+  if (e == NULL || e->pos != d->pos || e->hdr.options != d->hdr.options || memcmp (e->data, d->data, d->pos) != 0)
+    return false;
+  /* Only the cache references it if the refcount is 1, and because nobody else has
+     a pointer to it, nobody else can acquire a new reference: that means it can be
+     modified in place */
+  if (ddsrt_atomic_ld32 (&e->c.refc) != 1)
+    return false;
+  ddsrt_atomic_fence_acq ();
+  e->c.statusinfo = 0;
+  e->c.timestamp.v = INT64_MIN;
+  e->c.twrite.v = INT64_MIN;
+  slot->last = i;
+  return true;
+}
+
+struct ddsi_serdata *ddsi_serdata_default_cache_from_sample (struct ddsi_serdata_default_cache *cache, const struct ddsi_sertype *tpcmn, const void *sample)
+{
+  const struct ddsi_sertype_default *tp = (const struct ddsi_sertype_default *)tpcmn;
+  assert (tpcmn->serdata_ops == &ddsi_serdata_ops_cdr || tpcmn->serdata_ops == &ddsi_serdata_ops_cdr_nokey);
+  ddsrt_mutex_lock (&cache->lock);
+
+  /* Serialize into the scratch serdata: if an identical sample turns out to be cached
+     it is kept for the next call, otherwise it becomes the new serdata */
+  struct ddsi_serdata_default *d = cache->scratch;
+  if (d == NULL && (d = serdata_default_new (tp, SDK_DATA)) == NULL)
+  {
+    ddsrt_mutex_unlock (&cache->lock);
+    return NULL;
+  }
+  cache->scratch = NULL;
+  serdata_default_init (d, tp, SDK_DATA);
+  dds_ostream_t os;
+  dds_ostream_from_serdata_default (&os, d);
+  dds_stream_write_sample (&os, sample, tp);
+  dds_ostream_add_to_serdata_default (&os, &d);
+
+  const uint32_t hash = ddsrt_mh3 (d->data, d->pos, tpcmn->serdata_basehash);
+  struct ddsi_serdata_default_cache_slot * const slot = &cache->slots[hash % cache->nslots];
+  if (slot->hash == hash)
+  {
+    for (uint32_t k = 0; k < 2; k++)
+    {
+      const uint32_t i = slot->last ^ k;
+      if (serdata_default_cache_try_reuse (slot, i, d))
+      {
+        cache->hits++;
+        cache->scratch = d;
+        ddsrt_mutex_unlock (&cache->lock);
+        return ddsi_serdata_ref (&slot->sd[i]->c);
+      }
+    }
+  }
+
+  gen_keyhash_from_sample (tp, &d->keyhash, sample);
+  if (tpcmn->serdata_ops == &ddsi_serdata_ops_cdr_nokey)
+    (void) fix_serdata_default_nokey (d, tpcmn->serdata_basehash);
+  else
+    (void) fix_serdata_default (d, tpcmn->serdata_basehash);
+
+  /* Replace the least recently used entry if the slot holds copies of the same data
+     (all still referenced elsewhere), else replace both */
+  uint32_t i;
+  if (slot->hash == hash && slot->sd[slot->last] != NULL)
+    i = slot->last ^ 1;
+  else
+  {
+    if (slot->sd[slot->last ^ 1])
+    {
+      ddsi_serdata_unref (&slot->sd[slot->last ^ 1]->c);
+      slot->sd[slot->last ^ 1] = NULL;
+    }
+    i = slot->last;
+  }
+  if (slot->sd[i])
+    ddsi_serdata_unref (&slot->sd[i]->c);
+  slot->hash = hash;
+  slot->last = i;
+  slot->sd[i] = d;
+  ddsrt_mutex_unlock (&cache->lock);
+  return ddsi_serdata_ref (&d->c);
+}
+
 static struct ddsi_serdata *serdata_default_to_untyped (const struct ddsi_serdata *serdata_common)
 {
   const struct ddsi_serdata_default *d = (const struct ddsi_serdata_default *)serdata_common;
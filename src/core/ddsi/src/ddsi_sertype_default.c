@@ -85,6 +85,7 @@ static void sertype_default_free (struct ddsi_sertype *tpcmn)
   struct ddsi_sertype_default *tp = (struct ddsi_sertype_default *) tpcmn;
   ddsrt_free (tp->type.keys.keys);
   ddsrt_free (tp->type.ops.ops);
+  ddsrt_free (tp->copy_plan);
   ddsi_sertype_fini (&tp->c);
   ddsrt_free (tp);
 }
@@ -161,6 +162,8 @@ static bool sertype_default_deserialize (struct ddsi_domaingv *gv, struct ddsi_s
     return false;
   DDSRT_WARNING_MSVC_ON(6326)
   st->opt_size = (st->type.flagset & DDS_TOPIC_NO_OPTIMIZE) ? 0 : dds_stream_check_optimize (&st->type);
+  st->copy_plan = (st->type.flagset & DDS_TOPIC_NO_OPTIMIZE) ? NULL : dds_stream_make_copy_plan (&st->type);
+  st->native_ops = NULL;
   return true;
 }
 
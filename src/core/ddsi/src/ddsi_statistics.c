@@ -15,6 +15,7 @@
 #include "dds/ddsi/ddsi_entity_index.h"
 #include "dds/ddsi/ddsi_statistics.h"
 #include "dds/ddsi/q_entity.h"
+#include "dds/ddsi/q_qosmatch.h"
 #include "dds/ddsi/q_radmin.h"
 
 void ddsi_get_writer_stats (struct writer *wr, uint64_t * __restrict rexmit_bytes, uint32_t * __restrict throttle_count, uint64_t * __restrict time_throttled, uint64_t * __restrict time_retransmit)
@@ -63,3 +64,59 @@ void ddsi_get_reader_stats (struct reader *rd, uint64_t * __restrict discarded_b
   }
   ddsrt_mutex_unlock (&rd->e.lock);
 }
+
+void ddsi_get_recv_stats (const struct ddsi_domaingv *gv, uint64_t * __restrict rdbatch_count, uint64_t * __restrict rdbatch_packets)
+{
+  *rdbatch_count = 0;
+  *rdbatch_packets = 0;
+  for (uint32_t i = 0; i < gv->n_recv_threads; i++)
+  {
+    *rdbatch_count += ddsrt_atomic_ld64 (&gv->recv_threads[i].arg.rdbatch_count);
+    *rdbatch_packets += ddsrt_atomic_ld64 (&gv->recv_threads[i].arg.rdbatch_packets);
+  }
+}
+
+void ddsi_get_xmit_stats (const struct ddsi_domaingv *gv, uint64_t * __restrict xmit_batch_count, uint64_t * __restrict xmit_batch_packets)
+{
+  *xmit_batch_count = ddsrt_atomic_ld64 (&gv->xmit_batch_count);
+  *xmit_batch_packets = ddsrt_atomic_ld64 (&gv->xmit_batch_packets);
+}
+
+void ddsi_get_dqueue_stats (const struct ddsi_domaingv *gv, uint64_t * __restrict wakeups_spun, uint64_t * __restrict wakeups_parked)
+{
+  uint64_t spun, parked;
+  *wakeups_spun = *wakeups_parked = 0;
+  for (uint32_t i = 0; i < gv->n_builtins_dqueues; i++)
+  {
+    nn_dqueue_get_wakeup_stats (gv->builtins_dqueues[i], &spun, &parked);
+    *wakeups_spun += spun;
+    *wakeups_parked += parked;
+  }
+#ifdef DDS_HAS_NETWORK_CHANNELS
+  for (const struct ddsi_config_channel_listelem *chptr = gv->config.channels; chptr; chptr = chptr->next)
+  {
+    nn_dqueue_get_wakeup_stats (chptr->dqueue, &spun, &parked);
+    *wakeups_spun += spun;
+    *wakeups_parked += parked;
+  }
+#else
+  nn_dqueue_get_wakeup_stats (gv->user_dqueue, &spun, &parked);
+  *wakeups_spun += spun;
+  *wakeups_parked += parked;
+#endif
+}
+
+void ddsi_get_discovery_stats (const struct ddsi_domaingv *gv, uint64_t * __restrict sedp_sample_count, uint64_t * __restrict sedp_processing_time, uint64_t * __restrict qos_match_cache_hits, uint64_t * __restrict qos_match_cache_misses)
+{
+  *sedp_sample_count = ddsrt_atomic_ld64 (&gv->sedp_sample_count);
+  *sedp_processing_time = ddsrt_atomic_ld64 (&gv->sedp_processing_time);
+  qos_match_cache_get_stats (gv->qos_match_cache, qos_match_cache_hits, qos_match_cache_misses);
+}
+
+void ddsi_get_wraddrset_stats (const struct ddsi_domaingv *gv, uint64_t * __restrict rebuild_count, uint64_t * __restrict rebuild_time, uint64_t * __restrict update_count, uint64_t * __restrict update_time)
+{
+  *rebuild_count = ddsrt_atomic_ld64 (&gv->wraddrset_rebuild_count);
+  *rebuild_time = ddsrt_atomic_ld64 (&gv->wraddrset_rebuild_time);
+  *update_count = ddsrt_atomic_ld64 (&gv->wraddrset_update_count);
+  *update_time = ddsrt_atomic_ld64 (&gv->wraddrset_update_time);
+}
@@ -16,6 +16,8 @@
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/log.h"
 #include "dds/ddsrt/sockets.h"
+#include "dds/ddsrt/string.h"
+#include "dds/ddsrt/sync.h"
 #include "ddsi_eth.h"
 #include "dds/ddsi/ddsi_tran.h"
 #include "dds/ddsi/ddsi_tcp.h"
@@ -23,12 +25,27 @@
 #include "dds/ddsrt/avl.h"
 #include "dds/ddsi/q_config.h"
 #include "dds/ddsi/q_log.h"
+#include "dds/ddsi/q_misc.h"
 #include "dds/ddsi/q_entity.h"
+#include "dds/ddsi/q_thread.h"
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/ddsi_ssl.h"
 
 #define INVALID_PORT (~0u)
 
+/* Maximum number of queued messages written in a single system call */
+#define SENDQ_MAX_IOV 64
+
+/* Maximum number of connections the send thread waits for in one call to select:
+   on Windows an fd_set holds at most FD_SETSIZE sockets (one of which is the
+   trigger), elsewhere it limits the socket values instead, which is handled by
+   only queueing data for sockets below FD_SETSIZE */
+#if defined (_WIN32)
+#define SENDQ_MAX_SELECT (FD_SETSIZE - 1)
+#else
+#define SENDQ_MAX_SELECT INT_MAX
+#endif
+
 /*
   ddsi_tcp_conn: TCP connection for reading and writing. Mutex prevents concurrent
   writes to socket. Is reference counted. Peer port is actually contained in peer
@@ -38,8 +55,31 @@
   is not removed from cache but simply flagged as failed (may be subsequently
   replaced). Similarly server side sockets are not closed as are also used in socket
   wait set that manages their lifecycle.
+
+  If TCP/SendQueueSize > 0 (and SSL is not used), messages that can't be written
+  to the socket immediately are appended to a per-connection send queue, which is
+  drained by the "tcpsend" thread. Everything from the queue is protected by the
+  connection's mutex. Connections with a non-empty queue are on the thread's list
+  and hold a reference to prevent them from being freed. If no progress is made for
+  TCP/WriteTimeout, the thread shuts down the socket, leaving the clean-up to the
+  regular path for a connection closed by the peer.
+
+  What happens when the queue is full is decided per connection when it is
+  created: the first entry of TCP/SendQueueOverflowPeers matching the peer's
+  address determines it, TCP/SendQueueOverflow if none matches.
 */
 
+struct ddsi_tcp_sendq_elem {
+  struct ddsi_tcp_sendq_elem *next;
+  size_t size;
+  unsigned char data[];
+};
+
+struct ddsi_tcp_sendq_overflow_peer {
+  char *pattern;
+  enum ddsi_tcp_sendq_overflow policy;
+};
+
 union addr {
   struct sockaddr a;
   struct sockaddr_in a4;
@@ -57,6 +97,16 @@ typedef struct ddsi_tcp_conn {
 #ifdef DDS_HAS_SSL
   SSL * m_ssl;
 #endif
+  struct ddsi_tcp_sendq_elem *m_sendq_first, *m_sendq_last;
+  size_t m_sendq_off; /* bytes of m_sendq_first already written */
+  size_t m_sendq_bytes; /* bytes in queue (including m_sendq_off) */
+  ddsrt_mtime_t m_sendq_tprogress; /* time of last progress in writing the queue */
+  ddsrt_cond_t m_sendq_cond; /* signalled when the queue shrinks or the connection fails */
+  bool m_sendq_listed; /* on the send thread's list (implies a reference) */
+  bool m_sendq_failed; /* writing failed, connection must be closed */
+  bool m_sendq_selected; /* in the send thread's fd_set in the current iteration */
+  enum ddsi_tcp_sendq_overflow m_sendq_overflow; /* policy if the queue is full */
+  struct ddsi_tcp_conn *m_sendq_next; /* next in list of connections with queued data */
 } *ddsi_tcp_conn_t;
 
 typedef struct ddsi_tcp_listener {
@@ -76,6 +126,19 @@ struct ddsi_tran_factory_tcp {
 #ifdef DDS_HAS_SSL
   struct ddsi_ssl_plugins ddsi_tcp_ssl_plugin;
 #endif
+
+  /* Send queue thread, started on first use; "sendq_trigger" is a UDP socket
+     connected to itself for waking up the thread, DDSRT_INVALID_SOCKET if the
+     send queue is not used */
+  ddsrt_socket_t sendq_trigger;
+  ddsrt_mutex_t sendq_lock;
+  struct thread_state1 *sendq_ts;
+  bool sendq_stop;
+  ddsi_tcp_conn_t sendq_new; /* connections that got queued data, not yet seen by thread */
+
+  /* Per-peer overrides of TCP/SendQueueOverflow */
+  uint32_t n_sendq_overflow_peers;
+  struct ddsi_tcp_sendq_overflow_peer *sendq_overflow_peers;
 };
 
 static int ddsi_tcp_cmp_conn (const struct ddsi_tcp_conn *c1, const struct ddsi_tcp_conn *c2)
@@ -360,7 +423,8 @@ static void ddsi_tcp_cache_remove (ddsi_tcp_conn_t conn)
 
 /*
   ddsi_tcp_cache_find: Find existing connection to target, or if possible
-  create new connection.
+  create new connection. The caller must release the returned reference using
+  ddsi_tcp_conn_unref.
 */
 
 static ddsi_tcp_conn_t ddsi_tcp_cache_find (struct ddsi_tran_factory_tcp *fact, const ddsrt_msghdr_t * msg)
@@ -395,6 +459,8 @@ static ddsi_tcp_conn_t ddsi_tcp_cache_find (struct ddsi_tran_factory_tcp *fact,
     ret = ddsi_tcp_new_conn (fact, NULL, DDSRT_INVALID_SOCKET, false, &key.m_peer_addr.a);
     ddsi_tcp_cache_add (fact, ret, &path);
   }
+  /* caller gets a reference, it may be removed from the cache concurrently */
+  ddsrt_atomic_inc32 (&ret->m_base.m_count);
   ddsrt_mutex_unlock (&fact->ddsi_tcp_cache_lock_g);
 
   return ret;
@@ -418,6 +484,17 @@ static ssize_t ddsi_tcp_conn_read_ssl (ddsi_tcp_conn_t tcp, void * buf, size_t l
 }
 #endif
 
+static bool ddsi_tcp_sock_selectable (ddsrt_socket_t sock)
+{
+  /* select() can't wait for sockets that don't fit in an fd_set */
+#if defined (_WIN32)
+  (void) sock;
+  return true;
+#else
+  return sock >= 0 && sock < FD_SETSIZE;
+#endif
+}
+
 static bool ddsi_tcp_select (struct ddsi_domaingv const * const gv, ddsrt_socket_t sock, bool read, size_t pos, int64_t timeout)
 {
   dds_return_t rc;
@@ -427,6 +504,12 @@ static bool ddsi_tcp_select (struct ddsi_domaingv const * const gv, ddsrt_socket
   int64_t tval = timeout;
   int32_t ready = 0;
 
+  if (!ddsi_tcp_sock_selectable (sock))
+  {
+    GVWARNING ("tcp abandoning %s on blocking socket %d after %"PRIuSIZE" bytes: socket exceeds FD_SETSIZE\n", read ? "read" : "write", (int) sock, pos);
+    return false;
+  }
+
   FD_ZERO (&fds);
 #if LWIP_SOCKET == 1
   DDSRT_WARNING_GNUC_OFF(sign-conversion)
@@ -579,6 +662,362 @@ static ssize_t ddsi_tcp_block_write (ssize_t (*wr) (ddsi_tcp_conn_t, const void
   return (pos == sz) ? (ssize_t) pos : -1;
 }
 
+static void ddsi_tcp_conn_unref (ddsi_tcp_conn_t conn);
+static uint32_t ddsi_tcp_sendq_thread (void *vfact);
+
+static void set_msghdr_iov (ddsrt_msghdr_t *mhdr, ddsrt_iovec_t *iov, size_t iovlen)
+{
+  mhdr->msg_iov = iov;
+  mhdr->msg_iovlen = (ddsrt_msg_iovlen_t)iovlen;
+}
+
+static void ddsi_tcp_sendq_trigger (struct ddsi_tran_factory_tcp *fact)
+{
+  const char dummy = 0;
+  ssize_t sent;
+  /* non-blocking: if the buffer is full, there's a wake-up pending anyway */
+  (void) ddsrt_send (fact->sendq_trigger, &dummy, sizeof (dummy), 0, &sent);
+}
+
+static void ddsi_tcp_sendq_free_elems (ddsi_tcp_conn_t conn)
+{
+  while (conn->m_sendq_first)
+  {
+    struct ddsi_tcp_sendq_elem *e = conn->m_sendq_first;
+    conn->m_sendq_first = e->next;
+    ddsrt_free (e);
+  }
+  conn->m_sendq_last = NULL;
+  conn->m_sendq_off = 0;
+  conn->m_sendq_bytes = 0;
+}
+
+static void ddsi_tcp_sendq_fail (ddsi_tcp_conn_t conn)
+{
+  /* Drops everything queued and marks the connection as failed, blocked writers
+     are woken up; the caller must close the connection or arrange for it to be
+     closed */
+  conn->m_sendq_failed = true;
+  ddsi_tcp_sendq_free_elems (conn);
+  ddsrt_cond_broadcast (&conn->m_sendq_cond);
+}
+
+static void ddsi_tcp_sendq_append (ddsi_tcp_conn_t conn, const ddsrt_msghdr_t *msg, size_t len, size_t pos)
+{
+  struct ddsi_tcp_sendq_elem *e = ddsrt_malloc (sizeof (*e) + len - pos);
+  size_t off = 0;
+  e->next = NULL;
+  e->size = len - pos;
+  for (size_t i = 0; i < (size_t) msg->msg_iovlen; i++)
+  {
+    const size_t n = (size_t) msg->msg_iov[i].iov_len;
+    if (pos >= n)
+      pos -= n;
+    else
+    {
+      memcpy (e->data + off, (const char *) msg->msg_iov[i].iov_base + pos, n - pos);
+      off += n - pos;
+      pos = 0;
+    }
+  }
+  assert (off == e->size);
+  if (conn->m_sendq_first == NULL)
+    conn->m_sendq_first = e;
+  else
+    conn->m_sendq_last->next = e;
+  conn->m_sendq_last = e;
+  conn->m_sendq_bytes += e->size;
+}
+
+static void ddsi_tcp_sendq_list (struct ddsi_tran_factory_tcp *fact, ddsi_tcp_conn_t conn)
+{
+  struct ddsi_domaingv const * const gv = fact->fact.gv;
+  if (conn->m_sendq_listed)
+    return;
+  conn->m_sendq_listed = true;
+  ddsrt_atomic_inc32 (&conn->m_base.m_count);
+  ddsrt_mutex_lock (&fact->sendq_lock);
+  conn->m_sendq_next = fact->sendq_new;
+  fact->sendq_new = conn;
+  if (fact->sendq_ts == NULL && !fact->sendq_stop)
+  {
+    if (create_thread (&fact->sendq_ts, gv, "tcpsend", ddsi_tcp_sendq_thread, fact) != DDS_RETCODE_OK)
+      GVERROR ("ddsi_tcp_sendq_list: failed to create send queue thread\n");
+  }
+  ddsrt_mutex_unlock (&fact->sendq_lock);
+  ddsi_tcp_sendq_trigger (fact);
+}
+
+static ssize_t ddsi_tcp_conn_write_queued (struct ddsi_tran_factory_tcp *fact, ddsi_tcp_conn_t conn, const ddsrt_msghdr_t *msg, size_t len)
+{
+  /* conn->m_mutex held; returns len if the message was written or queued, -1 if
+     it was dropped or the connection failed (conn->m_sendq_failed is set) */
+  struct ddsi_domaingv const * const gv = fact->fact.gv;
+  size_t pos = 0;
+  if (conn->m_sendq_failed)
+    return -1;
+
+  if (conn->m_sendq_first == NULL)
+  {
+    /* nothing queued, so try writing directly */
+    int sendflags = 0;
+    dds_return_t rc;
+    ssize_t ret;
+#ifdef MSG_NOSIGNAL
+    sendflags |= MSG_NOSIGNAL;
+#endif
+    do {
+      rc = ddsrt_sendmsg (conn->m_sock, msg, sendflags, &ret);
+    } while (rc == DDS_RETCODE_INTERRUPTED);
+    if (rc == DDS_RETCODE_OK)
+    {
+      if ((size_t) ret == len)
+        return (ssize_t) len;
+      pos = (size_t) ret;
+    }
+    else if (rc != DDS_RETCODE_TRY_AGAIN)
+    {
+      GVLOG (DDS_LC_TCP, "tcp write: sock %"PRIdSOCK" error %"PRId32"\n", conn->m_sock, rc);
+      ddsi_tcp_sendq_fail (conn);
+      return -1;
+    }
+    conn->m_sendq_tprogress = ddsrt_time_monotonic ();
+  }
+
+  /* A partially written message must be queued regardless of the limit, or the
+     stream would get corrupted */
+  if (pos == 0 && conn->m_sendq_bytes > 0 && conn->m_sendq_bytes + len > gv->config.tcp_sendq_size)
+  {
+    if (conn->m_sendq_overflow == DDSI_TCP_SENDQ_BLOCK)
+    {
+      const ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
+      const ddsrt_mtime_t tend = ddsrt_mtime_add_duration (tnow, gv->config.tcp_write_timeout);
+      GVLOG (DDS_LC_TCP, "tcp write: sock %"PRIdSOCK" queue full (%"PRIuSIZE" bytes), waiting\n", conn->m_sock, conn->m_sendq_bytes);
+      while (!conn->m_sendq_failed && conn->m_sendq_bytes > 0 && conn->m_sendq_bytes + len > gv->config.tcp_sendq_size)
+      {
+        /* tend is on the monotonic clock, so wait for a relative time */
+        const int64_t reltimeout = tend.v - ddsrt_time_monotonic ().v;
+        if (reltimeout <= 0 || !ddsrt_cond_waitfor (&conn->m_sendq_cond, &conn->m_mutex, reltimeout))
+          break;
+      }
+      if (conn->m_sendq_failed)
+        return -1;
+    }
+    if (conn->m_sendq_bytes > 0 && conn->m_sendq_bytes + len > gv->config.tcp_sendq_size)
+    {
+      GVLOG (DDS_LC_TCP, "tcp write: sock %"PRIdSOCK" queue full (%"PRIuSIZE" bytes), dropping %"PRIuSIZE" bytes\n", conn->m_sock, conn->m_sendq_bytes, len);
+      return -1;
+    }
+  }
+
+  if (conn->m_sendq_first == NULL)
+    conn->m_sendq_tprogress = ddsrt_time_monotonic ();
+  ddsi_tcp_sendq_append (conn, msg, len, pos);
+  ddsi_tcp_sendq_list (fact, conn);
+  return (ssize_t) len;
+}
+
+static void ddsi_tcp_sendq_flush (ddsi_tcp_conn_t conn, ddsrt_mtime_t tnow)
+{
+  /* conn->m_mutex held; writes as much as possible, combining queued messages */
+  struct ddsi_domaingv const * const gv = conn->m_base.m_base.gv;
+  ddsrt_iovec_t iov[SENDQ_MAX_IOV];
+  int sendflags = 0;
+#ifdef MSG_NOSIGNAL
+  sendflags |= MSG_NOSIGNAL;
+#endif
+  bool progress = false;
+  while (conn->m_sendq_first && !conn->m_sendq_failed)
+  {
+    ddsrt_msghdr_t msg;
+    size_t niov = 0;
+    for (struct ddsi_tcp_sendq_elem *e = conn->m_sendq_first; e && niov < SENDQ_MAX_IOV; e = e->next)
+    {
+      const size_t off = (niov == 0) ? conn->m_sendq_off : 0;
+      iov[niov].iov_base = (void *) (e->data + off);
+      iov[niov].iov_len = (ddsrt_iov_len_t) (e->size - off);
+      niov++;
+    }
+    memset (&msg, 0, sizeof (msg));
+    set_msghdr_iov (&msg, iov, niov);
+
+    dds_return_t rc;
+    ssize_t ret;
+    do {
+      rc = ddsrt_sendmsg (conn->m_sock, &msg, sendflags, &ret);
+    } while (rc == DDS_RETCODE_INTERRUPTED);
+    if (rc == DDS_RETCODE_TRY_AGAIN)
+      break;
+    else if (rc != DDS_RETCODE_OK)
+    {
+      GVLOG (DDS_LC_TCP, "tcp sendq: sock %"PRIdSOCK" error %"PRId32"\n", conn->m_sock, rc);
+      ddsi_tcp_sendq_fail (conn);
+      break;
+    }
+
+    GVLOG (DDS_LC_TCP, "tcp sendq: sock %"PRIdSOCK" wrote %"PRIdSIZE" bytes from %"PRIuSIZE" messages\n", conn->m_sock, ret, niov);
+    size_t n = (size_t) ret;
+    progress = true;
+    conn->m_sendq_bytes -= n;
+    while (n > 0)
+    {
+      struct ddsi_tcp_sendq_elem *e = conn->m_sendq_first;
+      const size_t rem = e->size - conn->m_sendq_off;
+      if (n < rem)
+      {
+        conn->m_sendq_off += n;
+        n = 0;
+      }
+      else
+      {
+        n -= rem;
+        conn->m_sendq_off = 0;
+        if ((conn->m_sendq_first = e->next) == NULL)
+          conn->m_sendq_last = NULL;
+        ddsrt_free (e);
+      }
+    }
+  }
+  if (progress)
+  {
+    conn->m_sendq_tprogress = tnow;
+    ddsrt_cond_broadcast (&conn->m_sendq_cond);
+  }
+}
+
+static bool ddsi_tcp_sendq_service (ddsi_tcp_conn_t conn, bool writable, ddsrt_mtime_t tnow)
+{
+  /* returns true if the connection should remain on the send thread's list */
+  struct ddsi_domaingv const * const gv = conn->m_base.m_base.gv;
+  bool keep;
+  ddsrt_mutex_lock (&conn->m_mutex);
+  if (conn->m_base.m_closed)
+    ddsi_tcp_sendq_fail (conn);
+  else if (writable)
+    ddsi_tcp_sendq_flush (conn, tnow);
+  if (conn->m_sendq_first && tnow.v - conn->m_sendq_tprogress.v > gv->config.tcp_write_timeout)
+  {
+    GVWARNING ("tcp abandoning %"PRIuSIZE" queued bytes on socket %"PRIdSOCK" after %"PRId64" ms without progress\n",
+               conn->m_sendq_bytes, conn->m_sock, (tnow.v - conn->m_sendq_tprogress.v) / DDS_MSECS (1));
+    ddsi_tcp_sendq_fail (conn);
+  }
+  if (conn->m_sendq_failed && !conn->m_base.m_closed)
+  {
+    /* the receive thread will notice and close the connection */
+    (void) shutdown (conn->m_sock, 2);
+  }
+  if ((keep = (conn->m_sendq_first != NULL)) == false)
+    conn->m_sendq_listed = false;
+  ddsrt_mutex_unlock (&conn->m_mutex);
+  return keep;
+}
+
+static uint32_t ddsi_tcp_sendq_thread (void *vfact)
+{
+  struct ddsi_tran_factory_tcp * const fact = vfact;
+  ddsi_tcp_conn_t conns = NULL;
+  ddsrt_mutex_lock (&fact->sendq_lock);
+  while (!fact->sendq_stop)
+  {
+    while (fact->sendq_new)
+    {
+      ddsi_tcp_conn_t c = fact->sendq_new;
+      fact->sendq_new = c->m_sendq_next;
+      c->m_sendq_next = conns;
+      conns = c;
+    }
+    ddsrt_mutex_unlock (&fact->sendq_lock);
+
+    fd_set rdset, wrset;
+    ddsrt_socket_t maxsock = fact->sendq_trigger;
+    int32_t ready = 0;
+    dds_return_t rc;
+    FD_ZERO (&rdset);
+    FD_ZERO (&wrset);
+#if LWIP_SOCKET == 1
+    DDSRT_WARNING_GNUC_OFF(sign-conversion)
+#endif
+    FD_SET (fact->sendq_trigger, &rdset);
+    int nselected = 0;
+    for (ddsi_tcp_conn_t c = conns; c; c = c->m_sendq_next)
+    {
+      if ((c->m_sendq_selected = (nselected < SENDQ_MAX_SELECT)) == true)
+      {
+        FD_SET (c->m_sock, &wrset);
+        if (c->m_sock > maxsock)
+          maxsock = c->m_sock;
+        nselected++;
+      }
+    }
+#if LWIP_SOCKET == 1
+    DDSRT_WARNING_GNUC_ON(sign-conversion)
+#endif
+    /* timeout only matters for detecting lack of progress */
+    do {
+      rc = ddsrt_select (maxsock + 1, &rdset, &wrset, NULL, (conns == NULL) ? DDS_SECS (1) : DDS_MSECS (100), &ready);
+    } while (rc == DDS_RETCODE_INTERRUPTED);
+    if (rc != DDS_RETCODE_OK && rc != DDS_RETCODE_TIMEOUT)
+    {
+      FD_ZERO (&rdset);
+      FD_ZERO (&wrset);
+    }
+    if (FD_ISSET (fact->sendq_trigger, &rdset))
+    {
+      char buf[64];
+      ssize_t n;
+      while (ddsrt_recv (fact->sendq_trigger, buf, sizeof (buf), 0, &n) == DDS_RETCODE_OK && n > 0)
+        ;
+    }
+
+    /* connections that didn't fit in the fd_set go first next time, so that all of
+       them get their turn */
+    const ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
+    ddsi_tcp_conn_t selected = NULL, *selected_tail = &selected;
+    ddsi_tcp_conn_t *pc = &conns;
+    while (*pc)
+    {
+      ddsi_tcp_conn_t c = *pc;
+      if (!ddsi_tcp_sendq_service (c, c->m_sendq_selected && FD_ISSET (c->m_sock, &wrset), tnow))
+      {
+        *pc = c->m_sendq_next;
+        ddsi_tcp_conn_unref (c);
+      }
+      else if (c->m_sendq_selected)
+      {
+        *pc = c->m_sendq_next;
+        c->m_sendq_next = NULL;
+        *selected_tail = c;
+        selected_tail = &c->m_sendq_next;
+      }
+      else
+      {
+        pc = &c->m_sendq_next;
+      }
+    }
+    *pc = selected;
+    ddsrt_mutex_lock (&fact->sendq_lock);
+  }
+  while (fact->sendq_new)
+  {
+    ddsi_tcp_conn_t c = fact->sendq_new;
+    fact->sendq_new = c->m_sendq_next;
+    c->m_sendq_next = conns;
+    conns = c;
+  }
+  ddsrt_mutex_unlock (&fact->sendq_lock);
+  while (conns)
+  {
+    ddsi_tcp_conn_t c = conns;
+    conns = c->m_sendq_next;
+    ddsrt_mutex_lock (&c->m_mutex);
+    ddsi_tcp_sendq_fail (c);
+    c->m_sendq_listed = false;
+    ddsrt_mutex_unlock (&c->m_mutex);
+    ddsi_tcp_conn_unref (c);
+  }
+  return 0;
+}
+
 static size_t iovlen_sum (size_t niov, const ddsrt_iovec_t *iov)
 {
   size_t tot = 0;
@@ -587,12 +1026,6 @@ static size_t iovlen_sum (size_t niov, const ddsrt_iovec_t *iov)
   return tot;
 }
 
-static void set_msghdr_iov (ddsrt_msghdr_t *mhdr, ddsrt_iovec_t *iov, size_t iovlen)
-{
-  mhdr->msg_iov = iov;
-  mhdr->msg_iovlen = (ddsrt_msg_iovlen_t)iovlen;
-}
-
 static ssize_t ddsi_tcp_conn_write (ddsi_tran_conn_t base, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags)
 {
   struct ddsi_tran_factory_tcp * const fact = (struct ddsi_tran_factory_tcp *) base->m_factory;
@@ -640,6 +1073,7 @@ static ssize_t ddsi_tcp_conn_write (ddsi_tran_conn_t base, const ddsi_locator_t
     if (conn->m_sock == DDSRT_INVALID_SOCKET)
     {
       ddsrt_mutex_unlock (&conn->m_mutex);
+      ddsi_tcp_conn_unref (conn);
       return -1;
     }
     connect = true;
@@ -651,9 +1085,23 @@ static ssize_t ddsi_tcp_conn_write (ddsi_tran_conn_t base, const ddsi_locator_t
   {
     GVLOG (DDS_LC_TCP, "tcp write: sock %"PRIdSOCK" message filtered\n", conn->m_sock);
     ddsrt_mutex_unlock (&conn->m_mutex);
+    ddsi_tcp_conn_unref (conn);
     return (ssize_t) len;
   }
 
+  if (fact->sendq_trigger != DDSRT_INVALID_SOCKET && ddsi_tcp_sock_selectable (conn->m_sock))
+  {
+    msg.msg_name = NULL;
+    msg.msg_namelen = 0;
+    ret = ddsi_tcp_conn_write_queued (fact, conn, &msg, len);
+    const bool failed = conn->m_sendq_failed;
+    ddsrt_mutex_unlock (&conn->m_mutex);
+    if (failed)
+      ddsi_tcp_cache_remove (conn);
+    ddsi_tcp_conn_unref (conn);
+    return ret;
+  }
+
 #ifdef DDS_HAS_SSL
   if (gv->config.ssl_enable)
   {
@@ -767,6 +1215,7 @@ static ssize_t ddsi_tcp_conn_write (ddsi_tran_conn_t base, const ddsi_locator_t
   {
     ddsi_tcp_cache_remove (conn);
   }
+  ddsi_tcp_conn_unref (conn);
 
   return ((size_t) ret == len) ? ret : -1;
 }
@@ -930,6 +1379,20 @@ static void ddsi_tcp_base_init (const struct ddsi_tran_factory_tcp *fact, const
   base->m_locator_fn = ddsi_tcp_locator;
 }
 
+static enum ddsi_tcp_sendq_overflow ddsi_tcp_sendq_overflow_for_peer (const struct ddsi_tran_factory_tcp *fact, const struct sockaddr *peer)
+{
+  struct ddsi_domaingv const * const gv = fact->fact.gv;
+  char buff[DDSI_LOCSTRLEN];
+  if (fact->n_sendq_overflow_peers == 0 || ddsrt_sockaddrtostr (peer, buff, sizeof (buff)) != DDS_RETCODE_OK)
+    return gv->config.tcp_sendq_overflow;
+  for (uint32_t i = 0; i < fact->n_sendq_overflow_peers; i++)
+  {
+    if (ddsi2_patmatch (fact->sendq_overflow_peers[i].pattern, buff))
+      return fact->sendq_overflow_peers[i].policy;
+  }
+  return gv->config.tcp_sendq_overflow;
+}
+
 static ddsi_tcp_conn_t ddsi_tcp_new_conn (struct ddsi_tran_factory_tcp *fact, const struct nn_interface *interf, ddsrt_socket_t sock, bool server, struct sockaddr * peer)
 {
   ddsi_tcp_conn_t conn = ddsrt_malloc (sizeof (*conn));
@@ -937,11 +1400,13 @@ static ddsi_tcp_conn_t ddsi_tcp_new_conn (struct ddsi_tran_factory_tcp *fact, co
   memset (conn, 0, sizeof (*conn));
   ddsi_tcp_base_init (fact, interf, &conn->m_base);
   ddsrt_mutex_init (&conn->m_mutex);
+  ddsrt_cond_init (&conn->m_sendq_cond);
   conn->m_sock = DDSRT_INVALID_SOCKET;
   (void)memcpy(&conn->m_peer_addr, peer, (size_t)ddsrt_sockaddr_get_size(peer));
   conn->m_peer_port = ddsrt_sockaddr_get_port (peer);
   conn->m_base.m_server = server;
   conn->m_base.m_base.m_port = INVALID_PORT;
+  conn->m_sendq_overflow = ddsi_tcp_sendq_overflow_for_peer (fact, peer);
   ddsi_tcp_conn_set_socket (conn, sock);
 
   return conn;
@@ -1006,10 +1471,21 @@ static void ddsi_tcp_conn_delete (ddsi_tcp_conn_t conn)
   {
     ddsi_tcp_sock_free (gv, conn->m_sock, "connection");
   }
+  assert (!conn->m_sendq_listed);
+  ddsi_tcp_sendq_free_elems (conn);
+  ddsrt_cond_destroy (&conn->m_sendq_cond);
   ddsrt_mutex_destroy (&conn->m_mutex);
   ddsrt_free (conn);
 }
 
+static void ddsi_tcp_conn_unref (ddsi_tcp_conn_t conn)
+{
+  /* drops a reference that doesn't close the connection (held by the send thread
+     or returned by ddsi_tcp_cache_find) */
+  if (ddsrt_atomic_dec32_ov (&conn->m_base.m_count) == 1)
+    ddsi_tcp_conn_delete (conn);
+}
+
 static void ddsi_tcp_close_conn (ddsi_tran_conn_t tc)
 {
   struct ddsi_tran_factory_tcp * const fact_tcp = (struct ddsi_tran_factory_tcp *) tc->m_factory;
@@ -1102,10 +1578,32 @@ static void ddsi_tcp_release_listener (ddsi_tran_listener_t listener)
   ddsrt_free (tl);
 }
 
+static void ddsi_tcp_free_sendq_overflow_peers (uint32_t n, struct ddsi_tcp_sendq_overflow_peer *peers)
+{
+  for (uint32_t i = 0; i < n; i++)
+    ddsrt_free (peers[i].pattern);
+  ddsrt_free (peers);
+}
+
 static void ddsi_tcp_release_factory (struct ddsi_tran_factory *fact_cmn)
 {
   struct ddsi_tran_factory_tcp * const fact = (struct ddsi_tran_factory_tcp *) fact_cmn;
   struct ddsi_domaingv const * const gv = fact->fact.gv;
+  if (fact->sendq_trigger != DDSRT_INVALID_SOCKET)
+  {
+    ddsrt_mutex_lock (&fact->sendq_lock);
+    fact->sendq_stop = true;
+    struct thread_state1 * const ts = fact->sendq_ts;
+    ddsrt_mutex_unlock (&fact->sendq_lock);
+    if (ts)
+    {
+      ddsi_tcp_sendq_trigger (fact);
+      join_thread (ts);
+    }
+    ddsi_tcp_sock_free (gv, fact->sendq_trigger, NULL);
+  }
+  ddsrt_mutex_destroy (&fact->sendq_lock);
+  ddsi_tcp_free_sendq_overflow_peers (fact->n_sendq_overflow_peers, fact->sendq_overflow_peers);
   ddsrt_avl_free (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g, ddsi_tcp_node_free);
   ddsrt_mutex_destroy (&fact->ddsi_tcp_cache_lock_g);
 #ifdef DDS_HAS_SSL
@@ -1199,11 +1697,76 @@ static int ddsi_tcp_locator_from_sockaddr (const struct ddsi_tran_factory *tran_
   return 0;
 }
 
+static dds_return_t ddsi_tcp_sendq_trigger_new (struct ddsi_domaingv const * const gv, ddsrt_socket_t *sock)
+{
+  /* UDP socket bound to the IPv4 loopback address and connected to itself, sending
+     a datagram makes it readable, which wakes up the send thread */
+  union addr addr;
+  socklen_t addrlen = sizeof (addr);
+  dds_return_t rc;
+  memset (&addr, 0, sizeof (addr));
+  addr.a4.sin_family = AF_INET;
+  addr.a4.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  addr.a4.sin_port = 0;
+  if ((rc = ddsrt_socket (sock, AF_INET, SOCK_DGRAM, 0)) != DDS_RETCODE_OK)
+    return rc;
+  if ((rc = ddsrt_bind (*sock, &addr.a, ddsrt_sockaddr_get_size (&addr.a))) != DDS_RETCODE_OK ||
+      (rc = ddsrt_getsockname (*sock, &addr.a, &addrlen)) != DDS_RETCODE_OK ||
+      (rc = ddsrt_connect (*sock, &addr.a, ddsrt_sockaddr_get_size (&addr.a))) != DDS_RETCODE_OK ||
+      (rc = ddsrt_setsocknonblocking (*sock, true)) != DDS_RETCODE_OK)
+  {
+    ddsi_tcp_sock_free (gv, *sock, NULL);
+    *sock = DDSRT_INVALID_SOCKET;
+    return rc;
+  }
+  return DDS_RETCODE_OK;
+}
+
+static bool ddsi_tcp_parse_sendq_overflow_peers (struct ddsi_domaingv const * const gv, uint32_t *n, struct ddsi_tcp_sendq_overflow_peer **peers)
+{
+  /* comma-separated list of ADDRESS=POLICY */
+  char *copy = ddsrt_strdup (gv->config.tcp_sendq_overflow_peers ? gv->config.tcp_sendq_overflow_peers : ""), *cursor = copy, *tok;
+  *n = 0;
+  *peers = NULL;
+  while ((tok = ddsrt_strsep (&cursor, ",")) != NULL)
+  {
+    char *policy;
+    if (*tok == 0)
+      continue;
+    if ((policy = strchr (tok, '=')) == NULL || policy == tok)
+      goto err;
+    *policy++ = 0;
+    *peers = ddsrt_realloc (*peers, (*n + 1) * sizeof (**peers));
+    if (strcmp (policy, "block") == 0)
+      (*peers)[*n].policy = DDSI_TCP_SENDQ_BLOCK;
+    else if (strcmp (policy, "drop") == 0)
+      (*peers)[*n].policy = DDSI_TCP_SENDQ_DROP;
+    else
+      goto err;
+    (*peers)[*n].pattern = ddsrt_strdup (tok);
+    (*n)++;
+  }
+  ddsrt_free (copy);
+  return true;
+err:
+  GVERROR ("TCP/SendQueueOverflowPeers: invalid entry \"%s\"\n", tok);
+  ddsi_tcp_free_sendq_overflow_peers (*n, *peers);
+  *n = 0;
+  *peers = NULL;
+  ddsrt_free (copy);
+  return false;
+}
+
 int ddsi_tcp_init (struct ddsi_domaingv *gv)
 {
   struct ddsi_tran_factory_tcp *fact = ddsrt_malloc (sizeof (*fact));
 
   memset (fact, 0, sizeof (*fact));
+  if (!ddsi_tcp_parse_sendq_overflow_peers (gv, &fact->n_sendq_overflow_peers, &fact->sendq_overflow_peers))
+  {
+    ddsrt_free (fact);
+    return -1;
+  }
   fact->m_kind = NN_LOCATOR_KIND_TCPv4;
   fact->fact.gv = gv;
   fact->fact.m_typename = "tcp";
@@ -1258,6 +1821,18 @@ int ddsi_tcp_init (struct ddsi_domaingv *gv)
   ddsrt_avl_init (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g);
   ddsrt_mutex_init (&fact->ddsi_tcp_cache_lock_g);
 
+  ddsrt_mutex_init (&fact->sendq_lock);
+  fact->sendq_trigger = DDSRT_INVALID_SOCKET;
+#ifdef DDS_HAS_SSL
+  if (gv->config.tcp_sendq_size > 0 && !gv->config.ssl_enable)
+#else
+  if (gv->config.tcp_sendq_size > 0)
+#endif
+  {
+    if (ddsi_tcp_sendq_trigger_new (gv, &fact->sendq_trigger) != DDS_RETCODE_OK)
+      GVWARNING ("tcp failed to create send queue trigger, writing directly\n");
+  }
+
   GVLOG (DDS_LC_CONFIG, "tcp initialized\n");
   return 0;
 }
@@ -61,6 +61,47 @@ static void addr_to_loc (const struct ddsi_tran_factory *tran, ddsi_locator_t *d
   ddsi_ipaddr_to_loc (dst, &src->a, (src->a.sa_family == AF_INET) ? NN_LOCATOR_KIND_UDPv4 : NN_LOCATOR_KIND_UDPv6);
 }
 
+static void ddsi_udp_conn_received (ddsi_udp_conn_t conn, unsigned char *buf, size_t len, size_t sz, const union addr *src, bool trunc_flag)
+{
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  if (gv->pcap)
+  {
+    union addr dest;
+    socklen_t dest_len = sizeof (dest);
+    if (ddsrt_getsockname (conn->m_sock, &dest.a, &dest_len) != DDS_RETCODE_OK)
+      memset (&dest, 0, sizeof (dest));
+    write_pcap_received (gv, ddsrt_time_wallclock (), &src->x, &dest.x, buf, sz);
+  }
+
+  /* Check for udp packet truncation */
+  if (sz > len || trunc_flag)
+  {
+    char addrbuf[DDSI_LOCSTRLEN];
+    ddsi_locator_t tmp;
+    addr_to_loc (conn->m_base.m_factory, &tmp, src);
+    ddsi_locator_to_string (addrbuf, sizeof (addrbuf), &tmp);
+    GVWARNING ("%s => %d truncated to %d\n", addrbuf, (int) sz, (int) len);
+  }
+}
+
+static void ddsi_udp_init_msghdr (ddsrt_msghdr_t *msghdr, ddsrt_iovec_t *msg_iov, union addr *src, unsigned char *buf, size_t len)
+{
+  msg_iov->iov_base = (void *) buf;
+  msg_iov->iov_len = (ddsrt_iov_len_t) len; /* Windows uses unsigned, POSIX (except Linux) int */
+
+  msghdr->msg_name = &src->x;
+  msghdr->msg_namelen = (socklen_t) sizeof (*src);
+  msghdr->msg_iov = msg_iov;
+  msghdr->msg_iovlen = 1;
+#if defined(__sun) && !defined(_XPG4_2)
+  msghdr->msg_accrights = NULL;
+  msghdr->msg_accrightslen = 0;
+#else
+  msghdr->msg_control = NULL;
+  msghdr->msg_controllen = 0;
+#endif
+}
+
 static ssize_t ddsi_udp_conn_read (ddsi_tran_conn_t conn_cmn, unsigned char * buf, size_t len, bool allow_spurious, ddsi_locator_t *srcloc)
 {
   ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
@@ -70,24 +111,9 @@ static ssize_t ddsi_udp_conn_read (ddsi_tran_conn_t conn_cmn, unsigned char * bu
   ddsrt_msghdr_t msghdr;
   union addr src;
   ddsrt_iovec_t msg_iov;
-  socklen_t srclen = (socklen_t) sizeof (src);
   (void) allow_spurious;
 
-  msg_iov.iov_base = (void *) buf;
-  msg_iov.iov_len = (ddsrt_iov_len_t) len; /* Windows uses unsigned, POSIX (except Linux) int */
-
-  msghdr.msg_name = &src.x;
-  msghdr.msg_namelen = srclen;
-  msghdr.msg_iov = &msg_iov;
-  msghdr.msg_iovlen = 1;
-#if defined(__sun) && !defined(_XPG4_2)
-  msghdr.msg_accrights = NULL;
-  msghdr.msg_accrightslen = 0;
-#else
-  msghdr.msg_control = NULL;
-  msghdr.msg_controllen = 0;
-#endif
-
+  ddsi_udp_init_msghdr (&msghdr, &msg_iov, &src, buf, len);
   do {
     rc = ddsrt_recvmsg (conn->m_sock, &msghdr, 0, &ret);
   } while (rc == DDS_RETCODE_INTERRUPTED);
@@ -96,30 +122,12 @@ static ssize_t ddsi_udp_conn_read (ddsi_tran_conn_t conn_cmn, unsigned char * bu
   {
     if (srcloc)
       addr_to_loc (conn->m_base.m_factory, srcloc, &src);
-
-    if (gv->pcap_fp)
-    {
-      union addr dest;
-      socklen_t dest_len = sizeof (dest);
-      if (ddsrt_getsockname (conn->m_sock, &dest.a, &dest_len) != DDS_RETCODE_OK)
-        memset (&dest, 0, sizeof (dest));
-      write_pcap_received (gv, ddsrt_time_wallclock (), &src.x, &dest.x, buf, (size_t) ret);
-    }
-
-    /* Check for udp packet truncation */
 #if DDSRT_MSGHDR_FLAGS
     const bool trunc_flag = (msghdr.msg_flags & MSG_TRUNC) != 0;
 #else
     const bool trunc_flag = false;
 #endif
-    if ((size_t) ret > len || trunc_flag)
-    {
-      char addrbuf[DDSI_LOCSTRLEN];
-      ddsi_locator_t tmp;
-      addr_to_loc (conn->m_base.m_factory, &tmp, &src);
-      ddsi_locator_to_string (addrbuf, sizeof (addrbuf), &tmp);
-      GVWARNING ("%s => %d truncated to %d\n", addrbuf, (int) ret, (int) len);
-    }
+    ddsi_udp_conn_received (conn, buf, len, (size_t) ret, &src, trunc_flag);
   }
   else if (rc != DDS_RETCODE_BAD_PARAMETER && rc != DDS_RETCODE_NO_CONNECTION)
   {
@@ -129,42 +137,96 @@ static ssize_t ddsi_udp_conn_read (ddsi_tran_conn_t conn_cmn, unsigned char * bu
   return ret;
 }
 
+#if DDSRT_HAVE_MMSG
+static int ddsi_udp_conn_read_batch (ddsi_tran_conn_t conn_cmn, uint32_t n, unsigned char * const *bufs, size_t len, size_t *szs, ddsi_locator_t *srclocs)
+{
+  ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  ddsrt_mmsghdr_t msgvec[DDSI_MAX_READ_BATCH];
+  ddsrt_iovec_t msg_iov[DDSI_MAX_READ_BATCH];
+  union addr src[DDSI_MAX_READ_BATCH];
+  dds_return_t rc;
+  uint32_t nrcvd = 0;
+
+  assert (n > 0);
+  if (n > DDSI_MAX_READ_BATCH)
+    n = DDSI_MAX_READ_BATCH;
+  for (uint32_t i = 0; i < n; i++)
+  {
+    ddsi_udp_init_msghdr (&msgvec[i].msg_hdr, &msg_iov[i], &src[i], bufs[i], len);
+    msgvec[i].msg_len = 0;
+  }
+  do {
+    rc = ddsrt_recvmmsg (conn->m_sock, msgvec, n, 0, &nrcvd);
+  } while (rc == DDS_RETCODE_INTERRUPTED);
+
+  if (rc != DDS_RETCODE_OK)
+  {
+    if (rc == DDS_RETCODE_BAD_PARAMETER || rc == DDS_RETCODE_NO_CONNECTION)
+      return 0;
+    GVERROR ("UDP recvmmsg sock %d: retcode %"PRId32"\n", (int) conn->m_sock, rc);
+    return -1;
+  }
+
+  for (uint32_t i = 0; i < nrcvd; i++)
+  {
+    szs[i] = msgvec[i].msg_len;
+    if (srclocs)
+      addr_to_loc (conn->m_base.m_factory, &srclocs[i], &src[i]);
+    if (szs[i] > 0)
+      ddsi_udp_conn_received (conn, bufs[i], len, szs[i], &src[i], (msgvec[i].msg_hdr.msg_flags & MSG_TRUNC) != 0);
+  }
+  return (int) nrcvd;
+}
+#endif
+
 static void set_msghdr_iov (ddsrt_msghdr_t *mhdr, const ddsrt_iovec_t *iov, size_t iovlen)
 {
   mhdr->msg_iov = (ddsrt_iovec_t *) iov;
   mhdr->msg_iovlen = (ddsrt_msg_iovlen_t) iovlen;
 }
 
-static ssize_t ddsi_udp_conn_write (ddsi_tran_conn_t conn_cmn, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags)
+static void ddsi_udp_init_send_msghdr (ddsrt_msghdr_t *msg, union addr *dstaddr, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags)
 {
-  ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
-  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
-  dds_return_t rc;
-  ssize_t ret = -1;
-  unsigned retry = 2;
-  int sendflags = 0;
-  ddsrt_msghdr_t msg;
-  union addr dstaddr;
-  assert (niov <= INT_MAX);
-  ddsi_ipaddr_from_loc (&dstaddr.x, dst);
-  set_msghdr_iov (&msg, iov, niov);
-  msg.msg_name = &dstaddr.x;
-  msg.msg_namelen = (socklen_t) ddsrt_sockaddr_get_size (&dstaddr.a);
+  ddsi_ipaddr_from_loc (&dstaddr->x, dst);
+  set_msghdr_iov (msg, iov, niov);
+  msg->msg_name = &dstaddr->x;
+  msg->msg_namelen = (socklen_t) ddsrt_sockaddr_get_size (&dstaddr->a);
 #if defined(__sun) && !defined(_XPG4_2)
-  msg.msg_accrights = NULL;
-  msg.msg_accrightslen = 0;
+  msg->msg_accrights = NULL;
+  msg->msg_accrightslen = 0;
 #else
-  msg.msg_control = NULL;
-  msg.msg_controllen = 0;
+  msg->msg_control = NULL;
+  msg->msg_controllen = 0;
 #endif
 #if DDSRT_MSGHDR_FLAGS
-  msg.msg_flags = (int) flags;
+  msg->msg_flags = (int) flags;
 #else
   DDSRT_UNUSED_ARG (flags);
 #endif
+}
+
+static int ddsi_udp_sendflags (void)
+{
+  int sendflags = 0;
 #if MSG_NOSIGNAL && !LWIP_SOCKET
   sendflags |= MSG_NOSIGNAL;
 #endif
+  return sendflags;
+}
+
+static ssize_t ddsi_udp_conn_write (ddsi_tran_conn_t conn_cmn, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags)
+{
+  ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  dds_return_t rc;
+  ssize_t ret = -1;
+  unsigned retry = 2;
+  const int sendflags = ddsi_udp_sendflags ();
+  ddsrt_msghdr_t msg;
+  union addr dstaddr;
+  assert (niov <= INT_MAX);
+  ddsi_udp_init_send_msghdr (&msg, &dstaddr, dst, niov, iov, flags);
   do {
     rc = ddsrt_sendmsg (conn->m_sock, &msg, sendflags, &ret);
 #if defined _WIN32 && !defined WINCE
@@ -176,7 +238,7 @@ static ssize_t ddsi_udp_conn_write (ddsi_tran_conn_t conn_cmn, const ddsi_locato
     }
 #endif
   } while (rc == DDS_RETCODE_INTERRUPTED || rc == DDS_RETCODE_TRY_AGAIN || (rc == DDS_RETCODE_NOT_ALLOWED && retry-- > 0));
-  if (ret > 0 && gv->pcap_fp)
+  if (ret > 0 && gv->pcap)
   {
     union addr sa;
     socklen_t alen = sizeof (sa);
@@ -192,6 +254,53 @@ static ssize_t ddsi_udp_conn_write (ddsi_tran_conn_t conn_cmn, const ddsi_locato
   return (rc == DDS_RETCODE_OK) ? ret : -1;
 }
 
+#if DDSRT_HAVE_MMSG
+static int ddsi_udp_conn_write_multi (ddsi_tran_conn_t conn_cmn, uint32_t ndst, const ddsi_locator_t *dsts, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags)
+{
+  ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  const int sendflags = ddsi_udp_sendflags ();
+  ddsrt_mmsghdr_t msgvec[DDSI_MAX_WRITE_BATCH];
+  union addr dstaddrs[DDSI_MAX_WRITE_BATCH];
+  uint32_t off = 0, nok = 0;
+  assert (niov <= INT_MAX);
+  assert (ndst > 0 && ndst <= DDSI_MAX_WRITE_BATCH);
+  for (uint32_t i = 0; i < ndst; i++)
+  {
+    ddsi_udp_init_send_msghdr (&msgvec[i].msg_hdr, &dstaddrs[i], &dsts[i], niov, iov, flags);
+    msgvec[i].msg_len = 0;
+  }
+  while (off < ndst)
+  {
+    uint32_t nsent;
+    dds_return_t rc = ddsrt_sendmmsg (conn->m_sock, msgvec + off, ndst - off, sendflags, &nsent);
+    if (rc == DDS_RETCODE_OK)
+    {
+      if (gv->pcap)
+      {
+        union addr sa;
+        socklen_t alen = sizeof (sa);
+        if (ddsrt_getsockname (conn->m_sock, &sa.a, &alen) != DDS_RETCODE_OK)
+          memset(&sa, 0, sizeof(sa));
+        for (uint32_t i = off; i < off + nsent; i++)
+          write_pcap_sent (gv, ddsrt_time_wallclock (), &sa.x, &msgvec[i].msg_hdr, msgvec[i].msg_len);
+      }
+      off += nsent;
+      nok += nsent;
+    }
+    else if (rc != DDS_RETCODE_INTERRUPTED && rc != DDS_RETCODE_TRY_AGAIN)
+    {
+      /* Sending to this destination failed: let the single-destination path deal with
+         retrying and reporting it, then continue with the remaining ones */
+      if (ddsi_udp_conn_write (conn_cmn, &dsts[off], niov, iov, flags) > 0)
+        nok++;
+      off++;
+    }
+  }
+  return (int) nok;
+}
+#endif
+
 static void ddsi_udp_disable_multiplexing (ddsi_tran_conn_t conn_cmn)
 {
 #if defined _WIN32 && !defined WINCE
@@ -519,6 +628,21 @@ static dds_return_t ddsi_udp_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_
     }
   }
 
+  if (qos->m_reuse_port)
+  {
+    assert (qos->m_purpose == DDSI_TRAN_QOS_RECV_UC);
+#ifdef SO_REUSEPORT
+    if ((rc = ddsrt_setsockopt (sock, SOL_SOCKET, SO_REUSEPORT, &one, sizeof (one))) != DDS_RETCODE_OK)
+    {
+      GVERROR ("ddsi_udp_create_conn: failed to enable port reuse: %s\n", dds_strretcode (rc));
+      goto fail_w_socket;
+    }
+#else
+    GVERROR ("ddsi_udp_create_conn: port reuse not supported on this platform\n");
+    goto fail_w_socket;
+#endif
+  }
+
   if ((rc = set_rcvbuf (gv, sock, &gv->config.socket_min_rcvbuf_size)) < 0)
     goto fail_w_socket;
   if (rc > 0) {
@@ -586,6 +710,10 @@ static dds_return_t ddsi_udp_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_
 
   conn->m_base.m_read_fn = ddsi_udp_conn_read;
   conn->m_base.m_write_fn = ddsi_udp_conn_write;
+#if DDSRT_HAVE_MMSG
+  conn->m_base.m_read_batch_fn = ddsi_udp_conn_read_batch;
+  conn->m_base.m_write_multi_fn = ddsi_udp_conn_write_multi;
+#endif
   conn->m_base.m_disable_multiplexing_fn = ddsi_udp_disable_multiplexing;
   conn->m_base.m_locator_fn = ddsi_udp_conn_locator;
 
@@ -14,6 +14,7 @@
 #include <assert.h>
 
 #include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/avl.h"
 #include "dds/ddsrt/static_assert.h"
 #include "dds/ddsi/q_entity.h"
 #include "dds/ddsi/q_addrset.h"
@@ -811,3 +812,316 @@ struct addrset *compute_writer_addrset (const struct writer *wr)
   locset_free (locs);
   return newas;
 }
+
+// Incremental updates
+//
+// Computing the address set from scratch means building the cover matrix for all
+// matched readers and all their locators, which gets expensive when there are many
+// readers.  Most changes in the set of matched readers don't affect the result in an
+// interesting way: a new reader is often reachable via a locator that is already in
+// use (a reader in the same process, or the writer is using multicast) and a reader
+// disappearing often just means a unicast locator is no longer needed.
+//
+// For each locator in the address set, the writer tracks the number of matched proxy
+// readers that have it in their address set, so it knows when a locator is no longer
+// needed.  This is only done if all readers are "simple": no redundant networking, no
+// SSM, no MCGEN and no Iceoryx, because the reasoning below doesn't hold for those.
+// Changes where the greedy algorithm could reasonably come to a different choice
+// between unicast and multicast result in a full recomputation.
+//
+// Invariant: for each locator L in "refs", nrds = number of wr_prd_match entries "m"
+// with L in m->counted_as.  Every m->counted_as that is non-empty contains at least
+// one locator in "refs", so removing locators with nrds = 0 leaves all readers
+// reachable.
+
+struct wraddrset_locref {
+  ddsrt_avl_node_t avlnode;
+  ddsi_xlocator_t loc;
+  bool is_mc;
+  uint32_t nrds;
+};
+
+struct wraddrset_refs {
+  ddsrt_avl_tree_t locs;
+};
+
+static int compare_xlocators_vwrap (const void *va, const void *vb)
+{
+  return compare_xlocators (va, vb);
+}
+
+static const ddsrt_avl_treedef_t wraddrset_refs_treedef =
+  DDSRT_AVL_TREEDEF_INITIALIZER (offsetof (struct wraddrset_locref, avlnode), offsetof (struct wraddrset_locref, loc), compare_xlocators_vwrap, 0);
+
+static void wras_check_simple_helper (const ddsi_xlocator_t *loc, void *varg)
+{
+  bool * const simple = varg;
+  if (loc->c.kind == NN_LOCATOR_KIND_UDPv4MCGEN || locator_is_iceoryx (loc))
+    *simple = false;
+}
+
+static bool wras_prd_is_simple (const struct writer *wr, const struct proxy_reader *prd)
+{
+  if (prd->redundant_networking)
+    return false;
+#ifdef DDS_HAS_SSM
+  if (prd->favours_ssm && wr->supports_ssm)
+    return false;
+#else
+  (void) wr;
+#endif
+  bool simple = true;
+  addrset_forall (prd->c.as, wras_check_simple_helper, &simple);
+  return simple;
+}
+
+static struct wraddrset_locref *wras_refs_insert (const struct ddsi_domaingv *gv, struct wraddrset_refs *refs, const ddsi_xlocator_t *loc)
+{
+  struct wraddrset_locref *n = ddsrt_malloc (sizeof (*n));
+  n->loc = *loc;
+  n->is_mc = ddsi_is_mcaddr (gv, &loc->c);
+  n->nrds = 0;
+  ddsrt_avl_insert (&wraddrset_refs_treedef, &refs->locs, n);
+  return n;
+}
+
+struct wras_refs_insert_helper_arg {
+  const struct ddsi_domaingv *gv;
+  struct wraddrset_refs *refs;
+};
+
+static void wras_refs_insert_helper (const ddsi_xlocator_t *loc, void *varg)
+{
+  struct wras_refs_insert_helper_arg * const arg = varg;
+  (void) wras_refs_insert (arg->gv, arg->refs, loc);
+}
+
+struct wras_refs_adjust_helper_arg {
+  const struct ddsi_domaingv *gv;
+  struct wraddrset_refs *refs;
+  struct addrset *as; // address set of the writer
+  int32_t delta;
+  uint32_t n; // number of locators of the reader in refs
+  bool mc_single; // a multicast locator now reaches only a single reader
+  struct addrset *newas; // copy of "as" with unused locators removed, NULL if unchanged
+};
+
+static void wras_refs_adjust_helper (const ddsi_xlocator_t *loc, void *varg)
+{
+  struct wras_refs_adjust_helper_arg * const arg = varg;
+  struct wraddrset_locref *n;
+  if ((n = ddsrt_avl_lookup (&wraddrset_refs_treedef, &arg->refs->locs, loc)) == NULL)
+    return;
+  arg->n++;
+  if (arg->delta > 0)
+    n->nrds++;
+  else
+  {
+    assert (n->nrds > 0);
+    if (--n->nrds == 1 && n->is_mc)
+      arg->mc_single = true;
+    else if (n->nrds == 0)
+    {
+      if (arg->newas == NULL)
+      {
+        arg->newas = new_addrset ();
+        copy_addrset_into_addrset (arg->gv, arg->newas, arg->as);
+      }
+      remove_from_addrset (arg->gv, arg->newas, &n->loc);
+      ddsrt_avl_delete (&wraddrset_refs_treedef, &arg->refs->locs, n);
+      ddsrt_free (n);
+    }
+  }
+}
+
+struct wras_count_helper_arg {
+  const ddsi_xlocator_t *loc;
+  bool found;
+};
+
+static void wras_count_helper (const ddsi_xlocator_t *loc, void *varg)
+{
+  struct wras_count_helper_arg * const arg = varg;
+  if (compare_xlocators (loc, arg->loc) == 0)
+    arg->found = true;
+}
+
+static uint32_t wras_count_readers_with_locator (struct writer *wr, const ddsi_xlocator_t *loc)
+{
+  ddsrt_avl_iter_t it;
+  uint32_t nrds = 0;
+  for (const struct wr_prd_match *m = ddsrt_avl_iter_first (&wr_readers_treedef, &wr->readers, &it); m; m = ddsrt_avl_iter_next (&it))
+  {
+    struct wras_count_helper_arg arg = { .loc = loc, .found = false };
+    if (m->counted_as == NULL)
+      continue;
+    addrset_forall (m->counted_as, wras_count_helper, &arg);
+    nrds += arg.found;
+  }
+  return nrds;
+}
+
+#ifndef NDEBUG
+static void wras_check_refs (struct writer *wr)
+{
+  ddsrt_avl_iter_t it;
+  size_t nlocs = 0;
+  for (const struct wraddrset_locref *n = ddsrt_avl_iter_first (&wraddrset_refs_treedef, &wr->as_refs->locs, &it); n; n = ddsrt_avl_iter_next (&it))
+  {
+    assert (n->nrds > 0);
+    assert (n->nrds == wras_count_readers_with_locator (wr, &n->loc));
+    nlocs++;
+  }
+  assert (nlocs == addrset_count (wr->as));
+}
+#else
+static void wras_check_refs (struct writer *wr)
+{
+  (void) wr;
+}
+#endif
+
+void wraddrset_refs_clear (struct writer *wr)
+{
+  if (wr->as_refs == NULL)
+    return;
+  ddsrt_avl_iter_t it;
+  for (struct wr_prd_match *m = ddsrt_avl_iter_first (&wr_readers_treedef, &wr->readers, &it); m; m = ddsrt_avl_iter_next (&it))
+  {
+    if (m->counted_as)
+    {
+      unref_addrset (m->counted_as);
+      m->counted_as = NULL;
+    }
+  }
+  ddsrt_avl_free (&wraddrset_refs_treedef, &wr->as_refs->locs, ddsrt_free);
+  ddsrt_free (wr->as_refs);
+  wr->as_refs = NULL;
+}
+
+void wraddrset_refs_reset (struct writer *wr)
+{
+  struct ddsi_domaingv * const gv = wr->e.gv;
+  struct entity_index * const gh = gv->entity_index;
+  wraddrset_refs_clear (wr);
+
+  struct wraddrset_refs *refs = ddsrt_malloc (sizeof (*refs));
+  ddsrt_avl_init (&wraddrset_refs_treedef, &refs->locs);
+  wr->as_refs = refs;
+  struct wras_refs_insert_helper_arg iarg = { .gv = gv, .refs = refs };
+  addrset_forall (wr->as, wras_refs_insert_helper, &iarg);
+
+  ddsrt_avl_iter_t it;
+  for (struct wr_prd_match *m = ddsrt_avl_iter_first (&wr_readers_treedef, &wr->readers, &it); m; m = ddsrt_avl_iter_next (&it))
+  {
+    struct proxy_reader *prd;
+    if ((prd = entidx_lookup_proxy_reader_guid (gh, &m->prd_guid)) == NULL)
+      continue;
+    if (!wras_prd_is_simple (wr, prd))
+      goto unsupported;
+    struct wras_refs_adjust_helper_arg arg = { .gv = gv, .refs = refs, .as = wr->as, .delta = 1, .n = 0, .mc_single = false, .newas = NULL };
+    addrset_forall (prd->c.as, wras_refs_adjust_helper, &arg);
+    // the address set of the proxy reader may have changed while computing the cover,
+    // in which case the change will trigger a recomputation
+    if (arg.n == 0 && !addrset_empty (prd->c.as))
+      goto unsupported;
+    m->counted_as = ref_addrset (prd->c.as);
+  }
+  ddsrt_avl_iter_t it1;
+  for (struct wraddrset_locref *n = ddsrt_avl_iter_first (&wraddrset_refs_treedef, &refs->locs, &it1); n; n = ddsrt_avl_iter_next (&it1))
+    if (n->nrds == 0)
+      goto unsupported;
+  wras_check_refs (wr);
+  return;
+
+unsupported:
+  wraddrset_refs_clear (wr);
+}
+
+struct wras_choose_uc_helper_arg {
+  const struct ddsi_domaingv *gv;
+  bool has_mc;
+  bool found;
+  bool best_loopback;
+  ddsi_xlocator_t best;
+};
+
+static void wras_choose_uc_helper (const ddsi_xlocator_t *loc, void *varg)
+{
+  // For a single reader with only unicast locators, the cost function differs only in
+  // whether or not the locator is a loopback one, and of equal costs it picks the first
+  // in the order used by wras_calc_locators
+  struct wras_choose_uc_helper_arg * const arg = varg;
+  if (ddsi_is_mcaddr (arg->gv, &loc->c))
+  {
+    arg->has_mc = true;
+    return;
+  }
+  const bool loopback = isloopback (arg->gv, loc);
+  if (!arg->found || (loopback && !arg->best_loopback) ||
+      (loopback == arg->best_loopback && wras_compare_locs (loc, &arg->best) < 0))
+  {
+    arg->found = true;
+    arg->best_loopback = loopback;
+    arg->best = *loc;
+  }
+}
+
+bool wraddrset_add_reader (struct writer *wr, struct wr_prd_match *m, struct proxy_reader *prd, struct addrset **newas)
+{
+  struct ddsi_domaingv * const gv = wr->e.gv;
+  *newas = NULL;
+  if (wr->as_refs == NULL || !wras_prd_is_simple (wr, prd))
+    return false;
+  assert (m->counted_as == NULL);
+  struct wras_refs_adjust_helper_arg arg = { .gv = gv, .refs = wr->as_refs, .as = wr->as, .delta = 1, .n = 0, .mc_single = false, .newas = NULL };
+  addrset_forall (prd->c.as, wras_refs_adjust_helper, &arg);
+  if (arg.n == 0 && !addrset_empty (prd->c.as))
+  {
+    // Not reachable via any of the locators in use: if it has only unicast locators, a
+    // full recomputation would add the cheapest of those (modulo the choice between
+    // unicast locators that are shared with other readers, which is immaterial), but if
+    // it has multicast ones, switching to multicast may well be preferable.
+    struct wras_choose_uc_helper_arg carg = { .gv = gv, .has_mc = false, .found = false, .best_loopback = false };
+    addrset_forall (prd->c.as, wras_choose_uc_helper, &carg);
+    if (carg.has_mc || !carg.found)
+      return false;
+    m->counted_as = ref_addrset (prd->c.as);
+    struct wraddrset_locref *n = wras_refs_insert (gv, wr->as_refs, &carg.best);
+    n->nrds = wras_count_readers_with_locator (wr, &carg.best);
+    *newas = new_addrset ();
+    copy_addrset_into_addrset (gv, *newas, wr->as);
+    add_xlocator_to_addrset (gv, *newas, &carg.best);
+  }
+  else
+  {
+    m->counted_as = ref_addrset (prd->c.as);
+  }
+  return true;
+}
+
+bool wraddrset_remove_reader (struct writer *wr, struct wr_prd_match *m, struct addrset **newas)
+{
+  *newas = NULL;
+  if (wr->as_refs == NULL || m->counted_as == NULL)
+    return false;
+  struct wras_refs_adjust_helper_arg arg = { .gv = wr->e.gv, .refs = wr->as_refs, .as = wr->as, .delta = -1, .n = 0, .mc_single = false, .newas = NULL };
+  addrset_forall (m->counted_as, wras_refs_adjust_helper, &arg);
+  unref_addrset (m->counted_as);
+  m->counted_as = NULL;
+  if (arg.mc_single)
+  {
+    // Unicast may well be preferable once a multicast address reaches only one reader
+    if (arg.newas)
+      unref_addrset (arg.newas);
+    return false;
+  }
+  *newas = arg.newas;
+  return true;
+}
+
+void wraddrset_check (struct writer *wr)
+{
+  if (wr->as_refs)
+    wras_check_refs (wr);
+}
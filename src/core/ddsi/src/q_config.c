@@ -183,6 +183,9 @@ DUPF(bandwidth);
 DUPF(domainId);
 DUPF(transport_selector);
 DUPF(many_sockets_mode);
+DUPF(tcp_sendq_overflow);
+DUPF(xevent_scheduler);
+DUPF(trace_format);
 DU(deaf_mute);
 #ifdef DDS_HAS_SSL
 DUPF(min_tls_version);
@@ -947,6 +950,18 @@ static const enum ddsi_many_sockets_mode en_many_sockets_mode_ms[] = {
   DDSI_MSM_SINGLE_UNICAST, DDSI_MSM_NO_UNICAST, DDSI_MSM_MANY_UNICAST, DDSI_MSM_SINGLE_UNICAST, DDSI_MSM_MANY_UNICAST, 0 };
 GENERIC_ENUM_CTYPE (many_sockets_mode, enum ddsi_many_sockets_mode)
 
+static const char *en_tcp_sendq_overflow_vs[] = { "block", "drop", NULL };
+static const enum ddsi_tcp_sendq_overflow en_tcp_sendq_overflow_ms[] = { DDSI_TCP_SENDQ_BLOCK, DDSI_TCP_SENDQ_DROP, 0 };
+GENERIC_ENUM_CTYPE (tcp_sendq_overflow, enum ddsi_tcp_sendq_overflow)
+
+static const char *en_xevent_scheduler_vs[] = { "heap", "wheel", NULL };
+static const enum ddsi_xevent_scheduler en_xevent_scheduler_ms[] = { DDSI_XEVENT_SCHEDULER_HEAP, DDSI_XEVENT_SCHEDULER_WHEEL, 0 };
+GENERIC_ENUM_CTYPE (xevent_scheduler, enum ddsi_xevent_scheduler)
+
+static const char *en_trace_format_vs[] = { "text", "binary", NULL };
+static const enum ddsi_trace_format en_trace_format_ms[] = { DDSI_TRACE_FORMAT_TEXT, DDSI_TRACE_FORMAT_BINARY, 0 };
+GENERIC_ENUM_CTYPE (trace_format, enum ddsi_trace_format)
+
 static const char *en_standards_conformance_vs[] = { "pedantic", "strict", "lax", NULL };
 static const enum ddsi_standards_conformance en_standards_conformance_ms[] = { DDSI_SC_PEDANTIC, DDSI_SC_STRICT, DDSI_SC_LAX, 0 };
 GENERIC_ENUM_CTYPE (standards_conformance, enum ddsi_standards_conformance)
@@ -2439,6 +2454,8 @@ void config_fini (struct cfgst *cfgst)
   free_all_elements (cfgst, cfgst->cfg, root_cfgelems);
   dds_set_log_file (stderr);
   dds_set_trace_file (stderr);
+  if (cfgst->cfg->tracefp)
+    dds_log_binary_trace_close (cfgst->cfg->tracefp);
   if (cfgst->cfg->tracefp && cfgst->cfg->tracefp != stdout && cfgst->cfg->tracefp != stderr) {
     fclose(cfgst->cfg->tracefp);
   }
@@ -19,6 +19,7 @@
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/log.h"
 #include "dds/ddsrt/md5.h"
+#include "dds/ddsrt/mh3.h"
 #include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/avl.h"
 #include "dds/ddsrt/string.h"
@@ -623,7 +624,7 @@ static void respond_to_spdp (const struct ddsi_domaingv *gv, const ddsi_guid_t *
       /* pp can't reach gc_delete_participant => can safely reschedule */
       (void) resched_xevent_if_earlier (pp->spdp_xevent, tsched);
     else
-      qxev_spdp (gv->xevents, tsched, &pp->e.guid, dest_proxypp_guid);
+      qxev_spdp (xeventq_for_guid (gv, &pp->e.guid), tsched, &pp->e.guid, dest_proxypp_guid);
   }
   entidx_enum_participant_fini (&est);
 }
@@ -930,9 +931,38 @@ static int handle_spdp_alive (const struct receiver_state *rst, seqno_t seq, dds
   ddsi_xqos_log (DDS_LC_DISCOVERY, &gv->logconfig, &datap->qos);
   GVLOGDISC ("}\n");
 
-  maybe_add_pp_as_meta_to_as_disc (gv, as_meta);
-
-  if (!new_proxy_participant (gv, &datap->participant_guid, builtin_endpoint_set, &privileged_pp_guid, as_default, as_meta, datap, lease_duration, rst->vendor, custom_flags, timestamp, seq))
+  /* SEDP processing on another thread may have implicitly created it in the
+     meantime, in which case this message completes it the way it would have
+     had it been processed after the SEDP message, and it is still answered */
+  struct entity_common *existing_entity;
+  bool created;
+  ddsrt_mutex_lock (&gv->new_proxypp_lock);
+  if ((existing_entity = entidx_lookup_guid_untyped (gv->entity_index, &datap->participant_guid)) == NULL)
+  {
+    maybe_add_pp_as_meta_to_as_disc (gv, as_meta);
+    created = new_proxy_participant (gv, &datap->participant_guid, builtin_endpoint_set, &privileged_pp_guid, as_default, as_meta, datap, lease_duration, rst->vendor, custom_flags, timestamp, seq);
+    ddsrt_mutex_unlock (&gv->new_proxypp_lock);
+  }
+  else
+  {
+    ddsrt_mutex_unlock (&gv->new_proxypp_lock);
+    if ((created = (existing_entity->kind == EK_PROXY_PARTICIPANT)))
+    {
+      struct proxy_participant *proxypp = (struct proxy_participant *) existing_entity;
+      GVLOGDISC (" (created concurrently)");
+      maybe_add_pp_as_meta_to_as_disc (gv, as_meta);
+      ddsrt_mutex_lock (&proxypp->e.lock);
+      if (proxypp->implicitly_created || seq > proxypp->seq)
+      {
+        proxypp->implicitly_created = 0;
+        update_proxy_participant_plist_locked (proxypp, seq, datap, timestamp);
+      }
+      ddsrt_mutex_unlock (&proxypp->e.lock);
+    }
+    unref_addrset (as_default);
+    unref_addrset (as_meta);
+  }
+  if (!created)
   {
     /* If no proxy participant was created, don't respond */
     return 0;
@@ -1499,7 +1529,11 @@ static bool handle_sedp_checks (struct ddsi_domaingv * const gv, ddsi_guid_t *en
   if ((*proxypp = entidx_lookup_proxy_participant_guid (gv->entity_index, ppguid)) == NULL)
   {
     GVLOGDISC (" unknown-proxypp");
-    if ((*proxypp = implicitly_create_proxypp (gv, ppguid, datap, src_guid_prefix, vendorid, timestamp, 0)) == NULL)
+    ddsrt_mutex_lock (&gv->new_proxypp_lock);
+    if ((*proxypp = entidx_lookup_proxy_participant_guid (gv->entity_index, ppguid)) == NULL)
+      *proxypp = implicitly_create_proxypp (gv, ppguid, datap, src_guid_prefix, vendorid, timestamp, 0);
+    ddsrt_mutex_unlock (&gv->new_proxypp_lock);
+    if (*proxypp == NULL)
       E ("?\n", err);
     /* Repeat regular SEDP trace for convenience */
     GVLOGDISC ("SEDP ST0 "PGUIDFMT" (cont)", PGUID (*entity_guid));
@@ -1604,30 +1638,8 @@ static void handle_sedp_alive_endpoint (const struct receiver_state *rst, seqno_
   if (q_omg_is_endpoint_protected (datap) && !q_omg_proxy_participant_is_secure (proxypp))
     E (" remote endpoint is protected while local federation is not secure\n", err);
 
-  if (sedp_kind == SEDP_KIND_WRITER)
-    pwr = entidx_lookup_proxy_writer_guid (gv->entity_index, &datap->endpoint_guid);
-  else
-    prd = entidx_lookup_proxy_reader_guid (gv->entity_index, &datap->endpoint_guid);
-  if (pwr || prd)
-  {
-    /* Re-bind the proxy participant to the discovery service - and do this if it is currently
-       bound to another DS instance, because that other DS instance may have already failed and
-       with a new one taking over, without our noticing it. */
-    GVLOGDISC (" known%s", vendor_is_cloud (vendorid) ? "-DS" : "");
-    if (vendor_is_cloud (vendorid) && proxypp->implicitly_created && memcmp (&proxypp->privileged_pp_guid.prefix, src_guid_prefix, sizeof(proxypp->privileged_pp_guid.prefix)) != 0)
-    {
-      GVLOGDISC (" "PGUIDFMT" attach-to-DS "PGUIDFMT, PGUID(proxypp->e.guid), PGUIDPREFIX(*src_guid_prefix), proxypp->privileged_pp_guid.entityid.u);
-      ddsrt_mutex_lock (&proxypp->e.lock);
-      proxypp->privileged_pp_guid.prefix = *src_guid_prefix;
-      lease_set_expiry (proxypp->lease, DDSRT_ETIME_NEVER);
-      ddsrt_mutex_unlock (&proxypp->e.lock);
-    }
-    GVLOGDISC ("\n");
-  }
-  else
-  {
-    GVLOGDISC (" NEW");
-  }
+  if ((datap->endpoint_guid.entityid.u & NN_ENTITYID_SOURCE_MASK) == NN_ENTITYID_SOURCE_VENDOR && !vendor_is_eclipse_or_adlink (vendorid))
+    E (" ignoring vendor-specific endpoint\n", err);
 
   {
     const nn_locators_t emptyset = { .n = 0, .first = NULL, .last = NULL };
@@ -1664,7 +1676,7 @@ static void handle_sedp_alive_endpoint (const struct receiver_state *rst, seqno_
   if (addrset_empty (as))
   {
     unref_addrset (as);
-    E (" no address", err);
+    E (" no address\n", err);
   }
 
   nn_log_addrset(gv, DDS_LC_DISCOVERY, " (as", as);
@@ -1678,46 +1690,71 @@ static void handle_sedp_alive_endpoint (const struct receiver_state *rst, seqno_
 #endif
   GVLOGDISC (") QOS={");
   ddsi_xqos_log (DDS_LC_DISCOVERY, &gv->logconfig, xqos);
-  GVLOGDISC ("}\n");
-
-  if ((datap->endpoint_guid.entityid.u & NN_ENTITYID_SOURCE_MASK) == NN_ENTITYID_SOURCE_VENDOR && !vendor_is_eclipse_or_adlink (vendorid))
-  {
-    GVLOGDISC ("ignoring vendor-specific endpoint "PGUIDFMT"\n", PGUID (datap->endpoint_guid));
-  }
-  else
+  GVLOGDISC ("}");
+
+  /* SEDP relayed by another participant is processed on that participant's
+     queue, so a concurrent thread may be creating the same endpoint: checking
+     for its existence and creating it must be atomic, but matching it with the
+     local endpoints needn't be done while holding the lock */
+  ddsrt_mutex_t * const lock = &gv->new_proxy_endpoint_locks[ddsrt_mh3 (&datap->endpoint_guid, sizeof (datap->endpoint_guid), 0) % N_NEW_PROXY_ENDPOINT_LOCKS];
+  bool created = false;
+  ddsrt_mutex_lock (lock);
+  if (sedp_kind == SEDP_KIND_WRITER)
   {
-    if (sedp_kind == SEDP_KIND_WRITER)
+    if ((pwr = entidx_lookup_proxy_writer_guid (gv->entity_index, &datap->endpoint_guid)) == NULL)
     {
-      if (pwr)
-        update_proxy_writer (pwr, seq, as, xqos, timestamp);
-      else
-      {
-        /* not supposed to get here for built-in ones, so can determine the channel based on the transport priority */
-        assert (!is_builtin_entityid (datap->endpoint_guid.entityid, vendorid));
+      /* not supposed to get here for built-in ones, so can determine the channel based on the transport priority */
+      assert (!is_builtin_entityid (datap->endpoint_guid.entityid, vendorid));
+      GVLOGDISC (" NEW\n");
 #ifdef DDS_HAS_NETWORK_CHANNELS
-        {
-          struct ddsi_config_channel_listelem *channel = find_channel (&gv->config, xqos->transport_priority);
-          new_proxy_writer (gv, &ppguid, &datap->endpoint_guid, as, datap, channel->dqueue, channel->evq ? channel->evq : gv->xevents, timestamp, seq);
-        }
+      struct ddsi_config_channel_listelem *channel = find_channel (&gv->config, xqos->transport_priority);
+      created = (new_proxy_writer_unmatched (&pwr, gv, &ppguid, &datap->endpoint_guid, as, datap, channel->dqueue, channel->evq ? channel->evq : xeventq_for_guid (gv, &datap->endpoint_guid), timestamp, seq) == 0);
 #else
-        new_proxy_writer (gv, &ppguid, &datap->endpoint_guid, as, datap, gv->user_dqueue, gv->xevents, timestamp, seq);
+      created = (new_proxy_writer_unmatched (&pwr, gv, &ppguid, &datap->endpoint_guid, as, datap, gv->user_dqueue, xeventq_for_guid (gv, &datap->endpoint_guid), timestamp, seq) == 0);
 #endif
-      }
     }
-    else
+  }
+  else
+  {
+    if ((prd = entidx_lookup_proxy_reader_guid (gv->entity_index, &datap->endpoint_guid)) == NULL)
     {
-      if (prd)
-        update_proxy_reader (prd, seq, as, xqos, timestamp);
-      else
-      {
+      GVLOGDISC (" NEW\n");
 #ifdef DDS_HAS_SSM
-        new_proxy_reader (gv, &ppguid, &datap->endpoint_guid, as, datap, timestamp, seq, ssm);
+      created = (new_proxy_reader_unmatched (&prd, gv, &ppguid, &datap->endpoint_guid, as, datap, timestamp, seq, ssm) == DDS_RETCODE_OK);
 #else
-        new_proxy_reader (gv, &ppguid, &datap->endpoint_guid, as, datap, timestamp, seq);
+      created = (new_proxy_reader_unmatched (&prd, gv, &ppguid, &datap->endpoint_guid, as, datap, timestamp, seq) == DDS_RETCODE_OK);
 #endif
-      }
     }
   }
+  ddsrt_mutex_unlock (lock);
+
+  if (created)
+  {
+    if (pwr)
+      match_new_proxy_writer (pwr);
+    else
+      match_new_proxy_reader (prd);
+  }
+  else if (pwr || prd)
+  {
+    /* Re-bind the proxy participant to the discovery service - and do this if it is currently
+       bound to another DS instance, because that other DS instance may have already failed and
+       with a new one taking over, without our noticing it. */
+    GVLOGDISC (" known%s", vendor_is_cloud (vendorid) ? "-DS" : "");
+    if (vendor_is_cloud (vendorid) && proxypp->implicitly_created && memcmp (&proxypp->privileged_pp_guid.prefix, src_guid_prefix, sizeof(proxypp->privileged_pp_guid.prefix)) != 0)
+    {
+      GVLOGDISC (" "PGUIDFMT" attach-to-DS "PGUIDFMT, PGUID(proxypp->e.guid), PGUIDPREFIX(*src_guid_prefix), proxypp->privileged_pp_guid.entityid.u);
+      ddsrt_mutex_lock (&proxypp->e.lock);
+      proxypp->privileged_pp_guid.prefix = *src_guid_prefix;
+      lease_set_expiry (proxypp->lease, DDSRT_ETIME_NEVER);
+      ddsrt_mutex_unlock (&proxypp->e.lock);
+    }
+    GVLOGDISC ("\n");
+    if (pwr)
+      update_proxy_writer (pwr, seq, as, xqos, timestamp);
+    else
+      update_proxy_reader (prd, seq, as, xqos, timestamp);
+  }
   unref_addrset (as);
 
 err:
@@ -1785,17 +1822,20 @@ static void handle_sedp_alive_topic (const struct receiver_state *rst, seqno_t s
   }
   else
   {
+    /* SEDP relayed by another participant may be processed concurrently, so the
+       proxy topic may get created after all: then it needs to be updated instead */
     struct proxy_topic *ptp = lookup_proxy_topic (proxypp, &datap->topic_guid);
+    if (ptp == NULL)
+    {
+      GVLOGDISC (" NEW proxy-topic");
+      if (new_proxy_topic (proxypp, seq, &datap->topic_guid, &type_id, xqos, timestamp) != DDS_RETCODE_OK)
+        ptp = lookup_proxy_topic (proxypp, &datap->topic_guid);
+    }
     if (ptp)
     {
       GVLOGDISC (" update known proxy-topic%s\n", vendor_is_cloud (vendorid) ? "-DS" : "");
       update_proxy_topic (proxypp, ptp, seq, xqos, timestamp);
     }
-    else
-    {
-      GVLOGDISC (" NEW proxy-topic");
-      new_proxy_topic (proxypp, seq, &datap->topic_guid, &type_id, xqos, timestamp);
-    }
   }
 }
 
@@ -1825,6 +1865,7 @@ static void handle_sedp_dead_topic (const struct receiver_state *rst, ddsi_plist
 static void handle_sedp (const struct receiver_state *rst, seqno_t seq, struct ddsi_serdata *serdata, ddsi_sedp_kind_t sedp_kind)
 {
   ddsi_plist_t decoded_data;
+  const ddsrt_mtime_t tstart = ddsrt_time_monotonic ();
   if (ddsi_serdata_to_sample (serdata, &decoded_data, NULL, NULL))
   {
     struct ddsi_domaingv * const gv = rst->gv;
@@ -1851,6 +1892,11 @@ static void handle_sedp (const struct receiver_state *rst, seqno_t seq, struct d
         break;
     }
     ddsi_plist_fini (&decoded_data);
+
+    const int64_t dt = ddsrt_time_monotonic ().v - tstart.v;
+    ddsrt_atomic_inc64 (&gv->sedp_sample_count);
+    ddsrt_atomic_add64 (&gv->sedp_processing_time, (uint64_t) dt);
+    GVLOGDISC ("SEDP processed in %"PRId64" us\n", dt / 1000);
   }
 }
 
@@ -1873,6 +1919,19 @@ static void handle_typelookup (const struct receiver_state *rst, ddsi_entityid_t
 /******************************************************************************
  *****************************************************************************/
 
+uint32_t builtins_dqueue_index_for_prefix (const struct ddsi_domaingv *gv, const ddsi_guid_prefix_t *prefix)
+{
+  if (gv->n_builtins_dqueues == 1)
+    return 0;
+  else
+    return ddsrt_mh3 (prefix, sizeof (*prefix), 0) % gv->n_builtins_dqueues;
+}
+
+struct nn_dqueue *builtins_dqueue_for_prefix (const struct ddsi_domaingv *gv, const ddsi_guid_prefix_t *prefix)
+{
+  return gv->builtins_dqueues[builtins_dqueue_index_for_prefix (gv, prefix)];
+}
+
 int builtins_dqueue_handler (const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, UNUSED_ARG (const ddsi_guid_t *rdguid), UNUSED_ARG (void *qarg))
 {
   struct ddsi_domaingv * const gv = sampleinfo->rst->gv;
@@ -51,6 +51,7 @@
 #include "dds__whc.h"
 #include "dds/ddsi/ddsi_iid.h"
 #include "dds/ddsi/ddsi_tkmap.h"
+#include "dds/ddsi/ddsi_delivery_pool.h"
 #include "dds/ddsi/ddsi_security_omg.h"
 #include "dds/ddsi/ddsi_typelookup.h"
 #include "dds/ddsi/ddsi_list_tmpl.h"
@@ -1193,13 +1194,13 @@ dds_return_t new_participant_guid (ddsi_guid_t *ppguid, struct ddsi_domaingv *gv
        fire before the calls return.  If the initial sample wasn't
        accepted, all is lost, but we continue nonetheless, even though
        the participant won't be able to discover or be discovered.  */
-    pp->spdp_xevent = qxev_spdp (gv->xevents, ddsrt_mtime_add_duration (ddsrt_time_monotonic (), DDS_MSECS (100)), &pp->e.guid, NULL);
+    pp->spdp_xevent = qxev_spdp (xeventq_for_guid (gv, &pp->e.guid), ddsrt_mtime_add_duration (ddsrt_time_monotonic (), DDS_MSECS (100)), &pp->e.guid, NULL);
   }
 
   {
     ddsrt_mtime_t tsched;
     tsched = (pp->lease_duration == DDS_INFINITY) ? DDSRT_MTIME_NEVER : (ddsrt_mtime_t){0};
-    pp->pmd_update_xevent = qxev_pmd_update (gv->xevents, tsched, &pp->e.guid);
+    pp->pmd_update_xevent = qxev_pmd_update (xeventq_for_guid (gv, &pp->e.guid), tsched, &pp->e.guid);
   }
 
 #ifdef DDS_HAS_SECURITY
@@ -1595,22 +1596,8 @@ static uint32_t get_min_receive_buffer_size (struct writer *wr)
   return min_receive_buffer_size;
 }
 
-static void rebuild_writer_addrset (struct writer *wr)
+static void update_writer_burst_size_limits (struct writer *wr)
 {
-  /* FIXME: way too inefficient in this form:
-     - it gets computed for every change
-     - in many cases the set of addresses from the readers
-       is identical, so we could cache the results */
-
-  /* only one operation at a time */
-  ASSERT_MUTEX_HELD (&wr->e.lock);
-
-  /* swap in new address set; this simple procedure is ok as long as
-     wr->as is never accessed without the wr->e.lock held */
-  struct addrset * const oldas = wr->as;
-  wr->as = compute_writer_addrset (wr);
-  unref_addrset (oldas);
-
   /* Computing burst size limit here is a bit of a hack; but anyway ...
      try to limit bursts of retransmits to 67% of the smallest receive
      buffer, and those of initial transmissions to that + overshoot%.
@@ -1637,10 +1624,72 @@ static void rebuild_writer_addrset (struct writer *wr)
     wr->init_burst_size_limit = wr->rexmit_burst_size_limit;
   else
     wr->init_burst_size_limit = (uint32_t) limit64;
+}
+
+static void rebuild_writer_addrset (struct writer *wr)
+{
+  /* only one operation at a time */
+  ASSERT_MUTEX_HELD (&wr->e.lock);
+
+  /* swap in new address set; this simple procedure is ok as long as
+     wr->as is never accessed without the wr->e.lock held */
+  const ddsrt_mtime_t tstart = ddsrt_time_monotonic ();
+  struct addrset * const oldas = wr->as;
+  wr->as = compute_writer_addrset (wr);
+  unref_addrset (oldas);
+  wraddrset_refs_reset (wr);
+  update_writer_burst_size_limits (wr);
+  const int64_t dt = ddsrt_time_monotonic ().v - tstart.v;
+  ddsrt_atomic_inc64 (&wr->e.gv->wraddrset_rebuild_count);
+  ddsrt_atomic_add64 (&wr->e.gv->wraddrset_rebuild_time, (uint64_t) dt);
 
   ELOGDISC (wr, "rebuild_writer_addrset("PGUIDFMT"):", PGUID (wr->e.guid));
   nn_log_addrset(wr->e.gv, DDS_LC_DISCOVERY, "", wr->as);
-  ELOGDISC (wr, " (burst size %"PRIu32" rexmit %"PRIu32")\n", wr->init_burst_size_limit, wr->rexmit_burst_size_limit);
+  ELOGDISC (wr, " (burst size %"PRIu32" rexmit %"PRIu32"%s, %"PRId64" us)\n", wr->init_burst_size_limit, wr->rexmit_burst_size_limit, wr->as_refs ? "" : ", full only", dt / 1000);
+}
+
+static void writer_addrset_update_finish (struct writer *wr, struct addrset *newas, ddsrt_mtime_t tstart)
+{
+  if (newas != NULL)
+  {
+    struct addrset * const oldas = wr->as;
+    wr->as = newas;
+    unref_addrset (oldas);
+  }
+  wraddrset_check (wr);
+  update_writer_burst_size_limits (wr);
+  const int64_t dt = ddsrt_time_monotonic ().v - tstart.v;
+  ddsrt_atomic_inc64 (&wr->e.gv->wraddrset_update_count);
+  ddsrt_atomic_add64 (&wr->e.gv->wraddrset_update_time, (uint64_t) dt);
+
+  ELOGDISC (wr, "update_writer_addrset("PGUIDFMT"):", PGUID (wr->e.guid));
+  if (newas == NULL)
+    ELOGDISC (wr, " unchanged");
+  else
+    nn_log_addrset(wr->e.gv, DDS_LC_DISCOVERY, "", wr->as);
+  ELOGDISC (wr, " (burst size %"PRIu32" rexmit %"PRIu32", %"PRId64" us)\n", wr->init_burst_size_limit, wr->rexmit_burst_size_limit, dt / 1000);
+}
+
+static void writer_addrset_add_reader (struct writer *wr, struct wr_prd_match *m, struct proxy_reader *prd)
+{
+  ASSERT_MUTEX_HELD (&wr->e.lock);
+  const ddsrt_mtime_t tstart = ddsrt_time_monotonic ();
+  struct addrset *newas;
+  if (!wraddrset_add_reader (wr, m, prd, &newas))
+    rebuild_writer_addrset (wr);
+  else
+    writer_addrset_update_finish (wr, newas, tstart);
+}
+
+static void writer_addrset_remove_reader (struct writer *wr, struct wr_prd_match *m)
+{
+  ASSERT_MUTEX_HELD (&wr->e.lock);
+  const ddsrt_mtime_t tstart = ddsrt_time_monotonic ();
+  struct addrset *newas;
+  if (!wraddrset_remove_reader (wr, m, &newas))
+    rebuild_writer_addrset (wr);
+  else
+    writer_addrset_update_finish (wr, newas, tstart);
 }
 
 void rebuild_or_clear_writer_addrsets (struct ddsi_domaingv *gv, int rebuild)
@@ -1658,7 +1707,10 @@ void rebuild_or_clear_writer_addrsets (struct ddsi_domaingv *gv, int rebuild)
       if (rebuild)
         rebuild_writer_addrset(wr);
       else
+      {
         addrset_purge(wr->as);
+        wraddrset_refs_clear(wr);
+      }
     }
     else
     {
@@ -1688,6 +1740,8 @@ static void free_wr_prd_match (const struct ddsi_domaingv *gv, const ddsi_guid_t
     (void) gv;
     (void) wr_guid;
 #endif
+    if (m->counted_as)
+      unref_addrset (m->counted_as);
     nn_lat_estim_fini (&m->hb_to_ack_latency);
     ddsrt_free (m);
   }
@@ -1785,7 +1839,7 @@ static void writer_drop_connection (const struct ddsi_guid *wr_guid, const struc
       wr->num_readers--;
       wr->num_reliable_readers -= m->is_reliable;
       wr->num_readers_requesting_keyhash -= prd->requests_keyhash ? 1 : 0;
-      rebuild_writer_addrset (wr);
+      writer_addrset_remove_reader (wr, m);
       remove_acked_messages (wr, &whcst, &deferred_free_list);
     }
 
@@ -1914,6 +1968,10 @@ static void reader_update_notify_pwr_alive_state (struct reader *rd, const struc
   }
   ddsrt_mutex_unlock (&rd->e.lock);
 
+  /* samples handed off to the delivery pool must be stored before the writer
+     is unregistered, or they would register it again */
+  if (delta < 0 && pwr->e.gv->delivery_pool)
+    ddsi_delivery_pool_drain (pwr->e.gv->delivery_pool);
   if (delta < 0 && rd->rhc)
   {
     struct ddsi_writer_info wrinfo;
@@ -1947,6 +2005,8 @@ static void reader_drop_connection (const struct ddsi_guid *rd_guid, const struc
     ddsrt_mutex_unlock (&rd->e.lock);
     if (m != NULL)
     {
+      /* only called when deleting the proxy writer, after the barrier through the
+         delivery pool, so no samples from it can be pending there anymore */
       if (rd->rhc)
       {
         struct ddsi_writer_info wrinfo;
@@ -2107,6 +2167,7 @@ static void writer_add_connection (struct writer *wr, struct proxy_reader *prd,
   m->has_replied_to_hb = !m->is_reliable || use_iceoryx;
   m->all_have_replied_to_hb = 0;
   m->non_responsive_count = 0;
+  m->counted_as = NULL;
   m->rexmit_requests = 0;
 #ifdef DDS_HAS_SECURITY
   m->crypto_handle = crypto_handle;
@@ -2165,7 +2226,7 @@ static void writer_add_connection (struct writer *wr, struct proxy_reader *prd,
     wr->num_readers++;
     wr->num_reliable_readers += m->is_reliable;
     wr->num_readers_requesting_keyhash += prd->requests_keyhash ? 1 : 0;
-    rebuild_writer_addrset (wr);
+    writer_addrset_add_reader (wr, m, prd);
     ddsrt_mutex_unlock (&wr->e.lock);
 
     if (wr->status_cb)
@@ -2714,8 +2775,10 @@ static bool topickind_qos_match_p_lock (
     struct ddsi_domaingv *gv,
     struct entity_common *rd,
     const dds_qos_t *rdqos,
+    uint64_t rd_fp,
     struct entity_common *wr,
     const dds_qos_t *wrqos,
+    uint64_t wr_fp,
     dds_qos_policy_id_t *reason
 #ifdef DDS_HAS_TYPE_DISCOVERY
     , const type_identifier_t *rd_typeid
@@ -2736,9 +2799,9 @@ static bool topickind_qos_match_p_lock (
     ddsrt_mutex_lock (locks[i + shift]);
 #ifdef DDS_HAS_TYPE_DISCOVERY
   bool rd_type_lookup, wr_type_lookup;
-  bool ret = qos_match_p (gv, rdqos, wrqos, reason, rd_typeid, wr_typeid, &rd_type_lookup, &wr_type_lookup);
+  bool ret = qos_match_cached_p (gv, rdqos, rd_fp, wrqos, wr_fp, reason, rd_typeid, wr_typeid, &rd_type_lookup, &wr_type_lookup);
 #else
-  bool ret = qos_match_p (gv, rdqos, wrqos, reason);
+  bool ret = qos_match_cached_p (gv, rdqos, rd_fp, wrqos, wr_fp, reason);
 #endif
   for (int i = 0; i < 2; i++)
     ddsrt_mutex_unlock (locks[i + shift]);
@@ -2797,9 +2860,9 @@ static void connect_writer_with_proxy_reader (struct writer *wr, struct proxy_re
   if (wr->e.onlylocal)
     return;
 #ifdef DDS_HAS_TYPE_DISCOVERY
-  if (!isb0 && !topickind_qos_match_p_lock (gv, &prd->e, prd->c.xqos, &wr->e, wr->xqos, &reason, &prd->c.type_id, &wr->c.type_id))
+  if (!isb0 && !topickind_qos_match_p_lock (gv, &prd->e, prd->c.xqos, prd->c.qos_match_fp, &wr->e, wr->xqos, wr->c.qos_match_fp, &reason, &prd->c.type_id, &wr->c.type_id))
 #else
-  if (!isb0 && !topickind_qos_match_p_lock (gv, &prd->e, prd->c.xqos, &wr->e, wr->xqos, &reason))
+  if (!isb0 && !topickind_qos_match_p_lock (gv, &prd->e, prd->c.xqos, prd->c.qos_match_fp, &wr->e, wr->xqos, wr->c.qos_match_fp, &reason))
 #endif
   {
     writer_qos_mismatch (wr, reason);
@@ -2839,9 +2902,9 @@ static void connect_proxy_writer_with_reader (struct proxy_writer *pwr, struct r
   if (rd->e.onlylocal)
     return;
 #ifdef DDS_HAS_TYPE_DISCOVERY
-  if (!isb0 && !topickind_qos_match_p_lock (rd->e.gv, &rd->e, rd->xqos, &pwr->e, pwr->c.xqos, &reason, &rd->c.type_id, &pwr->c.type_id))
+  if (!isb0 && !topickind_qos_match_p_lock (rd->e.gv, &rd->e, rd->xqos, rd->c.qos_match_fp, &pwr->e, pwr->c.xqos, pwr->c.qos_match_fp, &reason, &rd->c.type_id, &pwr->c.type_id))
 #else
-  if (!isb0 && !topickind_qos_match_p_lock (rd->e.gv, &rd->e, rd->xqos, &pwr->e, pwr->c.xqos, &reason))
+  if (!isb0 && !topickind_qos_match_p_lock (rd->e.gv, &rd->e, rd->xqos, rd->c.qos_match_fp, &pwr->e, pwr->c.xqos, pwr->c.qos_match_fp, &reason))
 #endif
   {
     reader_qos_mismatch (rd, reason);
@@ -2909,9 +2972,9 @@ static void connect_writer_with_reader (struct writer *wr, struct reader *rd, dd
   if (ignore_local_p (&wr->e.guid, &rd->e.guid, wr->xqos, rd->xqos))
     return;
 #ifdef DDS_HAS_TYPE_DISCOVERY
-  if (!topickind_qos_match_p_lock (wr->e.gv, &rd->e, rd->xqos, &wr->e, wr->xqos, &reason, &rd->c.type_id, &wr->c.type_id))
+  if (!topickind_qos_match_p_lock (wr->e.gv, &rd->e, rd->xqos, rd->c.qos_match_fp, &wr->e, wr->xqos, wr->c.qos_match_fp, &reason, &rd->c.type_id, &wr->c.type_id))
 #else
-  if (!topickind_qos_match_p_lock (wr->e.gv, &rd->e, rd->xqos, &wr->e, wr->xqos, &reason))
+  if (!topickind_qos_match_p_lock (wr->e.gv, &rd->e, rd->xqos, rd->c.qos_match_fp, &wr->e, wr->xqos, wr->c.qos_match_fp, &reason))
 #endif
   {
     writer_qos_mismatch (wr, reason);
@@ -3582,6 +3645,38 @@ unsigned remove_acked_messages (struct writer *wr, struct whc_state *whcst, stru
   return n;
 }
 
+static void handle_ack_coalescing_xevent (struct xevent *xev, void *varg, ddsrt_mtime_t tnow)
+{
+  /* Drops everything acknowledged since the event was scheduled in one go, and frees the
+     samples without holding the writer lock.  The event is deleted by gc_delete_writer
+     before the WHC is freed, so the writer and its WHC are guaranteed to still exist. */
+  struct writer * const wr = varg;
+  struct whc_node *deferred_free_list = NULL;
+  struct whc_state whcst;
+  unsigned n;
+  (void) xev;
+  (void) tnow;
+  ddsrt_mutex_lock (&wr->e.lock);
+  wr->ack_coalescing_pending = 0;
+  n = remove_acked_messages (wr, &whcst, &deferred_free_list);
+  ETRACE (wr, "ack_coalescing("PGUIDFMT") max_drop_seq %"PRId64" RM%u\n", PGUID (wr->e.guid), writer_max_drop_seq (wr), n);
+  ddsrt_mutex_unlock (&wr->e.lock);
+  whc_free_deferred_free_list (wr->whc, deferred_free_list);
+}
+
+bool writer_defer_remove_acked_messages (struct writer *wr)
+{
+  ASSERT_MUTEX_HELD (&wr->e.lock);
+  if (wr->ack_coalescing_xevent == NULL)
+    return false;
+  if (!wr->ack_coalescing_pending)
+  {
+    wr->ack_coalescing_pending = 1;
+    (void) resched_xevent_if_earlier (wr->ack_coalescing_xevent, ddsrt_mtime_add_duration (ddsrt_time_monotonic (), wr->e.gv->config.ack_coalescing_delay));
+  }
+  return true;
+}
+
 static void writer_notify_liveliness_change_may_unlock (struct writer *wr)
 {
   struct alive_state alive_state;
@@ -3717,6 +3812,7 @@ static void new_writer_guid_common_init (struct writer *wr, const char *topic_na
   ddsi_xqos_mergein_missing (wr->xqos, &ddsi_default_qos_writer, ~(uint64_t)0);
   assert (wr->xqos->aliased == 0);
   set_topic_type_name (wr->xqos, topic_name, type->type_name);
+  wr->c.qos_match_fp = qos_match_fingerprint (wr->xqos);
 
   ELOGDISC (wr, "WRITER "PGUIDFMT" QOS={", PGUID (wr->e.guid));
   ddsi_xqos_log (DDS_LC_DISCOVERY, &wr->e.gv->logconfig, wr->xqos);
@@ -3746,6 +3842,7 @@ static void new_writer_guid_common_init (struct writer *wr, const char *topic_na
   wr->type = ddsi_sertype_ref (type);
   wr->as = new_addrset ();
   wr->as_group = NULL;
+  wr->as_refs = NULL;
 
 #ifdef DDS_HAS_NETWORK_PARTITIONS
   /* This is an open issue how to encrypt mesages send for various
@@ -3812,12 +3909,12 @@ static void new_writer_guid_common_init (struct writer *wr, const char *topic_na
     struct ddsi_config_channel_listelem *channel = find_channel (&wr->e.gv->config, wr->xqos->transport_priority);
     ELOGDISC (wr, "writer "PGUIDFMT": transport priority %d => channel '%s' priority %d\n",
               PGUID (wr->e.guid), wr->xqos->transport_priority.value, channel->name, channel->priority);
-    wr->evq = channel->evq ? channel->evq : wr->e.gv->xevents;
+    wr->evq = channel->evq ? channel->evq : xeventq_for_guid (wr->e.gv, &wr->e.guid);
   }
   else
 #endif
   {
-    wr->evq = wr->e.gv->xevents;
+    wr->evq = xeventq_for_guid (wr->e.gv, &wr->e.guid);
   }
 
   /* heartbeat event will be deleted when the handler can't find a
@@ -3828,6 +3925,11 @@ static void new_writer_guid_common_init (struct writer *wr, const char *topic_na
     wr->heartbeat_xevent = qxev_heartbeat (wr->evq, DDSRT_MTIME_NEVER, &wr->e.guid);
   else
     wr->heartbeat_xevent = NULL;
+  wr->ack_coalescing_pending = 0;
+  if (wr->reliable && wr->e.gv->config.ack_coalescing_delay > 0)
+    wr->ack_coalescing_xevent = qxev_callback (wr->evq, DDSRT_MTIME_NEVER, handle_ack_coalescing_xevent, wr);
+  else
+    wr->ack_coalescing_xevent = NULL;
 
   assert (wr->xqos->present & QP_LIVELINESS);
   if (wr->xqos->liveliness.lease_duration != DDS_INFINITY)
@@ -4020,6 +4122,8 @@ static void gc_delete_writer (struct gcreq *gcreq)
     wr->hbcontrol.tsched = DDSRT_MTIME_NEVER;
     delete_xevent (wr->heartbeat_xevent);
   }
+  if (wr->ack_coalescing_xevent)
+    delete_xevent_callback (wr->ack_coalescing_xevent);
 
   /* Tear down connections -- no proxy reader can be adding/removing
       us now, because we can't be found via entity_index anymore.  We
@@ -4061,6 +4165,7 @@ static void gc_delete_writer (struct gcreq *gcreq)
   if (wr->ssm_as)
     unref_addrset (wr->ssm_as);
 #endif
+  wraddrset_refs_clear (wr);
   unref_addrset (wr->as); /* must remain until readers gone (rebuilding of addrset) */
   ddsi_xqos_fini (wr->xqos);
   ddsrt_free (wr->xqos);
@@ -4356,6 +4461,7 @@ static dds_return_t new_reader_guid
   ddsi_xqos_mergein_missing (rd->xqos, &ddsi_default_qos_reader, ~(uint64_t)0);
   assert (rd->xqos->aliased == 0);
   set_topic_type_name (rd->xqos, topic_name, type->type_name);
+  rd->c.qos_match_fp = qos_match_fingerprint (rd->xqos);
 
   if (rd->e.gv->logconfig.c.mask & DDS_LC_DISCOVERY)
   {
@@ -4807,7 +4913,7 @@ static void create_proxy_builtin_endpoint_impl (struct ddsi_domaingv *gv, ddsrt_
   plist->qos.topic_name = dds_string_dup (topic_name);
   plist->qos.present |= QP_TOPIC_NAME;
   if (is_writer_entityid (ep_guid->entityid))
-    new_proxy_writer (gv, ppguid, ep_guid, proxypp->as_meta, plist, gv->builtins_dqueue, gv->xevents, timestamp, 0);
+    new_proxy_writer (gv, ppguid, ep_guid, proxypp->as_meta, plist, builtins_dqueue_for_prefix (gv, &ppguid->prefix), xeventq_for_guid (gv, ep_guid), timestamp, 0);
   else
   {
 #ifdef DDS_HAS_SSM
@@ -5134,8 +5240,9 @@ static void free_proxy_participant(struct proxy_participant *proxypp)
 
 bool new_proxy_participant (struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid, uint32_t bes, const struct ddsi_guid *privileged_pp_guid, struct addrset *as_default, struct addrset *as_meta, const ddsi_plist_t *plist, dds_duration_t tlease_dur, nn_vendorid_t vendor, unsigned custom_flags, ddsrt_wctime_t timestamp, seqno_t seq)
 {
-  /* No locking => iff all participants use unique guids, and sedp
-     runs on a single thread, it can't go wrong. FIXME, maybe? The
+  /* No locking => iff all participants use unique guids, and the
+     discovery code holds gv->new_proxypp_lock while checking for
+     existence and creating it, it can't go wrong. FIXME, maybe? The
      same holds for the other functions for creating entities. */
   struct proxy_participant *proxypp;
   const bool is_secure = ((bes & NN_DISC_BUILTIN_ENDPOINT_PARTICIPANT_SECURE_ANNOUNCER) != 0);
@@ -5791,38 +5898,47 @@ int proxy_topic_equal (const struct proxy_topic *proxy_tp_a, const struct proxy_
   return proxy_tp_a == proxy_tp_b;
 }
 
-struct proxy_topic *lookup_proxy_topic (struct proxy_participant *proxypp, const ddsi_guid_t *guid)
+static struct proxy_topic *lookup_proxy_topic_locked (struct proxy_participant *proxypp, const ddsi_guid_t *guid)
 {
-  assert (proxypp != NULL);
   proxy_topic_list_iter_t it;
-  struct proxy_topic *ptp = NULL;
-  ddsrt_mutex_lock (&proxypp->e.lock);
-  for (struct proxy_topic *proxytp = proxy_topic_list_iter_first (&proxypp->topics, &it); proxytp != NULL && !ptp; proxytp = proxy_topic_list_iter_next (&it))
+  ASSERT_MUTEX_HELD (&proxypp->e.lock);
+  for (struct proxy_topic *proxytp = proxy_topic_list_iter_first (&proxypp->topics, &it); proxytp != NULL; proxytp = proxy_topic_list_iter_next (&it))
   {
     if (proxytp->entityid.u == guid->entityid.u)
-      ptp = proxytp;
+      return proxytp;
   }
+  return NULL;
+}
+
+struct proxy_topic *lookup_proxy_topic (struct proxy_participant *proxypp, const ddsi_guid_t *guid)
+{
+  assert (proxypp != NULL);
+  ddsrt_mutex_lock (&proxypp->e.lock);
+  struct proxy_topic *ptp = lookup_proxy_topic_locked (proxypp, guid);
   ddsrt_mutex_unlock (&proxypp->e.lock);
   return ptp;
 }
 
-void new_proxy_topic (struct proxy_participant *proxypp, seqno_t seq, const ddsi_guid_t *guid, const type_identifier_t *type_id, struct dds_qos *qos, ddsrt_wctime_t timestamp)
+dds_return_t new_proxy_topic (struct proxy_participant *proxypp, seqno_t seq, const ddsi_guid_t *guid, const type_identifier_t *type_id, struct dds_qos *qos, ddsrt_wctime_t timestamp)
 {
   assert (proxypp != NULL);
   struct ddsi_domaingv *gv = proxypp->e.gv;
   bool new_tpd = false;
+  /* SEDP relayed by another participant may be processed concurrently, so checking for
+     its existence and inserting it must be done atomically */
+  ddsrt_mutex_lock (&proxypp->e.lock);
+  if (lookup_proxy_topic_locked (proxypp, guid) != NULL)
+  {
+    ddsrt_mutex_unlock (&proxypp->e.lock);
+    return DDS_RETCODE_PRECONDITION_NOT_MET;
+  }
   struct ddsi_topic_definition *tpd = lookup_topic_definition (gv, qos, type_id, NULL, &new_tpd);
-#ifndef NDEBUG
-  bool found_proxytp = lookup_proxy_topic (proxypp, guid);
-  assert (!found_proxytp);
-#endif
   struct proxy_topic *proxytp = ddsrt_malloc (sizeof (*proxytp));
   proxytp->entityid = guid->entityid;
   proxytp->definition = tpd;
   proxytp->seq = seq;
   proxytp->tupdate = timestamp;
   proxytp->deleted = 0;
-  ddsrt_mutex_lock (&proxypp->e.lock);
   proxy_topic_list_insert (&proxypp->topics, proxytp);
   tpd->refc++;
   ddsrt_mutex_unlock (&proxypp->e.lock);
@@ -5836,6 +5952,7 @@ void new_proxy_topic (struct proxy_participant *proxypp, seqno_t seq, const ddsi
     ddsrt_cond_broadcast (&gv->new_topic_cond);
     ddsrt_mutex_unlock (&gv->new_topic_lock);
   }
+  return DDS_RETCODE_OK;
 }
 
 void update_proxy_topic (struct proxy_participant *proxypp, struct proxy_topic *proxytp, seqno_t seq, struct dds_qos *xqos, ddsrt_wctime_t timestamp)
@@ -5938,6 +6055,7 @@ static int proxy_endpoint_common_init (struct entity_common *e, struct proxy_end
   name = (plist->present & PP_ENTITY_NAME) ? plist->entity_name : "";
   entity_common_init (e, proxypp->e.gv, guid, name, kind, tcreate, proxypp->vendor, false);
   c->xqos = ddsi_xqos_dup (&plist->qos);
+  c->qos_match_fp = qos_match_fingerprint (c->xqos);
   c->as = ref_addrset (as);
   c->vendor = proxypp->vendor;
   c->seq = seq;
@@ -6034,12 +6152,11 @@ get_proxy_writer_reorder_mode(const ddsi_entityid_t pwr_entityid, int isreliable
   return NN_REORDER_MODE_MONOTONICALLY_INCREASING;
 }
 
-int new_proxy_writer (struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid, const struct ddsi_guid *guid, struct addrset *as, const ddsi_plist_t *plist, struct nn_dqueue *dqueue, struct xeventq *evq, ddsrt_wctime_t timestamp, seqno_t seq)
+int new_proxy_writer_unmatched (struct proxy_writer **ppwr, struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid, const struct ddsi_guid *guid, struct addrset *as, const ddsi_plist_t *plist, struct nn_dqueue *dqueue, struct xeventq *evq, ddsrt_wctime_t timestamp, seqno_t seq)
 {
   struct proxy_participant *proxypp;
   struct proxy_writer *pwr;
   int isreliable;
-  ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
   enum nn_reorder_mode reorder_mode;
   int ret;
 
@@ -6069,6 +6186,8 @@ int new_proxy_writer (struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid,
   pwr->alive_vclock = 0;
   pwr->filtered = 0;
   ddsrt_atomic_st32 (&pwr->next_deliv_seq_lowword, 1);
+  ddsrt_atomic_st32 (&pwr->pool_handed_seq_lowword, 1);
+  ddsrt_atomic_st32 (&pwr->deliv_seq_update_inflight, 0);
   if (is_builtin_entityid (pwr->e.guid.entityid, pwr->c.vendor)) {
     /* The DDSI built-in proxy writers always deliver
        asynchronously */
@@ -6154,13 +6273,26 @@ int new_proxy_writer (struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid,
   builtintopic_write_endpoint (gv->builtin_topic_interface, &pwr->e, timestamp, true);
   ddsrt_mutex_unlock (&pwr->e.lock);
 
-  match_proxy_writer_with_readers (pwr, tnow);
+  *ppwr = pwr;
+  return 0;
+}
+
+void match_new_proxy_writer (struct proxy_writer *pwr)
+{
+  match_proxy_writer_with_readers (pwr, ddsrt_time_monotonic ());
 
   ddsrt_mutex_lock (&pwr->e.lock);
   pwr->local_matching_inprogress = 0;
   ddsrt_mutex_unlock (&pwr->e.lock);
+}
 
-  return 0;
+int new_proxy_writer (struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid, const struct ddsi_guid *guid, struct addrset *as, const ddsi_plist_t *plist, struct nn_dqueue *dqueue, struct xeventq *evq, ddsrt_wctime_t timestamp, seqno_t seq)
+{
+  struct proxy_writer *pwr;
+  int ret;
+  if ((ret = new_proxy_writer_unmatched (&pwr, gv, ppguid, guid, as, plist, dqueue, evq, timestamp, seq)) == 0)
+    match_new_proxy_writer (pwr);
+  return ret;
 }
 
 void update_proxy_writer (struct proxy_writer *pwr, seqno_t seq, struct addrset *as, const struct dds_qos *xqos, ddsrt_wctime_t timestamp)
@@ -6401,15 +6533,14 @@ int proxy_writer_set_notalive (struct proxy_writer *pwr, bool notify)
 
 /* PROXY-READER ----------------------------------------------------- */
 
-int new_proxy_reader (struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid, const struct ddsi_guid *guid, struct addrset *as, const ddsi_plist_t *plist, ddsrt_wctime_t timestamp, seqno_t seq
+int new_proxy_reader_unmatched (struct proxy_reader **pprd, struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid, const struct ddsi_guid *guid, struct addrset *as, const ddsi_plist_t *plist, ddsrt_wctime_t timestamp, seqno_t seq
 #ifdef DDS_HAS_SSM
-                      , int favours_ssm
+                                , int favours_ssm
 #endif
-                      )
+                                )
 {
   struct proxy_participant *proxypp;
   struct proxy_reader *prd;
-  ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
   int ret;
 
   assert (!is_writer_entityid (guid->entityid));
@@ -6460,10 +6591,33 @@ int new_proxy_reader (struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid,
   builtintopic_write_endpoint (gv->builtin_topic_interface, &prd->e, timestamp, true);
   ddsrt_mutex_unlock (&prd->e.lock);
 
-  match_proxy_reader_with_writers (prd, tnow);
+  *pprd = prd;
   return DDS_RETCODE_OK;
 }
 
+void match_new_proxy_reader (struct proxy_reader *prd)
+{
+  match_proxy_reader_with_writers (prd, ddsrt_time_monotonic ());
+}
+
+int new_proxy_reader (struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid, const struct ddsi_guid *guid, struct addrset *as, const ddsi_plist_t *plist, ddsrt_wctime_t timestamp, seqno_t seq
+#ifdef DDS_HAS_SSM
+                      , int favours_ssm
+#endif
+                      )
+{
+  struct proxy_reader *prd;
+  int ret;
+#ifdef DDS_HAS_SSM
+  ret = new_proxy_reader_unmatched (&prd, gv, ppguid, guid, as, plist, timestamp, seq, favours_ssm);
+#else
+  ret = new_proxy_reader_unmatched (&prd, gv, ppguid, guid, as, plist, timestamp, seq);
+#endif
+  if (ret == DDS_RETCODE_OK)
+    match_new_proxy_reader (prd);
+  return ret;
+}
+
 static void proxy_reader_set_delete_and_ack_all_messages (struct proxy_reader *prd)
 {
   ddsi_guid_t wrguid;
@@ -6637,12 +6791,25 @@ static int gcreq_proxy_participant (struct proxy_participant *proxypp)
   return 0;
 }
 
+static void gc_delete_proxy_writer_delivery_pool_cb (struct gcreq *gcreq)
+{
+  /* delete proxy_writer, phase 3b: all samples have been stored */
+  gcreq_requeue (gcreq, gc_delete_proxy_writer);
+}
+
 static void gc_delete_proxy_writer_dqueue_bubble_cb (struct gcreq *gcreq)
 {
   /* delete proxy_writer, phase 3 */
   struct proxy_writer *pwr = gcreq->arg;
+  struct ddsi_domaingv * const gv = pwr->e.gv;
   ELOGDISC (pwr, "gc_delete_proxy_writer_dqueue_bubble(%p, "PGUIDFMT")\n", (void *) gcreq, PGUID (pwr->e.guid));
-  gcreq_requeue (gcreq, gc_delete_proxy_writer);
+  /* samples handed off to the delivery pool may still be waiting to be
+     stored, and those must be in the reader history caches before the
+     instances get unregistered */
+  if (gv->delivery_pool)
+    ddsi_delivery_pool_enqueue_callback (gv->delivery_pool, (ddsi_delivery_pool_callback_t) gc_delete_proxy_writer_delivery_pool_cb, gcreq);
+  else
+    gcreq_requeue (gcreq, gc_delete_proxy_writer);
 }
 
 static void gc_delete_proxy_writer_dqueue (struct gcreq *gcreq)
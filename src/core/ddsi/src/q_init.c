@@ -11,6 +11,9 @@
  */
 #include <ctype.h>
 #include <stddef.h>
+#if defined __linux
+#include <sys/un.h>
+#endif
 
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/md5.h"
@@ -37,6 +40,7 @@
 #include "dds/ddsi/q_radmin.h"
 #include "dds/ddsi/q_thread.h"
 #include "dds/ddsi/ddsi_entity_index.h"
+#include "dds/ddsi/q_qosmatch.h"
 #include "dds/ddsi/q_lease.h"
 #include "dds/ddsi/q_gc.h"
 #include "dds/ddsi/q_entity.h"
@@ -64,6 +68,7 @@
 #include "dds/ddsi/ddsi_security_omg.h"
 
 #include "dds/ddsi/ddsi_tkmap.h"
+#include "dds/ddsi/ddsi_delivery_pool.h"
 #include "dds__whc.h"
 #include "dds/ddsi/ddsi_iid.h"
 
@@ -75,6 +80,10 @@
 #include "dds/ddsi/shm_init.h"
 #endif
 
+/* Maximum number of delivery queues for built-in data (Internal/DiscoveryDeliveryThreads) */
+#define MAX_BUILTINS_DQUEUES 64
+#define MAX_XEVENTQ_SHARDS 64
+
 static void add_peer_addresses (const struct ddsi_domaingv *gv, struct addrset *as, const struct ddsi_config_peer_listelem *list)
 {
   while (list)
@@ -91,9 +100,97 @@ enum make_uc_sockets_ret {
   MUSRET_ERROR          /* generic error, no use continuing */
 };
 
+static bool use_multiple_receive_threads (const struct ddsi_config *cfg)
+{
+  /* Under some unknown circumstances Windows (at least Windows 10) exhibits
+     the interesting behaviour of losing its ability to let us send packets
+     to our own sockets. When that happens, dedicated receive threads can no
+     longer be stopped and Cyclone hangs in shutdown.  So until someone
+     figures out why this happens, it is probably best have a different
+     default on Windows. */
+#if _WIN32
+  const bool def = false;
+#else
+  const bool def = true;
+#endif
+  switch (cfg->multiple_recv_threads)
+  {
+    case DDSI_BOOLDEF_FALSE:
+      return false;
+    case DDSI_BOOLDEF_TRUE:
+      return true;
+    case DDSI_BOOLDEF_DEFAULT:
+      return def;
+  }
+  assert (0);
+  return false;
+}
+
+static uint32_t data_uc_recv_threads (const struct ddsi_domaingv *gv)
+{
+  /* Spreading the unicast data over multiple sockets relies on the Linux
+     implementation of SO_REUSEPORT, which hashes the source and destination
+     addresses to select the socket.  It only makes sense if the data
+     unicast socket has a receive thread of its own in the first place. */
+#if defined __linux
+  if (gv->config.data_uc_recv_threads <= 1 ||
+      !use_multiple_receive_threads (&gv->config) ||
+      gv->config.many_sockets_mode != DDSI_MSM_SINGLE_UNICAST ||
+      !(strcmp (gv->m_factory->m_typename, "udp") == 0 || strcmp (gv->m_factory->m_typename, "udp6") == 0))
+    return 1;
+  return (gv->config.data_uc_recv_threads < MAX_DATA_UC_RECV_THREADS) ? gv->config.data_uc_recv_threads : MAX_DATA_UC_RECV_THREADS;
+#else
+  (void) gv;
+  return 1;
+#endif
+}
+
+#if defined __linux
+/* Binding a socket with SO_REUSEPORT set succeeds when another process of the
+   same user already has such sockets bound to the port, so checking that the
+   port is free and then binding the SO_REUSEPORT sockets is not atomic.
+   Processes doing this therefore hold an abstract unix domain socket named after
+   the port while they do so: binding it fails while another process holds it,
+   and the kernel releases it when the process dies. */
+static dds_return_t lock_reuseport_claim (ddsrt_socket_t *sock, uint32_t port)
+{
+  struct sockaddr_un addr;
+  dds_return_t rc;
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  const int n = snprintf (addr.sun_path + 1, sizeof (addr.sun_path) - 1, "cyclonedds-reuseport-%"PRIu32, port);
+  const socklen_t addrlen = (socklen_t) (offsetof (struct sockaddr_un, sun_path) + 1 + (size_t) n);
+  if ((rc = ddsrt_socket (sock, AF_UNIX, SOCK_DGRAM, 0)) != DDS_RETCODE_OK)
+    return rc;
+  if ((rc = ddsrt_bind (*sock, (struct sockaddr *) &addr, addrlen)) != DDS_RETCODE_OK)
+  {
+    ddsrt_close (*sock);
+    *sock = DDSRT_INVALID_SOCKET;
+  }
+  return rc;
+}
+#else
+static dds_return_t lock_reuseport_claim (ddsrt_socket_t *sock, uint32_t port)
+{
+  /* data_uc_recv_threads never returns more than 1 */
+  (void) port;
+  *sock = DDSRT_INVALID_SOCKET;
+  return DDS_RETCODE_OK;
+}
+#endif
+
+static void unlock_reuseport_claim (ddsrt_socket_t *sock)
+{
+  if (*sock != DDSRT_INVALID_SOCKET)
+    ddsrt_close (*sock);
+  *sock = DDSRT_INVALID_SOCKET;
+}
+
 static enum make_uc_sockets_ret make_uc_sockets (struct ddsi_domaingv *gv, uint32_t * pdisc, uint32_t * pdata, int ppid)
 {
   dds_return_t rc;
+  uint32_t nthreads;
+  ddsrt_socket_t claim = DDSRT_INVALID_SOCKET;
 
   if (gv->config.many_sockets_mode == DDSI_MSM_NO_UNICAST)
   {
@@ -124,12 +221,46 @@ static enum make_uc_sockets_ret make_uc_sockets (struct ddsi_domaingv *gv, uint3
     rc = ddsi_factory_create_conn (&gv->data_conn_uc, gv->m_factory, *pdata, &qos);
     if (rc != DDS_RETCODE_OK)
       goto fail_data;
+    if ((nthreads = data_uc_recv_threads (gv)) > 1)
+    {
+      /* A socket with SO_REUSEPORT set happily shares the port with those of
+         another process doing the same, so the plain socket is only used to
+         check the port is free; then it is replaced by a set of sockets all
+         bound to that port.  The plain socket can't stay bound while those
+         are created, because SO_REUSEPORT only works if every socket bound to
+         the port has it set.  Holding the claim lock keeps other processes
+         from doing the same in between; a process binding a plain socket in
+         between makes creating the SO_REUSEPORT sockets fail, which is just
+         like finding the port in use. */
+      const ddsi_tran_qos_t qos_rp = { .m_purpose = DDSI_TRAN_QOS_RECV_UC, .m_diffserv = 0, .m_interface = NULL, .m_reuse_port = true };
+      if ((rc = lock_reuseport_claim (&claim, *pdata)) != DDS_RETCODE_OK)
+        goto fail_claim;
+      ddsi_conn_free (gv->data_conn_uc);
+      gv->data_conn_uc = NULL;
+      rc = ddsi_factory_create_conn (&gv->data_conn_uc, gv->m_factory, *pdata, &qos_rp);
+      if (rc != DDS_RETCODE_OK)
+        goto fail_data;
+      for (gv->n_data_conn_uc_extra = 0; gv->n_data_conn_uc_extra < nthreads - 1; gv->n_data_conn_uc_extra++)
+      {
+        rc = ddsi_factory_create_conn (&gv->data_conn_uc_extra[gv->n_data_conn_uc_extra], gv->m_factory, *pdata, &qos_rp);
+        if (rc != DDS_RETCODE_OK)
+          goto fail_data_extra;
+      }
+      unlock_reuseport_claim (&claim);
+    }
   }
   ddsi_conn_locator (gv->disc_conn_uc, &gv->loc_meta_uc);
   ddsi_conn_locator (gv->data_conn_uc, &gv->loc_default_uc);
   return MUSRET_SUCCESS;
 
+fail_data_extra:
+  while (gv->n_data_conn_uc_extra > 0)
+    ddsi_conn_free (gv->data_conn_uc_extra[--gv->n_data_conn_uc_extra]);
+fail_claim:
+  ddsi_conn_free (gv->data_conn_uc);
+  gv->data_conn_uc = NULL;
 fail_data:
+  unlock_reuseport_claim (&claim);
   ddsi_conn_free (gv->disc_conn_uc);
   gv->disc_conn_uc = NULL;
 fail_disc:
@@ -489,7 +620,7 @@ int rtps_config_open_trace (struct ddsi_domaingv *gv)
     gv->config.tracefp = stderr;
     status = 1;
   }
-  else if ((gv->config.tracefp = fopen (gv->config.tracefile, gv->config.tracingAppendToFile ? "a" : "w")) == NULL)
+  else if ((gv->config.tracefp = fopen (gv->config.tracefile, (gv->config.trace_format == DDSI_TRACE_FORMAT_BINARY) ? (gv->config.tracingAppendToFile ? "ab" : "wb") : (gv->config.tracingAppendToFile ? "a" : "w"))) == NULL)
   {
     DDS_ILOG (DDS_LC_ERROR, gv->config.domainId, "%s: cannot open for writing\n", gv->config.tracefile);
     status = 0;
@@ -500,6 +631,14 @@ int rtps_config_open_trace (struct ddsi_domaingv *gv)
   }
 
   dds_log_cfg_init (&gv->logconfig, gv->config.domainId, gv->config.tracemask, stderr, gv->config.tracefp);
+  if (status && gv->config.tracefp && gv->config.trace_format == DDSI_TRACE_FORMAT_BINARY)
+  {
+    if (dds_log_cfg_set_binary_trace (&gv->logconfig) != DDS_RETCODE_OK)
+    {
+      DDS_ILOG (DDS_LC_ERROR, gv->config.domainId, "%s: cannot start binary tracing\n", gv->config.tracefile);
+      status = 0;
+    }
+  }
   return status;
   DDSRT_WARNING_MSVC_ON(4996);
 }
@@ -928,32 +1067,6 @@ static void make_special_types (struct ddsi_domaingv *gv)
   free_special_types (gv);
 }
 
-static bool use_multiple_receive_threads (const struct ddsi_config *cfg)
-{
-  /* Under some unknown circumstances Windows (at least Windows 10) exhibits
-     the interesting behaviour of losing its ability to let us send packets
-     to our own sockets. When that happens, dedicated receive threads can no
-     longer be stopped and Cyclone hangs in shutdown.  So until someone
-     figures out why this happens, it is probably best have a different
-     default on Windows. */
-#if _WIN32
-  const bool def = false;
-#else
-  const bool def = true;
-#endif
-  switch (cfg->multiple_recv_threads)
-  {
-    case DDSI_BOOLDEF_FALSE:
-      return false;
-    case DDSI_BOOLDEF_TRUE:
-      return true;
-    case DDSI_BOOLDEF_DEFAULT:
-      return def;
-  }
-  assert (0);
-  return false;
-}
-
 static int setup_and_start_recv_threads (struct ddsi_domaingv *gv)
 {
   const bool multi_recv_thr = use_multiple_receive_threads (&gv->config);
@@ -964,8 +1077,11 @@ static int setup_and_start_recv_threads (struct ddsi_domaingv *gv)
     gv->recv_threads[i].arg.mode = RTM_SINGLE;
     gv->recv_threads[i].arg.rbpool = NULL;
     gv->recv_threads[i].arg.gv = gv;
+    ddsrt_atomic_st64 (&gv->recv_threads[i].arg.rdbatch_count, 0);
+    ddsrt_atomic_st64 (&gv->recv_threads[i].arg.rdbatch_packets, 0);
     gv->recv_threads[i].arg.u.single.loc = NULL;
     gv->recv_threads[i].arg.u.single.conn = NULL;
+    gv->recv_threads[i].arg.u.single.ws = NULL;
   }
 
   /* First thread always uses a waitset and gobbles up all sockets not handled by dedicated threads - FIXME: DDSI_MSM_NO_UNICAST mode with UDP probably doesn't even need this one to use a waitset */
@@ -984,7 +1100,7 @@ static int setup_and_start_recv_threads (struct ddsi_domaingv *gv)
       ddsi_conn_disable_multiplexing (gv->data_conn_mc);
       gv->n_recv_threads++;
     }
-    if (gv->config.many_sockets_mode == DDSI_MSM_SINGLE_UNICAST)
+    if (gv->config.many_sockets_mode == DDSI_MSM_SINGLE_UNICAST && gv->n_data_conn_uc_extra == 0)
     {
       /* No per-participant sockets => handle data unicasts on a separate thread as well */
       gv->recv_threads[gv->n_recv_threads].name = "recvUC";
@@ -994,7 +1110,26 @@ static int setup_and_start_recv_threads (struct ddsi_domaingv *gv)
       ddsi_conn_disable_multiplexing (gv->data_conn_uc);
       gv->n_recv_threads++;
     }
+    else if (gv->config.many_sockets_mode == DDSI_MSM_SINGLE_UNICAST)
+    {
+      /* Data unicast port shared by multiple sockets => one thread per socket, all
+         named "recvUC" so they share the thread configuration.  Which thread
+         handles a packet depends on the source address, so all traffic from a
+         given remote writer ends up in the same thread.  These threads wait
+         on a private waitset because a packet sent to loc_default_uc wouldn't
+         necessarily reach the thread one is trying to wake up. */
+      for (uint32_t i = 0; i <= gv->n_data_conn_uc_extra; i++)
+      {
+        gv->recv_threads[gv->n_recv_threads].name = "recvUC";
+        gv->recv_threads[gv->n_recv_threads].arg.mode = RTM_SINGLE;
+        gv->recv_threads[gv->n_recv_threads].arg.u.single.conn = (i == 0) ? gv->data_conn_uc : gv->data_conn_uc_extra[i - 1];
+        gv->recv_threads[gv->n_recv_threads].arg.u.single.loc = &gv->loc_default_uc;
+        gv->n_recv_threads++;
+      }
+    }
   }
+  if (gv->config.data_uc_recv_threads > 1)
+    GVLOG (DDS_LC_CONFIG, "rtps_init: %"PRIu32" receive thread(s) for unicast data\n", gv->n_data_conn_uc_extra + 1);
   assert (gv->n_recv_threads <= MAX_RECV_THREADS);
 
   /* For each thread, create rbufpool and waitset if needed, then start it */
@@ -1016,6 +1151,19 @@ static int setup_and_start_recv_threads (struct ddsi_domaingv *gv)
         goto fail;
       }
     }
+    else if (gv->n_data_conn_uc_extra > 0 && gv->recv_threads[i].arg.u.single.loc == &gv->loc_default_uc)
+    {
+      if ((gv->recv_threads[i].arg.u.single.ws = os_sockWaitsetNew ()) == NULL)
+      {
+        GVERROR ("rtps_init: can't allocate sock waitset for thread %s\n", gv->recv_threads[i].name);
+        goto fail;
+      }
+      if (os_sockWaitsetAdd (gv->recv_threads[i].arg.u.single.ws, gv->recv_threads[i].arg.u.single.conn) < 0)
+      {
+        GVERROR ("rtps_init: can't add socket to sock waitset for thread %s\n", gv->recv_threads[i].name);
+        goto fail;
+      }
+    }
     if (create_thread (&gv->recv_threads[i].ts, gv, gv->recv_threads[i].name, recv_thread, &gv->recv_threads[i].arg) != DDS_RETCODE_OK)
     {
       GVERROR ("rtps_init: failed to start thread %s\n", gv->recv_threads[i].name);
@@ -1032,6 +1180,8 @@ fail:
   {
     if (gv->recv_threads[i].arg.mode == RTM_MANY && gv->recv_threads[i].arg.u.many.ws)
       os_sockWaitsetFree (gv->recv_threads[i].arg.u.many.ws);
+    else if (gv->recv_threads[i].arg.mode == RTM_SINGLE && gv->recv_threads[i].arg.u.single.ws)
+      os_sockWaitsetFree (gv->recv_threads[i].arg.u.single.ws);
     if (gv->recv_threads[i].arg.rbpool)
       nn_rbufpool_free (gv->recv_threads[i].arg.rbpool);
   }
@@ -1097,9 +1247,11 @@ static void free_conns (struct ddsi_domaingv *gv)
 {
   // Depending on settings, various "conn"s can alias others, this makes sure we free each one only once
   // FIXME: perhaps store them in a table instead?
-  ddsi_tran_conn_t cs[4 + MAX_XMIT_CONNS] = { gv->disc_conn_mc, gv->data_conn_mc, gv->disc_conn_uc, gv->data_conn_uc };
+  ddsi_tran_conn_t cs[4 + MAX_XMIT_CONNS + MAX_DATA_UC_RECV_THREADS - 1] = { gv->disc_conn_mc, gv->data_conn_mc, gv->disc_conn_uc, gv->data_conn_uc };
   for (size_t i = 0; i < MAX_XMIT_CONNS; i++)
     cs[4 + i] = gv->xmit_conns[i];
+  for (uint32_t i = 0; i < gv->n_data_conn_uc_extra; i++)
+    cs[4 + MAX_XMIT_CONNS + i] = gv->data_conn_uc_extra[i];
   for (size_t i = 0; i < sizeof (cs) / sizeof (cs[0]); i++)
   {
     if (cs[i] == NULL)
@@ -1517,6 +1669,7 @@ int rtps_init (struct ddsi_domaingv *gv)
   lease_management_init (gv);
   gv->deleted_participants = deleted_participants_admin_new (&gv->logconfig, gv->config.prune_deleted_ppant.delay);
   gv->entity_index = entity_index_new (gv);
+  gv->qos_match_cache = qos_match_cache_new ();
 
   ddsrt_mutex_init (&gv->privileged_pp_lock);
   gv->privileged_pp = NULL;
@@ -1557,8 +1710,14 @@ int rtps_init (struct ddsi_domaingv *gv)
 
   ddsrt_mutex_init (&gv->lock);
   ddsrt_mutex_init (&gv->spdp_lock);
+  ddsrt_mutex_init (&gv->new_proxypp_lock);
+  for (uint32_t i = 0; i < N_NEW_PROXY_ENDPOINT_LOCKS; i++)
+    ddsrt_mutex_init (&gv->new_proxy_endpoint_locks[i]);
+  gv->n_builtins_dqueues = (gv->config.discovery_delivery_threads == 0) ? 1 : (gv->config.discovery_delivery_threads < MAX_BUILTINS_DQUEUES) ? gv->config.discovery_delivery_threads : MAX_BUILTINS_DQUEUES;
   gv->spdp_defrag = nn_defrag_new (&gv->logconfig, NN_DEFRAG_DROP_OLDEST, gv->config.defrag_unreliable_maxsamples);
-  gv->spdp_reorder = nn_reorder_new (&gv->logconfig, NN_REORDER_MODE_ALWAYS_DELIVER, gv->config.primary_reorder_maxsamples, false);
+  gv->spdp_reorders = ddsrt_malloc (gv->n_builtins_dqueues * sizeof (*gv->spdp_reorders));
+  for (uint32_t i = 0; i < gv->n_builtins_dqueues; i++)
+    gv->spdp_reorders[i] = nn_reorder_new (&gv->logconfig, NN_REORDER_MODE_ALWAYS_DELIVER, gv->config.primary_reorder_maxsamples, false);
 
   gv->m_tkmap = ddsi_tkmap_new (gv);
 
@@ -1623,17 +1782,9 @@ int rtps_init (struct ddsi_domaingv *gv)
   GVLOG (DDS_LC_CONFIG, "rtps_init: domainid %"PRIu32" participantid %d\n", gv->config.domainId, gv->config.participantIndex);
 
   if (gv->config.pcap_file && *gv->config.pcap_file)
-  {
-    gv->pcap_fp = new_pcap_file (gv, gv->config.pcap_file);
-    if (gv->pcap_fp)
-    {
-      ddsrt_mutex_init (&gv->pcap_lock);
-    }
-  }
+    gv->pcap = new_pcap_capture (gv, gv->config.pcap_file);
   else
-  {
-    gv->pcap_fp = NULL;
-  }
+    gv->pcap = NULL;
 
   gv->mship = new_group_membership();
 
@@ -1781,19 +1932,26 @@ int rtps_init (struct ddsi_domaingv *gv)
   }
 #endif /* DDS_HAS_NETWORK_CHANNELS */
 
-  /* Create event queues */
+  /* Create event queues: the first one handles everything not tied to
+     a particular entity, see xeventq_for_guid for the others */
 
-  gv->xevents = xeventq_new
-  (
-    gv,
-    gv->config.max_queued_rexmit_bytes,
-    gv->config.max_queued_rexmit_msgs,
+  gv->n_xevents_shards = (gv->config.xevent_threads == 0) ? 1 : (gv->config.xevent_threads < MAX_XEVENTQ_SHARDS) ? gv->config.xevent_threads : MAX_XEVENTQ_SHARDS;
+  gv->xevents_shards = ddsrt_malloc (gv->n_xevents_shards * sizeof (*gv->xevents_shards));
+  for (uint32_t i = 0; i < gv->n_xevents_shards; i++)
+  {
+    gv->xevents_shards[i] = xeventq_new
+    (
+      gv,
+      gv->config.max_queued_rexmit_bytes,
+      gv->config.max_queued_rexmit_msgs,
 #ifdef DDS_HAS_BANDWIDTH_LIMITING
-    gv->config.auxiliary_bandwidth_limit
+      gv->config.auxiliary_bandwidth_limit
 #else
-    0
+      0
 #endif
-  );
+    );
+  }
+  gv->xevents = gv->xevents_shards[0];
 
 #ifdef DDS_HAS_SECURITY
   q_omg_security_init(gv);
@@ -1838,8 +1996,32 @@ int rtps_init (struct ddsi_domaingv *gv)
   // sendq thread is started if a DW is created with non-zero latency
   gv->sendq_running = false;
   ddsrt_mutex_init (&gv->sendq_running_lock);
-
-  gv->builtins_dqueue = nn_dqueue_new ("builtins", gv, gv->config.delivery_queue_maxsamples, builtins_dqueue_handler, NULL);
+  ddsrt_atomic_st64 (&gv->xmit_batch_count, 0);
+  ddsrt_atomic_st64 (&gv->xmit_batch_packets, 0);
+  ddsrt_atomic_st64 (&gv->sedp_sample_count, 0);
+  ddsrt_atomic_st64 (&gv->sedp_processing_time, 0);
+  ddsrt_atomic_st64 (&gv->wraddrset_rebuild_count, 0);
+  ddsrt_atomic_st64 (&gv->wraddrset_rebuild_time, 0);
+  ddsrt_atomic_st64 (&gv->wraddrset_update_count, 0);
+  ddsrt_atomic_st64 (&gv->wraddrset_update_time, 0);
+
+  if (gv->config.delivery_threads == 0)
+    gv->delivery_pool = NULL;
+  else
+  {
+    const uint32_t n = (gv->config.delivery_threads < DDSI_DELIVERY_POOL_MAX_THREADS) ? gv->config.delivery_threads : DDSI_DELIVERY_POOL_MAX_THREADS;
+    gv->delivery_pool = ddsi_delivery_pool_new (gv, "dlv", n, gv->config.delivery_queue_maxsamples);
+  }
+  gv->builtins_dqueues = ddsrt_malloc (gv->n_builtins_dqueues * sizeof (*gv->builtins_dqueues));
+  for (uint32_t i = 0; i < gv->n_builtins_dqueues; i++)
+  {
+    char name[20];
+    if (i == 0)
+      (void) snprintf (name, sizeof (name), "builtins");
+    else
+      (void) snprintf (name, sizeof (name), "builtins%"PRIu32, i);
+    gv->builtins_dqueues[i] = nn_dqueue_new (name, gv, gv->config.delivery_queue_maxsamples, builtins_dqueue_handler, NULL);
+  }
 #ifdef DDS_HAS_NETWORK_CHANNELS
   for (struct ddsi_config_channel_listelem *chptr = gv->config.channels; chptr; chptr = chptr->next)
     chptr->dqueue = nn_dqueue_new (chptr->name, &gv->config, gv->config.delivery_queue_maxsamples, user_dqueue_handler, NULL);
@@ -1863,8 +2045,8 @@ err_mc_conn:
   for (int i = 0; i < gv->n_interfaces; i++)
     gv->intf_xlocators[i].conn = NULL;
   free_conns (gv);
-  if (gv->pcap_fp)
-    ddsrt_mutex_destroy (&gv->pcap_lock);
+  if (gv->pcap)
+    free_pcap_capture (gv->pcap);
   free_group_membership (gv->mship);
 #ifdef DDS_HAS_NETWORK_PARTITIONS
 err_network_partition_addrset:
@@ -1873,13 +2055,20 @@ err_network_partition_addrset:
 #endif
 err_unicast_sockets:
   ddsi_tkmap_free (gv->m_tkmap);
-  nn_reorder_free (gv->spdp_reorder);
+  for (uint32_t i = 0; i < gv->n_builtins_dqueues; i++)
+    nn_reorder_free (gv->spdp_reorders[i]);
+  ddsrt_free (gv->spdp_reorders);
   nn_defrag_free (gv->spdp_defrag);
   ddsrt_mutex_destroy (&gv->spdp_lock);
+  for (uint32_t i = 0; i < N_NEW_PROXY_ENDPOINT_LOCKS; i++)
+    ddsrt_mutex_destroy (&gv->new_proxy_endpoint_locks[i]);
+  ddsrt_mutex_destroy (&gv->new_proxypp_lock);
   ddsrt_mutex_destroy (&gv->lock);
   ddsrt_mutex_destroy (&gv->privileged_pp_lock);
   entity_index_free (gv->entity_index);
   gv->entity_index = NULL;
+  qos_match_cache_free (gv->qos_match_cache);
+  gv->qos_match_cache = NULL;
   deleted_participants_admin_free (gv->deleted_participants);
   lease_management_term (gv);
   ddsrt_cond_destroy (&gv->participant_set_cond);
@@ -1940,6 +2129,12 @@ err_udp_tcp_init:
   return -1;
 }
 
+static void stop_xevents_shards_upto (struct ddsi_domaingv *gv, uint32_t n)
+{
+  for (uint32_t i = 1; i < n; i++)
+    xeventq_stop (gv->xevents_shards[i]);
+}
+
 #ifdef DDS_HAS_NETWORK_CHANNELS
 static void stop_all_xeventq_upto (struct ddsi_config_channel_listelem *chptr)
 {
@@ -1953,6 +2148,17 @@ int rtps_start (struct ddsi_domaingv *gv)
 {
   if (xeventq_start (gv->xevents, NULL) < 0)
     return -1;
+  for (uint32_t i = 1; i < gv->n_xevents_shards; i++)
+  {
+    char name[20];
+    (void) snprintf (name, sizeof (name), "%"PRIu32, i);
+    if (xeventq_start (gv->xevents_shards[i], name) < 0)
+    {
+      stop_xevents_shards_upto (gv, i);
+      xeventq_stop (gv->xevents);
+      return -1;
+    }
+  }
 #ifdef DDS_HAS_NETWORK_CHANNELS
   for (struct ddsi_config_channel_listelem *chptr = gv->config.channels; chptr; chptr = chptr->next)
   {
@@ -1961,6 +2167,7 @@ int rtps_start (struct ddsi_domaingv *gv)
       if (xeventq_start (chptr->evq, chptr->name) < 0)
       {
         stop_all_xeventq_upto (chptr);
+        stop_xevents_shards_upto (gv, gv->n_xevents_shards);
         xeventq_stop (gv->xevents);
         return -1;
       }
@@ -1973,6 +2180,7 @@ int rtps_start (struct ddsi_domaingv *gv)
 #ifdef DDS_HAS_NETWORK_CHANNELS
     stop_all_xeventq_upto (NULL);
 #endif
+    stop_xevents_shards_upto (gv, gv->n_xevents_shards);
     xeventq_stop (gv->xevents);
     return -1;
   }
@@ -2003,14 +2211,14 @@ int rtps_start (struct ddsi_domaingv *gv)
 struct dq_builtins_ready_arg {
   ddsrt_mutex_t lock;
   ddsrt_cond_t cond;
-  int ready;
+  uint32_t ready;
 };
 
 static void builtins_dqueue_ready_cb (void *varg)
 {
   struct dq_builtins_ready_arg *arg = varg;
   ddsrt_mutex_lock (&arg->lock);
-  arg->ready = 1;
+  arg->ready++;
   ddsrt_cond_broadcast (&arg->cond);
   ddsrt_mutex_unlock (&arg->lock);
 }
@@ -2040,6 +2248,7 @@ void rtps_stop (struct ddsi_domaingv *gv)
     ddsi_listener_free(gv->listener);
   }
 
+  stop_xevents_shards_upto (gv, gv->n_xevents_shards);
   xeventq_stop (gv->xevents);
 #ifdef DDS_HAS_NETWORK_CHANNELS
   for (chptr = gv->config.channels; chptr; chptr = chptr->next)
@@ -2049,7 +2258,7 @@ void rtps_stop (struct ddsi_domaingv *gv)
   }
 #endif /* DDS_HAS_NETWORK_CHANNELS */
 
-  /* Send a bubble through the delivery queue for built-ins, so that any
+  /* Send a bubble through the delivery queues for built-ins, so that any
      pending proxy participant discovery is finished before we start
      deleting them */
   {
@@ -2057,9 +2266,10 @@ void rtps_stop (struct ddsi_domaingv *gv)
     ddsrt_mutex_init (&arg.lock);
     ddsrt_cond_init (&arg.cond);
     arg.ready = 0;
-    nn_dqueue_enqueue_callback(gv->builtins_dqueue, builtins_dqueue_ready_cb, &arg);
+    for (uint32_t i = 0; i < gv->n_builtins_dqueues; i++)
+      nn_dqueue_enqueue_callback(gv->builtins_dqueues[i], builtins_dqueue_ready_cb, &arg);
     ddsrt_mutex_lock (&arg.lock);
-    while (!arg.ready)
+    while (arg.ready < gv->n_builtins_dqueues)
       ddsrt_cond_wait (&arg.cond, &arg.lock);
     ddsrt_mutex_unlock (&arg.lock);
     ddsrt_cond_destroy (&arg.cond);
@@ -2068,7 +2278,9 @@ void rtps_stop (struct ddsi_domaingv *gv)
 
   /* Once the receive threads have stopped, defragmentation and
      reorder state can't change anymore, and can be freed safely. */
-  nn_reorder_free (gv->spdp_reorder);
+  for (uint32_t i = 0; i < gv->n_builtins_dqueues; i++)
+    nn_reorder_free (gv->spdp_reorders[i]);
+  ddsrt_free (gv->spdp_reorders);
   nn_defrag_free (gv->spdp_defrag);
   ddsrt_mutex_destroy (&gv->spdp_lock);
 
@@ -2169,7 +2381,12 @@ void rtps_fini (struct ddsi_domaingv *gv)
   /* No new data gets added to any admin, all synchronous processing
      has ended, so now we can drain the delivery queues to end up with
      the expected reference counts all over the radmin thingummies. */
-  nn_dqueue_free (gv->builtins_dqueue);
+  for (uint32_t i = 0; i < gv->n_builtins_dqueues; i++)
+    nn_dqueue_free (gv->builtins_dqueues[i]);
+  ddsrt_free (gv->builtins_dqueues);
+  for (uint32_t i = 0; i < N_NEW_PROXY_ENDPOINT_LOCKS; i++)
+    ddsrt_mutex_destroy (&gv->new_proxy_endpoint_locks[i]);
+  ddsrt_mutex_destroy (&gv->new_proxypp_lock);
 
 #ifdef DDS_HAS_NETWORK_CHANNELS
   chptr = gv->config.channels;
@@ -2181,12 +2398,17 @@ void rtps_fini (struct ddsi_domaingv *gv)
 #else
   nn_dqueue_free (gv->user_dqueue);
 #endif
+  /* The delivery queues feed the delivery pool */
+  if (gv->delivery_pool)
+    ddsi_delivery_pool_free (gv->delivery_pool);
 
 #ifdef DDS_HAS_SECURITY
   q_omg_security_deinit (gv->security_context);
 #endif
 
-  xeventq_free (gv->xevents);
+  for (uint32_t i = 0; i < gv->n_xevents_shards; i++)
+    xeventq_free (gv->xevents_shards[i]);
+  ddsrt_free (gv->xevents_shards);
 
   // if sendq thread is started
   ddsrt_mutex_lock (&gv->sendq_running_lock);
@@ -2220,11 +2442,8 @@ void rtps_fini (struct ddsi_domaingv *gv)
   free_group_membership(gv->mship);
   ddsi_tran_factories_fini (gv);
 
-  if (gv->pcap_fp)
-  {
-    ddsrt_mutex_destroy (&gv->pcap_lock);
-    fclose (gv->pcap_fp);
-  }
+  if (gv->pcap)
+    free_pcap_capture (gv->pcap);
 
 #ifdef DDS_HAS_NETWORK_PARTITIONS
   for (struct ddsi_config_networkpartition_listelem *np = gv->config.networkPartitions; np; np = np->next)
@@ -2241,12 +2460,16 @@ void rtps_fini (struct ddsi_domaingv *gv)
   {
     if (gv->recv_threads[i].arg.mode == RTM_MANY)
       os_sockWaitsetFree (gv->recv_threads[i].arg.u.many.ws);
+    else if (gv->recv_threads[i].arg.u.single.ws)
+      os_sockWaitsetFree (gv->recv_threads[i].arg.u.single.ws);
     nn_rbufpool_free (gv->recv_threads[i].arg.rbpool);
   }
 
   ddsi_tkmap_free (gv->m_tkmap);
   entity_index_free (gv->entity_index);
   gv->entity_index = NULL;
+  qos_match_cache_free (gv->qos_match_cache);
+  gv->qos_match_cache = NULL;
   deleted_participants_admin_free (gv->deleted_participants);
   lease_management_term (gv);
   ddsrt_mutex_destroy (&gv->participant_set_lock);
@@ -16,7 +16,7 @@
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/sync.h"
 
-#include "dds/ddsrt/fibheap.h"
+#include "dds/ddsrt/timerwheel.h"
 
 #include "dds/ddsi/ddsi_serdata_default.h"
 #include "dds/ddsi/q_protocol.h"
@@ -41,39 +41,101 @@
 
 /* This is absolute bottom for signed integers, where -x = x and yet x
    != 0 -- and note that it had better be 2's complement machine! */
-#define TSCHED_NOT_ON_HEAP INT64_MIN
+#define TSCHED_NOT_IN_WHEEL INT64_MIN
 
-const ddsrt_fibheap_def_t lease_fhdef = DDSRT_FIBHEAPDEF_INITIALIZER (offsetof (struct lease, heapnode), compare_lease_tsched);
+/* Leases are kept in a timing wheel keyed on "tsched", which is only a lower
+   bound for the actual expiry time "tend": renewing a lease only moves
+   "tend" forward with a CAS, and check_and_handle_lease_expiration (running
+   in the gc thread) reschedules a lease that turns out not to have expired
+   when "tsched" is reached.
+
+   Moving the expiry time of a lease earlier (lease_set_expiry) happens on
+   the receive path as well, and so also doesn't touch the wheel: it pushes
+   the lease on "lease_pending" (unless it already is there) and the gc
+   thread reschedules it. The gc thread only needs to be woken up if the new
+   expiry time is before the time it will look at the leases anyway, which
+   it publishes in "lease_tnext". */
+
+static const ddsrt_timerwheel_def_t lease_twdef = DDSRT_TIMERWHEELDEF_INITIALIZER (offsetof (struct lease, wheelnode), offsetof (struct lease, tsched.v));
 
 static void force_lease_check (struct gcreq_queue *gcreq_queue)
 {
   gcreq_enqueue (gcreq_new (gcreq_queue, gcreq_free));
 }
 
-int compare_lease_tsched (const void *va, const void *vb)
+int compare_lease_tdur (const void *va, const void *vb)
 {
   const struct lease *a = va;
   const struct lease *b = vb;
-  return (a->tsched.v == b->tsched.v) ? 0 : (a->tsched.v < b->tsched.v) ? -1 : 1;
+  return (a->tdur == b->tdur) ? 0 : (a->tdur < b->tdur) ? -1 : 1;
 }
 
-int compare_lease_tdur (const void *va, const void *vb)
+static void lease_schedule_locked (struct ddsi_domaingv *gv, struct lease *l, int64_t tsched)
 {
-  const struct lease *a = va;
-  const struct lease *b = vb;
-  return (a->tdur == b->tdur) ? 0 : (a->tdur < b->tdur) ? -1 : 1;
+  l->tsched.v = tsched;
+  ddsrt_timerwheel_insert (&lease_twdef, &gv->leasewheel, l);
+}
+
+static void lease_unschedule_locked (struct ddsi_domaingv *gv, struct lease *l)
+{
+  if (l->tsched.v != TSCHED_NOT_IN_WHEEL)
+  {
+    ddsrt_timerwheel_delete (&lease_twdef, &gv->leasewheel, l);
+    l->tsched.v = TSCHED_NOT_IN_WHEEL;
+  }
+}
+
+static void lease_push_pending (struct ddsi_domaingv *gv, struct lease *l)
+{
+  /* if it is already pending, the gc thread has yet to read tend */
+  if (!ddsrt_atomic_cas32 (&l->pending, 0, 1))
+    return;
+  void *head;
+  do {
+    head = ddsrt_atomic_ldvoidp (&gv->lease_pending);
+    l->pending_next = head;
+  } while (!ddsrt_atomic_casvoidp (&gv->lease_pending, head, l));
+}
+
+static void lease_drain_pending_locked (struct ddsi_domaingv *gv)
+{
+  struct lease *l;
+  do {
+    l = ddsrt_atomic_ldvoidp (&gv->lease_pending);
+  } while (l != NULL && !ddsrt_atomic_casvoidp (&gv->lease_pending, l, NULL));
+  while (l != NULL)
+  {
+    struct lease * const next = l->pending_next;
+    ddsrt_atomic_st32 (&l->pending, 0);
+    ddsrt_atomic_fence ();
+    const int64_t tend = (int64_t) ddsrt_atomic_ld64 (&l->tend);
+    if (l->tsched.v == TSCHED_NOT_IN_WHEEL)
+    {
+      if (tend != DDS_NEVER)
+        lease_schedule_locked (gv, l, tend);
+    }
+    else if (tend < l->tsched.v)
+    {
+      lease_unschedule_locked (gv, l);
+      lease_schedule_locked (gv, l, tend);
+    }
+    l = next;
+  }
 }
 
 void lease_management_init (struct ddsi_domaingv *gv)
 {
-  ddsrt_mutex_init (&gv->leaseheap_lock);
-  ddsrt_fibheap_init (&lease_fhdef, &gv->leaseheap);
+  ddsrt_mutex_init (&gv->leasewheel_lock);
+  ddsrt_timerwheel_init (&lease_twdef, &gv->leasewheel);
+  ddsrt_atomic_stvoidp (&gv->lease_pending, NULL);
+  ddsrt_atomic_st64 (&gv->lease_tnext, (uint64_t) DDS_NEVER);
 }
 
 void lease_management_term (struct ddsi_domaingv *gv)
 {
-  assert (ddsrt_fibheap_min (&lease_fhdef, &gv->leaseheap) == NULL);
-  ddsrt_mutex_destroy (&gv->leaseheap_lock);
+  assert (ddsrt_atomic_ldvoidp (&gv->lease_pending) == NULL);
+  assert (ddsrt_timerwheel_is_empty (&lease_twdef, &gv->leasewheel));
+  ddsrt_mutex_destroy (&gv->leasewheel_lock);
 }
 
 struct lease *lease_new (ddsrt_etime_t texpire, dds_duration_t tdur, struct entity_common *e)
@@ -84,7 +146,9 @@ struct lease *lease_new (ddsrt_etime_t texpire, dds_duration_t tdur, struct enti
   EETRACE (e, "lease_new(tdur %"PRId64" guid "PGUIDFMT") @ %p\n", tdur, PGUID (e->guid), (void *) l);
   l->tdur = tdur;
   ddsrt_atomic_st64 (&l->tend, (uint64_t) texpire.v);
-  l->tsched.v = TSCHED_NOT_ON_HEAP;
+  ddsrt_atomic_st32 (&l->pending, 0);
+  l->pending_next = NULL;
+  l->tsched.v = TSCHED_NOT_IN_WHEEL;
   l->entity = e;
   return l;
 }
@@ -107,15 +171,12 @@ void lease_register (struct lease *l) /* FIXME: make lease admin struct */
 {
   struct ddsi_domaingv * const gv = l->entity->gv;
   GVTRACE ("lease_register(l %p guid "PGUIDFMT")\n", (void *) l, PGUID (l->entity->guid));
-  ddsrt_mutex_lock (&gv->leaseheap_lock);
-  assert (l->tsched.v == TSCHED_NOT_ON_HEAP);
+  ddsrt_mutex_lock (&gv->leasewheel_lock);
+  assert (l->tsched.v == TSCHED_NOT_IN_WHEEL);
   int64_t tend = (int64_t) ddsrt_atomic_ld64 (&l->tend);
   if (tend != DDS_NEVER)
-  {
-    l->tsched.v = tend;
-    ddsrt_fibheap_insert (&lease_fhdef, &gv->leaseheap, l);
-  }
-  ddsrt_mutex_unlock (&gv->leaseheap_lock);
+    lease_schedule_locked (gv, l, tend);
+  ddsrt_mutex_unlock (&gv->leasewheel_lock);
 
   /* check_and_handle_lease_expiration runs on GC thread and the only way to be sure that it wakes up in time is by forcing re-evaluation (strictly speaking only needed if this is the first lease to expire, but this operation is quite rare anyway) */
   force_lease_check (gv->gcreq_queue);
@@ -125,13 +186,12 @@ void lease_unregister (struct lease *l)
 {
   struct ddsi_domaingv * const gv = l->entity->gv;
   GVTRACE ("lease_unregister(l %p guid "PGUIDFMT")\n", (void *) l, PGUID (l->entity->guid));
-  ddsrt_mutex_lock (&gv->leaseheap_lock);
-  if (l->tsched.v != TSCHED_NOT_ON_HEAP)
-  {
-    ddsrt_fibheap_delete (&lease_fhdef, &gv->leaseheap, l);
-    l->tsched.v = TSCHED_NOT_ON_HEAP;
-  }
-  ddsrt_mutex_unlock (&gv->leaseheap_lock);
+  ddsrt_mutex_lock (&gv->leasewheel_lock);
+  /* a pending earlier expiry must not cause it to be scheduled again later */
+  if (ddsrt_atomic_ld32 (&l->pending))
+    lease_drain_pending_locked (gv);
+  lease_unschedule_locked (gv, l);
+  ddsrt_mutex_unlock (&gv->leasewheel_lock);
 
   /* see lease_register() */
   force_lease_check (gv->gcreq_queue);
@@ -141,6 +201,13 @@ void lease_free (struct lease *l)
 {
   struct ddsi_domaingv * const gv = l->entity->gv;
   GVTRACE ("lease_free(l %p guid "PGUIDFMT")\n", (void *) l, PGUID (l->entity->guid));
+  if (ddsrt_atomic_ld32 (&l->pending))
+  {
+    ddsrt_mutex_lock (&gv->leasewheel_lock);
+    lease_drain_pending_locked (gv);
+    lease_unschedule_locked (gv, l);
+    ddsrt_mutex_unlock (&gv->leasewheel_lock);
+  }
   ddsrt_free (l);
 }
 
@@ -182,59 +249,44 @@ void lease_renew (struct lease *l, ddsrt_etime_t tnowE)
 void lease_set_expiry (struct lease *l, ddsrt_etime_t when)
 {
   struct ddsi_domaingv * const gv = l->entity->gv;
-  bool trigger = false;
   assert (when.v >= 0);
-  ddsrt_mutex_lock (&gv->leaseheap_lock);
   /* only possible concurrent action is to move tend into the future (renew_lease),
-    all other operations occur with leaseheap_lock held */
+     a later expiry time is handled lazily by the gc thread */
   ddsrt_atomic_st64 (&l->tend, (uint64_t) when.v);
-  if (when.v < l->tsched.v)
-  {
-    /* moved forward and currently scheduled (by virtue of
-       TSCHED_NOT_ON_HEAP == INT64_MIN) */
-    l->tsched = when;
-    ddsrt_fibheap_decrease_key (&lease_fhdef, &gv->leaseheap, l);
-    trace_lease_renew (l, "earlier ", when);
-    trigger = true;
-  }
-  else if (l->tsched.v == TSCHED_NOT_ON_HEAP && when.v < DDS_NEVER)
-  {
-    /* not currently scheduled, with a finite new expiry time */
-    l->tsched = when;
-    ddsrt_fibheap_insert (&lease_fhdef, &gv->leaseheap, l);
-    trace_lease_renew (l, "insert ", when);
-    trigger = true;
-  }
-  ddsrt_mutex_unlock (&gv->leaseheap_lock);
-
-  /* see lease_register() */
-  if (trigger)
+  if (when.v == DDS_NEVER)
+    return;
+  trace_lease_renew (l, "set ", when);
+  lease_push_pending (gv, l);
+  /* pairs with the fence in check_and_handle_lease_expiration: either the gc
+     thread sees the pending lease, or this sees the updated lease_tnext */
+  ddsrt_atomic_fence ();
+  if (when.v < (int64_t) ddsrt_atomic_ld64 (&gv->lease_tnext))
     force_lease_check (gv->gcreq_queue);
 }
 
 int64_t check_and_handle_lease_expiration (struct ddsi_domaingv *gv, ddsrt_etime_t tnowE)
 {
   struct lease *l;
-  int64_t delay;
-  ddsrt_mutex_lock (&gv->leaseheap_lock);
-  while ((l = ddsrt_fibheap_min (&lease_fhdef, &gv->leaseheap)) != NULL && l->tsched.v <= tnowE.v)
+  int64_t tnext;
+  ddsrt_mutex_lock (&gv->leasewheel_lock);
+  lease_drain_pending_locked (gv);
+  while ((l = ddsrt_timerwheel_extract_due (&lease_twdef, &gv->leasewheel, tnowE.v)) != NULL)
   {
     ddsi_guid_t g = l->entity->guid;
     enum entity_kind k = l->entity->kind;
 
-    assert (l->tsched.v != TSCHED_NOT_ON_HEAP);
-    ddsrt_fibheap_extract_min (&lease_fhdef, &gv->leaseheap);
-    /* only possible concurrent action is to move tend into the future (renew_lease),
-       all other operations occur with leaseheap_lock held */
+    assert (l->tsched.v != TSCHED_NOT_IN_WHEEL);
+    /* only possible concurrent actions are moving tend into the future (renew_lease)
+       and moving it earlier (lease_set_expiry), the latter also queues the lease on
+       lease_pending and so will be taken care of later */
     int64_t tend = (int64_t) ddsrt_atomic_ld64 (&l->tend);
     if (tnowE.v < tend)
     {
       if (tend == DDS_NEVER) {
         /* don't reinsert if it won't expire */
-        l->tsched.v = TSCHED_NOT_ON_HEAP;
+        l->tsched.v = TSCHED_NOT_IN_WHEEL;
       } else {
-        l->tsched.v = tend;
-        ddsrt_fibheap_insert (&lease_fhdef, &gv->leaseheap, l);
+        lease_schedule_locked (gv, l, tend);
       }
       continue;
     }
@@ -273,14 +325,13 @@ int64_t check_and_handle_lease_expiration (struct ddsi_domaingv *gv, ddsrt_etime
           entidx_lookup_proxy_participant_guid (gv->entity_index, &proxypp->privileged_pp_guid) != NULL)
       {
         GVLOGDISC ("but postponing because privileged pp "PGUIDFMT" is still live\n", PGUID (proxypp->privileged_pp_guid));
-        l->tsched = ddsrt_etime_add_duration (tnowE, DDS_MSECS (200));
-        ddsrt_fibheap_insert (&lease_fhdef, &gv->leaseheap, l);
+        lease_schedule_locked (gv, l, ddsrt_etime_add_duration (tnowE, DDS_MSECS (200)).v);
         continue;
       }
     }
 
-    l->tsched.v = TSCHED_NOT_ON_HEAP;
-    ddsrt_mutex_unlock (&gv->leaseheap_lock);
+    l->tsched.v = TSCHED_NOT_IN_WHEEL;
+    ddsrt_mutex_unlock (&gv->leasewheel_lock);
 
     switch (k)
     {
@@ -300,11 +351,22 @@ int64_t check_and_handle_lease_expiration (struct ddsi_domaingv *gv, ddsrt_etime
         assert (false);
         break;
     }
-    ddsrt_mutex_lock (&gv->leaseheap_lock);
+    ddsrt_mutex_lock (&gv->leasewheel_lock);
+    lease_drain_pending_locked (gv);
   }
 
-  delay = (l == NULL) ? DDS_INFINITY : (l->tsched.v - tnowE.v);
-  ddsrt_mutex_unlock (&gv->leaseheap_lock);
-  return delay;
+  /* publish the time of the next check, then look for leases that were moved
+     earlier in the mean time (see lease_set_expiry) */
+  while (true)
+  {
+    tnext = ddsrt_timerwheel_next (&lease_twdef, &gv->leasewheel);
+    ddsrt_atomic_st64 (&gv->lease_tnext, (uint64_t) tnext);
+    ddsrt_atomic_fence ();
+    if (ddsrt_atomic_ldvoidp (&gv->lease_pending) == NULL)
+      break;
+    lease_drain_pending_locked (gv);
+  }
+  ddsrt_mutex_unlock (&gv->leasewheel_lock);
+  return (tnext == INT64_MAX) ? DDS_INFINITY : (tnext - tnowE.v);
 }
 
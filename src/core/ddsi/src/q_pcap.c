@@ -10,12 +10,24 @@
  * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
  */
 #include <stdio.h>
+#include <stddef.h>
+#include <string.h>
 #include <assert.h>
 
 #include "dds/ddsrt/endian.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/io.h"
+#include "dds/ddsrt/string.h"
+#include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/atomics.h"
 #include "dds/ddsi/q_log.h"
 #include "dds/ddsi/q_config.h"
 #include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/ddsi_entity_index.h"
+#include "dds/ddsi/q_entity.h"
+#include "dds/ddsi/q_thread.h"
+#include "dds/ddsi/q_misc.h"
+#include "dds/ddsi/q_protocol.h"
 #include "dds/ddsi/q_bswap.h"
 #include "dds/ddsi/q_pcap.h"
 
@@ -76,7 +88,77 @@ static const ipv4_hdr_t ipv4_hdr_template = {
 #define IPV4_HDR_SIZE 20
 #define UDP_HDR_SIZE 8
 
-FILE *new_pcap_file (struct ddsi_domaingv *gv, const char *name)
+/* Packets are described by a "struct pcap_packet" and the (possibly truncated)
+   UDP payload. Without a PacketCapture/BufferSize, the sending and receiving
+   threads copy the payload into "scratch" and process the packet (filter,
+   rotate, write) under "lock".
+
+   With a buffer, they instead copy it into "ring", a lock-free buffer shared
+   by all producers, and a dedicated thread does the processing. Records in
+   the ring are 8-byte aligned and consist of a "struct pcap_ringrec"
+   followed by the payload; they may wrap around except for the first 8
+   bytes. A producer reserves space by advancing "ring_head" with a CAS,
+   copies the packet and finally sets "ready". The writer thread consumes
+   records in order up to the first one that isn't ready yet, zeroes the
+   memory (so that all "ready" flags in the free space are 0) and then
+   advances "ring_tail" to release the space. If there isn't enough space,
+   the packet is dropped and counted. */
+
+struct pcap_packet {
+  ddsrt_wctime_t tstamp;
+  uint32_t srcip, dstip;     /* network byte order */
+  uint16_t srcport, dstport; /* network byte order */
+  uint32_t size;             /* size of UDP payload */
+  uint32_t captured;         /* number of bytes of payload available */
+  unsigned char ttl;
+};
+
+struct pcap_ringrec {
+  uint32_t size;             /* size of record, including payload and padding */
+  ddsrt_atomic_uint32_t ready;
+  struct pcap_packet pkt;
+};
+
+#define PCAP_RING_MIN_SIZE (128u * 1024u)
+
+struct pcap_capture {
+  struct ddsi_domaingv *gv;
+  ddsrt_mutex_t lock;
+  ddsrt_cond_t cond;
+
+  /* file & rotation */
+  FILE *fp;
+  char *name;
+  bool rotate;
+  uint32_t file_seq;
+  uint64_t file_size;
+  ddsrt_wctime_t file_tstart;
+  uint32_t snaplen;          /* 0 if unlimited */
+  uint32_t payload_snaplen;  /* max bytes of payload that need to be copied */
+
+  /* filters, no filtering if empty */
+  uint32_t n_prefix_pats;
+  char **prefix_pats;
+  uint32_t n_topic_pats;
+  char **topic_pats;
+
+  /* synchronous mode */
+  unsigned char *scratch;
+
+  /* asynchronous mode */
+  unsigned char *ring;
+  uint32_t ring_size;
+  ddsrt_atomic_uint32_t ring_head;
+  ddsrt_atomic_uint32_t ring_tail;
+  ddsrt_atomic_uint32_t dropped;
+  ddsrt_atomic_uint32_t signalled;
+  uint32_t dropped_reported;
+  ddsrt_mtime_t tdropped_reported;
+  bool stop;
+  struct thread_state1 *ts;
+};
+
+static FILE *new_pcap_file (struct ddsi_domaingv *gv, const char *name, uint32_t snaplen)
 {
   DDSRT_WARNING_MSVC_OFF(4996);
   FILE *fp;
@@ -93,7 +175,7 @@ FILE *new_pcap_file (struct ddsi_domaingv *gv, const char *name)
   hdr.version_minor = 4;
   hdr.thiszone = 0;
   hdr.sigfigs = 0;
-  hdr.snaplen = 65535;
+  hdr.snaplen = (snaplen > 0) ? snaplen : 65535;
   hdr.network = LINKTYPE_RAW;
   (void) fwrite (&hdr, sizeof (hdr), 1, fp);
 
@@ -101,17 +183,32 @@ FILE *new_pcap_file (struct ddsi_domaingv *gv, const char *name)
   DDSRT_WARNING_MSVC_ON(4996);
 }
 
-static void write_data (FILE *fp, const ddsrt_msghdr_t *msghdr, size_t sz)
+static bool open_capture_file (struct pcap_capture *pc, ddsrt_wctime_t tstart)
 {
-  size_t i, n = 0;
-  for (i = 0; i < (size_t) msghdr->msg_iovlen && n < sz; i++)
+  if (!pc->rotate)
+    pc->fp = new_pcap_file (pc->gv, pc->name, pc->snaplen);
+  else
   {
-    size_t m1 = msghdr->msg_iov[i].iov_len;
-    size_t m = (n + m1 <= sz) ? m1 : sz - n;
-    (void) fwrite (msghdr->msg_iov[i].iov_base, m, 1, fp);
-    n += m;
+    /* insert the sequence number before the extension, if there is one */
+    const char *sep = strrchr (pc->name, '/');
+#ifdef _WIN32
+    const char *sep1 = strrchr (pc->name, '\\');
+    if (sep1 && (sep == NULL || sep1 > sep))
+      sep = sep1;
+#endif
+    const char *base = sep ? sep + 1 : pc->name;
+    const char *ext = strrchr (base, '.');
+    const int baselen = (int) ((ext && ext != base) ? (size_t) (ext - pc->name) : strlen (pc->name));
+    const uint32_t seq = (pc->gv->config.pcap_max_files > 0) ? pc->file_seq % pc->gv->config.pcap_max_files : pc->file_seq;
+    char *name;
+    (void) ddsrt_asprintf (&name, "%.*s.%"PRIu32"%s", baselen, pc->name, seq, pc->name + baselen);
+    pc->fp = new_pcap_file (pc->gv, name, pc->snaplen);
+    ddsrt_free (name);
+    pc->file_seq++;
   }
-  assert (n == sz);
+  pc->file_size = sizeof (pcap_hdr_t);
+  pc->file_tstart = tstart;
+  return pc->fp != NULL;
 }
 
 static uint16_t calc_ipv4_checksum (const uint16_t *x)
@@ -126,36 +223,386 @@ static uint16_t calc_ipv4_checksum (const uint16_t *x)
   return (uint16_t) ~s;
 }
 
+static bool match_any (const char *str, uint32_t npats, char * const *pats)
+{
+  for (uint32_t i = 0; i < npats; i++)
+    if (ddsi2_patmatch (pats[i], str))
+      return true;
+  return false;
+}
+
+static const char *builtin_topic_name (ddsi_entityid_t id)
+{
+  switch (id.u)
+  {
+    case NN_ENTITYID_SPDP_BUILTIN_PARTICIPANT_WRITER:
+    case NN_ENTITYID_SPDP_BUILTIN_PARTICIPANT_READER:
+      return DDS_BUILTIN_TOPIC_PARTICIPANT_NAME;
+    case NN_ENTITYID_SEDP_BUILTIN_PUBLICATIONS_WRITER:
+    case NN_ENTITYID_SEDP_BUILTIN_PUBLICATIONS_READER:
+      return DDS_BUILTIN_TOPIC_PUBLICATION_NAME;
+    case NN_ENTITYID_SEDP_BUILTIN_SUBSCRIPTIONS_WRITER:
+    case NN_ENTITYID_SEDP_BUILTIN_SUBSCRIPTIONS_READER:
+      return DDS_BUILTIN_TOPIC_SUBSCRIPTION_NAME;
+    case NN_ENTITYID_SEDP_BUILTIN_TOPIC_WRITER:
+    case NN_ENTITYID_SEDP_BUILTIN_TOPIC_READER:
+      return DDS_BUILTIN_TOPIC_TOPIC_NAME;
+    case NN_ENTITYID_P2P_BUILTIN_PARTICIPANT_MESSAGE_WRITER:
+    case NN_ENTITYID_P2P_BUILTIN_PARTICIPANT_MESSAGE_READER:
+      return DDS_BUILTIN_TOPIC_PARTICIPANT_MESSAGE_NAME;
+    case NN_ENTITYID_TL_SVC_BUILTIN_REQUEST_WRITER:
+    case NN_ENTITYID_TL_SVC_BUILTIN_REQUEST_READER:
+      return DDS_BUILTIN_TOPIC_TYPELOOKUP_REQUEST_NAME;
+    case NN_ENTITYID_TL_SVC_BUILTIN_REPLY_WRITER:
+    case NN_ENTITYID_TL_SVC_BUILTIN_REPLY_READER:
+      return DDS_BUILTIN_TOPIC_TYPELOOKUP_REPLY_NAME;
+    case NN_ENTITYID_SPDP_RELIABLE_BUILTIN_PARTICIPANT_SECURE_WRITER:
+    case NN_ENTITYID_SPDP_RELIABLE_BUILTIN_PARTICIPANT_SECURE_READER:
+      return DDS_BUILTIN_TOPIC_PARTICIPANT_SECURE_NAME;
+    case NN_ENTITYID_SEDP_BUILTIN_PUBLICATIONS_SECURE_WRITER:
+    case NN_ENTITYID_SEDP_BUILTIN_PUBLICATIONS_SECURE_READER:
+      return DDS_BUILTIN_TOPIC_PUBLICATION_SECURE_NAME;
+    case NN_ENTITYID_SEDP_BUILTIN_SUBSCRIPTIONS_SECURE_WRITER:
+    case NN_ENTITYID_SEDP_BUILTIN_SUBSCRIPTIONS_SECURE_READER:
+      return DDS_BUILTIN_TOPIC_SUBSCRIPTION_SECURE_NAME;
+    case NN_ENTITYID_P2P_BUILTIN_PARTICIPANT_MESSAGE_SECURE_WRITER:
+    case NN_ENTITYID_P2P_BUILTIN_PARTICIPANT_MESSAGE_SECURE_READER:
+      return DDS_BUILTIN_TOPIC_PARTICIPANT_MESSAGE_SECURE_NAME;
+    case NN_ENTITYID_P2P_BUILTIN_PARTICIPANT_STATELESS_MESSAGE_WRITER:
+    case NN_ENTITYID_P2P_BUILTIN_PARTICIPANT_STATELESS_MESSAGE_READER:
+      return DDS_BUILTIN_TOPIC_PARTICIPANT_STATELESS_MESSAGE_NAME;
+    case NN_ENTITYID_P2P_BUILTIN_PARTICIPANT_VOLATILE_SECURE_WRITER:
+    case NN_ENTITYID_P2P_BUILTIN_PARTICIPANT_VOLATILE_SECURE_READER:
+      return DDS_BUILTIN_TOPIC_PARTICIPANT_VOLATILE_MESSAGE_SECURE_NAME;
+    default:
+      return NULL;
+  }
+}
+
+static const char *endpoint_topic_name (const struct ddsi_domaingv *gv, const ddsi_guid_prefix_t *prefix, const unsigned char *entityid, bool writer)
+{
+  /* caller must be awake, the result remains valid until it goes to sleep */
+  ddsi_guid_t guid;
+  const char *name;
+  guid.prefix = *prefix;
+  memcpy (&guid.entityid, entityid, sizeof (guid.entityid));
+  guid.entityid = nn_ntoh_entityid (guid.entityid);
+  if ((name = builtin_topic_name (guid.entityid)) != NULL)
+    return name;
+  if (writer)
+  {
+    const struct writer *wr;
+    const struct proxy_writer *pwr;
+    if ((wr = entidx_lookup_writer_guid (gv->entity_index, &guid)) != NULL)
+      return wr->xqos->topic_name;
+    else if ((pwr = entidx_lookup_proxy_writer_guid (gv->entity_index, &guid)) != NULL)
+      return pwr->c.xqos->topic_name;
+  }
+  else
+  {
+    const struct reader *rd;
+    const struct proxy_reader *prd;
+    if ((rd = entidx_lookup_reader_guid (gv->entity_index, &guid)) != NULL)
+      return rd->xqos->topic_name;
+    else if ((prd = entidx_lookup_proxy_reader_guid (gv->entity_index, &guid)) != NULL)
+      return prd->c.xqos->topic_name;
+  }
+  return NULL;
+}
+
+static bool match_topics (const struct pcap_capture *pc, ddsi_guid_prefix_t src, const unsigned char *data, size_t sz)
+{
+  /* Walks the submessages to find the writers that sent data, heartbeats and
+     gaps and the readers that sent acknowledgements; encrypted submessages are
+     skipped */
+  struct thread_state1 * const ts1 = lookup_thread_state ();
+  bool match = false;
+  size_t off = RTPS_MESSAGE_HEADER_SIZE;
+  thread_state_awake (ts1, pc->gv);
+  while (!match && off + RTPS_SUBMESSAGE_HEADER_SIZE <= sz)
+  {
+    const unsigned char id = data[off];
+    const unsigned char flags = data[off + 1];
+    const unsigned char *body = data + off + RTPS_SUBMESSAGE_HEADER_SIZE;
+    const size_t avail = sz - off - RTPS_SUBMESSAGE_HEADER_SIZE;
+    uint16_t len;
+    memcpy (&len, data + off + 2, sizeof (len));
+    if ((flags & SMFLAG_ENDIANNESS) != (DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN))
+      len = ddsrt_bswap2u (len);
+    const char *name = NULL;
+    switch (id)
+    {
+      case SMID_INFO_SRC:
+        if (avail >= 8 + sizeof (src))
+        {
+          memcpy (&src, body + 8, sizeof (src));
+          src = nn_ntoh_guid_prefix (src);
+        }
+        break;
+      case SMID_DATA: case SMID_DATA_FRAG:
+        if (avail >= 12)
+          name = endpoint_topic_name (pc->gv, &src, body + 8, true);
+        break;
+      case SMID_HEARTBEAT: case SMID_HEARTBEAT_FRAG: case SMID_GAP:
+        if (avail >= 8)
+          name = endpoint_topic_name (pc->gv, &src, body + 4, true);
+        break;
+      case SMID_ACKNACK: case SMID_NACK_FRAG:
+        if (avail >= 4)
+          name = endpoint_topic_name (pc->gv, &src, body, false);
+        break;
+    }
+    if (name && match_any (name, pc->n_topic_pats, pc->topic_pats))
+      match = true;
+    /* length 0 means the submessage extends to the end of the message */
+    if ((len == 0 && id != SMID_PAD && id != SMID_INFO_TS) || len >= avail)
+      break;
+    off += RTPS_SUBMESSAGE_HEADER_SIZE + len;
+  }
+  thread_state_asleep (ts1);
+  return match;
+}
+
+static bool pass_filters (const struct pcap_capture *pc, const struct pcap_packet *pkt, const unsigned char *data)
+{
+  if (pc->n_prefix_pats == 0 && pc->n_topic_pats == 0)
+    return true;
+  if (pkt->captured < RTPS_MESSAGE_HEADER_SIZE || memcmp (data, "RTPS", 4) != 0)
+    return false;
+  ddsi_guid_prefix_t prefix;
+  memcpy (&prefix, data + offsetof (Header_t, guid_prefix), sizeof (prefix));
+  prefix = nn_ntoh_guid_prefix (prefix);
+  if (pc->n_prefix_pats > 0)
+  {
+    char str[3 * 9];
+    (void) snprintf (str, sizeof (str), PGUIDPREFIXFMT, PGUIDPREFIX (prefix));
+    if (!match_any (str, pc->n_prefix_pats, pc->prefix_pats))
+      return false;
+  }
+  if (pc->n_topic_pats > 0 && !match_topics (pc, prefix, data, pkt->captured))
+    return false;
+  return true;
+}
+
+static void process_packet (struct pcap_capture *pc, const struct pcap_packet *pkt, const unsigned char *data)
+{
+  const struct ddsi_config *config = &pc->gv->config;
+  union {
+    ipv4_hdr_t ipv4_hdr;
+    uint16_t x[10];
+  } u;
+  udp_hdr_t udp_hdr;
+  pcaprec_hdr_t pcap_hdr;
+  const size_t sz_ud = pkt->size + UDP_HDR_SIZE;
+  const size_t sz_iud = sz_ud + IPV4_HDR_SIZE;
+  const size_t incl = (pc->snaplen > 0 && sz_iud > pc->snaplen) ? pc->snaplen : sz_iud;
+
+  if (pc->fp == NULL || !pass_filters (pc, pkt, data))
+    return;
+  if (pc->rotate &&
+      ((config->pcap_max_file_size > 0 && pc->file_size > sizeof (pcap_hdr_t) && pc->file_size + sizeof (pcap_hdr) + incl > config->pcap_max_file_size) ||
+       (config->pcap_rotation_interval != DDS_INFINITY && pkt->tstamp.v - pc->file_tstart.v >= config->pcap_rotation_interval)))
+  {
+    fclose (pc->fp);
+    if (!open_capture_file (pc, pkt->tstamp))
+      return;
+  }
+
+  ddsrt_wctime_to_sec_usec (&pcap_hdr.ts_sec, &pcap_hdr.ts_usec, pkt->tstamp);
+  pcap_hdr.incl_len = (uint32_t) incl;
+  pcap_hdr.orig_len = (uint32_t) sz_iud;
+  (void) fwrite (&pcap_hdr, sizeof (pcap_hdr), 1, pc->fp);
+  u.ipv4_hdr = ipv4_hdr_template;
+  u.ipv4_hdr.totallength = ddsrt_toBE2u ((unsigned short) sz_iud);
+  u.ipv4_hdr.ttl = pkt->ttl;
+  u.ipv4_hdr.srcip = pkt->srcip;
+  u.ipv4_hdr.dstip = pkt->dstip;
+  u.ipv4_hdr.checksum = calc_ipv4_checksum (u.x);
+  udp_hdr.srcport = pkt->srcport;
+  udp_hdr.dstport = pkt->dstport;
+  udp_hdr.length = ddsrt_toBE2u ((unsigned short) sz_ud);
+  udp_hdr.checksum = 0; /* don't have to compute a checksum for UDPv4 */
+  if (incl >= IPV4_HDR_SIZE + UDP_HDR_SIZE)
+  {
+    (void) fwrite (&u.ipv4_hdr, sizeof (u.ipv4_hdr), 1, pc->fp);
+    (void) fwrite (&udp_hdr, sizeof (udp_hdr), 1, pc->fp);
+    assert (incl - IPV4_HDR_SIZE - UDP_HDR_SIZE <= pkt->captured);
+    (void) fwrite (data, incl - IPV4_HDR_SIZE - UDP_HDR_SIZE, 1, pc->fp);
+  }
+  else
+  {
+    unsigned char hdrs[IPV4_HDR_SIZE + UDP_HDR_SIZE];
+    memcpy (hdrs, &u.ipv4_hdr, IPV4_HDR_SIZE);
+    memcpy (hdrs + IPV4_HDR_SIZE, &udp_hdr, UDP_HDR_SIZE);
+    (void) fwrite (hdrs, incl, 1, pc->fp);
+  }
+  pc->file_size += sizeof (pcap_hdr) + incl;
+}
+
+static void ring_copy_out (const struct pcap_capture *pc, void *dst, uint32_t pos, size_t sz)
+{
+  const uint32_t off = pos & (pc->ring_size - 1);
+  const size_t n = (sz <= pc->ring_size - off) ? sz : pc->ring_size - off;
+  memcpy (dst, pc->ring + off, n);
+  memcpy ((unsigned char *) dst + n, pc->ring, sz - n);
+}
+
+static void ring_zero (struct pcap_capture *pc, uint32_t pos, size_t sz)
+{
+  const uint32_t off = pos & (pc->ring_size - 1);
+  const size_t n = (sz <= pc->ring_size - off) ? sz : pc->ring_size - off;
+  memset (pc->ring + off, 0, n);
+  memset (pc->ring, 0, sz - n);
+}
+
+static void ring_drain (struct pcap_capture *pc)
+{
+  struct ddsi_domaingv * const gv = pc->gv;
+  uint32_t tail = ddsrt_atomic_ld32 (&pc->ring_tail);
+  while (tail != ddsrt_atomic_ld32 (&pc->ring_head))
+  {
+    struct pcap_ringrec * const rec = (struct pcap_ringrec *) (pc->ring + (tail & (pc->ring_size - 1)));
+    if (ddsrt_atomic_ld32 (&rec->ready) == 0)
+      break;
+    ddsrt_atomic_fence_acq ();
+    const uint32_t size = rec->size;
+    struct pcap_packet pkt;
+    ring_copy_out (pc, &pkt, tail + (uint32_t) offsetof (struct pcap_ringrec, pkt), sizeof (pkt));
+    const uint32_t payload_pos = tail + (uint32_t) sizeof (struct pcap_ringrec);
+    const uint32_t payload_off = payload_pos & (pc->ring_size - 1);
+    if (pkt.captured <= pc->ring_size - payload_off)
+      process_packet (pc, &pkt, pc->ring + payload_off);
+    else
+    {
+      ring_copy_out (pc, pc->scratch, payload_pos, pkt.captured);
+      process_packet (pc, &pkt, pc->scratch);
+    }
+    ring_zero (pc, tail, size);
+    ddsrt_atomic_fence_rel ();
+    tail += size;
+    ddsrt_atomic_st32 (&pc->ring_tail, tail);
+  }
+
+  const uint32_t dropped = ddsrt_atomic_ld32 (&pc->dropped);
+  if (dropped != pc->dropped_reported)
+  {
+    const ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
+    if (tnow.v - pc->tdropped_reported.v >= DDS_SECS (1))
+    {
+      GVWARNING ("packet capture: %"PRIu32" packets dropped because the buffer was full\n", dropped - pc->dropped_reported);
+      pc->dropped_reported = dropped;
+      pc->tdropped_reported = tnow;
+    }
+  }
+}
+
+static uint32_t pcap_writer_thread (void *vpc)
+{
+  struct pcap_capture * const pc = vpc;
+  ddsrt_mutex_lock (&pc->lock);
+  while (!pc->stop)
+  {
+    ddsrt_mutex_unlock (&pc->lock);
+    ring_drain (pc);
+    ddsrt_mutex_lock (&pc->lock);
+    ddsrt_atomic_st32 (&pc->signalled, 0);
+    if (!pc->stop)
+      (void) ddsrt_cond_waitfor (&pc->cond, &pc->lock, DDS_MSECS (10));
+  }
+  ddsrt_mutex_unlock (&pc->lock);
+  ring_drain (pc);
+  if (pc->fp)
+    fflush (pc->fp);
+  return 0;
+}
+
+static void ring_push (struct pcap_capture *pc, const struct pcap_packet *pkt, const ddsrt_iovec_t *iov, size_t niov)
+{
+  const uint32_t size = ((uint32_t) sizeof (struct pcap_ringrec) + pkt->captured + 7u) & ~7u;
+  uint32_t head, fill;
+  do {
+    head = ddsrt_atomic_ld32 (&pc->ring_head);
+    fill = head - ddsrt_atomic_ld32 (&pc->ring_tail);
+    if (size > pc->ring_size - fill)
+    {
+      ddsrt_atomic_inc32 (&pc->dropped);
+      return;
+    }
+  } while (!ddsrt_atomic_cas32 (&pc->ring_head, head, head + size));
+  ddsrt_atomic_fence_acq ();
+
+  /* header never wraps around, packet and payload may */
+  struct pcap_ringrec * const rec = (struct pcap_ringrec *) (pc->ring + (head & (pc->ring_size - 1)));
+  uint32_t off = (head + (uint32_t) offsetof (struct pcap_ringrec, pkt)) & (pc->ring_size - 1);
+  size_t n = (sizeof (*pkt) <= pc->ring_size - off) ? sizeof (*pkt) : pc->ring_size - off;
+  memcpy (pc->ring + off, pkt, n);
+  memcpy (pc->ring, (const unsigned char *) pkt + n, sizeof (*pkt) - n);
+  off = (head + (uint32_t) sizeof (*rec)) & (pc->ring_size - 1);
+  size_t rem = pkt->captured;
+  for (size_t i = 0; i < niov && rem > 0; i++)
+  {
+    const unsigned char *src = iov[i].iov_base;
+    size_t m = ((size_t) iov[i].iov_len <= rem) ? (size_t) iov[i].iov_len : rem;
+    rem -= m;
+    while (m > 0)
+    {
+      n = (m <= pc->ring_size - off) ? m : pc->ring_size - off;
+      memcpy (pc->ring + off, src, n);
+      src += n;
+      m -= n;
+      off = (off + (uint32_t) n) & (pc->ring_size - 1);
+    }
+  }
+  rec->size = size;
+  ddsrt_atomic_fence_rel ();
+  ddsrt_atomic_st32 (&rec->ready, 1);
+
+  /* the writer thread polls, but wake it up early if the ring is filling up */
+  if (fill + size > pc->ring_size / 2 && ddsrt_atomic_cas32 (&pc->signalled, 0, 1))
+  {
+    ddsrt_mutex_lock (&pc->lock);
+    ddsrt_cond_signal (&pc->cond);
+    ddsrt_mutex_unlock (&pc->lock);
+  }
+}
+
+static void capture (struct ddsi_domaingv *gv, struct pcap_packet *pkt, const ddsrt_iovec_t *iov, size_t niov)
+{
+  struct pcap_capture * const pc = gv->pcap;
+  pkt->captured = (pkt->size <= pc->payload_snaplen) ? pkt->size : pc->payload_snaplen;
+  if (pc->ring)
+    ring_push (pc, pkt, iov, niov);
+  else
+  {
+    ddsrt_mutex_lock (&pc->lock);
+    size_t n = 0;
+    for (size_t i = 0; i < niov && n < pkt->captured; i++)
+    {
+      const size_t m = ((size_t) iov[i].iov_len <= pkt->captured - n) ? (size_t) iov[i].iov_len : pkt->captured - n;
+      memcpy (pc->scratch + n, iov[i].iov_base, m);
+      n += m;
+    }
+    process_packet (pc, pkt, pc->scratch);
+    ddsrt_mutex_unlock (&pc->lock);
+  }
+}
+
 void write_pcap_received (struct ddsi_domaingv *gv, ddsrt_wctime_t tstamp, const struct sockaddr_storage *src, const struct sockaddr_storage *dst, unsigned char *buf, size_t sz)
 {
   if (gv->config.transport_selector == DDSI_TRANS_UDP)
   {
-    pcaprec_hdr_t pcap_hdr;
-    union {
-      ipv4_hdr_t ipv4_hdr;
-      uint16_t x[10];
-    } u;
-    udp_hdr_t udp_hdr;
-    size_t sz_ud = sz + UDP_HDR_SIZE;
-    size_t sz_iud = sz_ud + IPV4_HDR_SIZE;
-    ddsrt_mutex_lock (&gv->pcap_lock);
-    ddsrt_wctime_to_sec_usec (&pcap_hdr.ts_sec, &pcap_hdr.ts_usec, tstamp);
-    pcap_hdr.incl_len = pcap_hdr.orig_len = (uint32_t) sz_iud;
-    (void) fwrite (&pcap_hdr, sizeof (pcap_hdr), 1, gv->pcap_fp);
-    u.ipv4_hdr = ipv4_hdr_template;
-    u.ipv4_hdr.totallength = ddsrt_toBE2u ((unsigned short) sz_iud);
-    u.ipv4_hdr.ttl = 128;
-    u.ipv4_hdr.srcip = ((struct sockaddr_in*) src)->sin_addr.s_addr;
-    u.ipv4_hdr.dstip = ((struct sockaddr_in*) dst)->sin_addr.s_addr;
-    u.ipv4_hdr.checksum = calc_ipv4_checksum (u.x);
-    (void) fwrite (&u.ipv4_hdr, sizeof (u.ipv4_hdr), 1, gv->pcap_fp);
-    udp_hdr.srcport = ((struct sockaddr_in*) src)->sin_port;
-    udp_hdr.dstport = ((struct sockaddr_in*) dst)->sin_port;
-    udp_hdr.length = ddsrt_toBE2u ((unsigned short) sz_ud);
-    udp_hdr.checksum = 0; /* don't have to compute a checksum for UDPv4 */
-    (void) fwrite (&udp_hdr, sizeof (udp_hdr), 1, gv->pcap_fp);
-    (void) fwrite (buf, sz, 1, gv->pcap_fp);
-    ddsrt_mutex_unlock (&gv->pcap_lock);
+    struct pcap_packet pkt;
+    ddsrt_iovec_t iov;
+    pkt.tstamp = tstamp;
+    pkt.srcip = ((struct sockaddr_in*) src)->sin_addr.s_addr;
+    pkt.dstip = ((struct sockaddr_in*) dst)->sin_addr.s_addr;
+    pkt.srcport = ((struct sockaddr_in*) src)->sin_port;
+    pkt.dstport = ((struct sockaddr_in*) dst)->sin_port;
+    pkt.size = (uint32_t) sz;
+    pkt.ttl = 128;
+    iov.iov_base = buf;
+    iov.iov_len = (ddsrt_iov_len_t) sz;
+    capture (gv, &pkt, &iov, 1);
   }
 }
 
@@ -163,31 +610,118 @@ void write_pcap_sent (struct ddsi_domaingv *gv, ddsrt_wctime_t tstamp, const str
 {
   if (gv->config.transport_selector == DDSI_TRANS_UDP)
   {
-    pcaprec_hdr_t pcap_hdr;
-    union {
-      ipv4_hdr_t ipv4_hdr;
-      uint16_t x[10];
-    } u;
-    udp_hdr_t udp_hdr;
-    size_t sz_ud = sz + UDP_HDR_SIZE;
-    size_t sz_iud = sz_ud + IPV4_HDR_SIZE;
-    ddsrt_mutex_lock (&gv->pcap_lock);
-    ddsrt_wctime_to_sec_usec (&pcap_hdr.ts_sec, &pcap_hdr.ts_usec, tstamp);
-    pcap_hdr.incl_len = pcap_hdr.orig_len = (uint32_t) sz_iud;
-    (void) fwrite (&pcap_hdr, sizeof (pcap_hdr), 1, gv->pcap_fp);
-    u.ipv4_hdr = ipv4_hdr_template;
-    u.ipv4_hdr.totallength = ddsrt_toBE2u ((unsigned short) sz_iud);
-    u.ipv4_hdr.ttl = 255;
-    u.ipv4_hdr.srcip = ((struct sockaddr_in*) src)->sin_addr.s_addr;
-    u.ipv4_hdr.dstip = ((struct sockaddr_in*) hdr->msg_name)->sin_addr.s_addr;
-    u.ipv4_hdr.checksum = calc_ipv4_checksum (u.x);
-    (void) fwrite (&u.ipv4_hdr, sizeof (u.ipv4_hdr), 1, gv->pcap_fp);
-    udp_hdr.srcport = ((struct sockaddr_in*) src)->sin_port;
-    udp_hdr.dstport = ((struct sockaddr_in*) hdr->msg_name)->sin_port;
-    udp_hdr.length = ddsrt_toBE2u ((unsigned short) sz_ud);
-    udp_hdr.checksum = 0; /* don't have to compute a checksum for UDPv4 */
-    (void) fwrite (&udp_hdr, sizeof (udp_hdr), 1, gv->pcap_fp);
-    write_data (gv->pcap_fp, hdr, sz);
-    ddsrt_mutex_unlock (&gv->pcap_lock);
+    struct pcap_packet pkt;
+    pkt.tstamp = tstamp;
+    pkt.srcip = ((struct sockaddr_in*) src)->sin_addr.s_addr;
+    pkt.dstip = ((struct sockaddr_in*) hdr->msg_name)->sin_addr.s_addr;
+    pkt.srcport = ((struct sockaddr_in*) src)->sin_port;
+    pkt.dstport = ((struct sockaddr_in*) hdr->msg_name)->sin_port;
+    pkt.size = (uint32_t) sz;
+    pkt.ttl = 255;
+    capture (gv, &pkt, hdr->msg_iov, (size_t) hdr->msg_iovlen);
+  }
+}
+
+static uint32_t split_patterns (char ***pats, const char *list)
+{
+  char *copy = ddsrt_strdup (list ? list : ""), *cursor = copy, *tok;
+  uint32_t n = 0;
+  *pats = NULL;
+  while ((tok = ddsrt_strsep (&cursor, ",")) != NULL)
+  {
+    if (*tok == 0)
+      continue;
+    *pats = ddsrt_realloc (*pats, (n + 1) * sizeof (**pats));
+    (*pats)[n++] = ddsrt_strdup (tok);
+  }
+  ddsrt_free (copy);
+  return n;
+}
+
+static void free_patterns (uint32_t n, char **pats)
+{
+  for (uint32_t i = 0; i < n; i++)
+    ddsrt_free (pats[i]);
+  ddsrt_free (pats);
+}
+
+struct pcap_capture *new_pcap_capture (struct ddsi_domaingv *gv, const char *name)
+{
+  const struct ddsi_config *config = &gv->config;
+  struct pcap_capture *pc = ddsrt_malloc (sizeof (*pc));
+  memset (pc, 0, sizeof (*pc));
+  pc->gv = gv;
+  pc->name = ddsrt_strdup (name);
+  pc->rotate = (config->pcap_max_file_size > 0 || config->pcap_rotation_interval != DDS_INFINITY);
+  pc->snaplen = config->pcap_snaplen;
+  pc->n_prefix_pats = split_patterns (&pc->prefix_pats, config->pcap_guid_prefixes);
+  pc->n_topic_pats = split_patterns (&pc->topic_pats, config->pcap_topics);
+
+  /* the filters need the RTPS header, the topic filter potentially the
+     entire packet */
+  if (pc->snaplen == 0 || pc->n_topic_pats > 0)
+    pc->payload_snaplen = UINT32_MAX;
+  else
+  {
+    pc->payload_snaplen = (pc->snaplen > IPV4_HDR_SIZE + UDP_HDR_SIZE) ? pc->snaplen - IPV4_HDR_SIZE - UDP_HDR_SIZE : 0;
+    if (pc->n_prefix_pats > 0 && pc->payload_snaplen < RTPS_MESSAGE_HEADER_SIZE)
+      pc->payload_snaplen = RTPS_MESSAGE_HEADER_SIZE;
+  }
+
+  if (!open_capture_file (pc, ddsrt_time_wallclock ()))
+  {
+    free_patterns (pc->n_topic_pats, pc->topic_pats);
+    free_patterns (pc->n_prefix_pats, pc->prefix_pats);
+    ddsrt_free (pc->name);
+    ddsrt_free (pc);
+    return NULL;
+  }
+
+  ddsrt_mutex_init (&pc->lock);
+  ddsrt_cond_init (&pc->cond);
+  pc->scratch = ddsrt_malloc (65536);
+  if (config->pcap_buffer_size > 0)
+  {
+    uint32_t size = PCAP_RING_MIN_SIZE;
+    while (size < config->pcap_buffer_size)
+      size *= 2;
+    pc->ring_size = size;
+    pc->ring = ddsrt_malloc (size);
+    memset (pc->ring, 0, size);
+    ddsrt_atomic_st32 (&pc->ring_head, 0);
+    ddsrt_atomic_st32 (&pc->ring_tail, 0);
+    ddsrt_atomic_st32 (&pc->dropped, 0);
+    ddsrt_atomic_st32 (&pc->signalled, 0);
+    pc->tdropped_reported = ddsrt_time_monotonic ();
+    if (create_thread (&pc->ts, gv, "pcap", pcap_writer_thread, pc) != DDS_RETCODE_OK)
+    {
+      GVWARNING ("packet capture: failed to create writer thread, writing synchronously\n");
+      ddsrt_free (pc->ring);
+      pc->ring = NULL;
+      pc->ts = NULL;
+    }
+  }
+  return pc;
+}
+
+void free_pcap_capture (struct pcap_capture *pc)
+{
+  if (pc->ts)
+  {
+    ddsrt_mutex_lock (&pc->lock);
+    pc->stop = true;
+    ddsrt_cond_signal (&pc->cond);
+    ddsrt_mutex_unlock (&pc->lock);
+    join_thread (pc->ts);
   }
+  if (pc->fp)
+    fclose (pc->fp);
+  ddsrt_free (pc->ring);
+  ddsrt_free (pc->scratch);
+  ddsrt_cond_destroy (&pc->cond);
+  ddsrt_mutex_destroy (&pc->lock);
+  free_patterns (pc->n_topic_pats, pc->topic_pats);
+  free_patterns (pc->n_prefix_pats, pc->prefix_pats);
+  ddsrt_free (pc->name);
+  ddsrt_free (pc);
 }
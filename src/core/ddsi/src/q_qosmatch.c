@@ -12,6 +12,9 @@
 #include <string.h>
 #include <assert.h>
 
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/hopscotch.h"
+#include "dds/ddsrt/sync.h"
 #include "dds/ddsi/ddsi_xqos.h"
 #include "dds/ddsi/ddsi_typeid.h"
 #include "dds/ddsi/ddsi_typelookup.h"
@@ -109,35 +112,18 @@ static bool check_endpoint_typeid (struct ddsi_domaingv *gv, const type_identifi
 
 #endif /* DDS_HAS_TYPE_DISCOVERY */
 
-bool qos_match_mask_p (
-    struct ddsi_domaingv *gv,
-    const dds_qos_t *rd_qos,
-    const dds_qos_t *wr_qos,
-    uint64_t mask,
-    dds_qos_policy_id_t *reason
-#ifdef DDS_HAS_TYPE_DISCOVERY
-    , const type_identifier_t *rd_typeid
-    , const type_identifier_t *wr_typeid
-    , bool *rd_typeid_req_lookup
-    , bool *wr_typeid_req_lookup
-#endif
-)
+static bool qos_match_names_p (const dds_qos_t *rd_qos, const dds_qos_t *wr_qos, uint64_t mask)
 {
-  DDSRT_UNUSED_ARG (gv);
-#ifndef NDEBUG
-  unsigned musthave = (QP_RXO_MASK | QP_PARTITION | QP_TOPIC_NAME | QP_TYPE_NAME) & mask;
-  assert ((rd_qos->present & musthave) == musthave);
-  assert ((wr_qos->present & musthave) == musthave);
-#endif
-
-  mask &= rd_qos->present & wr_qos->present;
-  *reason = DDS_INVALID_QOS_POLICY_ID;
   if ((mask & QP_TOPIC_NAME) && strcmp (rd_qos->topic_name, wr_qos->topic_name) != 0)
     return false;
   if ((mask & QP_TYPE_NAME) && strcmp (rd_qos->type_name, wr_qos->type_name) != 0)
     return false;
+  return true;
+}
 
 #ifdef DDS_HAS_TYPE_DISCOVERY
+static bool qos_match_types_p (struct ddsi_domaingv *gv, const dds_qos_t *rd_qos, const type_identifier_t *rd_typeid, const type_identifier_t *wr_typeid, bool *rd_typeid_req_lookup, bool *wr_typeid_req_lookup, dds_qos_policy_id_t *reason)
+{
   if (rd_typeid_req_lookup != NULL)
     *rd_typeid_req_lookup = false;
   if (wr_typeid_req_lookup != NULL)
@@ -167,63 +153,302 @@ bool qos_match_mask_p (
       return false;
     }
   }
+  return true;
+}
+#endif
+
+/* returns DDS_INVALID_QOS_POLICY_ID if the request-offered QoS and partitions match */
+static dds_qos_policy_id_t qos_match_rxo (const dds_qos_t *rd_qos, const dds_qos_t *wr_qos, uint64_t mask)
+{
+  if ((mask & QP_RELIABILITY) && rd_qos->reliability.kind > wr_qos->reliability.kind)
+    return DDS_RELIABILITY_QOS_POLICY_ID;
+  if ((mask & QP_DURABILITY) && rd_qos->durability.kind > wr_qos->durability.kind)
+    return DDS_DURABILITY_QOS_POLICY_ID;
+  if ((mask & QP_PRESENTATION) && rd_qos->presentation.access_scope > wr_qos->presentation.access_scope)
+    return DDS_PRESENTATION_QOS_POLICY_ID;
+  if ((mask & QP_PRESENTATION) && rd_qos->presentation.coherent_access > wr_qos->presentation.coherent_access)
+    return DDS_PRESENTATION_QOS_POLICY_ID;
+  if ((mask & QP_PRESENTATION) && rd_qos->presentation.ordered_access > wr_qos->presentation.ordered_access)
+    return DDS_PRESENTATION_QOS_POLICY_ID;
+  if ((mask & QP_DEADLINE) && rd_qos->deadline.deadline < wr_qos->deadline.deadline)
+    return DDS_DEADLINE_QOS_POLICY_ID;
+  if ((mask & QP_LATENCY_BUDGET) && rd_qos->latency_budget.duration < wr_qos->latency_budget.duration)
+    return DDS_LATENCYBUDGET_QOS_POLICY_ID;
+  if ((mask & QP_OWNERSHIP) && rd_qos->ownership.kind != wr_qos->ownership.kind)
+    return DDS_OWNERSHIP_QOS_POLICY_ID;
+  if ((mask & QP_LIVELINESS) && rd_qos->liveliness.kind > wr_qos->liveliness.kind)
+    return DDS_LIVELINESS_QOS_POLICY_ID;
+  if ((mask & QP_LIVELINESS) && rd_qos->liveliness.lease_duration < wr_qos->liveliness.lease_duration)
+    return DDS_LIVELINESS_QOS_POLICY_ID;
+  if ((mask & QP_DESTINATION_ORDER) && rd_qos->destination_order.kind > wr_qos->destination_order.kind)
+    return DDS_DESTINATIONORDER_QOS_POLICY_ID;
+  if ((mask & QP_PARTITION) && !partitions_match_p (rd_qos, wr_qos))
+    return DDS_PARTITION_QOS_POLICY_ID;
+  return DDS_INVALID_QOS_POLICY_ID;
+}
+
+bool qos_match_mask_p (
+    struct ddsi_domaingv *gv,
+    const dds_qos_t *rd_qos,
+    const dds_qos_t *wr_qos,
+    uint64_t mask,
+    dds_qos_policy_id_t *reason
+#ifdef DDS_HAS_TYPE_DISCOVERY
+    , const type_identifier_t *rd_typeid
+    , const type_identifier_t *wr_typeid
+    , bool *rd_typeid_req_lookup
+    , bool *wr_typeid_req_lookup
+#endif
+)
+{
+  DDSRT_UNUSED_ARG (gv);
+#ifndef NDEBUG
+  unsigned musthave = (QP_RXO_MASK | QP_PARTITION | QP_TOPIC_NAME | QP_TYPE_NAME) & mask;
+  assert ((rd_qos->present & musthave) == musthave);
+  assert ((wr_qos->present & musthave) == musthave);
 #endif
 
-  if ((mask & QP_RELIABILITY) && rd_qos->reliability.kind > wr_qos->reliability.kind) {
-    *reason = DDS_RELIABILITY_QOS_POLICY_ID;
+  mask &= rd_qos->present & wr_qos->present;
+  *reason = DDS_INVALID_QOS_POLICY_ID;
+  if (!qos_match_names_p (rd_qos, wr_qos, mask))
     return false;
-  }
-  if ((mask & QP_DURABILITY) && rd_qos->durability.kind > wr_qos->durability.kind) {
-    *reason = DDS_DURABILITY_QOS_POLICY_ID;
+#ifdef DDS_HAS_TYPE_DISCOVERY
+  if (!qos_match_types_p (gv, rd_qos, rd_typeid, wr_typeid, rd_typeid_req_lookup, wr_typeid_req_lookup, reason))
     return false;
-  }
-  if ((mask & QP_PRESENTATION) && rd_qos->presentation.access_scope > wr_qos->presentation.access_scope) {
-    *reason = DDS_PRESENTATION_QOS_POLICY_ID;
+#endif
+  if ((*reason = qos_match_rxo (rd_qos, wr_qos, mask)) != DDS_INVALID_QOS_POLICY_ID)
     return false;
+  return true;
+}
+
+bool qos_match_p (
+    struct ddsi_domaingv *gv,
+    const dds_qos_t *rd_qos,
+    const dds_qos_t *wr_qos,
+    dds_qos_policy_id_t *reason
+#ifdef DDS_HAS_TYPE_DISCOVERY
+    , const type_identifier_t *rd_typeid
+    , const type_identifier_t *wr_typeid
+    , bool *rd_typeid_req_lookup
+    , bool *wr_typeid_req_lookup
+#endif
+)
+{
+  dds_qos_policy_id_t dummy;
+#ifdef DDS_HAS_TYPE_DISCOVERY
+  return qos_match_mask_p (gv, rd_qos, wr_qos, ~(uint64_t)0, reason ? reason : &dummy, rd_typeid, wr_typeid, rd_typeid_req_lookup, wr_typeid_req_lookup);
+#else
+  return qos_match_mask_p (gv, rd_qos, wr_qos, ~(uint64_t)0, reason ? reason : &dummy);
+#endif
+}
+
+/* QoS matching cache
+
+   The QoS relevant to matching can't be changed after creating an endpoint, and in
+   practice there are only a handful of distinct combinations in a system, so caching the
+   outcome of matching for pairs of fingerprints of these QoS saves evaluating the
+   request-offered and (potentially wildcard) partition matching for every candidate
+   during discovery.  Type assignability is not cached because whether it can be decided
+   depends on the availability of type information.
+
+   The fingerprints are only used to locate an entry: each entry also holds a copy of
+   the QoS it was computed for and a hit only counts if those are equivalent to the ones
+   being matched, so that a fingerprint collision can't cause a wrong outcome. */
+
+#define QOS_MATCH_CACHE_MAX_ENTRIES 4096
+#define QOS_MATCH_CACHE_QOS_MASK (QP_TOPIC_NAME | QP_TYPE_NAME | QP_RXO_MASK | QP_PARTITION)
+
+struct qos_match_cache_entry {
+  uint64_t rd_fp, wr_fp;
+  dds_qos_t *rd_qos, *wr_qos;
+  bool names_match;
+  dds_qos_policy_id_t rxo_reason;
+};
+
+struct qos_match_cache {
+  ddsrt_mutex_t lock;
+  struct ddsrt_ehh *entries;
+  uint32_t nentries;
+  uint64_t hits, misses;
+};
+
+static uint64_t fp_bytes (uint64_t h, const void *data, size_t sz)
+{
+  /* FNV-1a */
+  const unsigned char *d = data;
+  for (size_t i = 0; i < sz; i++)
+    h = (h ^ d[i]) * UINT64_C (1099511628211);
+  return h;
+}
+
+static uint64_t fp_u64 (uint64_t h, uint64_t x)
+{
+  return fp_bytes (h, &x, sizeof (x));
+}
+
+static uint64_t fp_str (uint64_t h, const char *str)
+{
+  return fp_bytes (h, str, strlen (str) + 1);
+}
+
+uint64_t qos_match_fingerprint (const dds_qos_t *qos)
+{
+  const uint64_t present = qos->present & (QP_TOPIC_NAME | QP_TYPE_NAME | QP_RXO_MASK | QP_PARTITION);
+  uint64_t h = fp_u64 (UINT64_C (14695981039346656037), present);
+  if (present & QP_TOPIC_NAME)
+    h = fp_str (h, qos->topic_name);
+  if (present & QP_TYPE_NAME)
+    h = fp_str (h, qos->type_name);
+  if (present & QP_RELIABILITY)
+    h = fp_u64 (h, (uint64_t) qos->reliability.kind);
+  if (present & QP_DURABILITY)
+    h = fp_u64 (h, (uint64_t) qos->durability.kind);
+  if (present & QP_PRESENTATION)
+  {
+    h = fp_u64 (h, (uint64_t) qos->presentation.access_scope);
+    h = fp_u64 (h, (uint64_t) qos->presentation.coherent_access);
+    h = fp_u64 (h, (uint64_t) qos->presentation.ordered_access);
   }
-  if ((mask & QP_PRESENTATION) && rd_qos->presentation.coherent_access > wr_qos->presentation.coherent_access) {
-    *reason = DDS_PRESENTATION_QOS_POLICY_ID;
-    return false;
+  if (present & QP_DEADLINE)
+    h = fp_u64 (h, (uint64_t) qos->deadline.deadline);
+  if (present & QP_LATENCY_BUDGET)
+    h = fp_u64 (h, (uint64_t) qos->latency_budget.duration);
+  if (present & QP_OWNERSHIP)
+    h = fp_u64 (h, (uint64_t) qos->ownership.kind);
+  if (present & QP_LIVELINESS)
+  {
+    h = fp_u64 (h, (uint64_t) qos->liveliness.kind);
+    h = fp_u64 (h, (uint64_t) qos->liveliness.lease_duration);
   }
-  if ((mask & QP_PRESENTATION) && rd_qos->presentation.ordered_access > wr_qos->presentation.ordered_access) {
-    *reason = DDS_PRESENTATION_QOS_POLICY_ID;
-    return false;
+  if (present & QP_DESTINATION_ORDER)
+    h = fp_u64 (h, (uint64_t) qos->destination_order.kind);
+  if (present & QP_PARTITION)
+  {
+    h = fp_u64 (h, qos->partition.n);
+    for (uint32_t i = 0; i < qos->partition.n; i++)
+      h = fp_str (h, qos->partition.strs[i]);
   }
-  if ((mask & QP_DEADLINE) && rd_qos->deadline.deadline < wr_qos->deadline.deadline) {
-    *reason = DDS_DEADLINE_QOS_POLICY_ID;
+  return h;
+}
+
+static bool qos_match_equiv_p (const dds_qos_t *a, const dds_qos_t *b)
+{
+  /* equivalent for the purposes of qos_match_mask_p, must cover (at least) everything
+     covered by qos_match_fingerprint */
+  const uint64_t present = a->present & QOS_MATCH_CACHE_QOS_MASK;
+  if (present != (b->present & QOS_MATCH_CACHE_QOS_MASK))
     return false;
-  }
-  if ((mask & QP_LATENCY_BUDGET) && rd_qos->latency_budget.duration < wr_qos->latency_budget.duration) {
-    *reason = DDS_LATENCYBUDGET_QOS_POLICY_ID;
+  if ((present & QP_TOPIC_NAME) && strcmp (a->topic_name, b->topic_name) != 0)
     return false;
-  }
-  if ((mask & QP_OWNERSHIP) && rd_qos->ownership.kind != wr_qos->ownership.kind) {
-    *reason = DDS_OWNERSHIP_QOS_POLICY_ID;
+  if ((present & QP_TYPE_NAME) && strcmp (a->type_name, b->type_name) != 0)
     return false;
-  }
-  if ((mask & QP_LIVELINESS) && rd_qos->liveliness.kind > wr_qos->liveliness.kind) {
-    *reason = DDS_LIVELINESS_QOS_POLICY_ID;
+  if ((present & QP_RELIABILITY) && a->reliability.kind != b->reliability.kind)
     return false;
-  }
-  if ((mask & QP_LIVELINESS) && rd_qos->liveliness.lease_duration < wr_qos->liveliness.lease_duration) {
-    *reason = DDS_LIVELINESS_QOS_POLICY_ID;
+  if ((present & QP_DURABILITY) && a->durability.kind != b->durability.kind)
     return false;
-  }
-  if ((mask & QP_DESTINATION_ORDER) && rd_qos->destination_order.kind > wr_qos->destination_order.kind) {
-    *reason = DDS_DESTINATIONORDER_QOS_POLICY_ID;
+  if ((present & QP_PRESENTATION) &&
+      (a->presentation.access_scope != b->presentation.access_scope ||
+       a->presentation.coherent_access != b->presentation.coherent_access ||
+       a->presentation.ordered_access != b->presentation.ordered_access))
     return false;
-  }
-  if ((mask & QP_PARTITION) && !partitions_match_p (rd_qos, wr_qos)) {
-    *reason = DDS_PARTITION_QOS_POLICY_ID;
+  if ((present & QP_DEADLINE) && a->deadline.deadline != b->deadline.deadline)
     return false;
+  if ((present & QP_LATENCY_BUDGET) && a->latency_budget.duration != b->latency_budget.duration)
+    return false;
+  if ((present & QP_OWNERSHIP) && a->ownership.kind != b->ownership.kind)
+    return false;
+  if ((present & QP_LIVELINESS) &&
+      (a->liveliness.kind != b->liveliness.kind || a->liveliness.lease_duration != b->liveliness.lease_duration))
+    return false;
+  if ((present & QP_DESTINATION_ORDER) && a->destination_order.kind != b->destination_order.kind)
+    return false;
+  if (present & QP_PARTITION)
+  {
+    if (a->partition.n != b->partition.n)
+      return false;
+    for (uint32_t i = 0; i < a->partition.n; i++)
+      if (strcmp (a->partition.strs[i], b->partition.strs[i]) != 0)
+        return false;
   }
   return true;
 }
 
-bool qos_match_p (
+static dds_qos_t *qos_match_cache_dup_qos (const dds_qos_t *qos)
+{
+  dds_qos_t *dup = ddsrt_malloc (sizeof (*dup));
+  ddsi_xqos_init_empty (dup);
+  ddsi_xqos_mergein_missing (dup, qos, QOS_MATCH_CACHE_QOS_MASK);
+  return dup;
+}
+
+static void qos_match_cache_free_qos (dds_qos_t *qos)
+{
+  ddsi_xqos_fini (qos);
+  ddsrt_free (qos);
+}
+
+static void qos_match_cache_entry_fini (void *vent, void *varg)
+{
+  struct qos_match_cache_entry *ent = vent;
+  DDSRT_UNUSED_ARG (varg);
+  qos_match_cache_free_qos (ent->rd_qos);
+  qos_match_cache_free_qos (ent->wr_qos);
+}
+
+static uint32_t qos_match_cache_entry_hash (const void *vx)
+{
+  const struct qos_match_cache_entry *x = vx;
+  const uint64_t h = x->rd_fp ^ (x->wr_fp * UINT64_C (16292676669999574021));
+  return (uint32_t) (h >> 32);
+}
+
+static int qos_match_cache_entry_eq (const void *va, const void *vb)
+{
+  const struct qos_match_cache_entry *a = va;
+  const struct qos_match_cache_entry *b = vb;
+  return a->rd_fp == b->rd_fp && a->wr_fp == b->wr_fp;
+}
+
+static void qos_match_cache_clear (struct qos_match_cache *qmc)
+{
+  ddsrt_ehh_enum (qmc->entries, qos_match_cache_entry_fini, NULL);
+  ddsrt_ehh_free (qmc->entries);
+  qmc->entries = ddsrt_ehh_new (sizeof (struct qos_match_cache_entry), 32, qos_match_cache_entry_hash, qos_match_cache_entry_eq);
+  qmc->nentries = 0;
+}
+
+struct qos_match_cache *qos_match_cache_new (void)
+{
+  struct qos_match_cache *qmc = ddsrt_malloc (sizeof (*qmc));
+  ddsrt_mutex_init (&qmc->lock);
+  qmc->entries = ddsrt_ehh_new (sizeof (struct qos_match_cache_entry), 32, qos_match_cache_entry_hash, qos_match_cache_entry_eq);
+  qmc->nentries = 0;
+  qmc->hits = qmc->misses = 0;
+  return qmc;
+}
+
+void qos_match_cache_free (struct qos_match_cache *qmc)
+{
+  ddsrt_ehh_enum (qmc->entries, qos_match_cache_entry_fini, NULL);
+  ddsrt_ehh_free (qmc->entries);
+  ddsrt_mutex_destroy (&qmc->lock);
+  ddsrt_free (qmc);
+}
+
+void qos_match_cache_get_stats (struct qos_match_cache *qmc, uint64_t * __restrict hits, uint64_t * __restrict misses)
+{
+  ddsrt_mutex_lock (&qmc->lock);
+  *hits = qmc->hits;
+  *misses = qmc->misses;
+  ddsrt_mutex_unlock (&qmc->lock);
+}
+
+bool qos_match_cached_p (
     struct ddsi_domaingv *gv,
     const dds_qos_t *rd_qos,
+    uint64_t rd_fp,
     const dds_qos_t *wr_qos,
+    uint64_t wr_fp,
     dds_qos_policy_id_t *reason
 #ifdef DDS_HAS_TYPE_DISCOVERY
     , const type_identifier_t *rd_typeid
@@ -233,10 +458,66 @@ bool qos_match_p (
 #endif
 )
 {
-  dds_qos_policy_id_t dummy;
+  struct qos_match_cache * const qmc = gv->qos_match_cache;
+  const uint64_t mask = rd_qos->present & wr_qos->present;
+  struct qos_match_cache_entry template = { .rd_fp = rd_fp, .wr_fp = wr_fp }, *ent;
+  bool names_match;
+  dds_qos_policy_id_t rxo_reason;
+
+  ddsrt_mutex_lock (&qmc->lock);
+  if ((ent = ddsrt_ehh_lookup (qmc->entries, &template)) != NULL &&
+      qos_match_equiv_p (ent->rd_qos, rd_qos) && qos_match_equiv_p (ent->wr_qos, wr_qos))
+  {
+    names_match = ent->names_match;
+    rxo_reason = ent->rxo_reason;
+    qmc->hits++;
+    ddsrt_mutex_unlock (&qmc->lock);
+    assert (names_match == qos_match_names_p (rd_qos, wr_qos, mask));
+    assert (rxo_reason == qos_match_rxo (rd_qos, wr_qos, mask));
+  }
+  else
+  {
+    qmc->misses++;
+    ddsrt_mutex_unlock (&qmc->lock);
+    names_match = qos_match_names_p (rd_qos, wr_qos, mask);
+    rxo_reason = qos_match_rxo (rd_qos, wr_qos, mask);
+    dds_qos_t * const rd_dup = qos_match_cache_dup_qos (rd_qos);
+    dds_qos_t * const wr_dup = qos_match_cache_dup_qos (wr_qos);
+    ddsrt_mutex_lock (&qmc->lock);
+    if ((ent = ddsrt_ehh_lookup (qmc->entries, &template)) != NULL)
+    {
+      /* either added concurrently or a fingerprint collision: in both cases replacing
+         the existing entry is fine */
+      qos_match_cache_free_qos (ent->rd_qos);
+      qos_match_cache_free_qos (ent->wr_qos);
+    }
+    else
+    {
+      if (qmc->nentries >= QOS_MATCH_CACHE_MAX_ENTRIES)
+      {
+        /* something weird is going on if there are this many combinations, simply
+           starting over is good enough */
+        qos_match_cache_clear (qmc);
+      }
+      (void) ddsrt_ehh_add (qmc->entries, &template);
+      ent = ddsrt_ehh_lookup (qmc->entries, &template);
+      qmc->nentries++;
+    }
+    ent->rd_qos = rd_dup;
+    ent->wr_qos = wr_dup;
+    ent->names_match = names_match;
+    ent->rxo_reason = rxo_reason;
+    ddsrt_mutex_unlock (&qmc->lock);
+  }
+
+  *reason = DDS_INVALID_QOS_POLICY_ID;
+  if (!names_match)
+    return false;
 #ifdef DDS_HAS_TYPE_DISCOVERY
-  return qos_match_mask_p (gv, rd_qos, wr_qos, ~(uint64_t)0, reason ? reason : &dummy, rd_typeid, wr_typeid, rd_typeid_req_lookup, wr_typeid_req_lookup);
-#else
-  return qos_match_mask_p (gv, rd_qos, wr_qos, ~(uint64_t)0, reason ? reason : &dummy);
+  if (!qos_match_types_p (gv, rd_qos, rd_typeid, wr_typeid, rd_typeid_req_lookup, wr_typeid_req_lookup, reason))
+    return false;
 #endif
+  if ((*reason = rxo_reason) != DDS_INVALID_QOS_POLICY_ID)
+    return false;
+  return true;
 }
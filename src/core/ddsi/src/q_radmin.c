@@ -419,6 +419,19 @@ struct nn_rbuf {
      approach.  Changes would be confined rmsg_new and rmsg_free. */
   unsigned char *freeptr;
 
+  /* Batch of rmsgs allocated by nn_rmsg_new_batch that have not all
+     been committed yet: [freeptr at the time, batch_endp) is reserved
+     for them and freeptr is set to batch_endp, so anything else
+     allocated in the meantime goes after the batch.  Committing keeps
+     track of the end of the last rmsg in the batch that must be kept
+     (batch_keepp), and once the last one has been committed, freeptr
+     is rolled back to batch_keepp if nothing was allocated beyond the
+     batch.  While a batch is pending, it holds a reference to the
+     rbuf. */
+  uint32_t batch_pending;
+  unsigned char *batch_endp;
+  unsigned char *batch_keepp;
+
   /* to ensure reasonable alignment of raw[] */
   union {
     int64_t l;
@@ -446,6 +459,8 @@ static struct nn_rbuf *nn_rbuf_alloc_new (struct nn_rbufpool *rbp)
   rb->size = rbp->rbuf_size;
   rb->max_rmsg_size = rbp->max_rmsg_size;
   rb->freeptr = rb->raw;
+  rb->batch_pending = 0;
+  rb->batch_endp = rb->batch_keepp = rb->raw;
   rb->trace = rbp->trace;
   RBPTRACE ("rbuf_alloc_new(%p) = %p\n", (void *) rbp, (void *) rb);
   return rb;
@@ -531,6 +546,17 @@ static void init_rmsg_chunk (struct nn_rmsg_chunk *chunk, struct nn_rbuf *rbuf)
   ddsrt_atomic_inc32 (&rbuf->n_live_rmsg_chunks);
 }
 
+static void init_rmsg (struct nn_rbufpool *rbp, struct nn_rmsg *rmsg, bool batch)
+{
+  /* Reference to this rmsg, undone by rmsg_commit(). */
+  ddsrt_atomic_st32 (&rmsg->refcount, RMSG_REFCOUNT_UNCOMMITTED_BIAS);
+  /* Initial chunk */
+  init_rmsg_chunk (&rmsg->chunk, rbp->current);
+  rmsg->trace = rbp->trace;
+  rmsg->batch = batch;
+  rmsg->lastchunk = &rmsg->chunk;
+}
+
 struct nn_rmsg *nn_rmsg_new (struct nn_rbufpool *rbp)
 {
   /* Note: only one thread calls nn_rmsg_new on a pool */
@@ -541,18 +567,74 @@ struct nn_rmsg *nn_rmsg_new (struct nn_rbufpool *rbp)
   if (rmsg == NULL)
     return NULL;
 
-  /* Reference to this rmsg, undone by rmsg_commit(). */
-  ddsrt_atomic_st32 (&rmsg->refcount, RMSG_REFCOUNT_UNCOMMITTED_BIAS);
-  /* Initial chunk */
-  init_rmsg_chunk (&rmsg->chunk, rbp->current);
-  rmsg->trace = rbp->trace;
-  rmsg->lastchunk = &rmsg->chunk;
+  init_rmsg (rbp, rmsg, false);
   /* Incrementing freeptr happens in commit(), so that discarding the
      message is really simple. */
   RBPTRACE ("rmsg_new(%p) = %p\n", (void *) rbp, (void *) rmsg);
   return rmsg;
 }
 
+/* Allocates up to n rmsgs laid out consecutively in one rbuf so that a
+   batch of packets can be received from the kernel in a single call,
+   returning the number actually allocated (which may be fewer than n if
+   fewer fit in an rbuf).  Each must be committed, whether used or not,
+   before allocating the next batch.  Allocating ordinary rmsgs while
+   the batch is outstanding is allowed. */
+uint32_t nn_rmsg_new_batch (struct nn_rbufpool *rbp, uint32_t n, struct nn_rmsg **rmsgs)
+{
+  /* Note: only one thread calls nn_rmsg_new_batch on a pool */
+  const uint32_t stride = align_rmsg (max_rmsg_size_w_hdr (rbp->max_rmsg_size));
+  const uint32_t nmax = rbp->rbuf_size / stride;
+  struct nn_rbuf *rb;
+  uint32_t navail;
+  RBPTRACE ("rmsg_new_batch(%p, %"PRIu32")\n", (void *) rbp, n);
+  ASSERT_RBUFPOOL_OWNER (rbp);
+  assert (n > 0);
+  rb = rbp->current;
+  assert (rb != NULL);
+  assert (rb->batch_pending == 0);
+  assert (rb->freeptr >= rb->raw);
+  assert (rb->freeptr <= rb->raw + rb->size);
+
+  if (n > nmax)
+    n = nmax;
+  if (n <= 1)
+  {
+    /* can't fit more than one: an ordinary rmsg is just as good */
+    return (rmsgs[0] = nn_rmsg_new (rbp)) != NULL;
+  }
+
+  /* Only switch to a new rbuf if it would allow a deeper batch, there
+     is no point in wasting the remainder of the current one otherwise */
+  navail = (uint32_t) (rb->raw + rb->size - rb->freeptr) / stride;
+  if (navail < n && navail < nmax)
+  {
+    if ((rb = nn_rbuf_new (rbp)) == NULL)
+      return 0;
+    navail = nmax;
+  }
+  if (n > navail)
+    n = navail;
+
+  rb->batch_pending = n;
+  rb->batch_keepp = rb->freeptr;
+  rb->batch_endp = rb->freeptr + n * stride;
+  /* Keep the rbuf alive until the batch is complete */
+  ddsrt_atomic_inc32 (&rb->n_live_rmsg_chunks);
+  for (uint32_t i = 0; i < n; i++)
+  {
+    struct nn_rmsg *rmsg = (struct nn_rmsg *) (rb->freeptr + i * stride);
+#if USE_VALGRIND
+    VALGRIND_MEMPOOL_ALLOC (rbp, rmsg, stride);
+#endif
+    init_rmsg (rbp, rmsg, true);
+    rmsgs[i] = rmsg;
+  }
+  rb->freeptr = rb->batch_endp;
+  RBPTRACE ("rmsg_new_batch(%p) = %"PRIu32" @ %p\n", (void *) rbp, n, (void *) rmsgs[0]);
+  return n;
+}
+
 void nn_rmsg_setsize (struct nn_rmsg *rmsg, uint32_t size)
 {
   uint32_t size8P = align_rmsg (size);
@@ -599,11 +681,31 @@ void nn_rmsg_free (struct nn_rmsg *rmsg)
   }
 }
 
-static void commit_rmsg_chunk (struct nn_rmsg_chunk *chunk)
+static void commit_rmsg_chunk (struct nn_rmsg *rmsg, struct nn_rmsg_chunk *chunk)
 {
   struct nn_rbuf *rbuf = chunk->rbuf;
+  unsigned char * const endp = (unsigned char *) (chunk + 1) + chunk->u.size;
   RBUFTRACE ("commit_rmsg_chunk(%p)\n", (void *) chunk);
-  rbuf->freeptr = (unsigned char *) (chunk + 1) + chunk->u.size;
+  if (!(rmsg->batch && chunk == &rmsg->chunk))
+    rbuf->freeptr = endp;
+  else if (endp > rbuf->batch_keepp)
+  {
+    /* first chunk of a batched rmsg: freeptr is beyond the batch */
+    rbuf->batch_keepp = endp;
+  }
+}
+
+static void nn_rbuf_batch_committed (struct nn_rbuf *rbuf)
+{
+  assert (rbuf->batch_pending > 0);
+  if (--rbuf->batch_pending == 0)
+  {
+    /* Space taken by discarded rmsgs at the end of the batch can be
+       reused if nothing was allocated after the batch */
+    if (rbuf->freeptr == rbuf->batch_endp)
+      rbuf->freeptr = rbuf->batch_keepp;
+    nn_rbuf_release (rbuf);
+  }
 }
 
 void nn_rmsg_commit (struct nn_rmsg *rmsg)
@@ -626,7 +728,10 @@ void nn_rmsg_commit (struct nn_rmsg *rmsg)
   assert (ddsrt_atomic_ld32 (&rmsg->refcount) >= RMSG_REFCOUNT_UNCOMMITTED_BIAS);
   assert (ddsrt_atomic_ld32 (&rmsg->chunk.rbuf->n_live_rmsg_chunks) > 0);
   assert (ddsrt_atomic_ld32 (&chunk->rbuf->n_live_rmsg_chunks) > 0);
-  assert (chunk->rbuf->rbufpool->current == chunk->rbuf);
+  assert (rmsg->batch || chunk->rbuf->rbufpool->current == chunk->rbuf);
+  /* the batch holds a reference to the rbuf containing the first chunk,
+     so it remains valid even if the rmsg gets freed */
+  struct nn_rbuf * const batch_rbuf = rmsg->batch ? rmsg->chunk.rbuf : NULL;
   if (ddsrt_atomic_sub32_nv (&rmsg->refcount, RMSG_REFCOUNT_UNCOMMITTED_BIAS) == 0)
     nn_rmsg_free (rmsg);
   else
@@ -634,8 +739,10 @@ void nn_rmsg_commit (struct nn_rmsg *rmsg)
     /* Other references exist, so either stored in defrag, reorder
        and/or delivery queue */
     RMSGTRACE ("rmsg_commit(%p) => keep\n", (void *) rmsg);
-    commit_rmsg_chunk (chunk);
+    commit_rmsg_chunk (rmsg, chunk);
   }
+  if (batch_rbuf)
+    nn_rbuf_batch_committed (batch_rbuf);
 }
 
 static void nn_rmsg_addbias (struct nn_rmsg *rmsg)
@@ -692,7 +799,7 @@ void *nn_rmsg_alloc (struct nn_rmsg *rmsg, uint32_t size)
     struct nn_rbufpool *rbp = rbuf->rbufpool;
     struct nn_rmsg_chunk *newchunk;
     RMSGTRACE ("rmsg_alloc(%p, %"PRIu32") limit hit - new chunk\n", (void *) rmsg, size);
-    commit_rmsg_chunk (chunk);
+    commit_rmsg_chunk (rmsg, chunk);
     newchunk = nn_rbuf_alloc (rbp);
     if (newchunk == NULL)
     {
@@ -2457,6 +2564,21 @@ void nn_reorder_set_next_seq (struct nn_reorder *reorder, seqno_t seq)
 
 /* DQUEUE -------------------------------------------------------------- */
 
+/* Lock-free mode (Internal/DeliveryQueueLockFree): the queue is a stack of
+   sample chain elements, producers push a chain with a single CAS on "head"
+   and the delivery thread grabs the entire stack at once.  Producers push
+   their chains in reverse, so that reversing the stack restores FIFO order
+   without losing the contiguity of the chains (nn_dqueue_enqueue1 relies on
+   that).  Only taking everything makes it immune to the ABA problem.
+
+   The delivery thread polls "head" for a while before parking on the
+   condition variable.  The polling time adapts: it grows when the thread
+   parks only to be woken up shortly afterward and shrinks when it parks
+   for longer periods.  Producers only need to lock and signal when the
+   delivery thread is parked. */
+#define DQUEUE_SPIN_MIN DDS_USECS (1)
+#define DQUEUE_SPIN_MAX DDS_USECS (50)
+
 struct nn_dqueue {
   ddsrt_mutex_t lock;
   ddsrt_cond_t cond;
@@ -2465,6 +2587,13 @@ struct nn_dqueue {
 
   struct nn_rsample_chain sc;
 
+  bool lockfree;
+  ddsrt_atomic_voidp_t head;
+  ddsrt_atomic_uint32_t parked;
+  dds_duration_t spin_time;
+  ddsrt_atomic_uint64_t wakeups_spun;
+  ddsrt_atomic_uint64_t wakeups_parked;
+
   struct thread_state1 *ts;
   char *name;
   uint32_t max_samples;
@@ -2512,6 +2641,86 @@ static enum dqueue_elem_kind dqueue_elem_kind (const struct nn_rsample_chain_ele
     return DQEK_BUBBLE;
 }
 
+static struct nn_rsample_chain_elem *dqueue_take_all_lockfree (struct nn_dqueue *q)
+{
+  void *head;
+  do {
+    head = ddsrt_atomic_ldvoidp (&q->head);
+  } while (head != NULL && !ddsrt_atomic_casvoidp (&q->head, head, NULL));
+  return head;
+}
+
+static void dqueue_wait_lockfree (struct nn_dqueue *q, struct nn_rsample_chain *sc)
+{
+  struct nn_rsample_chain_elem *stack;
+
+  if (ddsrt_atomic_ldvoidp (&q->head) == NULL)
+  {
+    const ddsrt_mtime_t tspin = ddsrt_time_monotonic ();
+    const ddsrt_mtime_t tspinend = ddsrt_mtime_add_duration (tspin, q->spin_time);
+    bool found = false;
+    uint32_t i = 0;
+    while (!(found = (ddsrt_atomic_ldvoidp (&q->head) != NULL)))
+    {
+      if ((++i % 64) == 0 && ddsrt_time_monotonic ().v >= tspinend.v)
+        break;
+    }
+    if (found)
+      ddsrt_atomic_inc64 (&q->wakeups_spun);
+    else
+    {
+      /* Setting "parked" and then checking "head" (and the reverse in the
+         producers) guarantees that either we see the new data, or the
+         producer sees we're parked and signals the condition variable.
+         Holding the lock from before setting "parked" ensures that signal
+         can't get lost. */
+      ddsrt_mutex_lock (&q->lock);
+      ddsrt_atomic_st32 (&q->parked, 1);
+      ddsrt_atomic_fence ();
+      while (ddsrt_atomic_ldvoidp (&q->head) == NULL)
+        ddsrt_cond_wait (&q->cond, &q->lock);
+      ddsrt_atomic_st32 (&q->parked, 0);
+      ddsrt_mutex_unlock (&q->lock);
+      ddsrt_atomic_inc64 (&q->wakeups_parked);
+
+      /* Data arriving shortly after parking means polling a bit longer would
+         have been better; if it took a long time, polling was a waste */
+      const dds_duration_t tparked = ddsrt_time_monotonic ().v - tspin.v;
+      if (tparked < DQUEUE_SPIN_MAX)
+        q->spin_time = (2 * q->spin_time + DQUEUE_SPIN_MIN < DQUEUE_SPIN_MAX) ? 2 * q->spin_time + DQUEUE_SPIN_MIN : DQUEUE_SPIN_MAX;
+      else
+        q->spin_time /= 2;
+    }
+  }
+
+  /* Stack has the most recently pushed element on top: reverse it */
+  stack = dqueue_take_all_lockfree (q);
+  assert (stack != NULL);
+  sc->first = NULL;
+  sc->last = stack;
+  while (stack)
+  {
+    struct nn_rsample_chain_elem *next = stack->next;
+    stack->next = sc->first;
+    sc->first = stack;
+    stack = next;
+  }
+}
+
+static void dqueue_wakeup_waiters (struct nn_dqueue *q)
+{
+  if (!q->lockfree)
+    ddsrt_cond_broadcast (&q->cond);
+  else
+  {
+    /* nn_dqueue_wait_until_empty_if_full checks the sample count with the
+       lock held, so the lock is needed to avoid a lost wakeup */
+    ddsrt_mutex_lock (&q->lock);
+    ddsrt_cond_broadcast (&q->cond);
+    ddsrt_mutex_unlock (&q->lock);
+  }
+}
+
 static uint32_t dqueue_thread (struct nn_dqueue *q)
 {
   struct thread_state1 * const ts1 = lookup_thread_state ();
@@ -2523,18 +2732,23 @@ static uint32_t dqueue_thread (struct nn_dqueue *q)
   ddsi_guid_t rdguid, *prdguid = NULL;
   uint32_t rdguid_count = 0;
 
-  ddsrt_mutex_lock (&q->lock);
   while (keepgoing)
   {
     struct nn_rsample_chain sc;
 
     LOG_THREAD_CPUTIME (&gv->logconfig, next_thread_cputime);
 
-    if (q->sc.first == NULL)
-      ddsrt_cond_wait (&q->cond, &q->lock);
-    sc = q->sc;
-    q->sc.first = q->sc.last = NULL;
-    ddsrt_mutex_unlock (&q->lock);
+    if (q->lockfree)
+      dqueue_wait_lockfree (q, &sc);
+    else
+    {
+      ddsrt_mutex_lock (&q->lock);
+      if (q->sc.first == NULL)
+        ddsrt_cond_wait (&q->cond, &q->lock);
+      sc = q->sc;
+      q->sc.first = q->sc.last = NULL;
+      ddsrt_mutex_unlock (&q->lock);
+    }
 
     thread_state_awake_fixed_domain (ts1);
     while (sc.first)
@@ -2543,7 +2757,7 @@ static uint32_t dqueue_thread (struct nn_dqueue *q)
       int ret;
       sc.first = e->next;
       if (ddsrt_atomic_dec32_ov (&q->nof_samples) == 1) {
-        ddsrt_cond_broadcast (&q->cond);
+        dqueue_wakeup_waiters (q);
       }
       thread_state_awake_to_awake_no_nest (ts1);
       switch (dqueue_elem_kind (e))
@@ -2598,9 +2812,7 @@ static uint32_t dqueue_thread (struct nn_dqueue *q)
     }
 
     thread_state_asleep (ts1);
-    ddsrt_mutex_lock (&q->lock);
   }
-  ddsrt_mutex_unlock (&q->lock);
   return 0;
 }
 
@@ -2620,6 +2832,13 @@ struct nn_dqueue *nn_dqueue_new (const char *name, const struct ddsi_domaingv *g
   q->handler_arg = arg;
   q->sc.first = q->sc.last = NULL;
 
+  q->lockfree = (gv->config.delivery_queue_lockfree != 0);
+  ddsrt_atomic_stvoidp (&q->head, NULL);
+  ddsrt_atomic_st32 (&q->parked, 0);
+  q->spin_time = 0;
+  ddsrt_atomic_st64 (&q->wakeups_spun, 0);
+  ddsrt_atomic_st64 (&q->wakeups_parked, 0);
+
   ddsrt_mutex_init (&q->lock);
   ddsrt_cond_init (&q->cond);
 
@@ -2661,17 +2880,58 @@ static int nn_dqueue_enqueue_locked (struct nn_dqueue *q, struct nn_rsample_chai
   return must_signal;
 }
 
-bool nn_dqueue_enqueue_deferred_wakeup (struct nn_dqueue *q, struct nn_rsample_chain *sc, nn_reorder_result_t rres)
+static bool nn_dqueue_push_lockfree (struct nn_dqueue *q, struct nn_rsample_chain *sc)
 {
+  /* Reverse the chain while it is still private, then push it.  The CAS is
+     a full barrier, so the delivery thread sees the links once it sees the
+     head, and the check of "parked" can't be done before the push. */
+  struct nn_rsample_chain_elem *top = NULL, *e = sc->first, *bottom = sc->first;
+  void *head;
+  while (e)
+  {
+    struct nn_rsample_chain_elem *next = e->next;
+    e->next = top;
+    top = e;
+    e = next;
+  }
+  do {
+    head = ddsrt_atomic_ldvoidp (&q->head);
+    bottom->next = head;
+  } while (!ddsrt_atomic_casvoidp (&q->head, head, top));
+  return ddsrt_atomic_ld32 (&q->parked) != 0;
+}
+
+static bool nn_dqueue_enqueue_chain (struct nn_dqueue *q, struct nn_rsample_chain *sc, uint32_t nsamples, bool wakeup)
+{
+  /* returns true if the delivery thread needs to be signalled, signalling it if "wakeup" is set */
   bool signal;
+  if (q->lockfree)
+  {
+    ddsrt_atomic_add32 (&q->nof_samples, nsamples);
+    if ((signal = nn_dqueue_push_lockfree (q, sc)) && wakeup)
+    {
+      ddsrt_mutex_lock (&q->lock);
+      ddsrt_cond_broadcast (&q->cond);
+      ddsrt_mutex_unlock (&q->lock);
+    }
+  }
+  else
+  {
+    ddsrt_mutex_lock (&q->lock);
+    ddsrt_atomic_add32 (&q->nof_samples, nsamples);
+    if ((signal = nn_dqueue_enqueue_locked (q, sc)) && wakeup)
+      ddsrt_cond_broadcast (&q->cond);
+    ddsrt_mutex_unlock (&q->lock);
+  }
+  return signal;
+}
+
+bool nn_dqueue_enqueue_deferred_wakeup (struct nn_dqueue *q, struct nn_rsample_chain *sc, nn_reorder_result_t rres)
+{
   assert (rres > 0);
   assert (sc->first);
   assert (sc->last->next == NULL);
-  ddsrt_mutex_lock (&q->lock);
-  ddsrt_atomic_add32 (&q->nof_samples, (uint32_t) rres);
-  signal = nn_dqueue_enqueue_locked (q, sc);
-  ddsrt_mutex_unlock (&q->lock);
-  return signal;
+  return nn_dqueue_enqueue_chain (q, sc, (uint32_t) rres, false);
 }
 
 void dd_dqueue_enqueue_trigger (struct nn_dqueue *q)
@@ -2686,30 +2946,22 @@ void nn_dqueue_enqueue (struct nn_dqueue *q, struct nn_rsample_chain *sc, nn_reo
   assert (rres > 0);
   assert (sc->first);
   assert (sc->last->next == NULL);
-  ddsrt_mutex_lock (&q->lock);
-  ddsrt_atomic_add32 (&q->nof_samples, (uint32_t) rres);
-  if (nn_dqueue_enqueue_locked (q, sc))
-    ddsrt_cond_broadcast (&q->cond);
-  ddsrt_mutex_unlock (&q->lock);
+  (void) nn_dqueue_enqueue_chain (q, sc, (uint32_t) rres, true);
 }
 
-static int nn_dqueue_enqueue_bubble_locked (struct nn_dqueue *q, struct nn_dqueue_bubble *b)
+static void nn_dqueue_init_bubble (struct nn_dqueue_bubble *b)
 {
-  struct nn_rsample_chain sc;
   b->sce.next = NULL;
   b->sce.fragchain = NULL;
   b->sce.sampleinfo = (struct nn_rsample_info *) b;
-  sc.first = sc.last = &b->sce;
-  return nn_dqueue_enqueue_locked (q, &sc);
 }
 
 static void nn_dqueue_enqueue_bubble (struct nn_dqueue *q, struct nn_dqueue_bubble *b)
 {
-  ddsrt_mutex_lock (&q->lock);
-  ddsrt_atomic_inc32 (&q->nof_samples);
-  if (nn_dqueue_enqueue_bubble_locked (q, b))
-    ddsrt_cond_broadcast (&q->cond);
-  ddsrt_mutex_unlock (&q->lock);
+  struct nn_rsample_chain sc;
+  nn_dqueue_init_bubble (b);
+  sc.first = sc.last = &b->sce;
+  (void) nn_dqueue_enqueue_chain (q, &sc, 1, true);
 }
 
 void nn_dqueue_enqueue_callback (struct nn_dqueue *q, nn_dqueue_callback_t cb, void *arg)
@@ -2725,6 +2977,7 @@ void nn_dqueue_enqueue_callback (struct nn_dqueue *q, nn_dqueue_callback_t cb, v
 void nn_dqueue_enqueue1 (struct nn_dqueue *q, const ddsi_guid_t *rdguid, struct nn_rsample_chain *sc, nn_reorder_result_t rres)
 {
   struct nn_dqueue_bubble *b;
+  struct nn_rsample_chain sc1;
 
   b = ddsrt_malloc (sizeof (*b));
   b->kind = NN_DQBK_RDGUID;
@@ -2735,12 +2988,12 @@ void nn_dqueue_enqueue1 (struct nn_dqueue *q, const ddsi_guid_t *rdguid, struct
   assert (rdguid != NULL);
   assert (sc->first);
   assert (sc->last->next == NULL);
-  ddsrt_mutex_lock (&q->lock);
-  ddsrt_atomic_add32 (&q->nof_samples, 1 + (uint32_t) rres);
-  if (nn_dqueue_enqueue_bubble_locked (q, b))
-    ddsrt_cond_broadcast (&q->cond);
-  (void) nn_dqueue_enqueue_locked (q, sc);
-  ddsrt_mutex_unlock (&q->lock);
+  /* the bubble must be immediately followed by the samples it applies to */
+  nn_dqueue_init_bubble (b);
+  b->sce.next = sc->first;
+  sc1.first = &b->sce;
+  sc1.last = sc->last;
+  (void) nn_dqueue_enqueue_chain (q, &sc1, 1 + (uint32_t) rres, true);
 }
 
 int nn_dqueue_is_full (struct nn_dqueue *q)
@@ -2770,6 +3023,12 @@ void nn_dqueue_wait_until_empty_if_full (struct nn_dqueue *q)
   }
 }
 
+void nn_dqueue_get_wakeup_stats (const struct nn_dqueue *q, uint64_t * __restrict spun, uint64_t * __restrict parked)
+{
+  *spun = ddsrt_atomic_ld64 (&q->wakeups_spun);
+  *parked = ddsrt_atomic_ld64 (&q->wakeups_parked);
+}
+
 void nn_dqueue_free (struct nn_dqueue *q)
 {
   /* There must not be any thread enqueueing things anymore at this
@@ -2783,6 +3042,7 @@ void nn_dqueue_free (struct nn_dqueue *q)
 
   join_thread (q->ts);
   assert (q->sc.first == NULL);
+  assert (ddsrt_atomic_ldvoidp (&q->head) == NULL);
   ddsrt_cond_destroy (&q->cond);
   ddsrt_mutex_destroy (&q->lock);
   ddsrt_free (q->name);
@@ -46,6 +46,7 @@
 #include "dds/ddsi/q_receive.h"
 #include "dds/ddsi/ddsi_rhc.h"
 #include "dds/ddsi/ddsi_deliver_locally.h"
+#include "dds/ddsi/ddsi_delivery_pool.h"
 
 #include "dds/ddsi/q_transmit.h"
 #include "dds/ddsi/ddsi_domaingv.h"
@@ -840,8 +841,18 @@ static int handle_AckNack (struct receiver_state *rst, ddsrt_etime_t tnow, const
       rn->seq = wr->seq;
     }
     ddsrt_avl_augment_update (&wr_readers_treedef, rn);
-    n = remove_acked_messages (wr, &whcst, &deferred_free_list);
-    RSTTRACE (" ACK%"PRId64" RM%u", n_ack, n);
+    if (writer_defer_remove_acked_messages (wr))
+    {
+      /* dropping the samples is left to the writer's ack coalescing event, the WHC
+         state therefore doesn't reflect this ACK yet */
+      whc_get_state (wr->whc, &whcst);
+      RSTTRACE (" ACK%"PRId64" DEFER", n_ack);
+    }
+    else
+    {
+      n = remove_acked_messages (wr, &whcst, &deferred_free_list);
+      RSTTRACE (" ACK%"PRId64" RM%u", n_ack, n);
+    }
   }
   else
   {
@@ -1261,6 +1272,11 @@ static int handle_Heartbeat (struct receiver_state *rst, ddsrt_etime_t tnow, str
     assert (res <= 0);
     (void) res;
     nn_fragchain_adjust_refcount (gap, refc_adjust);
+    /* nothing up to lastseq will be delivered to the in-sync readers, so when the
+       delivery pool's late-ack mode acknowledges only stored samples, it must not
+       hold back the acknowledgements either */
+    if (rst->gv->delivery_pool && rst->gv->config.late_ack_mode)
+      ddsrt_atomic_st32 (&pwr->next_deliv_seq_lowword, (uint32_t) (lastseq + 1));
     pwr->have_seen_heartbeat = 1;
   }
 
@@ -2098,6 +2114,63 @@ static dds_return_t remote_on_delivery_failure_fastpath (struct entity_common *s
   return DDS_RETCODE_TRY_AGAIN;
 }
 
+/* In late-ack mode with a delivery pool, a sample may only be acknowledged once it
+   has been stored, which is known once a callback queued behind it has been invoked.
+   A callback is a barrier through all threads of the pool, so instead of queueing one
+   for each sample, a proxy writer has at most one in flight, covering all samples
+   handed to the pool before it was queued.  Samples handed to the pool in the
+   meantime are covered by the next one, queued when the previous one completes. */
+struct deliv_seq_update {
+  struct ddsi_domaingv *gv;
+  struct proxy_writer *pwr;
+  ddsi_guid_t pwr_guid;
+  uint32_t next_deliv_seq_lowword;
+};
+
+static void deliv_seq_update_enqueue (struct ddsi_domaingv *gv, struct proxy_writer *pwr, uint32_t next_deliv_seq_lowword);
+
+static void deliv_seq_update_cb (void *varg)
+{
+  /* The proxy writer may have been deleted (it is only looked up from the entity
+     index, a deleted one is no longer there), and it won't be freed while this
+     thread is awake */
+  struct deliv_seq_update * const upd = varg;
+  struct ddsi_domaingv * const gv = upd->gv;
+  struct proxy_writer * const pwr = entidx_lookup_proxy_writer_guid (gv->entity_index, &upd->pwr_guid);
+  if (pwr == NULL || pwr != upd->pwr)
+  {
+    ddsrt_free (upd);
+    return;
+  }
+
+  /* next_deliv_seq may only move forward: the first heartbeat may have moved it
+     past the samples handed to the pool */
+  const uint32_t lw = upd->next_deliv_seq_lowword;
+  uint32_t old;
+  do {
+    old = ddsrt_atomic_ld32 (&pwr->next_deliv_seq_lowword);
+  } while ((int32_t) (lw - old) > 0 && !ddsrt_atomic_cas32 (&pwr->next_deliv_seq_lowword, old, lw));
+  ddsrt_free (upd);
+
+  /* Clearing the in-flight flag before checking for samples handed to the pool in
+     the meantime guarantees that either this thread or deliver_user_data queues the
+     next one */
+  ddsrt_atomic_st32 (&pwr->deliv_seq_update_inflight, 0);
+  const uint32_t handed = ddsrt_atomic_ld32 (&pwr->pool_handed_seq_lowword);
+  if (handed != lw && ddsrt_atomic_cas32 (&pwr->deliv_seq_update_inflight, 0, 1))
+    deliv_seq_update_enqueue (gv, pwr, handed);
+}
+
+static void deliv_seq_update_enqueue (struct ddsi_domaingv *gv, struct proxy_writer *pwr, uint32_t next_deliv_seq_lowword)
+{
+  struct deliv_seq_update * const upd = ddsrt_malloc (sizeof (*upd));
+  upd->gv = gv;
+  upd->pwr = pwr;
+  upd->pwr_guid = pwr->e.guid;
+  upd->next_deliv_seq_lowword = next_deliv_seq_lowword;
+  ddsi_delivery_pool_enqueue_callback (gv->delivery_pool, deliv_seq_update_cb, upd);
+}
+
 static int deliver_user_data (const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, const ddsi_guid_t *rdguid, int pwr_locked)
 {
   static const struct deliver_locally_ops deliver_locally_ops = {
@@ -2185,12 +2258,24 @@ static int deliver_user_data (const struct nn_rsample_info *sampleinfo, const st
     .statusinfo = statusinfo,
     .tstamp = tstamp
   };
+  /* Synchronous delivery happens with the proxy writer locked and is meant to be quick: only
+     delivery from a delivery queue gets handed off to the pool of delivery threads, if any */
+  struct ddsi_delivery_pool * const pool = pwr_locked ? NULL : gv->delivery_pool;
   if (rdguid)
-    (void) deliver_locally_one (gv, &pwr->e, pwr_locked != 0, rdguid, &wrinfo, &deliver_locally_ops, &sourceinfo);
+    (void) deliver_locally_one (gv, pool, &pwr->e, pwr_locked != 0, rdguid, &wrinfo, &deliver_locally_ops, &sourceinfo);
   else
   {
-    (void) deliver_locally_allinsync (gv, &pwr->e, pwr_locked != 0, &pwr->rdary, &wrinfo, &deliver_locally_ops, &sourceinfo);
-    ddsrt_atomic_st32 (&pwr->next_deliv_seq_lowword, (uint32_t) (sampleinfo->seq + 1));
+    (void) deliver_locally_allinsync (gv, pool, &pwr->e, pwr_locked != 0, &pwr->rdary, &wrinfo, &deliver_locally_ops, &sourceinfo);
+    if (pool == NULL || !gv->config.late_ack_mode)
+      ddsrt_atomic_st32 (&pwr->next_deliv_seq_lowword, (uint32_t) (sampleinfo->seq + 1));
+    else
+    {
+      /* late-ack mode acknowledges samples only once they have been stored */
+      const uint32_t lw = (uint32_t) (sampleinfo->seq + 1);
+      ddsrt_atomic_st32 (&pwr->pool_handed_seq_lowword, lw);
+      if (ddsrt_atomic_ld32 (&pwr->deliv_seq_update_inflight) == 0 && ddsrt_atomic_cas32 (&pwr->deliv_seq_update_inflight, 0, 1))
+        deliv_seq_update_enqueue (gv, pwr, lw);
+    }
   }
 
   ddsi_plist_fini (&qos);
@@ -2479,11 +2564,16 @@ static int handle_SPDP (const struct nn_rsample_info *sampleinfo, struct nn_rdat
   struct nn_rdata *fragchain;
   nn_reorder_result_t rres;
   int refc_adjust = 0;
+  /* same queue as the participant's other built-in writers, so SPDP and SEDP
+     of a participant are processed in order; the reorder admin is that of
+     the queue, so any samples it delivers along with this one belong there */
+  const uint32_t qidx = builtins_dqueue_index_for_prefix (gv, &sampleinfo->rst->src_guid_prefix);
+  struct nn_dqueue * const dqueue = gv->builtins_dqueues[qidx];
   ddsrt_mutex_lock (&gv->spdp_lock);
   rsample = nn_defrag_rsample (gv->spdp_defrag, rdata, sampleinfo);
   fragchain = nn_rsample_fragchain (rsample);
-  if ((rres = nn_reorder_rsample (&sc, gv->spdp_reorder, rsample, &refc_adjust, nn_dqueue_is_full (gv->builtins_dqueue))) > 0)
-    nn_dqueue_enqueue (gv->builtins_dqueue, &sc, rres);
+  if ((rres = nn_reorder_rsample (&sc, gv->spdp_reorders[qidx], rsample, &refc_adjust, nn_dqueue_is_full (dqueue))) > 0)
+    nn_dqueue_enqueue (dqueue, &sc, rres);
   nn_fragchain_adjust_refcount (fragchain, refc_adjust);
   ddsrt_mutex_unlock (&gv->spdp_lock);
   return 0;
@@ -3175,6 +3265,55 @@ malformed:
   return -1;
 }
 
+static bool handle_packet (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const ddsi_guid_prefix_t *guidprefix, struct nn_rbufpool *rbpool, struct nn_rmsg *rmsg, ssize_t sz, const ddsi_locator_t *srcloc)
+{
+  unsigned char *buff = (unsigned char *) NN_RMSG_PAYLOAD (rmsg);
+  Header_t *hdr = (Header_t *) buff;
+
+  if (sz > 0 && !gv->deaf)
+  {
+    nn_rmsg_setsize (rmsg, (uint32_t) sz);
+    assert (thread_is_asleep ());
+
+    if ((size_t)sz < RTPS_MESSAGE_HEADER_SIZE || *(uint32_t *)buff != NN_PROTOCOLID_AS_UINT32)
+    {
+      /* discard packets that are really too small or don't have magic cookie */
+    }
+    else if (hdr->version.major != RTPS_MAJOR || (hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
+    {
+      if ((hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
+        GVTRACE ("HDR(%"PRIx32":%"PRIx32":%"PRIx32" vendor %d.%d) len %lu\n, version mismatch: %d.%d\n",
+                 PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, hdr->version.major, hdr->version.minor);
+      if (DDSI_SC_PEDANTIC_P (gv->config))
+        malformed_packet_received_nosubmsg (gv, buff, sz, "header", hdr->vendorid);
+    }
+    else
+    {
+      hdr->guid_prefix = nn_ntoh_guid_prefix (hdr->guid_prefix);
+
+      if (gv->logconfig.c.mask & DDS_LC_TRACE)
+      {
+        char addrstr[DDSI_LOCSTRLEN];
+        ddsi_locator_to_string(addrstr, sizeof(addrstr), srcloc);
+        GVTRACE ("HDR(%"PRIx32":%"PRIx32":%"PRIx32" vendor %d.%d) len %lu from %s\n",
+                 PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, addrstr);
+      }
+      nn_rtps_msg_state_t res = decode_rtps_message (ts1, gv, &rmsg, &hdr, &buff, &sz, rbpool, conn->m_stream);
+      if (res != NN_RTPS_MSG_STATE_ERROR)
+      {
+        handle_submsg_sequence (ts1, gv, conn, srcloc, ddsrt_time_wallclock (), ddsrt_time_elapsed (), &hdr->guid_prefix, guidprefix, buff, (size_t) sz, buff + RTPS_MESSAGE_HEADER_SIZE, rmsg, res == NN_RTPS_MSG_STATE_ENCODED);
+      }
+      else
+      {
+        /* drop message */
+        sz = 1;
+      }
+    }
+  }
+  nn_rmsg_commit (rmsg);
+  return (sz > 0);
+}
+
 static bool do_packet (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const ddsi_guid_prefix_t *guidprefix, struct nn_rbufpool *rbpool)
 {
   /* UDP max packet size is 64kB */
@@ -3260,48 +3399,53 @@ static bool do_packet (struct thread_state1 * const ts1, struct ddsi_domaingv *g
     sz = ddsi_conn_read (conn, buff, buff_len, true, &srcloc);
   }
 
-  if (sz > 0 && !gv->deaf)
+  return handle_packet (ts1, gv, conn, guidprefix, rbpool, rmsg, sz, &srcloc);
+}
+
+static bool do_packet_batch (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const ddsi_guid_prefix_t *guidprefix, struct recv_thread_arg *recv_thread_arg)
+{
+  /* Batched equivalent of do_packet for datagram transports that support it: allocates a
+     number of rmsgs in one go, receives as many packets as are available (up to that number)
+     in a single call and then processes them in order */
+  const size_t maxsz = gv->config.rmsg_chunk_size < 65536 ? gv->config.rmsg_chunk_size : 65536;
+  struct nn_rbufpool * const rbpool = recv_thread_arg->rbpool;
+  struct nn_rmsg *rmsgs[DDSI_MAX_READ_BATCH];
+  unsigned char *bufs[DDSI_MAX_READ_BATCH];
+  size_t szs[DDSI_MAX_READ_BATCH];
+  ddsi_locator_t srclocs[DDSI_MAX_READ_BATCH];
+  uint32_t n;
+  int nrcvd;
+
+  assert (!conn->m_stream && conn->m_read_batch_fn != NULL);
+  n = gv->config.recv_batch_size < DDSI_MAX_READ_BATCH ? gv->config.recv_batch_size : DDSI_MAX_READ_BATCH;
+  if ((n = nn_rmsg_new_batch (rbpool, n, rmsgs)) == 0)
+    return false;
+  for (uint32_t i = 0; i < n; i++)
+    bufs[i] = (unsigned char *) NN_RMSG_PAYLOAD (rmsgs[i]);
+
+  nrcvd = ddsi_conn_read_batch (conn, n, bufs, maxsz, szs, srclocs);
+  if (nrcvd > 0)
   {
-    nn_rmsg_setsize (rmsg, (uint32_t) sz);
-    assert (thread_is_asleep ());
+    ddsrt_atomic_inc64 (&recv_thread_arg->rdbatch_count);
+    ddsrt_atomic_add64 (&recv_thread_arg->rdbatch_packets, (uint64_t) nrcvd);
+  }
 
-    if ((size_t)sz < RTPS_MESSAGE_HEADER_SIZE || *(uint32_t *)buff != NN_PROTOCOLID_AS_UINT32)
-    {
-      /* discard packets that are really too small or don't have magic cookie */
-    }
-    else if (hdr->version.major != RTPS_MAJOR || (hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
-    {
-      if ((hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
-        GVTRACE ("HDR(%"PRIx32":%"PRIx32":%"PRIx32" vendor %d.%d) len %lu\n, version mismatch: %d.%d\n",
-                 PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, hdr->version.major, hdr->version.minor);
-      if (DDSI_SC_PEDANTIC_P (gv->config))
-        malformed_packet_received_nosubmsg (gv, buff, sz, "header", hdr->vendorid);
-    }
+  for (uint32_t i = 0; i < n; i++)
+  {
+    if ((int) i < nrcvd)
+      (void) handle_packet (ts1, gv, conn, guidprefix, rbpool, rmsgs[i], (ssize_t) szs[i], &srclocs[i]);
     else
-    {
-      hdr->guid_prefix = nn_ntoh_guid_prefix (hdr->guid_prefix);
-
-      if (gv->logconfig.c.mask & DDS_LC_TRACE)
-      {
-        char addrstr[DDSI_LOCSTRLEN];
-        ddsi_locator_to_string(addrstr, sizeof(addrstr), &srcloc);
-        GVTRACE ("HDR(%"PRIx32":%"PRIx32":%"PRIx32" vendor %d.%d) len %lu from %s\n",
-                 PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, addrstr);
-      }
-      nn_rtps_msg_state_t res = decode_rtps_message (ts1, gv, &rmsg, &hdr, &buff, &sz, rbpool, conn->m_stream);
-      if (res != NN_RTPS_MSG_STATE_ERROR)
-      {
-        handle_submsg_sequence (ts1, gv, conn, &srcloc, ddsrt_time_wallclock (), ddsrt_time_elapsed (), &hdr->guid_prefix, guidprefix, buff, (size_t) sz, buff + RTPS_MESSAGE_HEADER_SIZE, rmsg, res == NN_RTPS_MSG_STATE_ENCODED);
-      }
-      else
-      {
-        /* drop message */
-        sz = 1;
-      }
-    }
+      nn_rmsg_commit (rmsgs[i]);
   }
-  nn_rmsg_commit (rmsg);
-  return (sz > 0);
+  return (nrcvd > 0);
+}
+
+static bool do_packets (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const ddsi_guid_prefix_t *guidprefix, struct recv_thread_arg *recv_thread_arg)
+{
+  if (gv->config.recv_batch_size > 1 && !conn->m_stream && conn->m_read_batch_fn)
+    return do_packet_batch (ts1, gv, conn, guidprefix, recv_thread_arg);
+  else
+    return do_packet (ts1, gv, conn, guidprefix, recv_thread_arg->rbpool);
 }
 
 struct local_participant_desc
@@ -3474,6 +3618,12 @@ void trigger_recv_threads (const struct ddsi_domaingv *gv)
         char dummy = 0;
         const ddsi_locator_t *dst = gv->recv_threads[i].arg.u.single.loc;
         ddsrt_iovec_t iov;
+        if (gv->recv_threads[i].arg.u.single.ws)
+        {
+          GVTRACE ("trigger_recv_threads: %"PRIu32" single %p\n", i, (void *) gv->recv_threads[i].arg.u.single.ws);
+          os_sockWaitsetTrigger (gv->recv_threads[i].arg.u.single.ws);
+          break;
+        }
         iov.iov_base = &dummy;
         iov.iov_len = 1;
         GVTRACE ("trigger_recv_threads: %"PRIu32" single %s\n", i, ddsi_locator_to_string (buf, sizeof (buf), dst));
@@ -3503,10 +3653,22 @@ uint32_t recv_thread (void *vrecv_thread_arg)
   if (waitset == NULL)
   {
     struct ddsi_tran_conn *conn = recv_thread_arg->u.single.conn;
+    os_sockWaitset single_ws = recv_thread_arg->u.single.ws;
     while (ddsrt_atomic_ld32 (&gv->rtps_keepgoing))
     {
       LOG_THREAD_CPUTIME (&gv->logconfig, next_thread_cputime);
-      (void) do_packet (ts1, gv, conn, NULL, rbpool);
+      if (single_ws == NULL)
+        (void) do_packets (ts1, gv, conn, NULL, recv_thread_arg);
+      else
+      {
+        os_sockWaitsetCtx ctx;
+        if ((ctx = os_sockWaitsetWait (single_ws)) != NULL)
+        {
+          ddsi_tran_conn_t evconn;
+          while (os_sockWaitsetNextEvent (ctx, &evconn) >= 0)
+            (void) do_packets (ts1, gv, evconn, NULL, recv_thread_arg);
+        }
+      }
     }
   }
   else
@@ -3584,7 +3746,7 @@ uint32_t recv_thread (void *vrecv_thread_arg)
           else
             guid_prefix = &lps.ps[(unsigned)idx - num_fixed].guid_prefix;
           /* Process message and clean out connection if failed or closed */
-          if (!do_packet (ts1, gv, conn, guid_prefix, rbpool) && !conn->m_connless)
+          if (!do_packets (ts1, gv, conn, guid_prefix, recv_thread_arg) && !conn->m_connless)
             ddsi_conn_free (conn);
         }
       }
@@ -27,9 +27,12 @@
 #define MODE_KQUEUE 1
 #define MODE_SELECT 2
 #define MODE_WFMEVS 3
+#define MODE_EPOLL 4
 
 #if defined __APPLE__
 #define MODE_SEL MODE_KQUEUE
+#elif defined __linux && !LWIP_SOCKET
+#define MODE_SEL MODE_EPOLL
 #elif defined WINCE
 #define MODE_SEL MODE_WFMEVS
 #else
@@ -281,6 +284,303 @@ int os_sockWaitsetNextEvent (os_sockWaitsetCtx ctx, ddsi_tran_conn_t *conn)
   return -1;
 }
 
+#elif MODE_SEL == MODE_EPOLL
+
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+
+/* Entries are allocated individually so that the pointer stored in the epoll
+   registration remains valid even when the array of entries is reallocated.
+   Purge doesn't remove anything from the epoll set, it only marks the
+   entries following the index as "stale" and a subsequent Add of the same
+   connection revives the existing registration in place.  Only those entries
+   that are still stale when the next Wait is called are really removed.  That
+   way, rebuilding the set of participant sockets in recv_thread when the set
+   of participants changes costs a system call only for the sockets that were
+   actually added or removed, rather than for all of them.
+
+   Remove can be called from any thread while the receive thread is processing
+   a context, and so an entry is never freed while it may still be referenced
+   by the events in the context: it is merely disabled (fd = -1) and freed by
+   the next call to Wait.
+
+   The registrations are level-triggered: the receive thread reads a single
+   datagram per event using blocking sockets, and edge-triggered mode would
+   require draining each socket until it would block. */
+
+#define STALE_INDEX UINT32_MAX
+
+struct os_sockWaitsetCtx
+{
+  struct epoll_event *evs;
+  uint32_t nevs;
+  uint32_t evs_sz;
+  uint32_t index; /* cursor for enumerating */
+};
+
+struct entry {
+  uint32_t index; /* 0 for the trigger pipe; STALE_INDEX if purged */
+  int fd;
+  ddsi_tran_conn_t conn;
+};
+
+struct os_sockWaitset
+{
+  int epoll;
+  int pipe[2]; /* pipe used for triggering */
+  uint32_t next_index; /* index to be assigned to next added connection */
+  uint32_t n; /* number of entries in use */
+  uint32_t sz; /* allocated size of entries */
+  bool need_sweep; /* whether entries contains stale or removed entries */
+  struct entry **entries;
+  struct os_sockWaitsetCtx ctx; /* set of descriptors being handled */
+  ddsrt_mutex_t lock; /* for add/delete */
+};
+
+static int add_entry_locked (os_sockWaitset ws, ddsi_tran_conn_t conn, int fd)
+{
+  struct entry *e, *stale = NULL;
+  struct epoll_event ev;
+  assert (fd >= 0);
+  for (uint32_t i = 0; i < ws->n; i++)
+  {
+    e = ws->entries[i];
+    if (e->fd != fd || e->conn != conn)
+      continue;
+    else if (e->index != STALE_INDEX)
+      return 0;
+    else
+      stale = e;
+  }
+  if (stale != NULL)
+  {
+    /* still registered with the epoll set, so just give it its new index */
+    stale->index = ws->next_index++;
+    return 1;
+  }
+
+  if (ws->n == ws->sz)
+  {
+    ws->sz += WAITSET_DELTA;
+    ws->entries = ddsrt_realloc (ws->entries, ws->sz * sizeof (*ws->entries));
+  }
+  e = ddsrt_malloc (sizeof (*e));
+  e->fd = fd;
+  e->conn = conn;
+  e->index = ws->next_index;
+  memset (&ev, 0, sizeof (ev));
+  ev.events = EPOLLIN;
+  ev.data.ptr = e;
+  if (epoll_ctl (ws->epoll, EPOLL_CTL_ADD, fd, &ev) == -1)
+  {
+    ddsrt_free (e);
+    return -1;
+  }
+  ws->entries[ws->n++] = e;
+  ws->next_index++;
+  return 1;
+}
+
+static void sweep_entries_locked (os_sockWaitset ws)
+{
+  uint32_t i, j;
+  for (i = j = 0; i < ws->n; i++)
+  {
+    struct entry * const e = ws->entries[i];
+    if (e->fd >= 0 && e->index != STALE_INDEX)
+      ws->entries[j++] = e;
+    else
+    {
+      /* removed entries have already been deregistered, stale ones may have been
+         closed in the meantime, in which case the kernel has already dropped it */
+      if (e->fd >= 0 && epoll_ctl (ws->epoll, EPOLL_CTL_DEL, e->fd, NULL) == -1 && errno != EBADF && errno != ENOENT)
+        DDS_WARNING("os_sockWaitsetWait: epoll_ctl DEL failed, errno = %d\n", errno);
+      ddsrt_free (e);
+    }
+  }
+  ws->n = j;
+  ws->need_sweep = false;
+}
+
+os_sockWaitset os_sockWaitsetNew (void)
+{
+  os_sockWaitset ws;
+  if ((ws = ddsrt_malloc (sizeof (*ws))) == NULL)
+    goto fail_waitset;
+  ws->next_index = 0;
+  ws->n = 0;
+  ws->sz = WAITSET_DELTA;
+  ws->need_sweep = false;
+  if ((ws->entries = ddsrt_malloc (ws->sz * sizeof (*ws->entries))) == NULL)
+    goto fail_entries;
+  ws->ctx.nevs = 0;
+  ws->ctx.index = 0;
+  ws->ctx.evs_sz = WAITSET_DELTA;
+  if ((ws->ctx.evs = ddsrt_malloc (ws->ctx.evs_sz * sizeof (*ws->ctx.evs))) == NULL)
+    goto fail_ctx_evs;
+  if ((ws->epoll = epoll_create1 (EPOLL_CLOEXEC)) == -1)
+    goto fail_epoll;
+  if (pipe (ws->pipe) == -1)
+    goto fail_pipe;
+  if (fcntl (ws->pipe[0], F_SETFD, fcntl (ws->pipe[0], F_GETFD) | FD_CLOEXEC) == -1)
+    goto fail_fcntl;
+  if (fcntl (ws->pipe[1], F_SETFD, fcntl (ws->pipe[1], F_GETFD) | FD_CLOEXEC) == -1)
+    goto fail_fcntl;
+  if (add_entry_locked (ws, NULL, ws->pipe[0]) < 0)
+    goto fail_add_trigger;
+  assert (ws->entries[0]->fd == ws->pipe[0] && ws->entries[0]->index == 0);
+  ddsrt_mutex_init (&ws->lock);
+  return ws;
+
+fail_add_trigger:
+fail_fcntl:
+  close (ws->pipe[0]);
+  close (ws->pipe[1]);
+fail_pipe:
+  close (ws->epoll);
+fail_epoll:
+  ddsrt_free (ws->ctx.evs);
+fail_ctx_evs:
+  ddsrt_free (ws->entries);
+fail_entries:
+  ddsrt_free (ws);
+fail_waitset:
+  return NULL;
+}
+
+void os_sockWaitsetFree (os_sockWaitset ws)
+{
+  for (uint32_t i = 0; i < ws->n; i++)
+    ddsrt_free (ws->entries[i]);
+  ddsrt_mutex_destroy (&ws->lock);
+  close (ws->pipe[0]);
+  close (ws->pipe[1]);
+  close (ws->epoll);
+  ddsrt_free (ws->entries);
+  ddsrt_free (ws->ctx.evs);
+  ddsrt_free (ws);
+}
+
+void os_sockWaitsetTrigger (os_sockWaitset ws)
+{
+  char buf = 0;
+  int n;
+  n = (int)write (ws->pipe[1], &buf, 1);
+  if (n != 1)
+  {
+    DDS_WARNING("os_sockWaitsetTrigger: write failed on trigger pipe, errno = %d\n", errno);
+  }
+}
+
+int os_sockWaitsetAdd (os_sockWaitset ws, ddsi_tran_conn_t conn)
+{
+  int ret;
+  ddsrt_mutex_lock (&ws->lock);
+  ret = add_entry_locked (ws, conn, ddsi_conn_handle (conn));
+  ddsrt_mutex_unlock (&ws->lock);
+  return ret;
+}
+
+void os_sockWaitsetPurge (os_sockWaitset ws, unsigned index)
+{
+  /* index 0 in the interface is the first connection, which has internal index 1 */
+  ddsrt_mutex_lock (&ws->lock);
+  for (uint32_t i = 0; i < ws->n; i++)
+  {
+    struct entry * const e = ws->entries[i];
+    if (e->index != STALE_INDEX && e->index > index)
+    {
+      e->index = STALE_INDEX;
+      ws->need_sweep = true;
+    }
+  }
+  if (ws->next_index > index + 1)
+    ws->next_index = index + 1;
+  ddsrt_mutex_unlock (&ws->lock);
+}
+
+void os_sockWaitsetRemove (os_sockWaitset ws, ddsi_tran_conn_t conn)
+{
+  const int fd = ddsi_conn_handle (conn);
+  assert (fd >= 0);
+  ddsrt_mutex_lock (&ws->lock);
+  for (uint32_t i = 1; i < ws->n; i++)
+  {
+    struct entry * const e = ws->entries[i];
+    if (e->fd == fd)
+    {
+      if (epoll_ctl (ws->epoll, EPOLL_CTL_DEL, fd, NULL) == -1)
+        DDS_WARNING("os_sockWaitsetRemove: epoll_ctl DEL failed, errno = %d\n", errno);
+      e->fd = -1;
+      ws->need_sweep = true;
+      break;
+    }
+  }
+  ddsrt_mutex_unlock (&ws->lock);
+}
+
+os_sockWaitsetCtx os_sockWaitsetWait (os_sockWaitset ws)
+{
+  /* if the array of events is smaller than the number of file descriptors in the
+     epoll set, things will still work fine, as the kernel will just return what
+     can be stored, and the set will be grown on the next call */
+  uint32_t ws_sz;
+  int nevs;
+  ddsrt_mutex_lock (&ws->lock);
+  if (ws->need_sweep)
+    sweep_entries_locked (ws);
+  ws_sz = ws->n;
+  ddsrt_mutex_unlock (&ws->lock);
+  if (ws->ctx.evs_sz < ws_sz)
+  {
+    ws->ctx.evs_sz = ws_sz;
+    ws->ctx.evs = ddsrt_realloc (ws->ctx.evs, ws_sz * sizeof (*ws->ctx.evs));
+  }
+  nevs = epoll_wait (ws->epoll, ws->ctx.evs, (int) ws->ctx.evs_sz, -1);
+  if (nevs < 0)
+  {
+    if (errno == EINTR)
+      nevs = 0;
+    else
+    {
+      DDS_WARNING("os_sockWaitsetWait: epoll_wait failed, errno = %d\n", errno);
+      return NULL;
+    }
+  }
+  ws->ctx.nevs = (uint32_t) nevs;
+  ws->ctx.index = 0;
+  return &ws->ctx;
+}
+
+int os_sockWaitsetNextEvent (os_sockWaitsetCtx ctx, ddsi_tran_conn_t *conn)
+{
+  while (ctx->index < ctx->nevs)
+  {
+    uint32_t idx = ctx->index++;
+    struct entry * const entry = ctx->evs[idx].data.ptr;
+    if (entry->fd < 0 || entry->index == STALE_INDEX)
+    {
+      /* removed or purged after epoll_wait returned */
+      continue;
+    }
+    else if (entry->index > 0)
+    {
+      *conn = entry->conn;
+      return (int) (entry->index - 1);
+    }
+    else
+    {
+      /* trigger pipe, read & try again */
+      char dummy;
+      if (read (entry->fd, &dummy, 1) != 1)
+        DDS_WARNING("os_sockWaitsetNextEvent: read failed on trigger pipe, errno = %d\n", errno);
+    }
+  }
+  return -1;
+}
+
 #elif MODE_SEL == MODE_WFMEVS
 
 struct os_sockWaitsetCtx
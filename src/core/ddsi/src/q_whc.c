@@ -20,6 +20,7 @@ DDS_EXPORT extern inline void whc_return_sample (struct whc *whc, struct whc_bor
 DDS_EXPORT extern inline void whc_sample_iter_init (const struct whc *whc, struct whc_sample_iter *it);
 DDS_EXPORT extern inline bool whc_sample_iter_borrow_next (struct whc_sample_iter *it, struct whc_borrowed_sample *sample);
 DDS_EXPORT extern inline void whc_free (struct whc *whc);
+DDS_EXPORT extern inline void whc_get_memory_stats (const struct whc *whc, struct whc_memory_stats *st);
 DDS_EXPORT extern int whc_insert (struct whc *whc, seqno_t max_drop_seq, seqno_t seq, ddsrt_mtime_t exp, struct ddsi_plist *plist, struct ddsi_serdata *serdata, struct ddsi_tkmap_instance *tk);
 DDS_EXPORT extern unsigned whc_downgrade_to_volatile (struct whc *whc, struct whc_state *st);
 DDS_EXPORT extern unsigned whc_remove_acked_messages (struct whc *whc, seqno_t max_drop_seq, struct whc_state *whcst, struct whc_node **deferred_free_list);
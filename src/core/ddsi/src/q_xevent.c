@@ -14,10 +14,12 @@
 
 #include "dds/ddsrt/atomics.h"
 #include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/mh3.h"
 #include "dds/ddsrt/sync.h"
 
 #include "dds/ddsrt/avl.h"
 #include "dds/ddsrt/fibheap.h"
+#include "dds/ddsrt/timerwheel.h"
 
 #include "dds/ddsi/q_log.h"
 #include "dds/ddsi/q_addrset.h"
@@ -65,7 +67,10 @@ enum xeventkind
 
 struct xevent
 {
-  ddsrt_fibheap_node_t heapnode;
+  union {
+    ddsrt_fibheap_node_t heap;
+    ddsrt_timerwheel_node_t wheel;
+  } schednode;
   struct xeventq *evq;
   ddsrt_mtime_t tsched;
   enum xeventkind kind;
@@ -141,7 +146,9 @@ struct xevent_nt
 };
 
 struct xeventq {
-  ddsrt_fibheap_t xevents;
+  enum ddsi_xevent_scheduler scheduler;
+  ddsrt_fibheap_t xevents; /* if scheduler = heap */
+  ddsrt_timerwheel_t *xevents_wheel; /* if scheduler = wheel */
   ddsrt_avl_tree_t msg_xevents;
   struct xevent_nt *non_timed_xmit_list_oldest;
   struct xevent_nt *non_timed_xmit_list_newest; /* undefined if ..._oldest == NULL */
@@ -167,7 +174,8 @@ static void handle_nontimed_xevent (struct xevent_nt *xev, struct nn_xpack *xp);
 
 static const ddsrt_avl_treedef_t msg_xevents_treedef = DDSRT_AVL_TREEDEF_INITIALIZER_INDKEY (offsetof (struct xevent_nt, u.msg_rexmit.msg_avlnode), offsetof (struct xevent_nt, u.msg_rexmit.msg), msg_xevents_cmp, 0);
 
-static const ddsrt_fibheap_def_t evq_xevents_fhdef = DDSRT_FIBHEAPDEF_INITIALIZER(offsetof (struct xevent, heapnode), compare_xevent_tsched);
+static const ddsrt_fibheap_def_t evq_xevents_fhdef = DDSRT_FIBHEAPDEF_INITIALIZER(offsetof (struct xevent, schednode.heap), compare_xevent_tsched);
+static const ddsrt_timerwheel_def_t evq_xevents_twdef = DDSRT_TIMERWHEELDEF_INITIALIZER(offsetof (struct xevent, schednode.wheel), offsetof (struct xevent, tsched.v));
 
 static int compare_xevent_tsched (const void *va, const void *vb)
 {
@@ -176,6 +184,60 @@ static int compare_xevent_tsched (const void *va, const void *vb)
   return (a->tsched.v == b->tsched.v) ? 0 : (a->tsched.v < b->tsched.v) ? -1 : 1;
 }
 
+/* The timed events are kept in either a Fibonacci heap or a timing wheel,
+   these dispatch to whichever one is in use */
+
+static void sched_insert (struct xeventq *evq, struct xevent *ev)
+{
+  if (evq->scheduler == DDSI_XEVENT_SCHEDULER_WHEEL)
+    ddsrt_timerwheel_insert (&evq_xevents_twdef, evq->xevents_wheel, ev);
+  else
+    ddsrt_fibheap_insert (&evq_xevents_fhdef, &evq->xevents, ev);
+}
+
+static void sched_delete (struct xeventq *evq, struct xevent *ev)
+{
+  if (evq->scheduler == DDSI_XEVENT_SCHEDULER_WHEEL)
+    ddsrt_timerwheel_delete (&evq_xevents_twdef, evq->xevents_wheel, ev);
+  else
+    ddsrt_fibheap_delete (&evq_xevents_fhdef, &evq->xevents, ev);
+}
+
+static void sched_decrease_key (struct xeventq *evq, struct xevent *ev)
+{
+  /* to be called after decreasing the key of an event that is scheduled */
+  if (evq->scheduler == DDSI_XEVENT_SCHEDULER_WHEEL)
+  {
+    ddsrt_timerwheel_delete (&evq_xevents_twdef, evq->xevents_wheel, ev);
+    ddsrt_timerwheel_insert (&evq_xevents_twdef, evq->xevents_wheel, ev);
+  }
+  else
+  {
+    ddsrt_fibheap_decrease_key (&evq_xevents_fhdef, &evq->xevents, ev);
+  }
+}
+
+static struct xevent *sched_extract_due (struct xeventq *evq, ddsrt_mtime_t tnow)
+{
+  if (evq->scheduler == DDSI_XEVENT_SCHEDULER_WHEEL)
+    return ddsrt_timerwheel_extract_due (&evq_xevents_twdef, evq->xevents_wheel, tnow.v);
+  else
+  {
+    struct xevent *min = ddsrt_fibheap_min (&evq_xevents_fhdef, &evq->xevents);
+    if (min == NULL || min->tsched.v > tnow.v)
+      return NULL;
+    return ddsrt_fibheap_extract_min (&evq_xevents_fhdef, &evq->xevents);
+  }
+}
+
+static struct xevent *sched_extract_any (struct xeventq *evq)
+{
+  if (evq->scheduler == DDSI_XEVENT_SCHEDULER_WHEEL)
+    return ddsrt_timerwheel_extract_any (&evq_xevents_twdef, evq->xevents_wheel);
+  else
+    return ddsrt_fibheap_extract_min (&evq_xevents_fhdef, &evq->xevents);
+}
+
 static void update_rexmit_counts (struct xeventq *evq, struct xevent_nt *ev)
 {
 #if 0
@@ -346,12 +408,12 @@ void delete_xevent (struct xevent *ev)
   if (ev->tsched.v != DDS_NEVER)
   {
     ev->tsched.v = TSCHED_DELETE;
-    ddsrt_fibheap_decrease_key (&evq_xevents_fhdef, &evq->xevents, ev);
+    sched_decrease_key (evq, ev);
   }
   else
   {
     ev->tsched.v = TSCHED_DELETE;
-    ddsrt_fibheap_insert (&evq_xevents_fhdef, &evq->xevents, ev);
+    sched_insert (evq, ev);
   }
   /* TSCHED_DELETE is absolute minimum time, so chances are we need to
      wake up the thread.  The superfluous signal is harmless. */
@@ -370,7 +432,7 @@ void delete_xevent_callback (struct xevent *ev)
     if (ev->tsched.v != DDS_NEVER)
     {
       assert (ev->tsched.v != TSCHED_DELETE);
-      ddsrt_fibheap_delete (&evq_xevents_fhdef, &evq->xevents, ev);
+      sched_delete (evq, ev);
       ev->tsched.v = DDS_NEVER;
     }
     if (ev->u.callback.executing)
@@ -402,12 +464,12 @@ int resched_xevent_if_earlier (struct xevent *ev, ddsrt_mtime_t tsched)
     if (ev->tsched.v != DDS_NEVER)
     {
       ev->tsched = tsched;
-      ddsrt_fibheap_decrease_key (&evq_xevents_fhdef, &evq->xevents, ev);
+      sched_decrease_key (evq, ev);
     }
     else
     {
       ev->tsched = tsched;
-      ddsrt_fibheap_insert (&evq_xevents_fhdef, &evq->xevents, ev);
+      sched_insert (evq, ev);
     }
     is_resched = 1;
     if (tsched.v < tbefore.v)
@@ -469,8 +531,12 @@ static struct xevent_nt *qxev_common_nt (struct xeventq *evq, enum xeventkind_nt
 
 static ddsrt_mtime_t earliest_in_xeventq (struct xeventq *evq)
 {
+  /* for the timing wheel, this may be earlier than the first event (but not
+     later), which is fine for deciding when to wake up the thread */
   struct xevent *min;
   ASSERT_MUTEX_HELD (&evq->lock);
+  if (evq->scheduler == DDSI_XEVENT_SCHEDULER_WHEEL)
+    return (ddsrt_mtime_t) { ddsrt_timerwheel_next (&evq_xevents_twdef, evq->xevents_wheel) };
   return ((min = ddsrt_fibheap_min (&evq_xevents_fhdef, &evq->xevents)) != NULL) ? min->tsched : DDSRT_MTIME_NEVER;
 }
 
@@ -483,7 +549,7 @@ static void qxev_insert (struct xevent *ev)
   if (ev->tsched.v != DDS_NEVER)
   {
     ddsrt_mtime_t tbefore = earliest_in_xeventq (evq);
-    ddsrt_fibheap_insert (&evq_xevents_fhdef, &evq->xevents, ev);
+    sched_insert (evq, ev);
     if (ev->tsched.v < tbefore.v)
       ddsrt_cond_broadcast (&evq->cond);
   }
@@ -509,7 +575,14 @@ struct xeventq * xeventq_new (struct ddsi_domaingv *gv, size_t max_queued_rexmit
   /* limit to 2GB to prevent overflow (4GB - 64kB should be ok, too) */
   if (max_queued_rexmit_bytes > 2147483648u)
     max_queued_rexmit_bytes = 2147483648u;
+  evq->scheduler = gv->config.xevent_scheduler;
   ddsrt_fibheap_init (&evq_xevents_fhdef, &evq->xevents);
+  evq->xevents_wheel = NULL;
+  if (evq->scheduler == DDSI_XEVENT_SCHEDULER_WHEEL)
+  {
+    evq->xevents_wheel = ddsrt_malloc (sizeof (*evq->xevents_wheel));
+    ddsrt_timerwheel_init (&evq_xevents_twdef, evq->xevents_wheel);
+  }
   ddsrt_avl_init (&msg_xevents_treedef, &evq->msg_xevents);
   evq->non_timed_xmit_list_oldest = NULL;
   evq->non_timed_xmit_list_newest = NULL;
@@ -528,6 +601,14 @@ struct xeventq * xeventq_new (struct ddsi_domaingv *gv, size_t max_queued_rexmit
   return evq;
 }
 
+struct xeventq *xeventq_for_guid (const struct ddsi_domaingv *gv, const ddsi_guid_t *guid)
+{
+  if (gv->n_xevents_shards == 1)
+    return gv->xevents;
+  else
+    return gv->xevents_shards[ddsrt_mh3 (guid, sizeof (*guid), 0) % gv->n_xevents_shards];
+}
+
 dds_return_t xeventq_start (struct xeventq *evq, const char *name)
 {
   dds_return_t rc;
@@ -566,7 +647,7 @@ void xeventq_free (struct xeventq *evq)
 {
   struct xevent *ev;
   assert (evq->ts == NULL);
-  while ((ev = ddsrt_fibheap_extract_min (&evq_xevents_fhdef, &evq->xevents)) != NULL)
+  while ((ev = sched_extract_any (evq)) != NULL)
     free_xevent (evq, ev);
 
   {
@@ -587,6 +668,7 @@ void xeventq_free (struct xeventq *evq)
   assert (ddsrt_avl_is_empty (&evq->msg_xevents));
   ddsrt_cond_destroy (&evq->cond);
   ddsrt_mutex_destroy (&evq->lock);
+  ddsrt_free (evq->xevents_wheel);
   ddsrt_free (evq);
 }
 
@@ -1193,9 +1275,9 @@ static void handle_xevents (struct thread_state1 * const ts1, struct xeventq *xe
 
   while (xeventsToProcess)
   {
-    while (earliest_in_xeventq(xevq).v <= tnow.v)
+    struct xevent *xev;
+    while ((xev = sched_extract_due (xevq, tnow)) != NULL)
     {
-      struct xevent *xev = ddsrt_fibheap_extract_min (&evq_xevents_fhdef, &xevq->xevents);
       if (xev->tsched.v == TSCHED_DELETE)
       {
         free_xevent (xevq, xev);
@@ -1218,9 +1300,9 @@ static void handle_xevents (struct thread_state1 * const ts1, struct xeventq *xe
 
     if (!non_timed_xmit_list_is_empty (xevq))
     {
-      struct xevent_nt *xev = getnext_from_non_timed_xmit_list (xevq);
+      struct xevent_nt *xev_nt = getnext_from_non_timed_xmit_list (xevq);
       thread_state_awake_to_awake_no_nest (ts1);
-      handle_nontimed_xevent (xev, xp);
+      handle_nontimed_xevent (xev_nt, xp);
       tnow = ddsrt_time_monotonic ();
     }
     else
@@ -1326,11 +1408,12 @@ void qxev_prd_entityid (struct proxy_reader *prd, const ddsi_guid_t *guid)
     nn_xmsg_setdstPRD (msg, prd);
     GVTRACE ("  qxev_prd_entityid (%"PRIx32":%"PRIx32":%"PRIx32")\n", PGUIDPREFIX (guid->prefix));
     nn_xmsg_add_entityid (msg);
-    ddsrt_mutex_lock (&gv->xevents->lock);
-    ev = qxev_common_nt (gv->xevents, XEVK_ENTITYID);
+    struct xeventq * const evq = xeventq_for_guid (gv, guid);
+    ddsrt_mutex_lock (&evq->lock);
+    ev = qxev_common_nt (evq, XEVK_ENTITYID);
     ev->u.entityid.msg = msg;
     qxev_insert_nt (ev);
-    ddsrt_mutex_unlock (&gv->xevents->lock);
+    ddsrt_mutex_unlock (&evq->lock);
   }
 }
 
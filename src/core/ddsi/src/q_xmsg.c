@@ -1277,6 +1277,88 @@ static void nn_xpack_send1v (const ddsi_xlocator_t *loc, void * varg)
   (void) nn_xpack_send1 (loc, varg);
 }
 
+/* Sending the same xpack to many destinations: consecutive locators using the same
+   connection are collected and sent with a single ddsi_conn_write_multi call */
+struct nn_xpack_send_multi_arg {
+  struct nn_xpack *xp;
+  ddsi_tran_conn_t conn;
+  uint32_t n, max;
+  ddsi_locator_t dsts[DDSI_MAX_WRITE_BATCH];
+};
+
+static bool nn_xpack_may_send_multi (const struct nn_xpack *xp)
+{
+  /* lossiness, muting and security encoding are all dealt with per destination in
+     nn_xpack_send1, so don't bother */
+  struct ddsi_domaingv const * const gv = xp->gv;
+  if (gv->config.xmit_batch_size <= 1 || gv->config.xmit_lossiness > 0 || gv->mute)
+    return false;
+#ifdef DDS_HAS_SECURITY
+  if (xp->sec_info.use_rtps_encoding)
+    return false;
+#endif
+  return true;
+}
+
+static void nn_xpack_send_multi_flush (struct nn_xpack_send_multi_arg *arg)
+{
+  struct nn_xpack *xp = arg->xp;
+  struct ddsi_domaingv * const gv = xp->gv;
+  int nsent;
+  if (arg->n == 0)
+    return;
+  nsent = ddsi_conn_write_multi (arg->conn, arg->n, arg->dsts, xp->niov, xp->iov, xp->call_flags);
+  xp->call_flags = 0;
+  ddsrt_atomic_inc64 (&gv->xmit_batch_count);
+  if (nsent > 0)
+  {
+    ddsrt_atomic_add64 (&gv->xmit_batch_packets, (uint64_t) nsent);
+#ifdef DDS_HAS_BANDWIDTH_LIMITING
+    nn_bw_limit_sleep_if_needed (gv, &xp->limiter, (ssize_t) nsent * (ssize_t) xp->msg_len.length);
+#endif
+  }
+  arg->n = 0;
+}
+
+static void nn_xpack_send_multi_addloc (const ddsi_xlocator_t *loc, void *varg)
+{
+  struct nn_xpack_send_multi_arg *arg = varg;
+  struct nn_xpack *xp = arg->xp;
+#ifdef DDS_HAS_SHM
+  if (loc->conn->m_write_multi_fn == NULL || loc->c.kind == NN_LOCATOR_KIND_SHEM)
+#else
+  if (loc->conn->m_write_multi_fn == NULL)
+#endif
+  {
+    nn_xpack_send_multi_flush (arg);
+    (void) nn_xpack_send1 (loc, xp);
+    return;
+  }
+  if (xp->gv->logconfig.c.mask & DDS_LC_TRACE)
+  {
+    struct ddsi_domaingv const * const gv = xp->gv;
+    char buf[DDSI_LOCSTRLEN];
+    GVTRACE (" %s", ddsi_xlocator_to_string (buf, sizeof(buf), loc));
+  }
+  if (arg->n > 0 && (arg->conn != loc->conn || arg->n == arg->max))
+    nn_xpack_send_multi_flush (arg);
+  arg->conn = loc->conn;
+  arg->dsts[arg->n++] = loc->c;
+}
+
+static size_t nn_xpack_send_multi (struct nn_xpack *xp, struct addrset *as)
+{
+  struct nn_xpack_send_multi_arg arg;
+  size_t calls;
+  arg.xp = xp;
+  arg.conn = NULL;
+  arg.n = 0;
+  arg.max = (xp->gv->config.xmit_batch_size < DDSI_MAX_WRITE_BATCH) ? xp->gv->config.xmit_batch_size : DDSI_MAX_WRITE_BATCH;
+  calls = addrset_forall_count (as, nn_xpack_send_multi_addloc, &arg);
+  nn_xpack_send_multi_flush (&arg);
+  return calls;
+}
+
 static void nn_xpack_send_real (struct nn_xpack *xp)
 {
   struct ddsi_domaingv const * const gv = xp->gv;
@@ -1315,7 +1397,10 @@ static void nn_xpack_send_real (struct nn_xpack *xp)
     calls = 0;
     if (xp->dstaddr.all.as)
     {
-      calls = addrset_forall_count (xp->dstaddr.all.as, nn_xpack_send1v, xp);
+      if (nn_xpack_may_send_multi (xp))
+        calls = nn_xpack_send_multi (xp, xp->dstaddr.all.as);
+      else
+        calls = addrset_forall_count (xp->dstaddr.all.as, nn_xpack_send1v, xp);
       unref_addrset (xp->dstaddr.all.as);
     }
 
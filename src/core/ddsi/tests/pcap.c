@@ -0,0 +1,334 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "dds/ddsrt/cdtors.h"
+#include "dds/ddsrt/bswap.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/process.h"
+#include "dds/ddsrt/random.h"
+#include "dds/ddsrt/sockets.h"
+#include "dds/ddsrt/string.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/q_thread.h"
+#include "dds/ddsi/q_pcap.h"
+#include "CUnit/Theory.h"
+
+#define PCAP_HDR_SIZE 24
+#define PCAPREC_HDR_SIZE 16
+#define IPV4_UDP_HDR_SIZE 28
+#define RTPS_HDR_SIZE 20
+
+static struct ddsi_domaingv gv;
+
+static void pcap_init (void)
+{
+  ddsrt_init ();
+  thread_states_init (16);
+  memset (&gv, 0, sizeof (gv));
+  ddsi_config_init_default (&gv.config);
+  gv.config.transport_selector = DDSI_TRANS_UDP;
+}
+
+static void pcap_fini (void)
+{
+  (void) thread_states_fini ();
+  ddsrt_fini ();
+}
+
+static void make_name (char *buf, size_t size, const char *tag, int seq)
+{
+  if (seq < 0)
+    (void) snprintf (buf, size, "pcap_%s_%"PRIdPID".pcap", tag, ddsrt_getpid ());
+  else
+    (void) snprintf (buf, size, "pcap_%s_%"PRIdPID".%d.pcap", tag, ddsrt_getpid (), seq);
+}
+
+static void set_addr (struct sockaddr_storage *ss, const char *ip, uint16_t port)
+{
+  memset (ss, 0, sizeof (*ss));
+  CU_ASSERT_FATAL (ddsrt_sockaddrfromstr (AF_INET, ip, ss) == DDS_RETCODE_OK);
+  ((struct sockaddr_in *) ss)->sin_port = htons (port);
+}
+
+/* payload starts with the sequence number, followed by bytes derived from it */
+static void write_packet (uint32_t seq, uint32_t size, const char *srcip, uint16_t srcport, const char *dstip, uint16_t dstport, ddsrt_wctime_t tstamp)
+{
+  static unsigned char buf[65536];
+  struct sockaddr_storage src, dst;
+  CU_ASSERT_FATAL (size >= 4 && size <= sizeof (buf));
+  buf[0] = (unsigned char) (seq >> 24); buf[1] = (unsigned char) (seq >> 16);
+  buf[2] = (unsigned char) (seq >> 8); buf[3] = (unsigned char) seq;
+  for (uint32_t i = 4; i < size; i++)
+    buf[i] = (unsigned char) (seq + i);
+  set_addr (&src, srcip, srcport);
+  set_addr (&dst, dstip, dstport);
+  write_pcap_received (&gv, tstamp, &src, &dst, buf, size);
+}
+
+struct pkt {
+  uint32_t seq;
+  uint32_t size;
+  ddsrt_wctime_t tstamp;
+};
+
+static uint32_t rd32 (const unsigned char *p)
+{
+  /* pcap headers are in host byte order, IP and UDP headers in network byte order */
+  uint32_t x;
+  memcpy (&x, p, sizeof (x));
+  return x;
+}
+
+static uint32_t rdbe16 (const unsigned char *p)
+{
+  return ((uint32_t) p[0] << 8) | p[1];
+}
+
+/* reads all packets in a capture file, checking the headers and the payloads;
+   returns the number of packets or -1 if the file doesn't exist */
+static int read_pcap (const char *name, struct pkt *pkts, int maxpkts, long *fsize)
+{
+  FILE *fp;
+  unsigned char hdr[PCAP_HDR_SIZE], rec[PCAPREC_HDR_SIZE];
+  static unsigned char data[65536];
+  int n = 0;
+  DDSRT_WARNING_MSVC_OFF(4996);
+  if ((fp = fopen (name, "rb")) == NULL)
+    return -1;
+  DDSRT_WARNING_MSVC_ON(4996);
+  CU_ASSERT_FATAL (fread (hdr, sizeof (hdr), 1, fp) == 1);
+  CU_ASSERT_FATAL (rd32 (hdr) == 0xa1b2c3d4);
+  while (fread (rec, sizeof (rec), 1, fp) == 1)
+  {
+    const uint32_t incl = rd32 (rec + 8), orig = rd32 (rec + 12);
+    CU_ASSERT_FATAL (n < maxpkts);
+    CU_ASSERT_FATAL (incl == orig && incl >= IPV4_UDP_HDR_SIZE + 4 && incl <= sizeof (data));
+    CU_ASSERT_FATAL (fread (data, incl, 1, fp) == 1);
+    CU_ASSERT_FATAL (rdbe16 (data + 2) == incl);
+    CU_ASSERT_FATAL (rdbe16 (data + 24) == incl - 20);
+    const unsigned char *payload = data + IPV4_UDP_HDR_SIZE;
+    pkts[n].seq = ((uint32_t) payload[0] << 24) | ((uint32_t) payload[1] << 16) | ((uint32_t) payload[2] << 8) | payload[3];
+    pkts[n].size = incl - IPV4_UDP_HDR_SIZE;
+    pkts[n].tstamp.v = (int64_t) rd32 (rec) * DDS_NSECS_IN_SEC + (int64_t) rd32 (rec + 4) * DDS_NSECS_IN_USEC;
+    for (uint32_t i = 4; i < pkts[n].size; i++)
+      CU_ASSERT_FATAL (payload[i] == (unsigned char) (pkts[n].seq + i));
+    n++;
+  }
+  *fsize = ftell (fp);
+  fclose (fp);
+  (void) remove (name);
+  return n;
+}
+
+CU_Test (ddsi_pcap, ring_wraparound, .init = pcap_init, .fini = pcap_fini, .timeout = 30)
+{
+  /* the minimum ring size is 128kB, writing 2000 packets of random sizes up to
+     1472 bytes wraps around about a dozen times, with records and payloads
+     straddling the end of the ring at various offsets; pausing regularly gives
+     the writer thread the opportunity to drain the ring, so nothing is dropped */
+#define N_PACKETS 2000
+  char name[100];
+  struct pkt *pkts = ddsrt_malloc (N_PACKETS * sizeof (*pkts));
+  uint32_t sizes[N_PACKETS];
+  long fsize;
+  ddsrt_prng_t prng;
+  ddsrt_prng_init_simple (&prng, 1);
+  gv.config.pcap_buffer_size = 1;
+  make_name (name, sizeof (name), "wrap", -1);
+  struct pcap_capture *pc = gv.pcap = new_pcap_capture (&gv, name);
+  CU_ASSERT_FATAL (pc != NULL);
+  const ddsrt_wctime_t t0 = ddsrt_time_wallclock ();
+  for (uint32_t i = 0; i < N_PACKETS; i++)
+  {
+    sizes[i] = 4 + ddsrt_prng_random (&prng) % 1469;
+    write_packet (i, sizes[i], "10.0.0.1", 7410, "10.0.0.2", 7411, ddsrt_wctime_add_duration (t0, DDS_USECS (i)));
+    if ((i % 16) == 15)
+      dds_sleepfor (DDS_MSECS (20));
+  }
+  free_pcap_capture (pc);
+  const int n = read_pcap (name, pkts, N_PACKETS, &fsize);
+  CU_ASSERT_FATAL (n == N_PACKETS);
+  for (uint32_t i = 0; i < N_PACKETS; i++)
+  {
+    CU_ASSERT_FATAL (pkts[i].seq == i);
+    CU_ASSERT_FATAL (pkts[i].size == sizes[i]);
+    CU_ASSERT_FATAL (pkts[i].tstamp.v == ddsrt_wctime_add_duration (t0, DDS_USECS (i)).v / DDS_NSECS_IN_USEC * DDS_NSECS_IN_USEC);
+  }
+  ddsrt_free (pkts);
+#undef N_PACKETS
+}
+
+static void check_file (const char *tag, int seq, int npkts, const uint32_t *expseqs, long maxsize)
+{
+  char name[100];
+  struct pkt pkts[10];
+  long fsize;
+  make_name (name, sizeof (name), tag, seq);
+  const int n = read_pcap (name, pkts, 10, &fsize);
+  CU_ASSERT_FATAL (n == npkts);
+  for (int i = 0; i < n; i++)
+    CU_ASSERT_FATAL (pkts[i].seq == expseqs[i]);
+  if (maxsize > 0)
+    CU_ASSERT_FATAL (fsize <= maxsize);
+}
+
+CU_Test (ddsi_pcap, rotate_size, .init = pcap_init, .fini = pcap_fini)
+{
+  /* a packet with a 1000 byte payload takes 1044 bytes in the file, so with the
+     24 byte file header three of them fit in 4096 bytes */
+  char name[100];
+  const ddsrt_wctime_t t0 = ddsrt_time_wallclock ();
+  gv.config.pcap_max_file_size = 4096;
+  make_name (name, sizeof (name), "size", -1);
+  struct pcap_capture *pc = gv.pcap = new_pcap_capture (&gv, name);
+  CU_ASSERT_FATAL (pc != NULL);
+  for (uint32_t i = 0; i < 10; i++)
+    write_packet (i, 1000, "10.0.0.1", 7410, "10.0.0.2", 7411, t0);
+  /* a packet that is larger than the limit goes into a file of its own */
+  write_packet (10, 5000, "10.0.0.1", 7410, "10.0.0.2", 7411, t0);
+  write_packet (11, 1000, "10.0.0.1", 7410, "10.0.0.2", 7411, t0);
+  free_pcap_capture (pc);
+
+  check_file ("size", 0, 3, (const uint32_t[]) { 0, 1, 2 }, 4096);
+  check_file ("size", 1, 3, (const uint32_t[]) { 3, 4, 5 }, 4096);
+  check_file ("size", 2, 3, (const uint32_t[]) { 6, 7, 8 }, 4096);
+  check_file ("size", 3, 1, (const uint32_t[]) { 9 }, 4096);
+  check_file ("size", 4, 1, (const uint32_t[]) { 10 }, 0);
+  check_file ("size", 5, 1, (const uint32_t[]) { 11 }, 4096);
+  check_file ("size", 6, -1, NULL, 0);
+}
+
+CU_Test (ddsi_pcap, rotate_max_files, .init = pcap_init, .fini = pcap_fini)
+{
+  char name[100];
+  const ddsrt_wctime_t t0 = ddsrt_time_wallclock ();
+  gv.config.pcap_max_file_size = 4096;
+  gv.config.pcap_max_files = 2;
+  make_name (name, sizeof (name), "maxfiles", -1);
+  struct pcap_capture *pc = gv.pcap = new_pcap_capture (&gv, name);
+  CU_ASSERT_FATAL (pc != NULL);
+  for (uint32_t i = 0; i < 7; i++)
+    write_packet (i, 1000, "10.0.0.1", 7410, "10.0.0.2", 7411, t0);
+  free_pcap_capture (pc);
+
+  /* the third file overwrote the first one */
+  check_file ("maxfiles", 0, 1, (const uint32_t[]) { 6 }, 4096);
+  check_file ("maxfiles", 1, 3, (const uint32_t[]) { 3, 4, 5 }, 4096);
+  check_file ("maxfiles", 2, -1, NULL, 0);
+}
+
+CU_Test (ddsi_pcap, rotate_interval, .init = pcap_init, .fini = pcap_fini)
+{
+  char name[100];
+  gv.config.pcap_rotation_interval = DDS_SECS (1);
+  make_name (name, sizeof (name), "interval", -1);
+  struct pcap_capture *pc = gv.pcap = new_pcap_capture (&gv, name);
+  CU_ASSERT_FATAL (pc != NULL);
+  const ddsrt_wctime_t t0 = ddsrt_time_wallclock ();
+  const dds_duration_t ts[] = { 0, DDS_MSECS (500), DDS_MSECS (1000), DDS_MSECS (1900), DDS_MSECS (2500) };
+  for (uint32_t i = 0; i < sizeof (ts) / sizeof (ts[0]); i++)
+    write_packet (i, 100, "10.0.0.1", 7410, "10.0.0.2", 7411, ddsrt_wctime_add_duration (t0, ts[i]));
+  free_pcap_capture (pc);
+
+  check_file ("interval", 0, 2, (const uint32_t[]) { 0, 1 }, 0);
+  check_file ("interval", 1, 2, (const uint32_t[]) { 2, 3 }, 0);
+  check_file ("interval", 2, 1, (const uint32_t[]) { 4 }, 0);
+  check_file ("interval", 3, -1, NULL, 0);
+}
+
+/* writes an RTPS header with GUID prefix prefix0:0:seq, so the source and the
+   sequence number can be recovered from the captured packet */
+static void write_rtps_packet (uint32_t seq, uint32_t prefix0, ddsrt_wctime_t tstamp)
+{
+  unsigned char buf[RTPS_HDR_SIZE];
+  const uint32_t prefix[3] = { ddsrt_toBE4u (prefix0), 0, ddsrt_toBE4u (seq) };
+  struct sockaddr_storage src, dst;
+  memcpy (buf, "RTPS", 4);
+  buf[4] = 2; buf[5] = 1; buf[6] = 1; buf[7] = 0x10;
+  memcpy (buf + 8, prefix, sizeof (prefix));
+  set_addr (&src, "10.0.0.1", 7410);
+  set_addr (&dst, "10.0.0.2", 7411);
+  write_pcap_received (&gv, tstamp, &src, &dst, buf, sizeof (buf));
+}
+
+/* returns the sequence numbers of the RTPS packets in a capture file */
+static int read_rtps_seqs (const char *name, uint32_t *seqs, int maxpkts)
+{
+  FILE *fp;
+  unsigned char hdr[PCAP_HDR_SIZE], rec[PCAPREC_HDR_SIZE], data[IPV4_UDP_HDR_SIZE + RTPS_HDR_SIZE];
+  int n = 0;
+  DDSRT_WARNING_MSVC_OFF(4996);
+  CU_ASSERT_FATAL ((fp = fopen (name, "rb")) != NULL);
+  DDSRT_WARNING_MSVC_ON(4996);
+  CU_ASSERT_FATAL (fread (hdr, sizeof (hdr), 1, fp) == 1);
+  while (fread (rec, sizeof (rec), 1, fp) == 1)
+  {
+    CU_ASSERT_FATAL (n < maxpkts);
+    CU_ASSERT_FATAL (rd32 (rec + 8) == sizeof (data));
+    CU_ASSERT_FATAL (fread (data, sizeof (data), 1, fp) == 1);
+    const unsigned char *p = data + IPV4_UDP_HDR_SIZE + 16;
+    seqs[n++] = ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+  }
+  fclose (fp);
+  (void) remove (name);
+  return n;
+}
+
+static void guid_prefix_filter (uint32_t buffer_size)
+{
+  static const struct {
+    uint32_t prefix0;
+    bool pass;
+  } cases[] = {
+    { 0x1107a3c, true },
+    { 0x1107a3d, false },
+    { 0x2ab, true },        /* wildcards */
+    { 0x2abc, false },      /* patterns match the whole prefix */
+    { 0x3f, false }
+  };
+  const uint32_t ncases = (uint32_t) (sizeof (cases) / sizeof (cases[0]));
+  char name[100];
+  uint32_t seqs[sizeof (cases) / sizeof (cases[0])];
+  gv.config.pcap_buffer_size = buffer_size;
+  gv.config.pcap_guid_prefixes = "1107a3c:*,2?b:0:*";
+  make_name (name, sizeof (name), "prefix", -1);
+  struct pcap_capture *pc = gv.pcap = new_pcap_capture (&gv, name);
+  CU_ASSERT_FATAL (pc != NULL);
+  const ddsrt_wctime_t t0 = ddsrt_time_wallclock ();
+  for (uint32_t i = 0; i < ncases; i++)
+    write_rtps_packet (i, cases[i].prefix0, t0);
+  free_pcap_capture (pc);
+
+  const int n = read_rtps_seqs (name, seqs, (int) ncases);
+  int k = 0;
+  for (uint32_t i = 0; i < ncases; i++)
+  {
+    if (!cases[i].pass)
+      continue;
+    CU_ASSERT_FATAL (k < n);
+    CU_ASSERT (seqs[k] == i);
+    k++;
+  }
+  CU_ASSERT (k == n);
+}
+
+CU_Test (ddsi_pcap, guid_prefix_filter, .init = pcap_init, .fini = pcap_fini)
+{
+  guid_prefix_filter (0);
+}
+
+CU_Test (ddsi_pcap, guid_prefix_filter_buffered, .init = pcap_init, .fini = pcap_fini)
+{
+  guid_prefix_filter (1);
+}
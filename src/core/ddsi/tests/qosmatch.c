@@ -0,0 +1,128 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <string.h>
+
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/string.h"
+#include "dds/ddsi/ddsi_xqos.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/q_qosmatch.h"
+#include "CUnit/Theory.h"
+
+static struct ddsi_domaingv gv;
+
+static void qosmatch_init (void)
+{
+  memset (&gv, 0, sizeof (gv));
+  gv.qos_match_cache = qos_match_cache_new ();
+}
+
+static void qosmatch_fini (void)
+{
+  qos_match_cache_free (gv.qos_match_cache);
+}
+
+static void make_qos (dds_qos_t *qos, const dds_qos_t *template, const char *partition)
+{
+  ddsi_xqos_copy (qos, template);
+  qos->present |= QP_TOPIC_NAME | QP_TYPE_NAME;
+  qos->topic_name = ddsrt_strdup ("topic");
+  qos->type_name = ddsrt_strdup ("type");
+  ddsi_xqos_fini_mask (qos, QP_PARTITION);
+  qos->present |= QP_PARTITION;
+  qos->partition.n = 1;
+  qos->partition.strs = ddsrt_malloc (sizeof (*qos->partition.strs));
+  qos->partition.strs[0] = ddsrt_strdup (partition);
+}
+
+static bool match (const dds_qos_t *rd, uint64_t rd_fp, const dds_qos_t *wr, uint64_t wr_fp, dds_qos_policy_id_t *reason)
+{
+#ifdef DDS_HAS_TYPE_DISCOVERY
+  const type_identifier_t none = { .hash = { 0 } };
+  return qos_match_cached_p (&gv, rd, rd_fp, wr, wr_fp, reason, &none, &none, NULL, NULL);
+#else
+  return qos_match_cached_p (&gv, rd, rd_fp, wr, wr_fp, reason);
+#endif
+}
+
+static void check_stats (uint64_t exp_hits, uint64_t exp_misses)
+{
+  uint64_t hits, misses;
+  qos_match_cache_get_stats (gv.qos_match_cache, &hits, &misses);
+  CU_ASSERT_EQUAL (hits, exp_hits);
+  CU_ASSERT_EQUAL (misses, exp_misses);
+}
+
+CU_Test (ddsi_qosmatch, cache_hit, .init = qosmatch_init, .fini = qosmatch_fini)
+{
+  dds_qos_t rd, wr;
+  dds_qos_policy_id_t reason;
+  make_qos (&rd, &ddsi_default_qos_reader, "a");
+  make_qos (&wr, &ddsi_default_qos_writer, "a");
+  const uint64_t rd_fp = qos_match_fingerprint (&rd), wr_fp = qos_match_fingerprint (&wr);
+  CU_ASSERT_FATAL (match (&rd, rd_fp, &wr, wr_fp, &reason));
+  check_stats (0, 1);
+  CU_ASSERT_FATAL (match (&rd, rd_fp, &wr, wr_fp, &reason));
+  check_stats (1, 1);
+
+  /* mismatch on reliability, cached as well */
+  rd.reliability.kind = DDS_RELIABILITY_RELIABLE;
+  wr.reliability.kind = DDS_RELIABILITY_BEST_EFFORT;
+  const uint64_t rd_fp1 = qos_match_fingerprint (&rd), wr_fp1 = qos_match_fingerprint (&wr);
+  CU_ASSERT_FATAL (rd_fp1 != rd_fp && wr_fp1 != wr_fp);
+  CU_ASSERT_FATAL (!match (&rd, rd_fp1, &wr, wr_fp1, &reason));
+  CU_ASSERT_EQUAL (reason, DDS_RELIABILITY_QOS_POLICY_ID);
+  CU_ASSERT_FATAL (!match (&rd, rd_fp1, &wr, wr_fp1, &reason));
+  CU_ASSERT_EQUAL (reason, DDS_RELIABILITY_QOS_POLICY_ID);
+  check_stats (2, 2);
+  ddsi_xqos_fini (&rd);
+  ddsi_xqos_fini (&wr);
+}
+
+CU_Test (ddsi_qosmatch, cache_collision, .init = qosmatch_init, .fini = qosmatch_fini)
+{
+  /* Colliding 64-bit fingerprints are impossible to construct in a test, but forcing
+     the same fingerprints for different QoS has the same effect.  The cached outcome
+     of a pair with different QoS must never be used. */
+  const uint64_t rd_fp = 1, wr_fp = 2;
+  dds_qos_t rd_a, rd_b, wr_a;
+  dds_qos_policy_id_t reason;
+  make_qos (&rd_a, &ddsi_default_qos_reader, "a");
+  make_qos (&rd_b, &ddsi_default_qos_reader, "b");
+  make_qos (&wr_a, &ddsi_default_qos_writer, "a");
+
+  CU_ASSERT_FATAL (match (&rd_a, rd_fp, &wr_a, wr_fp, &reason));
+  CU_ASSERT_FATAL (!match (&rd_b, rd_fp, &wr_a, wr_fp, &reason));
+  CU_ASSERT_EQUAL (reason, DDS_PARTITION_QOS_POLICY_ID);
+  check_stats (0, 2);
+  /* the colliding entry replaced the first one */
+  CU_ASSERT_FATAL (!match (&rd_b, rd_fp, &wr_a, wr_fp, &reason));
+  CU_ASSERT_EQUAL (reason, DDS_PARTITION_QOS_POLICY_ID);
+  check_stats (1, 2);
+  CU_ASSERT_FATAL (match (&rd_a, rd_fp, &wr_a, wr_fp, &reason));
+  check_stats (1, 3);
+
+  /* a difference in a QoS not involved in matching doesn't affect the cache */
+  rd_a.history.kind = DDS_HISTORY_KEEP_ALL;
+  CU_ASSERT_FATAL (match (&rd_a, rd_fp, &wr_a, wr_fp, &reason));
+  check_stats (2, 3);
+
+  /* the topic and type names are part of it, too */
+  ddsrt_free (wr_a.topic_name);
+  wr_a.topic_name = ddsrt_strdup ("other");
+  CU_ASSERT_FATAL (!match (&rd_a, rd_fp, &wr_a, wr_fp, &reason));
+  check_stats (2, 4);
+
+  ddsi_xqos_fini (&rd_a);
+  ddsi_xqos_fini (&rd_b);
+  ddsi_xqos_fini (&wr_a);
+}
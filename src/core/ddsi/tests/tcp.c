@@ -0,0 +1,247 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <string.h>
+
+#include "dds/ddsrt/cdtors.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/sockets.h"
+#include "dds/ddsrt/time.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/ddsi_entity_index.h"
+#include "dds/ddsi/ddsi_tran.h"
+#include "dds/ddsi/ddsi_tcp.h"
+#include "dds/ddsi/q_sockwaitset.h"
+#include "dds/ddsi/q_thread.h"
+#include "CUnit/Theory.h"
+
+#define MSGSIZE 8192
+/* upper bound on the number of messages needed to fill the socket buffers and the queue */
+#define MAX_MSGS 20000
+
+static struct ddsi_domaingv gv;
+static struct ddsi_tran_factory *fact;
+static ddsi_tran_conn_t conn;
+static ddsrt_socket_t peer_listener;
+static ddsi_locator_t peer_loc;
+
+static int tcp_setup (const char *overflow_peers, enum ddsi_tcp_sendq_overflow overflow, dds_duration_t write_timeout)
+{
+  ddsrt_init ();
+  thread_states_init (16);
+  conn = NULL;
+  peer_listener = DDSRT_INVALID_SOCKET;
+  memset (&gv, 0, sizeof (gv));
+  ddsi_config_init_default (&gv.config);
+  gv.config.transport_selector = DDSI_TRANS_TCP;
+  gv.config.tcp_sendq_size = 64 * 1024;
+  gv.config.tcp_sendq_overflow = overflow;
+  gv.config.tcp_sendq_overflow_peers = (char *) overflow_peers;
+  gv.config.tcp_write_timeout = write_timeout;
+  /* closing a connection purges proxy participants reachable via it */
+  gv.entity_index = entity_index_new (&gv);
+  /* connections are added to the waitset of the receive thread, which doesn't exist here */
+  gv.n_recv_threads = 1;
+  gv.recv_threads[0].arg.mode = RTM_MANY;
+  gv.recv_threads[0].arg.u.many.ws = os_sockWaitsetNew ();
+  if (ddsi_tcp_init (&gv) < 0)
+    return -1;
+  fact = ddsi_factory_find (&gv, "tcp");
+  CU_ASSERT_FATAL (fact != NULL);
+
+  /* The peer is a listening socket: the kernel accepts the connection, but nothing reads
+     from it until the test accepts it.  A small receive buffer makes the writer run into
+     a full send queue sooner. */
+  union { struct sockaddr a; struct sockaddr_in a4; } addr;
+  socklen_t addrlen = sizeof (addr);
+  const int rcvbuf = 16384;
+  memset (&addr, 0, sizeof (addr));
+  addr.a4.sin_family = AF_INET;
+  addr.a4.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  CU_ASSERT_FATAL (ddsrt_socket (&peer_listener, AF_INET, SOCK_STREAM, 0) == DDS_RETCODE_OK);
+  CU_ASSERT_FATAL (ddsrt_setsockopt (peer_listener, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof (rcvbuf)) == DDS_RETCODE_OK);
+  CU_ASSERT_FATAL (ddsrt_bind (peer_listener, &addr.a, sizeof (addr.a4)) == DDS_RETCODE_OK);
+  CU_ASSERT_FATAL (ddsrt_listen (peer_listener, 1) == DDS_RETCODE_OK);
+  CU_ASSERT_FATAL (ddsrt_getsockname (peer_listener, &addr.a, &addrlen) == DDS_RETCODE_OK);
+  memset (&peer_loc, 0, sizeof (peer_loc));
+  peer_loc.kind = NN_LOCATOR_KIND_TCPv4;
+  memcpy (peer_loc.address + 12, &addr.a4.sin_addr.s_addr, 4);
+  peer_loc.port = ntohs (addr.a4.sin_port);
+  /* the connection is for transmitting, which requires an interface */
+  gv.interfaces[0].loc = peer_loc;
+  gv.interfaces[0].loc.port = 0;
+  gv.interfaces[0].extloc = gv.interfaces[0].loc;
+  gv.interfaces[0].loopback = 1;
+  gv.interfaces[0].name = (char *) "lo";
+  gv.n_interfaces = 1;
+
+  const ddsi_tran_qos_t qos = { .m_purpose = DDSI_TRAN_QOS_XMIT, .m_diffserv = 0, .m_interface = &gv.interfaces[0] };
+  CU_ASSERT_FATAL (ddsi_factory_create_conn (&conn, fact, 0, &qos) == DDS_RETCODE_OK);
+  return 0;
+}
+
+static void tcp_teardown (void)
+{
+  if (peer_listener != DDSRT_INVALID_SOCKET)
+    ddsrt_close (peer_listener);
+  peer_listener = DDSRT_INVALID_SOCKET;
+  if (conn)
+  {
+    /* The receive thread frees the connection to the peer once the peer closes it,
+       dropping the reference held for the waitset.  There is no receive thread here,
+       so do the same. */
+    ddsi_tran_conn_t peer_conn = NULL;
+    while (peer_conn == NULL)
+    {
+      os_sockWaitsetCtx ctx;
+      ddsi_tran_conn_t c;
+      if ((ctx = os_sockWaitsetWait (gv.recv_threads[0].arg.u.many.ws)) != NULL)
+        while (os_sockWaitsetNextEvent (ctx, &c) >= 0)
+          peer_conn = c;
+    }
+    ddsi_conn_free (peer_conn);
+    ddsi_conn_free (conn);
+  }
+  conn = NULL;
+  while (gv.ddsi_tran_factories)
+  {
+    struct ddsi_tran_factory *f = gv.ddsi_tran_factories;
+    gv.ddsi_tran_factories = f->m_factory;
+    ddsi_factory_free (f);
+  }
+  os_sockWaitsetFree (gv.recv_threads[0].arg.u.many.ws);
+  entity_index_free (gv.entity_index);
+  (void) thread_states_fini ();
+  ddsrt_fini ();
+}
+
+/* message starts with the sequence number, followed by bytes derived from it */
+static void make_msg (unsigned char *buf, uint32_t seq)
+{
+  buf[0] = (unsigned char) (seq >> 24); buf[1] = (unsigned char) (seq >> 16);
+  buf[2] = (unsigned char) (seq >> 8); buf[3] = (unsigned char) seq;
+  for (uint32_t i = 4; i < MSGSIZE; i++)
+    buf[i] = (unsigned char) (seq + i);
+}
+
+static ssize_t write_msg (uint32_t seq)
+{
+  static unsigned char buf[MSGSIZE];
+  make_msg (buf, seq);
+  /* in two pieces, like an RTPS message consisting of a header and a submessage */
+  const ddsrt_iovec_t iov[2] = {
+    { .iov_base = buf, .iov_len = 20 },
+    { .iov_base = buf + 20, .iov_len = MSGSIZE - 20 }
+  };
+  return ddsi_conn_write (conn, &peer_loc, 2, iov, 0);
+}
+
+/* writes messages until one is rejected, returns the number of messages accepted and the
+   time it took to reject the message */
+static uint32_t write_until_rejected (dds_duration_t *reject_time)
+{
+  for (uint32_t seq = 0; seq < MAX_MSGS; seq++)
+  {
+    const dds_time_t t0 = dds_time ();
+    const ssize_t ret = write_msg (seq);
+    if (ret < 0)
+    {
+      *reject_time = dds_time () - t0;
+      return seq;
+    }
+    CU_ASSERT_FATAL (ret == MSGSIZE);
+  }
+  CU_FAIL_FATAL ("send queue never filled up");
+  return 0;
+}
+
+static void read_msgs (ddsrt_socket_t sock, uint32_t seq, uint32_t n)
+{
+  static unsigned char exp[MSGSIZE], buf[MSGSIZE];
+  for (uint32_t i = 0; i < n; i++)
+  {
+    size_t pos = 0;
+    while (pos < MSGSIZE)
+    {
+      ssize_t cnt;
+      CU_ASSERT_FATAL (ddsrt_recv (sock, buf + pos, MSGSIZE - pos, 0, &cnt) == DDS_RETCODE_OK);
+      CU_ASSERT_FATAL (cnt > 0);
+      pos += (size_t) cnt;
+    }
+    make_msg (exp, seq + i);
+    CU_ASSERT_FATAL (memcmp (buf, exp, MSGSIZE) == 0);
+  }
+}
+
+CU_Test (ddsi_tcp, sendq_overflow_drop, .timeout = 60)
+{
+  CU_ASSERT_FATAL (tcp_setup ("", DDSI_TCP_SENDQ_DROP, DDS_SECS (10)) == 0);
+  dds_duration_t reject_time;
+  const uint32_t nwritten = write_until_rejected (&reject_time);
+  /* dropping mustn't wait for the queue to drain */
+  CU_ASSERT_FATAL (reject_time < DDS_SECS (5));
+  for (uint32_t i = 1; i <= 10; i++)
+    CU_ASSERT_FATAL (write_msg (nwritten + i) < 0);
+
+  /* once the peer starts reading, it must receive everything that was accepted intact and
+     in order, and nothing of the dropped messages */
+  ddsrt_socket_t sock;
+  CU_ASSERT_FATAL (ddsrt_accept (peer_listener, NULL, NULL, &sock) == DDS_RETCODE_OK);
+  read_msgs (sock, 0, nwritten);
+  /* the queue drains, so writing is possible again */
+  const uint32_t seq = nwritten + 11;
+  ssize_t ret;
+  const dds_time_t tend = dds_time () + DDS_SECS (5);
+  while ((ret = write_msg (seq)) < 0 && dds_time () < tend)
+    dds_sleepfor (DDS_MSECS (10));
+  CU_ASSERT_FATAL (ret == MSGSIZE);
+  read_msgs (sock, seq, 1);
+  ddsrt_close (sock);
+  tcp_teardown ();
+}
+
+CU_Test (ddsi_tcp, sendq_overflow_block, .timeout = 60)
+{
+  const dds_duration_t write_timeout = DDS_MSECS (500);
+  CU_ASSERT_FATAL (tcp_setup ("", DDSI_TCP_SENDQ_BLOCK, write_timeout) == 0);
+  dds_duration_t reject_time;
+  (void) write_until_rejected (&reject_time);
+  /* blocked until the queue made no progress for the write timeout: the timer starts when
+     the queue first fills, which is slightly earlier than the rejected write */
+  CU_ASSERT_FATAL (reject_time >= write_timeout / 2);
+  tcp_teardown ();
+}
+
+CU_Test (ddsi_tcp, sendq_overflow_per_peer, .timeout = 60)
+{
+  dds_duration_t reject_time;
+
+  /* blocking by default, but not for the peer on the loopback address */
+  CU_ASSERT_FATAL (tcp_setup ("10.*=block,127.0.0.1=drop,*=block", DDSI_TCP_SENDQ_BLOCK, DDS_SECS (10)) == 0);
+  (void) write_until_rejected (&reject_time);
+  CU_ASSERT_FATAL (reject_time < DDS_SECS (5));
+  tcp_teardown ();
+
+  /* dropping by default, but not for the peer on the loopback address */
+  const dds_duration_t write_timeout = DDS_MSECS (500);
+  CU_ASSERT_FATAL (tcp_setup ("127.0.0.*=block", DDSI_TCP_SENDQ_DROP, write_timeout) == 0);
+  (void) write_until_rejected (&reject_time);
+  CU_ASSERT_FATAL (reject_time >= write_timeout / 2);
+  tcp_teardown ();
+}
+
+CU_Test (ddsi_tcp, sendq_overflow_peers_invalid)
+{
+  CU_ASSERT_FATAL (tcp_setup ("127.0.0.1=wait", DDSI_TCP_SENDQ_BLOCK, DDS_SECS (1)) < 0);
+  tcp_teardown ();
+  CU_ASSERT_FATAL (tcp_setup ("=drop", DDSI_TCP_SENDQ_BLOCK, DDS_SECS (1)) < 0);
+  tcp_teardown ();
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "dds/dds.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/bswap.h"
+#include "dds/ddsrt/time.h"
+#include "dds/ddsi/ddsi_serdata.h"
+#include "dds__topic.h"
+#include "dds__types.h"
+#include "NormalizeBenchTypes.h"
+
+/* Microbenchmark for byte swapping primitive arrays, both the bare kernels and
+   deserializing big-endian sequences of primitives on a little-endian machine
+   (and vice versa), for payloads from 1kB to 4MB.
+
+   Usage: normalize_bench [MB-PER-MEASUREMENT]
+
+   Each measurement processes (at least) the specified amount of data, default
+   256MB.  The "scalar" column is an element-by-element loop, "array" uses
+   ddsrt_bswapXu_array, and "from_ser" constructs a serdata from a CDR payload
+   in the non-native byte order, which includes normalizing it. */
+
+#define MIN_BYTES 1024u
+#define MAX_BYTES (4u * 1024u * 1024u)
+
+static void bswap_scalar (void *buf, uint32_t elem_size, size_t n)
+{
+  switch (elem_size)
+  {
+    case 2: { uint16_t *xs = buf; for (size_t i = 0; i < n; i++) xs[i] = ddsrt_bswap2u (xs[i]); break; }
+    case 4: { uint32_t *xs = buf; for (size_t i = 0; i < n; i++) xs[i] = ddsrt_bswap4u (xs[i]); break; }
+    case 8: { uint64_t *xs = buf; for (size_t i = 0; i < n; i++) xs[i] = ddsrt_bswap8u (xs[i]); break; }
+  }
+}
+
+static void bswap_array (void *buf, uint32_t elem_size, size_t n)
+{
+  switch (elem_size)
+  {
+    case 2: ddsrt_bswap2u_array (buf, buf, n); break;
+    case 4: ddsrt_bswap4u_array (buf, buf, n); break;
+    case 8: ddsrt_bswap8u_array (buf, buf, n); break;
+  }
+}
+
+static double gbps (uint64_t bytes, dds_duration_t dt)
+{
+  return (dt > 0) ? (double) bytes / (double) dt : 0.0;
+}
+
+static dds_duration_t time_kernel (void (*f) (void *buf, uint32_t elem_size, size_t n), void *buf, uint32_t elem_size, uint32_t nbytes, uint32_t reps)
+{
+  const dds_time_t t0 = dds_time ();
+  for (uint32_t i = 0; i < reps; i++)
+    f (buf, elem_size, nbytes / elem_size);
+  return dds_time () - t0;
+}
+
+static dds_duration_t time_from_ser (const struct ddsi_sertype *type, const void *payload, uint32_t size, uint32_t reps)
+{
+  const ddsrt_iovec_t iov = { .iov_base = (void *) payload, .iov_len = size };
+  const dds_time_t t0 = dds_time ();
+  for (uint32_t i = 0; i < reps; i++)
+  {
+    struct ddsi_serdata *sd = ddsi_serdata_from_ser_iov (type, SDK_DATA, 1, &iov, size);
+    if (sd == NULL)
+    {
+      fprintf (stderr, "deserialization failed\n");
+      exit (2);
+    }
+    ddsi_serdata_unref (sd);
+  }
+  return dds_time () - t0;
+}
+
+/* CDR encoding of a struct containing a single sequence of "nbytes / elem_size"
+   primitives, in the non-native byte order */
+static void *make_payload (uint32_t elem_size, uint32_t nbytes, uint32_t *size)
+{
+  const uint32_t n = nbytes / elem_size;
+  const uint32_t pad = (elem_size == 8) ? 4 : 0;
+  *size = 4 + 4 + pad + nbytes;
+  unsigned char *p = ddsrt_malloc (*size);
+  p[0] = 0; p[1] = (DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN) ? 0 : 1; p[2] = p[3] = 0;
+  const uint32_t n_swapped = ddsrt_bswap4u (n);
+  memcpy (p + 4, &n_swapped, 4);
+  memset (p + 8, 0, pad);
+  for (uint32_t i = 0; i < nbytes; i++)
+    p[8 + pad + i] = (unsigned char) i;
+  return p;
+}
+
+int main (int argc, char **argv)
+{
+  uint64_t bytes_per_measurement = 256u * 1024u * 1024u;
+  if (argc > 1)
+    bytes_per_measurement = (uint64_t) strtoul (argv[1], NULL, 10) * 1024u * 1024u;
+
+  const dds_entity_t pp = dds_create_participant (DDS_DOMAIN_DEFAULT, NULL, NULL);
+  if (pp < 0)
+  {
+    fprintf (stderr, "dds_create_participant: %s\n", dds_strretcode (pp));
+    return 1;
+  }
+  const dds_topic_descriptor_t *descs[] = { &NormalizeBench_Seq2_desc, &NormalizeBench_Seq4_desc, &NormalizeBench_Seq8_desc };
+  const char *names[] = { "normalize_bench_seq2", "normalize_bench_seq4", "normalize_bench_seq8" };
+  const struct ddsi_sertype *types[3];
+  for (int i = 0; i < 3; i++)
+  {
+    struct dds_topic *tp;
+    const dds_entity_t tpent = dds_create_topic (pp, descs[i], names[i], NULL, NULL);
+    if (tpent < 0 || dds_topic_pin (tpent, &tp) < 0)
+    {
+      fprintf (stderr, "topic creation failed\n");
+      return 1;
+    }
+    types[i] = tp->m_stype;
+    dds_topic_unpin (tp);
+  }
+
+  void *buf = ddsrt_malloc (MAX_BYTES);
+  memset (buf, 0x5a, MAX_BYTES);
+  printf ("%4s %9s %12s %12s %12s\n", "elem", "bytes", "scalar GB/s", "array GB/s", "from_ser GB/s");
+  for (uint32_t k = 0; k < 3; k++)
+  {
+    const uint32_t elem_size = 2u << k;
+    for (uint32_t nbytes = MIN_BYTES; nbytes <= MAX_BYTES; nbytes *= 4)
+    {
+      const uint32_t reps = (uint32_t) ((bytes_per_measurement + nbytes - 1) / nbytes);
+      const uint64_t total = (uint64_t) reps * nbytes;
+      const dds_duration_t dt_scalar = time_kernel (bswap_scalar, buf, elem_size, nbytes, reps);
+      const dds_duration_t dt_array = time_kernel (bswap_array, buf, elem_size, nbytes, reps);
+      uint32_t size;
+      void *payload = make_payload (elem_size, nbytes, &size);
+      const dds_duration_t dt_from_ser = time_from_ser (types[k], payload, size, reps);
+      ddsrt_free (payload);
+      printf ("%4"PRIu32" %9"PRIu32" %12.2f %12.2f %12.2f\n", elem_size, nbytes,
+              gbps (total, dt_scalar), gbps (total, dt_array), gbps (total, dt_from_ser));
+      fflush (stdout);
+    }
+  }
+  ddsrt_free (buf);
+  dds_delete (pp);
+  return 0;
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <inttypes.h>
+
+#include "dds/dds.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/random.h"
+#include "dds/ddsrt/time.h"
+#include "dds/ddsrt/fibheap.h"
+#include "dds/ddsrt/timerwheel.h"
+
+/* Microbenchmark comparing the two data structures available for the timed
+   events in the event queue (Internal/EventQueueScheduler): the Fibonacci
+   heap and the hierarchical timing wheel, for 1k to 1M scheduled timers.
+
+   Usage: timer_bench [OPS-PER-MEASUREMENT]
+
+   Time is simulated, so the numbers are the cost of the data structure
+   operations only, in ns per operation:
+   - resched: move a random timer to "now + period", the way deadline
+     missed events get pushed back whenever an instance is updated;
+   - cancel: delete a random timer and insert it again;
+   - expire: advance time in steps of 1ms and handle all due timers by
+     rescheduling them one period later, the way periodic heartbeats work.
+   Timer periods are uniformly distributed between 10ms and 1s. */
+
+#define MIN_TIMERS 1000u
+#define MAX_TIMERS 1000000u
+
+struct timer {
+  ddsrt_fibheap_node_t fhnode;
+  ddsrt_timerwheel_node_t twnode;
+  int64_t tsched;
+  int64_t period;
+};
+
+static int cmp_timer (const void *va, const void *vb)
+{
+  const struct timer *a = va, *b = vb;
+  return (a->tsched == b->tsched) ? 0 : (a->tsched < b->tsched) ? -1 : 1;
+}
+
+static const ddsrt_fibheap_def_t fhdef = DDSRT_FIBHEAPDEF_INITIALIZER (offsetof (struct timer, fhnode), cmp_timer);
+static const ddsrt_timerwheel_def_t twdef = DDSRT_TIMERWHEELDEF_INITIALIZER (offsetof (struct timer, twnode), offsetof (struct timer, tsched));
+
+struct sched {
+  const char *name;
+  void (*init) (void *s);
+  void (*insert) (void *s, struct timer *t);
+  void (*delete) (void *s, struct timer *t);
+  struct timer * (*extract_due) (void *s, int64_t tnow);
+};
+
+static void fh_init (void *s) { ddsrt_fibheap_init (&fhdef, s); }
+static void fh_insert (void *s, struct timer *t) { ddsrt_fibheap_insert (&fhdef, s, t); }
+static void fh_delete (void *s, struct timer *t) { ddsrt_fibheap_delete (&fhdef, s, t); }
+static struct timer *fh_extract_due (void *s, int64_t tnow)
+{
+  struct timer *min = ddsrt_fibheap_min (&fhdef, s);
+  return (min == NULL || min->tsched > tnow) ? NULL : ddsrt_fibheap_extract_min (&fhdef, s);
+}
+
+static void tw_init (void *s) { ddsrt_timerwheel_init (&twdef, s); }
+static void tw_insert (void *s, struct timer *t) { ddsrt_timerwheel_insert (&twdef, s, t); }
+static void tw_delete (void *s, struct timer *t) { ddsrt_timerwheel_delete (&twdef, s, t); }
+static struct timer *tw_extract_due (void *s, int64_t tnow) { return ddsrt_timerwheel_extract_due (&twdef, s, tnow); }
+
+static const struct sched scheds[] = {
+  { "heap", fh_init, fh_insert, fh_delete, fh_extract_due },
+  { "wheel", tw_init, tw_insert, tw_delete, tw_extract_due }
+};
+
+static void *setup (const struct sched *sc, struct timer *ts, uint32_t n, ddsrt_prng_t *prng)
+{
+  /* large enough for either */
+  void *s = ddsrt_malloc (sizeof (ddsrt_timerwheel_t) > sizeof (ddsrt_fibheap_t) ? sizeof (ddsrt_timerwheel_t) : sizeof (ddsrt_fibheap_t));
+  sc->init (s);
+  for (uint32_t i = 0; i < n; i++)
+  {
+    ts[i].period = DDS_MSECS (10) + (int64_t) (ddsrt_prng_random (prng) % DDS_MSECS (990));
+    ts[i].tsched = DDS_SECS (1) + ts[i].period;
+    sc->insert (s, &ts[i]);
+  }
+  return s;
+}
+
+static double bench_resched (const struct sched *sc, struct timer *ts, uint32_t n, uint32_t ops)
+{
+  ddsrt_prng_t prng;
+  ddsrt_prng_init_simple (&prng, 1);
+  void *s = setup (sc, ts, n, &prng);
+  int64_t tnow = DDS_SECS (1);
+  const dds_time_t t0 = dds_time ();
+  for (uint32_t i = 0; i < ops; i++)
+  {
+    struct timer *t = &ts[ddsrt_prng_random (&prng) % n];
+    sc->delete (s, t);
+    t->tsched = tnow + t->period;
+    sc->insert (s, t);
+    tnow += 100;
+  }
+  const dds_time_t t1 = dds_time ();
+  ddsrt_free (s);
+  return (double) (t1 - t0) / ops;
+}
+
+static double bench_cancel (const struct sched *sc, struct timer *ts, uint32_t n, uint32_t ops)
+{
+  ddsrt_prng_t prng;
+  ddsrt_prng_init_simple (&prng, 2);
+  void *s = setup (sc, ts, n, &prng);
+  const dds_time_t t0 = dds_time ();
+  for (uint32_t i = 0; i < ops; i++)
+  {
+    struct timer *t = &ts[ddsrt_prng_random (&prng) % n];
+    sc->delete (s, t);
+    sc->insert (s, t);
+  }
+  const dds_time_t t1 = dds_time ();
+  ddsrt_free (s);
+  return (double) (t1 - t0) / ops;
+}
+
+static double bench_expire (const struct sched *sc, struct timer *ts, uint32_t n, uint32_t ops)
+{
+  ddsrt_prng_t prng;
+  ddsrt_prng_init_simple (&prng, 3);
+  void *s = setup (sc, ts, n, &prng);
+  int64_t tnow = DDS_SECS (1);
+  uint32_t count = 0;
+  const dds_time_t t0 = dds_time ();
+  while (count < ops)
+  {
+    struct timer *t;
+    tnow += DDS_MSECS (1);
+    while ((t = sc->extract_due (s, tnow)) != NULL)
+    {
+      t->tsched += t->period;
+      sc->insert (s, t);
+      count++;
+    }
+  }
+  const dds_time_t t1 = dds_time ();
+  ddsrt_free (s);
+  return (double) (t1 - t0) / count;
+}
+
+int main (int argc, char **argv)
+{
+  uint32_t ops = 2000000;
+  if (argc > 1)
+    ops = (uint32_t) strtoul (argv[1], NULL, 10);
+
+  struct timer *ts = ddsrt_malloc (MAX_TIMERS * sizeof (*ts));
+  printf ("%8s %6s %12s %12s %12s\n", "timers", "", "resched ns", "cancel ns", "expire ns");
+  for (uint32_t n = MIN_TIMERS; n <= MAX_TIMERS; n *= 10)
+  {
+    for (size_t k = 0; k < sizeof (scheds) / sizeof (scheds[0]); k++)
+    {
+      const double resched = bench_resched (&scheds[k], ts, n, ops);
+      const double cancel = bench_cancel (&scheds[k], ts, n, ops);
+      const double expire = bench_expire (&scheds[k], ts, n, ops);
+      printf ("%8"PRIu32" %6s %12.1f %12.1f %12.1f\n", n, scheds[k].name, resched, cancel, expire);
+      fflush (stdout);
+    }
+  }
+  ddsrt_free (ts);
+  return 0;
+}
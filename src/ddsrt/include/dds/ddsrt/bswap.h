@@ -60,6 +60,24 @@ DDS_INLINE_EXPORT inline int64_t ddsrt_bswap8 (int64_t x)
   return (int64_t) ddsrt_bswap8u ((uint64_t) x);
 }
 
+/**
+ * @brief Byte swaps an array of 2-byte values
+ *
+ * Uses SIMD instructions when the platform supports them, including
+ * instruction set extensions that are only detected at run-time.
+ *
+ * @param[out] dst  destination, either equal to "src" or not overlapping it
+ * @param[in]  src  source
+ * @param[in]  n    number of elements
+ */
+DDS_EXPORT void ddsrt_bswap2u_array (uint16_t *dst, const uint16_t *src, size_t n);
+
+/** @brief Byte swaps an array of 4-byte values, see ddsrt_bswap2u_array */
+DDS_EXPORT void ddsrt_bswap4u_array (uint32_t *dst, const uint32_t *src, size_t n);
+
+/** @brief Byte swaps an array of 8-byte values, see ddsrt_bswap2u_array */
+DDS_EXPORT void ddsrt_bswap8u_array (uint64_t *dst, const uint64_t *src, size_t n);
+
 #if DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN
 #define ddsrt_toBE2(x) ddsrt_bswap2 (x)
 #define ddsrt_toBE2u(x) ddsrt_bswap2u (x)
@@ -26,6 +26,7 @@
 
 #include "dds/export.h"
 #include "dds/ddsrt/attributes.h"
+#include "dds/ddsrt/retcode.h"
 
 #if defined (__cplusplus)
 extern "C" {
@@ -252,6 +253,47 @@ dds_log_cfg_init(
     FILE *log_fp,
     FILE *trace_fp);
 
+/**
+ * @brief Switch the trace output of a struct ddsrt_log_cfg to the binary format
+ *
+ * Instead of formatting trace messages and writing them to the trace file
+ * synchronously, the format string and the arguments are stored in a
+ * per-thread ring buffer and written to the trace file by a background
+ * thread. The trace sink is not used for the trace output. Messages that
+ * fall into the log categories still go to the log as usual. Messages get
+ * dropped (and this is recorded in the file) if a thread produces them faster
+ * than they are written. The tools/decode-trace script converts the file into
+ * the usual text format.
+ *
+ * @param[in,out] cfg         Log configuration initialised using
+ *                            #dds_log_cfg_init with a non-null trace file.
+ *
+ * @returns A dds_return_t indicating success or failure.
+ *
+ * @retval DDS_RETCODE_OK
+ *             Binary tracing is enabled.
+ * @retval DDS_RETCODE_BAD_PARAMETER
+ *             There is no trace file.
+ * @retval DDS_RETCODE_OUT_OF_RESOURCES
+ *             Too many trace files are in use.
+ */
+DDS_EXPORT dds_return_t
+dds_log_cfg_set_binary_trace(
+    struct ddsrt_log_cfg *cfg);
+
+/**
+ * @brief Write all pending binary trace data to a file and stop using it
+ *
+ * Must be called before closing a trace file used for binary tracing, there
+ * may be no further tracing using configurations referring to the file once
+ * it has been called. It is a no-op for files not used for binary tracing.
+ *
+ * @param[in]  trace_fp       Trace file.
+ */
+DDS_EXPORT void
+dds_log_binary_trace_close(
+    FILE *trace_fp);
+
 /**
  * @brief Write a log or trace message for a specific logging configuraiton
  * (categories, id, sinks).
@@ -109,6 +109,56 @@ ddsrt_recvmsg(
   int flags,
   ssize_t *rcvd);
 
+#if DDSRT_HAVE_MMSG
+/**
+ * @brief Receive multiple messages from a socket in a single call.
+ *
+ * Blocks (for a blocking socket) until at least one message is available,
+ * then returns as many of the immediately available messages as fit in
+ * @msgvec without waiting for more. The size of each message is stored in
+ * the msg_len field of its entry.
+ *
+ * @param[in]  sock   Socket to receive from.
+ * @param[in]  msgvec Array of message headers to receive into.
+ * @param[in]  vlen   Number of entries in @msgvec.
+ * @param[in]  flags  Flags as for ddsrt_recvmsg.
+ * @param[out] rcvd   Number of messages received.
+ *
+ * @returns A dds_return_t indicating success or failure.
+ */
+DDS_EXPORT dds_return_t
+ddsrt_recvmmsg(
+  ddsrt_socket_t sock,
+  ddsrt_mmsghdr_t *msgvec,
+  uint32_t vlen,
+  int flags,
+  uint32_t *rcvd);
+
+/**
+ * @brief Send multiple messages over a socket in a single call.
+ *
+ * Messages are sent in order, stopping at the first one that cannot be
+ * sent. The number of bytes sent for each message is stored in the msg_len
+ * field of its entry. If the first message fails, the error is returned,
+ * otherwise the number of messages sent is returned in @sent.
+ *
+ * @param[in]  sock   Socket to send on.
+ * @param[in]  msgvec Array of message headers to send.
+ * @param[in]  vlen   Number of entries in @msgvec.
+ * @param[in]  flags  Flags as for ddsrt_sendmsg.
+ * @param[out] sent   Number of messages sent.
+ *
+ * @returns A dds_return_t indicating success or failure.
+ */
+DDS_EXPORT dds_return_t
+ddsrt_sendmmsg(
+  ddsrt_socket_t sock,
+  ddsrt_mmsghdr_t *msgvec,
+  uint32_t vlen,
+  int flags,
+  uint32_t *sent);
+#endif
+
 DDS_EXPORT dds_return_t
 ddsrt_getsockopt(
   ddsrt_socket_t sock,
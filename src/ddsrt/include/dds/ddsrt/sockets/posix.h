@@ -76,6 +76,18 @@ typedef struct msghdr ddsrt_msghdr_t;
 # define DDSRT_MSGHDR_FLAGS 1
 #endif
 
+#if defined(__linux) && !LWIP_SOCKET
+# define DDSRT_HAVE_MMSG 1
+/* Layout-compatible with Linux' struct mmsghdr, which is only declared when
+   compiling with _GNU_SOURCE */
+typedef struct ddsrt_mmsghdr {
+  ddsrt_msghdr_t msg_hdr;
+  unsigned int msg_len;
+} ddsrt_mmsghdr_t;
+#else
+# define DDSRT_HAVE_MMSG 0
+#endif
+
 #if defined(__cplusplus)
 }
 #endif
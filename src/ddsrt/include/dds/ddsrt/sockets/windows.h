@@ -49,6 +49,7 @@ typedef struct ddsrt_msghdr {
 } ddsrt_msghdr_t;
 
 #define DDSRT_MSGHDR_FLAGS 1
+#define DDSRT_HAVE_MMSG 0
 
 #if defined(__cplusplus)
 }
@@ -0,0 +1,86 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#ifndef DDSRT_TIMERWHEEL_H
+#define DDSRT_TIMERWHEEL_H
+
+/* Hierarchical timing wheel: an intrusive container of objects keyed on an
+   int64_t time stamp in nanoseconds that supports O(1) insert and delete and
+   extracts the objects that have become due in batches.
+
+   Time is divided into ticks of 2^DDSRT_TIMERWHEEL_TICK_SHIFT ns, and each of
+   the levels covers 64 times the range of the one below it.  Objects due in
+   the current tick are tracked exactly (they are never returned early); all
+   others are only sorted into buckets and cascade down as time advances.
+   Objects with a key at or before the time the wheel last advanced to are
+   due immediately. */
+
+#include <stdint.h>
+
+#include "dds/export.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+#define DDSRT_TIMERWHEEL_TICK_SHIFT 16
+#define DDSRT_TIMERWHEEL_LEVEL_BITS 6
+#define DDSRT_TIMERWHEEL_SLOTS (1u << DDSRT_TIMERWHEEL_LEVEL_BITS)
+#define DDSRT_TIMERWHEEL_LEVELS ((64 - DDSRT_TIMERWHEEL_TICK_SHIFT + DDSRT_TIMERWHEEL_LEVEL_BITS - 1) / DDSRT_TIMERWHEEL_LEVEL_BITS)
+
+typedef struct ddsrt_timerwheel_node {
+  struct ddsrt_timerwheel_node *next, *prev;
+  uint32_t slot;
+} ddsrt_timerwheel_node_t;
+
+typedef struct ddsrt_timerwheel_def {
+  uintptr_t offset; /* offset of node in object */
+  uintptr_t keyoffset; /* offset of int64_t key in object */
+} ddsrt_timerwheel_def_t;
+
+typedef struct ddsrt_timerwheel {
+  uint64_t now; /* tick the wheel has advanced to */
+  int64_t tlast; /* time the wheel has advanced to */
+  uint64_t nonempty[DDSRT_TIMERWHEEL_LEVELS];
+  ddsrt_timerwheel_node_t due;
+  ddsrt_timerwheel_node_t slots[DDSRT_TIMERWHEEL_LEVELS * DDSRT_TIMERWHEEL_SLOTS];
+} ddsrt_timerwheel_t;
+
+#define DDSRT_TIMERWHEELDEF_INITIALIZER(offset, keyoffset) { (offset), (keyoffset) }
+
+DDS_EXPORT void ddsrt_timerwheel_def_init (ddsrt_timerwheel_def_t *twdef, uintptr_t offset, uintptr_t keyoffset);
+DDS_EXPORT void ddsrt_timerwheel_init (const ddsrt_timerwheel_def_t *twdef, ddsrt_timerwheel_t *tw);
+DDS_EXPORT int ddsrt_timerwheel_is_empty (const ddsrt_timerwheel_def_t *twdef, const ddsrt_timerwheel_t *tw);
+
+/* Key may not be modified while the object is in the wheel: reschedule by
+   deleting it, updating the key, and inserting it again */
+DDS_EXPORT void ddsrt_timerwheel_insert (const ddsrt_timerwheel_def_t *twdef, ddsrt_timerwheel_t *tw, void *vnode);
+DDS_EXPORT void ddsrt_timerwheel_delete (const ddsrt_timerwheel_def_t *twdef, ddsrt_timerwheel_t *tw, void *vnode);
+
+/* Returns an object with a key <= tnow or NULL if there is none, advancing
+   the wheel to tnow if tnow is later than the last time it advanced to */
+DDS_EXPORT void *ddsrt_timerwheel_extract_due (const ddsrt_timerwheel_def_t *twdef, ddsrt_timerwheel_t *tw, int64_t tnow);
+
+/* Returns a lower bound on the keys of the objects in the wheel that is exact
+   for the objects that fall in the first non-empty tick, and INT64_MAX if the
+   wheel is empty.  It is therefore at or before the first time at which
+   ddsrt_timerwheel_extract_due returns an object, and a wheel advanced to a
+   coarse bound moves at least one bucket down. */
+DDS_EXPORT int64_t ddsrt_timerwheel_next (const ddsrt_timerwheel_def_t *twdef, const ddsrt_timerwheel_t *tw);
+
+/* Removes and returns an arbitrary object, for tearing down a wheel */
+DDS_EXPORT void *ddsrt_timerwheel_extract_any (const ddsrt_timerwheel_def_t *twdef, ddsrt_timerwheel_t *tw);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* DDSRT_TIMERWHEEL_H */
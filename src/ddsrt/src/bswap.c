@@ -18,3 +18,163 @@ DDS_EXPORT extern inline uint64_t ddsrt_bswap8u (uint64_t x);
 DDS_EXPORT extern inline int16_t ddsrt_bswap2 (int16_t x);
 DDS_EXPORT extern inline int32_t ddsrt_bswap4 (int32_t x);
 DDS_EXPORT extern inline int64_t ddsrt_bswap8 (int64_t x);
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define BSWAP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined __AVX2__
+#define BSWAP_AVX2 1
+#define BSWAP_TARGET_AVX2
+#define have_avx2() 1
+#elif defined BSWAP_SSE2 && (defined __GNUC__ || defined __clang__)
+/* AVX2 availability is checked at run-time, so the library still runs on older CPUs */
+#define BSWAP_AVX2 1
+#define BSWAP_TARGET_AVX2 __attribute__ ((target ("avx2")))
+#define have_avx2() __builtin_cpu_supports ("avx2")
+#endif
+
+#ifdef BSWAP_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined __ARM_NEON || defined __ARM_NEON__
+#define BSWAP_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* The kernels process "nbytes" of data (rounded down to a multiple of the vector size) and
+   return the number of bytes processed; "dst" may be equal to "src" */
+
+#ifdef BSWAP_AVX2
+BSWAP_TARGET_AVX2 static size_t bswap_avx2 (char *dst, const char *src, size_t nbytes, uint32_t elem_size)
+{
+  __m256i mask;
+  switch (elem_size)
+  {
+    case 2:
+      mask = _mm256_setr_epi8 (1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                               1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+      break;
+    case 4:
+      mask = _mm256_setr_epi8 (3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                               3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+      break;
+    default:
+      mask = _mm256_setr_epi8 (7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                               7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+      break;
+  }
+  size_t i = 0;
+  for (; i + 64 <= nbytes; i += 64)
+  {
+    const __m256i x0 = _mm256_loadu_si256 ((const __m256i *) (src + i));
+    const __m256i x1 = _mm256_loadu_si256 ((const __m256i *) (src + i + 32));
+    _mm256_storeu_si256 ((__m256i *) (dst + i), _mm256_shuffle_epi8 (x0, mask));
+    _mm256_storeu_si256 ((__m256i *) (dst + i + 32), _mm256_shuffle_epi8 (x1, mask));
+  }
+  for (; i + 32 <= nbytes; i += 32)
+  {
+    const __m256i x = _mm256_loadu_si256 ((const __m256i *) (src + i));
+    _mm256_storeu_si256 ((__m256i *) (dst + i), _mm256_shuffle_epi8 (x, mask));
+  }
+  return i;
+}
+#endif
+
+#ifdef BSWAP_SSE2
+static size_t bswap_sse2 (char *dst, const char *src, size_t nbytes, uint32_t elem_size)
+{
+  /* SSE2 has no byte shuffle: reorder the 16-bit words, then swap the bytes in each word */
+  size_t i = 0;
+  switch (elem_size)
+  {
+    case 2:
+      for (; i + 16 <= nbytes; i += 16)
+      {
+        const __m128i x = _mm_loadu_si128 ((const __m128i *) (src + i));
+        _mm_storeu_si128 ((__m128i *) (dst + i), _mm_or_si128 (_mm_slli_epi16 (x, 8), _mm_srli_epi16 (x, 8)));
+      }
+      break;
+    case 4:
+      for (; i + 16 <= nbytes; i += 16)
+      {
+        __m128i x = _mm_loadu_si128 ((const __m128i *) (src + i));
+        x = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (x, _MM_SHUFFLE (2, 3, 0, 1)), _MM_SHUFFLE (2, 3, 0, 1));
+        _mm_storeu_si128 ((__m128i *) (dst + i), _mm_or_si128 (_mm_slli_epi16 (x, 8), _mm_srli_epi16 (x, 8)));
+      }
+      break;
+    default:
+      for (; i + 16 <= nbytes; i += 16)
+      {
+        __m128i x = _mm_loadu_si128 ((const __m128i *) (src + i));
+        x = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (x, _MM_SHUFFLE (0, 1, 2, 3)), _MM_SHUFFLE (0, 1, 2, 3));
+        _mm_storeu_si128 ((__m128i *) (dst + i), _mm_or_si128 (_mm_slli_epi16 (x, 8), _mm_srli_epi16 (x, 8)));
+      }
+      break;
+  }
+  return i;
+}
+#endif
+
+#ifdef BSWAP_NEON
+static size_t bswap_neon (char *dst, const char *src, size_t nbytes, uint32_t elem_size)
+{
+  size_t i = 0;
+  switch (elem_size)
+  {
+    case 2:
+      for (; i + 16 <= nbytes; i += 16)
+        vst1q_u8 ((uint8_t *) (dst + i), vrev16q_u8 (vld1q_u8 ((const uint8_t *) (src + i))));
+      break;
+    case 4:
+      for (; i + 16 <= nbytes; i += 16)
+        vst1q_u8 ((uint8_t *) (dst + i), vrev32q_u8 (vld1q_u8 ((const uint8_t *) (src + i))));
+      break;
+    default:
+      for (; i + 16 <= nbytes; i += 16)
+        vst1q_u8 ((uint8_t *) (dst + i), vrev64q_u8 (vld1q_u8 ((const uint8_t *) (src + i))));
+      break;
+  }
+  return i;
+}
+#endif
+
+static size_t bswap_simd (void *vdst, const void *vsrc, size_t n, uint32_t elem_size)
+{
+  char *dst = vdst;
+  const char *src = vsrc;
+  const size_t nbytes = n * elem_size;
+  size_t i = 0;
+#ifdef BSWAP_AVX2
+  if (nbytes >= 32 && have_avx2 ())
+    i = bswap_avx2 (dst, src, nbytes, elem_size);
+#endif
+#ifdef BSWAP_SSE2
+  i += bswap_sse2 (dst + i, src + i, nbytes - i, elem_size);
+#elif defined BSWAP_NEON
+  i += bswap_neon (dst + i, src + i, nbytes - i, elem_size);
+#else
+  (void) dst; (void) src; (void) nbytes;
+#endif
+  return i / elem_size;
+}
+
+void ddsrt_bswap2u_array (uint16_t *dst, const uint16_t *src, size_t n)
+{
+  for (size_t i = bswap_simd (dst, src, n, 2); i < n; i++)
+    dst[i] = ddsrt_bswap2u (src[i]);
+}
+
+void ddsrt_bswap4u_array (uint32_t *dst, const uint32_t *src, size_t n)
+{
+  for (size_t i = bswap_simd (dst, src, n, 4); i < n; i++)
+    dst[i] = ddsrt_bswap4u (src[i]);
+}
+
+void ddsrt_bswap8u_array (uint64_t *dst, const uint64_t *src, size_t n)
+{
+  for (size_t i = bswap_simd (dst, src, n, 8); i < n; i++)
+    dst[i] = ddsrt_bswap8u (src[i]);
+}
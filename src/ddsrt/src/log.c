@@ -12,10 +12,16 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "dds/ddsrt/log.h"
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/hopscotch.h"
+#include "dds/ddsrt/mh3.h"
 #include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/threads.h"
 #include "dds/ddsrt/static_assert.h"
@@ -46,6 +52,7 @@ static ddsrt_rwlock_t lock;
 struct ddsrt_log_cfg_impl {
   struct ddsrt_log_cfg_common c;
   FILE *sink_fps[2];
+  uint32_t async_out; /* 0: text, else 1 + index of binary output */
 };
 
 DDSRT_STATIC_ASSERT (sizeof (struct ddsrt_log_cfg_impl) <= sizeof (struct ddsrt_log_cfg));
@@ -81,9 +88,636 @@ static log_sink_t sinks[2] = {
 
 uint32_t * const dds_log_mask = &logconfig.c.mask;
 
+/* Asynchronous binary tracing
+
+   Instead of formatting the message and writing it to the file, the thread
+   generating a trace message only determines the arguments from the format
+   string and appends a record containing those to a ring buffer private to
+   that thread.  A single writer thread drains all rings and writes the records
+   to the trace files.  The generating thread only takes a lock the first
+   time it traces and the first time it uses a format string: the ring is a
+   single-producer/single-consumer queue and the parsed format strings are
+   cached per thread.  Format strings are registered once, globally, and are
+   written to a file (as are thread names) before the first record that refers
+   to it.  When the ring is full, the message is dropped and the number of
+   messages dropped is recorded in the file as soon as there is room again.
+
+   Files start with "CDDSBTRC", the byte order marker 0x01020304 and the
+   version, all other data is in native byte order.  Each record starts with
+   its size in bytes (including the size and type) and its type:
+
+     THREAD:  u32 thread id, thread name (nul-terminated)
+     FORMAT:  u32 format id, format string (nul-terminated)
+     MSG:     u32 thread id, u32 category, u32 domain id, u32 format id,
+              i64 time, args
+     DROPPED: u32 thread id, u32 number of messages dropped
+
+   Integer, pointer and floating-point arguments are stored as 8 bytes, long
+   doubles are converted to doubles, strings as a u32 length (UINT32_MAX for a
+   null pointer) followed by the bytes.  Messages with a format the parser
+   doesn't understand are formatted by the thread and logged using format id
+   0, which is always "%s".  The tools/decode-trace script converts these
+   files back into text. */
+
+#define ASYNC_MAGIC "CDDSBTRC"
+#define ASYNC_VERSION 1u
+
+#define ASYNC_REC_THREAD 1u
+#define ASYNC_REC_FORMAT 2u
+#define ASYNC_REC_MSG 3u
+#define ASYNC_REC_DROPPED 4u
+
+#define ASYNC_MAX_OUTPUTS 32u
+#define ASYNC_MAX_ARGS 32u
+#define ASYNC_RING_SIZE (256u * 1024u)
+#define ASYNC_MAX_RECORD_SIZE 4096u
+#define ASYNC_FMTCACHE_SIZE 256u
+#define ASYNC_DRAIN_INTERVAL DDS_MSECS (10)
+
+/* in the ring, a MSG record has the index of the output inserted after the type */
+#define ASYNC_MSG_HDR_SIZE (7 * sizeof (uint32_t) + sizeof (int64_t))
+
+enum async_argkind {
+  AK_INT,
+  AK_LONG,
+  AK_LLONG,
+  AK_SIZE,
+  AK_INTMAX,
+  AK_PTRDIFF,
+  AK_DOUBLE,
+  AK_LDOUBLE,
+  AK_POINTER,
+  AK_STRING
+};
+
+struct async_arg {
+  enum async_argkind kind;
+  int32_t prec; /* strings: -1 = none, -2 = previous argument (".*") */
+};
+
+struct async_fmt {
+  uint32_t id;
+  bool fallback; /* format on the calling thread and log with id 0 */
+  uint32_t nargs;
+  uint32_t nstrings;
+  struct async_arg args[ASYNC_MAX_ARGS];
+  char str[];
+};
+
+struct async_fmtcache_entry {
+  const char *fmt;
+  const struct async_fmt *def;
+};
+
+struct async_ring {
+  ddsrt_atomic_uint32_t head; /* only written by the thread generating messages */
+  ddsrt_atomic_uint32_t tail; /* only written by the consumer */
+  ddsrt_atomic_uint32_t released; /* set when the thread terminates */
+  uint32_t id;
+  struct async_ring *next_free;
+  uint32_t announced; /* outputs that have the thread name, consumer only */
+  uint32_t ndropped; /* producer only */
+  bool midline; /* last message didn't end in a newline, producer only */
+  char name[32];
+  struct async_fmtcache_entry fmtcache[ASYNC_FMTCACHE_SIZE];
+  unsigned char rec[ASYNC_MAX_RECORD_SIZE];
+  unsigned char buf[ASYNC_RING_SIZE];
+};
+
+struct async_output {
+  FILE *fp;
+  uint32_t refc;
+  uint32_t nfmtbits;
+  unsigned char *fmtbits; /* formats already written to this output */
+};
+
+static struct {
+  /* ctrl_lock serializes adding/removing outputs, including starting and
+     stopping the writer thread; lock protects the rings, the outputs and
+     consuming data from the rings; fmt_lock protects the format table */
+  ddsrt_mutex_t ctrl_lock;
+  ddsrt_mutex_t lock;
+  ddsrt_cond_t cond;
+  ddsrt_mutex_t fmt_lock;
+  bool running;
+  bool stop;
+  ddsrt_thread_t tid;
+  uint32_t nrings;
+  struct async_ring **rings;
+  struct async_ring *free_rings;
+  uint32_t noutputs;
+  struct async_output outputs[ASYNC_MAX_OUTPUTS];
+  struct ddsrt_hh *fmts;
+  uint32_t nfmtdefs, maxfmtdefs;
+  struct async_fmt **fmtdefs;
+  unsigned char rec[ASYNC_MAX_RECORD_SIZE];
+} async;
+
+static ddsrt_thread_local struct async_ring *async_tl_ring;
+static ddsrt_thread_local bool async_tl_ring_released;
+
+static uint32_t async_fmt_hash (const void *vx)
+{
+  const struct async_fmt *x = vx;
+  return ddsrt_mh3 (x->str, strlen (x->str), 0);
+}
+
+static int async_fmt_eq (const void *va, const void *vb)
+{
+  const struct async_fmt *a = va, *b = vb;
+  return strcmp (a->str, b->str) == 0;
+}
+
+static bool async_fmt_addarg (struct async_fmt *def, enum async_argkind kind, int32_t prec)
+{
+  if (def->nargs == ASYNC_MAX_ARGS)
+    return false;
+  def->args[def->nargs].kind = kind;
+  def->args[def->nargs].prec = prec;
+  def->nargs++;
+  if (kind == AK_STRING)
+    def->nstrings++;
+  return true;
+}
+
+static bool async_parse_format (struct async_fmt *def, const char *fmt)
+{
+  def->nargs = def->nstrings = 0;
+  while ((fmt = strchr (fmt, '%')) != NULL)
+  {
+    fmt++;
+    if (*fmt == '%')
+    {
+      fmt++;
+      continue;
+    }
+    fmt += strspn (fmt, "-+ #0");
+    if (*fmt == '*')
+    {
+      if (!async_fmt_addarg (def, AK_INT, 0))
+        return false;
+      fmt++;
+    }
+    else
+    {
+      fmt += strspn (fmt, "0123456789");
+    }
+    int32_t prec = -1;
+    if (*fmt == '.')
+    {
+      fmt++;
+      if (*fmt == '*')
+      {
+        if (!async_fmt_addarg (def, AK_INT, 0))
+          return false;
+        prec = -2;
+        fmt++;
+      }
+      else
+      {
+        prec = 0;
+        for (; *fmt >= '0' && *fmt <= '9'; fmt++)
+          if (prec < 1000000)
+            prec = 10 * prec + (*fmt - '0');
+      }
+    }
+    enum async_argkind ikind = AK_INT;
+    bool has_length = true, is_ldouble = false;
+    switch (*fmt)
+    {
+      case 'h': fmt += (fmt[1] == 'h') ? 2 : 1; break;
+      case 'l':
+        if (fmt[1] == 'l') { ikind = AK_LLONG; fmt += 2; }
+        else { ikind = AK_LONG; fmt++; }
+        break;
+      case 'q': ikind = AK_LLONG; fmt++; break;
+      case 'z': ikind = AK_SIZE; fmt++; break;
+      case 'j': ikind = AK_INTMAX; fmt++; break;
+      case 't': ikind = AK_PTRDIFF; fmt++; break;
+      case 'L': is_ldouble = true; fmt++; break;
+      default: has_length = false; break;
+    }
+    bool ok;
+    switch (*fmt)
+    {
+      case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+        ok = !is_ldouble && async_fmt_addarg (def, ikind, 0);
+        break;
+      case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+        ok = async_fmt_addarg (def, is_ldouble ? AK_LDOUBLE : AK_DOUBLE, 0);
+        break;
+      case 'p':
+        ok = !has_length && async_fmt_addarg (def, AK_POINTER, 0);
+        break;
+      case 's':
+        ok = !has_length && async_fmt_addarg (def, AK_STRING, prec);
+        break;
+      default:
+        /* %n, wide characters and strings, and anything malformed */
+        ok = false;
+        break;
+    }
+    if (!ok)
+      return false;
+    fmt++;
+  }
+  return true;
+}
+
+static struct async_fmt *async_register_format_locked (const char *fmt)
+{
+  const size_t len = strlen (fmt);
+  struct async_fmt *def, *old;
+  if ((def = ddsrt_malloc_s (sizeof (*def) + len + 1)) == NULL)
+    return NULL;
+  memcpy (def->str, fmt, len + 1);
+  if ((old = ddsrt_hh_lookup (async.fmts, def)) != NULL)
+  {
+    ddsrt_free (def);
+    return old;
+  }
+  def->fallback = !async_parse_format (def, fmt);
+  if (def->fallback)
+    def->id = 0;
+  else if (async.nfmtdefs < async.maxfmtdefs)
+    def->id = async.nfmtdefs++;
+  else
+  {
+    const uint32_t maxfmtdefs = (async.maxfmtdefs == 0) ? 256 : 2 * async.maxfmtdefs;
+    struct async_fmt **fmtdefs;
+    if ((fmtdefs = ddsrt_realloc_s (async.fmtdefs, maxfmtdefs * sizeof (*fmtdefs))) == NULL)
+    {
+      ddsrt_free (def);
+      return NULL;
+    }
+    async.fmtdefs = fmtdefs;
+    async.maxfmtdefs = maxfmtdefs;
+    def->id = async.nfmtdefs++;
+  }
+  if (!def->fallback)
+    async.fmtdefs[def->id] = def;
+  (void) ddsrt_hh_add (async.fmts, def);
+  return def;
+}
+
+static const struct async_fmt *async_lookup_format (struct async_ring *r, const char *fmt)
+{
+  struct async_fmtcache_entry * const ce = &r->fmtcache[((uintptr_t) fmt >> 2) % ASYNC_FMTCACHE_SIZE];
+  /* the format need not be a string literal, so check the contents as well */
+  if (ce->fmt != fmt || strcmp (ce->def->str, fmt) != 0)
+  {
+    const struct async_fmt *def;
+    ddsrt_mutex_lock (&async.fmt_lock);
+    def = async_register_format_locked (fmt);
+    ddsrt_mutex_unlock (&async.fmt_lock);
+    if (def == NULL)
+      return NULL;
+    ce->fmt = fmt;
+    ce->def = def;
+  }
+  return ce->def;
+}
+
+static void async_ring_release (void *vr)
+{
+  struct async_ring * const r = vr;
+  ddsrt_atomic_fence_rel ();
+  ddsrt_atomic_st32 (&r->released, 1);
+  async_tl_ring = NULL;
+  async_tl_ring_released = true;
+}
+
+static struct async_ring *async_get_ring (void)
+{
+  struct async_ring *r;
+  if (async_tl_ring_released)
+    return NULL;
+  ddsrt_mutex_lock (&async.lock);
+  if ((r = async.free_rings) != NULL)
+  {
+    async.free_rings = r->next_free;
+    ddsrt_atomic_st32 (&r->released, 0);
+  }
+  else
+  {
+    struct async_ring **rings;
+    if ((rings = ddsrt_realloc_s (async.rings, (async.nrings + 1) * sizeof (*rings))) == NULL)
+    {
+      ddsrt_mutex_unlock (&async.lock);
+      return NULL;
+    }
+    async.rings = rings;
+    if ((r = ddsrt_malloc_s (sizeof (*r))) == NULL)
+    {
+      ddsrt_mutex_unlock (&async.lock);
+      return NULL;
+    }
+    ddsrt_atomic_st32 (&r->head, 0);
+    ddsrt_atomic_st32 (&r->tail, 0);
+    ddsrt_atomic_st32 (&r->released, 0);
+    r->id = async.nrings;
+    for (uint32_t i = 0; i < ASYNC_FMTCACHE_SIZE; i++)
+      r->fmtcache[i].fmt = NULL;
+    async.rings[async.nrings++] = r;
+  }
+  r->next_free = NULL;
+  r->announced = 0;
+  r->ndropped = 0;
+  r->midline = false;
+  (void) ddsrt_thread_getname (r->name, sizeof (r->name));
+  ddsrt_mutex_unlock (&async.lock);
+  /* if this fails, the ring simply never gets recycled */
+  (void) ddsrt_thread_cleanup_push (async_ring_release, r);
+  async_tl_ring = r;
+  return r;
+}
+
+static void async_ring_copy (unsigned char *dst, const unsigned char *ring, uint32_t pos, uint32_t n)
+{
+  const uint32_t off = pos % ASYNC_RING_SIZE;
+  const uint32_t n1 = (n <= ASYNC_RING_SIZE - off) ? n : ASYNC_RING_SIZE - off;
+  memcpy (dst, ring + off, n1);
+  memcpy (dst + n1, ring, n - n1);
+}
+
+static bool async_ring_push (struct async_ring *r, const unsigned char *rec, uint32_t size)
+{
+  const uint32_t head = ddsrt_atomic_ld32 (&r->head);
+  const uint32_t tail = ddsrt_atomic_ld32 (&r->tail);
+  ddsrt_atomic_fence_acq ();
+  if (size > ASYNC_RING_SIZE - (head - tail))
+    return false;
+  const uint32_t off = head % ASYNC_RING_SIZE;
+  const uint32_t n1 = (size <= ASYNC_RING_SIZE - off) ? size : ASYNC_RING_SIZE - off;
+  memcpy (r->buf + off, rec, n1);
+  memcpy (r->buf, rec + n1, size - n1);
+  ddsrt_atomic_fence_rel ();
+  ddsrt_atomic_st32 (&r->head, head + size);
+  /* the writer polls, but a burst could fill the ring before it looks again */
+  if (head + size - tail > ASYNC_RING_SIZE / 2)
+    ddsrt_cond_signal (&async.cond);
+  return true;
+}
+
+static unsigned char *async_put32 (unsigned char *p, uint32_t x)
+{
+  memcpy (p, &x, sizeof (x));
+  return p + sizeof (x);
+}
+
+static unsigned char *async_put64 (unsigned char *p, uint64_t x)
+{
+  memcpy (p, &x, sizeof (x));
+  return p + sizeof (x);
+}
+
+static unsigned char *async_putstr (unsigned char *p, const char *s, int64_t prec, size_t *space)
+{
+  size_t len;
+  if (s == NULL)
+    return async_put32 (p, UINT32_MAX);
+  if (prec < 0)
+    len = strlen (s);
+  else
+  {
+    /* the string need not be terminated if there's a precision */
+    const char *z = memchr (s, 0, (size_t) prec);
+    len = (z == NULL) ? (size_t) prec : (size_t) (z - s);
+  }
+  if (len > *space)
+    len = *space;
+  *space -= len;
+  p = async_put32 (p, (uint32_t) len);
+  memcpy (p, s, len);
+  return p + len;
+}
+
+static void async_trace (const struct ddsrt_log_cfg_impl *cfg, uint32_t cat, const char *fmt, va_list ap)
+{
+  struct async_ring *r;
+  const struct async_fmt *def;
+  if ((r = async_tl_ring) == NULL && (r = async_get_ring ()) == NULL)
+    return;
+
+  /* same treatment of leading newlines as in vlog1 */
+  if (!r->midline)
+  {
+    while (*fmt == '\n')
+      fmt++;
+  }
+  if (*fmt == 0)
+    return;
+  r->midline = (fmt[strlen (fmt) - 1] != '\n');
+  if ((def = async_lookup_format (r, fmt)) == NULL)
+    return;
+
+  unsigned char *p = r->rec + 2 * sizeof (uint32_t);
+  p = async_put32 (p, cfg->async_out - 1);
+  p = async_put32 (p, r->id);
+  p = async_put32 (p, cat);
+  p = async_put32 (p, cfg->c.domid);
+  p = async_put32 (p, def->id);
+  p = async_put64 (p, (uint64_t) dds_time ());
+  if (def->fallback)
+  {
+    char * const txt = (char *) p + sizeof (uint32_t);
+    const size_t space = ASYNC_MAX_RECORD_SIZE - ASYNC_MSG_HDR_SIZE - sizeof (uint32_t);
+    const int n = vsnprintf (txt, space, fmt, ap);
+    const size_t len = (n < 0) ? 0 : ((size_t) n >= space) ? space - 1 : (size_t) n;
+    p = async_put32 (p, (uint32_t) len) + len;
+  }
+  else
+  {
+    size_t space = ASYNC_MAX_RECORD_SIZE - ASYNC_MSG_HDR_SIZE - def->nargs * sizeof (uint64_t);
+    int64_t prevint = 0;
+    for (uint32_t i = 0; i < def->nargs; i++)
+    {
+      switch (def->args[i].kind)
+      {
+        case AK_INT: prevint = va_arg (ap, int); p = async_put64 (p, (uint64_t) prevint); break;
+        case AK_LONG: p = async_put64 (p, (uint64_t) va_arg (ap, long)); break;
+        case AK_LLONG: p = async_put64 (p, (uint64_t) va_arg (ap, long long)); break;
+        case AK_SIZE: p = async_put64 (p, (uint64_t) va_arg (ap, size_t)); break;
+        case AK_INTMAX: p = async_put64 (p, (uint64_t) va_arg (ap, intmax_t)); break;
+        case AK_PTRDIFF: p = async_put64 (p, (uint64_t) va_arg (ap, ptrdiff_t)); break;
+        case AK_POINTER: p = async_put64 (p, (uint64_t) (uintptr_t) va_arg (ap, void *)); break;
+        case AK_DOUBLE: case AK_LDOUBLE: {
+          const double d = (def->args[i].kind == AK_DOUBLE) ? va_arg (ap, double) : (double) va_arg (ap, long double);
+          memcpy (p, &d, sizeof (d));
+          p += sizeof (d);
+          break;
+        }
+        case AK_STRING: {
+          const int64_t prec = (def->args[i].prec == -2) ? prevint : def->args[i].prec;
+          p = async_putstr (p, va_arg (ap, const char *), prec, &space);
+          break;
+        }
+      }
+    }
+  }
+  const uint32_t size = (uint32_t) (p - r->rec);
+  (void) async_put32 (r->rec, size);
+  (void) async_put32 (r->rec + sizeof (uint32_t), ASYNC_REC_MSG);
+
+  if (r->ndropped > 0)
+  {
+    unsigned char drec[4 * sizeof (uint32_t)], *q = drec;
+    q = async_put32 (q, (uint32_t) sizeof (drec));
+    q = async_put32 (q, ASYNC_REC_DROPPED);
+    q = async_put32 (q, r->id);
+    (void) async_put32 (q, r->ndropped);
+    if (!async_ring_push (r, drec, (uint32_t) sizeof (drec)))
+    {
+      r->ndropped++;
+      return;
+    }
+    r->ndropped = 0;
+  }
+  if (!async_ring_push (r, r->rec, size))
+    r->ndropped++;
+}
+
+static void async_write_string_record (FILE *fp, uint32_t type, uint32_t id, const char *str)
+{
+  const size_t len = strlen (str) + 1;
+  uint32_t hdr[3];
+  hdr[0] = (uint32_t) (sizeof (hdr) + len);
+  hdr[1] = type;
+  hdr[2] = id;
+  (void) fwrite (hdr, sizeof (hdr), 1, fp);
+  (void) fwrite (str, len, 1, fp);
+}
+
+static bool async_announce_format (struct async_output *o, uint32_t fmtid)
+{
+  if (fmtid >= o->nfmtbits)
+  {
+    const uint32_t nfmtbits = (fmtid + 256) & ~255u;
+    unsigned char *fmtbits;
+    if ((fmtbits = ddsrt_realloc_s (o->fmtbits, nfmtbits / 8)) == NULL)
+      return false;
+    memset (fmtbits + o->nfmtbits / 8, 0, (nfmtbits - o->nfmtbits) / 8);
+    o->fmtbits = fmtbits;
+    o->nfmtbits = nfmtbits;
+  }
+  if (!(o->fmtbits[fmtid / 8] & (1u << (fmtid % 8))))
+  {
+    ddsrt_mutex_lock (&async.fmt_lock);
+    async_write_string_record (o->fp, ASYNC_REC_FORMAT, fmtid, async.fmtdefs[fmtid]->str);
+    ddsrt_mutex_unlock (&async.fmt_lock);
+    o->fmtbits[fmtid / 8] |= (unsigned char) (1u << (fmtid % 8));
+  }
+  return true;
+}
+
+static void async_announce_thread (struct async_ring *r, uint32_t out)
+{
+  if (!(r->announced & (1u << out)))
+  {
+    async_write_string_record (async.outputs[out].fp, ASYNC_REC_THREAD, r->id, r->name);
+    r->announced |= 1u << out;
+  }
+}
+
+static void async_handle_record (struct async_ring *r, const unsigned char *rec, uint32_t size)
+{
+  uint32_t type, out, fmtid;
+  memcpy (&type, rec + sizeof (uint32_t), sizeof (type));
+  switch (type)
+  {
+    case ASYNC_REC_MSG:
+      memcpy (&out, rec + 2 * sizeof (uint32_t), sizeof (out));
+      memcpy (&fmtid, rec + 6 * sizeof (uint32_t), sizeof (fmtid));
+      if (out < ASYNC_MAX_OUTPUTS && async.outputs[out].fp != NULL)
+      {
+        struct async_output * const o = &async.outputs[out];
+        if (!async_announce_format (o, fmtid))
+          break;
+        async_announce_thread (r, out);
+        /* drop the output index */
+        const uint32_t hdr[2] = { size - (uint32_t) sizeof (uint32_t), type };
+        (void) fwrite (hdr, sizeof (hdr), 1, o->fp);
+        (void) fwrite (rec + 3 * sizeof (uint32_t), size - 3 * sizeof (uint32_t), 1, o->fp);
+      }
+      break;
+    case ASYNC_REC_DROPPED:
+      for (out = 0; out < ASYNC_MAX_OUTPUTS; out++)
+      {
+        if (async.outputs[out].fp != NULL)
+        {
+          async_announce_thread (r, out);
+          (void) fwrite (rec, size, 1, async.outputs[out].fp);
+        }
+      }
+      break;
+  }
+}
+
+static void async_drain_locked (void)
+{
+  for (uint32_t i = 0; i < async.nrings; i++)
+  {
+    struct async_ring * const r = async.rings[i];
+    const bool released = (ddsrt_atomic_ld32 (&r->released) == 1);
+    ddsrt_atomic_fence_acq ();
+    const uint32_t head = ddsrt_atomic_ld32 (&r->head);
+    uint32_t tail = ddsrt_atomic_ld32 (&r->tail);
+    ddsrt_atomic_fence_acq ();
+    while (tail != head)
+    {
+      uint32_t size;
+      async_ring_copy ((unsigned char *) &size, r->buf, tail, sizeof (size));
+      assert (size <= ASYNC_MAX_RECORD_SIZE && size <= head - tail);
+      async_ring_copy (async.rec, r->buf, tail, size);
+      async_handle_record (r, async.rec, size);
+      tail += size;
+      ddsrt_atomic_fence_rel ();
+      ddsrt_atomic_st32 (&r->tail, tail);
+    }
+    /* the thread is gone and all it wrote has been processed: the ring can be
+       recycled, but only once (the "released" flag gets set only once) */
+    if (released && ddsrt_atomic_cas32 (&r->released, 1, 2))
+    {
+      r->next_free = async.free_rings;
+      async.free_rings = r;
+    }
+  }
+  for (uint32_t out = 0; out < ASYNC_MAX_OUTPUTS; out++)
+    if (async.outputs[out].fp != NULL)
+      (void) fflush (async.outputs[out].fp);
+}
+
+static uint32_t async_writer_thread (void *varg)
+{
+  (void) varg;
+  ddsrt_mutex_lock (&async.lock);
+  while (!async.stop)
+  {
+    async_drain_locked ();
+    (void) ddsrt_cond_waitfor (&async.cond, &async.lock, ASYNC_DRAIN_INTERVAL);
+  }
+  async_drain_locked ();
+  ddsrt_mutex_unlock (&async.lock);
+  return 0;
+}
+
+static void async_flush (void)
+{
+  ddsrt_mutex_lock (&async.lock);
+  async_drain_locked ();
+  ddsrt_mutex_unlock (&async.lock);
+}
+
 static void init_lock (void)
 {
   ddsrt_rwlock_init (&lock);
+  ddsrt_mutex_init (&async.ctrl_lock);
+  ddsrt_mutex_init (&async.lock);
+  ddsrt_cond_init (&async.cond);
+  ddsrt_mutex_init (&async.fmt_lock);
+  async.fmts = ddsrt_hh_new (256, async_fmt_hash, async_fmt_eq);
+  /* format id 0 is used for messages formatted by the calling thread */
+  (void) async_register_format_locked ("%s");
   sinks[LOG].ptr = sinks[TRACE].ptr = stderr;
   sinks[LOG].out = sinks[TRACE].out = stderr;
   logconfig.sink_fps[LOG] = sinks[LOG].ptr;
@@ -168,6 +802,100 @@ void dds_log_cfg_init (struct ddsrt_log_cfg *cfg, uint32_t domid, uint32_t trace
   cfgimpl->sink_fps[TRACE] = trace_fp;
 }
 
+dds_return_t dds_log_cfg_set_binary_trace (struct ddsrt_log_cfg *cfg)
+{
+  struct ddsrt_log_cfg_impl *cfgimpl = (struct ddsrt_log_cfg_impl *) cfg;
+  FILE * const fp = cfgimpl->sink_fps[TRACE];
+  dds_return_t ret = DDS_RETCODE_OK;
+  uint32_t out;
+  if (fp == NULL)
+    return DDS_RETCODE_BAD_PARAMETER;
+  ddsrt_once (&lock_inited, &init_lock);
+  ddsrt_mutex_lock (&async.ctrl_lock);
+  ddsrt_mutex_lock (&async.lock);
+  for (out = 0; out < ASYNC_MAX_OUTPUTS; out++)
+    if (async.outputs[out].fp == fp)
+      break;
+  if (out < ASYNC_MAX_OUTPUTS)
+    async.outputs[out].refc++;
+  else
+  {
+    for (out = 0; out < ASYNC_MAX_OUTPUTS; out++)
+      if (async.outputs[out].fp == NULL)
+        break;
+    if (out == ASYNC_MAX_OUTPUTS)
+      ret = DDS_RETCODE_OUT_OF_RESOURCES;
+    else
+    {
+      const uint32_t hdr[2] = { 0x01020304, ASYNC_VERSION };
+      (void) fwrite (ASYNC_MAGIC, strlen (ASYNC_MAGIC), 1, fp);
+      (void) fwrite (hdr, sizeof (hdr), 1, fp);
+      async.outputs[out].fp = fp;
+      async.outputs[out].refc = 1;
+      async.outputs[out].nfmtbits = 0;
+      async.outputs[out].fmtbits = NULL;
+      async.noutputs++;
+    }
+  }
+  ddsrt_mutex_unlock (&async.lock);
+  if (ret == DDS_RETCODE_OK && !async.running)
+  {
+    ddsrt_threadattr_t attr;
+    ddsrt_threadattr_init (&attr);
+    async.stop = false;
+    if ((ret = ddsrt_thread_create (&async.tid, "tracewriter", &attr, async_writer_thread, NULL)) == DDS_RETCODE_OK)
+      async.running = true;
+    else
+    {
+      ddsrt_mutex_lock (&async.lock);
+      async.outputs[out].fp = NULL;
+      async.noutputs--;
+      ddsrt_mutex_unlock (&async.lock);
+    }
+  }
+  if (ret == DDS_RETCODE_OK)
+    cfgimpl->async_out = out + 1;
+  ddsrt_mutex_unlock (&async.ctrl_lock);
+  return ret;
+}
+
+void dds_log_binary_trace_close (FILE *fp)
+{
+  uint32_t out;
+  ddsrt_once (&lock_inited, &init_lock);
+  ddsrt_mutex_lock (&async.ctrl_lock);
+  ddsrt_mutex_lock (&async.lock);
+  for (out = 0; out < ASYNC_MAX_OUTPUTS; out++)
+    if (async.outputs[out].fp == fp)
+      break;
+  if (out < ASYNC_MAX_OUTPUTS)
+  {
+    async_drain_locked ();
+    if (--async.outputs[out].refc == 0)
+    {
+      ddsrt_free (async.outputs[out].fmtbits);
+      async.outputs[out].fp = NULL;
+      async.noutputs--;
+      /* a new output in this slot must get the thread names again */
+      for (uint32_t i = 0; i < async.nrings; i++)
+        async.rings[i]->announced &= ~(1u << out);
+    }
+  }
+  const bool stop = (async.noutputs == 0 && async.running);
+  if (stop)
+  {
+    async.stop = true;
+    ddsrt_cond_broadcast (&async.cond);
+  }
+  ddsrt_mutex_unlock (&async.lock);
+  if (stop)
+  {
+    (void) ddsrt_thread_join (async.tid, NULL);
+    async.running = false;
+  }
+  ddsrt_mutex_unlock (&async.ctrl_lock);
+}
+
 static size_t print_header (char *str, uint32_t id)
 {
   int cnt, off;
@@ -279,7 +1007,7 @@ static void vlog1 (const struct ddsrt_log_cfg_impl *cfg, uint32_t cat, uint32_t
     /* if tracing is enabled, then print to trace if it matches the
        trace flags or if it got written to the log
        (mask == (tracemask | DDS_LOG_MASK)) */
-    if (cfg->c.tracemask && (cat & cfg->c.mask))
+    if (cfg->c.tracemask && (cat & cfg->c.mask) && cfg->async_out == 0)
     {
       dds_log_write_fn_t const g = sinks[TRACE].func;
       void * const g_arg = (g == default_sink) ? cfg->sink_fps[TRACE] : sinks[TRACE].ptr;
@@ -299,7 +1027,11 @@ static void vlog (const struct ddsrt_log_cfg_impl *cfg, uint32_t cat, uint32_t d
   vlog1 (cfg, cat, domid, file, line, func, fmt, ap);
   unlock_sink ();
   if (cat & DDS_LC_FATAL)
+  {
+    if (cfg->async_out != 0)
+      async_flush ();
     abort();
+  }
 }
 
 void dds_log_cfg (const struct ddsrt_log_cfg *cfg, uint32_t cat, const char *file, uint32_t line, const char *func, const char *fmt, ...)
@@ -310,6 +1042,17 @@ void dds_log_cfg (const struct ddsrt_log_cfg *cfg, uint32_t cat, const char *fil
      and have to keep them synchronized */
   if ((cfgimpl->c.mask & cat) && ((dds_get_log_mask () | cfgimpl->c.tracemask) & cat)) {
     va_list ap;
+    if (cfgimpl->async_out != 0) {
+      /* binary trace output doesn't go through the sinks, only what needs
+         to go to the log still takes the normal path */
+      if (cfgimpl->c.tracemask) {
+        va_start (ap, fmt);
+        async_trace (cfgimpl, cat, fmt, ap);
+        va_end (ap);
+      }
+      if (!(dds_get_log_mask () & cat & DDS_LOG_MASK))
+        return;
+    }
     va_start (ap, fmt);
     vlog (cfgimpl, cat, cfgimpl->c.domid, file, line, func, fmt, ap);
     va_end (ap);
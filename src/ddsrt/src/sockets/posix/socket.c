@@ -9,13 +9,18 @@
  *
  * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
  */
+#if defined(__linux) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* recvmmsg, sendmmsg */
+#endif
 #include <assert.h>
+#include <stddef.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "dds/ddsrt/log.h"
 #include "dds/ddsrt/misc.h"
 #include "dds/ddsrt/sockets_priv.h"
+#include "dds/ddsrt/static_assert.h"
 
 #if !LWIP_SOCKET
 #if defined(__VXWORKS__)
@@ -461,6 +466,31 @@ ddsrt_recvmsg(
   return recv_error_to_retcode(errno);
 }
 
+#if DDSRT_HAVE_MMSG
+DDSRT_STATIC_ASSERT(sizeof(ddsrt_mmsghdr_t) == sizeof(struct mmsghdr) &&
+                    offsetof(ddsrt_mmsghdr_t, msg_len) == offsetof(struct mmsghdr, msg_len));
+
+dds_return_t
+ddsrt_recvmmsg(
+  ddsrt_socket_t sock,
+  ddsrt_mmsghdr_t *msgvec,
+  uint32_t vlen,
+  int flags,
+  uint32_t *rcvd)
+{
+  int n;
+
+  assert(vlen > 0);
+  if ((n = recvmmsg(sock, (struct mmsghdr *)msgvec, vlen, flags | MSG_WAITFORONE, NULL)) != -1) {
+    assert(n >= 0 && (uint32_t)n <= vlen);
+    *rcvd = (uint32_t)n;
+    return DDS_RETCODE_OK;
+  }
+
+  return recv_error_to_retcode(errno);
+}
+#endif
+
 static inline dds_return_t
 send_error_to_retcode(int errnum)
 {
@@ -541,6 +571,28 @@ ddsrt_sendmsg(
   return send_error_to_retcode(errno);
 }
 
+#if DDSRT_HAVE_MMSG
+dds_return_t
+ddsrt_sendmmsg(
+  ddsrt_socket_t sock,
+  ddsrt_mmsghdr_t *msgvec,
+  uint32_t vlen,
+  int flags,
+  uint32_t *sent)
+{
+  int n;
+
+  assert(vlen > 0);
+  if ((n = sendmmsg(sock, (struct mmsghdr *)msgvec, vlen, flags)) != -1) {
+    assert(n >= 0 && (uint32_t)n <= vlen);
+    *sent = (uint32_t)n;
+    return DDS_RETCODE_OK;
+  }
+
+  return send_error_to_retcode(errno);
+}
+#endif
+
 dds_return_t
 ddsrt_select(
   int32_t nfds,
@@ -0,0 +1,302 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stddef.h>
+#include <assert.h>
+
+#include "dds/ddsrt/misc.h"
+#include "dds/ddsrt/timerwheel.h"
+
+/* Invariant: an object with tick e > now is in the slot at the level of the
+   most significant group of LEVEL_BITS bits in which e and now differ (level 0
+   if they don't differ), at the index given by that group of e.  Consequently
+   all objects at level k are due before all objects at level k+1, and within
+   a level the slot indices of the objects are all >= the index of "now" at
+   that level, so that the first non-empty slot is simply the least
+   significant bit set in "nonempty".  Objects with a key <= tlast are on the
+   "due" list. */
+
+#define SLOT_DUE (DDSRT_TIMERWHEEL_LEVELS * DDSRT_TIMERWHEEL_SLOTS)
+#define SLOT_MASK (DDSRT_TIMERWHEEL_SLOTS - 1)
+
+static unsigned ctz64 (uint64_t x)
+{
+  assert (x != 0);
+#if defined (__GNUC__)
+  return (unsigned) __builtin_ctzll (x);
+#else
+  unsigned n = 0;
+  while (!(x & 1)) { x >>= 1; n++; }
+  return n;
+#endif
+}
+
+static unsigned msb64 (uint64_t x)
+{
+  assert (x != 0);
+#if defined (__GNUC__)
+  return 63u - (unsigned) __builtin_clzll (x);
+#else
+  unsigned n = 0;
+  while (x >>= 1) n++;
+  return n;
+#endif
+}
+
+static uint64_t rotr64 (uint64_t x, unsigned n)
+{
+  return (n == 0) ? x : (x >> n) | (x << (64 - n));
+}
+
+static ddsrt_timerwheel_node_t *node_of (const ddsrt_timerwheel_def_t *twdef, const void *vnode)
+{
+  return (ddsrt_timerwheel_node_t *) ((char *) vnode + twdef->offset);
+}
+
+static void *object_of (const ddsrt_timerwheel_def_t *twdef, const ddsrt_timerwheel_node_t *node)
+{
+  return (char *) node - twdef->offset;
+}
+
+static int64_t key_of (const ddsrt_timerwheel_def_t *twdef, const ddsrt_timerwheel_node_t *node)
+{
+  return *((const int64_t *) ((const char *) node - twdef->offset + twdef->keyoffset));
+}
+
+static uint64_t tick_of (int64_t t)
+{
+  return (t < 0) ? 0 : (uint64_t) t >> DDSRT_TIMERWHEEL_TICK_SHIFT;
+}
+
+static void list_init (ddsrt_timerwheel_node_t *hd)
+{
+  hd->next = hd->prev = hd;
+}
+
+static int list_is_empty (const ddsrt_timerwheel_node_t *hd)
+{
+  return hd->next == hd;
+}
+
+static void list_append (ddsrt_timerwheel_node_t *hd, ddsrt_timerwheel_node_t *node)
+{
+  node->next = hd;
+  node->prev = hd->prev;
+  hd->prev->next = node;
+  hd->prev = node;
+}
+
+static void list_splice (ddsrt_timerwheel_node_t *hd, ddsrt_timerwheel_node_t *src)
+{
+  /* appends all of src to hd, leaving src empty */
+  if (list_is_empty (src))
+    return;
+  src->next->prev = hd->prev;
+  hd->prev->next = src->next;
+  src->prev->next = hd;
+  hd->prev = src->prev;
+  list_init (src);
+}
+
+static void unlink_node (ddsrt_timerwheel_t *tw, ddsrt_timerwheel_node_t *node)
+{
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+  if (node->slot != SLOT_DUE && list_is_empty (&tw->slots[node->slot]))
+  {
+    const uint32_t level = node->slot / DDSRT_TIMERWHEEL_SLOTS;
+    tw->nonempty[level] &= ~((uint64_t) 1 << (node->slot & SLOT_MASK));
+  }
+}
+
+static void place_node (const ddsrt_timerwheel_def_t *twdef, ddsrt_timerwheel_t *tw, ddsrt_timerwheel_node_t *node)
+{
+  const int64_t key = key_of (twdef, node);
+  if (key <= tw->tlast)
+  {
+    node->slot = SLOT_DUE;
+    list_append (&tw->due, node);
+  }
+  else
+  {
+    const uint64_t e = tick_of (key);
+    assert (e >= tw->now);
+    const uint64_t diff = e ^ tw->now;
+    const unsigned level = (diff == 0) ? 0 : msb64 (diff) / DDSRT_TIMERWHEEL_LEVEL_BITS;
+    const unsigned idx = (unsigned) (e >> (level * DDSRT_TIMERWHEEL_LEVEL_BITS)) & SLOT_MASK;
+    assert (level < DDSRT_TIMERWHEEL_LEVELS);
+    node->slot = level * DDSRT_TIMERWHEEL_SLOTS + idx;
+    list_append (&tw->slots[node->slot], node);
+    tw->nonempty[level] |= (uint64_t) 1 << idx;
+  }
+}
+
+static void advance (const ddsrt_timerwheel_def_t *twdef, ddsrt_timerwheel_t *tw, int64_t tnow)
+{
+  const uint64_t to = tick_of (tnow);
+  assert (tnow > tw->tlast);
+  tw->tlast = tnow;
+  if (to == tw->now)
+  {
+    /* only the objects in the current tick can have become due */
+    ddsrt_timerwheel_node_t * const hd = &tw->slots[to & SLOT_MASK];
+    ddsrt_timerwheel_node_t *node = hd->next;
+    while (node != hd)
+    {
+      ddsrt_timerwheel_node_t * const next = node->next;
+      if (key_of (twdef, node) <= tnow)
+      {
+        unlink_node (tw, node);
+        node->slot = SLOT_DUE;
+        list_append (&tw->due, node);
+      }
+      node = next;
+    }
+  }
+  else
+  {
+    /* collect everything in the slots "now" passes over on its way to "to"
+       (including the destination slots at the higher levels) and put them
+       back relative to the new "now": they either become due or move to a
+       lower level; everything else stays put */
+    ddsrt_timerwheel_node_t tmp;
+    list_init (&tmp);
+    for (unsigned k = 0; k < DDSRT_TIMERWHEEL_LEVELS; k++)
+    {
+      const uint64_t f = tw->now >> (k * DDSRT_TIMERWHEEL_LEVEL_BITS);
+      const uint64_t t = to >> (k * DDSRT_TIMERWHEEL_LEVEL_BITS);
+      if (f == t)
+        break;
+      const unsigned fidx = (unsigned) f & SLOT_MASK;
+      uint64_t mask;
+      if (t - f >= SLOT_MASK)
+        mask = ~(uint64_t) 0;
+      else
+        mask = ((uint64_t) 1 << (t - f + 1)) - 1;
+      /* visit slots in time order starting at f */
+      mask &= rotr64 (tw->nonempty[k], fidx);
+      while (mask)
+      {
+        const unsigned idx = (fidx + ctz64 (mask)) & SLOT_MASK;
+        mask &= mask - 1;
+        list_splice (&tmp, &tw->slots[k * DDSRT_TIMERWHEEL_SLOTS + idx]);
+        tw->nonempty[k] &= ~((uint64_t) 1 << idx);
+      }
+    }
+    tw->now = to;
+    while (!list_is_empty (&tmp))
+    {
+      ddsrt_timerwheel_node_t * const node = tmp.next;
+      tmp.next = node->next;
+      node->next->prev = &tmp;
+      place_node (twdef, tw, node);
+    }
+  }
+}
+
+void ddsrt_timerwheel_def_init (ddsrt_timerwheel_def_t *twdef, uintptr_t offset, uintptr_t keyoffset)
+{
+  twdef->offset = offset;
+  twdef->keyoffset = keyoffset;
+}
+
+void ddsrt_timerwheel_init (const ddsrt_timerwheel_def_t *twdef, ddsrt_timerwheel_t *tw)
+{
+  DDSRT_UNUSED_ARG (twdef);
+  tw->now = 0;
+  tw->tlast = 0;
+  list_init (&tw->due);
+  for (uint32_t i = 0; i < DDSRT_TIMERWHEEL_LEVELS; i++)
+    tw->nonempty[i] = 0;
+  for (uint32_t i = 0; i < DDSRT_TIMERWHEEL_LEVELS * DDSRT_TIMERWHEEL_SLOTS; i++)
+    list_init (&tw->slots[i]);
+}
+
+int ddsrt_timerwheel_is_empty (const ddsrt_timerwheel_def_t *twdef, const ddsrt_timerwheel_t *tw)
+{
+  DDSRT_UNUSED_ARG (twdef);
+  if (!list_is_empty (&tw->due))
+    return 0;
+  for (uint32_t i = 0; i < DDSRT_TIMERWHEEL_LEVELS; i++)
+    if (tw->nonempty[i])
+      return 0;
+  return 1;
+}
+
+void ddsrt_timerwheel_insert (const ddsrt_timerwheel_def_t *twdef, ddsrt_timerwheel_t *tw, void *vnode)
+{
+  place_node (twdef, tw, node_of (twdef, vnode));
+}
+
+void ddsrt_timerwheel_delete (const ddsrt_timerwheel_def_t *twdef, ddsrt_timerwheel_t *tw, void *vnode)
+{
+  unlink_node (tw, node_of (twdef, vnode));
+}
+
+void *ddsrt_timerwheel_extract_due (const ddsrt_timerwheel_def_t *twdef, ddsrt_timerwheel_t *tw, int64_t tnow)
+{
+  if (list_is_empty (&tw->due) && tnow > tw->tlast)
+    advance (twdef, tw, tnow);
+  if (list_is_empty (&tw->due))
+    return NULL;
+  ddsrt_timerwheel_node_t * const node = tw->due.next;
+  unlink_node (tw, node);
+  return object_of (twdef, node);
+}
+
+int64_t ddsrt_timerwheel_next (const ddsrt_timerwheel_def_t *twdef, const ddsrt_timerwheel_t *tw)
+{
+  if (!list_is_empty (&tw->due))
+    return tw->tlast;
+  for (unsigned k = 0; k < DDSRT_TIMERWHEEL_LEVELS; k++)
+  {
+    if (tw->nonempty[k] == 0)
+      continue;
+    const unsigned idx = ctz64 (tw->nonempty[k]);
+    if (k == 0)
+    {
+      const ddsrt_timerwheel_node_t * const hd = &tw->slots[idx];
+      int64_t min = INT64_MAX;
+      for (const ddsrt_timerwheel_node_t *node = hd->next; node != hd; node = node->next)
+      {
+        const int64_t key = key_of (twdef, node);
+        if (key < min)
+          min = key;
+      }
+      return min;
+    }
+    else
+    {
+      const unsigned shift = k * DDSRT_TIMERWHEEL_LEVEL_BITS;
+      const uint64_t above = (tw->now >> (shift + DDSRT_TIMERWHEEL_LEVEL_BITS)) << (shift + DDSRT_TIMERWHEEL_LEVEL_BITS);
+      const uint64_t tick = above | ((uint64_t) idx << shift);
+      return (int64_t) (tick << DDSRT_TIMERWHEEL_TICK_SHIFT);
+    }
+  }
+  return INT64_MAX;
+}
+
+void *ddsrt_timerwheel_extract_any (const ddsrt_timerwheel_def_t *twdef, ddsrt_timerwheel_t *tw)
+{
+  ddsrt_timerwheel_node_t *node = NULL;
+  if (!list_is_empty (&tw->due))
+    node = tw->due.next;
+  else
+  {
+    for (unsigned k = 0; k < DDSRT_TIMERWHEEL_LEVELS && node == NULL; k++)
+      if (tw->nonempty[k])
+        node = tw->slots[k * DDSRT_TIMERWHEEL_SLOTS + ctz64 (tw->nonempty[k])].next;
+  }
+  if (node == NULL)
+    return NULL;
+  unlink_node (tw, node);
+  return object_of (twdef, node);
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <string.h>
+
+#include "CUnit/Test.h"
+#include "dds/ddsrt/bswap.h"
+#include "dds/ddsrt/random.h"
+
+#define MAX_N 200
+
+#define BSWAP_ARRAY_TEST(nbytes, uintN_t)                                                \
+  static void bswap##nbytes##_array_test (ddsrt_prng_t *prng)                             \
+  {                                                                                       \
+    static uintN_t src[MAX_N + 2], dst[MAX_N + 2], ref[MAX_N + 2];                        \
+    for (size_t i = 0; i < MAX_N + 2; i++)                                                \
+      src[i] = (uintN_t) (((uint64_t) ddsrt_prng_random (prng) << 32) | ddsrt_prng_random (prng)); \
+    for (size_t n = 0; n <= MAX_N; n++)                                                   \
+    {                                                                                     \
+      for (size_t skip = 0; skip <= 1; skip++)                                            \
+      {                                                                                   \
+        for (size_t i = 0; i < n; i++)                                                    \
+          ref[skip + i] = ddsrt_bswap##nbytes##u (src[skip + i]);                         \
+        memset (dst, 0, sizeof (dst));                                                    \
+        ddsrt_bswap##nbytes##u_array (dst + skip, src + skip, n);                         \
+        CU_ASSERT_FATAL (memcmp (dst + skip, ref + skip, n * sizeof (dst[0])) == 0);      \
+        CU_ASSERT_FATAL (dst[skip + n] == 0);                                             \
+        memcpy (dst, src, sizeof (dst));                                                  \
+        ddsrt_bswap##nbytes##u_array (dst + skip, dst + skip, n);                         \
+        CU_ASSERT_FATAL (memcmp (dst + skip, ref + skip, n * sizeof (dst[0])) == 0);      \
+        CU_ASSERT_FATAL (dst[skip + n] == src[skip + n]);                                 \
+      }                                                                                   \
+    }                                                                                     \
+  }
+
+BSWAP_ARRAY_TEST(2, uint16_t)
+BSWAP_ARRAY_TEST(4, uint32_t)
+BSWAP_ARRAY_TEST(8, uint64_t)
+
+/* Covers the scalar tails and all vector widths, with and without a misaligned start,
+   both in-place and copying */
+CU_Test(ddsrt_bswap, array)
+{
+  ddsrt_prng_t prng;
+  ddsrt_prng_init_simple (&prng, 1);
+  bswap2_array_test (&prng);
+  bswap4_array_test (&prng);
+  bswap8_array_test (&prng);
+}
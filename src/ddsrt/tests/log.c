@@ -321,6 +321,88 @@ CU_Test(dds_log, newline_terminates, .fini=reset)
 #endif
 }
 
+#if HAVE_FMEMOPEN
+static bool contains(const char *buf, size_t size, const char *str)
+{
+  const size_t len = strlen(str);
+  for (size_t i = 0; i + len <= size; i++) {
+    if (memcmp(buf + i, str, len) == 0)
+      return true;
+  }
+  return false;
+}
+#endif
+
+/* In binary mode the trace file gets a header, the format strings and the
+   arguments once it is closed, while log messages still go to the log. */
+CU_Test(dds_log, binary_trace, .init=setup, .fini=teardown)
+{
+#if HAVE_FMEMOPEN
+  char buf[1024], *msg = NULL;
+  size_t nbytes;
+  ddsrt_log_cfg_t logcfg;
+
+  dds_set_log_sink(&copy, &msg);
+  dds_log_cfg_init(&logcfg, 0, DDS_LC_TRACE, stderr, fh);
+  CU_ASSERT_EQUAL_FATAL(dds_log_cfg_set_binary_trace(&logcfg), DDS_RETCODE_OK);
+  DDS_CTRACE(&logcfg, "foo %d %s", 42, "bar");
+  DDS_CTRACE(&logcfg, "%.2s\n", "bazqux");
+  DDS_CLOG(DDS_LC_ERROR, &logcfg, "error %s\n", "quux");
+  dds_log_binary_trace_close(fh);
+  CU_ASSERT_PTR_NOT_NULL_FATAL(msg);
+  CU_ASSERT(strcmp(msg, "error quux\n") == 0);
+  ddsrt_free(msg);
+
+  (void)fseek(fh, 0L, SEEK_SET);
+  nbytes = fread(buf, 1, sizeof(buf), fh);
+  CU_ASSERT_FATAL(nbytes > 8);
+  CU_ASSERT(memcmp(buf, "CDDSBTRC", 8) == 0);
+  CU_ASSERT(contains(buf, nbytes, "foo %d %s"));
+  CU_ASSERT(contains(buf, nbytes, "bar"));
+  CU_ASSERT(contains(buf, nbytes, "%.2s\n"));
+  CU_ASSERT(contains(buf, nbytes, "ba"));
+  CU_ASSERT(!contains(buf, nbytes, "baz"));
+  CU_ASSERT(contains(buf, nbytes, "error %s\n"));
+  CU_ASSERT(contains(buf, nbytes, "quux"));
+  CU_ASSERT(!contains(buf, nbytes, "foo 42"));
+#endif
+}
+
+/* A trace file that reuses the output of a closed one must still get the
+   name of a thread that wrote to the closed one. */
+CU_Test(dds_log, binary_trace_reopen, .init=setup, .fini=teardown)
+{
+#if HAVE_FMEMOPEN
+  char buf[1024], name[32];
+  size_t nbytes;
+  ddsrt_log_cfg_t logcfg;
+  FILE *fh2;
+
+  (void)ddsrt_thread_getname(name, sizeof(name));
+  CU_ASSERT_FATAL(strlen(name) > 0);
+  dds_log_cfg_init(&logcfg, 0, DDS_LC_TRACE, stderr, fh);
+  CU_ASSERT_EQUAL_FATAL(dds_log_cfg_set_binary_trace(&logcfg), DDS_RETCODE_OK);
+  DDS_CTRACE(&logcfg, "first %d\n", 1);
+  dds_log_binary_trace_close(fh);
+  (void)fseek(fh, 0L, SEEK_SET);
+  nbytes = fread(buf, 1, sizeof(buf), fh);
+  CU_ASSERT(contains(buf, nbytes, name));
+
+  fh2 = fmemopen(NULL, 1024, "wb+");
+  CU_ASSERT_PTR_NOT_NULL_FATAL(fh2);
+  dds_log_cfg_init(&logcfg, 0, DDS_LC_TRACE, stderr, fh2);
+  CU_ASSERT_EQUAL_FATAL(dds_log_cfg_set_binary_trace(&logcfg), DDS_RETCODE_OK);
+  DDS_CTRACE(&logcfg, "second %d\n", 2);
+  dds_log_binary_trace_close(fh2);
+  (void)fseek(fh2, 0L, SEEK_SET);
+  nbytes = fread(buf, 1, sizeof(buf), fh2);
+  CU_ASSERT_FATAL(nbytes > 8);
+  CU_ASSERT(contains(buf, nbytes, "second %d\n"));
+  CU_ASSERT(contains(buf, nbytes, name));
+  (void)fclose(fh2);
+#endif
+}
+
 /* Nothing must be written unless a category is enabled. */
 CU_Test(dds_log, disabled_categories_discarded, .fini=reset)
 {
@@ -0,0 +1,159 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "CUnit/Test.h"
+
+#include "dds/ddsrt/random.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/timerwheel.h"
+
+#define NOBJS 2000
+#define NITERS 20000
+
+struct obj {
+  ddsrt_timerwheel_node_t node;
+  int64_t key;
+  bool inwheel;
+};
+
+static const ddsrt_timerwheel_def_t twdef = DDSRT_TIMERWHEELDEF_INITIALIZER (offsetof (struct obj, node), offsetof (struct obj, key));
+
+static int64_t random_delay (ddsrt_prng_t *prng)
+{
+  /* mix of delays within the current tick, within the lowest levels and far into the future */
+  switch (ddsrt_prng_random (prng) % 4)
+  {
+    case 0: return (int64_t) (ddsrt_prng_random (prng) % 100000);
+    case 1: return (int64_t) (ddsrt_prng_random (prng) % 100000000);
+    case 2: return (int64_t) ddsrt_prng_random (prng) * 1000;
+    default: return -(int64_t) (ddsrt_prng_random (prng) % 1000);
+  }
+}
+
+static void check_next (const ddsrt_timerwheel_t *tw, const struct obj *objs, int64_t tnow)
+{
+  int64_t min = INT64_MAX;
+  for (int i = 0; i < NOBJS; i++)
+    if (objs[i].inwheel && objs[i].key < min)
+      min = objs[i].key;
+  const int64_t next = ddsrt_timerwheel_next (&twdef, tw);
+  CU_ASSERT_FATAL (next <= min);
+  CU_ASSERT_FATAL ((min == INT64_MAX) == (next == INT64_MAX));
+  CU_ASSERT_FATAL ((min == INT64_MAX) == (ddsrt_timerwheel_is_empty (&twdef, tw) != 0));
+  /* nothing can be due: it would've been extracted */
+  CU_ASSERT_FATAL (min > tnow);
+}
+
+CU_Test(ddsrt_timerwheel, random)
+{
+  ddsrt_prng_t prng;
+  ddsrt_prng_init_simple (&prng, 1);
+  struct obj *objs = ddsrt_malloc (NOBJS * sizeof (*objs));
+  ddsrt_timerwheel_t *tw = ddsrt_malloc (sizeof (*tw));
+  ddsrt_timerwheel_init (&twdef, tw);
+  for (int i = 0; i < NOBJS; i++)
+    objs[i].inwheel = false;
+
+  int64_t tnow = 1;
+  for (int iter = 0; iter < NITERS; iter++)
+  {
+    struct obj *o = &objs[ddsrt_prng_random (&prng) % NOBJS];
+    switch (ddsrt_prng_random (&prng) % 3)
+    {
+      case 0: /* (re)schedule */
+        if (o->inwheel)
+          ddsrt_timerwheel_delete (&twdef, tw, o);
+        o->key = tnow + random_delay (&prng);
+        ddsrt_timerwheel_insert (&twdef, tw, o);
+        o->inwheel = true;
+        break;
+      case 1: /* cancel */
+        if (o->inwheel)
+        {
+          ddsrt_timerwheel_delete (&twdef, tw, o);
+          o->inwheel = false;
+        }
+        break;
+      case 2: { /* advance time, sometimes by a lot */
+        const int64_t next = ddsrt_timerwheel_next (&twdef, tw);
+        if (next != INT64_MAX && (ddsrt_prng_random (&prng) % 2) && next > tnow)
+          tnow = next;
+        else
+          tnow += (ddsrt_prng_random (&prng) % 8 == 0) ? (int64_t) ddsrt_prng_random (&prng) * 100 : (int64_t) (ddsrt_prng_random (&prng) % 1000000);
+        struct obj *x;
+        while ((x = ddsrt_timerwheel_extract_due (&twdef, tw, tnow)) != NULL)
+        {
+          CU_ASSERT_FATAL (x->inwheel);
+          CU_ASSERT_FATAL (x->key <= tnow);
+          x->inwheel = false;
+        }
+        check_next (tw, objs, tnow);
+        break;
+      }
+    }
+  }
+
+  int nexp = 0, n = 0;
+  for (int i = 0; i < NOBJS; i++)
+    if (objs[i].inwheel)
+      nexp++;
+  struct obj *x;
+  while ((x = ddsrt_timerwheel_extract_any (&twdef, tw)) != NULL)
+  {
+    CU_ASSERT_FATAL (x->inwheel);
+    x->inwheel = false;
+    n++;
+  }
+  for (int i = 0; i < NOBJS; i++)
+    CU_ASSERT (!objs[i].inwheel);
+  CU_ASSERT (ddsrt_timerwheel_is_empty (&twdef, tw));
+  CU_ASSERT (n == nexp);
+  ddsrt_free (tw);
+  ddsrt_free (objs);
+}
+
+CU_Test(ddsrt_timerwheel, order)
+{
+  /* objects in different ticks become due in time order regardless of the
+     order of insertion, of the level they start out in, and of whether
+     they need to cascade down or not */
+  struct obj objs[200];
+  ddsrt_timerwheel_t *tw = ddsrt_malloc (sizeof (*tw));
+  ddsrt_timerwheel_init (&twdef, tw);
+  for (int i = 0; i < 200; i++)
+  {
+    objs[i].key = 1000000 + (199 - i) * 70000;
+    ddsrt_timerwheel_insert (&twdef, tw, &objs[i]);
+  }
+  CU_ASSERT (ddsrt_timerwheel_next (&twdef, tw) <= objs[199].key);
+  CU_ASSERT (ddsrt_timerwheel_extract_due (&twdef, tw, objs[199].key - 1) == NULL);
+  int64_t prev = 0;
+  struct obj *x;
+  int n = 0;
+  for (int64_t tnow = objs[199].key; tnow <= objs[0].key; tnow += 10000)
+  {
+    while ((x = ddsrt_timerwheel_extract_due (&twdef, tw, tnow)) != NULL)
+    {
+      CU_ASSERT (x->key <= tnow && x->key > tnow - 10000);
+      CU_ASSERT (x->key >= prev);
+      prev = x->key;
+      n++;
+    }
+  }
+  CU_ASSERT (n == 200);
+  CU_ASSERT (ddsrt_timerwheel_next (&twdef, tw) == INT64_MAX);
+  ddsrt_free (tw);
+}
@@ -55,25 +55,70 @@ static bool trusted_check_buffer_sizes (const size_t num, const trusted_crypto_d
 }
 #endif
 
-bool crypto_cipher_encrypt_data (const crypto_session_key_t *session_key, uint32_t key_size, const struct init_vector *iv, const size_t num_inp, const trusted_crypto_data_t *inpdata, trusted_crypto_data_t *outpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
+void crypto_cipher_ctx_init (crypto_cipher_ctx *cctx)
 {
-  assert (session_key);
+  ddsrt_mutex_init (&cctx->lock);
+  cctx->ctx = NULL;
+  cctx->key_set = false;
+  cctx->encrypt = false;
+  cctx->id = 0;
+  cctx->key_size = 0;
+}
+
+void crypto_cipher_ctx_fini (crypto_cipher_ctx *cctx)
+{
+  /* freeing the context also clears the key schedule */
+  if (cctx->ctx)
+    EVP_CIPHER_CTX_free (cctx->ctx);
+  ddsrt_mutex_destroy (&cctx->lock);
+}
+
+void crypto_cipher_ctx_reset (crypto_cipher_ctx *cctx)
+{
+  ddsrt_mutex_lock (&cctx->lock);
+  cctx->key_set = false;
+  ddsrt_mutex_unlock (&cctx->lock);
+}
+
+bool crypto_cipher_ctx_has_key (const crypto_cipher_ctx *cctx, uint32_t id, uint32_t key_size, bool encrypt)
+{
+  return cctx->key_set && cctx->id == id && cctx->key_size == key_size && cctx->encrypt == encrypt;
+}
+
+bool crypto_cipher_ctx_set_key (crypto_cipher_ctx *cctx, uint32_t id, const crypto_session_key_t *key, uint32_t key_size, bool encrypt, DDS_Security_SecurityException *ex)
+{
+  assert (key_size == 128 || key_size == 256);
+  EVP_CIPHER const * const evp = (key_size != 256) ? EVP_aes_128_gcm () : EVP_aes_256_gcm ();
+
+  cctx->key_set = false;
+  if (cctx->ctx == NULL && (cctx->ctx = EVP_CIPHER_CTX_new ()) == NULL)
+    SSLERROR (fail, "EVP_CIPHER_CTX_new");
+  if (!EVP_CipherInit_ex (cctx->ctx, evp, NULL, key->data, NULL, encrypt ? 1 : 0))
+    SSLERROR (fail, "EVP_CipherInit_ex to set aes_128_gcm/aes_256_gcm and key");
+  cctx->key_set = true;
+  cctx->encrypt = encrypt;
+  cctx->id = id;
+  cctx->key_size = key_size;
+  return true;
+
+fail:
+  return false;
+}
+
+bool crypto_cipher_encrypt_data (crypto_cipher_ctx *cctx, const struct init_vector *iv, const size_t num_inp, const trusted_crypto_data_t *inpdata, trusted_crypto_data_t *outpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
+{
+  assert (cctx->key_set && cctx->encrypt);
   assert (iv);
   assert (num_inp > 0);
   assert (inpdata);
-  assert (key_size == 128 || key_size == 256);
   assert (trusted_check_buffer_sizes (num_inp, inpdata, outpdata));
 
-  EVP_CIPHER const * const evp = (key_size != 256) ? EVP_aes_128_gcm () : EVP_aes_256_gcm ();
-  EVP_CIPHER_CTX *ctx;
+  EVP_CIPHER_CTX * const ctx = cctx->ctx;
   unsigned char *ptr = outpdata ? outpdata->x.base : NULL;
 
-  if ((ctx = EVP_CIPHER_CTX_new ()) == NULL)
-    SSLERROR (fail_context_new, "EVP_CIPHER_CTX_new");
-  if (!EVP_EncryptInit_ex (ctx, evp, NULL, NULL, NULL))
-    SSLERROR (fail_encrypt, "EVP_EncryptInit_ex to set aes_128_gcm/aes_256_gcm");
-  if (!EVP_EncryptInit_ex (ctx, NULL, NULL, session_key->data, iv->u))
-    SSLERROR (fail_encrypt, "EVP_EncryptInit_ex to set key and IV");
+  /* key schedule is retained, only the IV needs to be set */
+  if (!EVP_EncryptInit_ex (ctx, NULL, NULL, NULL, iv->u))
+    SSLERROR (fail_encrypt, "EVP_EncryptInit_ex to set IV");
 
   for (size_t i = 0; i < num_inp; i++)
   {
@@ -105,17 +150,15 @@ bool crypto_cipher_encrypt_data (const crypto_session_key_t *session_key, uint32
   /* get the tag */
   if (!EVP_CIPHER_CTX_ctrl (ctx, EVP_CTRL_GCM_GET_TAG, CRYPTO_HMAC_SIZE, tag->data))
     SSLERROR (fail_encrypt, "EVP_CIPHER_CTX_ctrl to get the tag");
-
-  EVP_CIPHER_CTX_free (ctx);
   return true;
 
 fail_encrypt:
-  EVP_CIPHER_CTX_free (ctx);
-fail_context_new:
+  /* don't trust the state of the context after an error */
+  cctx->key_set = false;
   return false;
 }
 
-bool crypto_cipher_calc_hmac (const crypto_session_key_t *session_key, uint32_t key_size, const struct init_vector *iv, const tainted_crypto_data_t *inpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
+bool crypto_cipher_calc_hmac (crypto_cipher_ctx *cctx, const struct init_vector *iv, const tainted_crypto_data_t *inpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
 {
   const trusted_crypto_data_t inpdata_wrapper = { *inpdata };
   if (inpdata_wrapper.x.length > INT_MAX)
@@ -123,28 +166,23 @@ bool crypto_cipher_calc_hmac (const crypto_session_key_t *session_key, uint32_t
     DDS_Security_Exception_set (ex, DDS_CRYPTO_PLUGIN_CONTEXT, DDS_SECURITY_ERR_CIPHER_ERROR, 0, "oversize data fragment");
     return false;
   }
-  return crypto_cipher_encrypt_data (session_key, key_size, iv, 1, &inpdata_wrapper, NULL, tag, ex);
+  return crypto_cipher_encrypt_data (cctx, iv, 1, &inpdata_wrapper, NULL, tag, ex);
 }
 
-bool crypto_cipher_decrypt_data (const remote_session_info *session, const struct init_vector *iv, const size_t num_inp, const const_tainted_crypto_data_t *inpdata, tainted_crypto_data_t *outpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
+bool crypto_cipher_decrypt_data (crypto_cipher_ctx *cctx, const struct init_vector *iv, const size_t num_inp, const const_tainted_crypto_data_t *inpdata, tainted_crypto_data_t *outpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
 {
-  assert (session);
+  assert (cctx->key_set && !cctx->encrypt);
   assert (iv);
   assert (num_inp > 0);
   assert (inpdata);
-  assert (session->key_size == 128 || session->key_size == 256);
   assert (check_buffer_sizes (num_inp, inpdata, outpdata));
 
-  EVP_CIPHER const * const evp = (session->key_size != 256) ? EVP_aes_128_gcm () : EVP_aes_256_gcm ();
+  EVP_CIPHER_CTX * const ctx = cctx->ctx;
   unsigned char *ptr = outpdata ? outpdata->base : NULL;
-  EVP_CIPHER_CTX *ctx;
 
-  if ((ctx = EVP_CIPHER_CTX_new ()) == NULL)
-    SSLERROR (fail_context_new, "EVP_CIPHER_CTX_new");
-  if (!EVP_DecryptInit_ex (ctx, evp, NULL, NULL, NULL))
-    SSLERROR (fail_decrypt, "EVP_DecryptInit_ex to set aes_128_gcm/aes_256_gcm");
-  if (!EVP_DecryptInit_ex (ctx, NULL, NULL, session->key.data, iv->u))
-    SSLERROR (fail_decrypt, "EVP_DecryptInit_ex to set key and IV");
+  /* key schedule is retained, only the IV needs to be set */
+  if (!EVP_DecryptInit_ex (ctx, NULL, NULL, NULL, iv->u))
+    SSLERROR (fail_decrypt, "EVP_DecryptInit_ex to set IV");
 
   /* Set expected tag value. */
   if (!EVP_CIPHER_CTX_ctrl (ctx, EVP_CTRL_GCM_SET_TAG, CRYPTO_HMAC_SIZE, tag->data))
@@ -181,12 +219,10 @@ bool crypto_cipher_decrypt_data (const remote_session_info *session, const struc
     if (!EVP_DecryptFinal_ex (ctx, temp, &len))
       SSLERROR (fail_decrypt, "EVP_EncryptFinal_ex to finalize signature check");
   }
-
-  EVP_CIPHER_CTX_free(ctx);
   return true;
 
 fail_decrypt:
-  EVP_CIPHER_CTX_free(ctx);
-fail_context_new:
+  /* don't trust the state of the context after an error */
+  cctx->key_set = false;
   return false;
 }
@@ -15,26 +15,68 @@
 #include "dds/ddsrt/types.h"
 #include "crypto_objects.h"
 
+void crypto_cipher_ctx_init (crypto_cipher_ctx *cctx)
+  ddsrt_nonnull_all;
+
+void crypto_cipher_ctx_fini (crypto_cipher_ctx *cctx)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Forgets the key the cipher context was initialized with
+ *
+ * Must be called when the master key material from which the key was derived
+ * changes. Takes the lock of the cipher context.
+ */
+void crypto_cipher_ctx_reset (crypto_cipher_ctx *cctx)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Checks whether the cipher context is initialized for a key
+ *
+ * The caller must hold the lock of the cipher context.
+ *
+ * @param[in]     cctx          The cipher context
+ * @param[in]     id            The session id of the key
+ * @param[in]     key_size      The size of the key (128 or 256 bit)
+ * @param[in]     encrypt       Whether the context is used for encrypting or decrypting
+ */
+bool crypto_cipher_ctx_has_key (const crypto_cipher_ctx *cctx, uint32_t id, uint32_t key_size, bool encrypt)
+  ddsrt_nonnull_all ddsrt_attribute_warn_unused_result;
+
+/**
+ * @brief Initializes the cipher context with a key
+ *
+ * The caller must hold the lock of the cipher context.
+ *
+ * @param[in,out] cctx          The cipher context
+ * @param[in]     id            The session id of the key
+ * @param[in]     key           The (derived) session key
+ * @param[in]     key_size      The size of the session key (128 or 256 bit)
+ * @param[in]     encrypt       Whether the context is used for encrypting or decrypting
+ * @param[in,out] ex            Security exception
+ */
+bool crypto_cipher_ctx_set_key (crypto_cipher_ctx *cctx, uint32_t id, const crypto_session_key_t *key, uint32_t key_size, bool encrypt, DDS_Security_SecurityException *ex)
+  ddsrt_nonnull_all ddsrt_attribute_warn_unused_result;
+
 /**
- * @brief Encodes the provide data using the provided key
+ * @brief Encodes the provide data using the key of the cipher context
  *
- * This function encodes the provide data using the provided key, key_size
- * and initialization_vector. It also computes the common_mac from the provided data.
- * The data parameter contains the data that has to encoded. The aad parameter contains
- * the data that is not encoded but is used in the computation of the common_mac
- * On return the encrypted parameter contains the encoded data and the tag parameter
+ * This function encodes the provide data using the key the cipher context has been
+ * initialized with and the provided initialization_vector. It also computes the
+ * common_mac from the provided data. The inpdata parameter contains the data that
+ * has to be encoded.
+ * On return the outpdata parameter contains the encoded data and the tag parameter
  * the common mac.
  * This function will be used either to encode the provided data in that case the
- * data parameter should be set to the data to be encoded and the aad parameter should
- * be NULL. Also the encrypted parameter should be set and contain a buffer large enough
- * to contain the encoded data.
- * This function is also used to only computer the common_mac. In that case the
- * data parameter should be NULL and the aad parameter should point to the data on
- * which the common_mac has to be computed. The encryped parameter is not relevant
- * in this case.
+ * outpdata parameter should be set and contain a buffer large enough to contain the
+ * encoded data.
+ * This function is also used to only compute the common_mac. In that case the
+ * outpdata parameter should be NULL and the common_mac is computed over the input
+ * data.
+ * The caller must hold the lock of the cipher context, which must have been
+ * initialized for encrypting using crypto_cipher_ctx_set_key.
  *
- * @param[in]     session_key   The session key used to encode the provided data
- * @param[in]     key_size      The size of the session key (128 or 256 bit)
+ * @param[in,out] cctx          The cipher context
  * @param[in]     iv            The init vector used by the encoding
  * @param[in]     num_inp       The number of input data segments
  * @param[in]     inpdata       The input data segments
@@ -42,28 +84,28 @@
  * @param[in,out] tag           Contains on return the mac value calculated over the provided data
  * @param[in,out] ex            Security exception
  */
-bool crypto_cipher_encrypt_data(const crypto_session_key_t *session_key, uint32_t key_size, const struct init_vector *iv, const size_t num_inp, const trusted_crypto_data_t *inpdata, trusted_crypto_data_t *outpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
-  ddsrt_nonnull((1, 3, 5, 7, 8)) ddsrt_attribute_warn_unused_result;
+bool crypto_cipher_encrypt_data(crypto_cipher_ctx *cctx, const struct init_vector *iv, const size_t num_inp, const trusted_crypto_data_t *inpdata, trusted_crypto_data_t *outpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
+  ddsrt_nonnull((1, 2, 4, 6, 7)) ddsrt_attribute_warn_unused_result;
 
-bool crypto_cipher_calc_hmac (const crypto_session_key_t *session_key, uint32_t key_size, const struct init_vector *iv, const tainted_crypto_data_t *inpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
-  ddsrt_nonnull((1, 3, 4, 5, 6)) ddsrt_attribute_warn_unused_result;
+bool crypto_cipher_calc_hmac (crypto_cipher_ctx *cctx, const struct init_vector *iv, const tainted_crypto_data_t *inpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
+  ddsrt_nonnull_all ddsrt_attribute_warn_unused_result;
 
 /**
- * @brief Decodes the provided data using the session key and key_size
+ * @brief Decodes the provided data using the key of the cipher context
  *
- * This function decodes the provided data using the session key and key_size provided
- * by by the session parameter. The iv parameter contains the initialization_vector used
+ * This function decodes the provided data using the key the cipher context has been
+ * initialized with. The iv parameter contains the initialization_vector used
  * by the decode operation which is the concatination of received session_id and init_vector_suffix.
  * The function checks if the common_mac (tag parameter) is corresponds with the provided data.
  * This function will be used either to decode the provided data in that case the
- * encrypted parameter should be set to the data to be decoded and the aad parameter should
- * be NULL. Also the data parameter should be set and contain a buffer large enough
- * to contain the decoded data.
+ * outpdata parameter should be set and contain a buffer large enough to contain
+ * the decoded data.
  * This function is also used to only verify the common_mac. In that case the
- * data and the encrypted parameter should be NULL and the aad parameter should point to
- * the data for which the common_mac has to be verified.
+ * outpdata parameter should be NULL and the common_mac is verified for the input data.
+ * The caller must hold the lock of the cipher context, which must have been
+ * initialized for decrypting using crypto_cipher_ctx_set_key.
  *
- * @param[in]     session       Contains the session key and key size used of the decoding
+ * @param[in,out] cctx          The cipher context
  * @param[in]     iv            The init vector used by the decoding
  * @param[in]     num_inp       The number of input data segments
  * @param[in]     inpdata       The input data segments
@@ -71,7 +113,7 @@ bool crypto_cipher_calc_hmac (const crypto_session_key_t *session_key, uint32_t
  * @param[in,out] tag           The mac value which has to be verified
  * @param[in,out] ex            Security exception
  */
-bool crypto_cipher_decrypt_data(const remote_session_info *session, const struct init_vector *iv, const size_t num_inp, const const_tainted_crypto_data_t *inpdata, tainted_crypto_data_t *outpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
+bool crypto_cipher_decrypt_data(crypto_cipher_ctx *cctx, const struct init_vector *iv, const size_t num_inp, const const_tainted_crypto_data_t *inpdata, tainted_crypto_data_t *outpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
   ddsrt_nonnull((1, 2, 4, 6, 7)) ddsrt_attribute_warn_unused_result;
 
 #endif /* CRYPTO_CIPHER_H */
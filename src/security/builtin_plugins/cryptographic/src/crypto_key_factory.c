@@ -74,6 +74,8 @@ crypto_token_copy(
       memcpy(dst->master_receiver_specific_key, src->master_receiver_specific_key._buffer, key_bytes);
   }
   dst->transformation_kind = src_transform_kind;
+  crypto_cipher_ctx_reset(&dst->sender_cipher);
+  crypto_cipher_ctx_reset(&dst->receiver_specific_cipher);
 };
 
 /* Compute KeyMaterial_AES_GCM_GMAC as described in DDS Security spec v1.1 section 9.5.2.1.2 (table 67 and table 68) */
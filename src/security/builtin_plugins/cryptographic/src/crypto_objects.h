@@ -13,6 +13,7 @@
 #define CRYPTO_OBJECTS_H
 
 #include <openssl/rand.h>
+#include <openssl/evp.h>
 #include "dds/ddsrt/atomics.h"
 #include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/types.h"
@@ -75,6 +76,21 @@ struct local_datareader_crypto;
 struct remote_datawriter_crypto;
 struct remote_datareader_crypto;
 
+/* AES-GCM cipher context initialized with the key derived for session "id",
+   so that subsequent operations using that same key only need to set the IV
+   instead of deriving the key and expanding the key schedule every time.  An
+   EVP_CIPHER_CTX can only be used for one operation at a time, hence the lock,
+   which must be held while using the context. */
+typedef struct crypto_cipher_ctx
+{
+  ddsrt_mutex_t lock;
+  EVP_CIPHER_CTX *ctx;
+  bool key_set;
+  bool encrypt;
+  uint32_t id;
+  uint32_t key_size;
+} crypto_cipher_ctx;
+
 typedef struct master_key_material
 {
   CryptoObject _parent;
@@ -84,6 +100,8 @@ typedef struct master_key_material
   unsigned char *master_sender_key;
   uint32_t receiver_specific_key_id;
   unsigned char *master_receiver_specific_key;
+  crypto_cipher_ctx sender_cipher; /* session key derived from master_sender_key (decoding) */
+  crypto_cipher_ctx receiver_specific_cipher; /* key derived from master_receiver_specific_key */
 } master_key_material;
 
 typedef struct session_key_material
@@ -97,15 +115,9 @@ typedef struct session_key_material
   uint64_t max_blocks_per_session;
   uint64_t init_vector_suffix;
   master_key_material *master_key_material;
+  crypto_cipher_ctx cipher;
 } session_key_material;
 
-typedef struct remote_session_info
-{
-  uint32_t key_size;
-  uint32_t id;
-  crypto_session_key_t key;
-} remote_session_info;
-
 typedef struct key_relation
 {
   CryptoObject _parent;
@@ -292,11 +292,59 @@ static tainted_input_buffer_t tainted_input_buffer_from_OctetSeq (const DDS_Secu
   };
 }
 
-static bool initialize_remote_session_info (remote_session_info *info, const struct const_tainted_secure_prefix *prefix, const unsigned char *master_salt, const unsigned char *master_key, DDS_Security_CryptoTransformKind_Enum transformation_kind, DDS_Security_SecurityException *ex)
+static bool session_encrypt_data (session_key_material *session, const struct init_vector *iv, const size_t num_inp, const trusted_crypto_data_t *inpdata, trusted_crypto_data_t *outpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
 {
-  info->key_size = crypto_get_key_size (transformation_kind);
-  info->id = prefix->session_id;
-  return crypto_calculate_session_key (&info->key, info->id, master_salt, master_key, transformation_kind, ex);
+  crypto_cipher_ctx * const cctx = &session->cipher;
+  bool result = true;
+  ddsrt_mutex_lock (&cctx->lock);
+  if (!crypto_cipher_ctx_has_key (cctx, session->id, session->key_size, true))
+    result = crypto_cipher_ctx_set_key (cctx, session->id, &session->key, session->key_size, true, ex);
+  if (result)
+    result = crypto_cipher_encrypt_data (cctx, iv, num_inp, inpdata, outpdata, tag, ex);
+  ddsrt_mutex_unlock (&cctx->lock);
+  return result;
+}
+
+static bool remote_session_decrypt_data (master_key_material *keymat, const struct const_tainted_secure_prefix *prefix, const const_tainted_crypto_data_t *inpdata, tainted_crypto_data_t *outpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
+{
+  /* consecutive messages from a remote writer/participant nearly always use the
+     same session, so the derived session key is retained in the key material */
+  crypto_cipher_ctx * const cctx = &keymat->sender_cipher;
+  const uint32_t key_size = crypto_get_key_size (keymat->transformation_kind);
+  bool result = true;
+  ddsrt_mutex_lock (&cctx->lock);
+  if (!crypto_cipher_ctx_has_key (cctx, prefix->session_id, key_size, false))
+  {
+    crypto_session_key_t key;
+    result = crypto_calculate_session_key (&key, prefix->session_id, keymat->master_salt, keymat->master_sender_key, keymat->transformation_kind, ex) &&
+             crypto_cipher_ctx_set_key (cctx, prefix->session_id, &key, key_size, false, ex);
+    memset (&key, 0, sizeof (key));
+  }
+  if (result)
+    result = crypto_cipher_decrypt_data (cctx, &prefix->iv, 1, inpdata, outpdata, tag, ex);
+  ddsrt_mutex_unlock (&cctx->lock);
+  return result;
+}
+
+static bool receiver_specific_calc_hmac (master_key_material *keymat, uint32_t session_id, const struct init_vector *iv, const tainted_crypto_data_t *inpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
+{
+  /* the receiver specific key only changes with the session, retain it to avoid
+     deriving it for each receiver of each message */
+  crypto_cipher_ctx * const cctx = &keymat->receiver_specific_cipher;
+  const uint32_t key_size = crypto_get_key_size (keymat->transformation_kind);
+  bool result = true;
+  ddsrt_mutex_lock (&cctx->lock);
+  if (!crypto_cipher_ctx_has_key (cctx, session_id, key_size, true))
+  {
+    crypto_session_key_t key;
+    result = crypto_calculate_receiver_specific_key (&key, session_id, keymat->master_salt, keymat->master_receiver_specific_key, keymat->transformation_kind, ex) &&
+             crypto_cipher_ctx_set_key (cctx, session_id, &key, key_size, true, ex);
+    memset (&key, 0, sizeof (key));
+  }
+  if (result)
+    result = crypto_cipher_calc_hmac (cctx, iv, inpdata, tag, ex);
+  ddsrt_mutex_unlock (&cctx->lock);
+  return result;
 }
 
 static bool read_submsg_header (tainted_input_buffer_t *input, uint8_t smid, SubmessageHeader_t *hdr, bool *bswap, tainted_input_buffer_t *submsg_view)
@@ -677,14 +725,14 @@ encode_serialized_payload(
     encrypted_data.x.base = content->data;
     encrypted_data.x.length = plain_buffer->_length;
 
-    if (!crypto_cipher_encrypt_data(&session->key, session->key_size, &prefix->iv, 1, &plain_data, &encrypted_data, &hmac, ex))
+    if (!session_encrypt_data(session, &prefix->iv, 1, &plain_data, &encrypted_data, &hmac, ex))
       goto fail_encrypt;
     content->length = ddsrt_toBE4u((uint32_t)encrypted_data.x.length);
   }
   else if (is_authentication_required(transform_kind))
   {
     /* the transformation_kind indicates only indicates authentication the determine HMAC */
-    if (!crypto_cipher_encrypt_data(&session->key, session->key_size, &prefix->iv, 1, &plain_data, NULL, &hmac, ex))
+    if (!session_encrypt_data(session, &prefix->iv, 1, &plain_data, NULL, &hmac, ex))
       goto fail_encrypt;
     unsigned char *ptr = trusted_crypto_buffer_append(&buffer,  plain_buffer->_length);
     memcpy(ptr, plain_buffer->_buffer, plain_buffer->_length);
@@ -758,13 +806,11 @@ add_specific_mac(
   {
     struct trusted_crypto_header const * const h = (struct trusted_crypto_header const *) (buffer->contents + header_offset);
     struct trusted_crypto_footer const * const f = (struct trusted_crypto_footer const *) (buffer->contents + footer_offset);
-    crypto_session_key_t key;
-    const trusted_crypto_data_t data = { {
+    const tainted_crypto_data_t data = {
       .base = (unsigned char *) f->postfix.common_mac.data,
       .length = CRYPTO_HMAC_SIZE
-    } };
-    if (!crypto_calculate_receiver_specific_key (&key, session->id, keymat->master_salt, keymat->master_receiver_specific_key, keymat->transformation_kind, ex) ||
-        !crypto_cipher_encrypt_data (&key, session->key_size, &h->prefix.iv, 1, &data, NULL, &hmac, ex))
+    };
+    if (!receiver_specific_calc_hmac (keymat, session->id, &h->prefix.iv, &data, &hmac, ex))
       return false;
   }
 
@@ -948,7 +994,7 @@ encode_submmessage_encrypt(
     trusted_crypto_data_t encrypted_data = {{ .base = body->content.data, .length = plain_submsg->_length }};
 
     /* encrypt submessage */
-    if (!crypto_cipher_encrypt_data(&session->key, session->key_size, &header->prefix.iv, 1, &plain_data, &encrypted_data, &hmac, ex))
+    if (!session_encrypt_data(session, &header->prefix.iv, 1, &plain_data, &encrypted_data, &hmac, ex))
       goto enc_submsg_fail;
 
     /* adjust the length of the body submessage when needed */
@@ -964,7 +1010,7 @@ encode_submmessage_encrypt(
   {
     unsigned char *ptr = trusted_crypto_buffer_append(&buffer, plain_submsg->_length);
     /* the transformation_kind indicates only indicates authentication the determine HMAC */
-    if (!crypto_cipher_encrypt_data(&session->key, session->key_size, &header->prefix.iv, 1, &plain_data, NULL, &hmac, ex))
+    if (!session_encrypt_data(session, &header->prefix.iv, 1, &plain_data, NULL, &hmac, ex))
       goto enc_submsg_fail;
 
     /* copy submessage */
@@ -1125,7 +1171,6 @@ check_reader_specific_mac(
   master_key_material *keymat = NULL;
   tainted_crypto_data_t data = { .base = postfix->common_mac.data, .length = CRYPTO_HMAC_SIZE };
   uint32_t index;
-  crypto_session_key_t key;
   const crypto_hmac_t *href = NULL;
   crypto_hmac_t hmac;
 
@@ -1152,14 +1197,7 @@ check_reader_specific_mac(
     goto check_failed;
   }
 
-  if (!crypto_calculate_receiver_specific_key(&key, prefix->session_id, keymat->master_salt, keymat->master_receiver_specific_key, keymat->transformation_kind, ex))
-  {
-    DDS_Security_Exception_set(ex, DDS_CRYPTO_PLUGIN_CONTEXT, DDS_SECURITY_ERR_INVALID_CRYPTO_RECEIVER_SIGN_CODE, 0,
-        "%s: failed to calculate receiver specific session key", context);
-    goto check_failed;
-  }
-
-  if (!crypto_cipher_calc_hmac(&key, crypto_get_key_size(keymat->transformation_kind), &prefix->iv, &data, &hmac, ex))
+  if (!receiver_specific_calc_hmac(keymat, prefix->session_id, &prefix->iv, &data, &hmac, ex))
   {
     DDS_Security_Exception_set(ex, DDS_CRYPTO_PLUGIN_CONTEXT, DDS_SECURITY_ERR_INVALID_CRYPTO_RECEIVER_SIGN_CODE, 0,
         "%s: failed to calculate receiver specific hmac", context);
@@ -1292,7 +1330,7 @@ static DDS_Security_boolean encode_rtps_message_encrypt (
     encrypted_data.x.length = secure_body_plain_size;
 
     /* encrypt message */
-    if (!crypto_cipher_encrypt_data(&session->key, session->key_size, &header->prefix.iv, num_segs, plain_data, &encrypted_data, &hmac, ex))
+    if (!session_encrypt_data(session, &header->prefix.iv, num_segs, plain_data, &encrypted_data, &hmac, ex))
       goto enc_rtps_fail_data;
 
     body->content.length = ddsrt_toBE4u((uint32_t)encrypted_data.x.length);
@@ -1307,7 +1345,7 @@ static DDS_Security_boolean encode_rtps_message_encrypt (
   {
     unsigned char *ptr = trusted_crypto_buffer_append(&buffer, secure_body_plain_size);
     /* the transformation_kind indicates only indicates authentication the determine HMAC */
-    if (!crypto_cipher_encrypt_data(&session->key, session->key_size, &header->prefix.iv, num_segs, plain_data, NULL, &hmac, ex))
+    if (!session_encrypt_data(session, &header->prefix.iv, num_segs, plain_data, NULL, &hmac, ex))
       goto enc_rtps_fail_data;
 
     /* copy submessage */
@@ -1405,7 +1443,6 @@ decode_rtps_message(dds_security_crypto_transform *instance,
 {
   dds_security_crypto_transform_impl *impl = (dds_security_crypto_transform_impl *)instance;
   dds_security_crypto_key_factory *factory = cryptography_get_crypto_key_factory(impl->crypto);
-  remote_session_info remote_session;
   struct const_tainted_encrypted_state estate;
   unsigned char *buffer = NULL;
   size_t buflen;
@@ -1448,14 +1485,6 @@ decode_rtps_message(dds_security_crypto_transform *instance,
       goto fail_reader_mac;
   }
 
-  /* calculate the session key */
-  if (!initialize_remote_session_info(&remote_session, &estate.prefix, remote_key_material->master_salt, remote_key_material->master_sender_key, remote_key_material->transformation_kind, ex))
-  {
-    DDS_Security_Exception_set(ex, DDS_CRYPTO_PLUGIN_CONTEXT, DDS_SECURITY_ERR_INVALID_CRYPTO_ARGUMENT_CODE, 0,
-        "%s: " DDS_SECURITY_ERR_INVALID_CRYPTO_ARGUMENT_MESSAGE, context);
-    goto fail_reader_mac;
-  }
-
   buflen = estate.body.data.length + RTPS_MESSAGE_HEADER_SIZE;
   buffer = ddsrt_malloc(buflen);
   memcpy(buffer, encoded_data.base, RTPS_MESSAGE_HEADER_SIZE);
@@ -1481,7 +1510,7 @@ decode_rtps_message(dds_security_crypto_transform *instance,
       goto fail_decrypt;
     }
 
-    if (!crypto_cipher_decrypt_data(&remote_session, &estate.prefix.iv, 1, &estate.body.data, &decoded_body, &estate.postfix.common_mac, ex))
+    if (!remote_session_decrypt_data(remote_key_material, &estate.prefix, &estate.body.data, &decoded_body, &estate.postfix.common_mac, ex))
       goto fail_decrypt;
   }
   else if (is_authentication_required(estate.prefix.transform_kind))
@@ -1493,7 +1522,7 @@ decode_rtps_message(dds_security_crypto_transform *instance,
       goto fail_decrypt;
     }
     /* When the CryptoHeader indicates that authentication is performed then calculate the HMAC */
-    if (!crypto_cipher_decrypt_data(&remote_session, &estate.prefix.iv, 1, &estate.body.data, NULL, &estate.postfix.common_mac, ex))
+    if (!remote_session_decrypt_data(remote_key_material, &estate.prefix, &estate.body.data, NULL, &estate.postfix.common_mac, ex))
       goto fail_decrypt;
     memcpy(decoded_body.base, estate.body.data.base, estate.body.data.length);
   }
@@ -1580,7 +1609,6 @@ decode_submessage(
   master_key_material *keymat;
   tainted_crypto_data_t plain_data;
   DDS_Security_ProtectionKind protection_kind;
-  remote_session_info remote_session;
   struct const_tainted_encrypted_state est;
 
   assert(encoded_submsg && encoded_submsg->endp > encoded_submsg->ptr && encoded_submsg->ptr);
@@ -1616,10 +1644,6 @@ decode_submessage(
   if (has_origin_authentication(protection_kind) && !check_reader_specific_mac(factory, &est.prefix, &est.postfix, kind, remote_crypto, context, ex))
     goto fail_mac;
 
-  /* calculate the session key */
-  if (!initialize_remote_session_info(&remote_session, &est.prefix, keymat->master_salt, keymat->master_sender_key, keymat->transformation_kind, ex))
-    goto fail_mac;
-
   plain_data.base = ddsrt_malloc(est.body.data.length);
   plain_data.length = est.body.data.length;
 
@@ -1641,7 +1665,7 @@ decode_submessage(
       goto fail_decrypt;
     }
 
-    if (!crypto_cipher_decrypt_data(&remote_session, &est.prefix.iv, 1, &est.body.data, &plain_data, &est.postfix.common_mac, ex))
+    if (!remote_session_decrypt_data(keymat, &est.prefix, &est.body.data, &plain_data, &est.postfix.common_mac, ex))
       goto fail_decrypt;
   }
   else if (is_authentication_required(est.prefix.transform_kind))
@@ -1654,7 +1678,7 @@ decode_submessage(
     }
     assert(est.prefix.transform_id != 0);
     /* When the CryptoHeader indicates that authentication is performed then calculate the HMAC */
-    if (!crypto_cipher_decrypt_data(&remote_session, &est.prefix.iv, 1, &est.body.data, NULL, &est.postfix.common_mac, ex))
+    if (!remote_session_decrypt_data(keymat, &est.prefix, &est.body.data, NULL, &est.postfix.common_mac, ex))
       goto fail_decrypt;
 
     memcpy(plain_data.base, est.body.data.base, est.body.data.length);
@@ -1723,7 +1747,6 @@ decode_serialized_payload(
   tainted_crypto_data_t plain_data;
   DDS_Security_BasicProtectionKind basic_protection_kind;
   master_key_material *writer_master_key;
-  remote_session_info remote_session;
   struct const_tainted_encrypted_state estate;
 
   DDSRT_UNUSED_ARG(inline_qos);
@@ -1760,10 +1783,6 @@ decode_serialized_payload(
   plain_data.base = ddsrt_malloc(estate.body.data.length);
   plain_data.length = estate.body.data.length;
 
-  /* calculate the session key */
-  if (!initialize_remote_session_info(&remote_session, &estate.prefix, writer_master_key->master_salt, writer_master_key->master_sender_key, writer_master_key->transformation_kind, ex))
-    goto fail_decrypt;
-
   /*
    * Depending on encryption, the payload part between Header and Footer is
    * either CryptoContent or the original plain payload.
@@ -1779,7 +1798,7 @@ decode_serialized_payload(
       goto fail_decrypt;
     }
 
-    if (!crypto_cipher_decrypt_data(&remote_session, &estate.prefix.iv, 1, &estate.body.data, &plain_data, &estate.postfix.common_mac, ex))
+    if (!remote_session_decrypt_data(writer_master_key, &estate.prefix, &estate.body.data, &plain_data, &estate.postfix.common_mac, ex))
       goto fail_decrypt;
   }
   else if (is_authentication_required(estate.prefix.transform_kind))
@@ -1792,7 +1811,7 @@ decode_serialized_payload(
       goto fail_decrypt;
     }
     /* When the CryptoHeader indicates that authentication is performed then calculate the HMAC */
-    if (!crypto_cipher_decrypt_data(&remote_session, &estate.prefix.iv, 1, &estate.body.data, NULL, &estate.postfix.common_mac, ex))
+    if (!remote_session_decrypt_data(writer_master_key, &estate.prefix, &estate.body.data, NULL, &estate.postfix.common_mac, ex))
       goto fail_decrypt;
     memcpy(plain_data.base, estate.body.data.base,  estate.body.data.length);
   }
@@ -0,0 +1,346 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "dds/ddsrt/bswap.h"
+#include "dds/ddsrt/endian.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/string.h"
+#include "dds/ddsrt/time.h"
+#include "dds/ddsrt/types.h"
+#include "dds/security/dds_security_api.h"
+#include "dds/security/core/dds_security_utils.h"
+#include "dds/security/core/shared_secret.h"
+#include "dds/security/openssl_support.h"
+#include "CUnit/CUnit.h"
+#include "CUnit/Test.h"
+#include "common/src/loader.h"
+#include "crypto_objects.h"
+
+/* Measures the throughput of the encoding operations of the builtin
+   cryptographic plugin, for each of the AES-GCM/GMAC transformation kinds and
+   a few message sizes.  Submessage and RTPS message protection use origin
+   authentication for a number of receivers, so that the receiver-specific
+   MACs are included in the measurement.  The results are only printed, as
+   the numbers depend on the machine. */
+
+#define N_RECEIVERS 4u
+#define BYTES_PER_MEASUREMENT (8u * 1024u * 1024u)
+#define RTPS_HEADER_SIZE 20u
+
+struct submsg_header
+{
+  unsigned char id;
+  unsigned char flags;
+  uint16_t length;
+};
+
+static struct plugins_hdl *plugins = NULL;
+static dds_security_cryptography *crypto = NULL;
+
+static DDS_Security_IdentityHandle local_participant_identity = 1;
+static DDS_Security_ParticipantCryptoHandle local_pp_crypto = 0;
+static DDS_Security_ParticipantCryptoHandle remote_pp_cryptos[N_RECEIVERS];
+static DDS_Security_DatawriterCryptoHandle local_writer_crypto = 0;
+static DDS_Security_DatareaderCryptoHandle remote_reader_cryptos[N_RECEIVERS];
+
+static DDS_Security_SharedSecretHandleImpl *shared_secret_handle_impl = NULL;
+static DDS_Security_SharedSecretHandle shared_secret_handle;
+
+static const uint32_t payload_sizes[] = { 64, 1024, 16384 };
+
+static void reset_exception(DDS_Security_SecurityException *ex)
+{
+  ex->code = 0;
+  ex->minor_code = 0;
+  ddsrt_free(ex->message);
+  ex->message = NULL;
+}
+
+static void allocate_shared_secret(void)
+{
+  shared_secret_handle_impl = ddsrt_malloc(sizeof(DDS_Security_SharedSecretHandleImpl));
+  shared_secret_handle_impl->shared_secret = ddsrt_malloc(32);
+  shared_secret_handle_impl->shared_secret_size = 32;
+  for (int32_t i = 0; i < shared_secret_handle_impl->shared_secret_size; i++)
+    shared_secret_handle_impl->shared_secret[i] = (unsigned char)(i % 20);
+  for (int32_t i = 0; i < 32; i++)
+  {
+    shared_secret_handle_impl->challenge1[i] = (unsigned char)(i % 15);
+    shared_secret_handle_impl->challenge2[i] = (unsigned char)(i % 12);
+  }
+  shared_secret_handle = (DDS_Security_SharedSecretHandle)shared_secret_handle_impl;
+}
+
+static void deallocate_shared_secret(void)
+{
+  ddsrt_free(shared_secret_handle_impl->shared_secret);
+  ddsrt_free(shared_secret_handle_impl);
+}
+
+static bool is_encrypting(DDS_Security_CryptoTransformKind_Enum transformation_kind)
+{
+  return transformation_kind == CRYPTO_TRANSFORMATION_KIND_AES128_GCM || transformation_kind == CRYPTO_TRANSFORMATION_KIND_AES256_GCM;
+}
+
+static void prepare_key_size_property(DDS_Security_PropertySeq *properties, DDS_Security_CryptoTransformKind_Enum transformation_kind)
+{
+  const bool is_128 = (transformation_kind == CRYPTO_TRANSFORMATION_KIND_AES128_GCM || transformation_kind == CRYPTO_TRANSFORMATION_KIND_AES128_GMAC);
+  properties->_maximum = properties->_length = 1;
+  properties->_buffer = ddsrt_malloc(sizeof(DDS_Security_Property_t));
+  properties->_buffer[0].name = ddsrt_strdup(DDS_SEC_PROP_CRYPTO_KEYSIZE);
+  properties->_buffer[0].value = ddsrt_strdup(is_128 ? "128" : "256");
+  properties->_buffer[0].propagate = false;
+}
+
+static void register_entities(DDS_Security_CryptoTransformKind_Enum transformation_kind)
+{
+  DDS_Security_SecurityException exception = {NULL, 0, 0};
+  DDS_Security_ParticipantSecurityAttributes participant_attributes;
+  DDS_Security_EndpointSecurityAttributes writer_attributes;
+  DDS_Security_PropertySeq properties;
+  const bool encrypted = is_encrypting(transformation_kind);
+
+  memset(&participant_attributes, 0, sizeof(participant_attributes));
+  participant_attributes.is_rtps_protected = true;
+  participant_attributes.plugin_participant_attributes = DDS_SECURITY_PARTICIPANT_ATTRIBUTES_FLAG_IS_VALID | DDS_SECURITY_PLUGIN_PARTICIPANT_ATTRIBUTES_FLAG_IS_RTPS_AUTHENTICATED;
+  if (encrypted)
+    participant_attributes.plugin_participant_attributes |= DDS_SECURITY_PLUGIN_PARTICIPANT_ATTRIBUTES_FLAG_IS_RTPS_ENCRYPTED;
+  prepare_key_size_property(&properties, transformation_kind);
+
+  local_pp_crypto = crypto->crypto_key_factory->register_local_participant(
+      crypto->crypto_key_factory, local_participant_identity, 2, &properties, &participant_attributes, &exception);
+  if (local_pp_crypto == 0)
+    printf("register_local_participant: %s\n", exception.message ? exception.message : "Error message missing");
+  CU_ASSERT_FATAL(local_pp_crypto != 0);
+  ((local_participant_crypto *)local_pp_crypto)->rtps_protection_kind =
+      encrypted ? DDS_SECURITY_PROTECTION_KIND_ENCRYPT_WITH_ORIGIN_AUTHENTICATION : DDS_SECURITY_PROTECTION_KIND_SIGN_WITH_ORIGIN_AUTHENTICATION;
+
+  memset(&writer_attributes, 0, sizeof(writer_attributes));
+  writer_attributes.is_payload_protected = true;
+  writer_attributes.is_submessage_protected = true;
+  writer_attributes.plugin_endpoint_attributes = DDS_SECURITY_PLUGIN_ENDPOINT_ATTRIBUTES_FLAG_IS_SUBMESSAGE_ORIGIN_AUTHENTICATED;
+  if (encrypted)
+    writer_attributes.plugin_endpoint_attributes |= DDS_SECURITY_PLUGIN_ENDPOINT_ATTRIBUTES_FLAG_IS_PAYLOAD_ENCRYPTED | DDS_SECURITY_PLUGIN_ENDPOINT_ATTRIBUTES_FLAG_IS_SUBMESSAGE_ENCRYPTED;
+
+  local_writer_crypto = crypto->crypto_key_factory->register_local_datawriter(
+      crypto->crypto_key_factory, local_pp_crypto, &properties, &writer_attributes, &exception);
+  if (local_writer_crypto == 0)
+    printf("register_local_datawriter: %s\n", exception.message ? exception.message : "Error message missing");
+  CU_ASSERT_FATAL(local_writer_crypto != 0);
+  DDS_Security_PropertySeq_deinit(&properties);
+
+  for (uint32_t i = 0; i < N_RECEIVERS; i++)
+  {
+    remote_pp_cryptos[i] = crypto->crypto_key_factory->register_matched_remote_participant(
+        crypto->crypto_key_factory, local_pp_crypto, (DDS_Security_IdentityHandle)(2 + i), 5, shared_secret_handle, &exception);
+    if (remote_pp_cryptos[i] == 0)
+      printf("register_matched_remote_participant: %s\n", exception.message ? exception.message : "Error message missing");
+    CU_ASSERT_FATAL(remote_pp_cryptos[i] != 0);
+    ((remote_participant_crypto *)remote_pp_cryptos[i])->rtps_protection_kind =
+        ((local_participant_crypto *)local_pp_crypto)->rtps_protection_kind;
+
+    remote_reader_cryptos[i] = crypto->crypto_key_factory->register_matched_remote_datareader(
+        crypto->crypto_key_factory, local_writer_crypto, remote_pp_cryptos[i], shared_secret_handle, true, &exception);
+    if (remote_reader_cryptos[i] == 0)
+      printf("register_matched_remote_datareader: %s\n", exception.message ? exception.message : "Error message missing");
+    CU_ASSERT_FATAL(remote_reader_cryptos[i] != 0);
+  }
+}
+
+static void unregister_entities(void)
+{
+  DDS_Security_SecurityException exception = {NULL, 0, 0};
+  for (uint32_t i = 0; i < N_RECEIVERS; i++)
+  {
+    crypto->crypto_key_factory->unregister_datareader(crypto->crypto_key_factory, remote_reader_cryptos[i], &exception);
+    reset_exception(&exception);
+    crypto->crypto_key_factory->unregister_participant(crypto->crypto_key_factory, remote_pp_cryptos[i], &exception);
+    reset_exception(&exception);
+  }
+  crypto->crypto_key_factory->unregister_datawriter(crypto->crypto_key_factory, local_writer_crypto, &exception);
+  reset_exception(&exception);
+  crypto->crypto_key_factory->unregister_participant(crypto->crypto_key_factory, local_pp_crypto, &exception);
+  reset_exception(&exception);
+}
+
+static void initialize_message(DDS_Security_OctetSeq *msg, uint32_t offset, uint32_t size)
+{
+  /* [RTPS header] + DATA-like submessage with "size" bytes of payload */
+  struct submsg_header *header;
+  msg->_length = msg->_maximum = offset + (uint32_t)sizeof(*header) + size;
+  msg->_buffer = ddsrt_malloc(msg->_length);
+  memset(msg->_buffer, 'R', offset);
+  header = (struct submsg_header *)(msg->_buffer + offset);
+  header->id = 0x15;
+  header->flags = (DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN) ? 1 : 0;
+  header->length = (uint16_t)size;
+  for (uint32_t i = 0; i < size; i++)
+    msg->_buffer[offset + sizeof(*header) + i] = (unsigned char)i;
+}
+
+static double mbps(uint64_t bytes, dds_duration_t dt)
+{
+  return (dt > 0) ? ((double)bytes / 1048576.0) / ((double)dt / 1e9) : 0.0;
+}
+
+static dds_duration_t time_encode_serialized_payload(const DDS_Security_OctetSeq *payload, uint32_t reps)
+{
+  DDS_Security_SecurityException exception = {NULL, 0, 0};
+  DDS_Security_OctetSeq extra_inline_qos;
+  memset(&extra_inline_qos, 0, sizeof(extra_inline_qos));
+  const dds_time_t t0 = dds_time();
+  for (uint32_t i = 0; i < reps; i++)
+  {
+    DDS_Security_OctetSeq encoded = {0, 0, NULL};
+    const bool result = crypto->crypto_transform->encode_serialized_payload(
+        crypto->crypto_transform, &encoded, &extra_inline_qos, payload, local_writer_crypto, &exception);
+    if (!result)
+    {
+      printf("encode_serialized_payload: %s\n", exception.message ? exception.message : "Error message missing");
+      reset_exception(&exception);
+      CU_FAIL_FATAL("encode_serialized_payload failed");
+    }
+    DDS_Security_OctetSeq_deinit(&encoded);
+  }
+  return dds_time() - t0;
+}
+
+static dds_duration_t time_encode_datawriter_submessage(const DDS_Security_OctetSeq *submsg, uint32_t reps)
+{
+  DDS_Security_SecurityException exception = {NULL, 0, 0};
+  DDS_Security_DatareaderCryptoHandleSeq reader_list;
+  reader_list._length = reader_list._maximum = N_RECEIVERS;
+  reader_list._buffer = remote_reader_cryptos;
+  const dds_time_t t0 = dds_time();
+  for (uint32_t i = 0; i < reps; i++)
+  {
+    DDS_Security_OctetSeq encoded = {0, 0, NULL};
+    const DDS_Security_OctetSeq *input = submsg;
+    int32_t index = 0;
+    /* like the core: call again with the encoded message as input until all receiver MACs are added */
+    while (index != (int32_t)N_RECEIVERS)
+    {
+      const bool result = crypto->crypto_transform->encode_datawriter_submessage(
+          crypto->crypto_transform, &encoded, input, local_writer_crypto, &reader_list, &index, &exception);
+      if (!result)
+      {
+        printf("encode_datawriter_submessage: %s\n", exception.message ? exception.message : "Error message missing");
+        reset_exception(&exception);
+        CU_FAIL_FATAL("encode_datawriter_submessage failed");
+      }
+      input = NULL;
+    }
+    DDS_Security_OctetSeq_deinit(&encoded);
+  }
+  return dds_time() - t0;
+}
+
+static dds_duration_t time_encode_rtps_message(const DDS_Security_OctetSeq *msg, uint32_t reps)
+{
+  DDS_Security_SecurityException exception = {NULL, 0, 0};
+  DDS_Security_ParticipantCryptoHandleSeq receiver_list;
+  receiver_list._length = receiver_list._maximum = N_RECEIVERS;
+  receiver_list._buffer = remote_pp_cryptos;
+  const dds_time_t t0 = dds_time();
+  for (uint32_t i = 0; i < reps; i++)
+  {
+    DDS_Security_OctetSeq encoded = {0, 0, NULL};
+    const DDS_Security_OctetSeq *input = msg;
+    int32_t index = 0;
+    while (index != (int32_t)N_RECEIVERS)
+    {
+      const bool result = crypto->crypto_transform->encode_rtps_message(
+          crypto->crypto_transform, &encoded, input, local_pp_crypto, &receiver_list, &index, &exception);
+      if (!result)
+      {
+        printf("encode_rtps_message: %s\n", exception.message ? exception.message : "Error message missing");
+        reset_exception(&exception);
+        CU_FAIL_FATAL("encode_rtps_message failed");
+      }
+      input = NULL;
+    }
+    DDS_Security_OctetSeq_deinit(&encoded);
+  }
+  return dds_time() - t0;
+}
+
+static void crypto_throughput(DDS_Security_CryptoTransformKind_Enum transformation_kind, const char *name)
+{
+  CU_ASSERT_FATAL(crypto != NULL);
+  assert(crypto != NULL);
+  register_entities(transformation_kind);
+
+  printf("%-12s %8s %14s %14s %14s\n", name, "bytes", "payload MB/s", "submsg MB/s", "rtps MB/s");
+  for (size_t k = 0; k < sizeof(payload_sizes) / sizeof(payload_sizes[0]); k++)
+  {
+    const uint32_t size = payload_sizes[k];
+    const uint32_t reps = (BYTES_PER_MEASUREMENT + size - 1) / size;
+    const uint64_t total = (uint64_t)reps * size;
+    DDS_Security_OctetSeq payload, submsg, msg;
+    payload._length = payload._maximum = size;
+    payload._buffer = ddsrt_malloc(size);
+    memset(payload._buffer, 'P', size);
+    initialize_message(&submsg, 0, size);
+    initialize_message(&msg, RTPS_HEADER_SIZE, size);
+
+    const dds_duration_t dt_payload = time_encode_serialized_payload(&payload, reps);
+    const dds_duration_t dt_submsg = time_encode_datawriter_submessage(&submsg, reps);
+    const dds_duration_t dt_rtps = time_encode_rtps_message(&msg, reps);
+    printf("%-12s %8"PRIu32" %14.1f %14.1f %14.1f\n", "", size, mbps(total, dt_payload), mbps(total, dt_submsg), mbps(total, dt_rtps));
+
+    DDS_Security_OctetSeq_deinit(&msg);
+    DDS_Security_OctetSeq_deinit(&submsg);
+    DDS_Security_OctetSeq_deinit(&payload);
+  }
+  fflush(stdout);
+  unregister_entities();
+}
+
+static void suite_crypto_throughput_init(void)
+{
+  allocate_shared_secret();
+  CU_ASSERT_FATAL ((plugins = load_plugins(
+                      NULL    /* Access Control */,
+                      NULL    /* Authentication */,
+                      &crypto /* Cryptograpy    */,
+                      NULL)) != NULL);
+}
+
+static void suite_crypto_throughput_fini(void)
+{
+  unload_plugins(plugins);
+  deallocate_shared_secret();
+}
+
+CU_Test(ddssec_builtin_crypto_throughput, aes128_gmac, .init = suite_crypto_throughput_init, .fini = suite_crypto_throughput_fini)
+{
+  crypto_throughput(CRYPTO_TRANSFORMATION_KIND_AES128_GMAC, "AES128_GMAC");
+}
+
+CU_Test(ddssec_builtin_crypto_throughput, aes128_gcm, .init = suite_crypto_throughput_init, .fini = suite_crypto_throughput_fini)
+{
+  crypto_throughput(CRYPTO_TRANSFORMATION_KIND_AES128_GCM, "AES128_GCM");
+}
+
+CU_Test(ddssec_builtin_crypto_throughput, aes256_gmac, .init = suite_crypto_throughput_init, .fini = suite_crypto_throughput_fini)
+{
+  crypto_throughput(CRYPTO_TRANSFORMATION_KIND_AES256_GMAC, "AES256_GMAC");
+}
+
+CU_Test(ddssec_builtin_crypto_throughput, aes256_gcm, .init = suite_crypto_throughput_init, .fini = suite_crypto_throughput_fini)
+{
+  crypto_throughput(CRYPTO_TRANSFORMATION_KIND_AES256_GCM, "AES256_GCM");
+}
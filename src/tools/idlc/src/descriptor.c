@@ -1303,7 +1303,7 @@ err_keys:
 static int print_flags(FILE *fp, struct descriptor *descriptor)
 {
   const char *fmt;
-  const char *vec[4] = { NULL };
+  const char *vec[5] = { NULL };
   size_t cnt, len = 0;
 
   if (descriptor->flags & DDS_TOPIC_NO_OPTIMIZE)
@@ -1312,6 +1312,8 @@ static int print_flags(FILE *fp, struct descriptor *descriptor)
     vec[len++] = "DDS_TOPIC_CONTAINS_UNION";
   if (descriptor->flags & DDS_TOPIC_FIXED_KEY)
     vec[len++] = "DDS_TOPIC_FIXED_KEY";
+  if (descriptor->flags & DDS_TOPIC_NATIVE_OPS)
+    vec[len++] = "DDS_TOPIC_NATIVE_OPS";
 
   bool fixed_size = true;
   for (uint32_t op = 0; op < descriptor->instructions.count && fixed_size; op++)
@@ -1362,22 +1364,401 @@ static int print_descriptor(FILE *fp, struct descriptor *descriptor)
           "  %3$s_keys,\n" /* key array */
           "  %4$"PRIu32",\n" /* number of ops */
           "  %3$s_ops,\n" /* ops array */
-          "  \"\"\n" /* OpenSplice metadata */
-          "};\n";
+          "  \"\",\n"; /* OpenSplice metadata */
   else
     fmt = "  %1$"PRIu32"u,\n" /* number of keys */
           "  \"%2$s\",\n" /* fully qualified name in IDL */
           "  NULL,\n" /* key array */
           "  %4$"PRIu32",\n" /* number of ops */
           "  %3$s_ops,\n" /* ops array */
-          "  \"\"\n" /* OpenSplice metadata */
-          "};\n";
+          "  \"\",\n"; /* OpenSplice metadata */
   if (idl_fprintf(fp, fmt, descriptor->keys, name, type, descriptor->opcodes) < 0)
     return -1;
+  /* native (de)serializers */
+  if (descriptor->flags & DDS_TOPIC_NATIVE_OPS)
+    fmt = "  &%s_native_ops\n"
+          "};\n";
+  else
+    fmt = "  NULL\n"
+          "};\n";
+  if (idl_fprintf(fp, fmt, type) < 0)
+    return -1;
 
   return 0;
 }
 
+/* type-specialized (de)serializers are generated from the instruction table,
+   which makes them (de)serialize exactly like the interpreter does. this is
+   limited to types that consist of members of basic types, strings and arrays
+   and sequences of basic types (possibly in nested structs, which are inlined
+   in the instruction table). other types are left to the interpreter */
+struct native_member {
+  uint32_t code; /**< opcode */
+  uint32_t type; /**< DDS_OP_VAL_... of member, or of elements for arrays and sequences */
+  uint32_t order; /**< key order if DDS_OP_FLAG_KEY */
+  uint32_t count; /**< number of elements for arrays, size of buffer for bounded strings */
+  const char *member; /**< name of member for generating member access */
+};
+
+static uint32_t native_type_size(uint32_t type)
+{
+  assert(type >= DDS_OP_VAL_1BY && type <= DDS_OP_VAL_8BY);
+  return 1u << (type - DDS_OP_VAL_1BY);
+}
+
+static idl_retcode_t
+get_native_members(
+  const struct descriptor *descriptor,
+  struct native_member **membersp,
+  uint32_t *nmembersp)
+{
+  struct native_member *members;
+  uint32_t nmembers = 0;
+
+  *membersp = NULL;
+  *nmembersp = 0;
+  if (descriptor->flags & DDS_TOPIC_CONTAINS_UNION)
+    return IDL_RETCODE_OK;
+  if (!(members = calloc(descriptor->opcodes, sizeof(*members))))
+    return IDL_RETCODE_NO_MEMORY;
+
+  for (uint32_t i=0; i < descriptor->instructions.count; ) {
+    const struct instruction *inst = &descriptor->instructions.table[i];
+    struct native_member *m = &members[nmembers];
+    uint32_t code, type, subtype, len = 2;
+
+    assert(inst->type == OPCODE);
+    code = inst->data.opcode.code;
+    if ((code & (0xffu<<24)) == DDS_OP_RTS) {
+      /* return from subroutine only occurs at the end for supported types */
+      assert(i == descriptor->instructions.count - 1);
+      break;
+    } else if ((code & (0xffu<<24)) != DDS_OP_ADR) {
+      goto unsupported;
+    }
+    type = (code >> 16) & 0xffu;
+    subtype = (code >> 8) & 0xffu;
+    assert(i+1 < descriptor->instructions.count);
+    if (descriptor->instructions.table[i+1].type != OFFSET ||
+        !descriptor->instructions.table[i+1].data.offset.member)
+      goto unsupported;
+    m->code = code;
+    m->type = type;
+    m->order = inst->data.opcode.order;
+    m->member = descriptor->instructions.table[i+1].data.offset.member;
+    switch (type) {
+      case DDS_OP_VAL_1BY:
+      case DDS_OP_VAL_2BY:
+      case DDS_OP_VAL_4BY:
+      case DDS_OP_VAL_8BY:
+      case DDS_OP_VAL_STR:
+        break;
+      case DDS_OP_VAL_BST:
+      case DDS_OP_VAL_ARR:
+        assert(i+2 < descriptor->instructions.count);
+        assert(descriptor->instructions.table[i+2].type == SINGLE);
+        m->count = descriptor->instructions.table[i+2].data.single;
+        len = 3;
+        if (type == DDS_OP_VAL_BST)
+          break;
+        /* fall through */
+      case DDS_OP_VAL_SEQ:
+        if (subtype < DDS_OP_VAL_1BY || subtype > DDS_OP_VAL_8BY)
+          goto unsupported;
+        m->type = subtype;
+        break;
+      default:
+        goto unsupported;
+    }
+    nmembers++;
+    i += len;
+  }
+
+  *membersp = members;
+  *nmembersp = nmembers;
+  return IDL_RETCODE_OK;
+unsupported:
+  free(members);
+  return IDL_RETCODE_OK;
+}
+
+static int print_native_write(
+  FILE *fp, const char *type, const struct native_member *members, uint32_t nmembers)
+{
+  const char *fmt;
+
+  fmt = "static void %1$s_write (struct dds_ostream *os, const void *sample)\n"
+        "{\n"
+        "  const %1$s *x = sample;\n";
+  if (idl_fprintf(fp, fmt, type) < 0)
+    return -1;
+  for (uint32_t i=0; i < nmembers; i++) {
+    const struct native_member *m = &members[i];
+    const uint32_t optype = (m->code >> 16) & 0xffu;
+    int cnt;
+    if (optype == DDS_OP_VAL_STR || optype == DDS_OP_VAL_BST) {
+      fmt = "  dds_stream_write_string (os, x->%s);\n";
+      cnt = idl_fprintf(fp, fmt, m->member);
+    } else if (optype == DDS_OP_VAL_ARR) {
+      fmt = "  dds_os_put_bytes_aligned (os, x->%s, %"PRIu32"u, %"PRIu32"u);\n";
+      cnt = idl_fprintf(fp, fmt, m->member, m->count, native_type_size(m->type));
+    } else if (optype == DDS_OP_VAL_SEQ) {
+      /* no alignment padding for empty sequences */
+      fmt = "  dds_os_put4 (os, x->%1$s._length);\n"
+            "  if (x->%1$s._length > 0)\n"
+            "    dds_os_put_bytes_aligned (os, x->%1$s._buffer, x->%1$s._length, %2$"PRIu32"u);\n";
+      cnt = idl_fprintf(fp, fmt, m->member, native_type_size(m->type));
+    } else {
+      const uint32_t size = native_type_size(m->type);
+      fmt = "  dds_os_put%"PRIu32" (os, *(const uint%"PRIu32"_t *) &x->%s);\n";
+      cnt = idl_fprintf(fp, fmt, size, 8*size, m->member);
+    }
+    if (cnt < 0)
+      return -1;
+  }
+  return fputs("}\n\n", fp) < 0 ? -1 : 0;
+}
+
+static int print_native_read(
+  FILE *fp, const char *type, const struct native_member *members, uint32_t nmembers)
+{
+  const char *fmt;
+
+  fmt = "static void %1$s_read (struct dds_istream *is, void *sample)\n"
+        "{\n"
+        "  %1$s *x = sample;\n";
+  if (idl_fprintf(fp, fmt, type) < 0)
+    return -1;
+  for (uint32_t i=0; i < nmembers; i++) {
+    const struct native_member *m = &members[i];
+    const uint32_t optype = (m->code >> 16) & 0xffu;
+    int cnt;
+    if (optype == DDS_OP_VAL_STR) {
+      fmt = "  x->%1$s = dds_stream_reuse_string (is, x->%1$s);\n";
+      cnt = idl_fprintf(fp, fmt, m->member);
+    } else if (optype == DDS_OP_VAL_BST) {
+      fmt = "  dds_stream_reuse_string_bound (is, x->%s, %"PRIu32"u);\n";
+      cnt = idl_fprintf(fp, fmt, m->member, m->count);
+    } else if (optype == DDS_OP_VAL_ARR) {
+      fmt = "  dds_is_get_bytes (is, x->%s, %"PRIu32"u, %"PRIu32"u);\n";
+      cnt = idl_fprintf(fp, fmt, m->member, m->count, native_type_size(m->type));
+    } else if (optype == DDS_OP_VAL_SEQ) {
+      fmt = "  dds_stream_read_primseq (is, (dds_sequence_t *) &x->%s, %"PRIu32"u);\n";
+      cnt = idl_fprintf(fp, fmt, m->member, native_type_size(m->type));
+    } else {
+      const uint32_t size = native_type_size(m->type);
+      fmt = "  *(uint%"PRIu32"_t *) &x->%s = dds_is_get%"PRIu32" (is);\n";
+      cnt = idl_fprintf(fp, fmt, 8*size, m->member, size);
+    }
+    if (cnt < 0)
+      return -1;
+  }
+  return fputs("}\n\n", fp) < 0 ? -1 : 0;
+}
+
+static const char *native_type_code(uint32_t type)
+{
+  switch (type) {
+    case DDS_OP_VAL_1BY: return "DDS_OP_VAL_1BY";
+    case DDS_OP_VAL_2BY: return "DDS_OP_VAL_2BY";
+    case DDS_OP_VAL_4BY: return "DDS_OP_VAL_4BY";
+    default:
+      assert(type == DDS_OP_VAL_8BY);
+      return "DDS_OP_VAL_8BY";
+  }
+}
+
+static int print_native_normalize(
+  FILE *fp, const char *type, const struct native_member *members, uint32_t nmembers)
+{
+  const char *fmt;
+
+  fmt = "static bool %s_normalize (char *data, uint32_t *off, uint32_t size, bool bswap)\n"
+        "{\n";
+  if (idl_fprintf(fp, fmt, type) < 0)
+    return -1;
+  for (uint32_t i=0; i < nmembers; i++) {
+    const struct native_member *m = &members[i];
+    const uint32_t optype = (m->code >> 16) & 0xffu;
+    int cnt;
+    if (optype == DDS_OP_VAL_STR) {
+      fmt = "  if (!dds_stream_normalize_string (data, off, size, bswap, SIZE_MAX))\n";
+      cnt = idl_fprintf(fp, fmt);
+    } else if (optype == DDS_OP_VAL_BST) {
+      fmt = "  if (!dds_stream_normalize_string (data, off, size, bswap, %"PRIu32"u))\n";
+      cnt = idl_fprintf(fp, fmt, m->count);
+    } else if (optype == DDS_OP_VAL_ARR) {
+      fmt = "  if (!dds_stream_normalize_primarray (data, off, size, bswap, %"PRIu32"u, %s))\n";
+      cnt = idl_fprintf(fp, fmt, m->count, native_type_code(m->type));
+    } else if (optype == DDS_OP_VAL_SEQ) {
+      fmt = "  if (!dds_stream_normalize_primseq (data, off, size, bswap, %s))\n";
+      cnt = idl_fprintf(fp, fmt, native_type_code(m->type));
+    } else {
+      fmt = "  if (!dds_stream_normalize_prim (data, off, size, bswap, %s))\n";
+      cnt = idl_fprintf(fp, fmt, native_type_code(m->type));
+    }
+    if (cnt < 0 || fputs("    return false;\n", fp) < 0)
+      return -1;
+  }
+  return fputs("  return true;\n}\n\n", fp) < 0 ? -1 : 0;
+}
+
+static const struct native_member *
+native_key(
+  const struct native_member *members, uint32_t nmembers, uint32_t key, bool keylist)
+{
+  /* key descriptors are ordered by key order for #pragma keylist and by
+     member order otherwise (see print_keys) */
+  for (uint32_t i=0, k=0; i < nmembers; i++) {
+    if (!(members[i].code & DDS_OP_FLAG_KEY))
+      continue;
+    if (keylist ? (members[i].order == key+1) : (k == key))
+      return &members[i];
+    k++;
+  }
+  return NULL;
+}
+
+static int print_native_write_key(
+  FILE *fp, const char *type, const struct native_member *members, uint32_t nmembers, uint32_t nkeys, bool keylist)
+{
+  const char *fmt;
+
+  fmt = "static void %1$s_write_keyBE (struct dds_ostreamBE *os, const void *sample)\n"
+        "{\n"
+        "  const %1$s *x = sample;\n";
+  if (idl_fprintf(fp, fmt, type) < 0)
+    return -1;
+  /* same order as dds_stream_write_keyBE */
+  for (uint32_t k=0; k < nkeys; k++) {
+    const struct native_member *m = native_key(members, nmembers, k, keylist);
+    uint32_t optype;
+    int cnt;
+    assert(m);
+    optype = (m->code >> 16) & 0xffu;
+    if (optype == DDS_OP_VAL_STR || optype == DDS_OP_VAL_BST) {
+      fmt = "  dds_streamBE_write_string (os, x->%s);\n";
+      cnt = idl_fprintf(fp, fmt, m->member);
+    } else if (optype == DDS_OP_VAL_ARR) {
+      const uint32_t size = native_type_size(m->type);
+      fmt = "  for (uint32_t i = 0; i < %"PRIu32"u; i++)\n"
+            "    dds_os_put%"PRIu32"be (os, ((const uint%"PRIu32"_t *) x->%s)[i]);\n";
+      cnt = idl_fprintf(fp, fmt, m->count, size, 8*size, m->member);
+    } else {
+      const uint32_t size = native_type_size(m->type);
+      assert(optype != DDS_OP_VAL_SEQ);
+      fmt = "  dds_os_put%"PRIu32"be (os, *(const uint%"PRIu32"_t *) &x->%s);\n";
+      cnt = idl_fprintf(fp, fmt, size, 8*size, m->member);
+    }
+    if (cnt < 0)
+      return -1;
+  }
+  return fputs("}\n\n", fp) < 0 ? -1 : 0;
+}
+
+static int print_native_extract_key(
+  FILE *fp, const char *type, const struct native_member *members, uint32_t nmembers, uint32_t nkeys)
+{
+  const char *fmt;
+
+  fmt = "static void %s_extract_keyBE (struct dds_istream *is, struct dds_ostreamBE *os)\n"
+        "{\n";
+  if (idl_fprintf(fp, fmt, type) < 0)
+    return -1;
+  /* same order as dds_stream_extract_keyBE_from_data: member order, stop
+     after the last key */
+  for (uint32_t i=0, k=0; i < nmembers && k < nkeys; i++) {
+    const struct native_member *m = &members[i];
+    const uint32_t optype = (m->code >> 16) & 0xffu;
+    const bool key = (m->code & DDS_OP_FLAG_KEY) != 0;
+    int cnt;
+    if ((optype == DDS_OP_VAL_STR || optype == DDS_OP_VAL_BST) && key) {
+      fmt = "  {\n"
+            "    const uint32_t sz = dds_is_get4 (is);\n"
+            "    dds_os_put4be (os, sz);\n"
+            "    dds_os_put_bytes (&os->x, is->m_buffer + is->m_index, sz);\n"
+            "    is->m_index += sz;\n"
+            "  }\n";
+      cnt = idl_fprintf(fp, fmt);
+    } else if (optype == DDS_OP_VAL_STR || optype == DDS_OP_VAL_BST) {
+      cnt = idl_fprintf(fp, "  dds_stream_skip_string (is);\n");
+    } else if (optype == DDS_OP_VAL_ARR && key) {
+      fmt = "  for (uint32_t i = 0; i < %1$"PRIu32"u; i++)\n"
+            "    dds_os_put%2$"PRIu32"be (os, dds_is_get%2$"PRIu32" (is));\n";
+      cnt = idl_fprintf(fp, fmt, m->count, native_type_size(m->type));
+    } else if (optype == DDS_OP_VAL_ARR) {
+      fmt = "  dds_cdr_alignto (is, %1$"PRIu32"u);\n"
+            "  is->m_index += %2$"PRIu32"u * %1$"PRIu32"u;\n";
+      cnt = idl_fprintf(fp, fmt, native_type_size(m->type), m->count);
+    } else if (optype == DDS_OP_VAL_SEQ) {
+      assert(!key);
+      fmt = "  dds_stream_skip_primseq (is, %"PRIu32"u);\n";
+      cnt = idl_fprintf(fp, fmt, native_type_size(m->type));
+    } else if (key) {
+      fmt = "  dds_os_put%1$"PRIu32"be (os, dds_is_get%1$"PRIu32" (is));\n";
+      cnt = idl_fprintf(fp, fmt, native_type_size(m->type));
+    } else {
+      fmt = "  (void) dds_is_get%"PRIu32" (is);\n";
+      cnt = idl_fprintf(fp, fmt, native_type_size(m->type));
+    }
+    if (cnt < 0)
+      return -1;
+    if (key)
+      k++;
+  }
+  return fputs("}\n\n", fp) < 0 ? -1 : 0;
+}
+
+static int print_native_ops(FILE *fp, struct descriptor *descriptor, bool keylist)
+{
+  char *type;
+  const char *fmt;
+  struct native_member *members;
+  uint32_t nmembers;
+  int ret = -1;
+
+  if (get_native_members(descriptor, &members, &nmembers) != IDL_RETCODE_OK)
+    return -1;
+  if (!members)
+    return 0;
+  if (IDL_PRINTA(&type, print_type, descriptor->topic) < 0)
+    goto err;
+  if (print_native_write(fp, type, members, nmembers) < 0)
+    goto err;
+  if (print_native_read(fp, type, members, nmembers) < 0)
+    goto err;
+  if (print_native_normalize(fp, type, members, nmembers) < 0)
+    goto err;
+  if (descriptor->keys) {
+    if (print_native_write_key(fp, type, members, nmembers, descriptor->keys, keylist) < 0)
+      goto err;
+    if (print_native_extract_key(fp, type, members, nmembers, descriptor->keys) < 0)
+      goto err;
+    fmt = "static const dds_topic_native_ops_t %1$s_native_ops =\n{\n"
+          "  %1$s_write,\n"
+          "  %1$s_read,\n"
+          "  %1$s_normalize,\n"
+          "  %1$s_write_keyBE,\n"
+          "  %1$s_extract_keyBE\n"
+          "};\n\n";
+  } else {
+    fmt = "static const dds_topic_native_ops_t %1$s_native_ops =\n{\n"
+          "  %1$s_write,\n"
+          "  %1$s_read,\n"
+          "  %1$s_normalize,\n"
+          "  NULL,\n"
+          "  NULL\n"
+          "};\n\n";
+  }
+  if (idl_fprintf(fp, fmt, type) < 0)
+    goto err;
+  descriptor->flags |= DDS_TOPIC_NATIVE_OPS;
+  ret = 0;
+err:
+  free(members);
+  return ret;
+}
+
 idl_retcode_t generate_descriptor(const idl_pstate_t *pstate, struct generator *generator, const idl_node_t *node);
 
 idl_retcode_t
@@ -1419,6 +1800,9 @@ generate_descriptor(
     { ret = IDL_RETCODE_NO_MEMORY; goto err_print; }
   if (print_opcodes(generator->source.handle, &descriptor) < 0)
     { ret = IDL_RETCODE_NO_MEMORY; goto err_print; }
+  if (generator->config.native_serializers &&
+      print_native_ops(generator->source.handle, &descriptor, keylist) < 0)
+    { ret = IDL_RETCODE_NO_MEMORY; goto err_print; }
   if (print_descriptor(generator->source.handle, &descriptor) < 0)
     { ret = IDL_RETCODE_NO_MEMORY; goto err_print; }
 
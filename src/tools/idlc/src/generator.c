@@ -26,6 +26,25 @@
 #include "idl/processor.h"
 #include "idl/print.h"
 
+static struct {
+  int native_serializers;
+} config;
+
+static const idlc_option_t *opts[] = {
+  &(idlc_option_t){
+    IDLC_FLAG, { .flag = &config.native_serializers }, 'f', "native-serializers", "",
+    "Generate type-specialized functions for (de)serializing topic types. "
+    "Types that cannot be handled this way (e.g. those containing unions or "
+    "sequences of structs) are (de)serialized by interpreting the generated "
+    "marshalling instructions as usual." },
+  NULL
+};
+
+const idlc_option_t **idlc_generator_options(void)
+{
+  return opts;
+}
+
 static int print_base_type(
   char *str, size_t size, const void *node, void *user_data)
 {
@@ -323,6 +342,9 @@ generate_nosetup(const idl_pstate_t *pstate, struct generator *generator)
       sep = ptr+1;
   if (idl_fprintf(generator->source.handle, "#include \"%s\"\n\n", sep) < 0)
     return IDL_RETCODE_NO_MEMORY;
+  if (generator->config.native_serializers &&
+      fputs("#include \"dds/ddsi/ddsi_cdrstream.h\"\n\n", generator->source.handle) < 0)
+    return IDL_RETCODE_NO_MEMORY;
   if ((ret = generate_types(pstate, generator)))
     return ret;
   if (fputs("#ifdef __cplusplus\n}\n#endif\n\n", generator->header.handle) < 0)
@@ -376,6 +398,7 @@ idlc_generate(const idl_pstate_t *pstate)
 
   memset(&generator, 0, sizeof(generator));
   generator.path = file;
+  generator.config.native_serializers = (config.native_serializers != 0);
 
   sep = dir[0] == '\0' ? "" : "/";
   if (idl_asprintf(&generator.header.path, "%s%s%s.h", dir, sep, basename) < 0)
@@ -12,9 +12,11 @@
 #ifndef GENERATOR_H
 #define GENERATOR_H
 
+#include <stdbool.h>
 #include <stdio.h>
 
 #include "idl/processor.h"
+#include "idlc/options.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -29,6 +31,9 @@ struct generator {
     FILE *handle;
     char *path;
   } source;
+  struct {
+    bool native_serializers; /**< generate type-specialized (de)serializers */
+  } config;
 };
 
 int print_type(char *str, size_t len, const void *ptr, void *user_data);
@@ -39,6 +44,11 @@ __declspec(dllexport)
 #endif
 idl_retcode_t idlc_generate(const idl_pstate_t *pstate);
 
+#if _WIN32
+__declspec(dllexport)
+#endif
+const idlc_option_t **idlc_generator_options(void);
+
 #if _WIN32
 __declspec(dllexport)
 #endif
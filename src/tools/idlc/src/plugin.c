@@ -65,6 +65,7 @@ static void *loadsym(void *handle, const char *symbol)
 }
 
 extern int idlc_generate(const idl_pstate_t *pstate);
+extern const idlc_option_t **idlc_generator_options(void);
 
 int32_t
 idlc_load_generator(idlc_generator_plugin_t *plugin, const char *lang)
@@ -78,7 +79,7 @@ idlc_load_generator(idlc_generator_plugin_t *plugin, const char *lang)
   /* short-circuit on builtin generator */
   if (idl_strcasecmp(lang, "C") == 0) {
     plugin->handle = NULL;
-    plugin->generator_options = 0;
+    plugin->generator_options = &idlc_generator_options;
     plugin->generator_annotations = 0;
     plugin->generate = &idlc_generate;
     return 0;